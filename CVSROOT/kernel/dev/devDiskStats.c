@@ -20,6 +20,8 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include <sprite.h>
 #include <stdio.h>
 #include <sync.h>
+#include <timer.h>
+#include <dev.h>
 #include <sysStats.h>
 #include <devDiskStats.h>
 #include <user/fs.h>
@@ -51,6 +53,10 @@ typedef struct Device {
 static Sync_Semaphore deviceListMutex = Sync_SemInitStatic("devDiskStatMutex");
 static List_Links	deviceListHdr;
 static Boolean		initialized = FALSE;
+
+static int	HistBucket _ARGS_((unsigned int value));
+static unsigned int ElapsedMs _ARGS_((Timer_Ticks *startPtr,
+			Timer_Ticks *endPtr));
 
 /*
  *----------------------------------------------------------------------
@@ -65,7 +71,7 @@ static Boolean		initialized = FALSE;
  *	None.
  *
  * Side effects:
- *	None.
+ *	The queue depth histogram of each disk is updated.
  *
  *----------------------------------------------------------------------
  */
@@ -85,6 +91,14 @@ Dev_GatherDiskStats()
 	    register Sys_DiskStats *stats =
 		    &(devicePtr->devDiskStats.diskStats);
     
+	    register int depth = devicePtr->devDiskStats.busy;
+    
+	    if (depth < 0) {
+		depth = 0;
+	    } else if (depth >= DEV_DISK_HIST_BUCKETS) {
+		depth = DEV_DISK_HIST_BUCKETS - 1;
+	    }
+	    devicePtr->devDiskStats.ioStats.depthHist[depth]++;
 	    stats->numSamples++;
 	    if (devicePtr->idleCheck == (Boolean((*) _ARGS_ ((ClientData,
 		DevDiskStats *)))) NIL) {
@@ -143,6 +157,201 @@ Dev_GetDiskStats(diskStatArr, numEntries)
     return index;
 }
 
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Dev_GetDiskMergeStats --
+ *
+ *	Return the request merging counts of the different disks.  The
+ *	entries are in the same order as those of Dev_GetDiskStats.
+ *
+ * Results:
+ *	Number of statistics entries returned.
+ *
+ * Side effects:
+ *	Entries in *mergeStatArr filled in.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Dev_GetDiskMergeStats(mergeStatArr, numEntries)
+    DevDiskMergeStats *mergeStatArr;	/* Where to store the stats. */
+    int		   numEntries;	/* The number of elements in mergeStatArr. */
+{
+    Device *devicePtr;
+    int	   index;
+
+    MASTER_LOCK(&deviceListMutex);
+    index = 0;
+    if (initialized) {
+	LIST_FORALL(&deviceListHdr, (List_Links *) devicePtr) {
+	    if (index >= numEntries) {
+		break;
+	    }
+	    mergeStatArr[index] = devicePtr->devDiskStats.mergeStats;
+	    (void) strncpy(mergeStatArr[index].name,
+		    devicePtr->devDiskStats.diskStats.name,
+		    SYS_DISK_NAME_LENGTH);
+	    index += 1;
+	}
+    }
+    MASTER_UNLOCK(&deviceListMutex);
+    return index;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Dev_GetDiskIOStats --
+ *
+ *	Return the latency, size and queue depth histograms of the
+ *	different disks.  The entries are in the same order as those of
+ *	Dev_GetDiskStats.
+ *
+ * Results:
+ *	Number of statistics entries returned.
+ *
+ * Side effects:
+ *	Entries in *ioStatArr filled in.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Dev_GetDiskIOStats(ioStatArr, numEntries)
+    DevDiskIOStats *ioStatArr;	/* Where to store the stats. */
+    int		   numEntries;	/* The number of elements in ioStatArr. */
+{
+    Device *devicePtr;
+    int	   index;
+
+    MASTER_LOCK(&deviceListMutex);
+    index = 0;
+    if (initialized) {
+	LIST_FORALL(&deviceListHdr, (List_Links *) devicePtr) {
+	    if (index >= numEntries) {
+		break;
+	    }
+	    ioStatArr[index] = devicePtr->devDiskStats.ioStats;
+	    ioStatArr[index].version = DEV_DISK_IO_STATS_VERSION;
+	    (void) strncpy(ioStatArr[index].name,
+		    devicePtr->devDiskStats.diskStats.name,
+		    SYS_DISK_NAME_LENGTH);
+	    index += 1;
+	}
+    }
+    MASTER_UNLOCK(&deviceListMutex);
+    return index;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DevDiskIODone --
+ *
+ *	Record a finished request in the histograms of a disk.  Disk
+ *	drivers call this from their completion routines.
+ *
+ *	NOTE: The caller must hold diskStatsPtr->mutex.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The disk's histograms are updated.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+DevDiskIODone(diskStatsPtr, operation, byteCount, issueTimePtr, startTimePtr)
+    DevDiskStats *diskStatsPtr;	/* Stats of the disk. */
+    int		operation;	/* FS_READ or FS_WRITE. */
+    int		byteCount;	/* Bytes transferred. */
+    Timer_Ticks	*issueTimePtr;	/* When the driver was given the request. */
+    Timer_Ticks	*startTimePtr;	/* When the request went to the device. */
+{
+    register DevDiskIOStats *ioStatsPtr = &(diskStatsPtr->ioStats);
+    Timer_Ticks	now;
+    int		dir;
+
+    Timer_GetCurrentTicks(&now);
+    dir = (operation == FS_READ) ? DEV_DISK_READ : DEV_DISK_WRITE;
+    ioStatsPtr->waitHist[dir][HistBucket(ElapsedMs(issueTimePtr,
+					startTimePtr))]++;
+    ioStatsPtr->serviceHist[dir][HistBucket(ElapsedMs(startTimePtr,
+					&now))]++;
+    ioStatsPtr->sizeHist[dir][HistBucket((unsigned int)
+					byteCount / DEV_BYTES_PER_SECTOR)]++;
+    if (diskStatsPtr->busy > ioStatsPtr->maxDepth) {
+	ioStatsPtr->maxDepth = diskStatsPtr->busy;
+    }
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * HistBucket --
+ *
+ *	Find the histogram bucket of a value.
+ *
+ * Results:
+ *	0 for 0, otherwise 1 plus the log base 2 of the value, limited
+ *	to the last bucket.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+HistBucket(value)
+    unsigned int value;	/* Value to find the bucket of. */
+{
+    int		bucket;
+
+    for (bucket = 0; (value != 0) && (bucket < DEV_DISK_HIST_BUCKETS - 1);
+	 bucket++) {
+	value >>= 1;
+    }
+    return bucket;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ElapsedMs --
+ *
+ *	Compute the time between two tick values.
+ *
+ * Results:
+ *	The number of milliseconds from *startPtr to *endPtr, 0 if
+ *	*endPtr is earlier.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static unsigned int
+ElapsedMs(startPtr, endPtr)
+    Timer_Ticks	*startPtr;	/* Start of the interval. */
+    Timer_Ticks	*endPtr;	/* End of the interval. */
+{
+    Timer_Ticks	diff;
+    Time	time;
+
+    Timer_SubtractTicks(*endPtr, *startPtr, &diff);
+    Timer_TicksToTime(diff, &time);
+    if (time.seconds > 1000000) {
+	return 1000000000;
+    }
+    return time.seconds * 1000 + time.microseconds / 1000;
+}
+
 
 /*
  *----------------------------------------------------------------------
@@ -293,11 +502,13 @@ DevPrintIOStats(time, clientData)
     ClientData	clientData;
 {
     Sys_DiskStats	diskStats[10];
-    int			numStats;
+    DevDiskMergeStats	mergeStats[10];
+    int			numStats, numMergeStats;
     int			i;
 
     /* print stuff */
     numStats = Dev_GetDiskStats(diskStats, 10 * sizeof (Sys_DiskStats));
+    numMergeStats = Dev_GetDiskMergeStats(mergeStats, 10);
     printf("IO STATS:\n");
     for (i = 0; i < numStats; i++) {
 	printf("name: %s\n", diskStats[i].name);
@@ -306,6 +517,10 @@ DevPrintIOStats(time, clientData)
 	printf("idleCount: %d\n", diskStats[i].idleCount);
 	printf("diskReads: %d\n", diskStats[i].diskReads);
 	printf("diskWrites: %d\n", diskStats[i].diskWrites);
+	if (i < numMergeStats) {
+	    printf("numMerges: %d\n", mergeStats[i].numMerges);
+	    printf("numMergedReqs: %d\n", mergeStats[i].numMergedReqs);
+	}
     }
     printf("\n");
 
@@ -22,6 +22,61 @@
 #include <user/sysStats.h>
 #include <user/fs.h>
 
+/*
+ * Counts of requests merged by the device queue.  These are kept apart
+ * from the Sys_DiskStats so that the structure user programs know about
+ * doesn't change.  See Dev_GetDiskMergeStats.
+ */
+typedef struct DevDiskMergeStats {
+    char	name[SYS_DISK_NAME_LENGTH];	/* Name of the disk. */
+    int		numMerges;	/* Merged commands sent to the disk. */
+    int		numMergedReqs;	/* Requests carried by merged commands. */
+} DevDiskMergeStats;
+
+/*
+ * Sys_Stats command that returns a DevDiskMergeStats for each disk.  The
+ * option is the number of entries the buffer holds.  The disk stats
+ * commands are numbered apart from the commands in user/sysStats.h.
+ */
+#define	SYS_DISK_MERGE_STATS	1000
+
+/*
+ * Histograms of request latency, request size and queue depth, returned
+ * by Dev_GetDiskIOStats.  Bucket 0 counts values below one unit and
+ * bucket i values from 2^(i-1) up to 2^i units; the last bucket also
+ * takes everything larger.  Times are in milliseconds and sizes in
+ * sectors.  The depth histogram is linear: bucket i counts the samples
+ * taken by Dev_GatherDiskStats with i requests outstanding.  Programs
+ * should check the version before using the rest of the structure.
+ */
+#define	DEV_DISK_IO_STATS_VERSION	1
+#define	DEV_DISK_HIST_BUCKETS		16
+
+#define	DEV_DISK_READ		0	/* Index of read histograms. */
+#define	DEV_DISK_WRITE		1	/* Index of write histograms. */
+
+typedef struct DevDiskIOStats {
+    int		version;	/* DEV_DISK_IO_STATS_VERSION. */
+    char	name[SYS_DISK_NAME_LENGTH];	/* Name of the disk. */
+    int		waitHist[2][DEV_DISK_HIST_BUCKETS];
+				/* Time from issue until the request was
+				 * sent to the device. */
+    int		serviceHist[2][DEV_DISK_HIST_BUCKETS];
+				/* Time from being sent to the device until
+				 * completion. */
+    int		sizeHist[2][DEV_DISK_HIST_BUCKETS];
+				/* Sectors transferred per request. */
+    int		depthHist[DEV_DISK_HIST_BUCKETS];
+				/* Requests outstanding, sampled. */
+    int		maxDepth;	/* Most requests ever outstanding. */
+} DevDiskIOStats;
+
+/*
+ * Sys_Stats command that returns a DevDiskIOStats for each disk.  The
+ * option is the number of entries the buffer holds.
+ */
+#define	SYS_DISK_IO_STATS	1001
+
 /*
  * This structure is used for disk stats instead of a straignt Sys_DiskStats
  * because otherwise for some types of disks (SCSI), there is no place to
@@ -31,6 +86,8 @@ typedef struct  DevDiskStats {
     Sync_Semaphore	mutex;		/* syncrhonize stat updates */
     int         	busy;		/* For idle check. */
     Sys_DiskStats 	diskStats;	/* Stat structure of device. */
+    DevDiskMergeStats	mergeStats;	/* Request merging counts. */
+    DevDiskIOStats	ioStats;	/* Latency and size histograms. */
 } DevDiskStats;
 
 
@@ -42,6 +99,12 @@ extern DevDiskStats *DevRegisterDisk _ARGS_((Fs_Device *devicePtr,
                                 DevDiskStats *diskStatsPtr)),
     ClientData clientData));
 extern void DevDiskUnregister _ARGS_((DevDiskStats *diskStatsPtr));
+extern void DevDiskIODone _ARGS_((DevDiskStats *diskStatsPtr, int operation,
+    int byteCount, Timer_Ticks *issueTimePtr, Timer_Ticks *startTimePtr));
+extern int Dev_GetDiskMergeStats _ARGS_((DevDiskMergeStats *mergeStatArr,
+    int numEntries));
+extern int Dev_GetDiskIOStats _ARGS_((DevDiskIOStats *ioStatArr,
+    int numEntries));
 extern void DevPrintIOStats _ARGS_((Timer_Ticks time, ClientData clientData));
 extern void Dev_StartIOStats _ARGS_((void));
 extern void Dev_StopIOStats _ARGS_((void));
@@ -85,6 +85,14 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
  *	2) The predefined insert "function" DEV_QUEUE_FIFO_INSERT can
  *	   be specified to the Dev_QueueCreate call to get first in
  *	   first out queuing.
+ *	3) The insert procedure of a queue can be changed at any time
+ *	   with Dev_QueueSetInsertProc().
+ *	4) A queue may have a merge procedure, set with
+ *	   Dev_QueueSetMergeProc(), that Dev_QueueGetNext() calls to
+ *	   combine the entry being taken with the entries behind it.
+ *	   This lets a driver turn several small requests for adjacent
+ *	   blocks into one large transfer while the device is busy.
+ *	   It also tells the driver when each queued entry was taken.
  *
  * Data structures used to implement device queues.
  *
@@ -123,6 +131,9 @@ typedef struct Queue {
     ClientData	clientData; /* The ClientData to use on entryAvail callbacks
 			     * for this queue.   */
     void   (*insertProc)(); /* Insert procedure to use from this queue. */
+    List_Links *(*mergeProc)(); /* Merge procedure called when an entry is
+			     * taken from this queue. NIL if none. */
+    ClientData	mergeData;  /* ClientData passed to the mergeProc. */
     unsigned int  queueBit; /* Bit used to specify this queue to the
 			     * GetNextFromSet() routine. */
     List_Links elementListHdr; /* List of elements on this queue. */
@@ -242,12 +253,136 @@ Dev_QueueCreate(ctrlQueue, queueBit, insertProc, clientData)
     queuePtr->ctrlPtr = ctrlPtr;
     queuePtr->clientData = clientData;
     queuePtr->insertProc = insertProc;
+    queuePtr->mergeProc = (List_Links *(*)()) NIL;
     queuePtr->queueBit = queueBit;
     List_Init(&(queuePtr->elementListHdr));
     return (DevQueue) queuePtr;
 
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Dev_QueueSetInsertProc --
+ *
+ *	Change the insert procedure of a device queue.  The entries
+ *	already in the queue are reinserted with the new procedure.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The queue may be reordered.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Dev_QueueSetInsertProc(devQueue, insertProc)
+    DevQueue	devQueue;	/* Queue to change. */
+    void	(*insertProc)(); /* New queue insert routine. */
+{
+    register Queue	 *queuePtr = (Queue *) devQueue;
+    register CtrlQueues  *ctrlPtr = queuePtr->ctrlPtr;
+    List_Links		 oldListHdr;
+    List_Links		 *elementPtr;
+
+    MASTER_LOCK(ctrlPtr->mutexPtr);
+    queuePtr->insertProc = insertProc;
+    if (!List_IsEmpty(&(queuePtr->elementListHdr))) {
+	/*
+	 * Move the entries to a temporary list and put them back one at
+	 * a time.  The queue stays non-empty, so its place on the ready
+	 * list doesn't change.
+	 */
+	List_Init(&oldListHdr);
+	while (!List_IsEmpty(&(queuePtr->elementListHdr))) {
+	    elementPtr = List_First(&(queuePtr->elementListHdr));
+	    List_Move(elementPtr, LIST_ATREAR(&oldListHdr));
+	}
+	while (!List_IsEmpty(&oldListHdr)) {
+	    elementPtr = List_First(&oldListHdr);
+	    List_Remove(elementPtr);
+	    if (insertProc != DEV_QUEUE_FIFO_INSERT) {
+		(insertProc)(elementPtr, &(queuePtr->elementListHdr));
+	    } else {
+		List_Insert(elementPtr,
+			LIST_ATREAR(&(queuePtr->elementListHdr)));
+	    }
+	}
+    }
+    MASTER_UNLOCK(ctrlPtr->mutexPtr);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Dev_QueueGetInsertProc --
+ *
+ *	Return the insert procedure of a device queue.
+ *
+ * Results:
+ *	The insert procedure, DEV_QUEUE_FIFO_INSERT for FIFO queueing.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+(*Dev_QueueGetInsertProc(devQueue))()
+    DevQueue	devQueue;	/* Queue to examine. */
+{
+    return ((Queue *) devQueue)->insertProc;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Dev_QueueSetMergeProc --
+ *
+ *	Set the merge procedure of a device queue.  When an entry is
+ *	taken from the queue, Dev_QueueGetNext calls the merge procedure
+ *	as:
+ *
+ *	List_Links *mergeProc(elementPtr, listHeaderPtr, mergeData)
+ *		List_Links  *elementPtr;    -- Element being taken.
+ *		List_Links  *listHeaderPtr; -- Entries left in the queue.
+ *		ClientData  mergeData;	    -- mergeData given here.
+ *
+ *	The list may be empty.  The merge procedure may remove entries
+ *	from the list and return an element that stands for them and
+ *	elementPtr, or it may return elementPtr unchanged.  Entries
+ *	handed straight to an idle controller by Dev_QueueInsert never
+ *	reach the merge procedure.  It is called with the controller's lock
+ *	held, possibly at interrupt time, so it must not block.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Dev_QueueSetMergeProc(devQueue, mergeProc, mergeData)
+    DevQueue	devQueue;	/* Queue to change. */
+    List_Links	*(*mergeProc)(); /* New merge routine, NIL for none. */
+    ClientData	mergeData;	/* Passed to mergeProc. */
+{
+    register Queue	 *queuePtr = (Queue *) devQueue;
+    register CtrlQueues  *ctrlPtr = queuePtr->ctrlPtr;
+
+    MASTER_LOCK(ctrlPtr->mutexPtr);
+    queuePtr->mergeProc = mergeProc;
+    queuePtr->mergeData = mergeData;
+    MASTER_UNLOCK(ctrlPtr->mutexPtr);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -366,7 +501,8 @@ Dev_QueueInsert(devQueue, elementPtr)
  *
  * Side effects:
  *	Entry removed from a queue and the queue may be moved from the
- *	ready list to empty list.
+ *	ready list to empty list.  The queue's merge procedure may take
+ *	more entries off the queue.
  *----------------------------------------------------------------------
  */
 
@@ -392,6 +528,10 @@ Dev_QueueGetNext(devQueue)
      */
     returnValue = List_First(&(queuePtr->elementListHdr));
     List_Remove(returnValue);
+    if (queuePtr->mergeProc != (List_Links *(*)()) NIL) {
+	returnValue = (queuePtr->mergeProc)(returnValue,
+			&(queuePtr->elementListHdr), queuePtr->mergeData);
+    }
     if (queuePtr->queueBit != 0) {
 	if (List_IsEmpty(&(queuePtr->elementListHdr))) {
 	    List_Remove((List_Links *) queuePtr);
@@ -61,6 +61,11 @@ extern DevCtrlQueues Dev_CtrlQueuesCreate _ARGS_((Sync_Semaphore *mutexPtr,
     Boolean (*entryAvailProc)()));
 extern DevQueue Dev_QueueCreate _ARGS_((DevCtrlQueues ctrlQueue,
     unsigned int queueBit, void (*insertProc)(), ClientData clientData));
+extern void Dev_QueueSetInsertProc _ARGS_((DevQueue devQueue,
+    void (*insertProc)()));
+extern void (*Dev_QueueGetInsertProc _ARGS_((DevQueue devQueue)))();
+extern void Dev_QueueSetMergeProc _ARGS_((DevQueue devQueue,
+    List_Links *(*mergeProc)(), ClientData mergeData));
 extern Boolean Dev_QueueDestroy _ARGS_((DevQueue devQueue));
 extern void Dev_QueueInsert _ARGS_((DevQueue devQueue, List_Links *elementPtr));
 extern List_Links *Dev_QueueGetNext _ARGS_((DevQueue devQueue));
@@ -28,6 +28,110 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include <devInt.h>
 #include <fs.h>
 #include <user/fs.h>
+#include <fsioDevice.h>
+#include <proc.h>
+#include <sync.h>
+#include <list.h>
+#include <vm.h>
+#include <stdlib.h>
+#include <bstring.h>
+
+/*
+ * The device is opened with FS_DEV_DONT_COPY so user buffers reach us
+ * unchanged, and a transfer is split into pieces of at most the device's
+ * maxTransferSize that are all started at once.  The host adaptor drivers
+ * map or copy a request's buffer in whatever context starts or completes
+ * the command, so a user address can't be given to them.  A user
+ * transfer goes through a kernel buffer of its own instead, filled in
+ * the caller's context before a write and copied out in the caller's
+ * context after a read.
+ *
+ * Asynchronous requests (IOC_RAW_AIO_SUBMIT) use the same machinery but
+ * return once the pieces are started.  A process reaps only its own
+ * requests, since only then is its address space there to copy read
+ * data to.  Those it never reaps are waited for and thrown away when the
+ * process exits or migrates, and when the device is closed, so they
+ * don't count against devRawAioMaxRequests.
+ */
+
+/*
+ * RawPiece - One block device request of a transfer.
+ */
+typedef struct RawPiece {
+    DevBlockDeviceRequest request;	/* MUST BE FIRST. */
+    int			amount;		/* Bytes the piece transferred. */
+    ReturnStatus	status;		/* Status of the piece. */
+} RawPiece;
+
+/*
+ * RawIO - A transfer between a buffer and a raw block device.
+ */
+typedef struct RawIO {
+    List_Links	links;		/* On the device's ioList.  MUST BE FIRST. */
+    struct RawDev *rawPtr;	/* Device of the transfer. */
+    Proc_PID	processID;	/* Process that started the transfer. */
+    Boolean	async;		/* Reaped with IOC_RAW_AIO_REAP rather than
+				 * waited for. */
+    int		id;		/* Caller's id for an asynchronous request. */
+    int		operation;	/* FS_READ or FS_WRITE. */
+    Address	buffer;		/* Caller's buffer. */
+    int		length;		/* Bytes to transfer. */
+    Address	kernBuffer;	/* Kernel copy of a user buffer that the
+				 * device transfers to or from, else NIL. */
+    int		numPieces;	/* Number of pieces of the transfer. */
+    int		piecesDone;	/* Number of pieces finished. */
+    RawPiece	*pieces;	/* The pieces. */
+    Boolean	done;		/* TRUE once all pieces have finished. */
+} RawIO;
+
+/*
+ * RawDev - Per device state, hung off the clientData of the device's
+ * DevBlockDeviceHandle.
+ */
+typedef struct RawDev {
+    List_Links	links;		/* On rawDevList.  MUST BE FIRST. */
+    Sync_Semaphore mutex;	/* Protects the transfers of the device.
+				 * Taken at interrupt level. */
+    Sync_Condition ioDone;	/* Notified when a transfer finishes. */
+    List_Links	ioList;		/* Transfers started and not yet waited
+				 * for or reaped. */
+    int		numAio;		/* Asynchronous transfers on ioList. */
+    Fs_NotifyToken token;	/* Used to notify select waiters. */
+} RawDev;
+
+#define	RAW_DEV(handlePtr)	((RawDev *) ((handlePtr)->clientData))
+
+/*
+ * rawDevList - The open raw devices, so that an exiting process's
+ *		requests can be found.  Protected by the monitor lock.
+ */
+static List_Links	rawDevListHdr;
+static List_Links	*rawDevList = (List_Links *) NIL;
+static Sync_Lock	rawDevLock = Sync_LockInitStatic("Dev:rawDevLock");
+#define	LOCKPTR	(&rawDevLock)
+
+/*
+ * devRawAioMaxRequests - Most asynchronous requests that may be
+ *			  outstanding on a device.
+ */
+int devRawAioMaxRequests = 64;
+
+static ReturnStatus RawIOStart _ARGS_((DevBlockDeviceHandle *handlePtr,
+    int operation, Address buffer, int length, int offset,
+    Boolean userBuffer, Boolean async, int id, RawIO **ioPtrPtr));
+static void RawIODone _ARGS_((DevBlockDeviceRequest *requestPtr,
+    ReturnStatus status, int amountTransferred));
+static void RawIOWait _ARGS_((RawIO *ioPtr));
+static ReturnStatus RawIOFinish _ARGS_((RawIO *ioPtr, Boolean copyOut,
+    int *amountPtr));
+static ReturnStatus RawAioSubmit _ARGS_((DevBlockDeviceHandle *handlePtr,
+    Fs_IOCParam *ioctlPtr));
+static ReturnStatus RawAioReap _ARGS_((DevBlockDeviceHandle *handlePtr,
+    Fs_IOCParam *ioctlPtr, Fs_IOReply *replyPtr));
+static void RawAioDiscard _ARGS_((RawDev *rawPtr, Boolean allProcs,
+    Proc_PID processID));
+static void AddRawDev _ARGS_((RawDev *rawPtr));
+static void RemoveRawDev _ARGS_((RawDev *rawPtr));
 
 
 /*
@@ -36,7 +140,8 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
  * DevRawBlockDevOpen --
  *
  *	Open a Block Device as a file for reads and writes.  Modify the
- *	Fs_Device structure to point at the attached device's handle.
+ *	Fs_Device structure to point at the attached device's handle, and
+ *	set up the state used for direct and asynchronous I/O.
  *
  * Results:
  *	SUCCESS if the device is successfully attached.
@@ -55,6 +160,7 @@ DevRawBlockDevOpen(devicePtr, useFlags, token, flagsPtr)
     int		*flagsPtr;	/* OUT: Device IO flags. */
 {
     DevBlockDeviceHandle *handlePtr;
+    RawDev		*rawPtr;
 
     /*
      * See if the device was already open by someone else. NOTE: The 
@@ -64,9 +170,11 @@ DevRawBlockDevOpen(devicePtr, useFlags, token, flagsPtr)
     handlePtr =  (DevBlockDeviceHandle *) devicePtr->data;
     if (handlePtr != (DevBlockDeviceHandle *) NIL) {
 	/*
-	 * Block devices handle their own locking.
+	 * Block devices handle their own locking, and we do I/O
+	 * directly to and from user buffers.
 	 */
-	*flagsPtr |= FS_DEV_DONT_LOCK;
+	*flagsPtr |= FS_DEV_DONT_LOCK | FS_DEV_DONT_COPY;
+	RAW_DEV(handlePtr)->token = token;
 	/*
 	 * Already attached. 
 	 */
@@ -81,10 +189,18 @@ DevRawBlockDevOpen(devicePtr, useFlags, token, flagsPtr)
 	return(DEV_NO_DEVICE);
     }
     devicePtr->data = (ClientData) handlePtr;
+    rawPtr = (RawDev *) malloc(sizeof(RawDev));
+    bzero((char *) rawPtr, sizeof(RawDev));
+    Sync_SemInitDynamic(&rawPtr->mutex, "Dev:rawBlockDevMutex");
+    List_Init(&rawPtr->ioList);
+    rawPtr->token = token;
+    handlePtr->clientData = (ClientData) rawPtr;
+    AddRawDev(rawPtr);
     /*
-     * Block devices handle their own locking.
+     * Block devices handle their own locking, and we do I/O
+     * directly to and from user buffers.
      */
-    *flagsPtr |= FS_DEV_DONT_LOCK;
+    *flagsPtr |= FS_DEV_DONT_LOCK | FS_DEV_DONT_COPY;
     return(SUCCESS);
 }
 
@@ -144,17 +260,13 @@ DevRawBlockDevRead(devicePtr, readPtr, replyPtr)
     Fs_IOReply	*replyPtr;	/* Return length and signal */ 
 {
     ReturnStatus error;
-    DevBlockDeviceRequest	request;
     DevBlockDeviceHandle	*handlePtr;
-    int				amountRead;
-    int				toRead;
+    RawIO			*ioPtr;
 
     /*
-     * Extract the BlockDeviceHandle from the Fs_Device and sent a 
-     * BlockDeviceRequest READ request using the synchronous
-     * Block IO interface. If the request is too large break it into
-     * smaller pieces. Insure the request to a multiple of the min
-     * blocksize.
+     * Extract the BlockDeviceHandle from the Fs_Device and read
+     * into the caller's buffer.  Insure the request to a multiple of the
+     * min blocksize.
      */
     handlePtr = (DevBlockDeviceHandle *) (devicePtr->data);
     if ((readPtr->offset % (handlePtr->minTransferUnit)) || 
@@ -164,30 +276,15 @@ DevRawBlockDevRead(devicePtr, readPtr, replyPtr)
 		readPtr->length, readPtr->offset);
 	return DEV_INVALID_ARG;
     }
-
-    amountRead = 0;
-    error = FAILURE;
-    while (readPtr->length > 0) {
-	/*
-	 * Reinitialize everything each loop because lower-levels
-	 * might trash operation or startAddrHigh for their own reasons.
-	 */
-	request.operation = FS_READ;
-	request.startAddrHigh = 0;
-	request.startAddress = readPtr->offset + amountRead;
-	request.buffer = readPtr->buffer + amountRead;
-	toRead = (readPtr->length > handlePtr->maxTransferSize) ?
-		  handlePtr->maxTransferSize : readPtr->length;
-	request.bufferLen = toRead;
-	error = Dev_BlockDeviceIOSync(handlePtr, &request, &replyPtr->length);
-	amountRead += replyPtr->length;
-	readPtr->length -= replyPtr->length;
-	if ((error != SUCCESS) || (replyPtr->length != toRead)) {
-	    return error;
-	}
+    error = RawIOStart(handlePtr, FS_READ, readPtr->buffer, readPtr->length,
+		readPtr->offset, (readPtr->flags & FS_USER) != 0, FALSE, 0,
+		&ioPtr);
+    if (error != SUCCESS) {
+	replyPtr->length = 0;
+	return error;
     }
-    replyPtr->length = amountRead;
-    return error;
+    RawIOWait(ioPtr);
+    return RawIOFinish(ioPtr, TRUE, &replyPtr->length);
 }
 
 /*
@@ -212,14 +309,11 @@ DevRawBlockDevWrite(devicePtr, writePtr, replyPtr)
     Fs_IOReply	*replyPtr;	/* Return length and signal */
 {
     ReturnStatus 		error;	
-    DevBlockDeviceRequest	request;
     DevBlockDeviceHandle	*handlePtr;
-    int				amountWritten;
-    int				toWrite;
+    RawIO			*ioPtr;
     /*
-     * Extract the BlockDeviceHandle from the Fs_Device and sent a 
-     * BlockDeviceRequest WRITE request using the synchronous
-     * Block IO interface.
+     * Extract the BlockDeviceHandle from the Fs_Device and write
+     * from the caller's buffer.
      */
 
     handlePtr = (DevBlockDeviceHandle *) (devicePtr->data);
@@ -228,29 +322,15 @@ DevRawBlockDevWrite(devicePtr, writePtr, replyPtr)
 	replyPtr->length = 0;
 	return DEV_INVALID_ARG;
     }
-    amountWritten = 0;
-    error = SUCCESS;
-    while (writePtr->length > 0) {
-	/*
-	 * Reinitialize everything each loop because lower-levels
-	 * might trash operation or startAddrHigh for their own reasons.
-	 */
-	request.operation = FS_WRITE;
-	request.startAddrHigh = 0;
-	request.startAddress = writePtr->offset + amountWritten;
-	request.buffer = writePtr->buffer + amountWritten;
-	toWrite = (writePtr->length > handlePtr->maxTransferSize) ?
-		   handlePtr->maxTransferSize : writePtr->length;
-	request.bufferLen = toWrite;
-	error = Dev_BlockDeviceIOSync(handlePtr, &request, &replyPtr->length);
-	amountWritten += replyPtr->length;
-	writePtr->length -= replyPtr->length;
-	if ((error != SUCCESS) || (replyPtr->length != toWrite)) {
-	    return error;
-	}
+    error = RawIOStart(handlePtr, FS_WRITE, writePtr->buffer,
+		writePtr->length, writePtr->offset,
+		(writePtr->flags & FS_USER) != 0, FALSE, 0, &ioPtr);
+    if (error != SUCCESS) {
+	replyPtr->length = 0;
+	return error;
     }
-    replyPtr->length = amountWritten;
-    return(error);
+    RawIOWait(ioPtr);
+    return RawIOFinish(ioPtr, TRUE, &replyPtr->length);
 }
 
 /*
@@ -276,8 +356,68 @@ DevRawBlockDevIOControl(devicePtr, ioctlPtr, replyPtr)
     Fs_IOCParam *ioctlPtr;	/* Standard I/O Control parameter block */
     Fs_IOReply *replyPtr;	/* reply length and signal */
 {
-    return Dev_BlockDeviceIOControl((DevBlockDeviceHandle *) (devicePtr->data),
-		ioctlPtr, replyPtr);
+    DevBlockDeviceHandle	*handlePtr;
+
+    handlePtr = (DevBlockDeviceHandle *) (devicePtr->data);
+    switch (ioctlPtr->command) {
+	case IOC_RAW_AIO_SUBMIT:
+	    return RawAioSubmit(handlePtr, ioctlPtr);
+	case IOC_RAW_AIO_REAP:
+	    return RawAioReap(handlePtr, ioctlPtr, replyPtr);
+	default:
+	    return Dev_BlockDeviceIOControl(handlePtr, ioctlPtr, replyPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DevRawBlockDevSelect --
+ *
+ *	Select on a raw Block Device.  The device is readable when an
+ *	asynchronous request of the calling process has finished and can
+ *	be reaped.  It is always writable.
+ *
+ * Results:
+ *	SUCCESS
+ *
+ * Side effects:
+ *	*readPtr and *exceptPtr may be cleared.
+ *
+ *----------------------------------------------------------------------
+ */
+
+/*ARGSUSED*/
+ReturnStatus
+DevRawBlockDevSelect(devicePtr, readPtr, writePtr, exceptPtr)
+    Fs_Device	*devicePtr;	/* Device to select on. */
+    int		*readPtr;	/* Set to zero if device not readable. */
+    int		*writePtr;	/* Set to zero if device not writable. */
+    int		*exceptPtr;	/* Set to zero if no exception pending on
+				 * device. */
+{
+    RawDev	*rawPtr;
+    List_Links	*itemPtr;
+    Proc_PID	processID;
+    Boolean	readable;
+
+    rawPtr = RAW_DEV((DevBlockDeviceHandle *) (devicePtr->data));
+    processID = Proc_GetCurrentProc()->processID;
+    readable = FALSE;
+    MASTER_LOCK(&rawPtr->mutex);
+    LIST_FORALL(&rawPtr->ioList, itemPtr) {
+	if (((RawIO *) itemPtr)->async && ((RawIO *) itemPtr)->done &&
+	    (((RawIO *) itemPtr)->processID == processID)) {
+	    readable = TRUE;
+	    break;
+	}
+    }
+    MASTER_UNLOCK(&rawPtr->mutex);
+    if (!readable) {
+	*readPtr = 0;
+    }
+    *exceptPtr = 0;
+    return SUCCESS;
 }
 
 /*
@@ -292,7 +432,8 @@ DevRawBlockDevIOControl(devicePtr, ioctlPtr, replyPtr)
  *	The return status of the close operation.
  *
  * Side effects:
- *	Block device may be detached.
+ *	Block device may be detached.  Unreaped asynchronous requests
+ *	are waited for and discarded on the last close.
  *
  *----------------------------------------------------------------------
  */
@@ -306,9 +447,20 @@ DevRawBlockDevClose(devicePtr, useFlags, openCount, writerCount)
 {
     ReturnStatus 		error;	
     DevBlockDeviceHandle	*handlePtr;
+    RawDev			*rawPtr;
 
     if (openCount == 0) { 
 	handlePtr = (DevBlockDeviceHandle *) (devicePtr->data);
+	/*
+	 * Wait for any asynchronous requests that are still in progress
+	 * and throw away their results.
+	 */
+	rawPtr = RAW_DEV(handlePtr);
+	RemoveRawDev(rawPtr);
+	RawAioDiscard(rawPtr, TRUE, (Proc_PID) 0);
+	Sync_SemClear(&rawPtr->mutex);
+	free((char *) rawPtr);
+	handlePtr->clientData = (ClientData) NIL;
 	error = Dev_BlockDeviceRelease(handlePtr);
 	devicePtr->data = (ClientData) NIL;
     } else {
@@ -317,3 +469,567 @@ DevRawBlockDevClose(devicePtr, useFlags, openCount, writerCount)
     return(error);
 }
 
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RawIOStart --
+ *
+ *	Start a transfer between a buffer and a raw Block Device.  A user
+ *	buffer is replaced by a kernel buffer, into which the data to
+ *	write is copied here.  The transfer is split into pieces of at
+ *	most maxTransferSize bytes that are all started at once.  The
+ *	offset and length must already be checked.
+ *
+ * Results:
+ *	SUCCESS and the transfer in *ioPtrPtr, or an error if the transfer
+ *	couldn't be started.  An error in starting a piece is instead
+ *	returned when the transfer finishes.
+ *
+ * Side effects:
+ *	A kernel buffer may be allocated until RawIOFinish.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ReturnStatus
+RawIOStart(handlePtr, operation, buffer, length, offset, userBuffer,
+	   async, id, ioPtrPtr)
+    DevBlockDeviceHandle *handlePtr;	/* Device to transfer to or from. */
+    int		operation;	/* FS_READ or FS_WRITE. */
+    Address	buffer;		/* Caller's buffer. */
+    int		length;		/* Bytes to transfer. */
+    int		offset;		/* Byte offset on the device. */
+    Boolean	userBuffer;	/* TRUE if buffer is in user space. */
+    Boolean	async;		/* TRUE for an IOC_RAW_AIO_SUBMIT request. */
+    int		id;		/* Caller's id for an asynchronous request. */
+    RawIO	**ioPtrPtr;	/* OUT: The transfer. */
+{
+    RawDev	*rawPtr = RAW_DEV(handlePtr);
+    RawIO	*ioPtr;
+    RawPiece	*piecePtr;
+    ReturnStatus status;
+    Address	ioBuffer;
+    int		i, maxSize;
+
+    if (async) {
+	MASTER_LOCK(&rawPtr->mutex);
+	if (rawPtr->numAio >= devRawAioMaxRequests) {
+	    MASTER_UNLOCK(&rawPtr->mutex);
+	    return FS_WOULD_BLOCK;
+	}
+	rawPtr->numAio++;
+	MASTER_UNLOCK(&rawPtr->mutex);
+    }
+    ioPtr = (RawIO *) malloc(sizeof(RawIO));
+    bzero((char *) ioPtr, sizeof(RawIO));
+    ioPtr->rawPtr = rawPtr;
+    ioPtr->processID = Proc_GetCurrentProc()->processID;
+    ioPtr->async = async;
+    ioPtr->id = id;
+    ioPtr->operation = operation;
+    ioPtr->buffer = buffer;
+    ioPtr->length = length;
+    ioPtr->kernBuffer = (Address) NIL;
+    ioBuffer = buffer;
+    if (userBuffer && (length > 0)) {
+	ioPtr->kernBuffer = (Address) malloc(length);
+	if ((operation == FS_WRITE) &&
+	    (Vm_CopyIn(length, buffer, ioPtr->kernBuffer) != SUCCESS)) {
+	    free((char *) ioPtr->kernBuffer);
+	    status = SYS_ARG_NOACCESS;
+	    goto error;
+	}
+	ioBuffer = ioPtr->kernBuffer;
+    }
+    maxSize = handlePtr->maxTransferSize;
+    ioPtr->numPieces = (length + maxSize - 1) / maxSize;
+    if (ioPtr->numPieces > 0) {
+	ioPtr->pieces = (RawPiece *) malloc(ioPtr->numPieces *
+					    sizeof(RawPiece));
+    }
+    for (i = 0; i < ioPtr->numPieces; i++) {
+	piecePtr = &ioPtr->pieces[i];
+	piecePtr->request.operation = operation;
+	piecePtr->request.startAddrHigh = 0;
+	piecePtr->request.startAddress = offset + i * maxSize;
+	piecePtr->request.buffer = ioBuffer + i * maxSize;
+	piecePtr->request.bufferLen = (length - i * maxSize > maxSize) ?
+					maxSize : length - i * maxSize;
+	piecePtr->request.doneProc = RawIODone;
+	piecePtr->request.clientData = (ClientData) ioPtr;
+	piecePtr->amount = 0;
+	piecePtr->status = SUCCESS;
+    }
+    MASTER_LOCK(&rawPtr->mutex);
+    List_InitElement((List_Links *) ioPtr);
+    List_Insert((List_Links *) ioPtr, LIST_ATREAR(&rawPtr->ioList));
+    if (ioPtr->numPieces == 0) {
+	ioPtr->done = TRUE;
+	if (async) {
+	    Fsio_DevNotifyReader(rawPtr->token);
+	}
+    }
+    MASTER_UNLOCK(&rawPtr->mutex);
+    /*
+     * Once the last piece is started the transfer may finish, and an
+     * asynchronous one be reaped, at any time.  Don't touch it after.
+     */
+    for (i = 0; i < ioPtr->numPieces; i++) {
+	status = Dev_BlockDeviceIO(handlePtr, &ioPtr->pieces[i].request);
+	if (status != SUCCESS) {
+	    RawIODone(&ioPtr->pieces[i].request, status, 0);
+	}
+    }
+    *ioPtrPtr = ioPtr;
+    return SUCCESS;
+
+error:
+    free((char *) ioPtr);
+    if (async) {
+	MASTER_LOCK(&rawPtr->mutex);
+	rawPtr->numAio--;
+	MASTER_UNLOCK(&rawPtr->mutex);
+    }
+    return status;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RawIODone --
+ *
+ *	Callback for the pieces of a transfer.  May be called at interrupt
+ *	level.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	When the last piece finishes the transfer is marked done, waiters
+ *	are woken, and select waiters are notified of an asynchronous
+ *	transfer.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RawIODone(requestPtr, status, amountTransferred)
+    DevBlockDeviceRequest *requestPtr;	/* The piece that finished. */
+    ReturnStatus	status;			/* Status of the piece. */
+    int			amountTransferred;	/* Bytes transferred. */
+{
+    RawPiece	*piecePtr = (RawPiece *) requestPtr;
+    RawIO	*ioPtr = (RawIO *) requestPtr->clientData;
+    RawDev	*rawPtr = ioPtr->rawPtr;
+
+    MASTER_LOCK(&rawPtr->mutex);
+    piecePtr->status = status;
+    piecePtr->amount = amountTransferred;
+    ioPtr->piecesDone++;
+    if (ioPtr->piecesDone == ioPtr->numPieces) {
+	ioPtr->done = TRUE;
+	Sync_MasterBroadcast(&rawPtr->ioDone);
+	if (ioPtr->async) {
+	    Fsio_DevNotifyReader(rawPtr->token);
+	}
+    }
+    MASTER_UNLOCK(&rawPtr->mutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RawIOWait --
+ *
+ *	Wait for a synchronous transfer to finish.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The transfer is taken off the device's list.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RawIOWait(ioPtr)
+    RawIO	*ioPtr;		/* Transfer to wait for. */
+{
+    RawDev	*rawPtr = ioPtr->rawPtr;
+
+    MASTER_LOCK(&rawPtr->mutex);
+    while (!ioPtr->done) {
+	Sync_MasterWait(&rawPtr->ioDone, &rawPtr->mutex, FALSE);
+    }
+    List_Remove((List_Links *) ioPtr);
+    MASTER_UNLOCK(&rawPtr->mutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RawIOFinish --
+ *
+ *	Clean up after a finished transfer that is off the device's list.
+ *	The amount transferred is the data up to the first piece that
+ *	came up short.  Read data is copied out of the kernel buffer if
+ *	asked, which must then be done by the process that started the
+ *	transfer.
+ *
+ * Results:
+ *	The status of the transfer, and the amount transferred in
+ *	*amountPtr.
+ *
+ * Side effects:
+ *	The transfer and its kernel buffer are freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ReturnStatus
+RawIOFinish(ioPtr, copyOut, amountPtr)
+    RawIO	*ioPtr;		/* Finished transfer. */
+    Boolean	copyOut;	/* TRUE to copy read data to the caller. */
+    int		*amountPtr;	/* OUT: Bytes transferred. */
+{
+    ReturnStatus status;
+    int		i, amount;
+
+    status = SUCCESS;
+    amount = 0;
+    for (i = 0; i < ioPtr->numPieces; i++) {
+	amount += ioPtr->pieces[i].amount;
+	if (ioPtr->pieces[i].status != SUCCESS) {
+	    status = ioPtr->pieces[i].status;
+	    break;
+	}
+	if (ioPtr->pieces[i].amount != ioPtr->pieces[i].request.bufferLen) {
+	    break;
+	}
+    }
+    if (ioPtr->kernBuffer != (Address) NIL) {
+	if (copyOut && (ioPtr->operation == FS_READ) && (amount > 0) &&
+	    (Vm_CopyOut(amount, ioPtr->kernBuffer, ioPtr->buffer) !=
+		SUCCESS)) {
+	    status = SYS_ARG_NOACCESS;
+	}
+	free((char *) ioPtr->kernBuffer);
+    }
+    if (ioPtr->numPieces > 0) {
+	free((char *) ioPtr->pieces);
+    }
+    free((char *) ioPtr);
+    *amountPtr = amount;
+    return status;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RawAioSubmit --
+ *
+ *	Start the asynchronous request in the input buffer of an
+ *	IOC_RAW_AIO_SUBMIT.
+ *
+ * Results:
+ *	SUCCESS if the request was started.  FS_WOULD_BLOCK if the device
+ *	has too many requests outstanding.
+ *
+ * Side effects:
+ *	The request is started.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ReturnStatus
+RawAioSubmit(handlePtr, ioctlPtr)
+    DevBlockDeviceHandle *handlePtr;	/* Device of the request. */
+    Fs_IOCParam		*ioctlPtr;	/* Standard I/O Control block. */
+{
+    DevRawAioRequest	request;
+    RawIO		*ioPtr;
+
+    /*
+     * The buffer must be in the address space of the current process,
+     * so remote clients can't use asynchronous I/O.
+     */
+    if (ioctlPtr->procID != Proc_GetCurrentProc()->processID) {
+	return GEN_NOT_IMPLEMENTED;
+    }
+    if (ioctlPtr->inBufSize < sizeof(DevRawAioRequest)) {
+	return GEN_INVALID_ARG;
+    }
+    bcopy(ioctlPtr->inBuffer, (char *) &request, sizeof(request));
+    if (((request.operation != FS_READ) && (request.operation != FS_WRITE)) ||
+	(request.length < 0) || (request.offset < 0) ||
+	(request.offset % handlePtr->minTransferUnit) ||
+	(request.length % handlePtr->minTransferUnit)) {
+	return DEV_INVALID_ARG;
+    }
+    return RawIOStart(handlePtr, request.operation, request.buffer,
+		request.length, request.offset, TRUE, TRUE, request.id,
+		&ioPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RawAioReap --
+ *
+ *	Return the results of the caller's finished asynchronous requests
+ *	for an IOC_RAW_AIO_REAP.  Doesn't wait; use select to wait for a
+ *	request to finish.
+ *
+ * Results:
+ *	SUCCESS, with a DevRawAioResult for each reaped request in the
+ *	output buffer.
+ *
+ * Side effects:
+ *	The reaped requests are cleaned up.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ReturnStatus
+RawAioReap(handlePtr, ioctlPtr, replyPtr)
+    DevBlockDeviceHandle *handlePtr;	/* Device of the requests. */
+    Fs_IOCParam		*ioctlPtr;	/* Standard I/O Control block. */
+    Fs_IOReply		*replyPtr;	/* Reply length. */
+{
+    RawDev		*rawPtr = RAW_DEV(handlePtr);
+    DevRawAioResult	*resultPtr;
+    List_Links		doneList;
+    List_Links		*itemPtr, *nextPtr;
+    RawIO		*ioPtr;
+    Proc_PID		processID;
+    int			maxResults, numResults;
+
+    processID = Proc_GetCurrentProc()->processID;
+    if (ioctlPtr->procID != processID) {
+	return GEN_NOT_IMPLEMENTED;
+    }
+    maxResults = ioctlPtr->outBufSize / sizeof(DevRawAioResult);
+    List_Init(&doneList);
+    numResults = 0;
+    MASTER_LOCK(&rawPtr->mutex);
+    itemPtr = List_First(&rawPtr->ioList);
+    while (!List_IsAtEnd(&rawPtr->ioList, itemPtr) &&
+	   (numResults < maxResults)) {
+	nextPtr = List_Next(itemPtr);
+	ioPtr = (RawIO *) itemPtr;
+	if (ioPtr->async && ioPtr->done && (ioPtr->processID == processID)) {
+	    List_Move(itemPtr, LIST_ATREAR(&doneList));
+	    rawPtr->numAio--;
+	    numResults++;
+	}
+	itemPtr = nextPtr;
+    }
+    MASTER_UNLOCK(&rawPtr->mutex);
+    resultPtr = (DevRawAioResult *) ioctlPtr->outBuffer;
+    while (!List_IsEmpty(&doneList)) {
+	ioPtr = (RawIO *) List_First(&doneList);
+	List_Remove((List_Links *) ioPtr);
+	resultPtr->id = ioPtr->id;
+	resultPtr->status = RawIOFinish(ioPtr, TRUE, &resultPtr->amount);
+	resultPtr++;
+    }
+    replyPtr->length = numResults * sizeof(DevRawAioResult);
+    return SUCCESS;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RawAioDiscard --
+ *
+ *	Wait for the asynchronous requests of a device that belong to a
+ *	process, or to any process, and throw away their results.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The requests are cleaned up and their kernel buffers freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RawAioDiscard(rawPtr, allProcs, processID)
+    RawDev	*rawPtr;	/* Device of the requests. */
+    Boolean	allProcs;	/* TRUE to discard every request. */
+    Proc_PID	processID;	/* Else the process whose requests go. */
+{
+    List_Links	doneList;
+    List_Links	*itemPtr, *nextPtr;
+    RawIO	*ioPtr;
+    Boolean	waited;
+    int		amount;
+
+    List_Init(&doneList);
+    MASTER_LOCK(&rawPtr->mutex);
+    do {
+	waited = FALSE;
+	itemPtr = List_First(&rawPtr->ioList);
+	while (!List_IsAtEnd(&rawPtr->ioList, itemPtr)) {
+	    nextPtr = List_Next(itemPtr);
+	    ioPtr = (RawIO *) itemPtr;
+	    if (ioPtr->async &&
+		(allProcs || (ioPtr->processID == processID))) {
+		if (!ioPtr->done) {
+		    Sync_MasterWait(&rawPtr->ioDone, &rawPtr->mutex, FALSE);
+		    waited = TRUE;
+		    break;
+		}
+		List_Move(itemPtr, LIST_ATREAR(&doneList));
+		rawPtr->numAio--;
+	    }
+	    itemPtr = nextPtr;
+	}
+    } while (waited);
+    MASTER_UNLOCK(&rawPtr->mutex);
+    while (!List_IsEmpty(&doneList)) {
+	ioPtr = (RawIO *) List_First(&doneList);
+	List_Remove((List_Links *) ioPtr);
+	(void) RawIOFinish(ioPtr, FALSE, &amount);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DevRawBlockDevProcExit --
+ *
+ *	Called when a process exits.  Its unreaped asynchronous requests
+ *	on any raw device are waited for and thrown away, so that they
+ *	stop counting against devRawAioMaxRequests.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The process's requests are cleaned up.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ENTRY void
+DevRawBlockDevProcExit(processID)
+    Proc_PID	processID;	/* The exiting process. */
+{
+    List_Links	*itemPtr;
+
+    LOCK_MONITOR;
+    if (rawDevList != (List_Links *) NIL) {
+	LIST_FORALL(rawDevList, itemPtr) {
+	    RawAioDiscard((RawDev *) itemPtr, FALSE, processID);
+	}
+    }
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DevRawBlockDevProcBusy --
+ *
+ *	See if a process has asynchronous requests on any raw device that
+ *	it hasn't reaped.  A process can't migrate while it does, since
+ *	the requests and their results stay on this host.
+ *
+ * Results:
+ *	TRUE if the process has unreaped requests.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ENTRY Boolean
+DevRawBlockDevProcBusy(processID)
+    Proc_PID	processID;	/* The process to check. */
+{
+    List_Links	*itemPtr, *ioItemPtr;
+    RawDev	*rawPtr;
+    Boolean	busy = FALSE;
+
+    LOCK_MONITOR;
+    if (rawDevList != (List_Links *) NIL) {
+	LIST_FORALL(rawDevList, itemPtr) {
+	    rawPtr = (RawDev *) itemPtr;
+	    MASTER_LOCK(&rawPtr->mutex);
+	    LIST_FORALL(&rawPtr->ioList, ioItemPtr) {
+		if (((RawIO *) ioItemPtr)->async &&
+		    (((RawIO *) ioItemPtr)->processID == processID)) {
+		    busy = TRUE;
+		    break;
+		}
+	    }
+	    MASTER_UNLOCK(&rawPtr->mutex);
+	    if (busy) {
+		break;
+	    }
+	}
+    }
+    UNLOCK_MONITOR;
+    return busy;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddRawDev --
+ *
+ *	Put a newly attached device on the list of open raw devices.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The list is initialized on first use.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY void
+AddRawDev(rawPtr)
+    RawDev	*rawPtr;	/* Device being opened. */
+{
+    LOCK_MONITOR;
+    if (rawDevList == (List_Links *) NIL) {
+	rawDevList = &rawDevListHdr;
+	List_Init(rawDevList);
+    }
+    List_InitElement((List_Links *) rawPtr);
+    List_Insert((List_Links *) rawPtr, LIST_ATREAR(rawDevList));
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RemoveRawDev --
+ *
+ *	Take a device that is being detached off the list of open raw
+ *	devices.  This waits for a process exit that is looking at it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY void
+RemoveRawDev(rawPtr)
+    RawDev	*rawPtr;	/* Device being closed. */
+{
+    LOCK_MONITOR;
+    List_Remove((List_Links *) rawPtr);
+    UNLOCK_MONITOR;
+}
@@ -66,11 +66,54 @@ typedef struct ScsiDisk {
 typedef struct ScsiDiskCmd {
     ScsiDisk	*diskPtr;	/* Target disk of command. */
     ScsiCmd	scsiCmd;	/* SCSI command to send to disk. */
+    unsigned int firstSector;	/* First sector on the disk of the transfer. */
+    unsigned int numSectors;	/* Length of the transfer in sectors. */
+    Boolean	noMerge;	/* TRUE -> send this command by itself. */
+    Timer_Ticks	issueTime;	/* When the request was given to us. */
+    Timer_Ticks	startTime;	/* When the HBA took the command. */
 } ScsiDiskCmd;
 
+/*
+ * Requests for adjacent sectors that are waiting in a disk's device
+ * queue are merged into one command when the HBA takes the first of
+ * them (see DiskMergeProc).  A disk has one merged command outstanding
+ * at a time.  The state for it hangs off the clientData of the
+ * ScsiDevice, and is shared by all the partitions of the disk.
+ */
+#define	DISK_MAX_MERGE		16		/* Most requests in a merge. */
+#define	DISK_MERGE_MAX_BYTES	(64 * 1024)	/* Largest merged transfer. */
+
+typedef struct ScsiDiskMerge {
+    ScsiDevice	*devPtr;		/* Device the commands are for. */
+    ScsiCmd	scsiCmd;		/* The merged command. */
+    ScsiCmd	*cmdPtrs[DISK_MAX_MERGE]; /* Commands carried by scsiCmd,
+					 * in disk order. */
+    int		numCmds;		/* Number of cmdPtrs in use. */
+    Boolean	staged;			/* TRUE -> scsiCmd uses buffer below
+					 * because the requests' buffers
+					 * aren't contiguous in memory. */
+    char	*buffer;		/* Staging buffer. */
+    int		bufferSize;		/* Size of buffer in bytes. */
+    Boolean	busy;			/* TRUE -> scsiCmd is outstanding. */
+} ScsiDiskMerge;
+
+/*
+ * Largest transfer that requests are merged into.  Zero turns merging
+ * off.  The HBA's maxTransferSize also limits merged commands.
+ */
+int devScsiDiskMergeMaxBytes = DISK_MERGE_MAX_BYTES;
+
+#define	DiskCmd(scsiCmdPtr) ((ScsiDiskCmd *) \
+	(((DevBlockDeviceRequest *) ((scsiCmdPtr)->clientData))->ctrlData))
+
 
 #define	SCSI_DISK_SECTOR_SIZE	DEV_BYTES_PER_SECTOR
 
+/*
+ * Queue insert procedure for newly attached disks (see devScsiSched.c).
+ */
+void (*devScsiDiskInsertProc)() = DevScsiDeadlineInsert;
+
 #define	RequestDone(requestPtr,status,byteCount) \
 	((requestPtr)->doneProc)((requestPtr),(status),(byteCount))
 
@@ -82,6 +125,15 @@ static int DiskDoneProc _ARGS_((struct ScsiCmd *scsiCmdPtr,
 			    ReturnStatus status, int statusByte, 
 			    int byteCount, int senseLength, 
 			    Address senseDataPtr));
+static int MergeDoneProc _ARGS_((struct ScsiCmd *scsiCmdPtr, 
+			    ReturnStatus status, int statusByte, 
+			    int byteCount, int senseLength, 
+			    Address senseDataPtr));
+static List_Links *DiskMergeProc _ARGS_((List_Links *elementPtr,
+			    List_Links *listHdrPtr, ClientData mergeData));
+static ReturnStatus FillInRWCmd _ARGS_((ScsiDevice *devPtr,
+			    Boolean write, unsigned int firstSector,
+			    unsigned int lengthInSectors, ScsiCmd *scsiCmdPtr));
 
 
 /*
@@ -398,12 +450,16 @@ DiskDoneProc(scsiCmdPtr, status, statusByte, byteCount, senseLength,
     Address	senseDataPtr;	/* Sense data. */
 {
     DevBlockDeviceRequest *requestPtr;
+    ScsiDiskCmd	*diskCmdPtr;
     ScsiDisk	*diskPtr;
 
     requestPtr = (DevBlockDeviceRequest *) (scsiCmdPtr->clientData);
-    diskPtr = ((ScsiDiskCmd *) (requestPtr->ctrlData))->diskPtr;
+    diskCmdPtr = (ScsiDiskCmd *) (requestPtr->ctrlData);
+    diskPtr = diskCmdPtr->diskPtr;
 
     MASTER_LOCK(&(diskPtr->diskStatsPtr->mutex));
+    DevDiskIODone(diskPtr->diskStatsPtr, requestPtr->operation, byteCount,
+		&(diskCmdPtr->issueTime), &(diskCmdPtr->startTime));
     diskPtr->diskStatsPtr->busy--;
     if (requestPtr->operation == FS_READ) {
 	diskPtr->diskStatsPtr->diskStats.diskReads += 
@@ -471,38 +527,34 @@ DiskDoneProc(scsiCmdPtr, status, statusByte, byteCount, senseLength,
 /*
  *----------------------------------------------------------------------
  *
- * SendCmdToDevice --
+ * FillInRWCmd --
  *
- *	Translate a Block Device request into and SCSI command and send it
- *	to the disk device.
+ *	Fill in the command block of a SCSI READ or WRITE command,
+ *	using the extended form if the sector numbers need it.
  *
  * Results:
- *	SUCCESS is the command is sent otherwise a Sprite Error code.
+ *	SUCCESS if the command block was filled in, FAILURE otherwise.
  *
  * Side effects:
- *	Disk may be read or written.
+ *	*scsiCmdPtr is zeroed and its command block set.
  *
  *----------------------------------------------------------------------
  */
 static ReturnStatus
-SendCmdToDevice(diskPtr, requestPtr, firstSector, lengthInSectors)
-    ScsiDisk	*diskPtr;
-    DevBlockDeviceRequest *requestPtr;
-    unsigned int	firstSector;
-    unsigned int	lengthInSectors;
+FillInRWCmd(devPtr, write, firstSector, lengthInSectors, scsiCmdPtr)
+    ScsiDevice		*devPtr;	/* Device for the command. */
+    Boolean		write;		/* TRUE -> WRITE, FALSE -> READ. */
+    unsigned int	firstSector;	/* First sector to transfer. */
+    unsigned int	lengthInSectors; /* Number of sectors to transfer. */
+    ScsiCmd		*scsiCmdPtr;	/* Command to fill in. */
 {
     int		cmd;
-    ScsiDiskCmd	 *diskCmdPtr = (ScsiDiskCmd *) (requestPtr->ctrlData);
     ReturnStatus status;
 
-    if (sizeof(ScsiDiskCmd) > sizeof((requestPtr->ctrlData))) {
-	panic("ScsiDISK: command block bigger than controller data\n");
-	return FAILURE;
-    }
     if (firstSector <= 0x1fffff) {
-	cmd = (requestPtr->operation == FS_READ) ? SCSI_READ : SCSI_WRITE;
-	status = DevScsiGroup0Cmd(diskPtr->devPtr,cmd, firstSector, 
-		    lengthInSectors, &(diskCmdPtr->scsiCmd));
+	cmd = write ? SCSI_WRITE : SCSI_READ;
+	status = DevScsiGroup0Cmd(devPtr, cmd, firstSector, 
+		    lengthInSectors, scsiCmdPtr);
 	if (status != SUCCESS) {
 	    return FAILURE;
 	}
@@ -518,12 +570,11 @@ SendCmdToDevice(diskPtr, requestPtr, firstSector, lengthInSectors)
 		lengthInSectors, 0xffff);
 	    return FAILURE;
 	}
-	bzero((char *) &(diskCmdPtr->scsiCmd), sizeof(ScsiCmd));
-	diskCmdPtr->scsiCmd.commandBlockLen = sizeof(ScsiReadExtCmd);
-	cmdPtr = (ScsiReadExtCmd *) (diskCmdPtr->scsiCmd.commandBlock);
-	cmdPtr->command = (requestPtr->operation == FS_READ) ? 
-	    SCSI_READ_EXT : SCSI_WRITE_EXT;
-	cmdPtr->unitNumber = diskPtr->devPtr->LUN;
+	bzero((char *) scsiCmdPtr, sizeof(ScsiCmd));
+	scsiCmdPtr->commandBlockLen = sizeof(ScsiReadExtCmd);
+	cmdPtr = (ScsiReadExtCmd *) (scsiCmdPtr->commandBlock);
+	cmdPtr->command = write ? SCSI_WRITE_EXT : SCSI_READ_EXT;
+	cmdPtr->unitNumber = devPtr->LUN;
 	cmdPtr->highAddr = ((firstSector >> 24) & 0xff);
 	cmdPtr->highMidAddr = ((firstSector >> 16) & 0xff);
 	cmdPtr->lowMidAddr = ((firstSector >> 8) & 0xff);
@@ -531,6 +582,44 @@ SendCmdToDevice(diskPtr, requestPtr, firstSector, lengthInSectors)
 	cmdPtr->highCount = ((lengthInSectors >> 8) & 0xff);
 	cmdPtr->lowCount = ((lengthInSectors) & 0xff);
     }
+    return SUCCESS;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SendCmdToDevice --
+ *
+ *	Translate a Block Device request into and SCSI command and send it
+ *	to the disk device.
+ *
+ * Results:
+ *	SUCCESS is the command is sent otherwise a Sprite Error code.
+ *
+ * Side effects:
+ *	Disk may be read or written.
+ *
+ *----------------------------------------------------------------------
+ */
+static ReturnStatus
+SendCmdToDevice(diskPtr, requestPtr, firstSector, lengthInSectors)
+    ScsiDisk	*diskPtr;
+    DevBlockDeviceRequest *requestPtr;
+    unsigned int	firstSector;
+    unsigned int	lengthInSectors;
+{
+    ScsiDiskCmd	 *diskCmdPtr = (ScsiDiskCmd *) (requestPtr->ctrlData);
+    ReturnStatus status;
+
+    if (sizeof(ScsiDiskCmd) > sizeof((requestPtr->ctrlData))) {
+	panic("ScsiDISK: command block bigger than controller data\n");
+	return FAILURE;
+    }
+    status = FillInRWCmd(diskPtr->devPtr, requestPtr->operation == FS_WRITE,
+		firstSector, lengthInSectors, &(diskCmdPtr->scsiCmd));
+    if (status != SUCCESS) {
+	return FAILURE;
+    }
     diskCmdPtr->scsiCmd.buffer = requestPtr->buffer;
     diskCmdPtr->scsiCmd.bufferLen = lengthInSectors * SCSI_DISK_SECTOR_SIZE;
     diskCmdPtr->scsiCmd.dataToDevice = (requestPtr->operation == FS_WRITE);
@@ -538,6 +627,15 @@ SendCmdToDevice(diskPtr, requestPtr, firstSector, lengthInSectors)
     diskCmdPtr->scsiCmd.clientData = (ClientData) requestPtr;
     diskCmdPtr->scsiCmd.senseLen = sizeof(diskCmdPtr->scsiCmd.senseBuffer);
     diskCmdPtr->diskPtr = diskPtr;
+    diskCmdPtr->firstSector = firstSector;
+    diskCmdPtr->numSectors = lengthInSectors;
+    diskCmdPtr->noMerge = FALSE;
+    /*
+     * The start time is set again if the command has to wait in the
+     * device queue (see DiskMergeProc).
+     */
+    Timer_GetCurrentTicks(&(diskCmdPtr->issueTime));
+    diskCmdPtr->startTime = diskCmdPtr->issueTime;
 
     MASTER_LOCK(&(diskPtr->diskStatsPtr->mutex));
     diskPtr->diskStatsPtr->busy++;
@@ -548,6 +646,197 @@ SendCmdToDevice(diskPtr, requestPtr, firstSector, lengthInSectors)
     return SUCCESS;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * DiskMergeProc --
+ *
+ *	Device queue merge procedure for SCSI disks.  Called by
+ *	Dev_QueueGetNext when the HBA takes a command off the disk's
+ *	queue.  Read or write requests that follow the command in the
+ *	queue and continue where it leaves off on the disk are carried
+ *	along with it in a single merged command.  The time the commands
+ *	were taken is recorded for the disk's statistics.
+ *
+ *	NOTE: This routine is called with the HBA's lock held, possibly
+ *	at interrupt time.
+ *
+ * Results:
+ *	The merged command, or elementPtr if nothing could be merged.
+ *
+ * Side effects:
+ *	Merged requests are removed from the queue.  Write data of
+ *	requests whose buffers aren't contiguous is copied into the
+ *	staging buffer.
+ *
+ *----------------------------------------------------------------------
+ */
+static List_Links *
+DiskMergeProc(elementPtr, listHdrPtr, mergeData)
+    List_Links	*elementPtr;	/* Command being taken from the queue. */
+    List_Links	*listHdrPtr;	/* Commands left in the queue. */
+    ClientData	mergeData;	/* ScsiDiskMerge of the disk. */
+{
+    register ScsiDiskMerge *mergePtr = (ScsiDiskMerge *) mergeData;
+    register ScsiCmd	*firstPtr = (ScsiCmd *) elementPtr;
+    register ScsiCmd	*nextPtr;
+    ScsiDiskCmd		*diskCmdPtr;
+    DevDiskStats	*statsPtr;
+    List_Links		*itemPtr;
+    unsigned int	nextSector;
+    int			maxBytes, numBytes, offset, i;
+    ReturnStatus	status;
+
+    if (firstPtr->doneProc != DiskDoneProc) {
+	return elementPtr;
+    }
+    diskCmdPtr = DiskCmd(firstPtr);
+    Timer_GetCurrentTicks(&(diskCmdPtr->startTime));
+    if (mergePtr->busy || diskCmdPtr->noMerge) {
+	return elementPtr;
+    }
+    maxBytes = devScsiDiskMergeMaxBytes;
+    if (maxBytes > mergePtr->bufferSize) {
+	maxBytes = mergePtr->bufferSize;
+    }
+    if (maxBytes > mergePtr->devPtr->maxTransferSize) {
+	maxBytes = mergePtr->devPtr->maxTransferSize;
+    }
+    /*
+     * Collect the requests behind this one that are in the same
+     * direction and start where the previous one ends.  The queue
+     * insert procedures keep such requests next to each other.
+     */
+    mergePtr->cmdPtrs[0] = firstPtr;
+    mergePtr->numCmds = 1;
+    mergePtr->staged = FALSE;
+    numBytes = firstPtr->bufferLen;
+    nextSector = diskCmdPtr->firstSector + diskCmdPtr->numSectors;
+    itemPtr = List_First(listHdrPtr);
+    while (!List_IsAtEnd(listHdrPtr, itemPtr) &&
+	   (mergePtr->numCmds < DISK_MAX_MERGE)) {
+	nextPtr = (ScsiCmd *) itemPtr;
+	if ((nextPtr->doneProc != DiskDoneProc) ||
+	    DiskCmd(nextPtr)->noMerge ||
+	    (nextPtr->dataToDevice != firstPtr->dataToDevice) ||
+	    (DiskCmd(nextPtr)->firstSector != nextSector) ||
+	    (numBytes + nextPtr->bufferLen > maxBytes)) {
+	    break;
+	}
+	if (nextPtr->buffer != firstPtr->buffer + numBytes) {
+	    mergePtr->staged = TRUE;
+	}
+	mergePtr->cmdPtrs[mergePtr->numCmds++] = nextPtr;
+	numBytes += nextPtr->bufferLen;
+	nextSector += DiskCmd(nextPtr)->numSectors;
+	itemPtr = List_Next(itemPtr);
+    }
+    if (mergePtr->numCmds == 1) {
+	return elementPtr;
+    }
+    status = FillInRWCmd(mergePtr->devPtr, firstPtr->dataToDevice,
+		diskCmdPtr->firstSector, 
+		(unsigned) (numBytes / SCSI_DISK_SECTOR_SIZE),
+		&(mergePtr->scsiCmd));
+    if (status != SUCCESS) {
+	return elementPtr;
+    }
+    offset = 0;
+    for (i = 0; i < mergePtr->numCmds; i++) {
+	nextPtr = mergePtr->cmdPtrs[i];
+	if (i > 0) {
+	    List_Remove((List_Links *) nextPtr);
+	    DiskCmd(nextPtr)->startTime = diskCmdPtr->startTime;
+	}
+	if (mergePtr->staged && firstPtr->dataToDevice) {
+	    bcopy(nextPtr->buffer, mergePtr->buffer + offset,
+		    nextPtr->bufferLen);
+	}
+	offset += nextPtr->bufferLen;
+    }
+    mergePtr->scsiCmd.buffer = mergePtr->staged ? mergePtr->buffer :
+						  firstPtr->buffer;
+    mergePtr->scsiCmd.bufferLen = numBytes;
+    mergePtr->scsiCmd.dataToDevice = firstPtr->dataToDevice;
+    mergePtr->scsiCmd.doneProc = MergeDoneProc;
+    mergePtr->scsiCmd.clientData = (ClientData) mergePtr;
+    mergePtr->scsiCmd.senseLen = sizeof(mergePtr->scsiCmd.senseBuffer);
+    mergePtr->busy = TRUE;
+
+    statsPtr = diskCmdPtr->diskPtr->diskStatsPtr;
+    MASTER_LOCK(&(statsPtr->mutex));
+    statsPtr->mergeStats.numMerges++;
+    statsPtr->mergeStats.numMergedReqs += mergePtr->numCmds;
+    MASTER_UNLOCK(&(statsPtr->mutex));
+
+    return (List_Links *) &(mergePtr->scsiCmd);
+}
+\f
+/*
+ *----------------------------------------------------------------------
+ *
+ * MergeDoneProc --
+ *
+ *	Call back routine for a merged command.  Completes each of the
+ *	requests the command carried.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Read data is copied out of the staging buffer.  If the merged
+ *	command failed the requests are sent again one at a time so each
+ *	gets the usual error handling and retries.
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static int
+MergeDoneProc(scsiCmdPtr, status, statusByte, byteCount, senseLength, 
+	     senseDataPtr)
+    ScsiCmd	*scsiCmdPtr;	/* Merged command that finished. */
+    ReturnStatus  status;	/* Error of request. */
+    unsigned char statusByte;	/* SCSI status byte of request. */
+    int		byteCount;	/* Number of bytes transferred. */
+    int		senseLength;	/* Length of sense data returned. */
+    Address	senseDataPtr;	/* Sense data. */
+{
+    ScsiDiskMerge	*mergePtr = (ScsiDiskMerge *) (scsiCmdPtr->clientData);
+    ScsiCmd		*cmdPtrs[DISK_MAX_MERGE];
+    int			numCmds, offset, i;
+
+    /*
+     * Copy out what we need before letting go of the merge state, so
+     * the next merge can start while the requests are completed.
+     */
+    numCmds = mergePtr->numCmds;
+    bcopy((char *) mergePtr->cmdPtrs, (char *) cmdPtrs,
+	    numCmds * sizeof(ScsiCmd *));
+    if ((status == SUCCESS) && (statusByte == 0) &&
+	(byteCount == scsiCmdPtr->bufferLen)) {
+	if (mergePtr->staged && !scsiCmdPtr->dataToDevice) {
+	    offset = 0;
+	    for (i = 0; i < numCmds; i++) {
+		bcopy(mergePtr->buffer + offset, cmdPtrs[i]->buffer,
+			cmdPtrs[i]->bufferLen);
+		offset += cmdPtrs[i]->bufferLen;
+	    }
+	}
+	mergePtr->busy = FALSE;
+	for (i = 0; i < numCmds; i++) {
+	    (void) DiskDoneProc(cmdPtrs[i], SUCCESS, 0, cmdPtrs[i]->bufferLen,
+			0, cmdPtrs[i]->senseBuffer);
+	}
+	return 0;
+    }
+    mergePtr->busy = FALSE;
+    for (i = 0; i < numCmds; i++) {
+	DiskCmd(cmdPtrs[i])->noMerge = TRUE;
+	DevScsiSendCmd(mergePtr->devPtr, cmdPtrs[i]);
+    }
+    return 0;
+}
+\f
 /*
  *----------------------------------------------------------------------
  *
@@ -896,8 +1185,22 @@ ReleaseProc(handlePtr)
 {
     ReturnStatus status;	
     ScsiDisk	*diskPtr = (ScsiDisk *) handlePtr;
+    ScsiDevice	*devPtr = diskPtr->devPtr;
+    ScsiDiskMerge *mergePtr = (ScsiDiskMerge *) devPtr->clientData;
 
-    status = DevScsiReleaseDevice(diskPtr->devPtr);
+    /*
+     * The merge state goes away with the last reference to the device.
+     */
+    if ((devPtr->referenceCount == 1) &&
+	(mergePtr != (ScsiDiskMerge *) 0) &&
+	(mergePtr != (ScsiDiskMerge *) NIL)) {
+	Dev_QueueSetMergeProc(devPtr->devQueue, (List_Links *(*)()) NIL,
+		(ClientData) NIL);
+	devPtr->clientData = (ClientData) NIL;
+	free(mergePtr->buffer);
+	free((char *) mergePtr);
+    }
+    status = DevScsiReleaseDevice(devPtr);
     DevDiskUnregister(diskPtr->diskStatsPtr);
     free((char *) diskPtr);
 
@@ -994,10 +1297,11 @@ DevScsiDiskAttach(devicePtr)
     ScsiDisk	*diskPtr;
 
     /*
-     * Ask the HBA to set up the path to the device. For the time being
-     * we will not sort the disk requests.
+     * Ask the HBA to set up the path to the device.  Disk requests are
+     * sorted by devScsiDiskInsertProc; IOC_SCSI_SET_SCHED changes it
+     * for a particular disk.
      */
-    devPtr = DevScsiAttachDevice(devicePtr, DEV_QUEUE_FIFO_INSERT);
+    devPtr = DevScsiAttachDevice(devicePtr, devScsiDiskInsertProc);
     if (devPtr == (ScsiDevice *) NIL) {
 	return (DevBlockDeviceHandle *) NIL;
     }
@@ -1022,6 +1326,26 @@ DevScsiDiskAttach(devicePtr)
     if (diskPtr == (ScsiDisk *) NIL) {
 	return (DevBlockDeviceHandle *) NIL;
     }
+    /*
+     * Start merging adjacent requests the first time the disk is
+     * attached.  Later attaches of other partitions share the state.
+     */
+    if ((devPtr->clientData == (ClientData) 0) ||
+	(devPtr->clientData == (ClientData) NIL)) {
+	ScsiDiskMerge	*mergePtr;
+
+	mergePtr = (ScsiDiskMerge *) malloc(sizeof(ScsiDiskMerge));
+	bzero((char *) mergePtr, sizeof(ScsiDiskMerge));
+	mergePtr->devPtr = devPtr;
+	mergePtr->bufferSize = DISK_MERGE_MAX_BYTES;
+	if (mergePtr->bufferSize > devPtr->maxTransferSize) {
+	    mergePtr->bufferSize = devPtr->maxTransferSize;
+	}
+	mergePtr->buffer = malloc(mergePtr->bufferSize);
+	devPtr->clientData = (ClientData) mergePtr;
+	Dev_QueueSetMergeProc(devPtr->devQueue, DiskMergeProc,
+		(ClientData) mergePtr);
+    }
     /*
      * Register this disk with the Disk stat routines.
      */
@@ -0,0 +1,669 @@
+/*
+ * devSCSISim.c --
+ *
+ *	A simulated SCSI HBA with memory based disks attached to it.  The
+ *	HBA supports tagged command queuing: up to tagDepth commands may be
+ *	outstanding on each disk, and each disk works on them in its own
+ *	order the way a real drive with a command queue does.  By default
+ *	a disk services the outstanding command closest to its head
+ *	position next (shortest seek first), so commands finish out of
+ *	order and are matched back up to their requests by tag.
+ *
+ *	The simulated disks are useful for exercising the queue insert,
+ *	merge and tagged queuing code without real hardware.  Service
+ *	times are modeled with a fixed transfer time plus a seek time
+ *	proportional to the distance the head moves.
+ *
+ *	Each HBA number has its own controller, created the first time
+ *	a device on it is attached.  Targets 0 through
+ *	devScsiSimNumTargets - 1 hold a disk at LUN 0, up to
+ *	SIM_MAX_TARGETS disks.
+ *
+ * Copyright 1990 Regents of the University of California
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ */
+
+#ifndef lint
+static char rcsid[] = "$Header$ SPRITE (Berkeley)";
+#endif /* not lint */
+
+#include <sprite.h>
+#include <dev.h>
+#include <devInt.h>
+#include <sys/scsi.h>
+#include <scsiHBA.h>
+#include <scsiDevice.h>
+#include <scsiSim.h>
+#include <timer.h>
+#include <sync.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <bstring.h>
+
+/*
+ * Tunables.  They take effect for disks attached after they are changed.
+ *
+ * devScsiSimNumTargets -	Number of disks on each simulated HBA, at
+ *				most SIM_MAX_TARGETS.
+ * devScsiSimDiskKB -		Size of each disk in kilobytes.
+ * devScsiSimMaxTags -		Most commands a disk can queue, at most
+ *				DEV_SCSI_MAX_TAGS.
+ * devScsiSimTransferMs -	Time to transfer the data of a command.
+ * devScsiSimSeekMs -		Time to seek across the whole disk.
+ * devScsiSimReorder -		If zero, disks service commands in the
+ *				order they arrive.
+ */
+int devScsiSimNumTargets = 2;
+int devScsiSimDiskKB = 2048;
+int devScsiSimMaxTags = 8;
+int devScsiSimTransferMs = 1;
+int devScsiSimSeekMs = 10;
+int devScsiSimReorder = 1;
+
+int devScsiSimDebug = 0;
+
+/*
+ * SIM_SENSE_LEN - Length of the extended sense data returned by the
+ *		   simulated disks.
+ * SIM_INQUIRY_LEN - Length of the inquiry data returned by the
+ *		     simulated disks.
+ */
+#define	SIM_SENSE_LEN	18
+#define	SIM_INQUIRY_LEN	36
+
+/*
+ * Sense keys and additional sense codes used by the simulated disks.
+ */
+#define	SIM_KEY_NO_SENSE	0x0
+#define	SIM_KEY_ILLEGAL		0x5
+#define	SIM_ASC_BAD_OPCODE	0x20
+#define	SIM_ASC_BAD_ADDRESS	0x21
+
+/*
+ * SIM_MAX_TARGETS - Most disks on a simulated HBA.
+ */
+#define	SIM_MAX_TARGETS	8
+
+/*
+ * Controller - One exists for each simulated HBA in use.
+ */
+typedef struct Controller {
+    char	*name;		/* String for error messages. */
+    Sync_Semaphore mutex;	/* Lock protecting the controller and its
+				 * devices.  Shared with the device queues. */
+    DevCtrlQueues devQueues;	/* Device queues for the disks. */
+    struct Device *devicePtr[SIM_MAX_TARGETS];
+				/* Disks indexed by targetID. NIL if not
+				 * attached yet. */
+} Controller;
+
+/*
+ * SIM_MAX_CTRLS - Most simulated HBAs.
+ */
+#define	SIM_MAX_CTRLS	4
+static Controller *Controllers[SIM_MAX_CTRLS];
+
+static Sync_Semaphore simCtrlMutex = Sync_SemInitStatic("Dev:simCtrlMutex");
+
+/*
+ * Attaches are serialized with a monitor lock so the controllers and
+ * disks can be allocated and initialized without holding the spin locks
+ * above.  The spin locks are only taken to publish the new pointers.
+ */
+static Sync_Lock simAttachLock = Sync_LockInitStatic("Dev:simAttachLock");
+#define	LOCKPTR	(&simAttachLock)
+
+/*
+ * Device - A simulated disk.  The ScsiDevice handle is what is returned
+ * to higher level software, so it MUST BE THE FIRST FIELD.
+ */
+typedef struct Device {
+    ScsiDevice	handle;		/* Scsi Device handle. */
+    Controller	*ctrlPtr;	/* Controller the disk is attached to. */
+    int		targetID;	/* SCSI Target ID of the disk. */
+    DevScsiTagTable tags;	/* Commands queued on the disk. */
+    int		arrival[DEV_SCSI_MAX_TAGS]; /* Arrival order of the
+				 * command holding each tag. */
+    int		nextArrival;	/* Arrival number of the next command. */
+    int		activeTag;	/* Tag of the command being serviced,
+				 * -1 if the disk is idle. */
+    Timer_QueueElement timer;	/* Fires when the active command is
+				 * done. */
+    Address	data;		/* Contents of the disk. */
+    int		numSectors;	/* Size of the disk in sectors. */
+    int		headPos;	/* Sector the head is over. */
+    char	sense[SIM_SENSE_LEN]; /* Sense data of the last command
+				 * that returned CHECK status. */
+} Device;
+
+static Boolean entryAvailProc _ARGS_((ClientData clientData,
+				List_Links *newRequestPtr));
+static ReturnStatus ReleaseProc _ARGS_((ScsiDevice *scsiDevicePtr));
+static Boolean DecodeRW _ARGS_((ScsiCmd *scsiCmdPtr, int *firstSectorPtr,
+				int *numSectorsPtr));
+static void SetSense _ARGS_((Device *devPtr, ScsiCmd *scsiCmdPtr,
+				int key, int asc));
+static int ExecuteCmd _ARGS_((Device *devPtr, ScsiCmd *scsiCmdPtr,
+				int *amountPtr));
+static void StartService _ARGS_((Device *devPtr));
+static void StartNextRequests _ARGS_((Device *devPtr));
+static void SimDiskDone _ARGS_((Timer_Ticks time, ClientData clientData));
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DevScsiSimAttachDevice --
+ *
+ *	Attach a disk on a simulated HBA.  The controller is created the
+ *	first time one of its disks is attached.
+ *
+ * Results:
+ *	The ScsiDevice handle of the disk, NIL if there is no such disk.
+ *
+ * Side effects:
+ *	Memory is allocated for the controller and the disk contents.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ENTRY ScsiDevice   *
+DevScsiSimAttachDevice(devicePtr, insertProc)
+    Fs_Device	*devicePtr;	 /* Device to attach. */
+    void	(*insertProc) _ARGS_ ((List_Links *elementPtr,
+                                       List_Links *elementListHdrPtr));
+				 /* Queue insert procedure. */
+{
+    Device	*devPtr;
+    Controller	*ctrlPtr;
+    char	tmpBuffer[512];
+    int		ctrlNum, targetID, lun;
+    int		i;
+
+    ctrlNum = SCSI_HBA_NUMBER(devicePtr);
+    targetID = SCSI_TARGET_ID(devicePtr);
+    lun = SCSI_LUN(devicePtr);
+    if ((ctrlNum >= SIM_MAX_CTRLS) || (lun != 0) ||
+	(targetID >= devScsiSimNumTargets) || (targetID >= SIM_MAX_TARGETS) ||
+	(devScsiSimDiskKB <= 0)) {
+	return (ScsiDevice *) NIL;
+    }
+    LOCK_MONITOR;
+    ctrlPtr = Controllers[ctrlNum];
+    if (ctrlPtr == (Controller *) 0) {
+	ctrlPtr = (Controller *) malloc(sizeof(Controller));
+	bzero((char *) ctrlPtr, sizeof(Controller));
+	(void) sprintf(tmpBuffer, "SimHBA#%d", ctrlNum);
+	ctrlPtr->name = (char *) strcpy(malloc(strlen(tmpBuffer) + 1),
+					tmpBuffer);
+	Sync_SemInitDynamic(&(ctrlPtr->mutex), ctrlPtr->name);
+	ctrlPtr->devQueues = Dev_CtrlQueuesCreate(&(ctrlPtr->mutex),
+						  entryAvailProc);
+	for (i = 0; i < SIM_MAX_TARGETS; i++) {
+	    ctrlPtr->devicePtr[i] = (Device *) NIL;
+	}
+	MASTER_LOCK(&simCtrlMutex);
+	Controllers[ctrlNum] = ctrlPtr;
+	MASTER_UNLOCK(&simCtrlMutex);
+    }
+
+    if (ctrlPtr->devicePtr[targetID] != (Device *) NIL) {
+	/*
+	 * Already attached once before. Use the cached value.
+	 */
+	devPtr = ctrlPtr->devicePtr[targetID];
+	UNLOCK_MONITOR;
+	return (ScsiDevice *) devPtr;
+    }
+    devPtr = (Device *) malloc(sizeof(Device));
+    bzero((char *) devPtr, sizeof(Device));
+    devPtr->ctrlPtr = ctrlPtr;
+    devPtr->targetID = targetID;
+    devPtr->numSectors = devScsiSimDiskKB * (1024 / DEV_BYTES_PER_SECTOR);
+    devPtr->data = (Address) malloc(devPtr->numSectors * DEV_BYTES_PER_SECTOR);
+    bzero((char *) devPtr->data, devPtr->numSectors * DEV_BYTES_PER_SECTOR);
+    devPtr->activeTag = -1;
+    DevScsiTagInit(&devPtr->tags);
+    devPtr->timer.routine = SimDiskDone;
+    devPtr->timer.clientData = (ClientData) devPtr;
+
+    devPtr->handle.devQueue = Dev_QueueCreate(ctrlPtr->devQueues, 0,
+				insertProc, (ClientData) devPtr);
+    (void) sprintf(tmpBuffer, "%s Target %d LUN %d", ctrlPtr->name,
+			targetID, lun);
+    devPtr->handle.locationName = (char *) strcpy(malloc(strlen(tmpBuffer)+1),
+						  tmpBuffer);
+    devPtr->handle.LUN = lun;
+    devPtr->handle.releaseProc = ReleaseProc;
+    devPtr->handle.maxTransferSize = 64 * 1024;
+    devPtr->handle.maxTagDepth = devScsiSimMaxTags;
+    if (devPtr->handle.maxTagDepth > DEV_SCSI_MAX_TAGS) {
+	devPtr->handle.maxTagDepth = DEV_SCSI_MAX_TAGS;
+    }
+    if (devPtr->handle.maxTagDepth < 1) {
+	devPtr->handle.maxTagDepth = 1;
+    }
+    devPtr->handle.tagDepth = devPtr->handle.maxTagDepth;
+    MASTER_LOCK(&(ctrlPtr->mutex));
+    ctrlPtr->devicePtr[targetID] = devPtr;
+    MASTER_UNLOCK(&(ctrlPtr->mutex));
+    UNLOCK_MONITOR;
+    return (ScsiDevice *) devPtr;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseProc --
+ *
+ *	Release a simulated disk.  The disk and its contents are kept
+ *	for the next attach.
+ *
+ * Results:
+ *	SUCCESS
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static ReturnStatus
+ReleaseProc(scsiDevicePtr)
+    ScsiDevice	*scsiDevicePtr;
+{
+    return SUCCESS;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * entryAvailProc --
+ *
+ *	Dev_Queue callback called when a request is ready for a disk.
+ *	The request is given a tag and queued on the disk if the disk
+ *	has fewer than tagDepth commands outstanding.  Called with the
+ *	controller lock held.
+ *
+ * Results:
+ *	TRUE if the request was taken, FALSE if the device queue should
+ *	keep it.
+ *
+ * Side effects:
+ *	The disk may start servicing a command.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Boolean
+entryAvailProc(clientData, newRequestPtr)
+   ClientData	clientData;	/* Really the Device this request ready. */
+   List_Links	*newRequestPtr;	/* The new SCSI request. */
+{
+    register Device *devPtr = (Device *) clientData;
+    ScsiCmd	*scsiCmdPtr = (ScsiCmd *) newRequestPtr;
+    int		tag;
+
+    tag = DevScsiTagAlloc(&devPtr->tags, devPtr->handle.tagDepth,
+			  scsiCmdPtr);
+    if (tag < 0) {
+	return FALSE;
+    }
+    devPtr->arrival[tag] = devPtr->nextArrival++;
+    if (devScsiSimDebug > 3) {
+	printf("%s: queued 0x%x as tag %d, %d active\n",
+	    devPtr->handle.locationName, scsiCmdPtr->commandBlock[0] & 0xff,
+	    tag, devPtr->tags.numActive);
+    }
+    if (devPtr->activeTag < 0) {
+	StartService(devPtr);
+    }
+    return TRUE;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StartNextRequests --
+ *
+ *	Take requests off a disk's device queue until its command queue
+ *	is full.  Called with the controller lock held.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Requests are queued on the disk.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+StartNextRequests(devPtr)
+    Device	*devPtr;	/* Disk to fill. */
+{
+    List_Links	*newRequestPtr;
+
+    while (devPtr->tags.numActive < devPtr->handle.tagDepth) {
+	newRequestPtr = Dev_QueueGetNext(devPtr->handle.devQueue);
+	if (newRequestPtr == (List_Links *) NIL) {
+	    break;
+	}
+	(void) entryAvailProc((ClientData) devPtr, newRequestPtr);
+    }
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StartService --
+ *
+ *	Pick the next command a disk works on and schedule its completion.
+ *	With devScsiSimReorder set the command needing the shortest seek
+ *	is picked, otherwise the oldest.  Called with the controller lock
+ *	held.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The disk's timer is scheduled if it has commands.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+StartService(devPtr)
+    Device	*devPtr;	/* Idle disk. */
+{
+    int		tag, bestTag, bestDistance, distance;
+    int		firstSector, numSectors;
+    int		serviceMs;
+    ScsiCmd	*scsiCmdPtr;
+
+    if (devPtr->tags.numActive == 0) {
+	return;
+    }
+    bestTag = -1;
+    bestDistance = 0;
+    for (tag = 0; tag < DEV_SCSI_MAX_TAGS; tag++) {
+	scsiCmdPtr = DevScsiTagLookup(&devPtr->tags, tag);
+	if (scsiCmdPtr == (ScsiCmd *) NIL) {
+	    continue;
+	}
+	distance = 0;
+	if (DecodeRW(scsiCmdPtr, &firstSector, &numSectors)) {
+	    distance = firstSector - devPtr->headPos;
+	    if (distance < 0) {
+		distance = -distance;
+	    }
+	}
+	if ((bestTag < 0) ||
+	    (devScsiSimReorder && (distance < bestDistance)) ||
+	    ((!devScsiSimReorder || (distance == bestDistance)) &&
+	     (devPtr->arrival[tag] < devPtr->arrival[bestTag]))) {
+	    bestTag = tag;
+	    bestDistance = distance;
+	}
+    }
+    devPtr->activeTag = bestTag;
+    if (bestDistance > devPtr->numSectors) {
+	bestDistance = devPtr->numSectors;
+    }
+    serviceMs = devScsiSimTransferMs +
+		(devScsiSimSeekMs * bestDistance) / devPtr->numSectors;
+    devPtr->timer.interval = serviceMs * timer_IntOneMillisecond;
+    Timer_ScheduleRoutine(&devPtr->timer, TRUE);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SimDiskDone --
+ *
+ *	Timer routine called when a disk finishes servicing a command.
+ *	The command is found by its tag and executed, the disk's command
+ *	queue is refilled, and the requestor is called back.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The disk contents may change.  The command's doneProc is called.
+ *
+ *----------------------------------------------------------------------
+ */
+
+/*ARGSUSED*/
+static void
+SimDiskDone(time, clientData)
+    Timer_Ticks	time;		/* Time the timer fired. */
+    ClientData	clientData;	/* Really the Device. */
+{
+    Device	*devPtr = (Device *) clientData;
+    Controller	*ctrlPtr = devPtr->ctrlPtr;
+    ScsiCmd	*scsiCmdPtr;
+    int		statusByte, amount, tag;
+
+    MASTER_LOCK(&(ctrlPtr->mutex));
+    tag = devPtr->activeTag;
+    devPtr->activeTag = -1;
+    scsiCmdPtr = DevScsiTagFree(&devPtr->tags, tag);
+    if (scsiCmdPtr == (ScsiCmd *) NIL) {
+	printf("Warning: %s: completion for unknown tag %d\n",
+	    devPtr->handle.locationName, tag);
+	StartService(devPtr);
+	MASTER_UNLOCK(&(ctrlPtr->mutex));
+	return;
+    }
+    statusByte = ExecuteCmd(devPtr, scsiCmdPtr, &amount);
+    if (devScsiSimDebug > 3) {
+	printf("%s: tag %d done status 0x%x count %d\n",
+	    devPtr->handle.locationName, tag, statusByte, amount);
+    }
+    StartNextRequests(devPtr);
+    StartService(devPtr);
+    MASTER_UNLOCK(&(ctrlPtr->mutex));
+    if (SCSI_CHECK_STATUS(statusByte)) {
+	(scsiCmdPtr->doneProc)(scsiCmdPtr, SUCCESS, statusByte, amount,
+			scsiCmdPtr->senseLen, scsiCmdPtr->senseBuffer);
+    } else {
+	(scsiCmdPtr->doneProc)(scsiCmdPtr, SUCCESS, statusByte, amount,
+			0, (char *) 0);
+    }
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DecodeRW --
+ *
+ *	Get the sectors a READ or WRITE command covers.
+ *
+ * Results:
+ *	TRUE if the command is a READ or WRITE, FALSE otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Boolean
+DecodeRW(scsiCmdPtr, firstSectorPtr, numSectorsPtr)
+    ScsiCmd	*scsiCmdPtr;	/* Command to decode. */
+    int		*firstSectorPtr;	/* OUT: First sector. */
+    int		*numSectorsPtr;		/* OUT: Number of sectors. */
+{
+    unsigned char *cdbPtr = (unsigned char *) scsiCmdPtr->commandBlock;
+
+    switch (cdbPtr[0]) {
+	case SCSI_READ:
+	case SCSI_WRITE:
+	    *firstSectorPtr = ((cdbPtr[1] & 0x1f) << 16) | (cdbPtr[2] << 8) |
+				cdbPtr[3];
+	    *numSectorsPtr = (cdbPtr[4] == 0) ? 256 : cdbPtr[4];
+	    return TRUE;
+	case SCSI_READ_EXT:
+	case SCSI_WRITE_EXT:
+	    *firstSectorPtr = (cdbPtr[2] << 24) | (cdbPtr[3] << 16) |
+				(cdbPtr[4] << 8) | cdbPtr[5];
+	    *numSectorsPtr = (cdbPtr[7] << 8) | cdbPtr[8];
+	    return TRUE;
+	default:
+	    return FALSE;
+    }
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SetSense --
+ *
+ *	Fill in the extended sense data of a command that failed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The sense is stored in the command and in the disk, where the
+ *	next REQUEST SENSE finds it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SetSense(devPtr, scsiCmdPtr, key, asc)
+    Device	*devPtr;	/* Disk the command failed on. */
+    ScsiCmd	*scsiCmdPtr;	/* Command that failed. */
+    int		key;		/* Sense key. */
+    int		asc;		/* Additional sense code. */
+{
+    int		length;
+
+    bzero(devPtr->sense, SIM_SENSE_LEN);
+    devPtr->sense[0] = 0x70;
+    devPtr->sense[2] = key;
+    devPtr->sense[7] = SIM_SENSE_LEN - 8;
+    devPtr->sense[12] = asc;
+    length = SIM_SENSE_LEN;
+    if (length > SCSI_MAX_SENSE_LEN) {
+	length = SCSI_MAX_SENSE_LEN;
+    }
+    bcopy(devPtr->sense, scsiCmdPtr->senseBuffer, length);
+    scsiCmdPtr->senseLen = length;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ExecuteCmd --
+ *
+ *	Carry out a command on a simulated disk.  Called with the
+ *	controller lock held.
+ *
+ * Results:
+ *	The SCSI status byte.  The number of bytes transferred is
+ *	returned in *amountPtr.
+ *
+ * Side effects:
+ *	Data is copied between the command's buffer and the disk.  The
+ *	head moves to the end of a READ or WRITE.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ExecuteCmd(devPtr, scsiCmdPtr, amountPtr)
+    Device	*devPtr;	/* Disk to execute the command on. */
+    ScsiCmd	*scsiCmdPtr;	/* Command to execute. */
+    int		*amountPtr;	/* OUT: Bytes transferred. */
+{
+    unsigned char *cdbPtr = (unsigned char *) scsiCmdPtr->commandBlock;
+    char	inquiry[SIM_INQUIRY_LEN];
+    int		firstSector, numSectors, length;
+    Address	diskAddr;
+
+    *amountPtr = 0;
+    scsiCmdPtr->senseLen = 0;
+    if (DecodeRW(scsiCmdPtr, &firstSector, &numSectors)) {
+	if ((firstSector < 0) || (numSectors < 0) ||
+	    (firstSector + numSectors > devPtr->numSectors)) {
+	    SetSense(devPtr, scsiCmdPtr, SIM_KEY_ILLEGAL, SIM_ASC_BAD_ADDRESS);
+	    return SCSI_STATUS_CHECK;
+	}
+	length = numSectors * DEV_BYTES_PER_SECTOR;
+	if (length > scsiCmdPtr->bufferLen) {
+	    length = scsiCmdPtr->bufferLen;
+	}
+	diskAddr = devPtr->data + firstSector * DEV_BYTES_PER_SECTOR;
+	if (scsiCmdPtr->dataToDevice) {
+	    bcopy(scsiCmdPtr->buffer, diskAddr, length);
+	} else {
+	    bcopy(diskAddr, scsiCmdPtr->buffer, length);
+	}
+	devPtr->headPos = firstSector + numSectors;
+	*amountPtr = length;
+	return 0;
+    }
+    switch (cdbPtr[0]) {
+	case SCSI_TEST_UNIT_READY:
+	case SCSI_START_STOP:
+	    return 0;
+	case SCSI_INQUIRY:
+	    bzero(inquiry, SIM_INQUIRY_LEN);
+	    inquiry[0] = SCSI_DISK_TYPE;
+	    inquiry[2] = 2;		/* SCSI-2 */
+	    inquiry[3] = 2;		/* Response data format. */
+	    inquiry[4] = SIM_INQUIRY_LEN - 5;
+	    inquiry[7] = 0x02;		/* Supports command queuing. */
+	    bcopy("Sprite  ", &inquiry[8], 8);
+	    bcopy("Simulated disk  ", &inquiry[16], 16);
+	    bcopy("1.0 ", &inquiry[32], 4);
+	    length = SIM_INQUIRY_LEN;
+	    if (length > cdbPtr[4]) {
+		length = cdbPtr[4];
+	    }
+	    if (length > scsiCmdPtr->bufferLen) {
+		length = scsiCmdPtr->bufferLen;
+	    }
+	    bcopy(inquiry, scsiCmdPtr->buffer, length);
+	    *amountPtr = length;
+	    return 0;
+	case SCSI_REQUEST_SENSE:
+	    if (devPtr->sense[0] == 0) {
+		devPtr->sense[0] = 0x70;
+		devPtr->sense[2] = SIM_KEY_NO_SENSE;
+		devPtr->sense[7] = SIM_SENSE_LEN - 8;
+	    }
+	    length = SIM_SENSE_LEN;
+	    if (length > cdbPtr[4]) {
+		length = cdbPtr[4];
+	    }
+	    if (length > scsiCmdPtr->bufferLen) {
+		length = scsiCmdPtr->bufferLen;
+	    }
+	    bcopy(devPtr->sense, scsiCmdPtr->buffer, length);
+	    bzero(devPtr->sense, SIM_SENSE_LEN);
+	    *amountPtr = length;
+	    return 0;
+	default:
+	    SetSense(devPtr, scsiCmdPtr, SIM_KEY_ILLEGAL, SIM_ASC_BAD_OPCODE);
+	    return SCSI_STATUS_CHECK;
+    }
+}
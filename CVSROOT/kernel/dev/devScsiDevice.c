@@ -336,6 +336,130 @@ DevScsiSenseCmd(scsiDevicePtr, bufferSize, buffer, scsiCmdPtr)
     scsiCmdPtr->buffer = buffer;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ *  DevScsiTagInit --
+ *
+ * 	Initialize the tag table of a device.  All tags are free.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects: 
+ *	The table is initialized.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+DevScsiTagInit(tablePtr)
+    DevScsiTagTable *tablePtr;	/* Table to initialize. */
+{
+    int		tag;
+
+    for (tag = 0; tag < DEV_SCSI_MAX_TAGS; tag++) {
+	tablePtr->cmdPtr[tag] = (ScsiCmd *) NIL;
+    }
+    tablePtr->numActive = 0;
+    tablePtr->nextTag = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *  DevScsiTagAlloc --
+ *
+ * 	Give a command a tag.
+ *
+ * Results:
+ *	The tag, or -1 if depth or more tags are already in use.
+ *
+ * Side effects: 
+ *	The tag is marked as belonging to the command.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+DevScsiTagAlloc(tablePtr, depth, scsiCmdPtr)
+    DevScsiTagTable *tablePtr;	/* Tag table of the device. */
+    int		depth;		/* Most tags that may be in use. */
+    ScsiCmd	*scsiCmdPtr;	/* Command to tag. */
+{
+    int		tag, i;
+
+    if ((tablePtr->numActive >= depth) ||
+	(tablePtr->numActive >= DEV_SCSI_MAX_TAGS)) {
+	return -1;
+    }
+    tag = tablePtr->nextTag;
+    for (i = 0; i < DEV_SCSI_MAX_TAGS; i++) {
+	if (tablePtr->cmdPtr[tag] == (ScsiCmd *) NIL) {
+	    break;
+	}
+	tag = (tag + 1) % DEV_SCSI_MAX_TAGS;
+    }
+    tablePtr->cmdPtr[tag] = scsiCmdPtr;
+    tablePtr->numActive++;
+    tablePtr->nextTag = (tag + 1) % DEV_SCSI_MAX_TAGS;
+    return tag;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *  DevScsiTagLookup --
+ *
+ * 	Find the command holding a tag.
+ *
+ * Results:
+ *	The command, NIL if the tag isn't in use.
+ *
+ * Side effects: 
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+ScsiCmd *
+DevScsiTagLookup(tablePtr, tag)
+    DevScsiTagTable *tablePtr;	/* Tag table of the device. */
+    int		tag;		/* Tag returned by the device. */
+{
+    if ((tag < 0) || (tag >= DEV_SCSI_MAX_TAGS)) {
+	return (ScsiCmd *) NIL;
+    }
+    return tablePtr->cmdPtr[tag];
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *  DevScsiTagFree --
+ *
+ * 	Release the tag of a command that has finished.
+ *
+ * Results:
+ *	The command that held the tag, NIL if the tag wasn't in use.
+ *
+ * Side effects: 
+ *	The tag is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+ScsiCmd *
+DevScsiTagFree(tablePtr, tag)
+    DevScsiTagTable *tablePtr;	/* Tag table of the device. */
+    int		tag;		/* Tag returned by the device. */
+{
+    ScsiCmd	*scsiCmdPtr;
+
+    scsiCmdPtr = DevScsiTagLookup(tablePtr, tag);
+    if (scsiCmdPtr != (ScsiCmd *) NIL) {
+	tablePtr->cmdPtr[tag] = (ScsiCmd *) NIL;
+	tablePtr->numActive--;
+    }
+    return scsiCmdPtr;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -678,6 +802,69 @@ DevScsiIOControl(devPtr, ioctlPtr, replyPtr)
 	                 senseBufLen);
 	}
 	return status;
+    } else if (ioctlPtr->command == IOC_SCSI_SET_SCHED) {
+	void	(*insertProc)();
+
+	if (ioctlPtr->inBufSize < sizeof(int)) {
+	    return GEN_INVALID_ARG;
+	}
+	switch (*(int *) ioctlPtr->inBuffer) {
+	    case DEV_SCSI_SCHED_FIFO:
+		insertProc = DEV_QUEUE_FIFO_INSERT;
+		break;
+	    case DEV_SCSI_SCHED_CLOOK:
+		insertProc = DevScsiCLookInsert;
+		break;
+	    case DEV_SCSI_SCHED_DEADLINE:
+		insertProc = DevScsiDeadlineInsert;
+		break;
+	    default:
+		return GEN_INVALID_ARG;
+	}
+	Dev_QueueSetInsertProc(devPtr->devQueue, insertProc);
+	return SUCCESS;
+    } else if (ioctlPtr->command == IOC_SCSI_GET_SCHED) {
+	void	(*insertProc)();
+
+	if (ioctlPtr->outBufSize < sizeof(int)) {
+	    return GEN_INVALID_ARG;
+	}
+	insertProc = Dev_QueueGetInsertProc(devPtr->devQueue);
+	if (insertProc == DevScsiCLookInsert) {
+	    *(int *) ioctlPtr->outBuffer = DEV_SCSI_SCHED_CLOOK;
+	} else if (insertProc == DevScsiDeadlineInsert) {
+	    *(int *) ioctlPtr->outBuffer = DEV_SCSI_SCHED_DEADLINE;
+	} else {
+	    *(int *) ioctlPtr->outBuffer = DEV_SCSI_SCHED_FIFO;
+	}
+	return SUCCESS;
+    } else if (ioctlPtr->command == IOC_SCSI_SCHED_BENCH) {
+	return DevScsiSchedBench(ioctlPtr);
+    } else if (ioctlPtr->command == IOC_SCSI_SET_TAG_DEPTH) {
+	int	depth;
+
+	if (ioctlPtr->inBufSize < sizeof(int)) {
+	    return GEN_INVALID_ARG;
+	}
+	if (devPtr->maxTagDepth == 0) {
+	    return GEN_NOT_IMPLEMENTED;
+	}
+	depth = *(int *) ioctlPtr->inBuffer;
+	if (depth < 1) {
+	    return GEN_INVALID_ARG;
+	}
+	if (depth > devPtr->maxTagDepth) {
+	    depth = devPtr->maxTagDepth;
+	}
+	devPtr->tagDepth = depth;
+	return SUCCESS;
+    } else if (ioctlPtr->command == IOC_SCSI_GET_TAG_DEPTH) {
+	if (ioctlPtr->outBufSize < 2 * sizeof(int)) {
+	    return GEN_INVALID_ARG;
+	}
+	((int *) ioctlPtr->outBuffer)[0] = devPtr->tagDepth;
+	((int *) ioctlPtr->outBuffer)[1] = devPtr->maxTagDepth;
+	return SUCCESS;
     } else {
 	return GEN_INVALID_ARG;
     }
@@ -0,0 +1,417 @@
+/*
+ * devScsiSched.c --
+ *
+ *	Queue insert procedures that order the commands on a SCSI device
+ *	queue to reduce seeking, and a simulator for comparing them on a
+ *	trace of requests.  See Dev_QueueCreate for the calling sequence
+ *	of insert procedures.
+ *
+ *	DevScsiCLookInsert keeps the queue in C-LOOK order: commands
+ *	ahead of the disk's position in increasing sector order, followed
+ *	by the commands behind it, also in increasing order.  The command
+ *	at the head of the queue is never displaced.
+ *
+ *	DevScsiDeadlineInsert does the same but also gives each command a
+ *	deadline, devScsiReadDeadlineMs after it was queued for reads and
+ *	devScsiWriteDeadlineMs for writes.  Commands whose deadline has
+ *	passed are moved to the head of the queue, oldest deadline first,
+ *	so a burst of writes cannot starve a synchronous read.
+ *
+ *	Commands other than reads and writes are never reordered: they
+ *	are queued at the rear and later commands are not moved ahead of
+ *	them.
+ *
+ * Copyright 1990 Regents of the University of California
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ */
+
+#ifndef lint
+static char rcsid[] = "$Header$ SPRITE (Berkeley)";
+#endif /* not lint */
+
+#include <sprite.h>
+#include <scsiDevice.h>
+#include <dev/scsi.h>
+#include <sys/scsi.h>
+#include <devQueue.h>
+#include <list.h>
+#include <fs.h>
+#include <timer.h>
+#include <stdlib.h>
+#include <bstring.h>
+
+/*
+ * Deadlines, in milliseconds after a command is queued.
+ */
+int devScsiReadDeadlineMs = 250;
+int devScsiWriteDeadlineMs = 2000;
+
+/*
+ * Time the simulator charges for each command, in milliseconds.
+ */
+int devScsiSchedBenchServiceMs = 10;
+
+/*
+ * Sector number of a command that is not a read or a write.
+ */
+#define	NOT_READ_WRITE	((unsigned int) 0xffffffff)
+
+#define	Sector(itemPtr)	CmdSector((ScsiCmd *) (itemPtr))
+
+static void SortedInsert _ARGS_((List_Links *elementPtr,
+			    List_Links *listHdrPtr, Timer_Ticks *nowPtr));
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CmdSector --
+ *
+ *	Return the starting sector of a read or write command.
+ *
+ * Results:
+ *	The sector, or NOT_READ_WRITE if the command doesn't transfer
+ *	data to or from the medium.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static unsigned int
+CmdSector(scsiCmdPtr)
+    ScsiCmd	*scsiCmdPtr;
+{
+    unsigned char	*cmdPtr = (unsigned char *) scsiCmdPtr->commandBlock;
+
+    switch (cmdPtr[0]) {
+	case SCSI_READ:
+	case SCSI_WRITE:
+	    return ((cmdPtr[1] & 0x1f) << 16) | (cmdPtr[2] << 8) | cmdPtr[3];
+	case SCSI_READ_EXT:
+	case SCSI_WRITE_EXT:
+	    return (cmdPtr[2] << 24) | (cmdPtr[3] << 16) | (cmdPtr[4] << 8) |
+		    cmdPtr[5];
+	default:
+	    return NOT_READ_WRITE;
+    }
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DevScsiCLookInsert --
+ *
+ *	Insert a command into a device queue in C-LOOK order.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The command is linked into the queue.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+DevScsiCLookInsert(elementPtr, listHdrPtr)
+    List_Links	*elementPtr;	/* ScsiCmd to add. */
+    List_Links	*listHdrPtr;	/* Device queue to add it to. */
+{
+    SortedInsert(elementPtr, listHdrPtr, (Timer_Ticks *) NIL);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DevScsiDeadlineInsert --
+ *
+ *	Insert a command into a device queue in C-LOOK order, after any
+ *	commands whose deadline has passed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The command's deadline is set and it is linked into the queue.
+ *	Expired commands are moved to the head of the queue.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+DevScsiDeadlineInsert(elementPtr, listHdrPtr)
+    List_Links	*elementPtr;	/* ScsiCmd to add. */
+    List_Links	*listHdrPtr;	/* Device queue to add it to. */
+{
+    Timer_Ticks	now;
+
+    Timer_GetCurrentTicks(&now);
+    SortedInsert(elementPtr, listHdrPtr, &now);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SortedInsert --
+ *
+ *	Do the work for DevScsiCLookInsert and DevScsiDeadlineInsert.
+ *	Only the part of the queue after the last command that is not a
+ *	read or write is sorted.  Within that part the queue looks like
+ *
+ *		[expired commands] [ascending run 1] [ascending run 2]
+ *
+ *	where run 1 starts at the command the disk will do next and run 2
+ *	holds the commands with lower sectors.  If nowPtr is NIL there
+ *	are no deadlines.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	See above.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SortedInsert(elementPtr, listHdrPtr, nowPtr)
+    List_Links	*elementPtr;	/* ScsiCmd to add. */
+    List_Links	*listHdrPtr;	/* Device queue to add it to. */
+    Timer_Ticks	*nowPtr;	/* Current time, NIL for no deadlines. */
+{
+    ScsiCmd	*scsiCmdPtr = (ScsiCmd *) elementPtr;
+    List_Links	*itemPtr;
+    List_Links	*fixedPtr;	/* Last element that may not be moved. */
+    List_Links	*prevPtr;
+    List_Links	*nextPtr;
+    List_Links	*oldestPtr;
+    unsigned int sector;
+    unsigned int firstSector;
+
+    sector = CmdSector(scsiCmdPtr);
+    if (nowPtr != (Timer_Ticks *) NIL) {
+	Timer_AddIntervalToTicks(*nowPtr, (unsigned int)
+		(scsiCmdPtr->dataToDevice ? devScsiWriteDeadlineMs :
+					    devScsiReadDeadlineMs) *
+		timer_IntOneMillisecond, &scsiCmdPtr->deadline);
+    }
+    if (sector == NOT_READ_WRITE) {
+	List_Insert(elementPtr, LIST_ATREAR(listHdrPtr));
+	return;
+    }
+    fixedPtr = listHdrPtr;
+    LIST_FORALL(listHdrPtr, itemPtr) {
+	if (Sector(itemPtr) == NOT_READ_WRITE) {
+	    fixedPtr = itemPtr;
+	}
+    }
+    if (nowPtr != (Timer_Ticks *) NIL) {
+	/*
+	 * Expired commands already at the front stay there.  Move any
+	 * others up behind them in deadline order.
+	 */
+	while (!List_IsAtEnd(listHdrPtr, fixedPtr->nextPtr) &&
+	       Timer_TickLE(((ScsiCmd *) fixedPtr->nextPtr)->deadline,
+			    *nowPtr)) {
+	    fixedPtr = fixedPtr->nextPtr;
+	}
+	for (;;) {
+	    oldestPtr = (List_Links *) NIL;
+	    for (itemPtr = fixedPtr->nextPtr;
+		 !List_IsAtEnd(listHdrPtr, itemPtr);
+		 itemPtr = itemPtr->nextPtr) {
+		if (Timer_TickLE(((ScsiCmd *) itemPtr)->deadline, *nowPtr) &&
+		    (oldestPtr == (List_Links *) NIL ||
+		     Timer_TickLT(((ScsiCmd *) itemPtr)->deadline,
+				  ((ScsiCmd *) oldestPtr)->deadline))) {
+		    oldestPtr = itemPtr;
+		}
+	    }
+	    if (oldestPtr == (List_Links *) NIL) {
+		break;
+	    }
+	    List_Move(oldestPtr, LIST_AFTER(fixedPtr));
+	    fixedPtr = oldestPtr;
+	}
+    }
+    /*
+     * Now insert the new command into the C-LOOK order.
+     */
+    prevPtr = fixedPtr->nextPtr;
+    if (List_IsAtEnd(listHdrPtr, prevPtr)) {
+	List_Insert(elementPtr, LIST_AFTER(fixedPtr));
+	return;
+    }
+    firstSector = Sector(prevPtr);
+    nextPtr = prevPtr->nextPtr;
+    if (sector >= firstSector) {
+	/*
+	 * Goes in run 1, after any commands for the same sector.
+	 */
+	while (!List_IsAtEnd(listHdrPtr, nextPtr) &&
+	       Sector(nextPtr) >= Sector(prevPtr) &&
+	       Sector(nextPtr) <= sector) {
+	    prevPtr = nextPtr;
+	    nextPtr = nextPtr->nextPtr;
+	}
+    } else {
+	/*
+	 * Skip run 1, then find the place in run 2.
+	 */
+	while (!List_IsAtEnd(listHdrPtr, nextPtr) &&
+	       Sector(nextPtr) >= Sector(prevPtr)) {
+	    prevPtr = nextPtr;
+	    nextPtr = nextPtr->nextPtr;
+	}
+	while (!List_IsAtEnd(listHdrPtr, nextPtr) &&
+	       Sector(nextPtr) <= sector) {
+	    prevPtr = nextPtr;
+	    nextPtr = nextPtr->nextPtr;
+	}
+    }
+    List_Insert(elementPtr, LIST_AFTER(prevPtr));
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DevScsiSchedBench --
+ *
+ *	Run a trace of requests through a simulated device queue using
+ *	one of the schedulers.  The input buffer holds a
+ *	DevScsiSchedBenchParams followed by the trace records; a
+ *	DevScsiSchedBenchResult is returned in the output buffer.  Each
+ *	command is charged devScsiSchedBenchServiceMs of simulated time.
+ *
+ * Results:
+ *	SUCCESS, or GEN_INVALID_ARG if the buffers are malformed.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ReturnStatus
+DevScsiSchedBench(ioctlPtr)
+    Fs_IOCParam *ioctlPtr;	/* Standard I/O Control parameter block */
+{
+    DevScsiSchedBenchParams	*paramsPtr;
+    DevScsiSchedTrace		*tracePtr;
+    DevScsiSchedBenchResult	result;
+    ScsiCmd			*cmds;
+    int				*queuedAt;
+    List_Links			listHdr;
+    List_Links			*itemPtr;
+    Timer_Ticks			now;
+    unsigned int		head;
+    unsigned int		seek;
+    unsigned int		seekRem;
+    unsigned int		sector;
+    int				numQueued;
+    int				next;
+    int				i;
+    int				wait;
+    unsigned char		*cmdPtr;
+
+    if (ioctlPtr->inBufSize < sizeof(DevScsiSchedBenchParams) ||
+	ioctlPtr->outBufSize < sizeof(DevScsiSchedBenchResult)) {
+	return GEN_INVALID_ARG;
+    }
+    paramsPtr = (DevScsiSchedBenchParams *) ioctlPtr->inBuffer;
+    tracePtr = (DevScsiSchedTrace *) (paramsPtr + 1);
+    if (paramsPtr->numRecords <= 0 || paramsPtr->queueDepth <= 0 ||
+	paramsPtr->sched < DEV_SCSI_SCHED_FIFO ||
+	paramsPtr->sched > DEV_SCSI_SCHED_DEADLINE ||
+	paramsPtr->numRecords > (ioctlPtr->inBufSize -
+		sizeof(DevScsiSchedBenchParams)) / sizeof(DevScsiSchedTrace)) {
+	return GEN_INVALID_ARG;
+    }
+    cmds = (ScsiCmd *) malloc(paramsPtr->numRecords * sizeof(ScsiCmd));
+    queuedAt = (int *) malloc(paramsPtr->numRecords * sizeof(int));
+    bzero((char *) &result, sizeof(result));
+    List_Init(&listHdr);
+    Timer_GetCurrentTicks(&now);
+    head = 0;
+    seekRem = 0;
+    numQueued = 0;
+    next = 0;
+    while (result.numRequests < paramsPtr->numRecords) {
+	while (next < paramsPtr->numRecords &&
+	       numQueued < paramsPtr->queueDepth) {
+	    bzero((char *) &cmds[next], sizeof(ScsiCmd));
+	    sector = tracePtr[next].sector;
+	    cmdPtr = (unsigned char *) cmds[next].commandBlock;
+	    cmdPtr[0] = tracePtr[next].write ? SCSI_WRITE_EXT : SCSI_READ_EXT;
+	    cmdPtr[2] = (sector >> 24) & 0xff;
+	    cmdPtr[3] = (sector >> 16) & 0xff;
+	    cmdPtr[4] = (sector >> 8) & 0xff;
+	    cmdPtr[5] = sector & 0xff;
+	    cmds[next].commandBlockLen = 10;
+	    cmds[next].dataToDevice = tracePtr[next].write;
+	    queuedAt[next] = result.numRequests;
+	    switch (paramsPtr->sched) {
+		case DEV_SCSI_SCHED_FIFO:
+		    List_Insert((List_Links *) &cmds[next],
+			    LIST_ATREAR(&listHdr));
+		    break;
+		case DEV_SCSI_SCHED_CLOOK:
+		    SortedInsert((List_Links *) &cmds[next], &listHdr,
+			    (Timer_Ticks *) NIL);
+		    break;
+		case DEV_SCSI_SCHED_DEADLINE:
+		    SortedInsert((List_Links *) &cmds[next], &listHdr, &now);
+		    break;
+	    }
+	    numQueued++;
+	    next++;
+	}
+	itemPtr = List_First(&listHdr);
+	List_Remove(itemPtr);
+	numQueued--;
+	i = (ScsiCmd *) itemPtr - cmds;
+	sector = tracePtr[i].sector;
+	seek = (sector > head) ? sector - head : head - sector;
+	head = sector;
+	result.numRequests++;
+	/*
+	 * Keep a running average so the sum can't overflow.
+	 */
+	result.avgSeek += seek / paramsPtr->numRecords;
+	seekRem += seek % paramsPtr->numRecords;
+	if (seekRem >= paramsPtr->numRecords) {
+	    result.avgSeek++;
+	    seekRem -= paramsPtr->numRecords;
+	}
+	wait = result.numRequests - 1 - queuedAt[i];
+	if (tracePtr[i].write) {
+	    if (wait > result.maxWriteWait) {
+		result.maxWriteWait = wait;
+	    }
+	} else if (wait > result.maxReadWait) {
+	    result.maxReadWait = wait;
+	}
+	if (paramsPtr->sched == DEV_SCSI_SCHED_DEADLINE &&
+	    Timer_TickLT(cmds[i].deadline, now)) {
+	    result.numExpired++;
+	}
+	Timer_AddIntervalToTicks(now, (unsigned int)
+		devScsiSchedBenchServiceMs * timer_IntOneMillisecond, &now);
+    }
+    free((char *) queuedAt);
+    free((char *) cmds);
+    bcopy((char *) &result, ioctlPtr->outBuffer, sizeof(result));
+    return SUCCESS;
+}
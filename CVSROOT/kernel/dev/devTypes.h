@@ -114,6 +114,7 @@
 #define	DEV_SCSI3_HBA	0
 #define	DEV_SCSI0_HBA	1
 #define	DEV_JAGUAR_HBA  2
+#define	DEV_SCSI_SIM_HBA 3	/* Simulated HBA, see devSCSISim.c. */
 
 /*
  * The following exists only on the sparc station.
@@ -25,6 +25,8 @@
 extern DevDiskStats *DevRegisterDisk _ARGS_((Fs_Device *devicePtr, char *deviceName, Boolean (*idleCheck)(), ClientData clientData));
 extern void Dev_GatherDiskStats _ARGS_((void));
 extern int Dev_GetDiskStats _ARGS_((Sys_DiskStats *diskStatArr, int numEntries));
+extern int Dev_GetDiskMergeStats _ARGS_((DevDiskMergeStats *mergeStatArr,
+    int numEntries));
 
 #endif /* _DISKSTATS */
 
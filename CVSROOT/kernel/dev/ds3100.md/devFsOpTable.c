@@ -94,8 +94,8 @@ DevFsTypeOps devFsOpTable[] = {
      */
     {DEV_SCSI_DISK, DevRawBlockDevOpen, DevRawBlockDevRead,
 		    DevRawBlockDevWrite, DevRawBlockDevIOControl, 
-		    DevRawBlockDevClose, Dev_NullSelect, DevScsiDiskAttach,
-		    DevRawBlockDevReopen, NullProc},
+		    DevRawBlockDevClose, DevRawBlockDevSelect,
+		    DevScsiDiskAttach, DevRawBlockDevReopen, NullProc},
     /*
      * SCSI Tape interface.
      */
@@ -132,14 +132,14 @@ DevFsTypeOps devFsOpTable[] = {
      */
     {DEV_RAID, DevRawBlockDevOpen, DevRawBlockDevRead,
                     DevRawBlockDevWrite, DevRawBlockDevIOControl,
-                    DevRawBlockDevClose, NullProc, DevRaidAttach,
+                    DevRawBlockDevClose, DevRawBlockDevSelect, DevRaidAttach,
                     DevRawBlockDevReopen, NullProc},
     /*  
      * Debug device. (useful for debugging RAID device)
      */ 
     {DEV_DEBUG, DevRawBlockDevOpen, DevRawBlockDevRead,
                     DevRawBlockDevWrite, DevRawBlockDevIOControl,
-                    DevRawBlockDevClose, NullProc, DevDebugAttach,
+                    DevRawBlockDevClose, DevRawBlockDevSelect, DevDebugAttach,
                     DevRawBlockDevReopen, NullProc},
     /*
      * The graphics device.
@@ -96,8 +96,8 @@ DevFsTypeOps devFsOpTable[] = {
      */
     {DEV_SCSI_DISK, DevRawBlockDevOpen, DevRawBlockDevRead,
 		    DevRawBlockDevWrite, DevRawBlockDevIOControl, 
-		    DevRawBlockDevClose, Dev_NullSelect, DevScsiDiskAttach,
-		    DevRawBlockDevReopen, NullProc},
+		    DevRawBlockDevClose, DevRawBlockDevSelect,
+		    DevScsiDiskAttach, DevRawBlockDevReopen, NullProc},
     /*
      * SCSI Tape interface.
      */
@@ -134,7 +134,7 @@ DevFsTypeOps devFsOpTable[] = {
      */
     {DEV_RAID, DevRawBlockDevOpen, DevRawBlockDevRead,
                     DevRawBlockDevWrite, DevRawBlockDevIOControl,
-                    DevRawBlockDevClose, NullProc, DevRaidAttach,
+                    DevRawBlockDevClose, DevRawBlockDevSelect, DevRaidAttach,
                     DevRawBlockDevReopen, NullProc},
 
     /*
@@ -142,7 +142,7 @@ DevFsTypeOps devFsOpTable[] = {
      */
     {DEV_DEBUG, DevRawBlockDevOpen, DevRawBlockDevRead,
                     DevRawBlockDevWrite, DevRawBlockDevIOControl,
-                    DevRawBlockDevClose, NullProc, DevDebugAttach,
+                    DevRawBlockDevClose, DevRawBlockDevSelect, DevDebugAttach,
                     DevRawBlockDevReopen, NullProc},
 
     /*
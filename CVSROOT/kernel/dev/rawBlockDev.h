@@ -23,6 +23,39 @@
 #include "user/fs.h"
 #include "fs.h"
 
+/*
+ * Asynchronous I/O on raw block devices.  IOC_RAW_AIO_SUBMIT takes a
+ * DevRawAioRequest in the input buffer and starts the transfer without
+ * waiting for it.  The device selects as readable once one of the
+ * caller's requests has finished, and IOC_RAW_AIO_REAP fills the output
+ * buffer with a DevRawAioResult for each finished request, up to as many
+ * as fit.  The buffer, offset and length of a request must be multiples
+ * of the device's minimum transfer unit, and the buffer must stay valid
+ * until the request is reaped.
+ */
+#ifndef IOC_RAW_AIO_SUBMIT
+#define	IOC_RAW_BLOCK_DEV	(21 << 16)
+#define	IOC_RAW_AIO_SUBMIT	(IOC_RAW_BLOCK_DEV | 1)
+#define	IOC_RAW_AIO_REAP	(IOC_RAW_BLOCK_DEV | 2)
+#endif
+
+typedef struct DevRawAioRequest {
+    int		id;		/* Caller's name for the request, returned
+				 * in its DevRawAioResult. */
+    int		operation;	/* FS_READ or FS_WRITE. */
+    int		offset;		/* Byte offset on the device. */
+    int		length;		/* Number of bytes to transfer. */
+    Address	buffer;		/* Caller's data buffer. */
+} DevRawAioRequest;
+
+typedef struct DevRawAioResult {
+    int		id;		/* From the DevRawAioRequest. */
+    ReturnStatus status;	/* SUCCESS or the error of the transfer. */
+    int		amount;		/* Bytes transferred. */
+} DevRawAioResult;
+
+extern int devRawAioMaxRequests;
+
 extern ReturnStatus DevRawBlockDevOpen _ARGS_((Fs_Device *devicePtr,
     int useFlags, Fs_NotifyToken token, int *flagsPtr));
 extern ReturnStatus DevRawBlockDevReopen _ARGS_((Fs_Device *devicePtr,
@@ -35,6 +68,10 @@ extern ReturnStatus DevRawBlockDevClose _ARGS_((Fs_Device *devicePtr,
     int useFlags, int openCount, int writerCount));
 extern ReturnStatus DevRawBlockDevIOControl _ARGS_((Fs_Device *devicePtr,
     Fs_IOCParam *ioctlPtr, Fs_IOReply *replyPtr));
+extern ReturnStatus DevRawBlockDevSelect _ARGS_((Fs_Device *devicePtr,
+    int *readPtr, int *writePtr, int *exceptPtr));
+extern void DevRawBlockDevProcExit _ARGS_((Proc_PID processID));
+extern Boolean DevRawBlockDevProcBusy _ARGS_((Proc_PID processID));
 
 #endif /* _RAWBLOCKDEV */
 
@@ -36,6 +36,7 @@
 #include <user/fs.h>
 #include <fs.h>
 #include <sys/scsi.h>
+#include <timer.h>
 
 /*
  * The ScsiCmd data structure contains the information that a SCSI device 
@@ -69,6 +70,8 @@ struct ScsiCmd {
     int		senseLen;	/* Length of sense data. */
     char	senseBuffer[SCSI_MAX_SENSE_LEN]; /* Sense buffer. */
     int		statusByte;	/* Sense byte from scsi command. */
+    Timer_Ticks	deadline;	/* Time by which the command should be
+				 * started.  Set by DevScsiDeadlineInsert. */
 };
 typedef struct ScsiCmd ScsiCmd;
 
@@ -115,6 +118,13 @@ typedef struct ScsiDevice {
     ReturnStatus (*errorProc) _ARGS_((struct ScsiDevice *devPtr, 
 				    ScsiCmd *scsiCmdPtr));     
     ClientData	clientData;	     /* Whatever you want it to be. */
+    int		maxTagDepth;	     /* Most commands the HBA can have
+				      * outstanding on the device at once
+				      * using tagged queuing. Zero if the
+				      * HBA sends one command at a time. */
+    int		tagDepth;	     /* Commands the HBA may have outstanding
+				      * on the device, at most maxTagDepth.
+				      * Set with IOC_SCSI_SET_TAG_DEPTH. */
 
 } ScsiDevice;
 
@@ -158,6 +168,60 @@ typedef struct ScsiDevice {
 extern void		  DevScsiSendCmd();
 #endif
 
+/*
+ * Queue schedulers for SCSI devices, selected with IOC_SCSI_SET_SCHED.
+ * See devScsiSched.c.
+ */
+#define	DEV_SCSI_SCHED_FIFO	0
+#define	DEV_SCSI_SCHED_CLOOK	1
+#define	DEV_SCSI_SCHED_DEADLINE	2
+
+/*
+ * IOC_SCSI_SET_SCHED takes a DEV_SCSI_SCHED_* value in the input buffer;
+ * IOC_SCSI_GET_SCHED returns one in the output buffer.
+ * IOC_SCSI_SCHED_BENCH runs a trace through a simulated device queue:
+ * the input buffer holds a DevScsiSchedBenchParams followed by
+ * numRecords DevScsiSchedTrace records, and a DevScsiSchedBenchResult
+ * is returned.
+ */
+#ifndef IOC_SCSI_SET_SCHED
+#define	IOC_SCSI_SET_SCHED	(IOC_SCSI | 0x40)
+#define	IOC_SCSI_GET_SCHED	(IOC_SCSI | 0x41)
+#define	IOC_SCSI_SCHED_BENCH	(IOC_SCSI | 0x42)
+#endif
+
+/*
+ * IOC_SCSI_SET_TAG_DEPTH takes the number of tagged commands the HBA may
+ * have outstanding on the device in the input buffer.  The value is
+ * limited to the maxTagDepth of the device.  IOC_SCSI_GET_TAG_DEPTH
+ * returns the current depth and maxTagDepth, in that order.
+ */
+#ifndef IOC_SCSI_SET_TAG_DEPTH
+#define	IOC_SCSI_SET_TAG_DEPTH	(IOC_SCSI | 0x43)
+#define	IOC_SCSI_GET_TAG_DEPTH	(IOC_SCSI | 0x44)
+#endif
+
+typedef struct DevScsiSchedBenchParams {
+    int		sched;		/* DEV_SCSI_SCHED_* to simulate. */
+    int		queueDepth;	/* Requests kept queued. */
+    int		numRecords;	/* Trace records that follow. */
+} DevScsiSchedBenchParams;
+
+typedef struct DevScsiSchedTrace {
+    unsigned int sector;	/* Starting sector of the request. */
+    int		 write;		/* TRUE for a write. */
+} DevScsiSchedTrace;
+
+typedef struct DevScsiSchedBenchResult {
+    int		numRequests;	/* Requests simulated. */
+    int		avgSeek;	/* Average seek distance in sectors. */
+    int		maxReadWait;	/* Most requests done while a read
+				 * was queued. */
+    int		maxWriteWait;	/* Most requests done while a write
+				 * was queued. */
+    int		numExpired;	/* Requests started late. */
+} DevScsiSchedBenchResult;
+
 #define	MAX_SCSI_ERROR_STRING	128
 extern int devScsiNumErrors[];
 extern char **devScsiErrors[];
@@ -183,6 +247,11 @@ extern ReturnStatus DevScsiIOControl _ARGS_((ScsiDevice *devPtr,
     Fs_IOCParam *ioctlPtr, Fs_IOReply *replyPtr));
 extern ScsiDevice *DevNoHBAAttachDevice _ARGS_((Fs_Device *devicePtr,
     void (*insertProc)()));
+extern void DevScsiCLookInsert _ARGS_((List_Links *elementPtr,
+    List_Links *listHdrPtr));
+extern void DevScsiDeadlineInsert _ARGS_((List_Links *elementPtr,
+    List_Links *listHdrPtr));
+extern ReturnStatus DevScsiSchedBench _ARGS_((Fs_IOCParam *ioctlPtr));
 extern Boolean DevScsiMapClass7Sense _ARGS_((int senseLength, char *senseDataPtr, ReturnStatus *statusPtr, char *errorString));
 extern ReturnStatus DevScsiGroup0Cmd _ARGS_((ScsiDevice *devPtr, int cmd, unsigned int blockNumber, unsigned int countNumber, register ScsiCmd *scsiCmdPtr));
 
@@ -53,8 +53,32 @@
  * 	ReturnStatus releaseProc(scsiDevicePtr)
  *	   ScsiDevice	*scsiDevicePtr;   -- Handle for the device to release.
  *
+ * Field: maxTagDepth, tagDepth
+ *	HBAs that can have more than one command outstanding on a device
+ *	set both to the number of commands they can queue.  The HBA should
+ *	not take a command off the device queue while tagDepth commands
+ *	are outstanding.  Other HBAs leave them zero.
+ *
  */
 
+/*
+ * Tagged command queuing.  An HBA that has several commands outstanding
+ * on a device keeps a DevScsiTagTable for the device.  A command gets a
+ * tag when it is sent, and the tag the device returns when the command
+ * finishes finds the command again.  The device may finish the commands
+ * in any order.  Tags are handed out round robin so that a tag isn't
+ * reused right after the command that had it completes.  The HBA's lock
+ * protects the table.
+ */
+#define	DEV_SCSI_MAX_TAGS	32
+
+typedef struct DevScsiTagTable {
+    ScsiCmd	*cmdPtr[DEV_SCSI_MAX_TAGS];	/* Command holding each tag,
+						 * NIL if the tag is free. */
+    int		numActive;	/* Number of tags in use. */
+    int		nextTag;	/* Where to look for a free tag next. */
+} DevScsiTagTable;
+
 /*
  * The following definitions should all the SCSI HBA needs know about
  * the format of SCSI command blocks.  
@@ -185,6 +209,11 @@ extern int	  devScsiNumHBATypes;
 
 extern void DevScsiSenseCmd _ARGS_((ScsiDevice *scsiDevicePtr, int bufferSize,
     char *buffer, ScsiCmd *scsiCmdPtr));
+extern void DevScsiTagInit _ARGS_((DevScsiTagTable *tablePtr));
+extern int DevScsiTagAlloc _ARGS_((DevScsiTagTable *tablePtr, int depth,
+    ScsiCmd *scsiCmdPtr));
+extern ScsiCmd *DevScsiTagLookup _ARGS_((DevScsiTagTable *tablePtr, int tag));
+extern ScsiCmd *DevScsiTagFree _ARGS_((DevScsiTagTable *tablePtr, int tag));
 
 #endif /* _SCSIHBA */
 
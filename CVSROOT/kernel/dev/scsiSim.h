@@ -0,0 +1,34 @@
+/*
+ * scsiSim.h --
+ *
+ *	Declarations for the simulated SCSI HBA.  See devSCSISim.c.
+ *
+ * Copyright 1990 Regents of the University of California
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ *
+ * $Header$ SPRITE (Berkeley)
+ */
+
+#ifndef _DEVSCSISIM
+#define _DEVSCSISIM
+
+#include "scsiHBA.h"
+
+extern int devScsiSimNumTargets;
+extern int devScsiSimDiskKB;
+extern int devScsiSimMaxTags;
+extern int devScsiSimTransferMs;
+extern int devScsiSimSeekMs;
+extern int devScsiSimReorder;
+
+extern ScsiDevice   *DevScsiSimAttachDevice _ARGS_ ((Fs_Device *devicePtr,
+    void (*insertProc) _ARGS_ ((List_Links *elementPtr,
+                                List_Links *elementListHdrPtr))));
+
+#endif /* _DEVSCSISIM */
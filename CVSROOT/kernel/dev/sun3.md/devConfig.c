@@ -34,6 +34,7 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include "scsi0.h"
 #include "xylogics450.h"
 #include "jaguar.h"
+#include "scsiSim.h"
 #include "devTMR.h"
 
 /*
@@ -63,6 +64,7 @@ ScsiDevice *((*devScsiAttachProcs[]) _ARGS_((Fs_Device *devicePtr,
     DevSCSI3AttachDevice,		/* SCSI Controller type 0. */
     DevSCSI0AttachDevice,		/* SCSI Controller type 1. */
     DevJaguarAttachDevice,		/* SCSI Controller type 2. */
+    DevScsiSimAttachDevice,		/* SCSI Controller type 3. */
 };
 int devScsiNumHBATypes = sizeof(devScsiAttachProcs) / 
 			 sizeof(devScsiAttachProcs[0]);
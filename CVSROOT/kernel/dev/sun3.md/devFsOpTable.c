@@ -113,8 +113,8 @@ DevFsTypeOps devFsOpTable[] = {
      */
     {DEV_SCSI_DISK, DevRawBlockDevOpen, DevRawBlockDevRead,
 		    DevRawBlockDevWrite, DevRawBlockDevIOControl,
-		    DevRawBlockDevClose, Dev_NullSelect, DevScsiDiskAttach,
-		    DevRawBlockDevReopen, noMmapProc},
+		    DevRawBlockDevClose, DevRawBlockDevSelect,
+		    DevScsiDiskAttach, DevRawBlockDevReopen, noMmapProc},
     /*
      * SCSI Tape interface.
      */
@@ -132,7 +132,7 @@ DevFsTypeOps devFsOpTable[] = {
      */
     {DEV_XYLOGICS, DevRawBlockDevOpen, DevRawBlockDevRead,
 		    DevRawBlockDevWrite, DevRawBlockDevIOControl, 
-		    DevRawBlockDevClose, Dev_NullSelect,
+		    DevRawBlockDevClose, DevRawBlockDevSelect,
 		    DevXylogics450DiskAttach, DevRawBlockDevReopen,
                     noMmapProc},
     /*
@@ -152,14 +152,14 @@ DevFsTypeOps devFsOpTable[] = {
      */ 
     {DEV_RAID, DevRawBlockDevOpen, DevRawBlockDevRead,
                     DevRawBlockDevWrite, DevRawBlockDevIOControl,
-                    DevRawBlockDevClose, Dev_NullSelect, DevRaidAttach,
+                    DevRawBlockDevClose, DevRawBlockDevSelect, DevRaidAttach,
                     DevRawBlockDevReopen, noMmapProc},
     /*  
      * Debug device. (useful for debugging RAID device)
      */ 
     {DEV_DEBUG, DevRawBlockDevOpen, DevRawBlockDevRead,
                     DevRawBlockDevWrite, DevRawBlockDevIOControl,
-                    DevRawBlockDevClose, Dev_NullSelect, DevDebugAttach,
+                    DevRawBlockDevClose, DevRawBlockDevSelect, DevDebugAttach,
                     DevRawBlockDevReopen, noMmapProc},
     /*
      * Event devices for window systems.
@@ -262,7 +262,8 @@ static JaguarMem DebugJaguarMem;
  *			     for Jaguar DMA. We choose 32 bit normal mode
  *			     transfers with a A24 bit supervisor data address
  *			     modifier (0x3d or 0x3f).
- * MAX_CMDS_QUEUED - Maximum number of command to queue per device.
+ * MAX_CMDS_QUEUED - Maximum number of command to queue per device. The
+ *		     tagDepth of a device may lower it.
  * SELECTION_TIMEOUT - Timeout value for selecting a device in 1 millisecond
  *		       ticks. We choose 1 second timeout.
  * RESELECTION_TIMEOUT - Timeout value for a device re-selecting in 32 
@@ -1612,7 +1613,7 @@ entryAvailProc(clientData, newRequestPtr)
     Boolean	good;
 
 
-    if (devPtr->numActiveCmds >= MAX_CMDS_QUEUED) { 
+    if (devPtr->numActiveCmds >= devPtr->handle.tagDepth) { 
 	return FALSE;
     }
     devPtr->numActiveCmds++;
@@ -1652,7 +1653,7 @@ StartNextRequest(devPtr)
 {
     List_Links	*newRequest;
 
-    while (devPtr->numActiveCmds < MAX_CMDS_QUEUED) { 
+    while (devPtr->numActiveCmds < devPtr->handle.tagDepth) { 
 	newRequest = Dev_QueueGetNext(devPtr->handle.devQueue);
 	if (newRequest == (List_Links *) NIL) {
 	    break;
@@ -1858,6 +1859,8 @@ DevJaguarAttachDevice(devicePtr, insertProc)
     devPtr->handle.LUN = lun;
     devPtr->handle.releaseProc = ReleaseProc;
     devPtr->handle.maxTransferSize = DEV_MAX_DMA_SIZE;
+    devPtr->handle.maxTagDepth = MAX_CMDS_QUEUED;
+    devPtr->handle.tagDepth = MAX_CMDS_QUEUED;
 
     devPtr->bus = bus;
     devPtr->targetID = targetID;
@@ -33,6 +33,7 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include "scsi3.h"
 #include "xylogics450.h"
 #include "jaguar.h"
+#include "scsiSim.h"
 #include "devTMR.h"
 #include "devVMElink.h"
 #include "devXbus.h"
@@ -84,6 +85,7 @@ ScsiDevice *((*devScsiAttachProcs[]) _ARGS_((Fs_Device *devicePtr,
     DevSCSI3AttachDevice,		/* SCSI Controller type 0. */
     DevNoHBAAttachDevice,		/* SCSI Controller type 1. */
     DevJaguarAttachDevice,		/* SCSI Controller type 2. */
+    DevScsiSimAttachDevice,		/* SCSI Controller type 3. */
 };
 int devScsiNumHBATypes = sizeof(devScsiAttachProcs) / 
 			 sizeof(devScsiAttachProcs[0]);
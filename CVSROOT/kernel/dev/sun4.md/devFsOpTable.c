@@ -100,8 +100,8 @@ DevFsTypeOps devFsOpTable[] = {
      */
     {DEV_SCSI_DISK, DevRawBlockDevOpen, DevRawBlockDevRead,
 		    DevRawBlockDevWrite, DevRawBlockDevIOControl, 
-		    DevRawBlockDevClose, NullProc, DevScsiDiskAttach,
-		    DevRawBlockDevReopen, NullProc},
+		    DevRawBlockDevClose, DevRawBlockDevSelect,
+		    DevScsiDiskAttach, DevRawBlockDevReopen, NullProc},
     /*
      * SCSI Tape interface.
      */
@@ -119,8 +119,8 @@ DevFsTypeOps devFsOpTable[] = {
      */
     {DEV_XYLOGICS, DevRawBlockDevOpen, DevRawBlockDevRead,
 		    DevRawBlockDevWrite, DevRawBlockDevIOControl, 
-		    DevRawBlockDevClose, NullProc, DevXylogics450DiskAttach,
-		    DevRawBlockDevReopen, NullProc},
+		    DevRawBlockDevClose, DevRawBlockDevSelect,
+		    DevXylogics450DiskAttach, DevRawBlockDevReopen, NullProc},
     /*
      * Network devices.  The unit number specifies the ethernet protocol number.
      */
@@ -138,14 +138,14 @@ DevFsTypeOps devFsOpTable[] = {
      */ 
     {DEV_RAID, DevRawBlockDevOpen, DevRawBlockDevRead,
                     DevRawBlockDevWrite, DevRawBlockDevIOControl,
-                    DevRawBlockDevClose, NullProc, DevRaidAttach,
+                    DevRawBlockDevClose, DevRawBlockDevSelect, DevRaidAttach,
                     DevRawBlockDevReopen, NullProc},
     /*  
      * Debug device. (useful for debugging RAID device)
      */ 
     {DEV_DEBUG, DevRawBlockDevOpen, DevRawBlockDevRead,
                     DevRawBlockDevWrite, DevRawBlockDevIOControl,
-                    DevRawBlockDevClose, NullProc, DevDebugAttach,
+                    DevRawBlockDevClose, DevRawBlockDevSelect, DevDebugAttach,
                     DevRawBlockDevReopen, NullProc},
     /*
      * Event devices for window systems.
@@ -189,7 +189,7 @@ DevFsTypeOps devFsOpTable[] = {
      */
     {DEV_ATC, DevRawBlockDevOpen, DevRawBlockDevRead,
                     DevRawBlockDevWrite, DevRawBlockDevIOControl,
-                    DevRawBlockDevClose, NullProc, DevATCDiskAttach,
+                    DevRawBlockDevClose, DevRawBlockDevSelect, DevATCDiskAttach,
                     DevRawBlockDevReopen, NullProc},
     /*
      * The following device number is unused.
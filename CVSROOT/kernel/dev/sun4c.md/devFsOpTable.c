@@ -111,8 +111,8 @@ DevFsTypeOps devFsOpTable[] = {
      */
     {DEV_SCSI_DISK, DevRawBlockDevOpen, DevRawBlockDevRead,
 		    DevRawBlockDevWrite, DevRawBlockDevIOControl, 
-		    DevRawBlockDevClose, nullSelectProc, DevScsiDiskAttach,
-		    DevRawBlockDevReopen, noMmapProc},
+		    DevRawBlockDevClose, DevRawBlockDevSelect,
+		    DevScsiDiskAttach, DevRawBlockDevReopen, noMmapProc},
     /*
      * SCSI Tape interface.
      */
@@ -148,14 +148,14 @@ DevFsTypeOps devFsOpTable[] = {
      */ 
     {DEV_RAID, DevRawBlockDevOpen, DevRawBlockDevRead,
                     DevRawBlockDevWrite, DevRawBlockDevIOControl,
-                    DevRawBlockDevClose, Dev_NullSelect, DevRaidAttach,
+                    DevRawBlockDevClose, DevRawBlockDevSelect, DevRaidAttach,
                     DevRawBlockDevReopen, noMmapProc},
     /*  
      * Debug device. (useful for debugging RAID device)
      */ 
     {DEV_DEBUG, DevRawBlockDevOpen, DevRawBlockDevRead,
                     DevRawBlockDevWrite, DevRawBlockDevIOControl,
-                    DevRawBlockDevClose, Dev_NullSelect, DevDebugAttach,
+                    DevRawBlockDevClose, DevRawBlockDevSelect, DevDebugAttach,
                     DevRawBlockDevReopen, noMmapProc},
     /*
      * Event devices for window systems.
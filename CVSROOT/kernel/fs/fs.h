@@ -436,6 +436,9 @@ extern ReturnStatus Fs_CommandStub _ARGS_((int command, int bufSize,
 			Address buffer));
 extern ReturnStatus Fs_CreatePipeStub _ARGS_((int *inStreamIDPtr, 
 			int *outStreamIDPtr));
+extern ReturnStatus Fs_CreateEventSetStub _ARGS_((int *streamIDPtr));
+extern ReturnStatus Fs_SpliceStub _ARGS_((int inStreamID, int outStreamID,
+			int length, int *amountMovedPtr));
 extern ReturnStatus Fs_GetAttributesIDStub _ARGS_((int streamID, 
 			Fs_Attributes *attrPtr));
 extern ReturnStatus Fs_GetAttributesStub _ARGS_((char *pathName, 
@@ -517,6 +520,9 @@ extern ReturnStatus Fs_Open _ARGS_((char *name, register int useFlags,
 			int type, int permissions, Fs_Stream **streamPtrPtr));
 extern ReturnStatus Fs_Read _ARGS_((Fs_Stream *streamPtr, Address buffer, 
 			int offset, int *lenPtr));
+extern ReturnStatus Fs_ReadRanges _ARGS_((Fs_Stream *streamPtr,
+			int numRanges, struct Vm_UserRange *rangePtr,
+			int *lenPtr));
 extern ReturnStatus Fs_Remove _ARGS_((char *name));
 extern ReturnStatus Fs_RemoveDir _ARGS_((char *name));
 extern ReturnStatus Fs_Rename _ARGS_((char *pathName, char *newName));
@@ -528,6 +534,11 @@ extern ReturnStatus Fs_Trunc _ARGS_((char *pathName, int length));
 extern ReturnStatus Fs_TruncStream _ARGS_((Fs_Stream *streamPtr, int length));
 extern ReturnStatus Fs_Write _ARGS_((Fs_Stream *streamPtr, Address buffer, 
 			int offset, int *lenPtr));
+extern ReturnStatus Fs_WriteRanges _ARGS_((Fs_Stream *streamPtr,
+			int numRanges, struct Vm_UserRange *rangePtr,
+			int *lenPtr));
+extern ReturnStatus Fs_Splice _ARGS_((Fs_Stream *inStreamPtr,
+			Fs_Stream *outStreamPtr, int length, int *lenPtr));
 
 /*
  * Filesystem utility routines.
@@ -511,6 +511,11 @@ ZeroFsStats()
     fs_Stats.nameCache.accesses = 0;
     fs_Stats.nameCache.hits = 0;
     fs_Stats.nameCache.replacements = 0;
+    fs_Stats.nameCache.misses = 0;
+    fs_Stats.nameCache.negativeHits = 0;
+    fs_Stats.nameCache.negativeFlushes = 0;
+    fs_Stats.nameCache.grows = 0;
+    fs_Stats.nameCache.shrinks = 0;
     fs_Stats.object.dirFlushed = 0;
     bzero(&fs_Stats.recovery, sizeof(fs_Stats.recovery));
     bzero(&fs_Stats.consist, sizeof(fs_Stats.consist));
@@ -30,6 +30,7 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include <fsprefix.h>
 #include <fslcl.h>
 #include <devFsOpTable.h>
+#include <rawBlockDev.h>
 #include <fspdev.h>
 #include <fsStat.h>
 #include <fsconsist.h>
@@ -90,6 +91,8 @@ Boolean fsutil_Initialized = FALSE;
 
 Boolean fsDiskAttached = FALSE;
 
+static void ReleaseRangeLocks _ARGS_((Proc_ControlBlock *procPtr));
+
 
 void Fs_Init()
 {
@@ -571,6 +574,9 @@ Fs_CloseOnExec(procPtr)
  *	Note: to avoid problems when destroying a process, we have two
  *	phases of removing file system state.  Phase 0 will just close
  *	streams.  Phase 1 closes down everything.  (Phase 0 is optional.)
+ *	Phase 0 also throws away the process's unreaped raw device
+ *	requests.  It releases the process's byte-range locks too, since closing
+ *	a stream that other processes share does not.
  *
  * Results:
  *	None.
@@ -588,6 +594,10 @@ Fs_CloseState(procPtr, phase)
     register int i;
     register Fs_ProcessState *fsPtr = procPtr->fsPtr;
 
+    if (phase == 0) {
+	DevRawBlockDevProcExit(procPtr->processID);
+	ReleaseRangeLocks(procPtr);
+    }
     if (phase>0) {
 	if (fsPtr->cwdPtr != (Fs_Stream *) NIL) {
 	    (void)Fs_Close(fsPtr->cwdPtr);
@@ -618,3 +628,71 @@ Fs_CloseState(procPtr, phase)
 	procPtr->fsPtr = (Fs_ProcessState *)NIL;
     }
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseRangeLocks
+ *
+ *	Release the byte-range locks an exiting process holds on the
+ *	files it has open.  The locks belong to the process, so they
+ *	have to go even if a stream stays open in other processes.
+ *	The stream's I/O control routine is called directly because
+ *	Fs_IOControl fills in the current process, which may not be
+ *	the one exiting.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	IOC_RANGE_LOCK_UNLOCK of the whole of each open file.  Remote
+ *	files only do an RPC if the process holds a lock on them.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+ReleaseRangeLocks(procPtr)
+    Proc_ControlBlock *procPtr;		/* An exiting process */
+{
+    register Fs_ProcessState *fsPtr = procPtr->fsPtr;
+    register Fs_Stream *streamPtr;
+    register int i;
+    int streamType;
+    Fsio_RangeLockArgs lockArgs;
+    Fs_IOCParam ioctl;
+    Fs_IOReply reply;
+
+    if (fsPtr->streamList == (Fs_Stream **)NIL) {
+	return;
+    }
+    ioctl.command = IOC_RANGE_LOCK_UNLOCK;
+    ioctl.inBuffer = (Address)&lockArgs;
+    ioctl.inBufSize = sizeof(Fsio_RangeLockArgs);
+    ioctl.outBuffer = (Address) NIL;
+    ioctl.outBufSize = 0;
+    ioctl.format = mach_Format;
+    ioctl.procID = procPtr->processID;
+    ioctl.familyID = procPtr->familyID;
+    ioctl.uid = procPtr->effectiveUserID;
+    ioctl.flags = 0;
+
+    for (i=0 ; i < fsPtr->numStreams ; i++) {
+	streamPtr = fsPtr->streamList[i];
+	if (streamPtr == (Fs_Stream *)NIL) {
+	    continue;
+	}
+	streamType = streamPtr->ioHandlePtr->fileID.type;
+	if (streamType != FSIO_LCL_FILE_STREAM &&
+	    streamType != FSIO_RMT_FILE_STREAM) {
+	    continue;
+	}
+	lockArgs.flags = 0;
+	lockArgs.hostID = rpc_SpriteID;
+	lockArgs.pid = procPtr->processID;
+	lockArgs.token = 0;
+	lockArgs.offset = 0;
+	lockArgs.length = 0;
+	(void)(*fsio_StreamOpTable[streamType].ioControl)
+		(streamPtr, &ioctl, &reply);
+    }
+}
@@ -171,6 +171,20 @@ typedef	union	Fs_GetAttrResultsParam {
     } attrResults;
 } Fs_GetAttrResultsParam;
 
+/*
+ * A client that wants to cache the result of RPC_FS_GET_ATTR_PATH sends
+ * this as the request parameter instead of plain Fs_OpenArgs.  Servers
+ * that don't grant leases only look at the open arguments.  A server
+ * that does returns the length of the lease in seconds, an int, as the
+ * reply data of a successful lookup.  See fsconsistLease.c.
+ */
+typedef struct Fs_GetAttrLeaseArgs {
+    Fs_OpenArgs	openArgs;	/* MUST BE FIRST */
+    int		leaseVersion;	/* FS_LEASE_VERSION */
+} Fs_GetAttrLeaseArgs;
+
+#define	FS_LEASE_VERSION	1
+
 /*
  * FS_DOMAIN_SET_ATTR arguments.
  */
@@ -240,6 +240,15 @@ typedef struct Fs_NameCacheStats {
     unsigned int hits;			/* Number of times it was found */
     unsigned int replacements;		/* Number of entries recycled via LRU */
     unsigned int size;			/* Number of entries total */
+    unsigned int misses;		/* Number of times it wasn't found */
+    unsigned int negativeHits;		/* Number of times it was found to
+					 * be missing from the directory */
+    unsigned int negativeFlushes;	/* Negative entries removed because
+					 * the name was created */
+    unsigned int grows;			/* Number of times the table was
+					 * enlarged */
+    unsigned int shrinks;		/* Number of times it was shrunk */
+    unsigned int negative;		/* Number of negative entries */
 } Fs_NameCacheStats;
 
 /*
@@ -287,6 +296,12 @@ typedef struct Fs_PrefixStats {
     unsigned int stale;		/* Number of times server server rejected a
 				 * handle */
     unsigned int found;		/* Number of times found a new prefix */
+    unsigned int components;	/* Number of components matched in the
+				 * prefix trie */
+    unsigned int retries;	/* Number of lookups repeated because the
+				 * table changed underneath them */
+    unsigned int locked;	/* Number of lookups that gave up and took
+				 * the prefix table lock */
 } Fs_PrefixStats;
 
 /*
@@ -372,6 +387,15 @@ typedef struct Fs_WriteBackStats {
     int files;			/* Number of dirty files processed */
     int blocks;			/* Number of dirty blocks processed */
     int maxBlocks;		/* Max blocks processed in one pass */
+    int syncWaits;		/* Waits in Fscache_FileWriteBack */
+    int syncWaitMs;		/* Total milliseconds of those waits */
+    int syncMaxWaitMs;		/* Longest of those waits */
+    int preempted;		/* Background files set aside for a sync */
+    int bgFiles;		/* Background files given to a cleaner */
+    int bgAgeSecs;		/* Total age of their oldest dirty blocks */
+    int bgMaxAgeSecs;		/* Oldest of those blocks */
+    int bgBytes;		/* Bytes of background write-back */
+    int throttled;		/* Times fscacheWriteBackLimit was hit */
 } Fs_WriteBackStats;
 
 /*
@@ -474,7 +498,7 @@ typedef struct Fs_MigStats {
  * File system statistics.  If you change this struct, be sure to verify 
  * that ZeroFsStats is still okay.
  */
-#define FS_STAT_VERSION 2
+#define FS_STAT_VERSION 5
 typedef struct Fs_Stats {
     int			statsVersion;   /* Version number of statistics info */
     Fs_NameOpStats	cltName;	/* Client-side naming operations */
@@ -33,15 +33,41 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include <rpc.h>
 #include <vm.h>
 #include <fsrmt.h>
+#include <fsioLock.h>
 #include <fslcl.h>
 #include <assert.h>
 #include <machparam.h>
 #include <string.h>
+#include <stdlib.h>
 #include <fspdev.h>
+#include <fsioPipe.h>
+#include <fsioEvent.h>
 #include <recov.h>
 
 extern Boolean fsconsist_ClientCachingEnabled;
 
+/*
+ * Range reads and writes of user buffers on file streams that are at
+ * least fsPinMinBytes long pin the buffers before the I/O starts.  This
+ * takes the page faults on the buffers up front instead of one at a time
+ * while the cache blocks are locked.  Transfers bigger than fsPinMaxBytes
+ * are not pinned so that a single process can't wire down much memory.
+ */
+int fsPinMinBytes = 2 * FS_BLOCK_SIZE;
+int fsPinMaxBytes = 16 * FS_BLOCK_SIZE;
+
+/*
+ * Vector reads and writes of at most this many bytes are gathered into
+ * a kernel buffer and done as a single transfer.
+ */
+int fsGatherMaxBytes = FS_BLOCK_SIZE;
+
+static Boolean PinAllowed _ARGS_((Fs_Stream *streamPtr, int length));
+static ReturnStatus StreamRead _ARGS_((Fs_Stream *streamPtr, Address buffer,
+	int offset, int *lenPtr, int ioFlags));
+static ReturnStatus StreamWrite _ARGS_((Fs_Stream *streamPtr, Address buffer,
+	int offset, int *lenPtr, int ioFlags));
+
 
 /*
  *----------------------------------------------------------------------
@@ -74,6 +100,37 @@ Fs_Read(streamPtr, buffer, offset, lenPtr)
     int 	offset;		/* Where to start reading from. */
     int 	*lenPtr;	/* Contains number of bytes to read on input,
 				   and is filled with number of bytes read. */
+{
+    return(StreamRead(streamPtr, buffer, offset, lenPtr, streamPtr->flags));
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StreamRead --
+ *
+ *	Do the work for Fs_Read and Fs_ReadRanges.  The I/O flags are
+ *	passed in so that a vector read can go through a kernel buffer
+ *	on a user stream.
+ *
+ * Results:
+ *	A return status, SUCCESS if successful.
+ *
+ * Side effects:
+ *	See Fs_Read.
+ *
+ *----------------------------------------------------------------------
+ */
+static ReturnStatus
+StreamRead(streamPtr, buffer, offset, lenPtr, ioFlags)
+    Fs_Stream 	*streamPtr;	/* Stream to read from. */
+    Address 	buffer;		/* Where to read into. */
+    int 	offset;		/* Where to start reading from. */
+    int 	*lenPtr;	/* Contains number of bytes to read on input,
+				   and is filled with number of bytes read. */
+    int		ioFlags;	/* Flags for the I/O parameter block, normally
+				 * the stream's flags. */
 {
     register ReturnStatus 	status = SUCCESS;
     Sync_RemoteWaiter		remoteWaiter;
@@ -100,7 +157,7 @@ Fs_Read(streamPtr, buffer, offset, lenPtr)
     }
     streamType = streamPtr->ioHandlePtr->fileID.type;
 
-    FsSetIOParam(ioPtr, buffer, toRead, offset, streamPtr->flags);
+    FsSetIOParam(ioPtr, buffer, toRead, offset, ioFlags);
     reply.length = 0;
     reply.flags = 0;
     reply.signal = 0;
@@ -159,7 +216,7 @@ Fs_Read(streamPtr, buffer, offset, lenPtr)
 		     */
 		    toRead -= reply.length;
 		    FsSetIOParam(ioPtr, io.buffer + reply.length, 
-			toRead, io.offset + reply.length, streamPtr->flags);
+			toRead, io.offset + reply.length, ioFlags);
 		}
 		if (Sync_ProcWait((Sync_Lock *) NIL, TRUE)) {
 		    status = GEN_ABORTED_BY_SIGNAL;
@@ -234,6 +291,36 @@ Fs_Write(streamPtr, buffer, offset, lenPtr)
     Address buffer;			/* The buffer to fill in */
     int offset;				/* Where in the stream to write to */
     int *lenPtr;			/* In/Out byte count */
+{
+    return(StreamWrite(streamPtr, buffer, offset, lenPtr, streamPtr->flags));
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StreamWrite --
+ *
+ *	Do the work for Fs_Write and Fs_WriteRanges.  The I/O flags are
+ *	passed in so that a vector write can go through a kernel buffer
+ *	on a user stream.
+ *
+ * Results:
+ *	A return status, SUCCESS if successful.
+ *
+ * Side effects:
+ *	See Fs_Write.
+ *
+ *----------------------------------------------------------------------
+ */
+static ReturnStatus
+StreamWrite(streamPtr, buffer, offset, lenPtr, ioFlags)
+    Fs_Stream *streamPtr;		/* The stream to write to */
+    Address buffer;			/* The buffer to fill in */
+    int offset;				/* Where in the stream to write to */
+    int *lenPtr;			/* In/Out byte count */
+    int ioFlags;			/* Flags for the I/O parameter block,
+					 * normally the stream's flags. */
 {
     register ReturnStatus 	status = SUCCESS;	/* I/O return status */
     Sync_RemoteWaiter	remoteWaiter;		/* Process info for waiting */
@@ -263,7 +350,7 @@ Fs_Write(streamPtr, buffer, offset, lenPtr)
     }
     streamType = streamPtr->ioHandlePtr->fileID.type;
 
-    FsSetIOParam(ioPtr, buffer, toWrite, offset, streamPtr->flags);
+    FsSetIOParam(ioPtr, buffer, toWrite, offset, ioFlags);
     reply.length = 0;
     reply.flags = 0;
     reply.signal = 0;
@@ -348,7 +435,316 @@ Fs_Write(streamPtr, buffer, offset, lenPtr)
 
     return(status);
 }
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PinAllowed --
+ *
+ *	Decide whether the user's buffers for a range read or write
+ *	should be pinned.  Only transfers on file streams that are big
+ *	enough to be worth it are pinned.
+ *
+ * Results:
+ *	TRUE if the caller should pin the buffers.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static Boolean
+PinAllowed(streamPtr, length)
+    Fs_Stream	*streamPtr;	/* Stream the transfer is on. */
+    int		length;		/* Number of bytes in the buffers. */
+{
+    int		streamType;
+
+    if ((streamPtr->flags & FS_USER) == 0 || length < fsPinMinBytes ||
+	    length > fsPinMaxBytes ||
+	    !Fsutil_HandleValid(streamPtr->ioHandlePtr)) {
+	return(FALSE);
+    }
+    /*
+     * Only file streams are pinned.  Pipes and devices can block for an
+     * arbitrary time with the buffer still pinned.
+     */
+    streamType = streamPtr->ioHandlePtr->fileID.type;
+    if (streamType != FSIO_LCL_FILE_STREAM &&
+	    streamType != FSIO_RMT_FILE_STREAM) {
+	return(FALSE);
+    }
+    return(TRUE);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fs_ReadRanges --
+ *
+ *	Read from a stream into a list of user buffers.  A small read is
+ *	done as one transfer into a kernel buffer which is then scattered
+ *	over the user's buffers.  A big read pins all of the user's buffers
+ *	once, when that is allowed, and then reads into each in turn.
+ *
+ * Results:
+ *	A return status, SUCCESS if successful.  *lenPtr is set to the
+ *	total number of bytes read.
+ *
+ * Side effects:
+ *	The buffers are filled and the stream offset is advanced.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+Fs_ReadRanges(streamPtr, numRanges, rangePtr, lenPtr)
+    Fs_Stream		*streamPtr;	/* Stream to read from. */
+    int			numRanges;	/* Number of buffers in rangePtr. */
+    Vm_UserRange	*rangePtr;	/* The user's buffers. */
+    int			*lenPtr;	/* Returns the number of bytes read. */
+{
+    ReturnStatus	status = SUCCESS;
+    Address		gatherBuffer;
+    Boolean		pinned;
+    int			total;
+    int			amountRead;
+    int			i;
+
+    *lenPtr = 0;
+    total = 0;
+    for (i = 0; i < numRanges; i++) {
+	if (rangePtr[i].numBytes < 0) {
+	    return(GEN_INVALID_ARG);
+	}
+	total += rangePtr[i].numBytes;
+    }
+    if (numRanges > 1 && total > 0 && total <= fsGatherMaxBytes &&
+	    (streamPtr->flags & FS_USER)) {
+	gatherBuffer = (Address) malloc(total);
+	amountRead = total;
+	status = StreamRead(streamPtr, gatherBuffer, streamPtr->offset,
+			&amountRead, streamPtr->flags & ~FS_USER);
+	if (amountRead > 0 && Vm_CopyOutRanges(amountRead, gatherBuffer,
+			numRanges, rangePtr) != SUCCESS) {
+	    status = SYS_ARG_NOACCESS;
+	    amountRead = 0;
+	}
+	free((Address) gatherBuffer);
+	*lenPtr = amountRead;
+	return(status);
+    }
+
+    /*
+     * If the pin fails the transfer goes ahead anyway, so that the error
+     * is reported by the copy in the usual way.
+     */
+    pinned = FALSE;
+    if (PinAllowed(streamPtr, total)) {
+	pinned = (Vm_PinUserRanges(VM_READWRITE_ACCESS, numRanges, rangePtr)
+			== SUCCESS);
+    }
+    for (i = 0; i < numRanges; i++) {
+	amountRead = rangePtr[i].numBytes;
+	status = StreamRead(streamPtr, rangePtr[i].addr, streamPtr->offset,
+			&amountRead, streamPtr->flags);
+	*lenPtr += amountRead;
+	if (status != SUCCESS || amountRead < rangePtr[i].numBytes) {
+	    break;
+	}
+    }
+    if (pinned) {
+	Vm_UnpinUserRanges(numRanges, rangePtr);
+    }
+    return(status);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fs_WriteRanges --
+ *
+ *	Write a list of user buffers to a stream.  A small write is
+ *	gathered into a kernel buffer and done as one transfer, so it
+ *	isn't split up on pipes and devices.  A big write pins all of the
+ *	user's buffers once, when that is allowed, and then writes each in
+ *	turn.
+ *
+ * Results:
+ *	A return status, SUCCESS if successful.  *lenPtr is set to the
+ *	total number of bytes written.
+ *
+ * Side effects:
+ *	The data is written and the stream offset is advanced.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+Fs_WriteRanges(streamPtr, numRanges, rangePtr, lenPtr)
+    Fs_Stream		*streamPtr;	/* Stream to write to. */
+    int			numRanges;	/* Number of buffers in rangePtr. */
+    Vm_UserRange	*rangePtr;	/* The user's buffers. */
+    int			*lenPtr;	/* Returns the number of bytes
+					 * written. */
+{
+    ReturnStatus	status = SUCCESS;
+    Address		gatherBuffer;
+    Boolean		pinned;
+    int			total;
+    int			amountWritten;
+    int			i;
+
+    *lenPtr = 0;
+    total = 0;
+    for (i = 0; i < numRanges; i++) {
+	if (rangePtr[i].numBytes < 0) {
+	    return(GEN_INVALID_ARG);
+	}
+	total += rangePtr[i].numBytes;
+    }
+    if (numRanges > 1 && total > 0 && total <= fsGatherMaxBytes &&
+	    (streamPtr->flags & FS_USER)) {
+	gatherBuffer = (Address) malloc(total);
+	if (Vm_CopyInRanges(numRanges, rangePtr, gatherBuffer) != SUCCESS) {
+	    free((Address) gatherBuffer);
+	    return(SYS_ARG_NOACCESS);
+	}
+	amountWritten = total;
+	status = StreamWrite(streamPtr, gatherBuffer, streamPtr->offset,
+			&amountWritten, streamPtr->flags & ~FS_USER);
+	free((Address) gatherBuffer);
+	*lenPtr = amountWritten;
+	return(status);
+    }
+
+    pinned = FALSE;
+    if (PinAllowed(streamPtr, total)) {
+	pinned = (Vm_PinUserRanges(VM_READONLY_ACCESS, numRanges, rangePtr)
+			== SUCCESS);
+    }
+    for (i = 0; i < numRanges; i++) {
+	amountWritten = rangePtr[i].numBytes;
+	status = StreamWrite(streamPtr, rangePtr[i].addr, streamPtr->offset,
+			&amountWritten, streamPtr->flags);
+	*lenPtr += amountWritten;
+	if (status != SUCCESS || amountWritten < rangePtr[i].numBytes) {
+	    break;
+	}
+    }
+    if (pinned) {
+	Vm_UnpinUserRanges(numRanges, rangePtr);
+    }
+    return(status);
+}
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fs_Splice --
+ *
+ *	Move data between a local pipe and another stream without going
+ *	through a user buffer.  The other stream is read straight into,
+ *	or written straight from, the pipe's buffer one contiguous piece
+ *	at a time.  Splicing out of a pipe returns once some data has
+ *	been moved, like a read of the pipe.  Splicing into a pipe blocks
+ *	while the pipe is full, like a write, and stops at a short read
+ *	of the other stream.
+ *
+ * Results:
+ *	A return status, SUCCESS if successful.  GEN_INVALID_ARG unless
+ *	exactly one of the streams is a local pipe.  *lenPtr is set to
+ *	the number of bytes moved.
+ *
+ * Side effects:
+ *	The data is moved and the offsets of both streams are advanced.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+Fs_Splice(inStreamPtr, outStreamPtr, length, lenPtr)
+    Fs_Stream	*inStreamPtr;	/* Stream to take the data from. */
+    Fs_Stream	*outStreamPtr;	/* Stream to put the data on. */
+    int		length;		/* Maximum number of bytes to move. */
+    int		*lenPtr;	/* Returns the number of bytes moved. */
+{
+    ReturnStatus	status = SUCCESS;
+    Sync_RemoteWaiter	remoteWaiter;
+    Fs_Stream		*pipeStreamPtr;
+    Fs_Stream		*otherStreamPtr;
+    Boolean		toPipe;
+    Address		buffer;
+    int			toMove;
+    int			amountMoved;
+
+    *lenPtr = 0;
+    if (length < 0) {
+	return(GEN_INVALID_ARG);
+    }
+    if (inStreamPtr->ioHandlePtr->fileID.type == FSIO_LCL_PIPE_STREAM &&
+	outStreamPtr->ioHandlePtr->fileID.type != FSIO_LCL_PIPE_STREAM) {
+	toPipe = FALSE;
+	pipeStreamPtr = inStreamPtr;
+	otherStreamPtr = outStreamPtr;
+    } else if (outStreamPtr->ioHandlePtr->fileID.type ==
+		FSIO_LCL_PIPE_STREAM &&
+	       inStreamPtr->ioHandlePtr->fileID.type != FSIO_LCL_PIPE_STREAM) {
+	toPipe = TRUE;
+	pipeStreamPtr = outStreamPtr;
+	otherStreamPtr = inStreamPtr;
+    } else {
+	return(GEN_INVALID_ARG);
+    }
+
+    remoteWaiter.hostID = rpc_SpriteID;
+    while (*lenPtr < length) {
+	Sync_GetWaitToken(&remoteWaiter.pid, &remoteWaiter.waitToken);
+	status = Fsio_PipeSpliceBegin(pipeStreamPtr, toPipe,
+		    length - *lenPtr, &remoteWaiter, &buffer, &toMove);
+	if (status == FS_WOULD_BLOCK) {
+	    if (*lenPtr > 0 &&
+		(!toPipe || (pipeStreamPtr->flags & FS_NON_BLOCKING))) {
+		status = SUCCESS;
+		break;
+	    } else if (pipeStreamPtr->flags & FS_NON_BLOCKING) {
+		break;
+	    }
+	    if (Sync_ProcWait((Sync_Lock *) NIL, TRUE)) {
+		status = GEN_ABORTED_BY_SIGNAL;
+		break;
+	    }
+	    continue;
+	} else if (status != SUCCESS || toMove == 0) {
+	    break;
+	}
+	/*
+	 * The piece of the pipe's buffer is ours until it is given
+	 * back, so the other stream can block while using it.
+	 */
+	amountMoved = toMove;
+	if (toPipe) {
+	    status = StreamRead(otherStreamPtr, buffer,
+			otherStreamPtr->offset, &amountMoved,
+			otherStreamPtr->flags & ~FS_USER);
+	} else {
+	    status = StreamWrite(otherStreamPtr, buffer,
+			otherStreamPtr->offset, &amountMoved,
+			otherStreamPtr->flags & ~FS_USER);
+	}
+	Fsio_PipeSpliceEnd(pipeStreamPtr, toPipe, amountMoved);
+	pipeStreamPtr->offset += amountMoved;
+	*lenPtr += amountMoved;
+	if (status != SUCCESS || amountMoved < toMove) {
+	    break;
+	}
+    }
+    if (status == FS_BROKEN_PIPE && toPipe) {
+	Sig_Send(SIG_PIPE, 0, PROC_MY_PID, FALSE, (Address)0);
+    }
+    return(status);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -378,9 +774,11 @@ Fs_IOControl(streamPtr, ioctlPtr, replyPtr)
     register int		command = ioctlPtr->command;
     int				offset;
     Ioc_LockArgs		*lockArgsPtr;
+    Fsio_RangeLockArgs		*rangeArgsPtr;
     register int		streamType;
 
     lockArgsPtr = (Ioc_LockArgs *) NIL;
+    rangeArgsPtr = (Fsio_RangeLockArgs *) NIL;
     /*
      * Retry loop to handle server error recovery and blocking locks.
      */
@@ -405,7 +803,8 @@ Fs_IOControl(streamPtr, ioctlPtr, replyPtr)
 	 * on the server may not be up-to-date.  Probably fixable.)
 	 *
 	 * IOC_LOCK and IOC_UNLOCK.  We have to fill in the process and hostID
-	 * entries in the buffer passed in from the user.
+	 * entries in the buffer passed in from the user.  The same goes
+	 * for the byte-range locks.
 	 *
 	 * IOC_PREFIX.  This is processed here and not passed down to
 	 * lower levels.  This looks at the streamPtr->nameInfoPtr which
@@ -422,6 +821,16 @@ Fs_IOControl(streamPtr, ioctlPtr, replyPtr)
 	    lockArgsPtr = (Ioc_LockArgs *)ioctlPtr->inBuffer;
 	    lockArgsPtr->hostID = rpc_SpriteID;
 	    Sync_GetWaitToken(&lockArgsPtr->pid, &lockArgsPtr->token);
+	} else if (command == IOC_RANGE_LOCK_SET ||
+		   command == IOC_RANGE_LOCK_UNLOCK ||
+		   command == IOC_RANGE_LOCK_TEST) {
+	    if (ioctlPtr->inBufSize < sizeof(Fsio_RangeLockArgs)) {
+		return(GEN_INVALID_ARG);
+	    }
+	    rangeArgsPtr = (Fsio_RangeLockArgs *)ioctlPtr->inBuffer;
+	    rangeArgsPtr->flags &= ~IOC_LOCK_RECLAIM;
+	    rangeArgsPtr->hostID = rpc_SpriteID;
+	    Sync_GetWaitToken(&rangeArgsPtr->pid, &rangeArgsPtr->token);
 	} else if (command == IOC_PREFIX) {
 	    Fsprefix	*prefixPtr;
 	    if ((streamPtr->nameInfoPtr == (Fs_NameInfo *) NIL) ||
@@ -480,6 +889,25 @@ Fs_IOControl(streamPtr, ioctlPtr, replyPtr)
 			retry = TRUE;
 			break;
 		    }
+		} else if ((command == IOC_RANGE_LOCK_SET) &&
+		    ((rangeArgsPtr->flags & IOC_LOCK_NO_BLOCK) == 0)) {
+		    if (!Sync_ProcWait((Sync_Lock *) NIL, TRUE)) {
+			retry = TRUE;
+			break;
+		    }
+		    /*
+		     * Make one last try without blocking.  This takes
+		     * the process off the range wait list on the I/O
+		     * server.  If the lock is granted after all it is
+		     * kept, and the signal is taken when we return.
+		     */
+		    rangeArgsPtr->flags |= IOC_LOCK_NO_BLOCK;
+		    status = (*fsio_StreamOpTable[streamType].ioControl)
+				(streamPtr, ioctlPtr, replyPtr);
+		    if (status != SUCCESS) {
+			return(GEN_ABORTED_BY_SIGNAL);
+		    }
+		    break;
 		} else {
 		    return(status);
 		}
@@ -618,6 +1046,9 @@ Fs_IOControl(streamPtr, ioctlPtr, replyPtr)
 	 */
 	case IOC_LOCK:
 	case IOC_UNLOCK:
+	case IOC_RANGE_LOCK_SET:
+	case IOC_RANGE_LOCK_UNLOCK:
+	case IOC_RANGE_LOCK_TEST:
 	case IOC_NUM_READABLE:
 	case IOC_TRUNCATE:
 	case IOC_GET_OWNER:
@@ -679,6 +1110,11 @@ Fs_Close(streamPtr)
 	Fsutil_HandleRelease(streamPtr, TRUE);
 	return SUCCESS;
     }
+    /*
+     * Event sets don't keep the streams they watch open, so drop
+     * their interests in this one before it goes away.
+     */
+    Fsio_EventStreamClose(streamPtr);
     /*
      * Call the stream type close routine to clean up this reference
      * to the I/O handle.
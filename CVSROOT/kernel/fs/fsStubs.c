@@ -1027,11 +1027,12 @@ Fs_ReadvStub(streamID, iov, iovcnt)
     register struct iovec *iov;	/* pointer to array of iovecs. */
     int iovcnt;			/* number of  iovecs in iov. */
 {
-    int amountRead;             /* place to hold number of bytes read */
     int totalRead = 0;          /* place to hold total # of bytes read */
     int i;
-    int status = SUCCESS;
+    ReturnStatus status;
     struct iovec iovCopy[MAX_IOV];      /* Kernel copy of iov */
+    Vm_UserRange rangeArray[MAX_IOV];	/* User buffers to read into */
+    Fs_Stream *streamPtr;
     Proc_ControlBlock	*procPtr = Proc_GetEffectiveProc();
 
     if (debugFsStubs) {
@@ -1046,31 +1047,32 @@ Fs_ReadvStub(streamID, iov, iovcnt)
         Mach_SetErrno(EFAULT);
         return -1;
     }
+    status = Fs_GetStreamPtr(procPtr, streamID, &streamPtr);
+    if (status != SUCCESS) {
+	Mach_SetErrno(Compat_MapCode(status));
+	return -1;
+    }
     for (i=0; i < iovcnt; i++) {
-        amountRead = Fs_NewReadStub(streamID, iovCopy[i].iov_base,
-                iovCopy[i].iov_len);
-        if (amountRead == -1) {
-	    if (debugFsStubs) {
-		printf("Readv subread failed\n");
-	    }
-	    status = FAILURE;
-	    break;
-        }
-        totalRead += amountRead;
-	if (amountRead < iovCopy[i].iov_len) {
-	    if (debugFsStubs) {
-		printf("Readv subread didn't do it all\n");
-	    }
-	    break;
-	}
+	rangeArray[i].addr = (Address)iovCopy[i].iov_base;
+	rangeArray[i].numBytes = iovCopy[i].iov_len;
     }
+    /*
+     * Fs_ReadRanges validates all of the buffers at once and stops at
+     * the first buffer that isn't filled.
+     */
+    status = Fs_ReadRanges(streamPtr, iovcnt, rangeArray, &totalRead);
     /*
      * If we read anything, it's a success.
      */
-    if (status == FAILURE && totalRead == 0) {
+    if (status != SUCCESS && totalRead == 0) {
 	if (debugFsStubs) {
 	    printf("Readv failed\n");
 	}
+	if (status == GEN_ABORTED_BY_SIGNAL) {
+	    procPtr->unixProgress = PROC_PROGRESS_RESTART;
+	} else {
+	    Mach_SetErrno(Compat_MapCode(status));
+	}
 	return -1;
     } else {
 	if (debugFsStubs) {
@@ -1106,11 +1108,12 @@ Fs_WritevStub(streamID, iov, iovcnt)
     register struct iovec *iov;	/* pointer to array of iovecs. */
     int iovcnt;			/* number of  iovecs in iov. */
 {
-    int amountWritten;          /* place to hold number of bytes read */
     int totalWritten = 0;       /* place to hold total # of bytes written */
     int i;
-    int status = SUCCESS;
+    ReturnStatus status;
     struct iovec iovCopy[MAX_IOV];      /* Kernel copy of iov */
+    Vm_UserRange rangeArray[MAX_IOV];	/* User buffers to write from */
+    Fs_Stream *streamPtr;
     Proc_ControlBlock	*procPtr = Proc_GetEffectiveProc();
 
     if (debugFsStubs) {
@@ -1125,31 +1128,32 @@ Fs_WritevStub(streamID, iov, iovcnt)
         Mach_SetErrno(EFAULT);
         return -1;
     }
+    status = Fs_GetStreamPtr(procPtr, streamID, &streamPtr);
+    if (status != SUCCESS) {
+	Mach_SetErrno(Compat_MapCode(status));
+	return -1;
+    }
     for (i=0; i < iovcnt; i++) {
-        amountWritten = Fs_NewWriteStub(streamID, iovCopy[i].iov_base,
-                iovCopy[i].iov_len);
-        if (amountWritten == -1) {
-	    if (debugFsStubs) {
-		printf("Writev subwrite failed\n");
-	    }
-	    status = FAILURE;
-	    break;
-        }
-        totalWritten += amountWritten;
-	if (amountWritten < iovCopy[i].iov_len) {
-	    if (debugFsStubs) {
-		printf("Writev subwrite didn't do it all\n");
-	    }
-	    break;
-	}
+	rangeArray[i].addr = (Address)iovCopy[i].iov_base;
+	rangeArray[i].numBytes = iovCopy[i].iov_len;
     }
+    /*
+     * Fs_WriteRanges gathers small writes into a single transfer, so
+     * they go down a pipe or socket in one piece.
+     */
+    status = Fs_WriteRanges(streamPtr, iovcnt, rangeArray, &totalWritten);
     /*
      * If we wrote anything, it's a success.
      */
-    if (status == FAILURE && totalWritten == 0) {
+    if (status != SUCCESS && totalWritten == 0) {
 	if (debugFsStubs) {
 	    printf("Writev failed\n");
 	}
+	if (status == GEN_ABORTED_BY_SIGNAL) {
+	    procPtr->unixProgress = PROC_PROGRESS_RESTART;
+	} else {
+	    Mach_SetErrno(Compat_MapCode(status));
+	}
 	return -1;
     } else {
 	/*
@@ -28,6 +28,7 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include <fsutil.h>
 #include <fsNameOps.h>
 #include <fsio.h>
+#include <fsioEvent.h>
 #include <fslcl.h>
 #include <fsdm.h>
 #include <vm.h>
@@ -467,8 +468,9 @@ Fs_UserReadVector(streamID, numVectors, vectorPtr, amountReadPtr)
     ReturnStatus	status;
     Fs_Stream		*streamPtr;	/* The stream to read from */
     Proc_ControlBlock 	*procPtr;	/* This process's control block */
-    register int	sum = 0;	/* Total # of bytes read. */
+    int			sum = 0;	/* Total # of bytes read. */
     register int	i;
+    Vm_UserRange	*rangePtr;	/* Kernel copy of the buffers. */
 
     /*
      * Map from stream ID to file pointer and do the read.
@@ -481,21 +483,16 @@ Fs_UserReadVector(streamID, numVectors, vectorPtr, amountReadPtr)
 
     if (status == SUCCESS) {
 	/*
-	 * Doing a Fs_Read for each vector buffer is probably not the
-	 * most efficiennt way to do this, but it is simple.
+	 * Hand all of the buffers to Fs_ReadRanges at once so that they
+	 * can be validated together and small transfers gathered.
 	 */
-	for (i= 0; i < numVectors; i++, vectorPtr++) {
-
-	    status = Fs_Read(streamPtr, vectorPtr->buffer, streamPtr->offset, 
-				&(vectorPtr->bufSize));
-	    /*
-	     * Check to see if the read failed or we got an end-of-file.
-	     */
-	    if ((status != SUCCESS) || (vectorPtr->bufSize == 0)) {
-		break;
-	    }
-	    sum += vectorPtr->bufSize;
+	rangePtr = (Vm_UserRange *) malloc(numVectors * sizeof(Vm_UserRange));
+	for (i = 0; i < numVectors; i++) {
+	    rangePtr[i].addr = vectorPtr[i].buffer;
+	    rangePtr[i].numBytes = vectorPtr[i].bufSize;
 	}
+	status = Fs_ReadRanges(streamPtr, numVectors, rangePtr, &sum);
+	free((Address) rangePtr);
     }
     *amountReadPtr = sum;
     return(status);
@@ -690,8 +687,9 @@ Fs_UserWriteVector(streamID, numVectors, vectorPtr, amountWrittenPtr)
     ReturnStatus	status;
     Fs_Stream		*streamPtr;	/* The stream to write to. */
     Proc_ControlBlock 	*procPtr;	/* This process's control block. */
-    register int	sum = 0;	/* Total # of bytes written. */
+    int			sum = 0;	/* Total # of bytes written. */
     register int	i;
+    Vm_UserRange	*rangePtr;	/* Kernel copy of the buffers. */
 
     /*
      * Map from stream ID to file pointer and do the write.
@@ -704,21 +702,16 @@ Fs_UserWriteVector(streamID, numVectors, vectorPtr, amountWrittenPtr)
 
     if (status == SUCCESS) {
 	/*
-	 * Doing a Fs_Write for each vector buffer is probably not the
-	 * most efficiennt way to do this, but it is simple.
+	 * Hand all of the buffers to Fs_WriteRanges at once so that they
+	 * can be validated together and small transfers gathered.
 	 */
-	for (i= 0; i < numVectors; i++, vectorPtr++) {
-
-	    status = Fs_Write(streamPtr, vectorPtr->buffer, streamPtr->offset, 
-				&(vectorPtr->bufSize));
-	    /*
-	     * Check to see if the write failed or we got an end-of-file.
-	     */
-	    if ((status != SUCCESS) || (vectorPtr->bufSize == 0)) {
-		break;
-	    }
-	    sum += vectorPtr->bufSize;
+	rangePtr = (Vm_UserRange *) malloc(numVectors * sizeof(Vm_UserRange));
+	for (i = 0; i < numVectors; i++) {
+	    rangePtr[i].addr = vectorPtr[i].buffer;
+	    rangePtr[i].numBytes = vectorPtr[i].bufSize;
 	}
+	status = Fs_WriteRanges(streamPtr, numVectors, rangePtr, &sum);
+	free((Address) rangePtr);
     }
     *amountWrittenPtr = sum;
     return(status);
@@ -1920,3 +1913,95 @@ Fs_CreatePipeStub(inStreamIDPtr, outStreamIDPtr)
     return(SYS_ARG_NOACCESS);
 }
 
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fs_CreateEventSetStub --
+ *
+ *      This is the stub for the Fs_CreateEventSet system call.  It sets
+ *      up a stream ID for the stream returned by Fsio_CreateEventSet.
+ *	Streams are added to the set and waited on with IOC_EVENT_CTL
+ *	and IOC_EVENT_WAIT.
+ *
+ * Results:
+ *	A return status or SUCCESS if successful.
+ *
+ * Side effects:
+ *	The argument is an out parameter and gets filled in with a
+ *	stream id.  The set exists until its stream is closed.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+Fs_CreateEventSetStub(streamIDPtr)
+    int *streamIDPtr;		/* Handle that the user can use to control
+				 * and wait on the set. */
+{
+    register ReturnStatus	status;
+    Fs_Stream			*streamPtr;
+    int		 		streamID;
+
+    status = Fsio_CreateEventSet(&streamPtr);
+    if (status != SUCCESS) {
+	return(status);
+    }
+    status = Fs_GetStreamID(streamPtr, &streamID);
+    if (status != SUCCESS) {
+	(void) Fs_Close(streamPtr);
+	return(status);
+    }
+    if (Vm_CopyOut(sizeof(int), (Address) &streamID, 
+		   (Address) streamIDPtr) != SUCCESS) {
+	Fs_ClearStreamID(streamID, (Proc_ControlBlock *)NIL);
+	(void) Fs_Close(streamPtr);
+	return(SYS_ARG_NOACCESS);
+    }
+    return(SUCCESS);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fs_SpliceStub --
+ *
+ *	The Fs_Splice system call stub.  Moves up to length bytes from
+ *	one stream to another, one of which must be a local pipe,
+ *	without copying the data through the user's address space.
+ *
+ * Results:
+ *	A return status.
+ *
+ * Side effects:
+ *	*amountMovedPtr is set to the number of bytes moved.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+Fs_SpliceStub(inStreamID, outStreamID, length, amountMovedPtr)
+    int inStreamID;		/* Stream to take the data from. */
+    int outStreamID;		/* Stream to put the data on. */
+    int length;			/* Maximum number of bytes to move. */
+    int *amountMovedPtr;	/* Returns the number of bytes moved. */
+{
+    register ReturnStatus status;
+    Fs_Stream	*inStreamPtr;
+    Fs_Stream	*outStreamPtr;
+    Proc_ControlBlock *procPtr;
+    int		amountMoved = 0;
+
+    procPtr = Proc_GetEffectiveProc();
+    status = Fs_GetStreamPtr(procPtr, inStreamID, &inStreamPtr);
+    if (status == SUCCESS) {
+	status = Fs_GetStreamPtr(procPtr, outStreamID, &outStreamPtr);
+    }
+    if (status == SUCCESS) {
+	status = Fs_Splice(inStreamPtr, outStreamPtr, length, &amountMoved);
+    }
+    if (Vm_CopyOut(sizeof(int), (Address) &amountMoved, 
+		   (Address) amountMovedPtr) != SUCCESS) {
+	status = SYS_ARG_NOACCESS;
+    }
+    return(status);
+}
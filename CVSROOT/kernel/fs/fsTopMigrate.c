@@ -37,6 +37,7 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include <byte.h>
 #include <rpc.h>
 #include <procMigrate.h>
+#include <rawBlockDev.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -57,7 +58,8 @@ extern int fsio_MigDebug;
  *
  * Results:
  *	SUCCESS is returned directly; the size of the encapsulated state
- *	is returned in infoPtr->size.
+ *	is returned in infoPtr->size.  FS_FILE_BUSY if the process has
+ *	unreaped raw device requests, which can't follow it.
  *
  * Side effects:
  *	None.
@@ -83,6 +85,11 @@ Fs_InitiateMigration(procPtr, hostID, infoPtr)
 
     fsPtr = procPtr->fsPtr;
     numStreams = fsPtr->numStreams;
+    if (DevRawBlockDevProcBusy(procPtr->processID)) {
+	DEBUG(("Fs_InitiateMigration: %x has raw I/O outstanding\n",
+	       procPtr->processID));
+	return(FS_FILE_BUSY);
+    }
     /*
      * Get the prefix for the current working directory, and its size.
      * We pass the name over so it can be opened to make sure the prefix
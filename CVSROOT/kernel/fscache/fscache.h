@@ -74,6 +74,9 @@ typedef struct Fscache_FileInfo {
 				    * written in a row without requiring a 
 				    * sync of the servers cache. */
     int		   numDirtyBlocks; /* The number of dirty blocks in the cache.*/
+    int		   blocksThisPass; /* Blocks given to a block cleaner
+				    * since the file was taken off the
+				    * dirty list. */
     Sync_Condition noDirtyBlocks;  /* Notified when all write backs done. */
     int		   lastTimeTried;  /* Time that last tried to see if disk was
 				    * available for this block. */
@@ -120,6 +120,20 @@ static unsigned int filewriteBackTime;		/* Write back all blocks in
 static int	numBackendsActive;		/* Number of backend write back
 					         * processes currently active.
 				                 */
+static int	numSyncWaiters;			/* Number of processes waiting
+						 * in Fscache_FileWriteBack. */
+static int	numWriteBackPasses;		/* Number of CacheWriteBack
+						 * calls in progress.  Calls
+						 * that overlap make up one
+						 * write-back pass. */
+static int	numUnlimitedPasses;		/* How many of those are
+						 * syncing the whole cache. */
+static int	writeBackBytes;			/* Bytes of background write
+						 * back issued in this pass. */
+static unsigned int prevWriteBackTime;		/* filewriteBackTime of the
+						 * previous pass.  Files
+						 * dirtied before this are
+						 * overdue. */
 /*
  * Pointer to LRU list that is used for block allocation.
  */
@@ -212,6 +226,19 @@ static  int	minNumAvailBlocks;	/* Minimum number of cache blocks to
 
 int	fscache_MaxBlockCleaners = FSCACHE_MAX_CLEANER_PROCS;
 
+/*
+ * Background write-back issues at most fscacheWriteBackLimit bytes
+ * in each write-back pass, unless the cache is short of blocks or is
+ * being synced.  Zero means no limit.  Files that are being fsynced
+ * are not limited.  Neither are overdue files, the ones that were
+ * already due in the previous pass, so the limit holds a file back
+ * for at most one pass.  A background file that has had
+ * fscachePreemptBlocks blocks written is set aside when a process is
+ * waiting for an fsync.
+ */
+int	fscacheWriteBackLimit = 512 * FS_BLOCK_SIZE;
+int	fscachePreemptBlocks = 8;
+
 /*
  * Internal functions.
  */
@@ -238,6 +265,8 @@ static void PutBlockOnDirtyList _ARGS_((Fscache_Block *blockPtr,
 static Hash_Entry *GetUnlockedBlock _ARGS_((BlockHashKey *blockHashKeyPtr, 
 			int blockNum));
 static void DeleteBlock _ARGS_((Fscache_Block *blockPtr));
+static Boolean ShouldPreempt _ARGS_((Fscache_FileInfo *cacheInfoPtr));
+static void RecordSyncWait _ARGS_((Timer_Ticks startTicks));
 
 
 /*
@@ -382,6 +411,7 @@ Fscache_FileInfoInit(cacheInfoPtr, hdrPtr, version, cacheable, attrPtr,
     cacheInfoPtr->version = version;
     cacheInfoPtr->hdrPtr = hdrPtr;
     cacheInfoPtr->blocksWritten = 0;
+    cacheInfoPtr->blocksThisPass = 0;
     cacheInfoPtr->noDirtyBlocks.waiting = 0;
     cacheInfoPtr->blocksInCache = 0;
     cacheInfoPtr->numDirtyBlocks = 0;
@@ -1234,6 +1264,7 @@ Fscache_FileWriteBack(cacheInfoPtr, firstBlock, lastBlock, flags,
     int			     i;
     ReturnStatus	     status;
     Boolean		     fsyncFile;
+    Timer_Ticks		     startTicks;
     enum  {ENTIRE_FILE, SINGLE_BLOCK, MULTI_BLOCK_RANGE} rangeType;
 
     LOCK_MONITOR;
@@ -1370,9 +1401,13 @@ again:
     }
 
     /*
-     * Wait until all blocks are written back.
+     * Wait until all blocks are written back.  Counting ourselves in
+     * numSyncWaiters lets the block cleaners set aside background
+     * files in favor of this one.
      */
     if (flags & FSCACHE_FILE_WB_WAIT) {
+	Timer_GetCurrentTicks(&startTicks);
+	numSyncWaiters++;
 	 if ((rangeType == SINGLE_BLOCK) && fsyncFile) {
 	    while ((blockPtr->flags & 
 		(FSCACHE_BLOCK_DIRTY|FSCACHE_BLOCK_BEING_WRITTEN)) && 
@@ -1392,6 +1427,10 @@ again:
 		(void) Sync_Wait(&cacheInfoPtr->noDirtyBlocks, FALSE);
 	    }
 	}
+	numSyncWaiters--;
+	if (fsyncFile) {
+	    RecordSyncWait(startTicks);
+	}
     }
 
     switch (cacheInfoPtr->flags&(FSCACHE_SERVER_DOWN|FSCACHE_NO_DISK_SPACE|
@@ -1698,15 +1737,41 @@ CacheWriteBack(writeBackTime, blocksSkippedPtr, writeTmpFiles)
     register Fscache_FileInfo	*cacheInfoPtr;
     int				currentTime;
     Fscache_Backend		*backendPtr;
+    Boolean			unlimited;
 
     currentTime = Fsutil_TimeInSeconds();
 
     *blocksSkippedPtr = 0;
+    unlimited = (writeBackTime == (unsigned int) -1) || writeTmpFiles;
+    if (numWriteBackPasses == 0) {
+	/*
+	 * Start a new pass, and a new interval for the limit on
+	 * background write-back.
+	 */
+	writeBackBytes = 0;
+	if (filewriteBackTime != (unsigned int) -1) {
+	    prevWriteBackTime = filewriteBackTime;
+	}
+	filewriteBackTime = writeBackTime;
+    } else if (writeBackTime > filewriteBackTime) {
+	/*
+	 * Join the pass in progress.  This can only widen it, so a
+	 * periodic write-back doesn't cut short a sync that is waiting
+	 * for the whole cache.
+	 */
+	filewriteBackTime = writeBackTime;
+    }
+    numWriteBackPasses++;
+    if (unlimited) {
+	/*
+	 * Syncing the whole cache is not limited.
+	 */
+	numUnlimitedPasses++;
+    }
     /*
      * Look thru all the cache backend`s dirty list for files to 
      * writeback.
      */
-    filewriteBackTime = writeBackTime;
     LIST_FORALL(backendList, (List_Links *) backendPtr) {
 	LIST_FORALL(&backendPtr->dirtyListHdr, (List_Links *) cacheInfoPtr) { 
 	    /*
@@ -1750,6 +1815,10 @@ CacheWriteBack(writeBackTime, blocksSkippedPtr, writeTmpFiles)
     while ((numBackendsActive > 0) && !sys_ShuttingDown) {
 	(void) Sync_Wait(&writeBackComplete, FALSE);
     }
+    numWriteBackPasses--;
+    if (unlimited) {
+	numUnlimitedPasses--;
+    }
 }
 
 
@@ -2266,6 +2335,16 @@ Fscache_GetDirtyBlock(cacheInfoPtr, blockMatchProc, clientData,
 	UNLOCK_MONITOR;
 	return (Fscache_Block *) NIL;
     }
+    if (ShouldPreempt(cacheInfoPtr)) {
+	/*
+	 * Someone is waiting for an fsync of another file.  Returning
+	 * no block makes the backend give this file back, and the
+	 * fsynced file is at the front of the dirty list.
+	 */
+	fs_Stats.writeBack.preempted++;
+	UNLOCK_MONITOR;
+	return (Fscache_Block *) NIL;
+    }
 
     LIST_FORALL(&cacheInfoPtr->dirtyList, dirtyPtr) {
 	blockPtr = DIRTY_LINKS_TO_BLOCK(dirtyPtr);
@@ -2325,6 +2404,11 @@ Fscache_GetDirtyBlock(cacheInfoPtr, blockMatchProc, clientData,
 	if (blockPtr->blockSize < 0) {
 	    panic( "Fscache_GetDirtyBlock: uninitialized block size\n");
 	}
+	cacheInfoPtr->blocksThisPass++;
+	if (!(cacheInfoPtr->flags & FSCACHE_FILE_FSYNC)) {
+	    writeBackBytes += blockPtr->blockSize;
+	    fs_Stats.writeBack.bgBytes += blockPtr->blockSize;
+	}
 	*lastDirtyBlockPtr = List_IsEmpty(&cacheInfoPtr->dirtyList);
 	UNLOCK_MONITOR;
 	return blockPtr;
@@ -2561,6 +2645,19 @@ Fscache_GetDirtyFile(backendPtr, fsyncOnly, fileMatchProc, clientData)
 		    (cacheInfoPtr->oldestDirtyBlockTime < filewriteBackTime))) {
 	    break;
 	}
+	if ((numAvailBlocks > minNumAvailBlocks) && fsyncOnly &&
+		!(cacheInfoPtr->flags & FSCACHE_FILE_FSYNC) &&
+		(cacheInfoPtr->oldestDirtyBlockTime >= prevWriteBackTime) &&
+		(numUnlimitedPasses == 0) && (fscacheWriteBackLimit > 0) &&
+		(writeBackBytes >= fscacheWriteBackLimit)) {
+	    /*
+	     * Background write-back has used up this pass.  This file
+	     * only became due in this pass, and the files behind it
+	     * are neither fsynced nor older.
+	     */
+	    fs_Stats.writeBack.throttled++;
+	    break;
+	}
 	/*
 	 * Check to make sure that if dirty blocks exist then at least one 
 	 * of the blocks is available to write.
@@ -2583,7 +2680,18 @@ Fscache_GetDirtyFile(backendPtr, fsyncOnly, fileMatchProc, clientData)
 
 	cacheInfoPtr->flags |= FSCACHE_FILE_BEING_WRITTEN;
 	cacheInfoPtr->flags &= ~FSCACHE_FILE_ON_DIRTY_LIST;
+	cacheInfoPtr->blocksThisPass = 0;
 	List_Remove((List_Links *)cacheInfoPtr);
+	if (!(cacheInfoPtr->flags & FSCACHE_FILE_FSYNC)) {
+	    int age;
+
+	    age = Fsutil_TimeInSeconds() - cacheInfoPtr->oldestDirtyBlockTime;
+	    fs_Stats.writeBack.bgFiles++;
+	    fs_Stats.writeBack.bgAgeSecs += age;
+	    if (age > fs_Stats.writeBack.bgMaxAgeSecs) {
+		fs_Stats.writeBack.bgMaxAgeSecs = age;
+	    }
+	}
 	UNLOCK_MONITOR;
 	return cacheInfoPtr;
     }
@@ -2642,6 +2750,79 @@ Fscache_ReturnDirtyFile(cacheInfoPtr, onFront)
     return;
 }
 
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * ShouldPreempt --
+ *
+ *	Decide whether a block cleaner should stop writing a background
+ *	file so it can get to a file that a process is waiting to have
+ *	synced.  The background file gets fscachePreemptBlocks blocks
+ *	written each time it is taken off the dirty list, so it still
+ *	makes progress if the synced file can't be written.
+ *
+ * Results:
+ *	TRUE if the cleaner should give the file back.
+ *
+ * Side effects:
+ *	None.
+ *
+ * ----------------------------------------------------------------------------
+ */
+INTERNAL static Boolean
+ShouldPreempt(cacheInfoPtr)
+    register Fscache_FileInfo	*cacheInfoPtr;	/* File being written. */
+{
+    register List_Links	*dirtyList;
+
+    if ((numSyncWaiters == 0) ||
+	(cacheInfoPtr->flags & FSCACHE_FILE_FSYNC) ||
+	(cacheInfoPtr->blocksThisPass < fscachePreemptBlocks)) {
+	return(FALSE);
+    }
+    dirtyList = &cacheInfoPtr->backendPtr->dirtyListHdr;
+    if (List_IsEmpty(dirtyList)) {
+	return(FALSE);
+    }
+    return((((Fscache_FileInfo *) List_First(dirtyList))->flags &
+	    FSCACHE_FILE_FSYNC) != 0);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * RecordSyncWait --
+ *
+ *	Add the time a process spent waiting in Fscache_FileWriteBack
+ *	to the write-back statistics.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Updates fs_Stats.writeBack.
+ *
+ * ----------------------------------------------------------------------------
+ */
+INTERNAL static void
+RecordSyncWait(startTicks)
+    Timer_Ticks	startTicks;	/* When the wait began. */
+{
+    Timer_Ticks	endTicks;
+    Time	time;
+    int		ms;
+
+    Timer_GetCurrentTicks(&endTicks);
+    Timer_SubtractTicks(endTicks, startTicks, &endTicks);
+    Timer_TicksToTime(endTicks, &time);
+    ms = (time.seconds * 1000) + (time.microseconds / 1000);
+    fs_Stats.writeBack.syncWaits++;
+    fs_Stats.writeBack.syncWaitMs += ms;
+    if (ms > fs_Stats.writeBack.syncMaxWaitMs) {
+	fs_Stats.writeBack.syncMaxWaitMs = ms;
+    }
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -3234,8 +3415,28 @@ PutFileOnDirtyList(cacheInfoPtr, oldestDirtyBlockTime)
     dirtyList = &cacheInfoPtr->backendPtr->dirtyListHdr;
     if (!(cacheInfoPtr->flags & 
 	(FSCACHE_FILE_ON_DIRTY_LIST|FSCACHE_FILE_BEING_WRITTEN))) {
-        List_Insert((List_Links *)cacheInfoPtr, LIST_ATREAR(dirtyList));
-	if (cacheInfoPtr->flags & FSCACHE_FILE_FSYNC) {
+	if (!(cacheInfoPtr->flags & FSCACHE_FILE_FSYNC)) {
+	    /*
+	     * Files that aren't being synced follow the synced ones in
+	     * order of their oldest dirty block, so the write-back code
+	     * can stop at the first file that isn't due.  Search from
+	     * the rear because most files have just been dirtied.
+	     */
+	    place = dirtyList;
+	    for (linkPtr = List_Last(dirtyList);
+		 !List_IsAtEnd(dirtyList, linkPtr);
+		 linkPtr = List_Prev(linkPtr)) {
+		if ((((Fscache_FileInfo *) linkPtr)->flags &
+					FSCACHE_FILE_FSYNC) ||
+		    (((Fscache_FileInfo *) linkPtr)->oldestDirtyBlockTime <=
+					oldestDirtyBlockTime)) {
+		    break;
+		}
+		place = linkPtr;
+	    }
+	    List_Insert((List_Links *)cacheInfoPtr, LIST_BEFORE(place));
+	} else {
+	    List_Insert((List_Links *)cacheInfoPtr, LIST_ATREAR(dirtyList));
 	    /*
 	     * Move down the list until we reach the file or the first non
 	     * synced file. 
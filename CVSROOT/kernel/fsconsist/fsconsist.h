@@ -42,6 +42,10 @@
  *				separate clients tried to read the named pipe
  *				at the same time.
  *	FSCONSIST_WRITE_BACK_ATTRS	Write back the cached attributes.
+ *	FSCONSIST_REVOKE_LEASE	Drop cached names and attributes of the
+ *				file.  See fsconsistLease.c.
+ *	FSCONSIST_REVOKE_NAMES	With FSCONSIST_REVOKE_LEASE, drop all the
+ *				names cached from the server.
  *	FSCONSIST_MIGRATION	Consistency operation is due to migration
  *				(for statistics purposes).
  */
@@ -51,6 +55,8 @@
 #define	FSCONSIST_DELETE_FILE			0x04
 #define	FSCONSIST_CANT_CACHE_NAMED_PIPE		0x08
 #define	FSCONSIST_WRITE_BACK_ATTRS		0x10
+#define	FSCONSIST_REVOKE_LEASE			0x20
+#define	FSCONSIST_REVOKE_NAMES			0x40
 #define	FSCONSIST_MIGRATION			0x200
 
 /*
@@ -207,6 +213,26 @@ extern ReturnStatus Fsconsist_RpcConsistReply _ARGS_((ClientData srvToken,
 			int clientID, int command, Rpc_Storage *storagePtr));
 
 extern int Fsconsist_NumClients _ARGS_((Fsconsist_Info *consistPtr));
+extern Boolean Fsconsist_AttrsStable _ARGS_((Fsconsist_Info *consistPtr,
+			int clientID));
+extern ReturnStatus Fsconsist_LeaseCallback _ARGS_((int clientID,
+			Fs_FileID *fileIDPtr, Boolean allNames));
+
+/*
+ * Name and attribute leases.
+ */
+extern Boolean fsconsist_Debug;
+extern int fsconsist_LeaseSeconds;
+extern int fsconsist_MaxLeaseFiles;
+
+extern int Fsconsist_LeaseStamp _ARGS_((void));
+extern int Fsconsist_GrantLease _ARGS_((Fs_FileID *fileIDPtr, int clientID,
+			int stamp));
+extern void Fsconsist_RevokeLeases _ARGS_((Fs_FileID *fileIDPtr,
+			Boolean allNames));
+extern void Fsconsist_CollectLeases _ARGS_((Fs_FileID *fileIDPtr,
+			Boolean allNames, List_Links *revokeList));
+extern void Fsconsist_RevokeCollected _ARGS_((List_Links *revokeList));
 
 extern void Fsconsist_AddClient _ARGS_((int clientID));
 
@@ -310,6 +310,13 @@ Fsconsist_FileConsistency(handlePtr, clientID, useFlags, cacheablePtr,
      */
     status = EndConsistency(consistPtr);
     UNLOCK_MONITOR;
+    if (useFlags & FS_WRITE) {
+	/*
+	 * Clients can't keep caching the attributes of a file
+	 * that is being written.
+	 */
+	Fsconsist_RevokeLeases(&handlePtr->hdr.fileID, FALSE);
+    }
     return(status);
 }
 
@@ -1542,13 +1549,13 @@ Fsconsist_GetAllDirtyBlocks(domain, invalidate)
     Boolean	invalidate;	/* Remove file from cache after getting blocks
 				 * back. */
 {
-    Hash_Search				hashSearch;
+    Fsutil_HandleSearch			handleSearch;
     register	Fs_HandleHeader		*hdrPtr;
 
-    Hash_StartSearch(&hashSearch);
-    for (hdrPtr = Fsutil_GetNextHandle(&hashSearch);
+    Fsutil_StartHandleSearch(&handleSearch);
+    for (hdrPtr = Fsutil_GetNextHandle(&handleSearch);
 	 hdrPtr != (Fs_HandleHeader *) NIL;
-         hdrPtr = Fsutil_GetNextHandle(&hashSearch)) {
+         hdrPtr = Fsutil_GetNextHandle(&handleSearch)) {
 	if (hdrPtr->fileID.type == FSIO_LCL_FILE_STREAM &&
 	    hdrPtr->fileID.major == domain) {
 	    register Fsio_FileIOHandle *handlePtr =
@@ -1828,6 +1835,99 @@ ClientCommand(consistPtr, clientPtr, flags)
     LOCK_MONITOR;
 }
 
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * Fsconsist_AttrsStable --
+ *
+ *	Check that no client other than the given one can be changing
+ *	the attributes of a file behind the server's back.  This is
+ *	used to decide whether to grant an attribute lease.
+ *
+ * Results:
+ *	TRUE if no other client is writing the file or has dirty blocks
+ *	for it, and no consistency action is under way.
+ *
+ * Side effects:
+ *	None.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ENTRY Boolean
+Fsconsist_AttrsStable(consistPtr, clientID)
+    register Fsconsist_Info *consistPtr;	/* Consistency state of file */
+    int			clientID;	/* Client asking for a lease */
+{
+    register Fsconsist_ClientInfo	*clientPtr;
+    Boolean				stable = TRUE;
+
+    LOCK_MONITOR;
+    if (consistPtr->flags & FS_CONSIST_IN_PROGRESS) {
+	stable = FALSE;
+    } else if (consistPtr->lastWriter != -1 &&
+	       consistPtr->lastWriter != clientID &&
+	       consistPtr->lastWriter != rpc_SpriteID) {
+	stable = FALSE;
+    } else {
+	LIST_FORALL(&consistPtr->clientList, (List_Links *)clientPtr) {
+	    if (clientPtr->use.write > 0 && clientPtr->clientID != clientID) {
+		stable = FALSE;
+		break;
+	    }
+	}
+    }
+    UNLOCK_MONITOR;
+    return(stable);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * Fsconsist_LeaseCallback --
+ *
+ *	Tell a client to drop the names and attributes it has cached
+ *	for a file, or all the names it has cached from us.  This uses
+ *	the RPC_FS_CONSIST call-back, but unlike ClientCommand there is
+ *	no reply phase and no per-file state is involved.
+ *
+ * Results:
+ *	The status from the RPC.
+ *
+ * Side effects:
+ *	RPC_FS_CONSIST to the client.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ReturnStatus
+Fsconsist_LeaseCallback(clientID, fileIDPtr, allNames)
+    int		clientID;	/* Client holding the lease */
+    Fs_FileID	*fileIDPtr;	/* Client's fileID for the file */
+    Boolean	allNames;	/* TRUE to drop every cached name */
+{
+    Rpc_Storage		storage;
+    ConsistMsg		consistRpc;
+
+    consistRpc.fileID = *fileIDPtr;
+    consistRpc.flags = FSCONSIST_REVOKE_LEASE;
+    if (allNames) {
+	consistRpc.flags |= FSCONSIST_REVOKE_NAMES;
+    }
+    consistRpc.openTimeStamp = 0;
+    consistRpc.version = 0;
+
+    storage.requestParamPtr = (Address) &consistRpc;
+    storage.requestParamSize = sizeof(ConsistMsg);
+    storage.requestDataPtr = (Address) NIL;
+    storage.requestDataSize = 0;
+
+    storage.replyParamPtr = (Address) NIL;
+    storage.replyParamSize = 0;
+    storage.replyDataPtr = (Address) NIL;
+    storage.replyDataSize = 0;
+
+    return(Rpc_Call(clientID, RPC_FS_CONSIST, &storage));
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1869,6 +1969,21 @@ Fsconsist_RpcConsist(srvToken, clientID, command, storagePtr)
     register ReturnStatus	status;
 
     consistArgPtr = (ConsistMsg *)storagePtr->requestParamPtr;
+    if (consistArgPtr->flags & FSCONSIST_REVOKE_LEASE) {
+	/*
+	 * Lease revocations can be for files we don't have open, so
+	 * they are handled here instead of by ProcessConsist and there
+	 * is no consistency reply.
+	 */
+	if (consistArgPtr->flags & FSCONSIST_REVOKE_NAMES) {
+	    Fsrmt_NameCacheRevoke(clientID, (Fs_FileID *)NIL);
+	} else {
+	    Fsrmt_NameCacheRevoke(clientID, &consistArgPtr->fileID);
+	}
+	Rpc_Reply(srvToken, SUCCESS, storagePtr, (int(*)())NIL,
+		(ClientData)NIL);
+	return(SUCCESS);
+    }
     if (consistArgPtr->fileID.type != FSIO_RMT_FILE_STREAM) {
 	printf("Fsconsist_RpcConsist bad fileID <%d,%d,%d,%d> from client %d\n",
 		    consistArgPtr->fileID.type, consistArgPtr->fileID.serverID,
@@ -2285,6 +2400,12 @@ ConsistType(flags)
     case FSCONSIST_WRITE_BACK_ATTRS:
 	result = "return-attrs";
 	break;
+    case FSCONSIST_REVOKE_LEASE:
+	result = "revoke-lease";
+	break;
+    case (FSCONSIST_REVOKE_LEASE|FSCONSIST_REVOKE_NAMES):
+	result = "revoke-names";
+	break;
     default:
 	result = "UNKNOWN";
 	break;
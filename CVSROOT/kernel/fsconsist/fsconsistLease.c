@@ -0,0 +1,700 @@
+/*
+ * fsconsistLease.c --
+ *
+ *	Name and attribute leases for remote clients.  A client that gets
+ *	the attributes of a file by pathname (RPC_FS_GET_ATTR_PATH) is
+ *	granted a short lease that lets it answer later lookups and stats
+ *	of the same name from its own cache (see fsrmtNameCache.c).  The
+ *	server remembers who holds leases on each file.  When the file's
+ *	attributes or names change the leases are revoked with an
+ *	RPC_FS_CONSIST call-back that carries FSCONSIST_REVOKE_LEASE.
+ *	Only clients that ask for a lease get one, so older clients
+ *	never see the lease reply or the revocation.
+ *
+ *	Lease state is soft.  It is kept in a table of its own, not in
+ *	the file handle, so that it is not lost when handles are
+ *	scavenged.  If a revocation can't be delivered the holder is kept
+ *	in the table, marked revoked, and nobody gets a new lease on the
+ *	file until the old one runs out.  If the server reboots the
+ *	client's copy runs out on its own.  Files open for writing are
+ *	not leased because their attributes are changing in the writer's
+ *	cache.
+ *
+ *	The call-backs are made by a Proc_CallFunc process, so the RPC
+ *	server process doing the change never waits for them.  Directory
+ *	operations take the leases out of the table while they have the
+ *	handles locked, with Fsconsist_CollectLeases, and hand them to
+ *	the call-back process with Fsconsist_RevokeCollected.
+ *
+ * Copyright 1991 Regents of the University of California
+ * All rights reserved.
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ */
+
+#ifndef lint
+static char rcsid[] = "$Header$ SPRITE (Berkeley)";
+#endif not lint
+
+
+#include <sprite.h>
+#include <fs.h>
+#include <fsutil.h>
+#include <fsio.h>
+#include <fsconsist.h>
+#include <list.h>
+#include <net.h>
+#include <rpc.h>
+#include <recov.h>
+#include <proc.h>
+#include <timer.h>
+#include <stdlib.h>
+
+#include <stdio.h>
+
+static Sync_Lock leaseLock = Sync_LockInitStatic("Fs:leaseLock");
+#define	LOCKPTR	(&leaseLock)
+
+/*
+ * Length of a lease in seconds.  Zero turns off leasing.  Clients
+ * start timing a lease before they send their request, and the
+ * server's record gets an extra second, so the server always
+ * remembers a lease at least as long as the client uses it.
+ */
+int fsconsist_LeaseSeconds = 10;
+
+/*
+ * Upper bound on the number of files with lease records.  When the
+ * table fills up the expired records are swept out, and if it is still
+ * full no more leases are granted until some run out.
+ */
+int fsconsist_MaxLeaseFiles = 1024;
+
+#define	LEASE_HASH_SIZE	64
+#define	LEASE_HASH(fileIDPtr) \
+	(((fileIDPtr)->major + (fileIDPtr)->minor) & (LEASE_HASH_SIZE - 1))
+
+/*
+ * A client holding a lease on a file.  The fileID and allNames fields
+ * are set when the lease is taken out of the table to be revoked.
+ */
+typedef struct LeaseHolder {
+    List_Links	links;
+    int		clientID;
+    int		expires;	/* Server time when the lease runs out */
+    Fs_FileID	fileID;		/* Client's fileID for the file */
+    Boolean	allNames;	/* TRUE to flush all of the client's names */
+    Boolean	revoked;	/* TRUE if the call-back failed.  The record
+				 * stays until the lease runs out, and no
+				 * new lease is granted on the file. */
+} LeaseHolder;
+
+/*
+ * A file with outstanding leases.
+ */
+typedef struct LeaseFile {
+    List_Links	links;		/* Hash chain */
+    int		major;		/* Domain of the file */
+    int		minor;		/* File number within the domain */
+    List_Links	holderList;	/* LeaseHolder records */
+} LeaseFile;
+
+static Boolean		leaseInit = FALSE;
+static List_Links	leaseHashTable[LEASE_HASH_SIZE];
+static int		numLeaseFiles = 0;
+
+/*
+ * The latest lease expiration of each client.  This finds everyone who
+ * has to flush their names when a directory is renamed.
+ */
+static int		clientExpires[NET_NUM_SPRITE_HOSTS];
+
+/*
+ * Incremented on every revocation.  A grant is refused if a revocation
+ * happened while the client's attributes were being looked up, because
+ * they might be the old ones.
+ */
+static int		leaseStamp = 0;
+
+/*
+ * Holders waiting for RevokeProc to call them back.
+ */
+static List_Links	revokePendingList;
+static Boolean		revokeScheduled = FALSE;
+
+static LeaseFile *LeaseFind _ARGS_((Fs_FileID *fileIDPtr, Boolean create));
+static void LeaseFileFree _ARGS_((LeaseFile *filePtr));
+static void LeaseSweep _ARGS_((int now, Boolean all));
+static int LeaseAdd _ARGS_((Fs_FileID *fileIDPtr, int clientID, int stamp));
+static void RevokeProc _ARGS_((ClientData data, Proc_CallInfo *callInfoPtr));
+static Boolean RevokeNext _ARGS_((List_Links *revokeList));
+static void RevokeFailed _ARGS_((LeaseHolder *holderPtr));
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * Fsconsist_LeaseStamp --
+ *
+ *	Return the current revocation stamp.  This is taken before the
+ *	attributes of a file are looked up and handed back to
+ *	Fsconsist_GrantLease.
+ *
+ * Results:
+ *	The revocation stamp.
+ *
+ * Side effects:
+ *	None.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ENTRY int
+Fsconsist_LeaseStamp()
+{
+    int stamp;
+
+    LOCK_MONITOR;
+    stamp = leaseStamp;
+    UNLOCK_MONITOR;
+    return(stamp);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * Fsconsist_GrantLease --
+ *
+ *	Decide whether a client may cache the name and attributes of
+ *	a file it just looked up, and if so record the lease.  Only
+ *	regular files, directories and links are leased, and only
+ *	while nobody else is writing them.
+ *
+ * Results:
+ *	The length of the lease in seconds, or zero if none is granted.
+ *
+ * Side effects:
+ *	A lease record is added for the client.
+ *
+ * ----------------------------------------------------------------------------
+ */
+int
+Fsconsist_GrantLease(fileIDPtr, clientID, stamp)
+    Fs_FileID	*fileIDPtr;	/* I/O fileID returned to the client */
+    int		clientID;	/* Client doing the lookup */
+    int		stamp;		/* From Fsconsist_LeaseStamp */
+{
+    Fs_FileID		fileID;
+    Fsio_FileIOHandle	*handlePtr;
+    Boolean		stable;
+
+    if (fsconsist_LeaseSeconds <= 0 ||
+	fileIDPtr->type != FSIO_RMT_FILE_STREAM ||
+	clientID == rpc_SpriteID ||
+	clientID <= 0 || clientID >= NET_NUM_SPRITE_HOSTS) {
+	return(0);
+    }
+    fileID = *fileIDPtr;
+    fileID.type = FSIO_LCL_FILE_STREAM;
+    handlePtr = Fsutil_HandleFetchType(Fsio_FileIOHandle, &fileID);
+    if (handlePtr == (Fsio_FileIOHandle *)NIL) {
+	return(0);
+    }
+    stable = Fsconsist_AttrsStable(&handlePtr->consist, clientID);
+    Fsutil_HandleRelease(handlePtr, TRUE);
+    if (!stable) {
+	return(0);
+    }
+    return(LeaseAdd(&fileID, clientID, stamp));
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * Fsconsist_RevokeLeases --
+ *
+ *	Revoke the leases on a file whose attributes or names have
+ *	changed.  This should be called after the change has been made.
+ *	See Fsconsist_CollectLeases for the meaning of allNames.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Schedules RPC_FS_CONSIST call-backs to the lease holders.
+ *
+ * ----------------------------------------------------------------------------
+ */
+void
+Fsconsist_RevokeLeases(fileIDPtr, allNames)
+    Fs_FileID	*fileIDPtr;	/* File that has changed */
+    Boolean	allNames;	/* TRUE to flush all of the clients' names */
+{
+    List_Links	revokeList;
+
+    List_Init(&revokeList);
+    Fsconsist_CollectLeases(fileIDPtr, allNames, &revokeList);
+    Fsconsist_RevokeCollected(&revokeList);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * Fsconsist_RevokeCollected --
+ *
+ *	Hand the leases taken out of the table by Fsconsist_CollectLeases
+ *	to RevokeProc, which makes the call-backs.  This doesn't wait for
+ *	them, so it is fine to call from an RPC server process.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Empties revokeList and schedules RevokeProc.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ENTRY void
+Fsconsist_RevokeCollected(revokeList)
+    List_Links	*revokeList;	/* From Fsconsist_CollectLeases */
+{
+    LOCK_MONITOR;
+    while (!List_IsEmpty(revokeList)) {
+	List_Move(List_First(revokeList), LIST_ATREAR(&revokePendingList));
+    }
+    if (!revokeScheduled && !List_IsEmpty(&revokePendingList)) {
+	revokeScheduled = TRUE;
+	Proc_CallFunc(RevokeProc, (ClientData)NIL, 0);
+    }
+    UNLOCK_MONITOR;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * RevokeProc --
+ *
+ *	Called via Proc_CallFunc to make the call-backs for revoked
+ *	leases.  A client that is down, or that doesn't answer, may still
+ *	be using its lease, so its record goes back in the table marked
+ *	revoked until the lease runs out.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	RPC_FS_CONSIST call-backs to the lease holders, which are freed
+ *	unless the call-back failed.
+ *
+ * ----------------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static void
+RevokeProc(data, callInfoPtr)
+    ClientData		data;		/* Not used */
+    Proc_CallInfo	*callInfoPtr;
+{
+    register LeaseHolder	*holderPtr;
+    List_Links			revokeList;
+    ReturnStatus		status;
+
+    List_Init(&revokeList);
+    while (RevokeNext(&revokeList)) {
+	while (!List_IsEmpty(&revokeList)) {
+	    holderPtr = (LeaseHolder *)List_First(&revokeList);
+	    List_Remove((List_Links *)holderPtr);
+	    /*
+	     * Earlier call-backs may have taken long enough for this
+	     * lease to run out, in which case there is nothing to do.
+	     */
+	    if (holderPtr->expires <= Fsutil_TimeInSeconds()) {
+		free((Address)holderPtr);
+		continue;
+	    }
+	    if (Recov_IsHostDown(holderPtr->clientID) == FAILURE) {
+		status = RPC_TIMEOUT;
+	    } else {
+		status = Fsconsist_LeaseCallback(holderPtr->clientID,
+				&holderPtr->fileID, holderPtr->allNames);
+	    }
+	    if (status != SUCCESS) {
+		if (fsconsist_Debug) {
+		    printf("Fsconsist_RevokeLeases: <%d,%d> client %d: %x\n",
+			holderPtr->fileID.major, holderPtr->fileID.minor,
+			holderPtr->clientID, status);
+		}
+		RevokeFailed(holderPtr);
+	    } else {
+		free((Address)holderPtr);
+	    }
+	}
+    }
+    callInfoPtr->interval = 0;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * RevokeNext --
+ *
+ *	Take the holders waiting to be called back.  If there are none
+ *	the call-back process is done.
+ *
+ * Results:
+ *	TRUE if any holders were moved to revokeList.
+ *
+ * Side effects:
+ *	Empties the pending list, or clears revokeScheduled.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ENTRY static Boolean
+RevokeNext(revokeList)
+    List_Links	*revokeList;	/* Empty list to take the holders */
+{
+    Boolean	found;
+
+    LOCK_MONITOR;
+    found = !List_IsEmpty(&revokePendingList);
+    while (!List_IsEmpty(&revokePendingList)) {
+	List_Move(List_First(&revokePendingList), LIST_ATREAR(revokeList));
+    }
+    if (!found) {
+	revokeScheduled = FALSE;
+    }
+    UNLOCK_MONITOR;
+    return(found);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * RevokeFailed --
+ *
+ *	Put back a holder that couldn't be called back.  It is marked
+ *	revoked so that the file gets no new leases until it runs out.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The holder goes back on the file's lease record.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ENTRY static void
+RevokeFailed(holderPtr)
+    register LeaseHolder	*holderPtr;	/* Holder that didn't answer */
+{
+    register LeaseFile	*filePtr;
+
+    LOCK_MONITOR;
+    holderPtr->revoked = TRUE;
+    filePtr = LeaseFind(&holderPtr->fileID, TRUE);
+    List_Insert((List_Links *)holderPtr, LIST_ATREAR(&filePtr->holderList));
+    UNLOCK_MONITOR;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * LeaseFind --
+ *
+ *	Find the lease record for a file, creating it if asked.
+ *
+ * Results:
+ *	The lease record, or NIL.
+ *
+ * Side effects:
+ *	The table is initialized on first use.
+ *
+ * ----------------------------------------------------------------------------
+ */
+INTERNAL static LeaseFile *
+LeaseFind(fileIDPtr, create)
+    Fs_FileID	*fileIDPtr;	/* File to look for */
+    Boolean	create;		/* TRUE to add a record if there isn't one */
+{
+    register LeaseFile	*filePtr;
+    register List_Links	*hashList;
+    register int	i;
+
+    if (!leaseInit) {
+	for (i = 0; i < LEASE_HASH_SIZE; i++) {
+	    List_Init(&leaseHashTable[i]);
+	}
+	List_Init(&revokePendingList);
+	leaseInit = TRUE;
+    }
+    hashList = &leaseHashTable[LEASE_HASH(fileIDPtr)];
+    LIST_FORALL(hashList, (List_Links *)filePtr) {
+	if (filePtr->major == fileIDPtr->major &&
+	    filePtr->minor == fileIDPtr->minor) {
+	    return(filePtr);
+	}
+    }
+    if (!create) {
+	return((LeaseFile *)NIL);
+    }
+    filePtr = (LeaseFile *)malloc(sizeof(LeaseFile));
+    List_InitElement((List_Links *)filePtr);
+    filePtr->major = fileIDPtr->major;
+    filePtr->minor = fileIDPtr->minor;
+    List_Init(&filePtr->holderList);
+    List_Insert((List_Links *)filePtr, LIST_ATREAR(hashList));
+    numLeaseFiles++;
+    return(filePtr);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * LeaseFileFree --
+ *
+ *	Remove a file's lease record along with any holders left on it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees memory.
+ *
+ * ----------------------------------------------------------------------------
+ */
+INTERNAL static void
+LeaseFileFree(filePtr)
+    register LeaseFile	*filePtr;
+{
+    register List_Links	*holderPtr;
+
+    while (!List_IsEmpty(&filePtr->holderList)) {
+	holderPtr = List_First(&filePtr->holderList);
+	List_Remove(holderPtr);
+	free((Address)holderPtr);
+    }
+    List_Remove((List_Links *)filePtr);
+    free((Address)filePtr);
+    numLeaseFiles--;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * LeaseSweep --
+ *
+ *	Throw away expired leases, and files left with none.  If all is
+ *	TRUE then every lease that has not been revoked is thrown away.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees memory.
+ *
+ * ----------------------------------------------------------------------------
+ */
+INTERNAL static void
+LeaseSweep(now, all)
+    int		now;		/* Current time in seconds */
+    Boolean	all;		/* TRUE to remove unexpired leases too */
+{
+    register LeaseFile		*filePtr;
+    register LeaseFile		*nextFilePtr;
+    register LeaseHolder	*holderPtr;
+    register LeaseHolder	*nextHolderPtr;
+    register int		i;
+
+    for (i = 0; i < LEASE_HASH_SIZE; i++) {
+	filePtr = (LeaseFile *)List_First(&leaseHashTable[i]);
+	while (!List_IsAtEnd(&leaseHashTable[i], (List_Links *)filePtr)) {
+	    nextFilePtr = (LeaseFile *)List_Next((List_Links *)filePtr);
+	    holderPtr = (LeaseHolder *)List_First(&filePtr->holderList);
+	    while (!List_IsAtEnd(&filePtr->holderList,
+				 (List_Links *)holderPtr)) {
+		nextHolderPtr =
+		    (LeaseHolder *)List_Next((List_Links *)holderPtr);
+		if (holderPtr->expires <= now ||
+		    (all && !holderPtr->revoked)) {
+		    List_Remove((List_Links *)holderPtr);
+		    free((Address)holderPtr);
+		}
+		holderPtr = nextHolderPtr;
+	    }
+	    if (List_IsEmpty(&filePtr->holderList)) {
+		LeaseFileFree(filePtr);
+	    }
+	    filePtr = nextFilePtr;
+	}
+    }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * LeaseAdd --
+ *
+ *	Record a lease for a client, unless there has been a revocation
+ *	since the stamp was taken, a revoked lease on the file has not
+ *	run out yet, or the table is full.
+ *
+ * Results:
+ *	The length of the lease in seconds, or zero.
+ *
+ * Side effects:
+ *	Adds or extends the client's lease record.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ENTRY static int
+LeaseAdd(fileIDPtr, clientID, stamp)
+    Fs_FileID	*fileIDPtr;	/* Local fileID of the file */
+    int		clientID;	/* Client getting the lease */
+    int		stamp;		/* From Fsconsist_LeaseStamp */
+{
+    register LeaseFile		*filePtr;
+    register LeaseHolder	*holderPtr;
+    Boolean			found;
+    int				now;
+    int				expires;
+    int				seconds;
+
+    LOCK_MONITOR;
+    if (stamp != leaseStamp) {
+	UNLOCK_MONITOR;
+	return(0);
+    }
+    now = Fsutil_TimeInSeconds();
+    if (numLeaseFiles >= fsconsist_MaxLeaseFiles) {
+	LeaseSweep(now, FALSE);
+    }
+    filePtr = LeaseFind(fileIDPtr, numLeaseFiles < fsconsist_MaxLeaseFiles);
+    if (filePtr == (LeaseFile *)NIL) {
+	UNLOCK_MONITOR;
+	return(0);
+    }
+    seconds = fsconsist_LeaseSeconds;
+    expires = now + seconds + 1;
+    found = FALSE;
+    LIST_FORALL(&filePtr->holderList, (List_Links *)holderPtr) {
+	if (holderPtr->revoked && holderPtr->expires > now) {
+	    UNLOCK_MONITOR;
+	    return(0);
+	}
+    }
+    LIST_FORALL(&filePtr->holderList, (List_Links *)holderPtr) {
+	if (holderPtr->clientID == clientID && !holderPtr->revoked) {
+	    found = TRUE;
+	    break;
+	}
+    }
+    if (!found) {
+	holderPtr = (LeaseHolder *)malloc(sizeof(LeaseHolder));
+	List_InitElement((List_Links *)holderPtr);
+	holderPtr->clientID = clientID;
+	holderPtr->revoked = FALSE;
+	List_Insert((List_Links *)holderPtr,
+		    LIST_ATREAR(&filePtr->holderList));
+    }
+    holderPtr->expires = expires;
+    if (clientExpires[clientID] < expires) {
+	clientExpires[clientID] = expires;
+    }
+    UNLOCK_MONITOR;
+    return(seconds);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * Fsconsist_CollectLeases --
+ *
+ *	Take the unexpired leases on a file that has changed out of the
+ *	table.  This is cheap and can be done with the file handles
+ *	locked, so that no new lease is granted on the old attributes.
+ *	The call-backs are made later by Fsconsist_RevokeCollected.
+ *
+ *	If allNames is TRUE then every client holding any lease is told
+ *	to drop all the names it has cached from us.  This is done when
+ *	a directory or link is renamed or removed, or a directory's
+ *	permissions change, since that affects pathnames that lead
+ *	through it.
+ *
+ * Results:
+ *	Adds LeaseHolder records to revokeList.
+ *
+ * Side effects:
+ *	Increments the revocation stamp.  Lease records are removed,
+ *	except those already revoked, which stay until they run out.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ENTRY void
+Fsconsist_CollectLeases(fileIDPtr, allNames, revokeList)
+    Fs_FileID	*fileIDPtr;	/* File that changed */
+    Boolean	allNames;	/* Revoke every lease on the server */
+    List_Links	*revokeList;	/* Holders to call back */
+{
+    register LeaseFile		*filePtr;
+    register LeaseHolder	*holderPtr;
+    register LeaseHolder	*nextHolderPtr;
+    register int		i;
+    int				now;
+    Fs_FileID			fileID;
+
+    /*
+     * Map to the client's view of the file.
+     */
+    fileID = *fileIDPtr;
+    fileID.type = FSIO_RMT_FILE_STREAM;
+    LOCK_MONITOR;
+    leaseStamp++;
+    if (!leaseInit) {
+	UNLOCK_MONITOR;
+	return;
+    }
+    now = Fsutil_TimeInSeconds();
+    if (allNames) {
+	for (i = 0; i < NET_NUM_SPRITE_HOSTS; i++) {
+	    if (clientExpires[i] > now) {
+		holderPtr = (LeaseHolder *)malloc(sizeof(LeaseHolder));
+		List_InitElement((List_Links *)holderPtr);
+		holderPtr->clientID = i;
+		holderPtr->expires = clientExpires[i];
+		holderPtr->fileID = fileID;
+		holderPtr->allNames = TRUE;
+		holderPtr->revoked = FALSE;
+		List_Insert((List_Links *)holderPtr, LIST_ATREAR(revokeList));
+	    }
+	    clientExpires[i] = 0;
+	}
+	LeaseSweep(now, TRUE);
+    } else {
+	filePtr = LeaseFind(fileIDPtr, FALSE);
+	if (filePtr != (LeaseFile *)NIL) {
+	    holderPtr = (LeaseHolder *)List_First(&filePtr->holderList);
+	    while (!List_IsAtEnd(&filePtr->holderList,
+				 (List_Links *)holderPtr)) {
+		nextHolderPtr =
+		    (LeaseHolder *)List_Next((List_Links *)holderPtr);
+		if (holderPtr->expires <= now) {
+		    List_Remove((List_Links *)holderPtr);
+		    free((Address)holderPtr);
+		} else if (!holderPtr->revoked) {
+		    holderPtr->fileID = fileID;
+		    holderPtr->allNames = FALSE;
+		    List_Move((List_Links *)holderPtr,
+			      LIST_ATREAR(revokeList));
+		}
+		holderPtr = nextHolderPtr;
+	    }
+	    if (List_IsEmpty(&filePtr->holderList)) {
+		LeaseFileFree(filePtr);
+	    }
+	}
+    }
+    UNLOCK_MONITOR;
+}
@@ -45,6 +45,7 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include "sync.h"
 #include "rpc.h"
 #include "fsioDevice.h"
+#include "fsioLock.h"
 #include "fsdmInt.h"
 #include "string.h"
 #include "fscache.h"
@@ -277,6 +278,11 @@ Fsdm_AttachDisk(devicePtr, localName, flags)
      * Make sure a name hash table exists now that we have a disk attached.
      */
     Fslcl_NameHashInit();
+    /*
+     * Clients start reopening files once we serve a domain again.  Hold
+     * back new byte-range locks while they reclaim the ones they had.
+     */
+    Fsio_LockGraceStart();
     Fsdm_DomainRelease(domainNum);
     return(SUCCESS);
 }
@@ -73,6 +73,9 @@ typedef struct Fsio_MigInfo {
  *	FSIO_RAW_IP_STREAM	Raw Internet Protocol stream.
  *	FSIO_UDP_STREAM		UDP protocol stream.
  *	FSIO_TCP_STREAM		TCP protocol stream.
+ *	FSIO_EVENT_STREAM	An event set, which reports the streams in its
+ *				interest list that become ready.  Event sets
+ *				are never remote.
  *
  * The following streams are not implemented
  *	FS_RMT_NFS_STREAM	NFS access implemented in kernel.
@@ -102,8 +105,9 @@ typedef struct Fsio_MigInfo {
 #define FSIO_RAW_IP_STREAM		17
 #define FSIO_UDP_STREAM			18
 #define FSIO_TCP_STREAM			19
+#define FSIO_EVENT_STREAM		20
 
-#define FSIO_NUM_STREAM_TYPES		20
+#define FSIO_NUM_STREAM_TYPES		21
 
 /*
  * Two arrays are used to map between local and remote types.  This has
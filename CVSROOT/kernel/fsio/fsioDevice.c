@@ -774,6 +774,7 @@ Fsio_DeviceScavenge(hdrPtr)
 	Fsutil_WaitListDelete(&handlePtr->readWaitList);
 	Fsutil_WaitListDelete(&handlePtr->writeWaitList);
 	Fsutil_WaitListDelete(&handlePtr->exceptWaitList);
+	Fsio_LockCleanup(&handlePtr->lock);
 	Fsutil_HandleRemove(handlePtr);
 	fs_Stats.object.devices--;
 	return(TRUE);
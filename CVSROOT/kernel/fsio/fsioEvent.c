@@ -0,0 +1,1534 @@
+/*
+ * fsioEvent.c --
+ *
+ *	Routines for event sets.  An event set keeps a persistent list of
+ *	interests, one per watched stream, so a process that waits on many
+ *	streams doesn't have to hand all of them to Fs_Select on every call.
+ *
+ *	An interest is armed by calling the select routine of its stream
+ *	with a waiter whose pid names the interest instead of a process.
+ *	When the stream becomes ready it notifies its wait list as usual,
+ *	and Fsio_EventNotify, which the notify routines try before waking
+ *	a process, moves the interest onto the ready list of its set.
+ *	IOC_EVENT_WAIT then polls only the interests on the ready list,
+ *	which also re-arms the ones that are no longer ready.
+ *
+ *	A set does not hold a reference to the streams it watches.  When
+ *	a watched stream is closed for the last time Fs_Close calls
+ *	Fsio_EventStreamClose, which drops its interests.  The wait lists
+ *	that a stream puts an interest's waiter on are reported by the
+ *	wait list insert routines through Fsio_EventArmed, so the waiter
+ *	can be taken off them when the interest goes away.  A waiter kept
+ *	by the server of a remote stream can't be taken back; if it fires
+ *	later the RPC_REMOTE_WAKEUP is ignored.
+ *
+ *	Event sets are local to the host that created them.  They refuse
+ *	migration, and an event set can't be added to another one.
+ *
+ * Copyright 1990 Regents of the University of California
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ */
+
+#ifndef lint
+static char rcsid[] = "$Header$ SPRITE (Berkeley)";
+#endif /* not lint */
+
+#include <sprite.h>
+#include <fs.h>
+#include <fsutil.h>
+#include <fsio.h>
+#include <fsioEvent.h>
+#include <proc.h>
+#include <sync.h>
+#include <timer.h>
+#include <rpc.h>
+#include <fsioRpc.h>
+#include <list.h>
+
+#include <stdio.h>
+
+/*
+ * An interest links into its set's interestList and, separately, into
+ * one of the ready, rearm or poll lists.  The second set of links
+ * points back to the interest.
+ */
+typedef struct FsioEventLinks {
+    List_Links			links;
+    struct FsioEventInterest	*interestPtr;
+} FsioEventLinks;
+
+/*
+ * The most wait lists a stream puts a waiter on, one each for reading,
+ * writing and exceptions, plus one for luck.
+ */
+#define EVENT_MAX_ARMED	4
+
+typedef struct FsioEventInterest {
+    List_Links		links;		/* In the set's interestList.
+					 * MUST BE FIRST */
+    FsioEventLinks	queue;		/* In the readyList or rearmList of
+					 * the set, or a poll list. */
+    Fsio_EventIOHandle	*setPtr;	/* Set that holds the interest. */
+    Fs_Stream		*streamPtr;	/* Stream being watched.  This is
+					 * not a reference; the interest is
+					 * dropped when the stream closes. */
+    int			id;		/* Names the interest in its
+					 * waiters on the stream. */
+    int			events;		/* FS_READABLE, etc., and
+					 * FSIO_EVENT_EDGE. */
+    ClientData		clientData;	/* Returned with each event. */
+    int			state;		/* See below. */
+    Boolean		pending;	/* Notified while being polled. */
+    Boolean		reported;	/* Edge-triggered and reported ready
+					 * since it was last seen not ready. */
+    List_Links		*armedList[EVENT_MAX_ARMED];
+					/* Wait lists holding our waiter. */
+    int			numArmed;	/* Entries used in armedList. */
+    struct FsioEventInterest *nextHashPtr;	/* Chain in eventHashTable */
+    struct FsioEventInterest *nextStreamPtr;	/* Chain in streamHashTable */
+} FsioEventInterest;
+
+/*
+ * Interest states:
+ *	EVENT_IDLE	Armed, or waiting to be, in the stream's wait lists.
+ *	EVENT_READY	On the set's readyList.
+ *	EVENT_REARM	On the set's rearmList.
+ *	EVENT_POLLING	On the poll list of an IOC_EVENT_WAIT.
+ */
+#define EVENT_IDLE	0
+#define EVENT_READY	1
+#define EVENT_REARM	2
+#define EVENT_POLLING	3
+
+#define EVENT_MASK	(FS_READABLE | FS_WRITABLE | FS_EXCEPTION)
+
+/*
+ * The pid in the waiter of an interest has EVENT_PID_BIT set, which no
+ * real process ID has, and the interest ID in the low bits.  Interests
+ * are found from their ID with a small hash table.
+ */
+#define EVENT_PID_BIT	0x40000000
+#define EVENT_ID_MASK	0x3fffffff
+
+#define EVENT_HASH_SIZE	64
+#define EVENT_HASH(id)	((id) & (EVENT_HASH_SIZE - 1))
+#define EVENT_STREAM_HASH(streamPtr) \
+	((((unsigned int)(streamPtr)) >> 4) & (EVENT_HASH_SIZE - 1))
+
+static FsioEventInterest *eventHashTable[EVENT_HASH_SIZE];
+static FsioEventInterest *streamHashTable[EVENT_HASH_SIZE];
+static Boolean eventHashInit = FALSE;
+static int nextEventID = 0;
+
+/*
+ * Monitor for the hash table and the ready state of every set.  The
+ * interestList of a set is changed only by whoever has it busy.
+ */
+static	Sync_Lock	eventLock = Sync_LockInitStatic("Fs:eventLock");
+#define	LOCKPTR	&eventLock
+
+/*
+ * Passed to the timeout proc of IOC_EVENT_WAIT.
+ */
+typedef struct {
+    Proc_ControlBlock	*procPtr;
+    int			timeOut;
+} WakeupInfo;
+
+/*
+ * Forward references.
+ */
+static void GetFileID _ARGS_((Fs_FileID *fileIDPtr));
+static void EventBegin _ARGS_((Fsio_EventIOHandle *handlePtr));
+static void EventEnd _ARGS_((Fsio_EventIOHandle *handlePtr));
+static void EventQueue _ARGS_((FsioEventInterest *interestPtr,
+		List_Links *waitersPtr));
+static void EventPost _ARGS_((int id, List_Links *waitersPtr));
+static void EventAdd _ARGS_((Fsio_EventIOHandle *handlePtr,
+		FsioEventInterest *interestPtr, List_Links *waitersPtr));
+static void EventChange _ARGS_((FsioEventInterest *interestPtr, int events,
+		ClientData clientData, List_Links *waitersPtr));
+static void EventUnlink _ARGS_((FsioEventInterest *interestPtr));
+static void EventRemove _ARGS_((FsioEventInterest *interestPtr));
+static void EventDisarm _ARGS_((FsioEventInterest *interestPtr));
+static FsioEventInterest *EventTakeStream _ARGS_((Fs_Stream *streamPtr));
+static FsioEventInterest *EventLookup _ARGS_((int id));
+static void EventStartPoll _ARGS_((Fsio_EventIOHandle *handlePtr,
+		List_Links *pollListPtr));
+static Boolean EventPolled _ARGS_((FsioEventInterest *interestPtr,
+		int readyEvents));
+static void EventRequeue _ARGS_((FsioEventInterest *interestPtr));
+static Boolean EventSleep _ARGS_((Fsio_EventIOHandle *handlePtr,
+		Sync_RemoteWaiter *waitPtr));
+static FsioEventInterest *EventFind _ARGS_((Fsio_EventIOHandle *handlePtr,
+		Fs_Stream *streamPtr));
+static int EventPollInterest _ARGS_((FsioEventInterest *interestPtr));
+static int EventPoll _ARGS_((Fsio_EventIOHandle *handlePtr,
+		Fsio_Event *eventPtr, int maxEvents));
+static ReturnStatus EventCtl _ARGS_((Fsio_EventIOHandle *handlePtr,
+		Fs_IOCParam *ioctlPtr));
+static ReturnStatus EventWait _ARGS_((Fsio_EventIOHandle *handlePtr,
+		Fs_IOCParam *ioctlPtr, Fs_IOReply *replyPtr));
+static void EventTimeout _ARGS_((Timer_Ticks ticks, ClientData clientData));
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_CreateEventSet --
+ *
+ *	Create an empty event set.  A pointer to a stream for it is
+ *	returned in *streamPtrPtr.
+ *
+ * Results:
+ *	SUCCESS.
+ *
+ * Side effects:
+ *	Installs the I/O handle for the set and creates its stream.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ReturnStatus
+Fsio_CreateEventSet(streamPtrPtr)
+    Fs_Stream **streamPtrPtr;		/* Return - stream to the set */
+{
+    Fs_FileID		fileID;
+    Fs_HandleHeader	*hdrPtr;
+    register Fsio_EventIOHandle	*handlePtr;
+    register Fs_Stream		*streamPtr;
+
+    GetFileID(&fileID);
+    (void)Fsutil_HandleInstall(&fileID, sizeof(Fsio_EventIOHandle),
+		"event set", FALSE, &hdrPtr);
+    handlePtr = (Fsio_EventIOHandle *)hdrPtr;
+    List_Init(&handlePtr->interestList);
+    List_Init(&handlePtr->readyList);
+    List_Init(&handlePtr->rearmList);
+    List_Init(&handlePtr->readWaitList);
+    handlePtr->busy = FALSE;
+    handlePtr->idle.waiting = FALSE;
+    handlePtr->numInterests = 0;
+
+    streamPtr = Fsio_StreamCreate(rpc_SpriteID, rpc_SpriteID,
+			(Fs_HandleHeader *)handlePtr,
+			FS_READ | FS_USER, "event-set");
+    Fsutil_HandleUnlock(handlePtr);
+    Fsutil_HandleUnlock(streamPtr);
+    *streamPtrPtr = streamPtr;
+    return(SUCCESS);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetFileID --
+ *
+ *      Get a unique file ID for an event set.  The first call also
+ *	initializes the interest hash table.
+ *
+ * Results:
+ *	Unique file ID.
+ *
+ * Side effects:
+ *	Open instance incremented.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY void
+GetFileID(fileIDPtr)
+    Fs_FileID	*fileIDPtr;
+{
+    static int openInstance = 0;
+    register int i;
+
+    LOCK_MONITOR;
+
+    if (!eventHashInit) {
+	for (i = 0; i < EVENT_HASH_SIZE; i++) {
+	    eventHashTable[i] = (FsioEventInterest *)NIL;
+	    streamHashTable[i] = (FsioEventInterest *)NIL;
+	}
+	eventHashInit = TRUE;
+    }
+    fileIDPtr->type = FSIO_EVENT_STREAM;
+    fileIDPtr->serverID = rpc_SpriteID;
+    fileIDPtr->major = 0;
+    fileIDPtr->minor = openInstance;
+    openInstance++;
+
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventBegin --
+ *
+ *	Wait until nobody else is using an event set, and mark it busy.
+ *	Interests are added, removed and polled only with the set busy,
+ *	which lets the poll call stream routines without the monitor.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets the busy flag.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY void
+EventBegin(handlePtr)
+    Fsio_EventIOHandle *handlePtr;
+{
+    LOCK_MONITOR;
+    while (handlePtr->busy) {
+	(void) Sync_Wait(&handlePtr->idle, FALSE);
+    }
+    handlePtr->busy = TRUE;
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventEnd --
+ *
+ *	Mark an event set as no longer busy.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Clears the busy flag and notifies anyone waiting for it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY void
+EventEnd(handlePtr)
+    Fsio_EventIOHandle *handlePtr;
+{
+    LOCK_MONITOR;
+    handlePtr->busy = FALSE;
+    Sync_Broadcast(&handlePtr->idle);
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventQueue --
+ *
+ *	Put an idle interest on the ready list of its set.  The processes
+ *	waiting on the set are moved to *waitersPtr; they have to be
+ *	notified after the monitor is released because one of them may
+ *	be selecting the set from another event set's interest.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Moves the interest to the readyList.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static INTERNAL void
+EventQueue(interestPtr, waitersPtr)
+    register FsioEventInterest *interestPtr;
+    List_Links *waitersPtr;		/* Gets the waiters on the set */
+{
+    register Fsio_EventIOHandle *handlePtr = interestPtr->setPtr;
+    register List_Links *waitPtr;
+
+    switch (interestPtr->state) {
+	case EVENT_POLLING:
+	    interestPtr->pending = TRUE;
+	    return;
+	case EVENT_READY:
+	    return;
+	case EVENT_REARM:
+	    List_Remove((List_Links *)&interestPtr->queue);
+	    break;
+    }
+    interestPtr->state = EVENT_READY;
+    List_Insert((List_Links *)&interestPtr->queue,
+		LIST_ATREAR(&handlePtr->readyList));
+    while (!List_IsEmpty(&handlePtr->readWaitList)) {
+	waitPtr = List_First(&handlePtr->readWaitList);
+	List_Remove(waitPtr);
+	List_Insert(waitPtr, LIST_ATREAR(waitersPtr));
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_EventNotify --
+ *
+ *	Called by the wait list notify routines for each local waiter
+ *	before the process is woken up.  If the waiter is really an
+ *	interest of an event set the interest is queued and there is
+ *	no process to wake.
+ *
+ * Results:
+ *	TRUE if the waiter belonged to an event set, FALSE if the caller
+ *	should wake the process.
+ *
+ * Side effects:
+ *	May queue an interest and notify the processes waiting on its set.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Boolean
+Fsio_EventNotify(pid, waitToken)
+    Proc_PID	pid;		/* Process ID, or interest of an event set */
+    int		waitToken;	/* Not used for interests */
+{
+    List_Links waiters;
+
+    if ((pid & EVENT_PID_BIT) == 0) {
+	return(FALSE);
+    }
+    List_Init(&waiters);
+    EventPost((int)(pid & EVENT_ID_MASK), &waiters);
+    Fsutil_FastWaitListNotify(&waiters);
+    return(TRUE);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventPost --
+ *
+ *	Queue the interest with the given ID.  Waiters left behind by
+ *	interests that have since been removed are ignored.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	See EventQueue.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY void
+EventPost(id, waitersPtr)
+    int		id;			/* ID of the interest */
+    List_Links	*waitersPtr;		/* Gets the waiters on the set */
+{
+    register FsioEventInterest *interestPtr;
+
+    LOCK_MONITOR;
+    interestPtr = EventLookup(id);
+    if (interestPtr != (FsioEventInterest *)NIL) {
+	EventQueue(interestPtr, waitersPtr);
+    }
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventLookup --
+ *
+ *	Find an interest from its ID.
+ *
+ * Results:
+ *	The interest, or NIL if it has been removed.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static INTERNAL FsioEventInterest *
+EventLookup(id)
+    int		id;			/* ID of the interest */
+{
+    register FsioEventInterest *interestPtr;
+
+    for (interestPtr = eventHashTable[EVENT_HASH(id)];
+	 interestPtr != (FsioEventInterest *)NIL;
+	 interestPtr = interestPtr->nextHashPtr) {
+	if (interestPtr->id == id) {
+	    return(interestPtr);
+	}
+    }
+    return((FsioEventInterest *)NIL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_EventArmed --
+ *
+ *	Called by the wait list insert routines when they add a local
+ *	waiter to a list.  If the waiter is an interest of an event set
+ *	the list is remembered so the waiter can be taken off it when
+ *	the interest is removed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May add to the armedList of the interest.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ENTRY void
+Fsio_EventArmed(waitPtr, list)
+    Sync_RemoteWaiter	*waitPtr;	/* Waiter just put on the list */
+    List_Links		*list;		/* Wait list of a stream */
+{
+    register FsioEventInterest *interestPtr;
+    register int i;
+
+    if ((waitPtr->pid & EVENT_PID_BIT) == 0 ||
+	waitPtr->hostID != rpc_SpriteID) {
+	return;
+    }
+    LOCK_MONITOR;
+    interestPtr = EventLookup((int)(waitPtr->pid & EVENT_ID_MASK));
+    if (interestPtr != (FsioEventInterest *)NIL) {
+	for (i = 0; i < interestPtr->numArmed; i++) {
+	    if (interestPtr->armedList[i] == list) {
+		break;
+	    }
+	}
+	if (i == interestPtr->numArmed && i < EVENT_MAX_ARMED) {
+	    interestPtr->armedList[i] = list;
+	    interestPtr->numArmed++;
+	}
+    }
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventAdd --
+ *
+ *	Enter a new interest into its set and the hash table.  It starts
+ *	out queued so the next wait polls the stream and arms it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Assigns the interest ID.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY void
+EventAdd(handlePtr, interestPtr, waitersPtr)
+    Fsio_EventIOHandle		*handlePtr;
+    register FsioEventInterest	*interestPtr;
+    List_Links			*waitersPtr;
+{
+    register int bucket;
+
+    LOCK_MONITOR;
+    interestPtr->id = nextEventID;
+    nextEventID = (nextEventID + 1) & EVENT_ID_MASK;
+    bucket = EVENT_HASH(interestPtr->id);
+    interestPtr->nextHashPtr = eventHashTable[bucket];
+    eventHashTable[bucket] = interestPtr;
+    bucket = EVENT_STREAM_HASH(interestPtr->streamPtr);
+    interestPtr->nextStreamPtr = streamHashTable[bucket];
+    streamHashTable[bucket] = interestPtr;
+    interestPtr->numArmed = 0;
+
+    interestPtr->setPtr = handlePtr;
+    interestPtr->queue.interestPtr = interestPtr;
+    interestPtr->state = EVENT_IDLE;
+    interestPtr->pending = FALSE;
+    interestPtr->reported = FALSE;
+    List_Insert((List_Links *)interestPtr,
+		LIST_ATREAR(&handlePtr->interestList));
+    handlePtr->numInterests++;
+    EventQueue(interestPtr, waitersPtr);
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventChange --
+ *
+ *	Change the events and client data of an interest, and queue it
+ *	to be polled for the new events.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	See EventQueue.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY void
+EventChange(interestPtr, events, clientData, waitersPtr)
+    FsioEventInterest	*interestPtr;
+    int			events;
+    ClientData		clientData;
+    List_Links		*waitersPtr;
+{
+    LOCK_MONITOR;
+    interestPtr->events = events;
+    interestPtr->clientData = clientData;
+    interestPtr->reported = FALSE;
+    EventQueue(interestPtr, waitersPtr);
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventUnlink --
+ *
+ *	Take an interest out of its set and the hash tables.  After this
+ *	a notify for the interest is ignored by EventPost.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Unlinks the interest.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static INTERNAL void
+EventUnlink(interestPtr)
+    register FsioEventInterest	*interestPtr;
+{
+    register FsioEventInterest **prevPtrPtr;
+    register int bucket;
+
+    for (prevPtrPtr = &eventHashTable[EVENT_HASH(interestPtr->id)];
+	 *prevPtrPtr != (FsioEventInterest *)NIL;
+	 prevPtrPtr = &(*prevPtrPtr)->nextHashPtr) {
+	if (*prevPtrPtr == interestPtr) {
+	    *prevPtrPtr = interestPtr->nextHashPtr;
+	    break;
+	}
+    }
+    bucket = EVENT_STREAM_HASH(interestPtr->streamPtr);
+    for (prevPtrPtr = &streamHashTable[bucket];
+	 *prevPtrPtr != (FsioEventInterest *)NIL;
+	 prevPtrPtr = &(*prevPtrPtr)->nextStreamPtr) {
+	if (*prevPtrPtr == interestPtr) {
+	    *prevPtrPtr = interestPtr->nextStreamPtr;
+	    break;
+	}
+    }
+    if (interestPtr->state == EVENT_READY ||
+	interestPtr->state == EVENT_REARM) {
+	List_Remove((List_Links *)&interestPtr->queue);
+    }
+    List_Remove((List_Links *)interestPtr);
+    interestPtr->setPtr->numInterests--;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventRemove --
+ *
+ *	Take an interest out of its set.  The set must be busy.  The
+ *	caller disarms the interest with EventDisarm and frees it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Unlinks the interest.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY void
+EventRemove(interestPtr)
+    register FsioEventInterest	*interestPtr;
+{
+    LOCK_MONITOR;
+    EventUnlink(interestPtr);
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventDisarm --
+ *
+ *	Take the waiter of a removed interest off the wait lists of its
+ *	stream.  The caller has the stream's I/O handle locked, which
+ *	keeps out the stream routines that use the unmonitored wait list
+ *	routines.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the waiters.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+EventDisarm(interestPtr)
+    register FsioEventInterest	*interestPtr;
+{
+    Sync_RemoteWaiter waiter;
+    register int i;
+
+    waiter.hostID = rpc_SpriteID;
+    waiter.pid = EVENT_PID_BIT | interestPtr->id;
+    waiter.waitToken = 0;
+    for (i = 0; i < interestPtr->numArmed; i++) {
+	Fsutil_WaitListRemove(interestPtr->armedList[i], &waiter);
+    }
+    interestPtr->numArmed = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventTakeStream --
+ *
+ *	Remove an interest in a stream from whatever set holds it.  This
+ *	waits for the set to be idle, so that no poll is using the stream.
+ *
+ * Results:
+ *	The interest, or NIL if there are no more in the stream.
+ *
+ * Side effects:
+ *	Unlinks the interest.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY FsioEventInterest *
+EventTakeStream(streamPtr)
+    Fs_Stream	*streamPtr;
+{
+    register FsioEventInterest *interestPtr;
+
+    LOCK_MONITOR;
+    if (!eventHashInit) {
+	UNLOCK_MONITOR;
+	return((FsioEventInterest *)NIL);
+    }
+again:
+    for (interestPtr = streamHashTable[EVENT_STREAM_HASH(streamPtr)];
+	 interestPtr != (FsioEventInterest *)NIL;
+	 interestPtr = interestPtr->nextStreamPtr) {
+	if (interestPtr->streamPtr == streamPtr) {
+	    if (interestPtr->setPtr->busy) {
+		/*
+		 * The set may remove the interest itself while we
+		 * wait, so look again afterwards.
+		 */
+		(void) Sync_Wait(&interestPtr->setPtr->idle, FALSE);
+		goto again;
+	    }
+	    EventUnlink(interestPtr);
+	    break;
+	}
+    }
+    UNLOCK_MONITOR;
+    return(interestPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_EventStreamClose --
+ *
+ *	Called by Fs_Close when the last reference to a stream goes
+ *	away, before the stream is closed.  Any interests of event sets
+ *	in the stream are dropped.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Removes interests and their waiters, and frees them.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Fsio_EventStreamClose(streamPtr)
+    Fs_Stream	*streamPtr;		/* Stream that is being closed */
+{
+    register FsioEventInterest *interestPtr;
+
+    while (TRUE) {
+	interestPtr = EventTakeStream(streamPtr);
+	if (interestPtr == (FsioEventInterest *)NIL) {
+	    break;
+	}
+	Fsutil_HandleLock(streamPtr->ioHandlePtr);
+	EventDisarm(interestPtr);
+	Fsutil_HandleUnlock(streamPtr->ioHandlePtr);
+	free((Address)interestPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_RpcRemoteWakeup --
+ *
+ *	Server stub for RPC_REMOTE_WAKEUP.  A waiter that is the interest
+ *	of an event set is posted to its set; otherwise the process is
+ *	woken by Sync_RemoteNotifyStub.
+ *
+ * Results:
+ *	SUCCESS.
+ *
+ * Side effects:
+ *	See Fsio_EventNotify and Sync_RemoteNotifyStub.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ReturnStatus
+Fsio_RpcRemoteWakeup(srvToken, clientID, command, storagePtr)
+    ClientData srvToken;	/* Handle on server process passed to
+				 * Rpc_Reply */
+    int clientID;		/* Sprite ID of client host */
+    int command;		/* Command identifier */
+    Rpc_Storage *storagePtr;	/* The request fields refer to the request
+				 * buffers and also indicate the exact amount
+				 * of data in the request buffers.  The reply
+				 * fields are initialized to NIL for the
+				 * pointers and 0 for the lengths.  This can
+				 * be passed to Rpc_Reply. */
+{
+    register Sync_RemoteWaiter *waitPtr;
+
+    waitPtr = (Sync_RemoteWaiter *)storagePtr->requestParamPtr;
+    if (!Fsio_EventNotify(waitPtr->pid, waitPtr->waitToken)) {
+	return(Sync_RemoteNotifyStub(srvToken, clientID, command,
+				     storagePtr));
+    }
+    Rpc_Reply(srvToken, SUCCESS, storagePtr, (int (*) ()) NIL,
+	      (ClientData) NIL);
+    return(SUCCESS);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventStartPoll --
+ *
+ *	Move the ready and rearm lists of a set onto a poll list.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The interests are marked as being polled.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY void
+EventStartPoll(handlePtr, pollListPtr)
+    Fsio_EventIOHandle	*handlePtr;
+    List_Links		*pollListPtr;	/* Gets the interests to poll */
+{
+    register FsioEventLinks *linksPtr;
+
+    LOCK_MONITOR;
+    while (!List_IsEmpty(&handlePtr->readyList)) {
+	linksPtr = (FsioEventLinks *)List_First(&handlePtr->readyList);
+	List_Remove((List_Links *)linksPtr);
+	List_Insert((List_Links *)linksPtr, LIST_ATREAR(pollListPtr));
+	linksPtr->interestPtr->state = EVENT_POLLING;
+	linksPtr->interestPtr->pending = FALSE;
+    }
+    while (!List_IsEmpty(&handlePtr->rearmList)) {
+	linksPtr = (FsioEventLinks *)List_First(&handlePtr->rearmList);
+	List_Remove((List_Links *)linksPtr);
+	List_Insert((List_Links *)linksPtr, LIST_ATREAR(pollListPtr));
+	linksPtr->interestPtr->state = EVENT_POLLING;
+	linksPtr->interestPtr->pending = FALSE;
+    }
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventPolled --
+ *
+ *	Decide what to do with an interest after polling its stream.
+ *	One that wasn't ready has been armed by the stream and goes idle.
+ *	A level-triggered one that was ready is reported and queued again
+ *	so the next wait looks at it.  An edge-triggered one is reported
+ *	only the first time it is found ready, and waits on the rearm
+ *	list until it is found not ready.  An interest notified while it
+ *	was being polled is queued in any case.
+ *
+ * Results:
+ *	TRUE if the ready events should be reported.
+ *
+ * Side effects:
+ *	Moves the interest to a new list.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY Boolean
+EventPolled(interestPtr, readyEvents)
+    register FsioEventInterest	*interestPtr;
+    int				readyEvents;	/* Ready events */
+{
+    register Fsio_EventIOHandle *handlePtr = interestPtr->setPtr;
+    Boolean report = FALSE;
+
+    LOCK_MONITOR;
+    if (readyEvents == 0) {
+	interestPtr->reported = FALSE;
+	interestPtr->state = EVENT_IDLE;
+    } else if (interestPtr->events & FSIO_EVENT_EDGE) {
+	report = !interestPtr->reported;
+	interestPtr->reported = TRUE;
+	interestPtr->state = EVENT_REARM;
+	List_Insert((List_Links *)&interestPtr->queue,
+		    LIST_ATREAR(&handlePtr->rearmList));
+    } else {
+	report = TRUE;
+	interestPtr->state = EVENT_READY;
+	List_Insert((List_Links *)&interestPtr->queue,
+		    LIST_ATREAR(&handlePtr->readyList));
+    }
+    if (interestPtr->pending && interestPtr->state != EVENT_READY) {
+	if (interestPtr->state == EVENT_REARM) {
+	    List_Remove((List_Links *)&interestPtr->queue);
+	}
+	interestPtr->state = EVENT_READY;
+	List_Insert((List_Links *)&interestPtr->queue,
+		    LIST_ATREAR(&handlePtr->readyList));
+    }
+    interestPtr->pending = FALSE;
+    UNLOCK_MONITOR;
+    return(report);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventRequeue --
+ *
+ *	Put back an interest that a wait had no room to poll.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Moves the interest to the ready or rearm list.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY void
+EventRequeue(interestPtr)
+    register FsioEventInterest	*interestPtr;
+{
+    register Fsio_EventIOHandle *handlePtr = interestPtr->setPtr;
+
+    LOCK_MONITOR;
+    if (interestPtr->reported && !interestPtr->pending) {
+	interestPtr->state = EVENT_REARM;
+	List_Insert((List_Links *)&interestPtr->queue,
+		    LIST_ATREAR(&handlePtr->rearmList));
+    } else {
+	interestPtr->state = EVENT_READY;
+	List_Insert((List_Links *)&interestPtr->queue,
+		    LIST_ATREAR(&handlePtr->readyList));
+    }
+    interestPtr->pending = FALSE;
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventSleep --
+ *
+ *	Put a process on the wait list of a set, unless an interest was
+ *	queued since the set was polled.
+ *
+ * Results:
+ *	TRUE if the process should wait.
+ *
+ * Side effects:
+ *	Adds to the readWaitList.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY Boolean
+EventSleep(handlePtr, waitPtr)
+    Fsio_EventIOHandle	*handlePtr;
+    Sync_RemoteWaiter	*waitPtr;
+{
+    Boolean sleep = FALSE;
+
+    LOCK_MONITOR;
+    if (List_IsEmpty(&handlePtr->readyList)) {
+	Fsutil_FastWaitListInsert(&handlePtr->readWaitList, waitPtr);
+	sleep = TRUE;
+    }
+    UNLOCK_MONITOR;
+    return(sleep);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventFind --
+ *
+ *	Find the interest in a stream.  The set must be busy.
+ *
+ * Results:
+ *	The interest, or NIL.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static FsioEventInterest *
+EventFind(handlePtr, streamPtr)
+    Fsio_EventIOHandle	*handlePtr;
+    Fs_Stream		*streamPtr;
+{
+    register FsioEventInterest *interestPtr;
+
+    LIST_FORALL(&handlePtr->interestList, (List_Links *)interestPtr) {
+	if (interestPtr->streamPtr == streamPtr) {
+	    return(interestPtr);
+	}
+    }
+    return((FsioEventInterest *)NIL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventPollInterest --
+ *
+ *	Call the select routine of an interest's stream.  If the stream
+ *	isn't ready this leaves the interest's waiter on its wait lists.
+ *	The set must be busy.
+ *
+ * Results:
+ *	The events of the interest that are ready.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+EventPollInterest(interestPtr)
+    register FsioEventInterest	*interestPtr;
+{
+    register Fs_Stream *streamPtr = interestPtr->streamPtr;
+    Sync_RemoteWaiter waiter;
+    int readBit, writeBit, exceptBit;
+    int readyEvents = 0;
+    ReturnStatus status;
+
+    readBit = interestPtr->events & FS_READABLE;
+    writeBit = interestPtr->events & FS_WRITABLE;
+    exceptBit = interestPtr->events & FS_EXCEPTION;
+    if (!(streamPtr->flags & FS_READ)) {
+	readBit = 0;
+    }
+    if (!(streamPtr->flags & FS_WRITE)) {
+	writeBit = 0;
+    }
+    waiter.hostID = rpc_SpriteID;
+    waiter.pid = EVENT_PID_BIT | interestPtr->id;
+    waiter.waitToken = 0;
+    status = (*fsio_StreamOpTable[streamPtr->ioHandlePtr->fileID.type].select)
+		(streamPtr->ioHandlePtr, &waiter,
+		 &readBit, &writeBit, &exceptBit);
+    if (status != SUCCESS) {
+	/*
+	 * Report the stream so the caller finds out what is wrong
+	 * when it uses it.
+	 */
+	return(FS_EXCEPTION);
+    }
+    if (readBit) {
+	readyEvents |= FS_READABLE;
+    }
+    if (writeBit) {
+	readyEvents |= FS_WRITABLE;
+    }
+    if (exceptBit) {
+	readyEvents |= FS_EXCEPTION;
+    }
+    return(readyEvents);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventPoll --
+ *
+ *	Poll the queued interests of a set and fill in an event for each
+ *	one that is ready.  The set must be busy.
+ *
+ * Results:
+ *	The number of events filled in.
+ *
+ * Side effects:
+ *	Re-arms the interests that are no longer ready.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+EventPoll(handlePtr, eventPtr, maxEvents)
+    Fsio_EventIOHandle	*handlePtr;
+    Fsio_Event		*eventPtr;	/* Array to fill in */
+    int			maxEvents;	/* Size of the array */
+{
+    List_Links pollList;
+    register FsioEventLinks *linksPtr;
+    register FsioEventInterest *interestPtr;
+    int readyEvents;
+    int numReady = 0;
+
+    List_Init(&pollList);
+    EventStartPoll(handlePtr, &pollList);
+    while (!List_IsEmpty(&pollList)) {
+	linksPtr = (FsioEventLinks *)List_First(&pollList);
+	List_Remove((List_Links *)linksPtr);
+	interestPtr = linksPtr->interestPtr;
+	if (numReady >= maxEvents) {
+	    EventRequeue(interestPtr);
+	    continue;
+	}
+	readyEvents = EventPollInterest(interestPtr);
+	if (EventPolled(interestPtr, readyEvents)) {
+	    eventPtr[numReady].events = readyEvents;
+	    eventPtr[numReady].clientData = interestPtr->clientData;
+	    numReady++;
+	}
+    }
+    return(numReady);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_EventIOControl --
+ *
+ *	I/O controls on an event set.
+ *
+ * Results:
+ *	SUCCESS, or an error from IOC_EVENT_CTL or IOC_EVENT_WAIT.
+ *
+ * Side effects:
+ *	See EventCtl and EventWait.
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+ReturnStatus
+Fsio_EventIOControl(streamPtr, ioctlPtr, replyPtr)
+    Fs_Stream *streamPtr;
+    Fs_IOCParam *ioctlPtr;		/* I/O Control parameter block */
+    Fs_IOReply *replyPtr;		/* Return length and signal */
+{
+    register Fsio_EventIOHandle *handlePtr =
+	    (Fsio_EventIOHandle *)streamPtr->ioHandlePtr;
+
+    switch(ioctlPtr->command) {
+	case IOC_EVENT_CTL:
+	    replyPtr->length = 0;
+	    return(EventCtl(handlePtr, ioctlPtr));
+	case IOC_EVENT_WAIT:
+	    return(EventWait(handlePtr, ioctlPtr, replyPtr));
+	case IOC_REPOSITION:
+	    return(FS_BAD_SEEK);
+	case IOC_GET_FLAGS:
+	case IOC_SET_FLAGS:
+	case IOC_SET_BITS:
+	case IOC_CLEAR_BITS:
+	    return(SUCCESS);
+	case IOC_TRUNCATE:
+	case IOC_LOCK:
+	case IOC_UNLOCK:
+	case IOC_NUM_READABLE:
+	case IOC_GET_OWNER:
+	case IOC_SET_OWNER:
+	case IOC_MAP:
+	case IOC_PREFIX:
+	    return(GEN_NOT_IMPLEMENTED);
+	default:
+	    return(GEN_INVALID_ARG);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventCtl --
+ *
+ *	Add, change or delete the interest of an event set in one of the
+ *	caller's streams.  The set doesn't keep the stream open; the
+ *	interest goes away by itself when the stream is closed.
+ *
+ * Results:
+ *	SUCCESS, GEN_INVALID_ARG for a bad request or a stream that is
+ *	already (or not) in the set, or the error from looking up the
+ *	stream.
+ *
+ * Side effects:
+ *	Changes the interestList of the set.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ReturnStatus
+EventCtl(handlePtr, ioctlPtr)
+    Fsio_EventIOHandle	*handlePtr;
+    Fs_IOCParam		*ioctlPtr;
+{
+    register Fsio_EventCtl *ctlPtr;
+    register FsioEventInterest *interestPtr;
+    Fs_Stream *streamPtr;
+    List_Links waiters;
+    ReturnStatus status;
+
+    if (ioctlPtr->format != mach_Format ||
+	ioctlPtr->inBufSize != sizeof(Fsio_EventCtl)) {
+	return(GEN_INVALID_ARG);
+    }
+    ctlPtr = (Fsio_EventCtl *)ioctlPtr->inBuffer;
+    status = Fs_GetStreamPtr(Proc_GetEffectiveProc(), ctlPtr->streamID,
+			     &streamPtr);
+    if (status != SUCCESS) {
+	return(status);
+    }
+    if (streamPtr->ioHandlePtr->fileID.type == FSIO_EVENT_STREAM) {
+	return(GEN_INVALID_ARG);
+    }
+    List_Init(&waiters);
+    EventBegin(handlePtr);
+    interestPtr = EventFind(handlePtr, streamPtr);
+    switch (ctlPtr->operation) {
+	case FSIO_EVENT_ADD:
+	    if (interestPtr != (FsioEventInterest *)NIL) {
+		status = GEN_INVALID_ARG;
+		break;
+	    }
+	    interestPtr = (FsioEventInterest *)
+		    malloc(sizeof(FsioEventInterest));
+	    interestPtr->streamPtr = streamPtr;
+	    interestPtr->events =
+		    ctlPtr->events & (EVENT_MASK | FSIO_EVENT_EDGE);
+	    interestPtr->clientData = ctlPtr->clientData;
+	    EventAdd(handlePtr, interestPtr, &waiters);
+	    break;
+	case FSIO_EVENT_MODIFY:
+	    if (interestPtr == (FsioEventInterest *)NIL) {
+		status = GEN_INVALID_ARG;
+		break;
+	    }
+	    EventChange(interestPtr,
+		    ctlPtr->events & (EVENT_MASK | FSIO_EVENT_EDGE),
+		    ctlPtr->clientData, &waiters);
+	    break;
+	case FSIO_EVENT_DELETE:
+	    if (interestPtr == (FsioEventInterest *)NIL) {
+		status = GEN_INVALID_ARG;
+		break;
+	    }
+	    EventRemove(interestPtr);
+	    Fsutil_HandleLock(streamPtr->ioHandlePtr);
+	    EventDisarm(interestPtr);
+	    Fsutil_HandleUnlock(streamPtr->ioHandlePtr);
+	    free((Address)interestPtr);
+	    break;
+	default:
+	    status = GEN_INVALID_ARG;
+	    break;
+    }
+    EventEnd(handlePtr);
+    /*
+     * Wake anyone already waiting on the set so the new interest
+     * gets polled and armed.
+     */
+    Fsutil_FastWaitListNotify(&waiters);
+    return(status);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventWait --
+ *
+ *	Wait for streams in an event set to become ready.  The optional
+ *	Time in the input buffer limits the wait; a zero time just polls.
+ *	The structure of the wait follows Fs_Select: the wait token is
+ *	taken before polling, so a notify that comes in after the poll
+ *	makes Sync_ProcWait return at once.
+ *
+ * Results:
+ *	SUCCESS, FS_TIMEOUT, GEN_ABORTED_BY_SIGNAL, or GEN_INVALID_ARG
+ *	if the buffers are the wrong size.
+ *
+ * Side effects:
+ *	Fills in the output buffer and sets replyPtr->length.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ReturnStatus
+EventWait(handlePtr, ioctlPtr, replyPtr)
+    Fsio_EventIOHandle	*handlePtr;
+    Fs_IOCParam		*ioctlPtr;
+    Fs_IOReply		*replyPtr;
+{
+    Sync_RemoteWaiter	waiter;
+    Timer_QueueElement	wakeupElement;	/* Element for timeout. */
+    WakeupInfo		wakeupInfo;	/* Passed to timeout routine. */
+    Boolean		doTimeout = FALSE;
+    Boolean		poll = FALSE;
+    Boolean		sleep;
+    int			maxEvents;
+    int			numReady = 0;
+    ReturnStatus	status = SUCCESS;
+
+    maxEvents = ioctlPtr->outBufSize / sizeof(Fsio_Event);
+    replyPtr->length = 0;
+    if (ioctlPtr->format != mach_Format || maxEvents <= 0) {
+	return(GEN_INVALID_ARG);
+    }
+    if (ioctlPtr->inBufSize != 0) {
+	Time timeout;
+	Timer_Ticks ticks;
+	Timer_Ticks currentTicks;
+
+	if (ioctlPtr->inBufSize != sizeof(Time)) {
+	    return(GEN_INVALID_ARG);
+	}
+	timeout = *(Time *)ioctlPtr->inBuffer;
+	if ((timeout.seconds < 0) ||
+	    ((timeout.seconds == 0) && (timeout.microseconds == 0))) {
+	    poll = TRUE;
+	} else {
+	    Timer_TimeToTicks(timeout, &ticks);
+	    Timer_GetCurrentTicks(&currentTicks);
+	    Timer_AddTicks(currentTicks, ticks, &(wakeupElement.time));
+	    doTimeout = TRUE;
+	}
+    }
+
+    wakeupInfo.timeOut = FALSE;
+    if (doTimeout) {
+	wakeupElement.routine = EventTimeout;
+	wakeupElement.clientData = (ClientData) &wakeupInfo;
+	wakeupInfo.procPtr = Proc_GetCurrentProc();
+	Timer_ScheduleRoutine(&wakeupElement, FALSE);
+    }
+
+    waiter.hostID = rpc_SpriteID;
+    while (TRUE) {
+	Sync_GetWaitToken(&waiter.pid, &waiter.waitToken);
+	if (wakeupInfo.timeOut) {
+	    status = FS_TIMEOUT;
+	    break;
+	}
+	EventBegin(handlePtr);
+	numReady = EventPoll(handlePtr, (Fsio_Event *)ioctlPtr->outBuffer,
+			     maxEvents);
+	if (numReady > 0 || poll) {
+	    EventEnd(handlePtr);
+	    break;
+	}
+	sleep = EventSleep(handlePtr, &waiter);
+	EventEnd(handlePtr);
+	if (sleep && Sync_ProcWait((Sync_Lock *) NIL, TRUE)) {
+	    status = GEN_ABORTED_BY_SIGNAL;
+	    break;
+	}
+    }
+
+    if (!wakeupInfo.timeOut && doTimeout) {
+	Timer_DescheduleRoutine(&wakeupElement);
+    }
+    if (status == SUCCESS) {
+	replyPtr->length = numReady * sizeof(Fsio_Event);
+    }
+    return(status);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EventTimeout --
+ *
+ *	Called from the Timer queue when an IOC_EVENT_WAIT times out.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The timeOut field is set to TRUE and the process is woken up.
+ *
+ *----------------------------------------------------------------------
+ */
+
+/*ARGSUSED*/
+static void
+EventTimeout(ticks, clientData)
+    Timer_Ticks	ticks;
+    ClientData	clientData;
+{
+    WakeupInfo	*wakeupInfoPtr = (WakeupInfo *) clientData;
+    wakeupInfoPtr->timeOut = TRUE;
+    Sync_ProcWakeup(wakeupInfoPtr->procPtr->processID,
+                    wakeupInfoPtr->procPtr->waitToken);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_EventSelect --
+ *
+ *	Select on an event set.  It is readable when some interest is
+ *	queued, which may turn out to be no longer ready when it is polled.
+ *
+ * Results:
+ *	SUCCESS.
+ *
+ * Side effects:
+ *	Puts the waiter on the readWaitList if nothing is queued.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ENTRY ReturnStatus
+Fsio_EventSelect(hdrPtr, waitPtr, readPtr, writePtr, exceptPtr)
+    Fs_HandleHeader *hdrPtr;	/* The handle of the set */
+    Sync_RemoteWaiter *waitPtr;	/* Process info for waiting */
+    int		*readPtr;	/* Read bit */
+    int		*writePtr;	/* Write bit */
+    int		*exceptPtr;	/* Exception bit */
+{
+    register Fsio_EventIOHandle *handlePtr = (Fsio_EventIOHandle *)hdrPtr;
+
+    LOCK_MONITOR;
+    *writePtr = 0;
+    *exceptPtr = 0;
+    if (*readPtr && List_IsEmpty(&handlePtr->readyList)) {
+	*readPtr = 0;
+	if (waitPtr != (Sync_RemoteWaiter *)NIL) {
+	    Fsutil_FastWaitListInsert(&handlePtr->readWaitList, waitPtr);
+	}
+    }
+    UNLOCK_MONITOR;
+    return(SUCCESS);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_EventClose --
+ *
+ *	Close an event set.  There is only ever one stream to a set, so
+ *	this removes every interest and the set itself.
+ *
+ * Results:
+ *	SUCCESS.
+ *
+ * Side effects:
+ *	Takes the set's waiters off the watched streams and removes
+ *	the handle.
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+ReturnStatus
+Fsio_EventClose(streamPtr, clientID, procID, flags, dataSize, closeData)
+    Fs_Stream		*streamPtr;	/* Stream to an event set */
+    int			clientID;	/* Host ID of closing process */
+    Proc_PID		procID;		/* Process closing */
+    int			flags;		/* Flags from the stream */
+    int			dataSize;	/* Should be 0 */
+    ClientData		closeData;	/* Should be NIL */
+{
+    register Fsio_EventIOHandle *handlePtr =
+	    (Fsio_EventIOHandle *)streamPtr->ioHandlePtr;
+    register FsioEventInterest *interestPtr;
+
+    EventBegin(handlePtr);
+    while (!List_IsEmpty(&handlePtr->interestList)) {
+	interestPtr = (FsioEventInterest *)List_First(&handlePtr->interestList);
+	EventRemove(interestPtr);
+	Fsutil_HandleLock(interestPtr->streamPtr->ioHandlePtr);
+	EventDisarm(interestPtr);
+	Fsutil_HandleUnlock(interestPtr->streamPtr->ioHandlePtr);
+	free((Address)interestPtr);
+    }
+    EventEnd(handlePtr);
+    Fsutil_WaitListDelete(&handlePtr->readWaitList);
+    Fsutil_HandleRelease(handlePtr, FALSE);
+    Fsutil_HandleRemove(handlePtr);
+    return(SUCCESS);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_EventScavenge --
+ *
+ *	Event sets are removed when their stream is closed, never by
+ *	the scavenger.
+ *
+ * Results:
+ *	FALSE.
+ *
+ * Side effects:
+ *	Unlocks the handle.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Boolean
+Fsio_EventScavenge(hdrPtr)
+    Fs_HandleHeader *hdrPtr;
+{
+    Fsutil_HandleUnlock(hdrPtr);
+    return(FALSE);
+}
@@ -0,0 +1,110 @@
+/*
+ * fsioEvent.h --
+ *
+ *	Declarations for event sets.  An event set is an anonymous stream
+ *	that holds a persistent list of streams a process is interested
+ *	in.  Readiness is posted to the set by the wait list notify
+ *	routines, so waiting on the set costs time in proportion to the
+ *	number of streams that became ready, not the number registered.
+ *
+ * Copyright 1990 Regents of the University of California
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ *
+ * $Header$ SPRITE (Berkeley)
+ */
+
+#ifndef _FSIOEVENT
+#define _FSIOEVENT
+
+#include <fsio.h>
+
+/*
+ * I/O controls on an event set.  IOC_EVENT_CTL takes an Fsio_EventCtl
+ * in the input buffer and adds, changes or deletes the interest in one
+ * stream.  IOC_EVENT_WAIT takes an optional Time in the input buffer as
+ * a timeout, with no input meaning wait forever and a zero time meaning
+ * poll.  It fills the output buffer with an Fsio_Event for each ready
+ * stream, up to as many as fit, and returns FS_TIMEOUT if none became
+ * ready in time.
+ */
+#ifndef IOC_EVENT_CTL
+#define	IOC_EVENT		(22 << 16)
+#define	IOC_EVENT_CTL		(IOC_EVENT | 1)
+#define	IOC_EVENT_WAIT		(IOC_EVENT | 2)
+#endif
+
+/*
+ * Operations for Fsio_EventCtl.
+ */
+#define	FSIO_EVENT_ADD		1
+#define	FSIO_EVENT_MODIFY	2
+#define	FSIO_EVENT_DELETE	3
+
+/*
+ * The events of an interest are FS_READABLE, FS_WRITABLE and
+ * FS_EXCEPTION, the same bits that Fs_Select uses.  An interest is
+ * level-triggered unless FSIO_EVENT_EDGE is also given, in which case
+ * it is reported when its stream becomes ready and not again until
+ * the stream has been seen not ready.
+ */
+#define	FSIO_EVENT_EDGE		0x1000
+
+typedef struct Fsio_EventCtl {
+    int		operation;	/* FSIO_EVENT_ADD, _MODIFY or _DELETE. */
+    int		streamID;	/* Stream of the caller to watch. */
+    int		events;		/* Wanted, plus FSIO_EVENT_EDGE. */
+    ClientData	clientData;	/* Returned in each Fsio_Event. */
+} Fsio_EventCtl;
+
+typedef struct Fsio_Event {
+    int		events;		/* Events that are ready. */
+    ClientData	clientData;	/* From the Fsio_EventCtl. */
+} Fsio_Event;
+
+/*
+ * The I/O handle for an event set: FSIO_EVENT_STREAM.  The interests
+ * themselves are private to fsioEvent.c.
+ */
+typedef struct Fsio_EventIOHandle {
+    Fs_HandleHeader	hdr;		/* Standard handle header. The 'minor'
+					 * field of the fileID is a creation
+					 * count, 'major' is unused. */
+    List_Links		interestList;	/* Every interest in the set. */
+    List_Links		readyList;	/* Interests to poll in the next
+					 * wait, in the order notified. */
+    List_Links		rearmList;	/* Edge-triggered interests that were
+					 * reported and are not yet re-armed.*/
+    List_Links		readWaitList;	/* Processes waiting for the set to
+					 * become ready, by IOC_EVENT_WAIT or
+					 * by selecting the set itself. */
+    Boolean		busy;		/* An operation is using the set. */
+    Sync_Condition	idle;		/* Notified when busy is cleared. */
+    int			numInterests;	/* Length of interestList. */
+} Fsio_EventIOHandle;
+
+extern ReturnStatus Fsio_CreateEventSet _ARGS_((Fs_Stream **streamPtrPtr));
+extern Boolean Fsio_EventNotify _ARGS_((Proc_PID pid, int waitToken));
+extern void Fsio_EventArmed _ARGS_((Sync_RemoteWaiter *waitPtr,
+	List_Links *list));
+extern void Fsio_EventStreamClose _ARGS_((Fs_Stream *streamPtr));
+
+/*
+ * Stream operations.
+ */
+extern ReturnStatus Fsio_EventIOControl _ARGS_((Fs_Stream *streamPtr,
+	Fs_IOCParam *ioctlPtr, Fs_IOReply *replyPtr));
+extern ReturnStatus Fsio_EventSelect _ARGS_((Fs_HandleHeader *hdrPtr,
+	Sync_RemoteWaiter *waitPtr, int *readPtr, int *writePtr,
+	int *exceptPtr));
+extern Boolean Fsio_EventScavenge _ARGS_((Fs_HandleHeader *hdrPtr));
+extern ReturnStatus Fsio_EventClose _ARGS_((Fs_Stream *streamPtr,
+	int clientID, Proc_PID procID, int flags, int dataSize,
+	ClientData closeData));
+
+#endif /* _FSIOEVENT */
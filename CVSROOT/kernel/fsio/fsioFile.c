@@ -148,6 +148,7 @@ Fsio_LocalFileHandleInit(fileIDPtr, name, descPtr, cantBlock, newHandlePtrPtr)
 	Fscache_ReadAheadInit(&handlePtr->readAhead);
 
 	handlePtr->segPtr = (Vm_Segment *)NIL;
+	handlePtr->dirIndexPtr = (struct FslclDirIndex *)NIL;
     }
     if (status != SUCCESS) {
 	Fsutil_HandleRelease(handlePtr, FALSE);
@@ -175,7 +176,8 @@ Fsio_LocalFileHandleInit(fileIDPtr, name, descPtr, cantBlock, newHandlePtrPtr)
  *
  *	This takes care of the dynamically allocated Sync_Lock's that
  *	are embedded in a Fsio_FileIOHandle.  This routine is
- *	called when the file handle is being removed.
+ *	called when the file handle is being removed, so it also
+ *	frees the index of a large directory and the lock state.
  *
  * Results:
  *	None.
@@ -193,6 +195,8 @@ Fsio_FileSyncLockCleanup(handlePtr)
     Fsconsist_SyncLockCleanup(&handlePtr->consist);
     Fscache_InfoSyncLockCleanup(&handlePtr->cacheInfo);
     Fscache_ReadAheadSyncLockCleanup(&handlePtr->readAhead);
+    Fslcl_DirIndexFree(handlePtr);
+    Fsio_LockCleanup(&handlePtr->lock);
 }
 
 /*
@@ -1489,6 +1493,12 @@ Fsio_FileIOControl(streamPtr, ioctlPtr, replyPtr)
 	    status = Fsio_IocLock(&handlePtr->lock, ioctlPtr,
 				&streamPtr->hdr.fileID);
 	    break;
+	case IOC_RANGE_LOCK_SET:
+	case IOC_RANGE_LOCK_UNLOCK:
+	case IOC_RANGE_LOCK_TEST:
+	    status = Fsio_IocRangeLock(&handlePtr->lock, ioctlPtr,
+				&streamPtr->hdr.fileID, replyPtr);
+	    break;
 	case IOC_NUM_READABLE: {
 	    /*
 	     * Return the number of bytes available to read.  The top-level
@@ -100,6 +100,9 @@ typedef struct Fsio_FileIOHandle {
 					 * with other I/O and closes/deletes. */
     struct Vm_Segment	*segPtr;	/* Reference to code segment needed
 					 * to flush VM cache. */
+    struct FslclDirIndex *dirIndexPtr;	/* Hashed index of a large
+					 * directory, or NIL.  Managed by
+					 * fslclDirIndex.c */
 } Fsio_FileIOHandle;			/* 268 BYTES (316 with traced locks) */
 
 /*
@@ -9,6 +9,13 @@
  *	held file locks.  Synchronization over these routines is assumed
  *	to be done by the caller via Fsutil_HandleLock.
  *
+ *	Byte-range locks are kept on the same ownership list, and also in
+ *	an interval tree so that finding the locks that overlap a range
+ *	does not mean looking at every lock on the file.  The tree is a
+ *	treap ordered by the first byte of each range, and each node
+ *	records the largest last byte in its subtree so whole subtrees
+ *	that end before a range can be skipped.
+ *
  * Copyright (C) 1986 Regents of the University of California
  * All rights reserved.
  */
@@ -26,6 +33,7 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include <proc.h>
 #include <rpc.h>
 #include <net.h>
+#include <timer.h>
 
 #include <stdio.h>
 
@@ -48,7 +56,107 @@ typedef struct FsLockOwner {
     int procID;			/* ProcessID of owning process */
     Fs_FileID streamID;		/* Stream on which lock call was made */
     int flags;			/* IOC_LOCK_EXCLUSIVE, IOC_LOCK_SHARED */
+    /*
+     * The rest is only used by byte-range locks.
+     */
+    Boolean range;		/* TRUE if this is a byte-range lock */
+    int start;			/* First byte locked */
+    int end;			/* Last byte locked, FSIO_LOCK_EOF for all
+				 * bytes to the end of the file */
+    int maxEnd;			/* Largest end in this subtree */
+    unsigned int priority;	/* Random treap priority.  A node's priority
+				 * is never less than its children's. */
+    struct FsLockOwner *leftPtr;	/* Ranges that start before this one */
+    struct FsLockOwner *rightPtr;	/* Ranges that start after this one */
 } FsLockOwner;
+
+#define	FSIO_LOCK_EOF	0x7fffffff
+
+/*
+ * A process waiting for a byte range.  It is only woken up when a lock
+ * that overlaps the range it wants is released.
+ */
+typedef struct FsLockWaiter {
+    Sync_RemoteWaiter wait;	/* Must be first, it has the list links */
+    Fs_FileID streamID;		/* Stream on which lock call was made */
+    int start;			/* First byte wanted */
+    int end;			/* Last byte wanted */
+} FsLockWaiter;
+
+/*
+ * A byte-range lock that could not be reclaimed after its server
+ * rebooted.  The client keeps one of these for each owner and stream
+ * that lost locks, and the owner's next byte-range lock operation on
+ * the stream fails so that it learns the lock is gone.
+ */
+typedef struct FsLockLost {
+    List_Links links;		/* A list of these hangs from Fsio_LockState */
+    int hostID;			/* SpriteID of process that lost it */
+    int procID;			/* ProcessID of that process */
+    Fs_FileID streamID;		/* Stream the lock was made through */
+    int flags;			/* IOC_LOCK_EXCLUSIVE, IOC_LOCK_SHARED */
+} FsLockLost;
+
+/*
+ * The reclaim window after this host reboots as a file server.  It
+ * starts when the first local domain is attached after booting, and
+ * lasts for fsio_LockGraceSeconds.  Reopens never start it again.
+ * Until it ends only byte-range locks marked IOC_LOCK_RECLAIM are
+ * granted.  Other processes that would block wait on graceWaitList,
+ * and are all woken up when the window ends.
+ */
+int fsio_LockGraceSeconds = 60;
+
+static Sync_Lock lockGraceLock = Sync_LockInitStatic("Fs:lockGraceLock");
+#define LOCKPTR (&lockGraceLock)
+
+#define GRACE_NOT_STARTED	0
+#define GRACE_ACTIVE		1
+#define GRACE_OVER		2
+static int lockGraceState = GRACE_NOT_STARTED;
+static List_Links graceWaitList;
+
+/*
+ * Total order on the nodes of the interval tree.  Ranges that start at
+ * the same byte are ordered by address so that a node can always be
+ * found again to delete it.
+ */
+#define OWNER_BEFORE(aPtr, bPtr) \
+    ((aPtr)->start < (bPtr)->start || \
+     ((aPtr)->start == (bPtr)->start && (Address)(aPtr) < (Address)(bPtr)))
+
+static unsigned int lockSeed = 1;
+
+static void UpdateMaxEnd _ARGS_((FsLockOwner *nodePtr));
+static FsLockOwner *RotateLeft _ARGS_((FsLockOwner *nodePtr));
+static FsLockOwner *RotateRight _ARGS_((FsLockOwner *nodePtr));
+static FsLockOwner *TreeInsert _ARGS_((FsLockOwner *rootPtr,
+			FsLockOwner *nodePtr));
+static FsLockOwner *TreeMerge _ARGS_((FsLockOwner *leftPtr,
+			FsLockOwner *rightPtr));
+static FsLockOwner *TreeDelete _ARGS_((FsLockOwner *rootPtr,
+			FsLockOwner *nodePtr));
+static FsLockOwner *FindOverlap _ARGS_((FsLockOwner *nodePtr, int start,
+			int end, int hostID, int procID, int flags,
+			Boolean own));
+static ReturnStatus GetRange _ARGS_((Fsio_RangeLockArgs *argPtr,
+			int *startPtr, int *endPtr));
+static void AddRangeOwner _ARGS_((Fsio_LockState *lockPtr, int hostID,
+			int procID, Fs_FileID *streamIDPtr, int flags,
+			int start, int end));
+static void RemoveRangeOwner _ARGS_((Fsio_LockState *lockPtr,
+			FsLockOwner *lockOwnerPtr));
+static Boolean ReleaseRange _ARGS_((Fsio_LockState *lockPtr, int hostID,
+			int procID, int start, int end));
+static void NotifyRange _ARGS_((Fsio_LockState *lockPtr, int start,
+			int end));
+static int RemoveLostLocks _ARGS_((Fsio_LockState *lockPtr,
+			int hostID, int procID, Fs_FileID *streamIDPtr));
+static void RemoveRangeWaiters _ARGS_((Fsio_LockState *lockPtr,
+			int hostID, int procID, Fs_FileID *streamIDPtr));
+static Boolean LockGraceWait _ARGS_((Fsio_RangeLockArgs *argPtr));
+static void LockGraceEnd _ARGS_((ClientData data,
+			Proc_CallInfo *callInfoPtr));
 
 /*
  *----------------------------------------------------------------------
@@ -74,6 +182,10 @@ Fsio_LockInit(lockPtr)
     List_Init(&lockPtr->ownerList);
     lockPtr->flags = 0;
     lockPtr->numShared = 0;
+    lockPtr->rangeRoot = (FsLockOwner *)NIL;
+    List_Init(&lockPtr->rangeWaitList);
+    lockPtr->numRanges = 0;
+    List_Init(&lockPtr->lostList);
 }
 
 /*
@@ -200,6 +312,7 @@ Fsio_Lock(lockPtr, argPtr, streamIDPtr)
 	    lockOwnerPtr->streamID.type = -1;
 	}
 	lockOwnerPtr->flags = operation & (IOC_LOCK_EXCLUSIVE|IOC_LOCK_SHARED);
+	lockOwnerPtr->range = FALSE;
 	List_Insert((List_Links *)lockOwnerPtr,
 		    LIST_ATREAR(&lockPtr->ownerList));
 	if (fsio_LockDebug) {
@@ -261,6 +374,9 @@ Fsio_Unlock(lockPtr, argPtr, streamIDPtr)
     if (operation & IOC_LOCK_EXCLUSIVE) {
 	if (lockPtr->flags & IOC_LOCK_EXCLUSIVE) {
 	    LIST_FORALL(&lockPtr->ownerList, (List_Links *)lockOwnerPtr) {
+		if (lockOwnerPtr->range) {
+		    continue;
+		}
 		if ((lockOwnerPtr->procID == argPtr->pid) ||
 		    (streamIDPtr != (Fs_FileID *)NIL &&
 		     lockOwnerPtr->streamID.major == streamIDPtr->major &&
@@ -276,9 +392,13 @@ Fsio_Unlock(lockPtr, argPtr, streamIDPtr)
 		/*
 		 * Oops, unlocking process didn't match lock owner.
 		 */
-		if (!List_IsEmpty(&lockPtr->ownerList)) {
-		    lockOwnerPtr =
-			(FsLockOwner *)List_First(&lockPtr->ownerList);
+		LIST_FORALL(&lockPtr->ownerList, (List_Links *)lockOwnerPtr) {
+		    if (!lockOwnerPtr->range) {
+			break;
+		    }
+		}
+		if (!List_IsAtEnd(&lockPtr->ownerList,
+			(List_Links *)lockOwnerPtr)) {
 #ifdef notdef
 		    printf("Fsio_Unlock, non-owner <%x> unlocked, owner <%x>\n",
 			argPtr->pid, lockOwnerPtr->procID);
@@ -298,6 +418,9 @@ Fsio_Unlock(lockPtr, argPtr, streamIDPtr)
 	    status = FAILURE;
 	    lockPtr->numShared--;
 	    LIST_FORALL(&lockPtr->ownerList, (List_Links *)lockOwnerPtr) {
+		if (lockOwnerPtr->range) {
+		    continue;
+		}
 		if ((lockOwnerPtr->procID == argPtr->pid) ||
 		    (streamIDPtr != (Fs_FileID *)NIL &&
 		     lockOwnerPtr->streamID.major == streamIDPtr->major &&
@@ -350,13 +473,16 @@ Fsio_Unlock(lockPtr, argPtr, streamIDPtr)
  * Fsio_LockClose --
  *
  *	Check that the stream owns a lock on this file,
- *	and if it does then break that lock.
+ *	and if it does then break that lock.  All the byte-range locks
+ *	made through the stream are released too, and processes still
+ *	waiting for a range through the stream, or that lost a range
+ *	held through it, are forgotten.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	Cleans up the lock and frees owner information.
+ *	Cleans up the lock and frees owner and waiter information.
  *
  *----------------------------------------------------------------------
  */
@@ -367,25 +493,43 @@ Fsio_LockClose(lockPtr, streamIDPtr)
     Fs_FileID *streamIDPtr;		/* Stream being closed */
 {
     register FsLockOwner *lockOwnerPtr;
+    register FsLockOwner *nextOwnerPtr;
+    Boolean flockClosed = FALSE;
+    int start, end;
 
-    LIST_FORALL(&lockPtr->ownerList, (List_Links *)lockOwnerPtr) {
-	if (streamIDPtr != (Fs_FileID *)NIL &&
-	    lockOwnerPtr->streamID.major == streamIDPtr->major &&
-	    lockOwnerPtr->streamID.minor == streamIDPtr->minor &&
-	    lockOwnerPtr->streamID.serverID == streamIDPtr->serverID) {
-	    if (fsio_LockDebug) {
-		printf("Stream <%d,%d> Lock Closed %x\n",
-		    streamIDPtr->major, streamIDPtr->minor,
-		    lockOwnerPtr->flags);
-	    }
+    if (streamIDPtr == (Fs_FileID *)NIL) {
+	return;
+    }
+    nextOwnerPtr = (FsLockOwner *)List_First(&lockPtr->ownerList);
+    while (!List_IsAtEnd(&lockPtr->ownerList, (List_Links *)nextOwnerPtr)) {
+	lockOwnerPtr = nextOwnerPtr;
+	nextOwnerPtr = (FsLockOwner *)List_Next((List_Links *)lockOwnerPtr);
+	if (lockOwnerPtr->streamID.major != streamIDPtr->major ||
+	    lockOwnerPtr->streamID.minor != streamIDPtr->minor ||
+	    lockOwnerPtr->streamID.serverID != streamIDPtr->serverID) {
+	    continue;
+	}
+	if (fsio_LockDebug) {
+	    printf("Stream <%d,%d> Lock Closed %x\n",
+		streamIDPtr->major, streamIDPtr->minor,
+		lockOwnerPtr->flags);
+	}
+	if (lockOwnerPtr->range) {
+	    start = lockOwnerPtr->start;
+	    end = lockOwnerPtr->end;
+	    RemoveRangeOwner(lockPtr, lockOwnerPtr);
+	    NotifyRange(lockPtr, start, end);
+	} else if (!flockClosed) {
 	    lockPtr->flags &= ~lockOwnerPtr->flags;
 	    List_Remove((List_Links *)lockOwnerPtr);
 	    free((Address)lockOwnerPtr);
 	    Fsutil_FastWaitListNotify(&lockPtr->waitList);
 	    Fsutil_WaitListDelete(&lockPtr->waitList);
-	    break;
+	    flockClosed = TRUE;
 	}
     }
+    RemoveRangeWaiters(lockPtr, -1, -1, streamIDPtr);
+    (void)RemoveLostLocks(lockPtr, -1, -1, streamIDPtr);
 }
 
 /*
@@ -401,7 +545,8 @@ Fsio_LockClose(lockPtr, streamIDPtr)
  *	None.
  *
  * Side effects:
- *	Releases locks held by processes on the client.
+ *	Releases locks held by processes on the client, and forgets
+ *	its processes that were waiting for byte ranges.
  *
  *----------------------------------------------------------------------
  */
@@ -414,13 +559,24 @@ Fsio_LockClientKill(lockPtr, clientID)
     register FsLockOwner *lockOwnerPtr;
     register FsLockOwner *nextOwnerPtr;
     register Boolean breakLock = FALSE;
+    int start, end;
 
     nextOwnerPtr = (FsLockOwner *)List_First(&lockPtr->ownerList);
     while (!List_IsAtEnd(&lockPtr->ownerList, (List_Links *)nextOwnerPtr)) {
 	lockOwnerPtr = nextOwnerPtr;
 	nextOwnerPtr = (FsLockOwner *)List_Next((List_Links *)lockOwnerPtr);
 
-	if (lockOwnerPtr->hostID == clientID) {
+	if (lockOwnerPtr->hostID == clientID && lockOwnerPtr->range) {
+	    if (fsio_LockDebug) {
+		printf("Stream <%d,%d> Range Lock Broken Client %d\n",
+		    lockOwnerPtr->streamID.major, lockOwnerPtr->streamID.minor,
+		    clientID);
+	    }
+	    start = lockOwnerPtr->start;
+	    end = lockOwnerPtr->end;
+	    RemoveRangeOwner(lockPtr, lockOwnerPtr);
+	    NotifyRange(lockPtr, start, end);
+	} else if (lockOwnerPtr->hostID == clientID) {
 	    breakLock = TRUE;
 	    lockPtr->flags &= ~lockOwnerPtr->flags;
 	    if (fsio_LockDebug) {
@@ -435,5 +591,1172 @@ Fsio_LockClientKill(lockPtr, clientID)
     if (breakLock) {
 	Fsutil_FastWaitListNotify(&lockPtr->waitList);
     }
+    RemoveRangeWaiters(lockPtr, clientID, -1, (Fs_FileID *)NIL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_LockCleanup --
+ *
+ *	Free the lock state of a handle that is being removed.  There
+ *	should be no locks left by now, since every stream has been
+ *	closed, but processes may still be on the wait lists.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the owners, waiters and lost lock records.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Fsio_LockCleanup(lockPtr)
+    register Fsio_LockState *lockPtr;	/* Locking state for the file. */
+{
+    register FsLockOwner *lockOwnerPtr;
+
+    while (!List_IsEmpty(&lockPtr->ownerList)) {
+	lockOwnerPtr = (FsLockOwner *)List_First(&lockPtr->ownerList);
+	if (lockOwnerPtr->range) {
+	    RemoveRangeOwner(lockPtr, lockOwnerPtr);
+	} else {
+	    List_Remove((List_Links *)lockOwnerPtr);
+	    free((Address)lockOwnerPtr);
+	}
+    }
+    lockPtr->flags = 0;
+    lockPtr->numShared = 0;
+    Fsutil_WaitListDelete(&lockPtr->waitList);
+    RemoveRangeWaiters(lockPtr, -1, -1, (Fs_FileID *)NIL);
+    (void)RemoveLostLocks(lockPtr, -1, -1, (Fs_FileID *)NIL);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_IocRangeLock --
+ *
+ *	Top-level routine for the byte-range lock I/O controls.  This
+ *	handles byte swapping of the arguments, and of the conflicting
+ *	lock returned by IOC_RANGE_LOCK_TEST.
+ *
+ * Results:
+ *	SUCCESS, FS_WOULD_BLOCK or GEN_INVALID_ARG.
+ *
+ * Side effects:
+ *	See Fsio_RangeLock and Fsio_RangeUnlock.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ReturnStatus
+Fsio_IocRangeLock(lockPtr, ioctlPtr, streamIDPtr, replyPtr)
+    register Fsio_LockState *lockPtr;	/* Locking state for a file. */
+    Fs_IOCParam *ioctlPtr;		/* I/O control parameter block */
+    Fs_FileID	*streamIDPtr;		/* ID of stream associated with lock */
+    Fs_IOReply	*replyPtr;		/* Return length of test result */
+{
+    register ReturnStatus status = SUCCESS;
+    Fsio_RangeLockArgs lockArgs;
+
+    if (ioctlPtr->format != mach_Format) {
+	int size = sizeof(Fsio_RangeLockArgs);
+	int inSize = ioctlPtr->inBufSize;
+	int fmtStatus;
+	fmtStatus = Fmt_Convert("w6", ioctlPtr->format, &inSize, 
+			ioctlPtr->inBuffer, mach_Format, &size, 
+			(Address) &lockArgs);
+	if (fmtStatus != 0) {
+	    printf("Format of ioctl failed <0x%x>\n", fmtStatus);
+	    status = GEN_INVALID_ARG;
+	}
+	if (size != sizeof(Fsio_RangeLockArgs)) {
+	    status = GEN_INVALID_ARG;
+	}
+    } else if (ioctlPtr->inBufSize < sizeof(Fsio_RangeLockArgs)) {
+	status = GEN_INVALID_ARG;
+    } else {
+	lockArgs = *(Fsio_RangeLockArgs *)ioctlPtr->inBuffer;
+    }
+    if (status != SUCCESS) {
+	return(status);
+    }
+    switch (ioctlPtr->command) {
+	case IOC_RANGE_LOCK_SET:
+	    status = Fsio_RangeLock(lockPtr, &lockArgs, streamIDPtr);
+	    break;
+	case IOC_RANGE_LOCK_UNLOCK:
+	    status = Fsio_RangeUnlock(lockPtr, &lockArgs);
+	    break;
+	case IOC_RANGE_LOCK_TEST:
+	    if (ioctlPtr->outBufSize < sizeof(Fsio_RangeLockArgs)) {
+		status = GEN_INVALID_ARG;
+		break;
+	    }
+	    status = Fsio_RangeLockTest(lockPtr, &lockArgs);
+	    if (status != SUCCESS) {
+		break;
+	    }
+	    if (ioctlPtr->format != mach_Format) {
+		int size = ioctlPtr->outBufSize;
+		int inSize = sizeof(Fsio_RangeLockArgs);
+		int fmtStatus;
+		fmtStatus = Fmt_Convert("w6", mach_Format, &inSize,
+			    (Address) &lockArgs, ioctlPtr->format, &size,
+			    ioctlPtr->outBuffer);
+		if (fmtStatus != 0) {
+		    printf("Format of ioctl failed <0x%x>\n", fmtStatus);
+		    status = GEN_INVALID_ARG;
+		}
+		replyPtr->length = size;
+	    } else {
+		*(Fsio_RangeLockArgs *)ioctlPtr->outBuffer = lockArgs;
+		replyPtr->length = sizeof(Fsio_RangeLockArgs);
+	    }
+	    break;
+	default:
+	    status = GEN_INVALID_ARG;
+	    break;
+    }
+    return(status);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_RangeLock --
+ *
+ *	Try to lock a byte range.  If another process holds a conflicting
+ *	lock on any part of the range then the caller is added to the
+ *	range wait list, unless it asked not to block, and FS_WOULD_BLOCK
+ *	is returned.  Otherwise any locks the caller already holds within
+ *	the range are replaced by the new one.  A request that does not
+ *	wait takes the caller off the range wait list, which is how an
+ *	aborted wait is cancelled.  While the server is in its reclaim
+ *	window only IOC_LOCK_RECLAIM requests are granted.
+ *
+ * Results:
+ *	SUCCESS, FS_WOULD_BLOCK or GEN_INVALID_ARG.
+ *
+ * Side effects:
+ *	Adds to the interval tree and the ownership list.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ReturnStatus
+Fsio_RangeLock(lockPtr, argPtr, streamIDPtr)
+    register Fsio_LockState *lockPtr;	/* Locking state for a file. */
+    register Fsio_RangeLockArgs *argPtr;	/* Range, type and owner */
+    Fs_FileID	*streamIDPtr;		/* Stream that owns the lock */
+{
+    ReturnStatus status;
+    int start, end;
+    int type;
+    register FsLockWaiter *waiterPtr;
+
+    status = GetRange(argPtr, &start, &end);
+    if (status != SUCCESS) {
+	return(status);
+    }
+    if (argPtr->flags & IOC_LOCK_EXCLUSIVE) {
+	type = IOC_LOCK_EXCLUSIVE;
+    } else if (argPtr->flags & IOC_LOCK_SHARED) {
+	type = IOC_LOCK_SHARED;
+    } else {
+	return(GEN_INVALID_ARG);
+    }
+    if ((argPtr->flags & IOC_LOCK_RECLAIM) == 0 && LockGraceWait(argPtr)) {
+	if (fsio_LockDebug) {
+	    printf("Range <%d..%d> held back for reclaims, proc %x\n",
+		start, end, argPtr->pid);
+	}
+	return(FS_WOULD_BLOCK);
+    }
+    if (FindOverlap(lockPtr->rangeRoot, start, end, argPtr->hostID,
+		argPtr->pid, type, FALSE) == (FsLockOwner *)NIL) {
+	RemoveRangeWaiters(lockPtr, argPtr->hostID, argPtr->pid,
+		    (Fs_FileID *)NIL);
+	/*
+	 * Replace whatever part of the range the caller already holds.
+	 * Turning an exclusive lock into a shared one may let readers in.
+	 */
+	if (ReleaseRange(lockPtr, argPtr->hostID, argPtr->pid, start, end) &&
+	    type == IOC_LOCK_SHARED) {
+	    NotifyRange(lockPtr, start, end);
+	}
+	AddRangeOwner(lockPtr, argPtr->hostID, argPtr->pid, streamIDPtr,
+		    type, start, end);
+	if (fsio_LockDebug) {
+	    printf("Range <%d..%d> locked %x by proc %x\n", start, end,
+		type, argPtr->pid);
+	}
+	return(SUCCESS);
+    }
+    if (argPtr->flags & IOC_LOCK_NO_BLOCK) {
+	RemoveRangeWaiters(lockPtr, argPtr->hostID, argPtr->pid,
+		    (Fs_FileID *)NIL);
+	return(FS_WOULD_BLOCK);
+    }
+    if (argPtr->hostID > NET_NUM_SPRITE_HOSTS) {
+	printf("Fsio_RangeLock: bad hostID %d.\n", argPtr->hostID);
+	return(FS_WOULD_BLOCK);
+    }
+    fsio_NumLockWaits++;
+    LIST_FORALL(&lockPtr->rangeWaitList, (List_Links *)waiterPtr) {
+	if (waiterPtr->wait.pid == argPtr->pid &&
+	    waiterPtr->wait.hostID == argPtr->hostID) {
+	    break;
+	}
+    }
+    if (List_IsAtEnd(&lockPtr->rangeWaitList, (List_Links *)waiterPtr)) {
+	waiterPtr = mnew(FsLockWaiter);
+	List_InitElement((List_Links *)waiterPtr);
+	waiterPtr->wait.hostID = argPtr->hostID;
+	waiterPtr->wait.pid = argPtr->pid;
+	List_Insert((List_Links *)waiterPtr,
+		    LIST_ATREAR(&lockPtr->rangeWaitList));
+    }
+    waiterPtr->wait.waitToken = argPtr->token;
+    if (streamIDPtr != (Fs_FileID *)NIL) {
+	waiterPtr->streamID = *streamIDPtr;
+    } else {
+	waiterPtr->streamID.type = -1;
+    }
+    waiterPtr->start = start;
+    waiterPtr->end = end;
+    if (fsio_LockDebug) {
+	printf("Range <%d..%d> Blocked, proc %x\n", start, end, argPtr->pid);
+    }
+    return(FS_WOULD_BLOCK);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_RangeUnlock --
+ *
+ *	Release the caller's locks within a byte range.  Parts of its
+ *	locks outside the range are kept.  It is not an error to unlock
+ *	bytes that are not locked.
+ *
+ * Results:
+ *	SUCCESS or GEN_INVALID_ARG.
+ *
+ * Side effects:
+ *	Updates the interval tree and wakes up the processes waiting for
+ *	bytes in the range.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ReturnStatus
+Fsio_RangeUnlock(lockPtr, argPtr)
+    register Fsio_LockState *lockPtr;	/* Locking state for a file. */
+    register Fsio_RangeLockArgs *argPtr;	/* Range and owner */
+{
+    ReturnStatus status;
+    int start, end;
+
+    status = GetRange(argPtr, &start, &end);
+    if (status != SUCCESS) {
+	return(status);
+    }
+    if (ReleaseRange(lockPtr, argPtr->hostID, argPtr->pid, start, end)) {
+	NotifyRange(lockPtr, start, end);
+	if (fsio_LockDebug) {
+	    printf("Range <%d..%d> Unlocked, proc %x\n", start, end,
+		argPtr->pid);
+	}
+    }
+    return(SUCCESS);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_RangeLockTest --
+ *
+ *	See if a byte-range lock could be granted.
+ *
+ * Results:
+ *	SUCCESS or GEN_INVALID_ARG.  The arguments are overwritten with
+ *	the first conflicting lock, or their flags are set to zero if
+ *	the lock could be granted.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ReturnStatus
+Fsio_RangeLockTest(lockPtr, argPtr)
+    register Fsio_LockState *lockPtr;	/* Locking state for a file. */
+    register Fsio_RangeLockArgs *argPtr;	/* In: lock wanted,
+						 * Out: conflicting lock */
+{
+    ReturnStatus status;
+    int start, end;
+    int type;
+    register FsLockOwner *conflictPtr;
+
+    status = GetRange(argPtr, &start, &end);
+    if (status != SUCCESS) {
+	return(status);
+    }
+    if (argPtr->flags & IOC_LOCK_EXCLUSIVE) {
+	type = IOC_LOCK_EXCLUSIVE;
+    } else if (argPtr->flags & IOC_LOCK_SHARED) {
+	type = IOC_LOCK_SHARED;
+    } else {
+	return(GEN_INVALID_ARG);
+    }
+    conflictPtr = FindOverlap(lockPtr->rangeRoot, start, end,
+		argPtr->hostID, argPtr->pid, type, FALSE);
+    if (conflictPtr == (FsLockOwner *)NIL) {
+	argPtr->flags = 0;
+    } else {
+	argPtr->flags = conflictPtr->flags;
+	argPtr->hostID = conflictPtr->hostID;
+	argPtr->pid = conflictPtr->procID;
+	argPtr->offset = conflictPtr->start;
+	if (conflictPtr->end == FSIO_LOCK_EOF) {
+	    argPtr->length = 0;
+	} else {
+	    argPtr->length = conflictPtr->end - conflictPtr->start + 1;
+	}
+    }
+    return(SUCCESS);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_RangeLockHeld --
+ *
+ *	See if a process holds a lock on any part of a byte range.
+ *	Clients use this on their shadow of a remote file's locks to
+ *	avoid asking the server to unlock what is not locked.
+ *
+ * Results:
+ *	TRUE if the owner in the arguments holds a lock in the range,
+ *	or if the range is invalid so the caller reports the error.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Boolean
+Fsio_RangeLockHeld(lockPtr, argPtr)
+    register Fsio_LockState *lockPtr;	/* Locking state for a file. */
+    register Fsio_RangeLockArgs *argPtr;	/* Range and owner */
+{
+    int start, end;
+
+    if (GetRange(argPtr, &start, &end) != SUCCESS) {
+	return(TRUE);
+    }
+    return(FindOverlap(lockPtr->rangeRoot, start, end, argPtr->hostID,
+		argPtr->pid, 0, TRUE) != (FsLockOwner *)NIL);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_LockReopen --
+ *
+ *	Re-establish the byte-range locks on the ownership list.  This is
+ *	used by clients, which shadow the locks their processes hold on
+ *	remote files, after the file server reboots.  Each lock is passed
+ *	to the reopen procedure, which reclaims it with the server without
+ *	blocking.  The server grants only reclaims for a while after it
+ *	boots, so a lock is lost only if the client missed that window.
+ *	A lost lock is remembered so that its owner's next byte-range
+ *	lock operation on the stream fails, see Fsio_RangeLockLost.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Calls the reopen procedure.  Lost locks are removed and recorded
+ *	on the lost list.  Locks are kept if the server went away again,
+ *	to be reclaimed when it comes back.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Fsio_LockReopen(lockPtr, reopenProc, clientData)
+    register Fsio_LockState *lockPtr;	/* Locking state for the file. */
+    Fsio_LockReopenProc reopenProc;	/* Asserts one lock with the server */
+    ClientData clientData;		/* Passed to reopenProc */
+{
+    register FsLockOwner *lockOwnerPtr;
+    register FsLockOwner *nextOwnerPtr;
+    register FsLockLost *lostPtr;
+    Fsio_RangeLockArgs lockArgs;
+    ReturnStatus status;
+
+    nextOwnerPtr = (FsLockOwner *)List_First(&lockPtr->ownerList);
+    while (!List_IsAtEnd(&lockPtr->ownerList, (List_Links *)nextOwnerPtr)) {
+	lockOwnerPtr = nextOwnerPtr;
+	nextOwnerPtr = (FsLockOwner *)List_Next((List_Links *)lockOwnerPtr);
+	if (!lockOwnerPtr->range) {
+	    continue;
+	}
+	lockArgs.flags = lockOwnerPtr->flags | IOC_LOCK_NO_BLOCK |
+			IOC_LOCK_RECLAIM;
+	lockArgs.hostID = lockOwnerPtr->hostID;
+	lockArgs.pid = lockOwnerPtr->procID;
+	lockArgs.token = 0;
+	lockArgs.offset = lockOwnerPtr->start;
+	if (lockOwnerPtr->end == FSIO_LOCK_EOF) {
+	    lockArgs.length = 0;
+	} else {
+	    lockArgs.length = lockOwnerPtr->end - lockOwnerPtr->start + 1;
+	}
+	status = (*reopenProc)(clientData, &lockOwnerPtr->streamID,
+				&lockArgs);
+	if (status == SUCCESS || status == RPC_TIMEOUT ||
+	    status == RPC_SERVICE_DISABLED) {
+	    continue;
+	}
+	printf("Fsio_LockReopen: proc %x lost lock on <%d..%d> <%x>\n",
+	    lockOwnerPtr->procID, lockOwnerPtr->start, lockOwnerPtr->end,
+	    status);
+	LIST_FORALL(&lockPtr->lostList, (List_Links *)lostPtr) {
+	    if (lostPtr->hostID == lockOwnerPtr->hostID &&
+		lostPtr->procID == lockOwnerPtr->procID &&
+		lostPtr->streamID.major == lockOwnerPtr->streamID.major &&
+		lostPtr->streamID.minor == lockOwnerPtr->streamID.minor &&
+		lostPtr->streamID.serverID == lockOwnerPtr->streamID.serverID) {
+		break;
+	    }
+	}
+	if (List_IsAtEnd(&lockPtr->lostList, (List_Links *)lostPtr)) {
+	    lostPtr = mnew(FsLockLost);
+	    List_InitElement((List_Links *)lostPtr);
+	    lostPtr->hostID = lockOwnerPtr->hostID;
+	    lostPtr->procID = lockOwnerPtr->procID;
+	    lostPtr->streamID = lockOwnerPtr->streamID;
+	    lostPtr->flags = 0;
+	    List_Insert((List_Links *)lostPtr, LIST_ATREAR(&lockPtr->lostList));
+	}
+	lostPtr->flags |= lockOwnerPtr->flags;
+	RemoveRangeOwner(lockPtr, lockOwnerPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_RangeLockLost --
+ *
+ *	See if a process lost byte-range locks held through a stream
+ *	because they could not be reclaimed after the server rebooted.
+ *	Clients check this on their shadow before each byte-range lock
+ *	operation, so the owner hears about the loss once.
+ *
+ * Results:
+ *	SUCCESS if no lock was lost, otherwise FS_NO_EXCLUSIVE_LOCK or
+ *	FS_NO_SHARED_LOCK depending on what was lost.
+ *
+ * Side effects:
+ *	Forgets the lost locks of the process on the stream.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ReturnStatus
+Fsio_RangeLockLost(lockPtr, argPtr, streamIDPtr)
+    register Fsio_LockState *lockPtr;	/* Locking state for a file. */
+    Fsio_RangeLockArgs *argPtr;		/* Owner of the operation */
+    Fs_FileID	*streamIDPtr;		/* Stream of the operation */
+{
+    int flags;
+
+    if (List_IsEmpty(&lockPtr->lostList)) {
+	return(SUCCESS);
+    }
+    flags = RemoveLostLocks(lockPtr, argPtr->hostID, argPtr->pid,
+			streamIDPtr);
+    if (flags & IOC_LOCK_EXCLUSIVE) {
+	return(FS_NO_EXCLUSIVE_LOCK);
+    } else if (flags != 0) {
+	return(FS_NO_SHARED_LOCK);
+    }
+    return(SUCCESS);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_LockGraceStart --
+ *
+ *	Start the reclaim window for byte-range locks.  This is called
+ *	each time a local domain is attached, but only the first call
+ *	after this host boots starts the window, since that is when its
+ *	clients start reopening files to recover.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Schedules LockGraceEnd.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ENTRY void
+Fsio_LockGraceStart()
+{
+    LOCK_MONITOR;
+    if (lockGraceState == GRACE_NOT_STARTED) {
+	List_Init(&graceWaitList);
+	if (fsio_LockGraceSeconds > 0) {
+	    lockGraceState = GRACE_ACTIVE;
+	    Proc_CallFunc(LockGraceEnd, (ClientData)NIL,
+		    timer_IntOneSecond * fsio_LockGraceSeconds);
+	} else {
+	    lockGraceState = GRACE_OVER;
+	}
+    }
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LockGraceWait --
+ *
+ *	Check for the reclaim window.  A process that would block is
+ *	put on the grace wait list so it retries when the window ends.
+ *
+ * Results:
+ *	TRUE if the window is open and the lock cannot be granted.
+ *
+ * Side effects:
+ *	May add to the grace wait list.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ENTRY Boolean
+LockGraceWait(argPtr)
+    register Fsio_RangeLockArgs *argPtr;	/* Lock wanted */
+{
+    Boolean inGrace;
+    Sync_RemoteWaiter wait;
+
+    LOCK_MONITOR;
+    inGrace = (lockGraceState == GRACE_ACTIVE);
+    if (inGrace && (argPtr->flags & IOC_LOCK_NO_BLOCK) == 0 &&
+	argPtr->hostID <= NET_NUM_SPRITE_HOSTS) {
+	wait.hostID = argPtr->hostID;
+	wait.pid = argPtr->pid;
+	wait.waitToken = argPtr->token;
+	Fsutil_FastWaitListInsert(&graceWaitList, &wait);
+    }
+    UNLOCK_MONITOR;
+    return(inGrace);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LockGraceEnd --
+ *
+ *	Called via Proc_CallFunc to close the reclaim window.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Wakes up and frees the processes on the grace wait list.
+ *
+ *----------------------------------------------------------------------
+ */
+
+/*ARGSUSED*/
+static ENTRY void
+LockGraceEnd(data, callInfoPtr)
+    ClientData		data;		/* Not used */
+    Proc_CallInfo	*callInfoPtr;
+{
+    LOCK_MONITOR;
+    lockGraceState = GRACE_OVER;
+    Fsutil_FastWaitListNotify(&graceWaitList);
+    UNLOCK_MONITOR;
+    callInfoPtr->interval = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetRange --
+ *
+ *	Convert the offset and length of a byte-range lock into its
+ *	first and last bytes.
+ *
+ * Results:
+ *	SUCCESS, or GEN_INVALID_ARG if the range is negative or overflows.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ReturnStatus
+GetRange(argPtr, startPtr, endPtr)
+    Fsio_RangeLockArgs *argPtr;		/* Offset and length */
+    int *startPtr;			/* Return, first byte */
+    int *endPtr;			/* Return, last byte */
+{
+    if (argPtr->offset < 0 || argPtr->length < 0) {
+	return(GEN_INVALID_ARG);
+    }
+    *startPtr = argPtr->offset;
+    if (argPtr->length == 0) {
+	*endPtr = FSIO_LOCK_EOF;
+    } else if (argPtr->length - 1 > FSIO_LOCK_EOF - argPtr->offset) {
+	return(GEN_INVALID_ARG);
+    } else {
+	*endPtr = argPtr->offset + argPtr->length - 1;
+    }
+    return(SUCCESS);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddRangeOwner --
+ *
+ *	Record a byte-range lock on the ownership list and in the
+ *	interval tree.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Allocates an FsLockOwner.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AddRangeOwner(lockPtr, hostID, procID, streamIDPtr, flags, start, end)
+    register Fsio_LockState *lockPtr;	/* Locking state for the file. */
+    int hostID;				/* Host of owning process */
+    int procID;				/* Owning process */
+    Fs_FileID *streamIDPtr;		/* Stream the lock was made on */
+    int flags;				/* IOC_LOCK_EXCLUSIVE, _SHARED */
+    int start;				/* First byte */
+    int end;				/* Last byte */
+{
+    register FsLockOwner *lockOwnerPtr;
+
+    lockOwnerPtr = mnew(FsLockOwner);
+    List_InitElement((List_Links *)lockOwnerPtr);
+    lockOwnerPtr->hostID = hostID;
+    lockOwnerPtr->procID = procID;
+    if (streamIDPtr != (Fs_FileID *)NIL) {
+	lockOwnerPtr->streamID = *streamIDPtr;
+    } else {
+	lockOwnerPtr->streamID.type = -1;
+    }
+    lockOwnerPtr->flags = flags;
+    lockOwnerPtr->range = TRUE;
+    lockOwnerPtr->start = start;
+    lockOwnerPtr->end = end;
+    lockSeed = lockSeed * 1103515245 + 12345;
+    lockOwnerPtr->priority = lockSeed;
+    List_Insert((List_Links *)lockOwnerPtr,
+		LIST_ATREAR(&lockPtr->ownerList));
+    lockPtr->rangeRoot = TreeInsert(lockPtr->rangeRoot, lockOwnerPtr);
+    lockPtr->numRanges++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RemoveRangeOwner --
+ *
+ *	Take a byte-range lock off the ownership list and out of the
+ *	interval tree.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the FsLockOwner.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RemoveRangeOwner(lockPtr, lockOwnerPtr)
+    register Fsio_LockState *lockPtr;	/* Locking state for the file. */
+    register FsLockOwner *lockOwnerPtr;	/* Lock to remove */
+{
+    lockPtr->rangeRoot = TreeDelete(lockPtr->rangeRoot, lockOwnerPtr);
+    List_Remove((List_Links *)lockOwnerPtr);
+    free((Address)lockOwnerPtr);
+    lockPtr->numRanges--;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseRange --
+ *
+ *	Remove a process's locks from a byte range.  A lock that extends
+ *	past either end of the range is split, and the parts outside the
+ *	range are kept.
+ *
+ * Results:
+ *	TRUE if any lock was released.
+ *
+ * Side effects:
+ *	Updates the interval tree and the ownership list.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Boolean
+ReleaseRange(lockPtr, hostID, procID, start, end)
+    register Fsio_LockState *lockPtr;	/* Locking state for the file. */
+    int hostID;				/* Host of owning process */
+    int procID;				/* Owning process */
+    int start;				/* First byte */
+    int end;				/* Last byte */
+{
+    register FsLockOwner *lockOwnerPtr;
+    Fs_FileID streamID;
+    int flags, ownStart, ownEnd;
+    Boolean released = FALSE;
+
+    while (TRUE) {
+	lockOwnerPtr = FindOverlap(lockPtr->rangeRoot, start, end,
+				hostID, procID, 0, TRUE);
+	if (lockOwnerPtr == (FsLockOwner *)NIL) {
+	    break;
+	}
+	released = TRUE;
+	streamID = lockOwnerPtr->streamID;
+	flags = lockOwnerPtr->flags;
+	ownStart = lockOwnerPtr->start;
+	ownEnd = lockOwnerPtr->end;
+	RemoveRangeOwner(lockPtr, lockOwnerPtr);
+	if (ownStart < start) {
+	    AddRangeOwner(lockPtr, hostID, procID, &streamID, flags,
+			ownStart, start - 1);
+	}
+	if (ownEnd > end) {
+	    AddRangeOwner(lockPtr, hostID, procID, &streamID, flags,
+			end + 1, ownEnd);
+	}
+    }
+    return(released);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NotifyRange --
+ *
+ *	Wake up the processes waiting for bytes that overlap a range
+ *	that was just unlocked.  Waiters for other parts of the file
+ *	are left alone.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Notifies and frees the overlapping waiters.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+NotifyRange(lockPtr, start, end)
+    register Fsio_LockState *lockPtr;	/* Locking state for the file. */
+    int start;				/* First byte unlocked */
+    int end;				/* Last byte unlocked */
+{
+    register FsLockWaiter *waiterPtr;
+    register FsLockWaiter *nextPtr;
+
+    nextPtr = (FsLockWaiter *)List_First(&lockPtr->rangeWaitList);
+    while (!List_IsAtEnd(&lockPtr->rangeWaitList, (List_Links *)nextPtr)) {
+	waiterPtr = nextPtr;
+	nextPtr = (FsLockWaiter *)List_Next((List_Links *)waiterPtr);
+	if (waiterPtr->start <= end && waiterPtr->end >= start) {
+	    Fsutil_NotifyWaiter(&waiterPtr->wait);
+	    List_Remove((List_Links *)waiterPtr);
+	    free((Address)waiterPtr);
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RemoveRangeWaiters --
+ *
+ *	Forget processes waiting for byte ranges without waking them.
+ *	This is used when a wait is cancelled, and when the stream,
+ *	client or handle the waiters depend on goes away.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the matching waiters.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RemoveRangeWaiters(lockPtr, hostID, procID, streamIDPtr)
+    register Fsio_LockState *lockPtr;	/* Locking state for the file. */
+    int hostID;				/* Host of waiters, -1 for any */
+    int procID;				/* Waiting process, -1 for any */
+    Fs_FileID *streamIDPtr;		/* Stream waited on, NIL for any */
+{
+    register FsLockWaiter *waiterPtr;
+    register FsLockWaiter *nextPtr;
+
+    nextPtr = (FsLockWaiter *)List_First(&lockPtr->rangeWaitList);
+    while (!List_IsAtEnd(&lockPtr->rangeWaitList, (List_Links *)nextPtr)) {
+	waiterPtr = nextPtr;
+	nextPtr = (FsLockWaiter *)List_Next((List_Links *)waiterPtr);
+	if (hostID != -1 && waiterPtr->wait.hostID != hostID) {
+	    continue;
+	}
+	if (procID != -1 && waiterPtr->wait.pid != procID) {
+	    continue;
+	}
+	if (streamIDPtr != (Fs_FileID *)NIL &&
+	    (waiterPtr->streamID.major != streamIDPtr->major ||
+	     waiterPtr->streamID.minor != streamIDPtr->minor ||
+	     waiterPtr->streamID.serverID != streamIDPtr->serverID)) {
+	    continue;
+	}
+	List_Remove((List_Links *)waiterPtr);
+	free((Address)waiterPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RemoveLostLocks --
+ *
+ *	Forget byte-range locks recorded as lost by Fsio_LockReopen.
+ *
+ * Results:
+ *	The lock types of the records removed, or zero if there were none.
+ *
+ * Side effects:
+ *	Frees the matching lost lock records.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+RemoveLostLocks(lockPtr, hostID, procID, streamIDPtr)
+    register Fsio_LockState *lockPtr;	/* Locking state for the file. */
+    int hostID;				/* Host of owner, -1 for any */
+    int procID;				/* Owning process, -1 for any */
+    Fs_FileID *streamIDPtr;		/* Stream locked, NIL for any */
+{
+    register FsLockLost *lostPtr;
+    register FsLockLost *nextPtr;
+    int flags = 0;
+
+    nextPtr = (FsLockLost *)List_First(&lockPtr->lostList);
+    while (!List_IsAtEnd(&lockPtr->lostList, (List_Links *)nextPtr)) {
+	lostPtr = nextPtr;
+	nextPtr = (FsLockLost *)List_Next((List_Links *)lostPtr);
+	if (hostID != -1 && lostPtr->hostID != hostID) {
+	    continue;
+	}
+	if (procID != -1 && lostPtr->procID != procID) {
+	    continue;
+	}
+	if (streamIDPtr != (Fs_FileID *)NIL &&
+	    (lostPtr->streamID.major != streamIDPtr->major ||
+	     lostPtr->streamID.minor != streamIDPtr->minor ||
+	     lostPtr->streamID.serverID != streamIDPtr->serverID)) {
+	    continue;
+	}
+	flags |= lostPtr->flags;
+	List_Remove((List_Links *)lostPtr);
+	free((Address)lostPtr);
+    }
+    return(flags);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FindOverlap --
+ *
+ *	Find the first lock in a subtree that overlaps a byte range
+ *	and either conflicts with a lock of the given type, or, if own
+ *	is TRUE, belongs to the given process.  Locks conflict if they
+ *	belong to different processes and either is exclusive.
+ *	Subtrees that end before the range, and those that start after
+ *	it, are not searched.
+ *
+ * Results:
+ *	The lock found, or NIL.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static FsLockOwner *
+FindOverlap(nodePtr, start, end, hostID, procID, flags, own)
+    register FsLockOwner *nodePtr;	/* Root of subtree to search */
+    int start;				/* First byte of range */
+    int end;				/* Last byte of range */
+    int hostID;				/* Host of process checking */
+    int procID;				/* Process checking */
+    int flags;				/* Type of lock wanted */
+    Boolean own;			/* TRUE to find the process's locks */
+{
+    register FsLockOwner *foundPtr;
+    Boolean sameOwner;
+
+    while (nodePtr != (FsLockOwner *)NIL && nodePtr->maxEnd >= start) {
+	foundPtr = FindOverlap(nodePtr->leftPtr, start, end, hostID, procID,
+				flags, own);
+	if (foundPtr != (FsLockOwner *)NIL) {
+	    return(foundPtr);
+	}
+	if (nodePtr->start > end) {
+	    break;
+	}
+	if (nodePtr->end >= start) {
+	    sameOwner = (nodePtr->hostID == hostID &&
+			 nodePtr->procID == procID);
+	    if (own ? sameOwner :
+		(!sameOwner &&
+		 ((nodePtr->flags | flags) & IOC_LOCK_EXCLUSIVE))) {
+		return(nodePtr);
+	    }
+	}
+	nodePtr = nodePtr->rightPtr;
+    }
+    return((FsLockOwner *)NIL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UpdateMaxEnd --
+ *
+ *	Recompute the largest end in a subtree from the node and the
+ *	roots of its two children.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets nodePtr->maxEnd.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UpdateMaxEnd(nodePtr)
+    register FsLockOwner *nodePtr;	/* Node whose children changed */
+{
+    register int maxEnd = nodePtr->end;
+
+    if (nodePtr->leftPtr != (FsLockOwner *)NIL &&
+	nodePtr->leftPtr->maxEnd > maxEnd) {
+	maxEnd = nodePtr->leftPtr->maxEnd;
+    }
+    if (nodePtr->rightPtr != (FsLockOwner *)NIL &&
+	nodePtr->rightPtr->maxEnd > maxEnd) {
+	maxEnd = nodePtr->rightPtr->maxEnd;
+    }
+    nodePtr->maxEnd = maxEnd;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RotateLeft --
+ * RotateRight --
+ *
+ *	Rotate a node's right (left) child up into its place.
+ *
+ * Results:
+ *	The new root of the subtree.
+ *
+ * Side effects:
+ *	Relinks the two nodes and recomputes their maxEnd.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static FsLockOwner *
+RotateLeft(nodePtr)
+    register FsLockOwner *nodePtr;	/* Root of subtree */
+{
+    register FsLockOwner *childPtr = nodePtr->rightPtr;
+
+    nodePtr->rightPtr = childPtr->leftPtr;
+    childPtr->leftPtr = nodePtr;
+    UpdateMaxEnd(nodePtr);
+    UpdateMaxEnd(childPtr);
+    return(childPtr);
+}
+
+static FsLockOwner *
+RotateRight(nodePtr)
+    register FsLockOwner *nodePtr;	/* Root of subtree */
+{
+    register FsLockOwner *childPtr = nodePtr->leftPtr;
+
+    nodePtr->leftPtr = childPtr->rightPtr;
+    childPtr->rightPtr = nodePtr;
+    UpdateMaxEnd(nodePtr);
+    UpdateMaxEnd(childPtr);
+    return(childPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TreeInsert --
+ *
+ *	Add a lock to the interval tree.  It goes in as a leaf and is
+ *	rotated up past any parents with a lower priority.
+ *
+ * Results:
+ *	The new root of the subtree.
+ *
+ * Side effects:
+ *	Links in the node.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static FsLockOwner *
+TreeInsert(rootPtr, nodePtr)
+    register FsLockOwner *rootPtr;	/* Root of subtree, may be NIL */
+    register FsLockOwner *nodePtr;	/* Lock to add */
+{
+    if (rootPtr == (FsLockOwner *)NIL) {
+	nodePtr->leftPtr = (FsLockOwner *)NIL;
+	nodePtr->rightPtr = (FsLockOwner *)NIL;
+	nodePtr->maxEnd = nodePtr->end;
+	return(nodePtr);
+    }
+    if (OWNER_BEFORE(nodePtr, rootPtr)) {
+	rootPtr->leftPtr = TreeInsert(rootPtr->leftPtr, nodePtr);
+	if (rootPtr->leftPtr->priority > rootPtr->priority) {
+	    return(RotateRight(rootPtr));
+	}
+    } else {
+	rootPtr->rightPtr = TreeInsert(rootPtr->rightPtr, nodePtr);
+	if (rootPtr->rightPtr->priority > rootPtr->priority) {
+	    return(RotateLeft(rootPtr));
+	}
+    }
+    UpdateMaxEnd(rootPtr);
+    return(rootPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TreeMerge --
+ *
+ *	Join two subtrees, all of whose nodes in the left one come
+ *	before all of those in the right one.
+ *
+ * Results:
+ *	The root of the joined tree.
+ *
+ * Side effects:
+ *	Relinks nodes along the right edge of the left subtree and the
+ *	left edge of the right subtree.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static FsLockOwner *
+TreeMerge(leftPtr, rightPtr)
+    register FsLockOwner *leftPtr;	/* Earlier subtree, may be NIL */
+    register FsLockOwner *rightPtr;	/* Later subtree, may be NIL */
+{
+    if (leftPtr == (FsLockOwner *)NIL) {
+	return(rightPtr);
+    }
+    if (rightPtr == (FsLockOwner *)NIL) {
+	return(leftPtr);
+    }
+    if (leftPtr->priority > rightPtr->priority) {
+	leftPtr->rightPtr = TreeMerge(leftPtr->rightPtr, rightPtr);
+	UpdateMaxEnd(leftPtr);
+	return(leftPtr);
+    } else {
+	rightPtr->leftPtr = TreeMerge(leftPtr, rightPtr->leftPtr);
+	UpdateMaxEnd(rightPtr);
+	return(rightPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TreeDelete --
+ *
+ *	Remove a lock from the interval tree by replacing it with the
+ *	merge of its children.
+ *
+ * Results:
+ *	The new root of the subtree.
+ *
+ * Side effects:
+ *	Unlinks the node, and recomputes maxEnd along the path to it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static FsLockOwner *
+TreeDelete(rootPtr, nodePtr)
+    register FsLockOwner *rootPtr;	/* Root of subtree */
+    register FsLockOwner *nodePtr;	/* Lock to remove */
+{
+    if (rootPtr == (FsLockOwner *)NIL) {
+	printf("Fsio TreeDelete: range <%d..%d> not in tree\n",
+		nodePtr->start, nodePtr->end);
+	return(rootPtr);
+    }
+    if (rootPtr == nodePtr) {
+	return(TreeMerge(nodePtr->leftPtr, nodePtr->rightPtr));
+    }
+    if (OWNER_BEFORE(nodePtr, rootPtr)) {
+	rootPtr->leftPtr = TreeDelete(rootPtr->leftPtr, nodePtr);
+    } else {
+	rootPtr->rightPtr = TreeDelete(rootPtr->rightPtr, nodePtr);
+    }
+    UpdateMaxEnd(rootPtr);
+    return(rootPtr);
+}
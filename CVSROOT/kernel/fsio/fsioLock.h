@@ -29,6 +29,15 @@ typedef struct Fsio_LockState {
 				 * file gets unlocked */
     int		numShared;	/* Number of shared lock holders */
     List_Links	ownerList;	/* List of processes responsible for locks */
+    struct FsLockOwner *rangeRoot;	/* Interval tree of byte-range locks,
+				 * whose owners are also on ownerList */
+    List_Links	rangeWaitList;	/* Processes waiting for a byte range.  Only
+				 * those whose range overlaps an unlock are
+				 * woken up. */
+    int		numRanges;	/* Number of byte-range locks held */
+    List_Links	lostList;	/* Byte-range locks a client could not
+				 * reclaim, reported to their owners on
+				 * their next lock operation */
 } Fsio_LockState;
 
 /*
@@ -39,6 +48,53 @@ typedef struct Fsio_LockState {
  *	wait until all shared locks go away.
  */
 
+/*
+ * Byte-range locks.  These are POSIX record locks: the owner of a lock
+ * is a process, identified by its host and process ID, and a process
+ * that locks a range it already holds converts that part of its lock
+ * to the new type.  Byte-range locks are independent of the whole-file
+ * locks set by IOC_LOCK.  IOC_RANGE_LOCK_TEST returns the first lock
+ * that conflicts with the one described by its input, or flags of zero
+ * if there is none.  A length of zero means to the end of the file,
+ * however large it grows.
+ */
+#ifndef IOC_RANGE_LOCK
+#define	IOC_RANGE_LOCK		(24 << 16)
+#define	IOC_RANGE_LOCK_SET	(IOC_RANGE_LOCK | 1)
+#define	IOC_RANGE_LOCK_UNLOCK	(IOC_RANGE_LOCK | 2)
+#define	IOC_RANGE_LOCK_TEST	(IOC_RANGE_LOCK | 3)
+#endif
+
+/*
+ * IOC_LOCK_RECLAIM is only set by the kernel.  It marks a request that
+ * re-establishes a lock the owner already held, either with a server
+ * that has rebooted or in a client's shadow of the server's locks.
+ * Fs_IOControl clears it in requests from user programs.  For a while
+ * after a server reboots, fsio_LockGraceSeconds, only reclaims are
+ * granted so that no other process can take a range from its owner.
+ */
+#define	IOC_LOCK_RECLAIM	0x100
+
+extern int fsio_LockGraceSeconds;
+
+typedef struct Fsio_RangeLockArgs {
+    int		flags;		/* IOC_LOCK_EXCLUSIVE or IOC_LOCK_SHARED,
+				 * plus IOC_LOCK_NO_BLOCK */
+    int		hostID;		/* Filled in by the kernel, as with */
+    int		pid;		/*   Ioc_LockArgs */
+    int		token;
+    int		offset;		/* First byte of the range */
+    int		length;		/* Bytes in the range, zero for to EOF */
+} Fsio_RangeLockArgs;
+
+/*
+ * Called by Fsio_LockReopen for each byte-range lock to re-establish.
+ * It returns SUCCESS if the lock is still held, and RPC_TIMEOUT or
+ * RPC_SERVICE_DISABLED if the server went away again.
+ */
+typedef ReturnStatus (*Fsio_LockReopenProc) _ARGS_((ClientData clientData,
+			Fs_FileID *streamIDPtr, Fsio_RangeLockArgs *argPtr));
+
 /*
  * flock() support
  */
@@ -52,6 +108,28 @@ extern ReturnStatus Fsio_Unlock _ARGS_((Fsio_LockState *lockPtr,
 extern void Fsio_LockClose _ARGS_((Fsio_LockState *lockPtr,
 			Fs_FileID *streamIDPtr));
 extern void Fsio_LockClientKill _ARGS_((Fsio_LockState *lockPtr, int clientID));
+extern void Fsio_LockCleanup _ARGS_((Fsio_LockState *lockPtr));
+
+/*
+ * fcntl() byte-range support
+ */
+extern ReturnStatus Fsio_IocRangeLock _ARGS_((Fsio_LockState *lockPtr,
+			Fs_IOCParam *ioctlPtr, Fs_FileID *streamIDPtr,
+			Fs_IOReply *replyPtr));
+extern ReturnStatus Fsio_RangeLock _ARGS_((Fsio_LockState *lockPtr,
+			Fsio_RangeLockArgs *argPtr, Fs_FileID *streamIDPtr));
+extern ReturnStatus Fsio_RangeUnlock _ARGS_((Fsio_LockState *lockPtr,
+			Fsio_RangeLockArgs *argPtr));
+extern ReturnStatus Fsio_RangeLockTest _ARGS_((Fsio_LockState *lockPtr,
+			Fsio_RangeLockArgs *argPtr));
+extern Boolean Fsio_RangeLockHeld _ARGS_((Fsio_LockState *lockPtr,
+			Fsio_RangeLockArgs *argPtr));
+extern ReturnStatus Fsio_RangeLockLost _ARGS_((Fsio_LockState *lockPtr,
+			Fsio_RangeLockArgs *argPtr, Fs_FileID *streamIDPtr));
+extern void Fsio_LockGraceStart _ARGS_((void));
+extern void Fsio_LockReopen _ARGS_((Fsio_LockState *lockPtr,
+			Fsio_LockReopenProc reopenProc,
+			ClientData clientData));
 
 /*
  * Cache consistency routines.
@@ -27,6 +27,7 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include <fsioDevice.h>
 #include <fsioFile.h>
 #include <fsioPipe.h>
+#include <fsioEvent.h>
 #include <fsrmt.h>
 #include <fsdm.h>
 #include <fsioStreamInt.h>
@@ -125,6 +126,18 @@ static Fsio_StreamTypeOps ioStreamOps[] = {
 		Fsio_PipeMigClose, Fsio_PipeMigOpen, Fsio_PipeMigrate,
 		Fsio_PipeReopen,
 		Fsio_PipeScavenge, Fsio_PipeClientKill, Fsio_PipeClose},
+    /*
+     * Event set.  It is local to this host, so there is no migration
+     * or recovery.
+     */
+    { FSIO_EVENT_STREAM, Fsio_NoProc, Fsio_NoProc, Fsio_NoProc,
+		Fsio_NoProc, Fsio_NoProc, Fsio_NoProc,	/* Paging routines */
+		Fsio_EventIOControl, Fsio_EventSelect,
+		Fsio_NullProc, Fsio_NullProc,		/* Get/Set IO Attr */
+		Fsio_NoHandle,				/* clientVerify */
+		Fsio_NoProc, Fsio_NoProc, Fsio_NoProc,	/* migration */
+		Fsio_NoProc,				/* reopen */
+		Fsio_EventScavenge, Fsio_NullClientKill, Fsio_EventClose},
 
 };
 
@@ -1,8 +1,10 @@
 /*
  * fsPipe.c --
  *
- *	Routines for unnamed pipes.  An unnamed pipe has a fixed length
- *	resident buffer, a reading stream, and a writing stream.
+ *	Routines for unnamed pipes.  An unnamed pipe has a resident
+ *	buffer that grows up to a limit, a reading stream, and a writing
+ *	stream.  The data in the buffer can also be spliced to or from
+ *	another stream.
  *	Process migration can result in remotely accessed pipes.
  *
  * Copyright (C) 1985 Regents of the University of California
@@ -33,10 +35,26 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 
 /*
  * Monitor to synchronize access to the openInstance in GetFileID.
+ * The data in each pipe is protected by the lock on its handle.
  */
 static	Sync_Lock	pipeLock = Sync_LockInitStatic("Fs:pipeLock");
 #define	LOCKPTR	&pipeLock
 
+/*
+ * Initial and maximum sizes of a pipe's buffer.  See fsioPipe.h.
+ */
+int fsio_PipeBufSize = FS_BLOCK_SIZE;
+int fsio_PipeMaxBufSize = 8 * FS_BLOCK_SIZE;
+
+/*
+ * The buffer size is a power of two so offsets into it can be masked.
+ * The first and last byte offsets float out past the size of the
+ * buffer, and the bits above the mask tell if a range wraps around.
+ */
+#define	PIPE_MASK(handlePtr)	((handlePtr)->bufSize - 1)
+#define	PIPE_USED(handlePtr)	((handlePtr)->firstByte == -1 ? 0 : \
+		(handlePtr)->lastByte - (handlePtr)->firstByte + 1)
+
 /*
  * Forward references.
  */
@@ -45,6 +63,8 @@ extern Fsio_PipeIOHandle *Fsio_PipeHandleInit _ARGS_((Fs_FileID *fileIDPtr,
 		Boolean findIt));
 static ReturnStatus PipeCloseInt _ARGS_((Fsio_PipeIOHandle *handlePtr, 
 		int ref, int write, Boolean release));
+static int PipeRoundSize _ARGS_((int size));
+static void PipeGrow _ARGS_((Fsio_PipeIOHandle *handlePtr, int length));
 
 /*
  * Migration debugging.
@@ -240,14 +260,102 @@ Fsio_PipeHandleInit(fileIDPtr, findIt)
 	List_Init(&handlePtr->clientList);
 	handlePtr->flags = 0;
 	handlePtr->firstByte = handlePtr->lastByte = -1;
-	handlePtr->buffer = (Address)malloc(FS_BLOCK_SIZE);
-	handlePtr->bufSize = FS_BLOCK_SIZE;
+	handlePtr->bufSize = PipeRoundSize(fsio_PipeBufSize);
+	handlePtr->buffer = (Address)malloc(handlePtr->bufSize);
 	List_Init(&handlePtr->readWaitList);
 	List_Init(&handlePtr->writeWaitList);
+	handlePtr->splice = 0;
+	handlePtr->spliceByte = 0;
 	fs_Stats.object.pipes++;
     }
     return(handlePtr);
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PipeRoundSize --
+ *
+ *	Round a pipe buffer size up to a power of two.
+ *
+ * Results:
+ *	The rounded size, or FS_BLOCK_SIZE if the size isn't positive.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+PipeRoundSize(size)
+    int size;		/* Requested buffer size */
+{
+    int bufSize;
+
+    if (size <= 0) {
+	return(FS_BLOCK_SIZE);
+    }
+    for (bufSize = 1; bufSize < size; bufSize <<= 1) {
+    }
+    return(bufSize);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PipeGrow --
+ *
+ *	Double the size of a pipe's buffer until there is room for
+ *	length more bytes or the buffer is fsio_PipeMaxBufSize.  The
+ *	data is copied to the front of the new buffer.  The handle
+ *	should be locked and no splice may be using the buffer.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May replace the buffer and reset the first and last byte offsets.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+PipeGrow(handlePtr, length)
+    register Fsio_PipeIOHandle *handlePtr;	/* Pipe to grow */
+    int length;					/* Bytes to fit */
+{
+    int		used;
+    int		newSize;
+    int		maxSize;
+    int		startOffset;
+    int		numBytes;
+    Address	newBuffer;
+
+    used = PIPE_USED(handlePtr);
+    maxSize = PipeRoundSize(fsio_PipeMaxBufSize);
+    newSize = handlePtr->bufSize;
+    while (newSize - used < length && newSize < maxSize) {
+	newSize <<= 1;
+    }
+    if (newSize == handlePtr->bufSize) {
+	return;
+    }
+    newBuffer = (Address)malloc(newSize);
+    if (used > 0) {
+	startOffset = handlePtr->firstByte & PIPE_MASK(handlePtr);
+	numBytes = handlePtr->bufSize - startOffset;
+	if (numBytes >= used) {
+	    bcopy(handlePtr->buffer + startOffset, newBuffer, used);
+	} else {
+	    bcopy(handlePtr->buffer + startOffset, newBuffer, numBytes);
+	    bcopy(handlePtr->buffer, newBuffer + numBytes, used - numBytes);
+	}
+	handlePtr->firstByte = 0;
+	handlePtr->lastByte = used - 1;
+    }
+    free(handlePtr->buffer);
+    handlePtr->buffer = newBuffer;
+    handlePtr->bufSize = newSize;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -367,7 +475,8 @@ PipeCloseInt(handlePtr, ref, write, release)
  * Fsio_PipeRead --
  *
  *      Read on a pipe.  Data is copied out of the pipe to satisfy the
- *	read.  If the pipe is empty this routine returns FS_WOULD_BLOCK.
+ *	read.  If the pipe is empty, or its data is being spliced out,
+ *	this routine returns FS_WOULD_BLOCK.
  *	If the pipe writer is gone this returns SUCCESS and 0 bytes
  *	to simulate EOF.
  *
@@ -399,6 +508,11 @@ Fsio_PipeRead(streamPtr, readPtr, waitPtr, replyPtr)
 
     Fsutil_HandleLock(handlePtr);
 
+    if (handlePtr->splice & FSIO_PIPE_SPLICE_OUT) {
+	replyPtr->length = 0;
+	status = FS_WOULD_BLOCK;
+	goto exit;
+    }
     if (handlePtr->firstByte == -1) {
 	/*
 	 * No data in the pipe.  If there is no writer left then
@@ -429,11 +543,11 @@ Fsio_PipeRead(streamPtr, readPtr, waitPtr, replyPtr)
      * of the buffer wraps around the end of the pipe.
      */
     startByte = handlePtr->firstByte;
-    startOffset = startByte & FS_BLOCK_OFFSET_MASK;
+    startOffset = startByte & PIPE_MASK(handlePtr);
     endByte = handlePtr->firstByte + toRead - 1;
 
-    if ((startByte & ~FS_BLOCK_OFFSET_MASK) ==
-	(endByte & ~FS_BLOCK_OFFSET_MASK)) {
+    if ((startByte & ~PIPE_MASK(handlePtr)) ==
+	(endByte & ~PIPE_MASK(handlePtr))) {
 	/*
 	 * Can do a straight copy, no wrap around necessary.
 	 */
@@ -450,7 +564,7 @@ Fsio_PipeRead(streamPtr, readPtr, waitPtr, replyPtr)
 	/*
 	 * Have to wrap around in the block so do it in two copies.
 	 */
-	numBytes = FS_BLOCK_SIZE - startOffset;
+	numBytes = handlePtr->bufSize - startOffset;
 	if (readPtr->flags & FS_USER) {
 	    if (Vm_CopyOut(numBytes, handlePtr->buffer + startOffset, readPtr->buffer)
 			  != SUCCESS) {
@@ -493,10 +607,11 @@ exit:
  *
  * Fsio_PipeWrite --
  *
- *      Write on a pipe.  This will put as much data as possible into the
- *	pipe buffer, and then block the process (return would-block) if
- *	there is any left over data.  *lenPtr is updated to reflect how
- *	much data was written to the pipe.
+ *      Write on a pipe.  This will grow the pipe buffer if the data
+ *	doesn't fit, put as much data as possible into it, and then block
+ *	the process (return would-block) if there is any left over data.
+ *	*lenPtr is updated to reflect how much data was written to the
+ *	pipe.  Writers also block while a splice is filling the pipe.
  *
  * Results:
  *      SUCCESS unless there was an address error or I/O error.
@@ -530,16 +645,20 @@ Fsio_PipeWrite(streamPtr, writePtr, waitPtr, replyPtr)
 	goto exit;
     }
 
+    if (handlePtr->splice & FSIO_PIPE_SPLICE_IN) {
+	replyPtr->length = 0;
+	status = FS_WOULD_BLOCK;
+	goto exit;
+    }
+
     /*
-     * Compute the number of bytes that will fit in the pipe.  Remember
-     * that the pipe can only hold one block of data.
+     * Compute the number of bytes that will fit in the pipe, after
+     * growing its buffer if that is allowed.
      */
-    if (handlePtr->firstByte == -1) {
-	toWrite = FS_BLOCK_SIZE;
-    } else {
-	toWrite = FS_BLOCK_SIZE - 
-		    (handlePtr->lastByte - handlePtr->firstByte + 1);
+    if (handlePtr->splice == 0) {
+	PipeGrow(handlePtr, writePtr->length);
     }
+    toWrite = handlePtr->bufSize - PIPE_USED(handlePtr);
     if (toWrite == 0) {
 	/*
 	 * No room in the pipe.
@@ -562,11 +681,11 @@ Fsio_PipeWrite(streamPtr, writePtr, waitPtr, replyPtr)
      * we use masks to clear off the extra high order bits.
      */
     startByte = handlePtr->lastByte + 1;
-    startOffset = startByte & FS_BLOCK_OFFSET_MASK;
+    startOffset = startByte & PIPE_MASK(handlePtr);
     endByte = handlePtr->lastByte + toWrite;
 
-    if ((startByte & ~FS_BLOCK_OFFSET_MASK) ==
-	(endByte & ~FS_BLOCK_OFFSET_MASK)) {
+    if ((startByte & ~PIPE_MASK(handlePtr)) ==
+	(endByte & ~PIPE_MASK(handlePtr))) {
 	/*
 	 * Can do a straight copy, no wrap around necessary.
 	 */
@@ -583,7 +702,7 @@ Fsio_PipeWrite(streamPtr, writePtr, waitPtr, replyPtr)
 	/*
 	 * Have to wrap around in the block so do it in two copies.
 	 */
-	numBytes = FS_BLOCK_SIZE - startOffset;
+	numBytes = handlePtr->bufSize - startOffset;
 	if (writePtr->flags & FS_USER) {
 	    if (Vm_CopyIn(numBytes, writePtr->buffer, handlePtr->buffer + startOffset)
 			  != SUCCESS) {
@@ -620,6 +739,159 @@ exit:
 }
 
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_PipeSpliceBegin --
+ *
+ *	Lend a contiguous piece of a pipe's buffer to Fs_Splice.  When
+ *	splicing out of the pipe the piece holds the oldest data in it,
+ *	and when splicing into the pipe it is free space after the
+ *	newest data.  The piece belongs to the caller until it calls
+ *	Fsio_PipeSpliceEnd, during which other readers (or writers) of
+ *	the pipe block.
+ *
+ * Results:
+ *	SUCCESS with *lengthPtr set to 0 at end of file,
+ *	FS_WOULD_BLOCK if the pipe is empty (or full) or another
+ *	splice is using it, FS_BROKEN_PIPE if there are no readers
+ *	left to splice into, or FS_NO_ACCESS.
+ *
+ * Side effects:
+ *	*bufferPtr and *lengthPtr are set to the piece of the buffer.
+ *	The waiter is put on a wait list if FS_WOULD_BLOCK is returned.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+Fsio_PipeSpliceBegin(streamPtr, toPipe, length, waitPtr, bufferPtr,
+		     lengthPtr)
+    Fs_Stream		*streamPtr;	/* Stream to the pipe */
+    Boolean		toPipe;		/* TRUE if splicing into the pipe */
+    int			length;		/* Most bytes wanted */
+    Sync_RemoteWaiter	*waitPtr;	/* Process info for waiting */
+    Address		*bufferPtr;	/* Return - piece of the buffer */
+    int			*lengthPtr;	/* Return - length of piece */
+{
+    register Fsio_PipeIOHandle *handlePtr =
+	    (Fsio_PipeIOHandle *)streamPtr->ioHandlePtr;
+    ReturnStatus	status = SUCCESS;
+    int			startByte;
+    int			startOffset;
+    int			toMove;
+
+    *lengthPtr = 0;
+    if ((streamPtr->flags & (toPipe ? FS_WRITE : FS_READ)) == 0) {
+	return(FS_NO_ACCESS);
+    }
+    Fsutil_HandleLock(handlePtr);
+    if (toPipe) {
+	if (handlePtr->flags & FSIO_PIPE_READER_GONE) {
+	    status = FS_BROKEN_PIPE;
+	    goto exit;
+	}
+	if (handlePtr->splice & FSIO_PIPE_SPLICE_IN) {
+	    status = FS_WOULD_BLOCK;
+	    goto exit;
+	}
+	if (handlePtr->splice == 0) {
+	    PipeGrow(handlePtr, length);
+	}
+	toMove = handlePtr->bufSize - PIPE_USED(handlePtr);
+	startByte = handlePtr->lastByte + 1;
+    } else {
+	if (handlePtr->splice & FSIO_PIPE_SPLICE_OUT) {
+	    status = FS_WOULD_BLOCK;
+	    goto exit;
+	}
+	if (handlePtr->firstByte == -1) {
+	    if ((handlePtr->flags & FSIO_PIPE_WRITER_GONE) == 0) {
+		status = FS_WOULD_BLOCK;
+	    }
+	    goto exit;
+	}
+	toMove = PIPE_USED(handlePtr);
+	startByte = handlePtr->firstByte;
+    }
+    /*
+     * Lend only up to the end of the buffer, not around the wrap.
+     */
+    startOffset = startByte & PIPE_MASK(handlePtr);
+    if (toMove > handlePtr->bufSize - startOffset) {
+	toMove = handlePtr->bufSize - startOffset;
+    }
+    if (toMove > length) {
+	toMove = length;
+    }
+    if (toMove <= 0) {
+	status = FS_WOULD_BLOCK;
+	goto exit;
+    }
+    if (toPipe) {
+	handlePtr->splice |= FSIO_PIPE_SPLICE_IN;
+	handlePtr->spliceByte = startByte;
+    } else {
+	handlePtr->splice |= FSIO_PIPE_SPLICE_OUT;
+    }
+    *bufferPtr = handlePtr->buffer + startOffset;
+    *lengthPtr = toMove;
+exit:
+    if (status == FS_WOULD_BLOCK) {
+	Fsutil_FastWaitListInsert(toPipe ? &handlePtr->writeWaitList :
+		&handlePtr->readWaitList, waitPtr);
+    }
+    Fsutil_HandleUnlock(handlePtr);
+    return(status);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsio_PipeSpliceEnd --
+ *
+ *	Give back the piece of a pipe's buffer lent by
+ *	Fsio_PipeSpliceBegin, after length bytes of it were used.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Removes the data spliced out of the pipe, or adds the data
+ *	spliced into it, and wakes up readers and writers.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Fsio_PipeSpliceEnd(streamPtr, toPipe, length)
+    Fs_Stream		*streamPtr;	/* Stream to the pipe */
+    Boolean		toPipe;		/* TRUE if splicing into the pipe */
+    int			length;		/* Bytes moved */
+{
+    register Fsio_PipeIOHandle *handlePtr =
+	    (Fsio_PipeIOHandle *)streamPtr->ioHandlePtr;
+
+    Fsutil_HandleLock(handlePtr);
+    if (toPipe) {
+	handlePtr->splice &= ~FSIO_PIPE_SPLICE_IN;
+	if (length > 0) {
+	    if (handlePtr->firstByte == -1) {
+		handlePtr->firstByte = handlePtr->spliceByte;
+	    }
+	    handlePtr->lastByte = handlePtr->spliceByte + length - 1;
+	}
+    } else {
+	handlePtr->splice &= ~FSIO_PIPE_SPLICE_OUT;
+	handlePtr->firstByte += length;
+	if (handlePtr->firstByte > handlePtr->lastByte) {
+	    handlePtr->firstByte = -1;
+	    handlePtr->lastByte = -1;
+	}
+    }
+    Fsutil_FastWaitListNotify(&handlePtr->readWaitList);
+    Fsutil_FastWaitListNotify(&handlePtr->writeWaitList);
+    Fsutil_HandleUnlock(handlePtr);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -757,12 +1029,15 @@ Fsio_PipeSelect(hdrPtr, waitPtr, readPtr, writePtr, exceptPtr)
     *exceptPtr = 0;
     if (*writePtr) {
 	/*
-	 * Turn off writability if the pipe is full and there
-	 * are still readers.  If there are no readers we allow
-	 * writing but the next write will fail.
+	 * Turn off writability if the pipe is full and can't grow,
+	 * or a splice is filling it, and there are still readers.
+	 * If there are no readers we allow writing but the next
+	 * write will fail.
 	 */
-	if ((((handlePtr->firstByte + 1) % FS_BLOCK_SIZE) ==
-	     handlePtr->lastByte) && 
+	if (((handlePtr->splice & FSIO_PIPE_SPLICE_IN) ||
+	     (PIPE_USED(handlePtr) == handlePtr->bufSize &&
+	      (handlePtr->splice != 0 || handlePtr->bufSize >=
+			PipeRoundSize(fsio_PipeMaxBufSize)))) &&
 	     ((handlePtr->flags & FSIO_PIPE_READER_GONE) == 0)) {
 	    if (waitPtr != (Sync_RemoteWaiter *)NIL) {
 		Fsutil_FastWaitListInsert(&handlePtr->writeWaitList, waitPtr);
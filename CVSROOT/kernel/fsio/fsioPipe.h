@@ -35,15 +35,38 @@ typedef struct Fsio_PipeIOHandle {
     int			flags;		/* FSIO_PIPE_READER_GONE, FSIO_PIPE_WRITER_GONE */
     int			firstByte;	/* Indexes into buffer. */
     int			lastByte;
-    int			bufSize;	/* Total number of bytes in buffer */
+    int			bufSize;	/* Size of buffer, a power of
+					 * two. */
     Address		buffer;		/* The buffer for the data. */
     List_Links		readWaitList;	/* For the waiting readers of the pipe*/
     List_Links		writeWaitList;	/* For the waiting writers on the pipe*/
-} Fsio_PipeIOHandle;			/* 68 BYTES */
+    int			splice;		/* FSIO_PIPE_SPLICE_IN or _OUT
+					 * while a splice uses buffer. */
+    int			spliceByte;	/* Offset of the free space lent
+					 * by FSIO_PIPE_SPLICE_IN. */
+} Fsio_PipeIOHandle;			/* 76 BYTES */
 
 #define FSIO_PIPE_READER_GONE	0x1
 #define FSIO_PIPE_WRITER_GONE	0x2
 
+/*
+ * Values for the splice field.  While FSIO_PIPE_SPLICE_OUT is set the
+ * data at firstByte is being written to another stream straight from
+ * the pipe buffer, so other readers wait.  While FSIO_PIPE_SPLICE_IN is
+ * set the free space at spliceByte is being filled from another stream,
+ * so other writers wait.  The buffer is not grown during a splice.
+ */
+#define FSIO_PIPE_SPLICE_IN	0x1
+#define FSIO_PIPE_SPLICE_OUT	0x2
+
+/*
+ * The buffer of a new pipe is fsio_PipeBufSize bytes.  A writer that
+ * finds too little room doubles the buffer, up to fsio_PipeMaxBufSize,
+ * before it blocks.  Both are rounded up to a power of two.
+ */
+extern int fsio_PipeBufSize;
+extern int fsio_PipeMaxBufSize;
+
 /*
  * When a client re-opens a pipe it sends the following state to the server.
  */
@@ -62,6 +85,15 @@ extern int Fsio_PipeRecovTestUseCount _ARGS_((Fsio_PipeIOHandle *handlePtr));
  */
 extern ReturnStatus Fsio_PipeSetupHandle _ARGS_((Fsrecov_HandleState *recovInfoPtr));
 
+/*
+ * Splicing between a local pipe and another stream.
+ */
+extern ReturnStatus Fsio_PipeSpliceBegin _ARGS_((Fs_Stream *streamPtr,
+	Boolean toPipe, int length, Sync_RemoteWaiter *waitPtr,
+	Address *bufferPtr, int *lengthPtr));
+extern void Fsio_PipeSpliceEnd _ARGS_((Fs_Stream *streamPtr,
+	Boolean toPipe, int length));
+
 
 /*
  * Stream operations.
@@ -24,6 +24,8 @@
 
 extern ReturnStatus Fsio_RpcStreamMigCloseNew _ARGS_((ClientData srvToken, 
 		int clientID, int command, Rpc_Storage *storagePtr));
+extern ReturnStatus Fsio_RpcRemoteWakeup _ARGS_((ClientData srvToken, 
+		int clientID, int command, Rpc_Storage *storagePtr));
 
 #endif /* _FSIORPC */
 
@@ -68,6 +68,7 @@ extern void Fslcl_NameInitializeOps _ARGS_((void));
 extern void Fslcl_NameHashInit _ARGS_((void));
 void Fslcl_CheckDirLog _ARGS_((Fsio_FileIOHandle *parentHandlePtr,
 	List_Links *dirLogList));
+extern void Fslcl_DirIndexFree _ARGS_((Fsio_FileIOHandle *handlePtr));
 
 #endif /* KERNEL */
 
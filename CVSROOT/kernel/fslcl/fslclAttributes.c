@@ -226,6 +226,7 @@ FslclSetAttr(fileIDPtr, attrPtr, idPtr, flags)
     register ReturnStatus	status = SUCCESS;
     Fsio_FileIOHandle		*handlePtr;
     register Fsdm_FileDescriptor	*descPtr;
+    Boolean			allNames = FALSE;
 
     handlePtr = Fsutil_HandleFetchType(Fsio_FileIOHandle, fileIDPtr);
     if (handlePtr == (Fsio_FileIOHandle *)NIL) {
@@ -339,8 +340,17 @@ setMode:
 	 * Update the attributes cached in the file handle.
 	 */
 	Fscache_UpdateCachedAttr(&handlePtr->cacheInfo, attrPtr, flags);
+	/*
+	 * New permissions on a directory affect the lookup of every
+	 * name below it.
+	 */
+	allNames = (descPtr->fileType == FS_DIRECTORY) &&
+		    (flags & (FS_SET_MODE|FS_SET_OWNER));
     }
 exit:
     Fsutil_HandleRelease(handlePtr, TRUE);
+    if (status == SUCCESS) {
+	Fsconsist_RevokeLeases(fileIDPtr, allNames);
+    }
     return(status);
 }
@@ -0,0 +1,531 @@
+/*
+ * fslclDirIndex.c --
+ *
+ *	Hashed indexes for large directories.  Directories are searched
+ *	linearly, which is fine for most of them but makes lookups and
+ *	creates in directories with thousands of entries read every
+ *	block.  When a directory grows past fslclDirIndexThreshold bytes
+ *	an index is built for it the next time it is searched.  The
+ *	index maps the hash of each name to the offset of its entry, and
+ *	records how large an entry each directory block has room for.
+ *
+ *	The index lives only in memory, hanging off the directory's
+ *	I/O handle, so the format of directory blocks is unchanged.  It
+ *	is kept up to date by InsertComponent and DeleteComponent, which
+ *	are the only routines that add or remove names, and is used
+ *	while the directory handle is locked.  Entries never move within
+ *	a directory, so the offsets in the index agree with the offsets
+ *	recorded in the directory change log.  If anything goes wrong
+ *	the index is thrown away and built again when next needed.
+ *
+ * Copyright 1990 Regents of the University of California
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ */
+
+#ifndef lint
+static char rcsid[] = "$Header$ SPRITE (Berkeley)";
+#endif not lint
+
+#include <sprite.h>
+#include <fs.h>
+#include <fsutil.h>
+#include <fslcl.h>
+#include <fslclInt.h>
+#include <fscache.h>
+#include <fsStat.h>
+#include <string.h>
+#include <stdlib.h>
+
+/*
+ * Directories at least this many bytes long get an index.
+ */
+int fslclDirIndexThreshold = 8 * FS_BLOCK_SIZE;
+
+/*
+ * Set to FALSE to search all directories linearly.
+ */
+Boolean fslclDirIndexing = TRUE;
+
+/*
+ * An index entry for one name in the directory.
+ */
+typedef struct DirIndexEntry {
+    struct DirIndexEntry *nextPtr;	/* Next entry in the same bucket. */
+    unsigned int	hash;		/* Hash of the name. */
+    int			offset;		/* Offset of the entry. */
+} DirIndexEntry;
+
+typedef struct FslclDirIndex {
+    DirIndexEntry	**buckets;	/* Chains of entries, by name hash. */
+    int			numBuckets;	/* A power of two. */
+    int			numEntries;	/* Names in the index. */
+    short		*blockRoom;	/* Largest record that fits in each
+					 * directory block without growing
+					 * the directory. */
+    int			numBlocks;	/* Blocks in blockRoom. */
+    int			maxBlocks;	/* Allocated blockRoom. */
+} FslclDirIndex;
+
+#define	DIR_INDEX_BUCKETS	256
+
+static unsigned int NameHash _ARGS_((char *component, int compLen));
+static void BlockRoom _ARGS_((FslclDirIndex *indexPtr, int blockNum,
+		Address blockAddr, int length));
+static void GrowBuckets _ARGS_((FslclDirIndex *indexPtr));
+static void AddEntry _ARGS_((FslclDirIndex *indexPtr, unsigned int hash,
+		int offset));
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FslclDirIndexGet --
+ *
+ *	Return the index for a directory, building it if the directory
+ *	is large enough to have one.  The directory handle must be locked.
+ *
+ * Results:
+ *	The index, or NIL if the directory should be searched linearly.
+ *
+ * Side effects:
+ *	Reads every block of the directory when the index is built.
+ *
+ *----------------------------------------------------------------------
+ */
+FslclDirIndex *
+FslclDirIndexGet(handlePtr)
+    Fsio_FileIOHandle	*handlePtr;	/* Locked directory handle. */
+{
+    register FslclDirIndex	*indexPtr;
+    register Fslcl_DirEntry	*dirEntryPtr;
+    register int		blockOffset;
+    Fscache_Block		*cacheBlockPtr;
+    ReturnStatus		status;
+    int				dirBlockNum;
+    int				length;
+    int				i;
+
+    if (handlePtr->dirIndexPtr != (FslclDirIndex *)NIL) {
+	return(handlePtr->dirIndexPtr);
+    }
+    if (!fslclDirIndexing ||
+	handlePtr->cacheInfo.attr.lastByte + 1 < fslclDirIndexThreshold) {
+	return((FslclDirIndex *)NIL);
+    }
+    indexPtr = (FslclDirIndex *)malloc(sizeof(FslclDirIndex));
+    indexPtr->numBuckets = DIR_INDEX_BUCKETS;
+    indexPtr->buckets = (DirIndexEntry **)
+	    malloc(DIR_INDEX_BUCKETS * sizeof(DirIndexEntry *));
+    for (i = 0; i < DIR_INDEX_BUCKETS; i++) {
+	indexPtr->buckets[i] = (DirIndexEntry *)NIL;
+    }
+    indexPtr->numEntries = 0;
+    indexPtr->maxBlocks =
+	    handlePtr->cacheInfo.attr.lastByte / FS_BLOCK_SIZE + 1;
+    indexPtr->blockRoom =
+	    (short *)malloc(indexPtr->maxBlocks * sizeof(short));
+    indexPtr->numBlocks = 0;
+    handlePtr->dirIndexPtr = indexPtr;
+
+    for (dirBlockNum = 0; ; dirBlockNum++) {
+	status = Fscache_BlockRead(&handlePtr->cacheInfo, dirBlockNum,
+			&cacheBlockPtr, &length, FSCACHE_DIR_BLOCK, FALSE);
+	if (status != SUCCESS) {
+	    Fslcl_DirIndexFree(handlePtr);
+	    return((FslclDirIndex *)NIL);
+	}
+	if (length == 0) {
+	    break;
+	}
+	dirEntryPtr = (Fslcl_DirEntry *)cacheBlockPtr->blockAddr;
+	blockOffset = 0;
+	while (blockOffset < length) {
+	    if (dirEntryPtr->recordLength <= 0) {
+		/*
+		 * Leave it to the linear search to complain.
+		 */
+		Fscache_UnlockBlock(cacheBlockPtr, (time_t) 0, -1, 0, 0);
+		Fslcl_DirIndexFree(handlePtr);
+		return((FslclDirIndex *)NIL);
+	    }
+	    if (dirEntryPtr->fileNumber != 0) {
+		AddEntry(indexPtr, NameHash(dirEntryPtr->fileName,
+					    dirEntryPtr->nameLength),
+			 dirBlockNum * FS_BLOCK_SIZE + blockOffset);
+	    }
+	    blockOffset += dirEntryPtr->recordLength;
+	    dirEntryPtr = (Fslcl_DirEntry *)((int)dirEntryPtr +
+					 dirEntryPtr->recordLength);
+	}
+	BlockRoom(indexPtr, dirBlockNum, cacheBlockPtr->blockAddr, length);
+	Fscache_UnlockBlock(cacheBlockPtr, (time_t) 0, -1, 0, 0);
+    }
+    return(indexPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fslcl_DirIndexFree --
+ *
+ *	Throw away the index of a directory.  This is called when the
+ *	directory handle is removed, and when the index might no longer
+ *	match the directory.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the index and sets the handle's dirIndexPtr to NIL.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Fslcl_DirIndexFree(handlePtr)
+    Fsio_FileIOHandle	*handlePtr;	/* Directory handle. */
+{
+    register FslclDirIndex	*indexPtr = handlePtr->dirIndexPtr;
+    register DirIndexEntry	*entryPtr;
+    register int		i;
+
+    if (indexPtr == (FslclDirIndex *)NIL) {
+	return;
+    }
+    for (i = 0; i < indexPtr->numBuckets; i++) {
+	while (indexPtr->buckets[i] != (DirIndexEntry *)NIL) {
+	    entryPtr = indexPtr->buckets[i];
+	    indexPtr->buckets[i] = entryPtr->nextPtr;
+	    free((Address)entryPtr);
+	}
+    }
+    free((Address)indexPtr->buckets);
+    free((Address)indexPtr->blockRoom);
+    free((Address)indexPtr);
+    handlePtr->dirIndexPtr = (FslclDirIndex *)NIL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FslclDirIndexFind --
+ *
+ *	Return the next directory block that may hold a name.  The
+ *	caller searches the block for the name.  *cursorPtr should be
+ *	NIL for the first call and is updated for the next one.
+ *
+ * Results:
+ *	A block number, or -1 if no other block can hold the name.
+ *
+ * Side effects:
+ *	Updates *cursorPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+FslclDirIndexFind(indexPtr, component, compLen, cursorPtr)
+    FslclDirIndex	*indexPtr;	/* Index of the directory. */
+    char		*component;	/* Name to look for. */
+    int			compLen;	/* Length of component. */
+    ClientData		*cursorPtr;	/* In/Out: search position. */
+{
+    register DirIndexEntry	*entryPtr;
+    register unsigned int	hash;
+    int				lastBlock = -1;
+
+    hash = NameHash(component, compLen);
+    entryPtr = (DirIndexEntry *)*cursorPtr;
+    if (entryPtr == (DirIndexEntry *)NIL) {
+	entryPtr = indexPtr->buckets[hash & (indexPtr->numBuckets - 1)];
+    } else {
+	lastBlock = entryPtr->offset / FS_BLOCK_SIZE;
+	entryPtr = entryPtr->nextPtr;
+    }
+    for ( ; entryPtr != (DirIndexEntry *)NIL; entryPtr = entryPtr->nextPtr) {
+	if ((entryPtr->hash == hash) &&
+	    (entryPtr->offset / FS_BLOCK_SIZE != lastBlock)) {
+	    *cursorPtr = (ClientData)entryPtr;
+	    return(entryPtr->offset / FS_BLOCK_SIZE);
+	}
+    }
+    return(-1);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FslclDirIndexRoom --
+ *
+ *	Find a directory block with room for a new entry.
+ *
+ * Results:
+ *	The first block at or after startBlock with room for a record
+ *	of recordLength bytes.  If there is none this is the last block
+ *	of the directory, which the caller extends, or startBlock if
+ *	that is already past the end.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+FslclDirIndexRoom(indexPtr, startBlock, recordLength)
+    FslclDirIndex	*indexPtr;	/* Index of the directory. */
+    int			startBlock;	/* First block to consider. */
+    int			recordLength;	/* Size of the new record. */
+{
+    register int blockNum;
+
+    for (blockNum = startBlock; blockNum < indexPtr->numBlocks; blockNum++) {
+	if (indexPtr->blockRoom[blockNum] >= recordLength) {
+	    return(blockNum);
+	}
+    }
+    if (startBlock < indexPtr->numBlocks) {
+	return(indexPtr->numBlocks - 1);
+    }
+    return(startBlock);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FslclDirIndexInsert --
+ * FslclDirIndexDelete --
+ *
+ *	Update the index after a name has been added to or deleted from
+ *	a directory block.  These are called with the modified block
+ *	before it is written.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Adds or removes the name's entry and recomputes the room left
+ *	in the block.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+FslclDirIndexInsert(indexPtr, component, compLen, offset, blockAddr, length)
+    FslclDirIndex	*indexPtr;	/* Index of the directory. */
+    char		*component;	/* Name that was added. */
+    int			compLen;	/* Length of component. */
+    int			offset;		/* Offset of its entry. */
+    Address		blockAddr;	/* The modified directory block. */
+    int			length;		/* Valid bytes in the block. */
+{
+    AddEntry(indexPtr, NameHash(component, compLen), offset);
+    BlockRoom(indexPtr, offset / FS_BLOCK_SIZE, blockAddr, length);
+}
+
+void
+FslclDirIndexDelete(indexPtr, component, compLen, offset, blockAddr, length)
+    FslclDirIndex	*indexPtr;	/* Index of the directory. */
+    char		*component;	/* Name that was deleted. */
+    int			compLen;	/* Length of component. */
+    int			offset;		/* Offset of its entry. */
+    Address		blockAddr;	/* The modified directory block. */
+    int			length;		/* Valid bytes in the block. */
+{
+    register DirIndexEntry	**entryPtrPtr;
+    register DirIndexEntry	*entryPtr;
+    register unsigned int	hash;
+
+    hash = NameHash(component, compLen);
+    entryPtrPtr = &indexPtr->buckets[hash & (indexPtr->numBuckets - 1)];
+    for (entryPtr = *entryPtrPtr; entryPtr != (DirIndexEntry *)NIL;
+	 entryPtrPtr = &entryPtr->nextPtr, entryPtr = *entryPtrPtr) {
+	if (entryPtr->offset == offset) {
+	    *entryPtrPtr = entryPtr->nextPtr;
+	    free((Address)entryPtr);
+	    indexPtr->numEntries--;
+	    break;
+	}
+    }
+    BlockRoom(indexPtr, offset / FS_BLOCK_SIZE, blockAddr, length);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NameHash --
+ *
+ *	Hash a pathname component.
+ *
+ * Results:
+ *	The hash value.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static unsigned int
+NameHash(component, compLen)
+    register char	*component;	/* Name to hash. */
+    register int	compLen;	/* Length of component. */
+{
+    register unsigned int hash = 0;
+
+    while (compLen-- > 0) {
+	hash = hash * 31 + *component++;
+    }
+    return(hash);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * BlockRoom --
+ *
+ *	Recompute the largest record that fits in a directory block,
+ *	either in a deleted entry or in the bytes left over at the end
+ *	of a valid one.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets the block's slot in blockRoom, growing the array and
+ *	the block count if the block is new.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+BlockRoom(indexPtr, blockNum, blockAddr, length)
+    register FslclDirIndex *indexPtr;	/* Index of the directory. */
+    int			blockNum;	/* Block within the directory. */
+    Address		blockAddr;	/* Contents of the block. */
+    int			length;		/* Valid bytes in the block. */
+{
+    register Fslcl_DirEntry	*dirEntryPtr;
+    register int		blockOffset;
+    register int		room;
+    register int		maxRoom = 0;
+
+    if (blockNum >= indexPtr->maxBlocks) {
+	short *newRoom;
+	int newMax = 2 * indexPtr->maxBlocks;
+
+	if (newMax <= blockNum) {
+	    newMax = blockNum + 1;
+	}
+	newRoom = (short *)malloc(newMax * sizeof(short));
+	bcopy((Address)indexPtr->blockRoom, (Address)newRoom,
+		indexPtr->numBlocks * sizeof(short));
+	free((Address)indexPtr->blockRoom);
+	indexPtr->blockRoom = newRoom;
+	indexPtr->maxBlocks = newMax;
+    }
+    while (indexPtr->numBlocks <= blockNum) {
+	indexPtr->blockRoom[indexPtr->numBlocks] = 0;
+	indexPtr->numBlocks++;
+    }
+    dirEntryPtr = (Fslcl_DirEntry *)blockAddr;
+    for (blockOffset = 0; blockOffset < length;
+	 blockOffset += dirEntryPtr->recordLength,
+	 dirEntryPtr = (Fslcl_DirEntry *)((int)dirEntryPtr +
+					  dirEntryPtr->recordLength)) {
+	if (dirEntryPtr->recordLength <= 0) {
+	    break;
+	}
+	if (dirEntryPtr->fileNumber != 0) {
+	    room = dirEntryPtr->recordLength -
+		    Fslcl_DirRecLength(dirEntryPtr->nameLength);
+	} else {
+	    room = dirEntryPtr->recordLength;
+	}
+	if (room > maxRoom) {
+	    maxRoom = room;
+	}
+    }
+    indexPtr->blockRoom[blockNum] = maxRoom;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddEntry --
+ *
+ *	Add a name to the index, doubling the number of buckets when
+ *	the chains get long.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Allocates an index entry.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+AddEntry(indexPtr, hash, offset)
+    register FslclDirIndex *indexPtr;	/* Index of the directory. */
+    unsigned int	hash;		/* Hash of the name. */
+    int			offset;		/* Offset of its entry. */
+{
+    register DirIndexEntry *entryPtr;
+    register DirIndexEntry **bucketPtr;
+
+    if (indexPtr->numEntries >= 2 * indexPtr->numBuckets) {
+	GrowBuckets(indexPtr);
+    }
+    entryPtr = (DirIndexEntry *)malloc(sizeof(DirIndexEntry));
+    entryPtr->hash = hash;
+    entryPtr->offset = offset;
+    bucketPtr = &indexPtr->buckets[hash & (indexPtr->numBuckets - 1)];
+    entryPtr->nextPtr = *bucketPtr;
+    *bucketPtr = entryPtr;
+    indexPtr->numEntries++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GrowBuckets --
+ *
+ *	Double the number of buckets in an index and rehash its entries.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Replaces the bucket array.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+GrowBuckets(indexPtr)
+    register FslclDirIndex *indexPtr;	/* Index of the directory. */
+{
+    register DirIndexEntry	**newBuckets;
+    register DirIndexEntry	*entryPtr;
+    register int		newNum;
+    register int		i;
+    DirIndexEntry		**bucketPtr;
+
+    newNum = 2 * indexPtr->numBuckets;
+    newBuckets = (DirIndexEntry **)malloc(newNum * sizeof(DirIndexEntry *));
+    for (i = 0; i < newNum; i++) {
+	newBuckets[i] = (DirIndexEntry *)NIL;
+    }
+    for (i = 0; i < indexPtr->numBuckets; i++) {
+	while (indexPtr->buckets[i] != (DirIndexEntry *)NIL) {
+	    entryPtr = indexPtr->buckets[i];
+	    indexPtr->buckets[i] = entryPtr->nextPtr;
+	    bucketPtr = &newBuckets[entryPtr->hash & (newNum - 1)];
+	    entryPtr->nextPtr = *bucketPtr;
+	    *bucketPtr = entryPtr;
+	}
+    }
+    free((Address)indexPtr->buckets);
+    indexPtr->buckets = newBuckets;
+    indexPtr->numBuckets = newNum;
+}
@@ -85,4 +85,23 @@ extern ReturnStatus FslclSetAttr _ARGS_((Fs_FileID *fileIDPtr,
 extern void FslclAssignAttrs _ARGS_((Fsio_FileIOHandle *handlePtr,
 		Boolean isExeced, Fs_Attributes *attrPtr));
 
+/*
+ * Hashed indexes for large directories, see fslclDirIndex.c.
+ */
+extern int fslclDirIndexThreshold;
+extern Boolean fslclDirIndexing;
+
+extern struct FslclDirIndex *FslclDirIndexGet _ARGS_((
+		Fsio_FileIOHandle *handlePtr));
+extern int FslclDirIndexFind _ARGS_((struct FslclDirIndex *indexPtr,
+		char *component, int compLen, ClientData *cursorPtr));
+extern int FslclDirIndexRoom _ARGS_((struct FslclDirIndex *indexPtr,
+		int startBlock, int recordLength));
+extern void FslclDirIndexInsert _ARGS_((struct FslclDirIndex *indexPtr,
+		char *component, int compLen, int offset, Address blockAddr,
+		int length));
+extern void FslclDirIndexDelete _ARGS_((struct FslclDirIndex *indexPtr,
+		char *component, int compLen, int offset, Address blockAddr,
+		int length));
+
 #endif /* _FSLCLINT */
@@ -84,12 +84,13 @@ static ReturnStatus CreateFile _ARGS_((Fsdm_Domain *domainPtr,
 		Fsio_FileIOHandle *parentHandlePtr, char *component, 
 		int compLen, int fileNumber, int type, int permissions, 
 		Fs_UserIDs *idPtr, Fsio_FileIOHandle **curHandlePtrPtr, 
-		int *dirOffsetPtr));
+		int *dirOffsetPtr, List_Links *revokeList));
 static ReturnStatus WriteNewDirectory _ARGS_((Fsio_FileIOHandle *curHandlePtr,
 		Fsio_FileIOHandle *parentHandlePtr));
 static ReturnStatus LinkFile _ARGS_((Fsio_FileIOHandle *parentHandlePtr,
 		char *component, int compLen, int fileNumber, int logOp, 
-		Fsio_FileIOHandle **curHandlePtrPtr, int clientID));
+		Fsio_FileIOHandle **curHandlePtrPtr, int clientID,
+		List_Links *revokeList));
 static ReturnStatus OkToMoveDirectory _ARGS_((
 		Fsio_FileIOHandle *newParentHandlePtr, 
 		Fsio_FileIOHandle *curHandlePtr));
@@ -102,7 +103,8 @@ static ReturnStatus SetParentNumber _ARGS_((Fsio_FileIOHandle *curHandlePtr,
 		int newParentNumber));
 static ReturnStatus DeleteFileName _ARGS_((Fsio_FileIOHandle *parentHandlePtr,
 		Fsio_FileIOHandle *curHandlePtr, char *component, int compLen,
-		int forRename, Fs_UserIDs *idPtr, int logOp, int clientID));
+		int forRename, Fs_UserIDs *idPtr, int logOp, int clientID,
+		List_Links *revokeList));
 static void	CloseDeletedFile _ARGS_((Fsio_FileIOHandle **parentHandlePtrPtr,
 					Fsio_FileIOHandle **curHandlePtrPtr));
 static Boolean DirectoryEmpty _ARGS_((Fsio_FileIOHandle *handlePtr));
@@ -196,6 +198,8 @@ FslclLookup(prefixHdrPtr, relativeName, rootIDPtr, useFlags, type, clientID,
     ClientData	recovLogClientData = (ClientData) 0;
 					/* Client data for directory change
 					 * logging in the recovery system. */
+    List_Links	revokeList;		/* Name leases to revoke once the
+					 * lookup is done. */
     /*
      * Get a handle on the domain of the file.  This is needed for disk I/O.
      * Remember that the <major> field of the fileID is a domain number.
@@ -219,6 +223,7 @@ FslclLookup(prefixHdrPtr, relativeName, rootIDPtr, useFlags, type, clientID,
     curHandlePtr = Fsutil_HandleDupType(Fsio_FileIOHandle, prefixHdrPtr);
     parentHandlePtr = (Fsio_FileIOHandle *)NIL;
     newNameBuffer = (char *)NIL;
+    List_Init(&revokeList);
     /*
      * Loop through the pathname expanding links and checking permissions.
      * Creations and deletions are handled after this loop.
@@ -500,7 +505,7 @@ endScan:
 			    status = CreateFile(domainPtr, parentHandlePtr,
 				     component, compLen, newFileNumber, type,
 				     permissions, idPtr, &curHandlePtr,
-				     &dirOffset);
+				     &dirOffset, &revokeList);
 			    if (status != SUCCESS) {
 				(void)Fsdm_FreeFileNumber(domainPtr,
 						newFileNumber);
@@ -586,7 +591,7 @@ endScan:
 			deletedHandlePtr = curHandlePtr;
 			status = DeleteFileName(parentHandlePtr,
 			      curHandlePtr, component, compLen, FALSE, idPtr,
-			      FSDM_LOG_RENAME_DELETE, clientID);
+			      FSDM_LOG_RENAME_DELETE, clientID, &revokeList);
 			if (status == SUCCESS) {
 			    fileDeleted = TRUE;
 			}
@@ -607,7 +612,7 @@ endScan:
 		if (status == SUCCESS) {
 		    status = LinkFile(parentHandlePtr,
 				component, compLen, fileNumber, logOp,
-				&curHandlePtr, clientID);
+				&curHandlePtr, clientID, &revokeList);
 		    if (status == SUCCESS) {
 			(void)Fsdm_FileDescStore(curHandlePtr, FALSE);
 		    }
@@ -630,7 +635,7 @@ endScan:
 			status = DeleteFileName(parentHandlePtr, curHandlePtr,
 				component, compLen,
 				(int) (useFlags & FS_RENAME), idPtr, logOp,
-				clientID);
+				clientID, &revokeList);
 			if (status == SUCCESS) {
 			    CloseDeletedFile(&parentHandlePtr,
 					&curHandlePtr);
@@ -656,6 +661,13 @@ endScan:
 	    curHandlePtr = (Fsio_FileIOHandle *)NIL;
 	} 
     }
+    /*
+     * Have the clients caching the names we changed called back.  This
+     * doesn't wait for the call-backs.
+     */
+    if (!List_IsEmpty(&revokeList)) {
+	Fsconsist_RevokeCollected(&revokeList);
+    }
     if (handlePtrPtr != (Fsio_FileIOHandle **)NIL) {
 	/*
 	 * Return a locked handle that has had its reference count bumped.
@@ -719,6 +731,8 @@ FindComponent(parentHandlePtr, component, compLen, isDotDot, curHandlePtrPtr,
     int 		length;		/* Length variable for read call */
     FslclHashEntry		*entryPtr;	/* Name cache entry */
     Fs_FileID		fileID;		/* Used when fetching handles */
+    struct FslclDirIndex *indexPtr;	/* Index of a large directory */
+    ClientData		cursor;		/* Search position in the index */
 
     /*
      * Check in system-wide name cache here before scanning
@@ -726,7 +740,13 @@ FindComponent(parentHandlePtr, component, compLen, isDotDot, curHandlePtrPtr,
      */
     entryPtr = FSLCL_HASH_LOOK_ONLY(fslclNameTablePtr, component, parentHandlePtr);
     if (entryPtr != (FslclHashEntry *)NIL) {
-	if (entryPtr->hdrPtr->fileID.type != FSIO_LCL_FILE_STREAM) {
+	if (entryPtr->hdrPtr == (Fs_HandleHeader *)NIL) {
+	    /*
+	     * A negative entry: the name isn't in the directory.
+	     */
+	    *curHandlePtrPtr = (Fsio_FileIOHandle *)NIL;
+	    return(FS_FILE_NOT_FOUND);
+	} else if (entryPtr->hdrPtr->fileID.type != FSIO_LCL_FILE_STREAM) {
 	    panic(
 		      "FindComponent: got trashy handle from cache");
 	} else {
@@ -744,11 +764,35 @@ FindComponent(parentHandlePtr, component, compLen, isDotDot, curHandlePtrPtr,
 	}
     }
 
-    dirBlockNum = 0;
+    /*
+     * A large directory has an index that tells us which blocks to
+     * look in.  Otherwise we scan all of the directory's blocks.
+     */
+    indexPtr = FslclDirIndexGet(parentHandlePtr);
+    cursor = (ClientData)NIL;
+    if (indexPtr == (struct FslclDirIndex *)NIL) {
+	dirBlockNum = 0;
+    } else {
+	dirBlockNum = FslclDirIndexFind(indexPtr, component, compLen, &cursor);
+    }
     do {
+	if (dirBlockNum < 0) {
+	    FSLCL_HASH_INSERT_NEGATIVE(fslclNameTablePtr, component,
+				       parentHandlePtr);
+	    *curHandlePtrPtr = (Fsio_FileIOHandle *)NIL;
+	    return(FS_FILE_NOT_FOUND);
+	}
 	status = Fscache_BlockRead(&parentHandlePtr->cacheInfo, dirBlockNum,
 			&cacheBlockPtr, &length, FSCACHE_DIR_BLOCK, FALSE);
 	if (status != SUCCESS || length == 0) {
+	    if (status == SUCCESS) {
+		/*
+		 * Remember that the name isn't here so the next lookup
+		 * doesn't have to scan the directory again.
+		 */
+		FSLCL_HASH_INSERT_NEGATIVE(fslclNameTablePtr, component,
+					   parentHandlePtr);
+	    }
 	    *curHandlePtrPtr = (Fsio_FileIOHandle *)NIL;
 	    return(FS_FILE_NOT_FOUND);
 	}
@@ -857,7 +901,12 @@ FindComponent(parentHandlePtr, component, compLen, isDotDot, curHandlePtrPtr,
 	    dirEntryPtr = (Fslcl_DirEntry *)((int)dirEntryPtr +
 					 dirEntryPtr->recordLength);
 	}
-	dirBlockNum++;
+	if (indexPtr == (struct FslclDirIndex *)NIL) {
+	    dirBlockNum++;
+	} else {
+	    dirBlockNum = FslclDirIndexFind(indexPtr, component, compLen,
+					    &cursor);
+	}
 	Fscache_UnlockBlock(cacheBlockPtr, (time_t) 0, -1, 0, 0);
     } while(TRUE);
 exit:
@@ -899,14 +948,25 @@ InsertComponent(curHandlePtr, component, compLen, fileNumber, dirOffsetPtr)
     int 		extraBytes;	/* The number of free bytes attached to
 				 	 * a directory entry. */
     Fscache_Block	*cacheBlockPtr;	/* Cache block. */
+    struct FslclDirIndex *indexPtr;	/* Index of a large directory */
+
+    /*
+     * Forget any negative name cache entry for the new name.
+     */
+    FSLCL_HASH_DELETE(fslclNameTablePtr, component, curHandlePtr);
 
     length = FS_BLOCK_SIZE;
     recordLength = Fslcl_DirRecLength(compLen);
     /*
      * Loop through the directory blocks looking for space of at least
-     * recordLength in which to insert the new directory record.
+     * recordLength in which to insert the new directory record.  The
+     * index of a large directory lets us skip blocks that are full.
      */
+    indexPtr = FslclDirIndexGet(curHandlePtr);
     dirBlockNum = 0;
+    if (indexPtr != (struct FslclDirIndex *)NIL) {
+	dirBlockNum = FslclDirIndexRoom(indexPtr, dirBlockNum, recordLength);
+    }
     do {
 	/*
 	 * Read in a full data block.
@@ -992,6 +1052,10 @@ InsertComponent(curHandlePtr, component, compLen, fileNumber, dirOffsetPtr)
 	}
 
 	dirBlockNum++;
+	if (indexPtr != (struct FslclDirIndex *)NIL) {
+	    dirBlockNum = FslclDirIndexRoom(indexPtr, dirBlockNum,
+					    recordLength);
+	}
 	Fscache_UnlockBlock(cacheBlockPtr,
 	                    (time_t) 0, -1, 0, FSCACHE_CLEAR_READ_AHEAD);
     } while(TRUE);
@@ -1022,7 +1086,14 @@ haveASlot:
 
     blockOffset = (((char *)dirEntryPtr) - (char *)(cacheBlockPtr->blockAddr));
     *dirOffsetPtr = dirBlockNum * FS_BLOCK_SIZE + blockOffset;
+    if (indexPtr != (struct FslclDirIndex *)NIL) {
+	FslclDirIndexInsert(indexPtr, component, compLen, *dirOffsetPtr,
+			    cacheBlockPtr->blockAddr, length);
+    }
     status = CacheDirBlockWrite(curHandlePtr,cacheBlockPtr,dirBlockNum,length);
+    if (status != SUCCESS) {
+	Fslcl_DirIndexFree(curHandlePtr);
+    }
     return(status);
 }
 
@@ -1059,9 +1130,20 @@ DeleteComponent(parentHandlePtr, component, compLen, dirOffsetPtr)
     int 		length;		/* Length variable for read call */
     Fscache_Block	*cacheBlockPtr;	/* Cache block. */
     int			dirBlockNum;
+    struct FslclDirIndex *indexPtr;	/* Index of a large directory */
+    ClientData		cursor;		/* Search position in the index */
 
-    dirBlockNum = 0;
+    indexPtr = FslclDirIndexGet(parentHandlePtr);
+    cursor = (ClientData)NIL;
+    if (indexPtr == (struct FslclDirIndex *)NIL) {
+	dirBlockNum = 0;
+    } else {
+	dirBlockNum = FslclDirIndexFind(indexPtr, component, compLen, &cursor);
+    }
     do {
+	if (dirBlockNum < 0) {
+	    return(FS_FILE_NOT_FOUND);
+	}
 	status = Fscache_BlockRead(&parentHandlePtr->cacheInfo, dirBlockNum,
 			  &cacheBlockPtr, &length, FSCACHE_DIR_BLOCK, FALSE);
 	if (status != SUCCESS || length == 0) {
@@ -1087,11 +1169,18 @@ DeleteComponent(parentHandlePtr, component, compLen, dirOffsetPtr)
 		     */
 		    lastDirEntryPtr->recordLength += dirEntryPtr->recordLength;
 		}
+		if (indexPtr != (struct FslclDirIndex *)NIL) {
+		    FslclDirIndexDelete(indexPtr, component, compLen,
+			    *dirOffsetPtr, cacheBlockPtr->blockAddr, length);
+		}
 		/*
 		 * Write out the modified directory block.
 		 */
 		status = CacheDirBlockWrite(parentHandlePtr, cacheBlockPtr, 
 					   dirBlockNum, length);
+		if (status != SUCCESS) {
+		    Fslcl_DirIndexFree(parentHandlePtr);
+		}
 		return(status);
 	    }
 	    blockOffset += dirEntryPtr->recordLength;
@@ -1103,7 +1192,12 @@ DeleteComponent(parentHandlePtr, component, compLen, dirOffsetPtr)
 	    dirEntryPtr = 
 		(Fslcl_DirEntry *)((int)dirEntryPtr + dirEntryPtr->recordLength);
 	}
-	dirBlockNum++;
+	if (indexPtr == (struct FslclDirIndex *)NIL) {
+	    dirBlockNum++;
+	} else {
+	    dirBlockNum = FslclDirIndexFind(indexPtr, component, compLen,
+					    &cursor);
+	}
 	Fscache_UnlockBlock(cacheBlockPtr, (time_t) 0,
 	                    -1, 0, FSCACHE_CLEAR_READ_AHEAD);
     } while(TRUE);
@@ -1300,7 +1394,7 @@ GetHandle(fileNumber, newDescPtr, curHandlePtr, name, newHandlePtrPtr)
  */
 static ReturnStatus
 CreateFile(domainPtr, parentHandlePtr, component, compLen, fileNumber, type,
-	   permissions, idPtr, curHandlePtrPtr, dirOffsetPtr)
+	   permissions, idPtr, curHandlePtrPtr, dirOffsetPtr, revokeList)
     Fsdm_Domain	*domainPtr;		/* Domain of the file */
     Fsio_FileIOHandle	*parentHandlePtr;/* Handle of directory in which to add 
 					 * file. */
@@ -1312,6 +1406,7 @@ CreateFile(domainPtr, parentHandlePtr, component, compLen, fileNumber, type,
     Fs_UserIDs	*idPtr;			/* User ID of calling process */
     Fsio_FileIOHandle	**curHandlePtrPtr;/* Return, handle for the new file */
     int		*dirOffsetPtr;  /* OUT: directory offset of component's entry.*/
+    List_Links	*revokeList;	/* Leases on the parent are added here */
 {
     ReturnStatus	status;
     Fsdm_FileDescriptor	*parentDescPtr;	/* Descriptor for the parent */
@@ -1389,6 +1484,8 @@ CreateFile(domainPtr, parentHandlePtr, component, compLen, fileNumber, type,
 	free((Address) newDescPtr);
     } else {
        (void)Fsdm_FileDescStore(parentHandlePtr, FALSE);
+       Fsconsist_CollectLeases(&parentHandlePtr->hdr.fileID, FALSE,
+		revokeList);
     }
     return(status);
 }
@@ -1468,7 +1565,7 @@ WriteNewDirectory(curHandlePtr, parentHandlePtr)
  */
 static ReturnStatus
 LinkFile(parentHandlePtr, component, compLen, fileNumber, logOp,curHandlePtrPtr,
-	clientID)
+	clientID, revokeList)
     Fsio_FileIOHandle	*parentHandlePtr;/* Handle of directory in which to add 
 					 * file. */
     char	*component;		/* Name of the file */
@@ -1477,6 +1574,7 @@ LinkFile(parentHandlePtr, component, compLen, fileNumber, logOp,curHandlePtrPtr,
     int		logOp;
     Fsio_FileIOHandle	**curHandlePtrPtr;/* Return, handle for the new file */
     int		clientID;		/* ID of requesting client. */
+    List_Links	*revokeList;		/* Leases to revoke are added here */
 {
     ReturnStatus	status;
     Fsdm_FileDescriptor	*linkDescPtr;	/* Descriptor for the existing file */
@@ -1562,6 +1660,16 @@ LinkFile(parentHandlePtr, component, compLen, fileNumber, logOp,curHandlePtrPtr,
 			component, compLen, fileNumber, linkDescPtr->fileType,
 			linkDescPtr, recovLogClientData, status);
 	}
+	if (status == SUCCESS) {
+	    /*
+	     * The link count and the parent have changed.  Moving a
+	     * directory changes every name beneath it.
+	     */
+	    Fsconsist_CollectLeases(&(*curHandlePtrPtr)->hdr.fileID,
+		    (linkDescPtr->fileType == FS_DIRECTORY), revokeList);
+	    Fsconsist_CollectLeases(&parentHandlePtr->hdr.fileID, FALSE,
+		    revokeList);
+	}
     }
     return(status);
 }
@@ -1858,7 +1966,7 @@ SetParentNumber(curHandlePtr, newParentNumber)
  */
 static ReturnStatus
 DeleteFileName(parentHandlePtr, curHandlePtr, component,
-	     compLen, forRename, idPtr, logOp, clientID)
+	     compLen, forRename, idPtr, logOp, clientID, revokeList)
     Fsio_FileIOHandle *parentHandlePtr;	/* Handle of directory in
 						 * which to delete file*/
     Fsio_FileIOHandle *curHandlePtr;	/* Handle of file to delete */
@@ -1870,6 +1978,7 @@ DeleteFileName(parentHandlePtr, curHandlePtr, component,
     Fs_UserIDs *idPtr;		/* User and group IDs */
     int		logOp;		/* Directory log operation.; */
     int		clientID;
+    List_Links	*revokeList;	/* Leases to revoke are added here */
 {
     ReturnStatus status;
     Fsdm_FileDescriptor *parentDescPtr;	/* Descriptor for parent */
@@ -1985,6 +2094,17 @@ DeleteFileName(parentHandlePtr, curHandlePtr, component,
 		component, compLen, fileNumber, type,
 		curDescPtr, recovLogClientData, status);
     }
+    if (status == SUCCESS) {
+	/*
+	 * Clients can no longer cache this name.  Names that were
+	 * looked up through a link are lost along with the link.
+	 */
+	Fsconsist_CollectLeases(&curHandlePtr->hdr.fileID,
+		(type == FS_SYMBOLIC_LINK || type == FS_REMOTE_LINK),
+		revokeList);
+	Fsconsist_CollectLeases(&parentHandlePtr->hdr.fileID, FALSE,
+		revokeList);
+    }
     return(status);
 }
 
@@ -2085,8 +2205,10 @@ Fslcl_DeleteFileDesc(handlePtr)
 	/*
 	 * Remove .. from the name cache so we don't end up with
 	 * a bad cache entry later when this directory is re-created.
+	 * Negative entries for names in it go too.
 	 */
 	FSLCL_HASH_DELETE(fslclNameTablePtr, "..", handlePtr);
+	FSLCL_HASH_PURGE(fslclNameTablePtr, handlePtr);
     }
 
     domainPtr = Fsdm_DomainFetch(handlePtr->hdr.fileID.major, FALSE);
@@ -2449,7 +2571,8 @@ Fslcl_CheckDirLog(parentHandlePtr, dirLogList)
 	entryPtr =
 	    FSLCL_HASH_LOOK_ONLY(fslclNameTablePtr, component, parentHandlePtr);
 
-	if (entryPtr != (FslclHashEntry *)NIL) {
+	if (entryPtr != (FslclHashEntry *)NIL &&
+	    entryPtr->hdrPtr != (Fs_HandleHeader *)NIL) {
 	    if (entryPtr->hdrPtr->fileID.type != FSIO_LCL_FILE_STREAM) {
 		panic("Fslcl_CheckDirLog: got trashy handle from cache");
 	    }
@@ -6,6 +6,16 @@
  *      in LRU order (in another list) for replacement when the table is
  *      full.
  *
+ *	An entry with a NIL hdrPtr is a negative entry.  It records that
+ *	the name is not in the directory, so repeated failed lookups
+ *	don't have to scan the directory blocks.  Names are only added
+ *	to directories by InsertComponent, which removes the negative
+ *	entry before it adds the name.
+ *
+ *	The table grows when it fills up with entries that are still in
+ *	use, and entries that have not been used for fslclNameHashIdle
+ *	seconds are dropped so the table can shrink again.
+ *
  * Copyright (C) 1983 Regents of the University of California
  * All rights reserved.
  */
@@ -29,7 +39,20 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 static	Sync_Lock nameHashLock = Sync_LockInitStatic("Fs:nameHashLock");
 #define	LOCKPTR	&nameHashLock
 
+/*
+ * The table does not grow beyond fslclNameHashMaxSize entries, and does
+ * not shrink below fslclNameHashSize.  An entry that has not been used
+ * for fslclNameHashIdle seconds is not part of the working set.
+ */
+int fslclNameHashMaxSize = 16 * FSLCL_NAME_HASH_SIZE;
+int fslclNameHashIdle = 60;
+
 static void HashInit _ARGS_((FslclHashTable *table, int numBuckets));
+static void AllocBuckets _ARGS_((FslclHashTable *table, int numBuckets));
+static void RebuildTable _ARGS_((FslclHashTable *table, int numBuckets));
+static void TrimTable _ARGS_((FslclHashTable *table));
+static void FreeEntry _ARGS_((FslclHashTable *table,
+			FslclHashEntry *hashEntryPtr));
 static int Hash _ARGS_((FslclHashTable *table, char *string, 
 			Fs_HandleHeader *keyHdrPtr));
 static FslclHashEntry *ChainSearch _ARGS_((FslclHashTable *table, char *string,
@@ -58,6 +81,36 @@ HashInit(table, numBuckets)
     int			numBuckets;	/* How many buckets to create for 
 					 * starters. This number is rounded up 
 					 * to a power of two. */
+{
+    table->numEntries = 0;
+    table->numNegative = 0;
+    List_Init(&(table->lruList));
+    AllocBuckets(table, numBuckets);
+}
+
+/*
+ *---------------------------------------------------------
+ * 
+ * AllocBuckets --
+ *
+ *	Allocate an empty bucket array for the hash table.
+ *
+ * Results:	
+ *	None.
+ *
+ * Side Effects:
+ *	Sets the table's size, shift and mask, and replaces its
+ *	bucket array without freeing the old one.
+ *
+ *---------------------------------------------------------
+ */
+
+static void
+AllocBuckets(table, numBuckets)
+    register FslclHashTable	*table;
+    int			numBuckets;	/* How many buckets to create.
+					 * This number is rounded up to a
+					 * power of two. */
 {
     register	int 		i;
     register	FslclHashBucket 	*tablePtr;
@@ -70,7 +123,6 @@ HashInit(table, numBuckets)
     if (numBuckets < 0) {
 	numBuckets = -numBuckets;
     }
-    table->numEntries = 0;
     table->size = 2;
     table->mask = 1;
     table->downShift = 29;
@@ -82,7 +134,6 @@ HashInit(table, numBuckets)
 
     fs_Stats.nameCache.size = table->size;
 
-    List_Init(&(table->lruList));
     table->table =
 	(FslclHashBucket *) malloc(sizeof(FslclHashBucket) * table->size);
     for (i=0, tablePtr = table->table; i < table->size; i++, tablePtr++) {
@@ -189,6 +240,7 @@ ChainSearch(table, string, keyHdrPtr, hashList)
 	     */
 	    List_Move(&(hashEntryPtr->lru.links),
 			 LIST_ATFRONT(&(table->lruList)));
+	    hashEntryPtr->lastUse = Fsutil_TimeInSeconds();
 	    return(hashEntryPtr);
 	}
     }
@@ -210,7 +262,8 @@ ChainSearch(table, string, keyHdrPtr, hashList)
  * Results:
  *	The return value is a pointer to the entry for string,
  *	if string was present in the table.  If string was not
- *	present, NIL is returned.
+ *	present, NIL is returned.  The entry's hdrPtr is NIL if
+ *	the name is known not to be in the directory.
  *
  * Side Effects:
  *	None.
@@ -230,7 +283,11 @@ FslclHashLookOnly(table, string, keyHdrPtr)
     fs_Stats.nameCache.accesses++;
     hashEntryPtr = ChainSearch(table, string, keyHdrPtr,
 		  &(table->table[Hash(table, string, keyHdrPtr)].list));
-    if (hashEntryPtr != (FslclHashEntry  *) NIL) {
+    if (hashEntryPtr == (FslclHashEntry  *) NIL) {
+	fs_Stats.nameCache.misses++;
+    } else if (hashEntryPtr->hdrPtr == (Fs_HandleHeader *)NIL) {
+	fs_Stats.nameCache.negativeHits++;
+    } else {
 	fs_Stats.nameCache.hits++;
     }
 
@@ -254,6 +311,8 @@ FslclHashLookOnly(table, string, keyHdrPtr)
  *
  *	Side Effects:
  *	Memory is allocated, and the hash buckets may be modified.
+ *	A NIL hdrPtr makes a negative entry.  The table may be
+ *	enlarged or shrunk.
  *---------------------------------------------------------
  */
 
@@ -275,46 +334,69 @@ FslclHashInsert(table, string, keyHdrPtr, hdrPtr)
 					&(bucketPtr->list));
 
     if (hashEntryPtr != (FslclHashEntry *) NIL) {
+	if (hashEntryPtr->hdrPtr == (Fs_HandleHeader *)NIL &&
+	    hdrPtr != (Fs_HandleHeader *)NIL) {
+	    /*
+	     * The name has been created since it was found missing.
+	     */
+	    hashEntryPtr->hdrPtr = hdrPtr;
+	    Fsutil_HandleIncRefCount(hdrPtr, 1);
+	    table->numNegative--;
+	    fs_Stats.nameCache.negative--;
+	}
 	UNLOCK_MONITOR;
 	return(hashEntryPtr);
     }
 
-    /* 
-     * See if we have to do LRU replacement before adding another entry.
+    /*
+     * Drop idle entries.  Then, if the table is full, either enlarge it
+     * or do LRU replacement.  The least recently used entry still being
+     * in use means the working set no longer fits in the table.
      */
 
+    TrimTable(table);
     if (table->numEntries >= table->size) {
-	fs_Stats.nameCache.replacements++;
 	lruLinkPtr = LIST_ATREAR(&(table->lruList));
 	hashEntryPtr = ((struct FsLruList *)lruLinkPtr)->entryPtr;
-	Fsutil_HandleDecRefCount(hashEntryPtr->hdrPtr);
-	Fsutil_HandleDecRefCount(hashEntryPtr->keyHdrPtr);
-	List_Remove((List_Links *)hashEntryPtr);
-	List_Remove(&(hashEntryPtr->lru.links));
-	free((Address)hashEntryPtr);
-    } else {
-	table->numEntries += 1;
+	if (table->size < fslclNameHashMaxSize &&
+	    Fsutil_TimeInSeconds() - hashEntryPtr->lastUse <
+		fslclNameHashIdle) {
+	    fs_Stats.nameCache.grows++;
+	    RebuildTable(table, table->size * 2);
+	} else {
+	    fs_Stats.nameCache.replacements++;
+	    FreeEntry(table, hashEntryPtr);
+	}
     }
+    table->numEntries += 1;
 
     /*
      * Not there, we have to allocate.  If the string is longer than 3
-     * bytes, then we have to allocate extra space in the entry.
+     * bytes, then we have to allocate extra space in the entry.  The
+     * table may have been rebuilt, so find the bucket again.
      */
 
+    bucketPtr = &(table->table[Hash(table, string, keyHdrPtr)]);
     hashEntryPtr = (FslclHashEntry *) malloc(sizeof(FslclHashEntry) + 
 			strlen(string) - 3);
     (void)strcpy(hashEntryPtr->keyName, string);
     hashEntryPtr->keyHdrPtr = keyHdrPtr;
     hashEntryPtr->hdrPtr = hdrPtr;
     hashEntryPtr->bucketPtr = bucketPtr;
+    hashEntryPtr->lastUse = Fsutil_TimeInSeconds();
     List_Insert((List_Links *) hashEntryPtr, LIST_ATFRONT(&(bucketPtr->list)));
     hashEntryPtr->lru.entryPtr = hashEntryPtr;
     List_Insert(&(hashEntryPtr->lru.links), LIST_ATFRONT(&(table->lruList)));
     /*
      * Increment the reference count on the handle since we now have it
-     * in the name cache.
+     * in the name cache.  A negative entry only references the directory.
      */
-    Fsutil_HandleIncRefCount(hdrPtr, 1);
+    if (hdrPtr != (Fs_HandleHeader *)NIL) {
+	Fsutil_HandleIncRefCount(hdrPtr, 1);
+    } else {
+	table->numNegative++;
+	fs_Stats.nameCache.negative++;
+    }
     Fsutil_HandleIncRefCount(keyHdrPtr, 1);
     UNLOCK_MONITOR;
 
@@ -353,85 +435,183 @@ FslclHashDelete(table, string, keyHdrPtr)
 		  &(table->table[Hash(table, string, keyHdrPtr)].list));
     if (hashEntryPtr != (FslclHashEntry  *) NIL) {
 	/*
-	 * Release the two handles referenced by the name cache entry.
+	 * Release the handles referenced by the name cache entry.
 	 * This is called when deleting the file, at which point both
-	 * the parent (keyHdrPtr) and the file itself (hdrPtr) are locked.
+	 * the parent (keyHdrPtr) and the file itself (hdrPtr) are locked,
+	 * and when creating a name, which removes a negative entry.
 	 */
-	Fsutil_HandleDecRefCount(hashEntryPtr->hdrPtr);
-	Fsutil_HandleDecRefCount(hashEntryPtr->keyHdrPtr);
-	List_Remove((List_Links *)hashEntryPtr);
-	List_Remove(&(hashEntryPtr->lru.links));
-	free((Address)hashEntryPtr);
-	table->numEntries--;
+	if (hashEntryPtr->hdrPtr == (Fs_HandleHeader *)NIL) {
+	    fs_Stats.nameCache.negativeFlushes++;
+	}
+	FreeEntry(table, hashEntryPtr);
+    }
+
+    UNLOCK_MONITOR;
+}
+
+/*
+ *---------------------------------------------------------
+ *
+ * FslclHashPurge --
+ *
+ * 	Remove every negative entry for names in a directory.  This
+ *	is called when the directory is deleted so the name cache
+ *	doesn't hold its handle.
+ *
+ * Results:
+ *	None.
+ *
+ * Side Effects:
+ *	Entries are removed and memory is freed.
+ *
+ *---------------------------------------------------------
+ */
+
+ENTRY void
+FslclHashPurge(table, keyHdrPtr)
+    register FslclHashTable *table;	/* Hash table to search. */
+    Fs_HandleHeader	 *keyHdrPtr;		/* Handle of the directory. */
+{
+    register List_Links		*lruLinkPtr;
+    register List_Links		*nextLinkPtr;
+    register FslclHashEntry	*hashEntryPtr;
+
+    LOCK_MONITOR;
+
+    lruLinkPtr = List_First(&(table->lruList));
+    while (table->numNegative > 0 &&
+	   !List_IsAtEnd(&(table->lruList), lruLinkPtr)) {
+	nextLinkPtr = List_Next(lruLinkPtr);
+	hashEntryPtr = ((struct FsLruList *)lruLinkPtr)->entryPtr;
+	if (hashEntryPtr->keyHdrPtr == keyHdrPtr &&
+	    hashEntryPtr->hdrPtr == (Fs_HandleHeader *)NIL) {
+	    FreeEntry(table, hashEntryPtr);
+	}
+	lruLinkPtr = nextLinkPtr;
     }
 
     UNLOCK_MONITOR;
 }
 
+/*
+ *---------------------------------------------------------
+ *
+ * FreeEntry --
+ *
+ * 	Remove an entry from the table.
+ *
+ * Results:
+ *	None.
+ *
+ * Side Effects:
+ *	Releases the handles referenced by the entry and frees it.
+ *
+ *---------------------------------------------------------
+ */
+
+INTERNAL static void
+FreeEntry(table, hashEntryPtr)
+    register FslclHashTable *table;	/* Table containing the entry. */
+    register FslclHashEntry *hashEntryPtr;	/* Entry to remove. */
+{
+    if (hashEntryPtr->hdrPtr != (Fs_HandleHeader *)NIL) {
+	Fsutil_HandleDecRefCount(hashEntryPtr->hdrPtr);
+    } else {
+	table->numNegative--;
+	fs_Stats.nameCache.negative--;
+    }
+    Fsutil_HandleDecRefCount(hashEntryPtr->keyHdrPtr);
+    List_Remove((List_Links *)hashEntryPtr);
+    List_Remove(&(hashEntryPtr->lru.links));
+    free((Address)hashEntryPtr);
+    table->numEntries--;
+}
+
+/*
+ *---------------------------------------------------------
+ *
+ * TrimTable --
+ *
+ * 	Drop a couple of entries from the LRU end of the table if they
+ *	haven't been used for fslclNameHashIdle seconds, and shrink
+ *	the table once it is mostly empty.  This is called on each
+ *	insert so the cost is spread out.
+ *
+ * Results:
+ *	None.
+ *
+ * Side Effects:
+ *	Entries may be freed and the table may be rebuilt.
+ *
+ *---------------------------------------------------------
+ */
+
+INTERNAL static void
+TrimTable(table)
+    register FslclHashTable *table;	/* Table to trim. */
+{
+    register FslclHashEntry	*hashEntryPtr;
+    register int		i;
+    int				now;
+
+    now = Fsutil_TimeInSeconds();
+    for (i = 0; i < 2 && !List_IsEmpty(&(table->lruList)); i++) {
+	hashEntryPtr =
+	    ((struct FsLruList *)LIST_ATREAR(&(table->lruList)))->entryPtr;
+	if (now - hashEntryPtr->lastUse < fslclNameHashIdle) {
+	    break;
+	}
+	FreeEntry(table, hashEntryPtr);
+    }
+    if (table->size > fslclNameHashSize &&
+	table->numEntries < table->size / 4) {
+	fs_Stats.nameCache.shrinks++;
+	RebuildTable(table, table->size / 2);
+    }
+}
+
 
 /*
  *---------------------------------------------------------
  *
- * FsRebuildTable --
- *	This local routine makes a new hash table that
- *	is larger than the old one.
+ * RebuildTable --
+ *	This local routine moves the entries of the hash table into
+ *	a new bucket array of a different size.
  *
  * Results:	
  * 	None.
  *
  * Side Effects:
  *	The entire hash table is moved, so any bucket numbers
- *	from the old table are invalid.
+ *	from the old table are invalid.  The LRU order is kept.
  *
  *---------------------------------------------------------
  */
-#ifdef notdef
-static void
-FsRebuildTable(table)
-    register	FslclHashTable 	*table;		/* Table to be enlarged. */
+INTERNAL static void
+RebuildTable(table, numBuckets)
+    register	FslclHashTable 	*table;		/* Table to be resized. */
+    int				numBuckets;	/* New size. */
 {
-    register	FslclHashBucket	*oldTable;
     register	FslclHashEntry  	*hashEntryPtr;
-    register	int 		oldSize;
-    int 		 	bucket;
+    register	List_Links		*lruLinkPtr;
     FslclHashBucket		*saveTable;
     FslclHashBucket		*bucketPtr;
-    Fs_HandleHeader		*keyHdrPtr;
-    int			 	version;
-
-    LOCK_MONITOR;
 
     saveTable = table->table;
-    oldSize = table->size;
+    AllocBuckets(table, numBuckets);
 
-    /* 
-     * Build a new table 4 times as large as the old one. 
-     */
-
-    HashInit(table, table->size * 4);
-
-    for (oldTable = saveTable; oldSize > 0; oldSize--, oldTable++) {
-	while (!List_IsEmpty(&(oldTable->list))) {
-	    hashEntryPtr = (FslclHashEntry *) List_First(&(oldTable->list));
-	    List_Remove((List_Links *) hashEntryPtr);
-	    List_Remove(&(hashEntryPtr->lru.links));
-	    keyHdrPtr = hashEntryPtr->keyHdrPtr;
-	    bucket = Hash(table, hashEntryPtr->keyName, keyHdrPtr);
-	    bucketPtr = &(table->table[bucket]);
-	    List_Insert((List_Links *) hashEntryPtr, 
-		LIST_ATFRONT(&(bucketPtr->list)));
-	    List_Insert(&(hashEntryPtr->lru.links),
-		LIST_ATFRONT(&(table->lruList)));
-	    hashEntryPtr->bucketPtr = bucketPtr;
-	    table->numEntries++;
-	}
+    LIST_FORALL(&(table->lruList), lruLinkPtr) {
+	hashEntryPtr = ((struct FsLruList *)lruLinkPtr)->entryPtr;
+	List_Remove((List_Links *) hashEntryPtr);
+	bucketPtr = &(table->table[Hash(table, hashEntryPtr->keyName,
+					hashEntryPtr->keyHdrPtr)]);
+	List_Insert((List_Links *) hashEntryPtr, 
+	    LIST_ATFRONT(&(bucketPtr->list)));
+	hashEntryPtr->bucketPtr = bucketPtr;
     }
 
     free((Address) saveTable);
-
-    UNLOCK_MONITOR;
 }
-#endif notdef
 
 /*
  *---------------------------------------------------------
@@ -477,8 +657,8 @@ FslclNameHashStats()
 	}
     }
 
-    printf("FS Name Hash Table, %d entries in %d buckets\n", 
-		table->numEntries, table->size);
+    printf("FS Name Hash Table, %d entries (%d negative) in %d buckets\n", 
+		table->numEntries, table->numNegative, table->size);
     for (i = 0;  i < 10; i++) {
 	printf("%d buckets with %d entries\n", count[i], i);
     }
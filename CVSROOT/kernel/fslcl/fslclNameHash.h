@@ -31,15 +31,21 @@ typedef struct FslclHashTable {
     List_Links		lruList;	/* The header of the LRU list */
     int 		size;		/* Actual size of array. */
     int 		numEntries;	/* Number of entries in the table. */
+    int 		numNegative;	/* Number of those that are negative
+					 * entries. */
     int 		downShift;	/* Shift count, used in hashing 
 					 * function. */
     int 		mask;		/* Used to select bits for hashing. */
 } FslclHashTable;
 
 /*
- * Default size of the name hash table.
+ * Default size of the name hash table.  It grows as far as
+ * fslclNameHashMaxSize to hold the working set, and shrinks back
+ * when entries are idle for fslclNameHashIdle seconds.
  */
 extern fslclNameHashSize;
+extern int fslclNameHashMaxSize;
+extern int fslclNameHashIdle;
 #define FSLCL_NAME_HASH_SIZE	512
 
 /*
@@ -61,8 +67,10 @@ typedef struct FslclHashEntry {
 	List_Links links;	/* Links for the LRU list */
 	struct FslclHashEntry *entryPtr;	/* Back pointer needed to get entry */
     } lru;
-    Fs_HandleHeader *hdrPtr;	/* Pointer to handle of named component. */
+    Fs_HandleHeader *hdrPtr;	/* Pointer to handle of named component,
+				 * NIL if the name is not in the parent. */
     Fs_HandleHeader *keyHdrPtr;	/* Pointer to handle of parent directory. */
+    int		lastUse;	/* When last used, in seconds. */
     char 	keyName[4];	/* Text name of this entry.  Note: the
 				 * actual size may be longer if necessary
 				 * to hold the whole string. This MUST be
@@ -92,6 +100,8 @@ extern void FslclHashDelete _ARGS_((FslclHashTable *table, char *string,
 extern FslclHashEntry *FslclHashInsert _ARGS_((FslclHashTable *table, 
 			char *string, Fs_HandleHeader *keyHdrPtr, 
 			Fs_HandleHeader *hdrPtr));
+extern void FslclHashPurge _ARGS_((FslclHashTable *table,
+			Fs_HandleHeader *keyHdrPtr));
 
 #define FSLCL_HASH_LOOK_ONLY(table, string, keyHandle) \
     (fslclNameCaching ? \
@@ -104,9 +114,27 @@ extern FslclHashEntry *FslclHashInsert _ARGS_((FslclHashTable *table,
 			   (Fs_HandleHeader *)handle); \
     }
 
-#define FSLCL_HASH_DELETE(table, string, keyHandle) \
+#define FSLCL_HASH_INSERT_NEGATIVE(table, string, keyHandle) \
     if (fslclNameCaching) { \
+	(void)FslclHashInsert(table, string, (Fs_HandleHeader *)keyHandle, \
+			   (Fs_HandleHeader *)NIL); \
+    }
+
+/*
+ * Deletes and purges are done even if name caching has been turned off.
+ * Entries made before caching was turned off would otherwise go stale
+ * when a name is created or removed, and be returned once caching is
+ * turned back on.  Negative entries also hold a reference to the
+ * directory.
+ */
+#define FSLCL_HASH_DELETE(table, string, keyHandle) \
+    if ((table) != (FslclHashTable *)NIL) { \
 	FslclHashDelete(table, string, (Fs_HandleHeader *)keyHandle); \
     }
 
+#define FSLCL_HASH_PURGE(table, keyHandle) \
+    if ((table) != (FslclHashTable *)NIL) { \
+	FslclHashPurge(table, (Fs_HandleHeader *)keyHandle); \
+    }
+
 #endif /* _FSLCLNAMEHASH */
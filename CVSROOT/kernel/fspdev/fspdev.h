@@ -117,6 +117,56 @@ typedef struct Fspdev_CircBuffer {
     int size;			/* Number of bytes in the circular buffer */
 } Fspdev_CircBuffer;
 
+/*
+ * A server can instead declare a pair of rings with IOC_PDEV_SET_RING.
+ * These belong with the rest of the protocol in <dev/pdev.h>.  The ring
+ * area starts with a Pdev_RingHdr, followed by requestRingSize bytes of
+ * request ring and then numReplies Pdev_Reply slots.  Each counter in the
+ * header only increases and is written by one side: the kernel puts
+ * requests and takes replies, the server takes requests and puts replies.
+ * A request may wrap around the end of the request ring.  The server is
+ * only woken when the request ring goes from empty to non-empty.  Its
+ * replies are taken when it makes IOC_PDEV_RING_REPLY, or the next time
+ * it reads or selects its stream, so it can answer many requests and
+ * then wait once.  Reading the stream returns the request tail.
+ */
+#ifndef IOC_PDEV_SET_RING
+#define IOC_PDEV_RING		(23 << 16)
+#define IOC_PDEV_SET_RING	(IOC_PDEV_RING | 1)
+#define IOC_PDEV_RING_REPLY	(IOC_PDEV_RING | 2)
+
+#define PDEV_RING_MAGIC		0x7e5a0001
+
+typedef struct Pdev_SetRingArgs {
+    Address	ringAddr;	/* Word aligned ring area in the server */
+    int		requestRingSize;/* Bytes, a power of two */
+    int		numReplies;	/* Number of reply slots */
+} Pdev_SetRingArgs;
+
+typedef struct Pdev_RingHdr {
+    int		magic;		/* PDEV_RING_MAGIC */
+    int		requestHead;	/* Request bytes taken by the server */
+    int		requestTail;	/* Request bytes put by the kernel */
+    int		replyHead;	/* Replies taken by the kernel */
+    int		replyTail;	/* Replies put by the server */
+} Pdev_RingHdr;
+#endif /* IOC_PDEV_SET_RING */
+
+/*
+ * The kernel's view of the rings.  The addresses are in the server's
+ * address space.  requestHead is the last value read from the server.
+ */
+typedef struct Fspdev_Ring {
+    Pdev_RingHdr *hdrAddr;	/* Ring header, NIL if not in ring mode */
+    Address	requests;	/* Start of the request ring */
+    int		requestSize;	/* Size of the request ring */
+    Address	replies;	/* Start of the reply slots */
+    int		numReplies;	/* Number of reply slots */
+    int		requestHead;	/* Request bytes taken by the server */
+    int		requestTail;	/* Request bytes put */
+    int		replyHead;	/* Replies taken */
+} Fspdev_Ring;
+
 /*
  * Fspdev_ServerIOHandle has the main state for a client-server connection.
  * The client's handle is a stub which just has a pointer to this handle.
@@ -135,6 +185,8 @@ typedef struct Fspdev_ServerIOHandle {
 				 * the server's address space to use.  We let
 				 * the server change buffers in mid-flight. */
     int nextRequestBufSize;	/* Size of the new request buffer */
+    Fspdev_Ring ring;		/* Rings used instead of the request buffer
+				 * when PDEV_RING is set. */
     Fspdev_CircBuffer readBuf;		/* This buffer contains read-ahead data for
 				 * the pseudo-device.  The server process puts
 				 * data here and the kernel removes it to
@@ -22,6 +22,11 @@
  *	stream.  In this case a client's read will be satisfied from the
  *	buffer and the server won't be contacted.
  *
+ *	Instead of the request buffer a server can declare a request ring
+ *	and a reply ring in its address space (see fspdev.h).  Then it
+ *	takes requests and puts replies without system calls, and it is
+ *	only woken when the request ring goes from empty to non-empty.
+ *
  * Copyright 1987, 1988 Regents of the University of California
  * Permission to use, copy, modify, and distribute this
  * software and its documentation for any purpose and without
@@ -86,6 +91,8 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
  *	PDEV_NAMING		Set on the naming request-response channel.
  *	PDEV_REQUEST_ABORTED	Set when the client aborts during a request-
  *				response transaction so we ignore the next rply.
+ *	PDEV_RING		The server uses the request and reply rings
+ *				instead of the request buffer.
  *	FS_USER_IN/OUT		These flags are borrowed from the stream flags
  *				and indicate which buffers are in user space
  */
@@ -101,6 +108,7 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #define PDEV_NO_BIG_WRITES	0x0200
 #define PDEV_NAMING		0x0400
 #define PDEV_REQUEST_ABORTED	0x0800
+#define PDEV_RING		0x1000
 /*resrv FS_USER_IN		0x8000 */
 /*resrv FS_USER_OUT	      0x800000 */
 
@@ -115,6 +123,15 @@ static ReturnStatus RequestResponse _ARGS_((
 	Fs_IOReply *ioReplyPtr, Sync_RemoteWaiter *waitPtr));
 static void PdevClientWakeup _ARGS_((Fspdev_ServerIOHandle *pdevHandlePtr));
 static void PdevClientNotify _ARGS_((Fspdev_ServerIOHandle *pdevHandlePtr));
+static ReturnStatus PdevReply _ARGS_((Fspdev_ServerIOHandle *pdevHandlePtr,
+	int command, Pdev_Reply *srvReplyPtr, int inBufSize));
+static ReturnStatus PdevRingPut _ARGS_((Fspdev_ServerIOHandle *pdevHandlePtr,
+	int hdrSize, Pdev_RequestHdr *requestHdrPtr, int inputSize,
+	Address inputBuf));
+static ReturnStatus PdevRingCopy _ARGS_((Proc_ControlBlock *serverProcPtr,
+	Fspdev_Ring *ringPtr, int offset, int numBytes, Address buffer,
+	Boolean fromKernel));
+static int PdevRingPoll _ARGS_((Fspdev_ServerIOHandle *pdevHandlePtr));
 
 /*
  *----------------------------------------------------------------------
@@ -224,6 +241,32 @@ RequestResponse(pdevHandlePtr, hdrSize, requestHdrPtr, inputSize, inputBuf,
     PDEV_REQUEST_PRINT(&pdevHandlePtr->hdr.fileID, requestHdrPtr);
     PDEV_REQUEST(&pdevHandlePtr->hdr.fileID, requestHdrPtr);
 
+    pdevHandlePtr->operation = requestHdrPtr->operation;
+    if (pdevHandlePtr->operation == PFS_OPEN) {
+	/*
+	 * We have to snarf up the hostID of the client doing the open
+	 * so the new pseudo-device connection that may be set up as
+	 * a side effect of PFS_OPEN is set up right.  The useFlags are
+	 * needed to initialize the new client stream right.
+	 */
+	register Pfs_Request *pfsRequestPtr = (Pfs_Request *)requestHdrPtr;
+	pdevHandlePtr->open.clientID = pfsRequestPtr->param.open.clientID;
+	pdevHandlePtr->open.useFlags = pfsRequestPtr->param.open.useFlags;
+	pdevHandlePtr->open.name = (char *)inputBuf;
+    }
+
+    if (pdevHandlePtr->flags & PDEV_RING) {
+	/*
+	 * The request ring takes care of copying and of waking the server.
+	 */
+	status = PdevRingPut(pdevHandlePtr, hdrSize, requestHdrPtr,
+			inputSize, inputBuf);
+	if (status != SUCCESS) {
+	    goto failure;
+	}
+	goto waitForReply;
+    }
+
     /*
      * PUT THE REQUEST INTO THE REQUEST BUFFER.
      * We assume that our caller will not give us a request that can't all
@@ -277,19 +320,6 @@ RequestResponse(pdevHandlePtr, hdrSize, requestHdrPtr, inputSize, inputBuf,
     }
     pdevHandlePtr->requestBuf.lastByte = lastByte;
     DBG_PRINT( (" first %d last %d\n", firstByte, lastByte) );
-    pdevHandlePtr->operation = requestHdrPtr->operation;
-    if (pdevHandlePtr->operation == PFS_OPEN) {
-	/*
-	 * We have to snarf up the hostID of the client doing the open
-	 * so the new pseudo-device connection that may be set up as
-	 * a side effect of PFS_OPEN is set up right.  The useFlags are
-	 * needed to initialize the new client stream right.
-	 */
-	register Pfs_Request *pfsRequestPtr = (Pfs_Request *)requestHdrPtr;
-	pdevHandlePtr->open.clientID = pfsRequestPtr->param.open.clientID;
-	pdevHandlePtr->open.useFlags = pfsRequestPtr->param.open.useFlags;
-	pdevHandlePtr->open.name = (char *)inputBuf;
-    }
 
     /*
      * COPY REQUEST AND DATA.
@@ -337,6 +367,7 @@ RequestResponse(pdevHandlePtr, hdrSize, requestHdrPtr, inputSize, inputBuf,
      */
     Fsutil_FastWaitListNotify(&pdevHandlePtr->srvReadWaitList);
 
+waitForReply:
     if (pdevHandlePtr->operation != PDEV_WRITE_ASYNC) {
 	/*
 	 * WAIT FOR A REPLY.
@@ -386,6 +417,210 @@ failure:
     return(status);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * PdevRingPut --
+ *
+ *	Put a request on the server's request ring.  If there isn't room
+ *	we wait for the server to take some requests.  The server is
+ *	only woken up if the ring was empty.
+ *
+ * Results:
+ *	SUCCESS, DEV_OFFLINE if the server is gone, GEN_INVALID_ARG if
+ *	the server has garbled the ring header, or an error from the
+ *	copy or wait.
+ *
+ * Side effects:
+ *	The request and its data are copied into the server's address
+ *	space, and then the request tail is advanced.
+ *
+ *----------------------------------------------------------------------
+ */
+INTERNAL static ReturnStatus
+PdevRingPut(pdevHandlePtr, hdrSize, requestHdrPtr, inputSize, inputBuf)
+    register Fspdev_ServerIOHandle *pdevHandlePtr;	/* Locked by caller */
+    int			hdrSize;	/* Size of the request header */
+    Pdev_RequestHdr	*requestHdrPtr;	/* Formatted request header */
+    int			inputSize;	/* Size of input buffer. */
+    Address		inputBuf;	/* Inputs of the remote command. */
+{
+    register Fspdev_Ring	*ringPtr = &pdevHandlePtr->ring;
+    Proc_ControlBlock		*serverProcPtr;
+    ReturnStatus		status;
+    int				head;
+    int				tail;
+    Boolean			wasEmpty;
+
+    tail = ringPtr->requestTail;
+    while (TRUE) {
+	serverProcPtr = Proc_LockPID(pdevHandlePtr->serverPID);
+	if (serverProcPtr == (Proc_ControlBlock *)NIL) {
+	    return(DEV_OFFLINE);
+	}
+	status = Vm_CopyInProc(sizeof(int), serverProcPtr,
+			(Address)&ringPtr->hdrAddr->requestHead,
+			(Address)&head, TRUE);
+	if (status != SUCCESS) {
+	    Proc_Unlock(serverProcPtr);
+	    return(status);
+	}
+	if (tail - head < 0 || tail - head > ringPtr->requestSize) {
+	    Proc_Unlock(serverProcPtr);
+	    printf("PdevRingPut: bad request head %d (tail %d) <%s>\n",
+		    head, tail, Fsutil_HandleName(pdevHandlePtr));
+	    return(GEN_INVALID_ARG);
+	}
+	ringPtr->requestHead = head;
+	if (ringPtr->requestSize - (tail - head) >=
+		requestHdrPtr->messageSize) {
+	    break;
+	}
+	/*
+	 * Wait for the server to catch up.  It notifies caughtUp
+	 * each time it waits on its stream.
+	 */
+	Proc_Unlock(serverProcPtr);
+	DBG_PRINT( (" (ring full) ") );
+	if (Sync_Wait(&pdevHandlePtr->caughtUp, TRUE)) {
+	    return(GEN_ABORTED_BY_SIGNAL);
+	} else if (pdevHandlePtr->flags & PDEV_SERVER_GONE) {
+	    return(DEV_OFFLINE);
+	}
+    }
+    wasEmpty = (head == tail);
+    status = PdevRingCopy(serverProcPtr, ringPtr, tail, hdrSize,
+			(Address)requestHdrPtr, TRUE);
+    if (status == SUCCESS && inputSize > 0) {
+	status = PdevRingCopy(serverProcPtr, ringPtr, tail + hdrSize,
+			inputSize, inputBuf,
+			(pdevHandlePtr->flags & FS_USER_IN) == 0);
+    }
+    if (status == SUCCESS) {
+	/*
+	 * The tail is only moved after the whole request is in the
+	 * ring, so the server never sees part of a request.
+	 */
+	tail += requestHdrPtr->messageSize;
+	status = Vm_CopyOutProc(sizeof(int), (Address)&tail, TRUE,
+			serverProcPtr, (Address)&ringPtr->hdrAddr->requestTail);
+    }
+    Proc_Unlock(serverProcPtr);
+    if (status == SUCCESS) {
+	ringPtr->requestTail = tail;
+	if (wasEmpty) {
+	    Fsutil_FastWaitListNotify(&pdevHandlePtr->srvReadWaitList);
+	}
+    }
+    return(status);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PdevRingCopy --
+ *
+ *	Copy into the server's request ring, wrapping around the end.
+ *
+ * Results:
+ *	The status of the copy.
+ *
+ * Side effects:
+ *	The server's request ring is written.
+ *
+ *----------------------------------------------------------------------
+ */
+static ReturnStatus
+PdevRingCopy(serverProcPtr, ringPtr, offset, numBytes, buffer, fromKernel)
+    Proc_ControlBlock	*serverProcPtr;	/* Locked server process */
+    register Fspdev_Ring *ringPtr;	/* Server's rings */
+    int			offset;		/* Unwrapped ring offset */
+    int			numBytes;	/* Amount to copy */
+    Address		buffer;		/* Data to copy */
+    Boolean		fromKernel;	/* TRUE if buffer is in the kernel */
+{
+    ReturnStatus	status;
+    int			start;
+    int			toEnd;
+
+    start = offset & (ringPtr->requestSize - 1);
+    toEnd = ringPtr->requestSize - start;
+    if (numBytes <= toEnd) {
+	return(Vm_CopyOutProc(numBytes, buffer, fromKernel, serverProcPtr,
+			ringPtr->requests + start));
+    }
+    status = Vm_CopyOutProc(toEnd, buffer, fromKernel, serverProcPtr,
+			ringPtr->requests + start);
+    if (status == SUCCESS) {
+	status = Vm_CopyOutProc(numBytes - toEnd, buffer + toEnd,
+			fromKernel, serverProcPtr, ringPtr->requests);
+    }
+    return(status);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PdevRingPoll --
+ *
+ *	Called when the server waits on its stream, or rings the doorbell
+ *	with IOC_PDEV_RING_REPLY.  This refreshes the request head and
+ *	handles every reply the server has put on the reply ring.  Only
+ *	the server process can do this, as the replies are in its
+ *	address space.
+ *
+ * Results:
+ *	The number of request bytes the server hasn't taken yet.
+ *
+ * Side effects:
+ *	Replies are passed to PdevReply, the reply head is advanced, and
+ *	clients waiting for room in the request ring are notified.
+ *
+ *----------------------------------------------------------------------
+ */
+INTERNAL static int
+PdevRingPoll(pdevHandlePtr)
+    register Fspdev_ServerIOHandle *pdevHandlePtr;	/* Locked by caller */
+{
+    register Fspdev_Ring	*ringPtr = &pdevHandlePtr->ring;
+    Pdev_Reply			reply;
+    ReturnStatus		status;
+    int				head;
+    int				tail;
+
+    if (Proc_GetEffectiveProc()->processID != pdevHandlePtr->serverPID) {
+	return(ringPtr->requestTail - ringPtr->requestHead);
+    }
+    if (Vm_CopyIn(sizeof(int), (Address)&ringPtr->hdrAddr->requestHead,
+		(Address)&head) == SUCCESS &&
+	ringPtr->requestTail - head >= 0 &&
+	ringPtr->requestTail - head <= ringPtr->requestSize) {
+	ringPtr->requestHead = head;
+    }
+    if (Vm_CopyIn(sizeof(int), (Address)&ringPtr->hdrAddr->replyTail,
+		(Address)&tail) == SUCCESS) {
+	if (tail - ringPtr->replyHead < 0 ||
+	    tail - ringPtr->replyHead > ringPtr->numReplies) {
+	    printf("PdevRingPoll: bad reply tail %d (head %d) <%s>\n",
+		    tail, ringPtr->replyHead,
+		    Fsutil_HandleName(pdevHandlePtr));
+	    tail = ringPtr->replyHead;
+	}
+	while (ringPtr->replyHead != tail) {
+	    status = Vm_CopyIn(sizeof(Pdev_Reply), ringPtr->replies +
+		    (ringPtr->replyHead % ringPtr->numReplies) *
+		    sizeof(Pdev_Reply), (Address)&reply);
+	    ringPtr->replyHead++;
+	    (void)PdevReply(pdevHandlePtr, IOC_PDEV_REPLY, &reply,
+		    (status == SUCCESS) ? sizeof(Pdev_Reply) : 0);
+	}
+	(void)Vm_CopyOut(sizeof(int), (Address)&ringPtr->replyHead,
+		(Address)&ringPtr->hdrAddr->replyHead);
+    }
+    Sync_Broadcast(&pdevHandlePtr->caughtUp);
+    return(ringPtr->requestTail - ringPtr->requestHead);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -455,6 +690,15 @@ FspdevServerStreamCreate(ioFileIDPtr, name, naming)
 
     pdevHandlePtr->nextRequestBuffer = (Address)NIL;
 
+    pdevHandlePtr->ring.hdrAddr = (Pdev_RingHdr *)NIL;
+    pdevHandlePtr->ring.requests = (Address)NIL;
+    pdevHandlePtr->ring.requestSize = 0;
+    pdevHandlePtr->ring.replies = (Address)NIL;
+    pdevHandlePtr->ring.numReplies = 0;
+    pdevHandlePtr->ring.requestHead = 0;
+    pdevHandlePtr->ring.requestTail = 0;
+    pdevHandlePtr->ring.replyHead = 0;
+
     pdevHandlePtr->readBuf.data = (Address)NIL;
     pdevHandlePtr->readBuf.firstByte = -1;
     pdevHandlePtr->readBuf.lastByte = -1;
@@ -520,7 +764,19 @@ FspdevServerStreamSelect(hdrPtr, waitPtr, readPtr, writePtr, exceptPtr)
     register Fspdev_ServerIOHandle	*pdevHandlePtr = (Fspdev_ServerIOHandle *)hdrPtr;
 
     LOCK_MONITOR;
-    if (*readPtr) {
+    if (pdevHandlePtr->flags & PDEV_RING) {
+	/*
+	 * Readable if there are requests on the ring.  Polling also
+	 * takes any replies the server has put on the reply ring.
+	 */
+	if (PdevRingPoll(pdevHandlePtr) == 0 && *readPtr) {
+	    *readPtr = 0;
+	    if (waitPtr != (Sync_RemoteWaiter *)NIL) {
+		Fsutil_FastWaitListInsert(&pdevHandlePtr->srvReadWaitList,
+			waitPtr);
+	    }
+	}
+    } else if (*readPtr) {
 	if (((pdevHandlePtr->flags & PDEV_READ_PTRS_CHANGED) == 0) &&
 	     ((pdevHandlePtr->requestBuf.firstByte == -1) ||
 	      (pdevHandlePtr->requestBuf.firstByte >=
@@ -545,6 +801,8 @@ FspdevServerStreamSelect(hdrPtr, waitPtr, readPtr, writePtr, exceptPtr)
  *	When the server reads on a server stream it is looking for a
  *	message containing pointers into the request buffer that's
  *	in its address spapce.  This routine returns those values.
+ *	In ring mode the server reads only to wait for requests, and
+ *	it is given the request tail.
  *
  * Results:
  *	SUCCESS unless all clients have gone away.
@@ -570,6 +828,23 @@ FspdevServerStreamRead(streamPtr, readPtr, waitPtr, replyPtr)
     register int reqFirstByte, reqLastByte;
 
     LOCK_MONITOR;
+    if (pdevHandlePtr->flags & PDEV_RING) {
+	if (PdevRingPoll(pdevHandlePtr) == 0) {
+	    status = FS_WOULD_BLOCK;
+	    replyPtr->length = 0;
+	    Fsutil_FastWaitListInsert(&pdevHandlePtr->srvReadWaitList, waitPtr);
+	} else if (readPtr->length < sizeof(int)) {
+	    status = GEN_INVALID_ARG;
+	    replyPtr->length = 0;
+	} else {
+	    status = Vm_CopyOut(sizeof(int),
+			(Address)&pdevHandlePtr->ring.requestTail,
+			readPtr->buffer);
+	    replyPtr->length = sizeof(int);
+	}
+	UNLOCK_MONITOR;
+	return(status);
+    }
     /*
      * The server stream is readable only if there are requests in the
      * request buffer or if the read ahead buffers have changed since
@@ -638,6 +913,139 @@ FspdevServerStreamRead(streamPtr, readPtr, waitPtr, replyPtr)
     return(status);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * PdevReply --
+ *
+ *	Handle the server's reply to a request, given with IOC_PDEV_REPLY
+ *	or IOC_PDEV_SMALL_REPLY or taken from the reply ring.
+ *
+ * Results:
+ *	SUCCESS, or an error from copying the reply data.
+ *
+ * Side effects:
+ *	Copy the reply from the server to the client.
+ *	Put the client on wait lists, if appropriate.
+ *	Notify the replyReady condition, and lastly
+ *	notify waiting clients about new select state.
+ *
+ *----------------------------------------------------------------------
+ */
+INTERNAL static ReturnStatus
+PdevReply(pdevHandlePtr, command, srvReplyPtr, inBufSize)
+    register Fspdev_ServerIOHandle *pdevHandlePtr;	/* Locked by caller */
+    int		command;		/* Which reply I/O control */
+    register Pdev_Reply *srvReplyPtr;	/* The reply, in the kernel */
+    int		inBufSize;		/* Reply plus small data */
+{
+    ReturnStatus status = SUCCESS;
+
+    if (inBufSize < sizeof(Pdev_Reply)) {
+	/*
+	 * inBuffer must be at least as big as Pdev_Reply.
+	 * It will be larger during PDEV_SMALL_REPLY which
+	 * includes a small amount of embedded data.
+	 */
+	status = FS_INVALID_ARG;
+	pdevHandlePtr->flags |= PDEV_REPLY_READY|PDEV_REPLY_FAILED;
+    } else if (pdevHandlePtr->flags & PDEV_REQUEST_ABORTED) {
+	/*
+	 * Client aborted the request from its end.
+	 * Do nothing but grab the select bits.
+	 */
+	pdevHandlePtr->flags &= ~PDEV_REQUEST_ABORTED;
+	pdevHandlePtr->selectBits = srvReplyPtr->selectBits;
+    } else {
+	/*
+	 * Copy current reply in to pdev state.
+	 */
+	pdevHandlePtr->reply = *srvReplyPtr;
+	if (srvReplyPtr->replySize > 0) {
+	    register Proc_ControlBlock *clientProcPtr;
+	    if (pdevHandlePtr->replyBuf == (char *)NIL) {
+		printf("PdevReply: unwanted reply data <%s>\n",
+		    Fsutil_HandleName(pdevHandlePtr));
+		goto noReplyData;
+	    }
+	    if (srvReplyPtr->replySize > pdevHandlePtr->replySize) {
+		printf("PdevReply: extra reply data (%d > %d) <%s>\n",
+		    srvReplyPtr->replySize, pdevHandlePtr->replySize,
+		    Fsutil_HandleName(pdevHandlePtr));
+		srvReplyPtr->replySize = pdevHandlePtr->replySize;
+	    }
+	    /*
+	     * Copy the reply into the waiting buffers.
+	     */
+	    if ((command == IOC_PDEV_SMALL_REPLY) &&
+		((srvReplyPtr->replySize > PDEV_SMALL_DATA_LIMIT) ||
+		 (inBufSize < sizeof(Pdev_Reply) + srvReplyPtr->replySize))){
+		status = GEN_INVALID_ARG;
+	    } else {
+		if ((pdevHandlePtr->flags & FS_USER_OUT) == 0) {
+		    /*
+		     * Reply buffer in the kernel.
+		     */
+		    if (command == IOC_PDEV_SMALL_REPLY) {
+			bcopy(((Pdev_ReplyData *)srvReplyPtr)->data,
+				pdevHandlePtr->replyBuf,
+				srvReplyPtr->replySize);
+		    } else {
+			status = Vm_CopyIn(srvReplyPtr->replySize,
+					   srvReplyPtr->replyBuf,
+					   pdevHandlePtr->replyBuf);
+		    }
+		} else {
+		    clientProcPtr = Proc_LockPID(pdevHandlePtr->clientPID);
+		    /*
+		     * Reply buffer in the client's address space.
+		     * Do a cross-address-space copy.
+		     */
+		    if (clientProcPtr == (Proc_ControlBlock *)NIL) {
+			status = FS_BROKEN_PIPE;
+		    } else {
+			if (command == IOC_PDEV_SMALL_REPLY) {
+			    status =
+				Vm_CopyOutProc(srvReplyPtr->replySize,
+				((Pdev_ReplyData *)srvReplyPtr)->data,
+				TRUE, clientProcPtr,
+				pdevHandlePtr->replyBuf);
+			} else {
+			    status =
+				Vm_CopyOutProc(srvReplyPtr->replySize,
+				srvReplyPtr->replyBuf, FALSE,
+				clientProcPtr, pdevHandlePtr->replyBuf);
+			}
+			Proc_Unlock(clientProcPtr);
+		    }
+		}
+	    }
+	    if (status != SUCCESS) {
+		pdevHandlePtr->flags |= PDEV_REPLY_FAILED;
+	    }
+	}
+noReplyData:
+	PDEV_REPLY(&pdevHandlePtr->hdr.fileID, srvReplyPtr);
+	if (srvReplyPtr->status == FS_WOULD_BLOCK) {
+	    /*
+	     * Put the client process on the appropriate wait list.
+	     */
+	    if (pdevHandlePtr->operation == PDEV_READ) {
+		Fsutil_FastWaitListInsert(&pdevHandlePtr->cltReadWaitList,
+				     &pdevHandlePtr->clientWait);
+	    } else if (pdevHandlePtr->operation == PDEV_WRITE) {
+		Fsutil_FastWaitListInsert(&pdevHandlePtr->cltWriteWaitList,
+				     &pdevHandlePtr->clientWait);
+	    }
+	}
+	pdevHandlePtr->flags |= PDEV_REPLY_READY;
+	pdevHandlePtr->selectBits = srvReplyPtr->selectBits;
+    }
+    Sync_Broadcast(&pdevHandlePtr->replyReady);
+    PdevClientNotify(pdevHandlePtr);
+    return(status);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -695,7 +1103,8 @@ FspdevServerStreamIOControl(streamPtr, ioctlPtr, replyPtr)
 		    (Pdev_SetBufArgs *)ioctlPtr->inBuffer;
 	    register int extraBytes;
 
-	    if (ioctlPtr->inBufSize != sizeof(Pdev_SetBufArgs)) {
+	    if (ioctlPtr->inBufSize != sizeof(Pdev_SetBufArgs) ||
+		(pdevHandlePtr->flags & PDEV_RING)) {
 		status = GEN_INVALID_ARG;
 	    } else if ((pdevHandlePtr->flags & PDEV_SETUP) == 0) {
 		/*
@@ -754,6 +1163,70 @@ FspdevServerStreamIOControl(streamPtr, ioctlPtr, replyPtr)
 	    }
 	    break;
 	}
+	case IOC_PDEV_SET_RING: {
+	    /*
+	     * The server is declaring request and reply rings instead
+	     * of a request buffer.  This has to be done first, and there
+	     * is no read ahead buffer in ring mode.
+	     *
+	     * Side effects:
+	     *		Initialize the ring header in the server's address
+	     *		space and let the client's open transaction begin.
+	     */
+	    register Pdev_SetRingArgs *argPtr =
+		    (Pdev_SetRingArgs *)ioctlPtr->inBuffer;
+	    register Fspdev_Ring *ringPtr = &pdevHandlePtr->ring;
+	    Pdev_RingHdr ringHdr;
+
+	    if (ioctlPtr->inBufSize != sizeof(Pdev_SetRingArgs) ||
+		(pdevHandlePtr->flags & PDEV_SETUP) ||
+		((unsigned int)argPtr->ringAddr & (sizeof(int) - 1)) ||
+		argPtr->requestRingSize < 2 * sizeof(Pdev_Request) ||
+		(argPtr->requestRingSize & (argPtr->requestRingSize - 1)) ||
+		argPtr->numReplies <= 0) {
+		status = GEN_INVALID_ARG;
+		break;
+	    }
+	    bzero((Address)&ringHdr, sizeof(ringHdr));
+	    ringHdr.magic = PDEV_RING_MAGIC;
+	    status = Vm_CopyOut(sizeof(ringHdr), (Address)&ringHdr,
+				argPtr->ringAddr);
+	    if (status != SUCCESS) {
+		break;
+	    }
+	    ringPtr->hdrAddr = (Pdev_RingHdr *)argPtr->ringAddr;
+	    ringPtr->requests = argPtr->ringAddr + sizeof(Pdev_RingHdr);
+	    ringPtr->requestSize = argPtr->requestRingSize;
+	    ringPtr->replies = ringPtr->requests + argPtr->requestRingSize;
+	    ringPtr->numReplies = argPtr->numReplies;
+	    ringPtr->requestHead = 0;
+	    ringPtr->requestTail = 0;
+	    ringPtr->replyHead = 0;
+	    /*
+	     * The request buffer size is still used to limit the size
+	     * of requests.
+	     */
+	    pdevHandlePtr->requestBuf.data = ringPtr->requests;
+	    pdevHandlePtr->requestBuf.size = ringPtr->requestSize;
+
+	    pdevHandlePtr->serverPID = ioctlPtr->procID;
+	    pdevHandlePtr->flags &= ~PDEV_BUSY;
+	    pdevHandlePtr->flags |= PDEV_SETUP|PDEV_RING|PDEV_READ_BUF_EMPTY|
+					     PDEV_SERVER_KNOWS_IT;
+	    Sync_Broadcast(&pdevHandlePtr->access);
+	    break;
+	}
+	case IOC_PDEV_RING_REPLY:
+	    /*
+	     * The server has put replies on the reply ring and wants
+	     * them handled now, instead of the next time it waits.
+	     */
+	    if ((pdevHandlePtr->flags & PDEV_RING) == 0) {
+		status = GEN_INVALID_ARG;
+	    } else {
+		(void)PdevRingPoll(pdevHandlePtr);
+	    }
+	    break;
 	case IOC_PDEV_WRITE_BEHIND: {
 	    /*
 	     * Side effects:
@@ -885,119 +1358,10 @@ FspdevServerStreamIOControl(streamPtr, ioctlPtr, replyPtr)
 	case IOC_PDEV_SMALL_REPLY:
 	case IOC_PDEV_REPLY: {
 	    /*
-	     * The server is replying to a request.
-	     *
-	     * Side effects:
-	     *		Copy the reply from the server to the client.
-	     *		Put the client on wait lists, if appropriate.
-	     *		Notify the replyReady condition, and lastly
-	     *		notify waiting clients about new select state.
+	     * The server is replying to a request.  See PdevReply.
 	     */
-	    register Pdev_Reply *srvReplyPtr = (Pdev_Reply *)ioctlPtr->inBuffer;
-
-	    if (ioctlPtr->inBufSize < sizeof(Pdev_Reply)) {
-		/*
-		 * inBuffer must be at least as big as Pdev_Reply.
-		 * It will be larger during PDEV_SMALL_REPLY which
-		 * includes a small amount of embedded data.
-		 */
-		status = FS_INVALID_ARG;
-		pdevHandlePtr->flags |= PDEV_REPLY_READY|PDEV_REPLY_FAILED;
-	    } else if (pdevHandlePtr->flags & PDEV_REQUEST_ABORTED) {
-		/*
-		 * Client aborted the request from its end.
-		 * Do nothing but grab the select bits.
-		 */
-		pdevHandlePtr->flags &= ~PDEV_REQUEST_ABORTED;
-		pdevHandlePtr->selectBits = srvReplyPtr->selectBits;
-	    } else {
-		/*
-		 * Copy current reply in to pdev state.
-		 */
-		pdevHandlePtr->reply = *srvReplyPtr;
-		if (srvReplyPtr->replySize > 0) {
-		    register Proc_ControlBlock *clientProcPtr;
-		    if (pdevHandlePtr->replyBuf == (char *)NIL) {
-			printf("PdevReply: unwanted reply data <%s>\n",
-			    Fsutil_HandleName(pdevHandlePtr));
-			goto noReplyData;
-		    }
-		    if (srvReplyPtr->replySize > pdevHandlePtr->replySize) {
-			printf("PdevReply: extra reply data (%d > %d) <%s>\n",
-			    srvReplyPtr->replySize, pdevHandlePtr->replySize,
-			    Fsutil_HandleName(pdevHandlePtr));
-			srvReplyPtr->replySize = pdevHandlePtr->replySize;
-		    }
-		    /*
-		     * Copy the reply into the waiting buffers.
-		     */
-		    if ((ioctlPtr->command == IOC_PDEV_SMALL_REPLY) &&
-			((srvReplyPtr->replySize > PDEV_SMALL_DATA_LIMIT) ||
-			 (ioctlPtr->inBufSize <
-				 sizeof(Pdev_Reply) + srvReplyPtr->replySize))){
-			status = GEN_INVALID_ARG;
-		    } else {
-			if ((pdevHandlePtr->flags & FS_USER_OUT) == 0) {
-			    /*
-			     * Reply buffer in the kernel.
-			     */
-			    if (ioctlPtr->command == IOC_PDEV_SMALL_REPLY) {
-				bcopy(((Pdev_ReplyData *)srvReplyPtr)->data,
-					pdevHandlePtr->replyBuf,
-					srvReplyPtr->replySize);
-			    } else {
-				status = Vm_CopyIn(srvReplyPtr->replySize,
-						   srvReplyPtr->replyBuf,
-						   pdevHandlePtr->replyBuf);
-			    }
-			} else {
-			    clientProcPtr = Proc_LockPID(pdevHandlePtr->clientPID);
-			    /*
-			     * Reply buffer in the client's address space.
-			     * Do a cross-address-space copy.
-			     */
-			    if (clientProcPtr == (Proc_ControlBlock *)NIL) {
-				status = FS_BROKEN_PIPE;
-			    } else {
-				if (ioctlPtr->command == IOC_PDEV_SMALL_REPLY) {
-				    status =
-					Vm_CopyOutProc(srvReplyPtr->replySize,
-					((Pdev_ReplyData *)srvReplyPtr)->data,
-					TRUE, clientProcPtr,
-					pdevHandlePtr->replyBuf);
-				} else {
-				    status =
-					Vm_CopyOutProc(srvReplyPtr->replySize,
-					srvReplyPtr->replyBuf, FALSE,
-					clientProcPtr, pdevHandlePtr->replyBuf);
-				}
-				Proc_Unlock(clientProcPtr);
-			    }
-			}
-		    }
-		    if (status != SUCCESS) {
-			pdevHandlePtr->flags |= PDEV_REPLY_FAILED;
-		    }
-		}
-noReplyData:
-		PDEV_REPLY(&pdevHandlePtr->hdr.fileID, srvReplyPtr);
-		if (srvReplyPtr->status == FS_WOULD_BLOCK) {
-		    /*
-		     * Put the client process on the appropriate wait list.
-		     */
-		    if (pdevHandlePtr->operation == PDEV_READ) {
-			Fsutil_FastWaitListInsert(&pdevHandlePtr->cltReadWaitList,
-					     &pdevHandlePtr->clientWait);
-		    } else if (pdevHandlePtr->operation == PDEV_WRITE) {
-			Fsutil_FastWaitListInsert(&pdevHandlePtr->cltWriteWaitList,
-					     &pdevHandlePtr->clientWait);
-		    }
-		}
-		pdevHandlePtr->flags |= PDEV_REPLY_READY;
-		pdevHandlePtr->selectBits = srvReplyPtr->selectBits;
-	    }
-	    Sync_Broadcast(&pdevHandlePtr->replyReady);
-	    PdevClientNotify(pdevHandlePtr);
+	    status = PdevReply(pdevHandlePtr, ioctlPtr->command,
+		    (Pdev_Reply *)ioctlPtr->inBuffer, ioctlPtr->inBufSize);
 	    break;
 	}
 	case IOC_PDEV_READY:
@@ -1188,7 +1552,10 @@ noReplyData:
 
 	    reqFirstByte = pdevHandlePtr->requestBuf.firstByte;
 	    reqLastByte = pdevHandlePtr->requestBuf.lastByte;
-	    if (((pdevHandlePtr->flags & PDEV_READ_PTRS_CHANGED) == 0) &&
+	    if (pdevHandlePtr->flags & PDEV_RING) {
+		numReadable = (PdevRingPoll(pdevHandlePtr) > 0) ?
+				sizeof(int) : 0;
+	    } else if (((pdevHandlePtr->flags & PDEV_READ_PTRS_CHANGED) == 0) &&
 		((reqFirstByte == -1) || (reqFirstByte > reqLastByte))) {
 		numReadable = 0;
 	    } else {
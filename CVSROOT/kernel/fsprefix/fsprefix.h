@@ -29,12 +29,11 @@
 #include <fsNameOps.h>
 
 /*
- * Fsprefix defines an entry in the prefix table.  Now it is just a linked
- * list of items with the prefix as the key and the client's token as the
- * data.  This structure requires an O(number of entries in the table)
- * search each time a complete path name is opened.  A trie structure
- * would be better because the time for the search would then be
- * 0(length of valid prefix).
+ * Fsprefix defines an entry in the prefix table.  The entries are kept
+ * on a linked list with the prefix as the key and the client's token as
+ * the data.  The list is also indexed by a trie of pathname components
+ * (see fsprefixInt.h) so that the search done each time a complete path
+ * name is opened takes O(length of valid prefix) time.
  */
 typedef struct Fsprefix {
     List_Links	links;		/* The prefix table is kept in a list */
@@ -34,6 +34,23 @@ typedef struct FsprefixExport {
     int		spriteID;
 } FsprefixExport;
 
+/*
+ * The prefix table is indexed by a trie with one node per pathname
+ * component, so finding the longest prefix of a name takes time
+ * proportional to the length of the name and not the size of the table.
+ * The root node stands for "/".  Nodes are only ever added, and a node
+ * is filled in completely before it is linked in, so Fsprefix_Lookup can
+ * walk the trie without the monitor lock.
+ */
+typedef struct FsprefixNode {
+    struct FsprefixNode	*childPtr;	/* Node for the next component */
+    struct FsprefixNode	*nextPtr;	/* Next node with same parent */
+    Fsprefix		*prefixPtr;	/* Entry whose prefix ends at this
+					 * node, or NIL */
+    int			length;		/* Length of the component */
+    char		*name;		/* The component, not null terminated */
+} FsprefixNode;
+
 /* procedures */
 
 extern void FsprefixDone _ARGS_((Fsprefix *prefixPtr));
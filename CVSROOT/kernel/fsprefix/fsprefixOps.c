@@ -51,6 +51,28 @@ static List_Links *prefixList = &prefixListHeader;
 static Sync_Lock prefixLock = Sync_LockInitStatic("Fs:prefixLock");
 #define LOCKPTR (&prefixLock)
 
+/*
+ * The root of the trie that indexes the prefix table.  It stands for "/".
+ */
+static FsprefixNode prefixRootNode;
+static FsprefixNode *prefixRoot = &prefixRootNode;
+
+/*
+ * Fsprefix_Lookup searches the table without the monitor lock so that
+ * lookups don't wait on each other or on changes to the table.  Code
+ * that changes an entry field used by the search brackets the change,
+ * under the monitor lock, with PREFIX_CHANGE_BEGIN and PREFIX_CHANGE_END.
+ * prefixGeneration is odd while a change is in progress, and a search
+ * that sees it odd, or sees it move, is repeated.  Freed entries stay
+ * mapped, so a search racing with a delete at worst reads garbage that
+ * it then throws away.  After PREFIX_MAX_TRIES attempts the search is
+ * done under the lock.
+ */
+static volatile unsigned int prefixGeneration = 0;
+#define PREFIX_CHANGE_BEGIN()	(prefixGeneration++)
+#define PREFIX_CHANGE_END()	(prefixGeneration++)
+#define PREFIX_MAX_TRIES	4
+
 /*
  * Forward references.
  */
@@ -59,6 +81,16 @@ static Fsprefix *PrefixInsert _ARGS_((char *prefix, int serverID,
 		Fs_HandleHeader *hdrPtr, int domainType, int flags));
 static void PrefixUpdate _ARGS_((Fsprefix *prefixPtr, int serverID, 
 		Fs_HandleHeader *hdrPtr, int domainType, int flags));
+static FsprefixNode *PrefixNode _ARGS_((char *prefix, Boolean create));
+static Fsprefix *PrefixFind _ARGS_((char *prefix));
+static ReturnStatus PrefixSearch _ARGS_((char *fileName, int flags,
+		int clientID, Boolean locked, Fs_HandleHeader **hdrPtrPtr,
+		char **lookupNamePtr, int *serverIDPtr, int *domainTypePtr,
+		Fsprefix **prefixPtrPtr));
+static ReturnStatus PrefixSearchLocked _ARGS_((char *fileName, int flags,
+		int clientID, Fs_HandleHeader **hdrPtrPtr, Fs_FileID *rootIDPtr,
+		char **lookupNamePtr, int *serverIDPtr, int *domainTypePtr,
+		Fsprefix **prefixPtrPtr));
 static ReturnStatus LocatePrefix _ARGS_((char *fileName, int serverID, 
 		int *domainTypePtr, Fs_HandleHeader **hdrPtrPtr));
 static ReturnStatus GetPrefix _ARGS_((char *fileName, Boolean follow, 
@@ -687,7 +719,7 @@ NameOp(lookupOperation)
  *	None.
  *
  * Side effects:
- *	Set up the list links.
+ *	Set up the list links and the root of the trie.
  *
  *----------------------------------------------------------------------
  */
@@ -695,6 +727,11 @@ void
 Fsprefix_Init()
 {
     List_Init(prefixList);
+    prefixRoot->childPtr = (FsprefixNode *)NIL;
+    prefixRoot->nextPtr = (FsprefixNode *)NIL;
+    prefixRoot->prefixPtr = (Fsprefix *)NIL;
+    prefixRoot->length = 0;
+    prefixRoot->name = "";
 }
 
 /*
@@ -723,15 +760,14 @@ Fsprefix_Install(prefix, hdrPtr, domainType, flags)
 
     LOCK_MONITOR;
 
-    LIST_FORALL(prefixList, (List_Links *)prefixPtr) {
-	if (strcmp(prefixPtr->prefix, prefix) == 0) {
-	    /*
-	     * Update information in the table.
-	     */
-	    PrefixUpdate(prefixPtr, FS_NO_SERVER, hdrPtr, domainType, flags);
-	    UNLOCK_MONITOR;
-	    return(prefixPtr);
-	}
+    prefixPtr = PrefixFind(prefix);
+    if (prefixPtr != (Fsprefix *)NIL) {
+	/*
+	 * Update information in the table.
+	 */
+	PrefixUpdate(prefixPtr, FS_NO_SERVER, hdrPtr, domainType, flags);
+	UNLOCK_MONITOR;
+	return(prefixPtr);
     }
     prefixPtr = PrefixInsert(prefix, FS_NO_SERVER, hdrPtr, domainType, flags);
     UNLOCK_MONITOR;
@@ -765,16 +801,15 @@ Fsprefix_Load(prefix, serverID, flags)
 
     LOCK_MONITOR;
 
-    LIST_FORALL(prefixList, (List_Links *)prefixPtr) {
-	if (strcmp(prefixPtr->prefix, prefix) == 0) {
-	    /*
-	     * Update information in the table.
-	     */
-	    PrefixUpdate(prefixPtr, serverID, (Fs_HandleHeader *)NIL, -1, 
-		flags);	
-	    UNLOCK_MONITOR;
-	    return;
-	}
+    prefixPtr = PrefixFind(prefix);
+    if (prefixPtr != (Fsprefix *)NIL) {
+	/*
+	 * Update information in the table.
+	 */
+	PrefixUpdate(prefixPtr, serverID, (Fs_HandleHeader *)NIL, -1, 
+	    flags);	
+	UNLOCK_MONITOR;
+	return;
     }
     /*
      * Add new entry to the table.
@@ -799,7 +834,8 @@ Fsprefix_Load(prefix, serverID, flags)
  *
  * Side effects:
  *	Sets the hdrPtr, etc. of the prefix.  Also resets number of
- *	active opens/delay opens state for the prefix.
+ *	active opens/delay opens state for the prefix.  The entry is
+ *	hung off the prefix trie, which may grow new nodes.
  *
  *----------------------------------------------------------------------
  */
@@ -832,21 +868,27 @@ PrefixInsert(prefix, serverID, hdrPtr, domainType, flags)
     List_Init(&prefixPtr->exportList);
 
     /*
-     * At this point one could think about sorting the prefix table
-     * in some way.  However, for now we just add new prefixes
-     * to the end.  The PrefixLookup look scans the whole list anyway.
-     * Finally, there is a silly dependency on the ordering from
-     * the use of a prefix table entry to block OPENS during recovery.
-     * The first prefix that is controlled by a particular server is
-     * used to synchronize OPENS and REOPENS.  If this stupid
-     * dependency were removed (by using a different data
+     * New prefixes are added to the end of the list.  Lookups go
+     * through the trie, but there is a silly dependency on the list
+     * ordering from the use of a prefix table entry to block OPENS
+     * during recovery.  The first prefix that is controlled by a
+     * particular server is used to synchronize OPENS and REOPENS.
+     * If this stupid dependency were removed (by using a different data
      * structure, please, than the prefix table (I did all this to
-     * myself - my thanks to whoever fixes it)) then the prefix
-     * table could be sorted in order of increasing prefix length
-     * so that the prefix table scan could halt at the first non
-     * matching prefix.
+     * myself - my thanks to whoever fixes it)) the list would be needed
+     * only for iterating over the table.
      */
     List_Insert((List_Links *)prefixPtr, LIST_ATREAR(prefixList));
+
+    /*
+     * The entry is complete before it is put in the trie, so a lookup
+     * that finds it sees valid fields.  Names that don't start with
+     * a slash can't be the prefix of an absolute name and aren't
+     * put in the trie.
+     */
+    if (prefix[0] == '/') {
+	PrefixNode(prefix, TRUE)->prefixPtr = prefixPtr;
+    }
     return(prefixPtr);
 }
 
@@ -881,6 +923,7 @@ PrefixUpdate(prefixPtr, serverID, hdrPtr, domainType, flags)
     int			domainType;	/* Domain type of handle */
     int			flags;		/* import, export, etc. */
 {
+    PREFIX_CHANGE_BEGIN();
     if (prefixPtr->hdrPtr == (Fs_HandleHeader *)NIL) {
 	/*
 	 * No handle, we are being updated during a pathname redirection.
@@ -921,9 +964,122 @@ PrefixUpdate(prefixPtr, serverID, hdrPtr, domainType, flags)
 	    prefixPtr->flags	|= FS_EXPORTED_PREFIX;
 	}
     }
+    PREFIX_CHANGE_END();
     return;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * PrefixNode --
+ *
+ *	Find the trie node for a prefix, optionally adding nodes for
+ *	any components of the prefix that aren't in the trie yet.  The
+ *	components are split at every slash, so "/a/" and "//a" have
+ *	nodes for empty components and a name is under a prefix
+ *	exactly when the prefix is a leading substring of the name that
+ *	ends at a component boundary.
+ *
+ * Results:
+ *	The node for the prefix, or NIL if create is FALSE and there
+ *	is no node for it, or if the prefix doesn't start with a slash.
+ *
+ * Side effects:
+ *	Allocates and links in new nodes if create is TRUE.
+ *
+ *----------------------------------------------------------------------
+ */
+static INTERNAL FsprefixNode *
+PrefixNode(prefix, create)
+    char	*prefix;	/* Prefix to find the node for */
+    Boolean	create;		/* TRUE if missing nodes should be added */
+{
+    register FsprefixNode *nodePtr;
+    register FsprefixNode *childPtr;
+    register char *namePtr;
+    register int length;
+
+    if (prefix[0] != '/') {
+	return((FsprefixNode *)NIL);
+    }
+    nodePtr = prefixRoot;
+    namePtr = &prefix[1];
+    while (*namePtr != '\0') {
+	if (nodePtr != prefixRoot) {
+	    namePtr++;
+	}
+	for (length = 0; namePtr[length] != '\0' && namePtr[length] != '/';
+		length++) {
+	}
+	for (childPtr = nodePtr->childPtr; childPtr != (FsprefixNode *)NIL;
+		childPtr = childPtr->nextPtr) {
+	    if (childPtr->length == length &&
+		    strncmp(childPtr->name, namePtr, length) == 0) {
+		break;
+	    }
+	}
+	if (childPtr == (FsprefixNode *)NIL) {
+	    if (!create) {
+		return((FsprefixNode *)NIL);
+	    }
+	    /*
+	     * Fill in the new node before linking it in so a lookup that
+	     * is walking the trie without the lock never sees it half done.
+	     * Nodes are never freed.
+	     */
+	    childPtr = mnew(FsprefixNode);
+	    childPtr->childPtr = (FsprefixNode *)NIL;
+	    childPtr->nextPtr = nodePtr->childPtr;
+	    childPtr->prefixPtr = (Fsprefix *)NIL;
+	    childPtr->length = length;
+	    childPtr->name = (char *)malloc(length + 1);
+	    (void)strncpy(childPtr->name, namePtr, length);
+	    childPtr->name[length] = '\0';
+	    nodePtr->childPtr = childPtr;
+	}
+	namePtr += length;
+	nodePtr = childPtr;
+    }
+    return(nodePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PrefixFind --
+ *
+ *	Find the prefix table entry for a prefix.
+ *
+ * Results:
+ *	The entry whose prefix matches exactly, or NIL.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static INTERNAL Fsprefix *
+PrefixFind(prefix)
+    char	*prefix;	/* Prefix to look for */
+{
+    register FsprefixNode *nodePtr;
+    register Fsprefix *prefixPtr;
+
+    if (prefix[0] == '/') {
+	nodePtr = PrefixNode(prefix, FALSE);
+	if (nodePtr == (FsprefixNode *)NIL) {
+	    return((Fsprefix *)NIL);
+	}
+	return(nodePtr->prefixPtr);
+    }
+    LIST_FORALL(prefixList, (List_Links *)prefixPtr) {
+	if (strcmp(prefixPtr->prefix, prefix) == 0) {
+	    return(prefixPtr);
+	}
+    }
+    return((Fsprefix *)NIL);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -931,6 +1087,8 @@ PrefixUpdate(prefixPtr, serverID, hdrPtr, domainType, flags)
  *
  *	Find an entry in the prefix table.  It is the caller's responsibility
  *	to broadcast to get the handle for the prefix, if necessary.
+ *	The table is searched without the monitor lock, see the
+ *	comment by prefixGeneration.
  *
  * Results:
  *	SUCCESS means there was a prefix match.  Still, *hdrPtr and
@@ -942,7 +1100,7 @@ PrefixUpdate(prefixPtr, serverID, hdrPtr, domainType, flags)
  *
  *----------------------------------------------------------------------
  */
-ENTRY ReturnStatus
+ReturnStatus
 Fsprefix_Lookup(fileName, flags, clientID, hdrPtrPtr, rootIDPtr, lookupNamePtr, 
 		serverIDPtr, domainTypePtr, prefixPtrPtr)
     register char *fileName;	/* File name to match against */
@@ -962,24 +1120,12 @@ Fsprefix_Lookup(fileName, flags, clientID, hdrPtrPtr, rootIDPtr, lookupNamePtr,
 {
     register Fs_ProcessState	*fsPtr;	   	    /* For this process, to
 						     * return working dir.*/
-    register Fsprefix 		*longestPrefixPtr;  /* Longest match */
-    register Fsprefix		*prefixPtr;	    /* Pointer to table entry */
     register Fs_NameInfo		*nameInfoPtr;	    /* Name info for prefix */
     ReturnStatus		status = SUCCESS;   /* Return value */
-    Boolean			exactMatch;	    /* TRUE the fileName has
-						     * to match the prefix in 
-						     * the table exactly */
-    Boolean			wantLink;	    /* TRUE if caller wants to
-						     * inhibit indirection via
-						     * a prefix so it can lstat
-						     * the link file itself. */
-
-    LOCK_MONITOR;
+    unsigned int		generation;	    /* prefixGeneration before
+						     * the search */
+    int				tries;		    /* Searches so far */
 
-    longestPrefixPtr = (Fsprefix *) NIL;
-    exactMatch = (flags & FSPREFIX_EXACT);
-    wantLink = (flags & FSPREFIX_LINK_NOT_PREFIX);
-    flags &= ~(FSPREFIX_EXACT|FSPREFIX_LINK_NOT_PREFIX);
     if (fileName[0] != '/') {
 	/*
 	 * For relative names just return the handle from the current
@@ -988,7 +1134,7 @@ Fsprefix_Lookup(fileName, flags, clientID, hdrPtrPtr, rootIDPtr, lookupNamePtr,
 	 */
 	fs_Stats.prefix.relative++;
 	fsPtr = (Proc_GetEffectiveProc())->fsPtr;
-	if (!exactMatch && fsPtr->cwdPtr != (Fs_Stream *)NIL) {
+	if (!(flags & FSPREFIX_EXACT) && fsPtr->cwdPtr != (Fs_Stream *)NIL) {
 	    *hdrPtrPtr = fsPtr->cwdPtr->ioHandlePtr;
 	    nameInfoPtr = fsPtr->cwdPtr->nameInfoPtr;
 	    *rootIDPtr = nameInfoPtr->rootID;
@@ -998,110 +1144,248 @@ Fsprefix_Lookup(fileName, flags, clientID, hdrPtrPtr, rootIDPtr, lookupNamePtr,
 	} else {
 	    status = FS_FILE_NOT_FOUND;
 	}
-    } else {
-	fs_Stats.prefix.absolute++;
-	LIST_FORALL(prefixList, (List_Links *) prefixPtr) {
-	    if (strncmp(prefixPtr->prefix, fileName, prefixPtr->prefixLength)
-					== 0) {
-		char	lastChar;
-
-		if (!(flags & prefixPtr->flags)) {
-		    /*
-		     * Only hit on imported or exported prefixes, as requested.
-		     */
-		    continue;
-		}
-		lastChar = fileName[prefixPtr->prefixLength];
-		if (exactMatch && lastChar != '\0') {
-		    /*
-		     * Need an exact match, but there is more filename left.
-		     */
-		    continue;
-		} else if (wantLink && lastChar == '\0' &&
-			    prefixPtr->prefixLength != 1) {
-		    /*
-		     * The opposite of exact match.  We skip an exact match
-		     * if we are trying to open a remote link.  This makes
-		     * lstat() behave the same on all remote links, whether
-		     * or not there is an installed prefix for the link.
-		     */
-		    continue;
-		} else if ((prefixPtr->prefixLength == 1) ||
-			   (lastChar == '\0') || (lastChar == '/')) {
-		    /*
-		     * The prefix is "/", or the prefix matches up through
-		     * a complete pathname component.  This implies that
-		     * /spur is not a valid prefix of /spurios.
-		     */
-		    if (longestPrefixPtr == (Fsprefix *)NIL) {
-			longestPrefixPtr = prefixPtr;
-		    } else if (longestPrefixPtr->prefixLength <
-			       prefixPtr->prefixLength) {
-			longestPrefixPtr = prefixPtr;
-		    }
-		}
-	    }
-	}
-	if (longestPrefixPtr != (Fsprefix *)NIL) {
-	    if ((flags & FSPREFIX_EXPORTED) && (clientID >= 0) &&
-		(! List_IsEmpty(&longestPrefixPtr->exportList))) {
+	return(status);
+    }
+    fs_Stats.prefix.absolute++;
+    for (tries = 0; tries < PREFIX_MAX_TRIES; tries++) {
+	generation = prefixGeneration;
+	if ((generation & 1) == 0) {
+	    status = PrefixSearch(fileName, flags, clientID, FALSE, hdrPtrPtr,
+			lookupNamePtr, serverIDPtr, domainTypePtr,
+			prefixPtrPtr);
+	    if (status == FAILURE) {
 		/*
-		 * Check the export list to see if the remote client has
-		 * access.  An empty export list implies everyone has access.
+		 * The export list has to be checked under the lock.
 		 */
-		register FsprefixExport *exportPtr;
-		status = FS_NO_ACCESS;
-		LIST_FORALL(&longestPrefixPtr->exportList,
-			    (List_Links *)exportPtr) {
-		    if (exportPtr->spriteID == clientID) {
-			status = SUCCESS;
-			break;
-		    }
-		}
+		break;
 	    }
-	    if (status == SUCCESS) {
-		*hdrPtrPtr = longestPrefixPtr->hdrPtr;
-		*domainTypePtr = longestPrefixPtr->domainType;
-		if (*hdrPtrPtr == (Fs_HandleHeader *)NIL) {
-		    /*
-		     * Return our caller the prefix instead of a relative name
-		     * so it can broadcast to get the prefix's handle.  If
-		     * the prefix has been installed under a specific serverID
-		     * then we return that so internet RPC (presumably) can
-		     * be used to contact the server.  Otherwise we'll
-		     * broadcast to locate the server.
-		     */
-		    *lookupNamePtr = longestPrefixPtr->prefix;
-		    if (longestPrefixPtr->flags & FSPREFIX_REMOTE) {
-			*serverIDPtr = longestPrefixPtr->serverID;
-		    } else {
-			*serverIDPtr = RPC_BROADCAST_SERVER_ID;
-		    }
-		    *prefixPtrPtr = (Fsprefix *)NIL;
-		    status = FS_NO_HANDLE;
-		} else {
-		    /*
-		     * All set, return our caller the name after the prefix.
-		     * A name not starting with a slash is returned as the
-		     * relative name.  This is because of domains that
-		     * think that a name starting with a slash is absolute.
-		     */
+	    if (prefixGeneration == generation) {
+		if (status == SUCCESS) {
 		    *rootIDPtr = (*hdrPtrPtr)->fileID;
-		    *lookupNamePtr = &fileName[longestPrefixPtr->prefixLength];
-		    while (**lookupNamePtr == '/') {
-			(*lookupNamePtr)++;
-		    }
-		    *prefixPtrPtr = longestPrefixPtr;
 		}
+		return(status);
 	    }
-	} else {
-	    status = FS_FILE_NOT_FOUND;
 	}
+	fs_Stats.prefix.retries++;
+    }
+    fs_Stats.prefix.locked++;
+    return(PrefixSearchLocked(fileName, flags, clientID, hdrPtrPtr,
+		rootIDPtr, lookupNamePtr, serverIDPtr, domainTypePtr,
+		prefixPtrPtr));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PrefixSearchLocked --
+ *
+ *	Search the prefix table for an absolute name with the monitor
+ *	lock held.  This is used when a search without the lock keeps
+ *	racing with changes to the table, and to check export lists.
+ *
+ * Results:
+ *	As for Fsprefix_Lookup.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+ENTRY static ReturnStatus
+PrefixSearchLocked(fileName, flags, clientID, hdrPtrPtr, rootIDPtr,
+		lookupNamePtr, serverIDPtr, domainTypePtr, prefixPtrPtr)
+    char 	*fileName;	/* Absolute file name to match against */
+    int 	flags;		/* Flags from Fsprefix_Lookup */
+    int		clientID;	/* Use to check export list */
+    Fs_HandleHeader **hdrPtrPtr;	/* Return, the handle for the prefix */
+    Fs_FileID	*rootIDPtr;	/* Return, ID of the root of the domain */
+    char 	**lookupNamePtr;/* Return, prefix or relative name */
+    int		*serverIDPtr;	/* Return, server if no handle */
+    int		*domainTypePtr;	/* Return, the domain of the prefix */
+    Fsprefix	**prefixPtrPtr;	/* Return, prefix used to find the file */
+{
+    ReturnStatus status;
+
+    LOCK_MONITOR;
+    status = PrefixSearch(fileName, flags, clientID, TRUE, hdrPtrPtr,
+		lookupNamePtr, serverIDPtr, domainTypePtr, prefixPtrPtr);
+    if (status == SUCCESS) {
+	*rootIDPtr = (*hdrPtrPtr)->fileID;
     }
     UNLOCK_MONITOR;
     return(status);
 }
-
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PrefixSearch --
+ *
+ *	Walk the prefix trie for an absolute name and return the longest
+ *	prefix that matches it.  This may be called without the monitor
+ *	lock, in which case the caller has to check prefixGeneration
+ *	before believing the results, and the results are only looked at,
+ *	never dereferenced, in here.
+ *
+ * Results:
+ *	As for Fsprefix_Lookup, except that *rootIDPtr isn't set.  If the
+ *	lock isn't held and the prefix has an export list to check this
+ *	returns FAILURE, and the caller must search with the lock held.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static ReturnStatus
+PrefixSearch(fileName, flags, clientID, locked, hdrPtrPtr, lookupNamePtr,
+		serverIDPtr, domainTypePtr, prefixPtrPtr)
+    char 	*fileName;	/* Absolute file name to match against */
+    int 	flags;		/* Flags from Fsprefix_Lookup */
+    int		clientID;	/* Use to check export list */
+    Boolean	locked;		/* TRUE if the monitor lock is held */
+    Fs_HandleHeader **hdrPtrPtr;	/* Return, the handle for the prefix */
+    char 	**lookupNamePtr;/* Return, prefix or relative name */
+    int		*serverIDPtr;	/* Return, server if no handle */
+    int		*domainTypePtr;	/* Return, the domain of the prefix */
+    Fsprefix	**prefixPtrPtr;	/* Return, prefix used to find the file */
+{
+    register FsprefixNode	*nodePtr;	    /* Node matched so far */
+    register FsprefixNode	*childPtr;	    /* Node for next component*/
+    register char		*namePtr;	    /* End of the part of
+						     * fileName matched */
+    register int		length;		    /* Of next component */
+    register Fsprefix		*prefixPtr;	    /* Pointer to table entry */
+    register Fsprefix 		*longestPrefixPtr;  /* Longest match */
+    char			*longestEndPtr;	    /* Where it ends in
+						     * fileName */
+    ReturnStatus		status = SUCCESS;   /* Return value */
+    Boolean			exactMatch;	    /* TRUE the fileName has
+						     * to match the prefix in 
+						     * the table exactly */
+    Boolean			wantLink;	    /* TRUE if caller wants to
+						     * inhibit indirection via
+						     * a prefix so it can lstat
+						     * the link file itself. */
+
+    longestPrefixPtr = (Fsprefix *) NIL;
+    longestEndPtr = fileName;
+    exactMatch = (flags & FSPREFIX_EXACT);
+    wantLink = (flags & FSPREFIX_LINK_NOT_PREFIX);
+    flags &= ~(FSPREFIX_EXACT|FSPREFIX_LINK_NOT_PREFIX);
+
+    /*
+     * Each node on the way down matches through a complete pathname
+     * component, or is "/".  This implies that /spur is not a valid
+     * prefix of /spurios.  Each match is longer than the one before.
+     */
+    nodePtr = prefixRoot;
+    namePtr = &fileName[1];
+    while (TRUE) {
+	prefixPtr = nodePtr->prefixPtr;
+	if (prefixPtr == (Fsprefix *)NIL || !(flags & prefixPtr->flags)) {
+	    /*
+	     * Only hit on imported or exported prefixes, as requested.
+	     */
+	} else if (exactMatch && *namePtr != '\0') {
+	    /*
+	     * Need an exact match, but there is more filename left.
+	     */
+	} else if (wantLink && *namePtr == '\0' && nodePtr != prefixRoot) {
+	    /*
+	     * The opposite of exact match.  We skip an exact match
+	     * if we are trying to open a remote link.  This makes
+	     * lstat() behave the same on all remote links, whether
+	     * or not there is an installed prefix for the link.
+	     */
+	} else {
+	    longestPrefixPtr = prefixPtr;
+	    longestEndPtr = namePtr;
+	}
+	if (*namePtr == '\0') {
+	    break;
+	}
+	if (nodePtr != prefixRoot) {
+	    namePtr++;
+	}
+	for (length = 0; namePtr[length] != '\0' && namePtr[length] != '/';
+		length++) {
+	}
+	for (childPtr = nodePtr->childPtr; childPtr != (FsprefixNode *)NIL;
+		childPtr = childPtr->nextPtr) {
+	    if (childPtr->length == length &&
+		    strncmp(childPtr->name, namePtr, length) == 0) {
+		break;
+	    }
+	}
+	if (childPtr == (FsprefixNode *)NIL) {
+	    break;
+	}
+	fs_Stats.prefix.components++;
+	namePtr += length;
+	nodePtr = childPtr;
+    }
+    if (longestPrefixPtr == (Fsprefix *)NIL) {
+	return(FS_FILE_NOT_FOUND);
+    }
+    if ((flags & FSPREFIX_EXPORTED) && (clientID >= 0) &&
+	(! List_IsEmpty(&longestPrefixPtr->exportList))) {
+	/*
+	 * Check the export list to see if the remote client has
+	 * access.  An empty export list implies everyone has access.
+	 * The list can't be followed safely without the lock.
+	 */
+	register FsprefixExport *exportPtr;
+
+	if (!locked) {
+	    return(FAILURE);
+	}
+	status = FS_NO_ACCESS;
+	LIST_FORALL(&longestPrefixPtr->exportList, (List_Links *)exportPtr) {
+	    if (exportPtr->spriteID == clientID) {
+		status = SUCCESS;
+		break;
+	    }
+	}
+	if (status != SUCCESS) {
+	    return(status);
+	}
+    }
+    *hdrPtrPtr = longestPrefixPtr->hdrPtr;
+    *domainTypePtr = longestPrefixPtr->domainType;
+    if (*hdrPtrPtr == (Fs_HandleHeader *)NIL) {
+	/*
+	 * Return our caller the prefix instead of a relative name
+	 * so it can broadcast to get the prefix's handle.  If
+	 * the prefix has been installed under a specific serverID
+	 * then we return that so internet RPC (presumably) can
+	 * be used to contact the server.  Otherwise we'll
+	 * broadcast to locate the server.
+	 */
+	*lookupNamePtr = longestPrefixPtr->prefix;
+	if (longestPrefixPtr->flags & FSPREFIX_REMOTE) {
+	    *serverIDPtr = longestPrefixPtr->serverID;
+	} else {
+	    *serverIDPtr = RPC_BROADCAST_SERVER_ID;
+	}
+	*prefixPtrPtr = (Fsprefix *)NIL;
+	status = FS_NO_HANDLE;
+    } else {
+	/*
+	 * All set, return our caller the name after the prefix.
+	 * A name not starting with a slash is returned as the
+	 * relative name.  This is because of domains that
+	 * think that a name starting with a slash is absolute.
+	 */
+	*lookupNamePtr = longestEndPtr;
+	while (**lookupNamePtr == '/') {
+	    (*lookupNamePtr)++;
+	}
+	*prefixPtrPtr = longestPrefixPtr;
+    }
+    return(status);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1130,27 +1414,27 @@ Fsprefix_Export(prefix, clientID, delete)
 
     LOCK_MONITOR;
 
-    LIST_FORALL(prefixList, (List_Links *)prefixPtr) {
-	if (strcmp(prefixPtr->prefix, prefix) == 0) {
-	    LIST_FORALL(&prefixPtr->exportList, (List_Links *)exportPtr) {
-		if (exportPtr->spriteID == clientID) {
-		    if (delete) {
-			List_Remove((List_Links *)exportPtr);
-			free((Address)exportPtr);
-		    }
-		    found = TRUE;
-		    break;
+    prefixPtr = PrefixFind(prefix);
+    if (prefixPtr != (Fsprefix *)NIL) {
+	PREFIX_CHANGE_BEGIN();
+	LIST_FORALL(&prefixPtr->exportList, (List_Links *)exportPtr) {
+	    if (exportPtr->spriteID == clientID) {
+		if (delete) {
+		    List_Remove((List_Links *)exportPtr);
+		    free((Address)exportPtr);
 		}
+		found = TRUE;
+		break;
 	    }
-	    if (!found && !delete) {
-		exportPtr = mnew(FsprefixExport);
-		List_InitElement((List_Links *)exportPtr);
-		exportPtr->spriteID = clientID;
-		List_Insert((List_Links *)exportPtr,
-			    LIST_ATREAR(&prefixPtr->exportList));
-	    }
-	    break;
 	}
+	if (!found && !delete) {
+	    exportPtr = mnew(FsprefixExport);
+	    List_InitElement((List_Links *)exportPtr);
+	    exportPtr->spriteID = clientID;
+	    List_Insert((List_Links *)exportPtr,
+			LIST_ATREAR(&prefixPtr->exportList));
+	}
+	PREFIX_CHANGE_END();
     }
     UNLOCK_MONITOR;
 }
@@ -1195,32 +1479,30 @@ Fsprefix_Clear(prefix, deleteFlag, forced)
     LOCK_MONITOR;
 
     /*
-     * First pass to scan the table for the prefix and get the
-     * flags and fileID associated with the prefix table entry.
+     * First find the prefix and get the flags and fileID associated
+     * with the prefix table entry.
      */
-    LIST_FORALL(prefixList, (List_Links *)prefixPtr) {
-	if (strcmp(prefixPtr->prefix, prefix) == 0) {
-	    if (prefixPtr->flags & (FSPREFIX_EXPORTED|FSPREFIX_LOCAL)) {
-		/*
-		 * We export the prefix and have to be careful about
-		 * deleting the prefix table entry for it.  Only if
-		 * there is another prefix corresponding to the same
-		 * domain can we delete this one.  This situation occurs
-		 * during bootstrap where "/bootTmp" is aliased to "/"
-		 * but eventually we want to nuke the local "/" so
-		 * we can hook up to the network "/".
-		 */
-		if (prefixPtr->hdrPtr != (Fs_HandleHeader *)NIL) {
-		    prefixID = prefixPtr->hdrPtr->fileID;
-		    okToNuke = FALSE;
-		}
+    prefixPtr = PrefixFind(prefix);
+    if (prefixPtr != (Fsprefix *)NIL) {
+	if (prefixPtr->flags & (FSPREFIX_EXPORTED|FSPREFIX_LOCAL)) {
+	    /*
+	     * We export the prefix and have to be careful about
+	     * deleting the prefix table entry for it.  Only if
+	     * there is another prefix corresponding to the same
+	     * domain can we delete this one.  This situation occurs
+	     * during bootstrap where "/bootTmp" is aliased to "/"
+	     * but eventually we want to nuke the local "/" so
+	     * we can hook up to the network "/".
+	     */
+	    if (prefixPtr->hdrPtr != (Fs_HandleHeader *)NIL) {
+		prefixID = prefixPtr->hdrPtr->fileID;
+		okToNuke = FALSE;
 	    }
-	    targetPrefixPtr = prefixPtr;
-	    break;
 	}
+	targetPrefixPtr = prefixPtr;
     }
     /*
-     * Second pass to look for an alias prefix.
+     * Scan the table to look for an alias prefix.
      */
     if (!okToNuke) {
 	LIST_FORALL(prefixList, (List_Links *)prefixPtr) {
@@ -1264,9 +1546,21 @@ nukeIt:
 	if (targetPrefixPtr->hdrPtr != (Fs_HandleHeader *)NIL) {
 	    FsprefixHandleCloseInt(targetPrefixPtr, FSPREFIX_ANY);
 	}
+	PREFIX_CHANGE_BEGIN();
 	targetPrefixPtr->serverID = RPC_BROADCAST_SERVER_ID;
 	targetPrefixPtr->flags &= ~(FSPREFIX_EXPORTED|FSPREFIX_LOCAL);
 	if (deleteFlag && targetPrefixPtr->prefixLength != 1) {
+	    register FsprefixNode *nodePtr;
+
+	    /*
+	     * Take the entry out of the trie before freeing it.  The
+	     * trie node stays behind for the next time the prefix
+	     * is installed.
+	     */
+	    nodePtr = PrefixNode(targetPrefixPtr->prefix, FALSE);
+	    if (nodePtr != (FsprefixNode *)NIL) {
+		nodePtr->prefixPtr = (Fsprefix *)NIL;
+	    }
 	    free((Address) targetPrefixPtr->prefix);
 	    while (! List_IsEmpty(&targetPrefixPtr->exportList)) {
 		register FsprefixExport *exportPtr;
@@ -1279,6 +1573,7 @@ nukeIt:
 	    List_Remove((List_Links *)targetPrefixPtr);
 	    free((Address) targetPrefixPtr);
 	}
+	PREFIX_CHANGE_END();
 	status = SUCCESS;
     }
 done:
@@ -1356,7 +1651,9 @@ FsprefixHandleCloseInt(prefixPtr, flags)
 	    printf("Fsprefix_HandleClose deleting \"%s\"\n", prefixPtr->prefix);
 	}
 	hdrPtr = prefixPtr->hdrPtr;
+	PREFIX_CHANGE_BEGIN();
 	prefixPtr->hdrPtr = (Fs_HandleHeader *)NIL;
+	PREFIX_CHANGE_END();
 	Fsutil_HandleLock(hdrPtr);
 	dummy.ioHandlePtr = hdrPtr;
 	dummy.hdr.fileID.type = -1;
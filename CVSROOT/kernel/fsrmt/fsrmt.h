@@ -25,6 +25,7 @@
 
 #include <fsutil.h>
 #include <fscache.h>
+#include <fsioLock.h>
 
 
 /* 
@@ -61,6 +62,9 @@ typedef struct Fsrmt_FileIOHandle {
     int			flags;		/* FS_SWAP */
     struct Vm_Segment	*segPtr;	/* Reference to code segment needed
 					 * to flush VM cache. */
+    Fsio_LockState	lock;		/* Shadow of the byte-range locks held
+					 * on the server by processes here,
+					 * reasserted if the server reboots. */
 } Fsrmt_FileIOHandle;			/* 216 BYTES  (264 with traced locks)*/
 
 /*
@@ -121,6 +125,7 @@ extern ReturnStatus FsrmtReopen _ARGS_((Fs_HandleHeader *hdrPtr, int inSize,
 extern ReturnStatus FsrmtBulkReopen _ARGS_((int serverID, int inSize,
 		Address inData, int *outSizePtr, Address outData));
 extern ReturnStatus Fsrmt_ServerReopen _ARGS_((int clientID));
+extern void Fsrmt_FileLockReopen _ARGS_((Fs_HandleHeader *hdrPtr));
 extern ReturnStatus FsrmtFileMigrate _ARGS_((Fsio_MigInfo *migInfoPtr, 
 		int dstClientID, int *flagsPtr, int *offsetPtr, int *sizePtr, 
 		Address *dataPtr));
@@ -131,6 +136,24 @@ extern ReturnStatus FsrmtPipeMigrate _ARGS_((Fsio_MigInfo *migInfoPtr,
 extern void Fsrmt_InitializeOps _ARGS_((void));
 extern void Fsrmt_Bin _ARGS_((void));
 
+/*
+ * Client cache of names and attributes leased from servers.
+ */
+extern	Boolean	fsrmt_NameCaching;
+extern	int	fsrmt_NameCacheSize;
+extern	int	fsrmt_NameCacheHits;
+extern	int	fsrmt_NameCacheMisses;
+
+extern int Fsrmt_NameCacheStamp _ARGS_((void));
+extern Boolean Fsrmt_NameCacheLookup _ARGS_((int serverID,
+		Fs_OpenArgs *openArgsPtr, char *name, Fs_FileID *fileIDPtr,
+		Fs_Attributes *attrPtr));
+extern void Fsrmt_NameCacheEnter _ARGS_((int serverID,
+		Fs_OpenArgs *openArgsPtr, char *name, Fs_FileID *fileIDPtr,
+		Fs_Attributes *attrPtr, int expires, int stamp));
+extern void Fsrmt_NameCacheRevoke _ARGS_((int serverID,
+		Fs_FileID *fileIDPtr));
+
 /*
  * Recovery testing operations.
  */
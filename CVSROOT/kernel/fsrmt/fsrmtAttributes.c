@@ -36,6 +36,7 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include <fsutil.h>
 #include <fslcl.h>
 #include <fsNameOps.h>
+#include <fsrmt.h>
 #include <fsconsist.h>
 #include <fscache.h>
 #include <fsdm.h>
@@ -96,12 +97,35 @@ FsrmtGetAttrPath(prefixHandle, relativeName, argsPtr, resultsPtr,
     char			replyName[FS_MAX_PATH_NAME_LENGTH];	 /* This
 						     * may get filled with a
 						     * redirected pathname. */
+    Fs_GetAttrLeaseArgs		leaseArgs;	/* Asks for a lease */
+    int				leaseSeconds;	/* Length of the lease */
+    int				stamp;		/* Name cache revocation
+						 * stamp */
+    int				startTime;	/* Start of the lease */
 
     openArgsPtr = (Fs_OpenArgs *) argsPtr;
     getAttrResultsPtr = (Fs_GetAttrResults *)resultsPtr;
 
-    storage.requestParamPtr = (Address) openArgsPtr;
-    storage.requestParamSize = sizeof(Fs_OpenArgs);
+    /*
+     * Answer from our name cache if we hold a lease on the name.
+     */
+    if (Fsrmt_NameCacheLookup(prefixHandle->fileID.serverID, openArgsPtr,
+	    relativeName, getAttrResultsPtr->fileIDPtr,
+	    getAttrResultsPtr->attrPtr)) {
+	return(SUCCESS);
+    }
+    stamp = Fsrmt_NameCacheStamp();
+    startTime = Fsutil_TimeInSeconds();
+
+    if (fsrmt_NameCaching) {
+	leaseArgs.openArgs = *openArgsPtr;
+	leaseArgs.leaseVersion = FS_LEASE_VERSION;
+	storage.requestParamPtr = (Address) &leaseArgs;
+	storage.requestParamSize = sizeof(Fs_GetAttrLeaseArgs);
+    } else {
+	storage.requestParamPtr = (Address) openArgsPtr;
+	storage.requestParamSize = sizeof(Fs_OpenArgs);
+    }
     storage.requestDataPtr = (Address) relativeName;
     storage.requestDataSize = strlen(relativeName) + 1;
     storage.replyParamPtr = (Address) &(getAttrResultsParam);
@@ -121,6 +145,19 @@ FsrmtGetAttrPath(prefixHandle, relativeName, argsPtr, resultsPtr,
 		 getAttrResultsParam.attrResults.fileID;
 	*(getAttrResultsPtr->attrPtr) =
 		getAttrResultsParam.attrResults.attrs;
+	/*
+	 * A server that granted a lease returns its length as the
+	 * reply data.  Older servers return no data.
+	 */
+	if (storage.replyDataSize == sizeof(int)) {
+	    bcopy((Address)replyName, (Address)&leaseSeconds, sizeof(int));
+	    if (leaseSeconds > 0) {
+		Fsrmt_NameCacheEnter(prefixHandle->fileID.serverID,
+		    openArgsPtr, relativeName, getAttrResultsPtr->fileIDPtr,
+		    getAttrResultsPtr->attrPtr, startTime + leaseSeconds,
+		    stamp);
+	    }
+	}
     } else if (status == FS_LOOKUP_REDIRECT) {
 	/*
 	 * Copy the info from our stack to a buffer for our caller
@@ -181,8 +218,14 @@ Fsrmt_RpcGetAttrPath(srvToken, clientID, command, storagePtr)
 						 * unallocated since proc call
 						 * allocates space for it. */
     int				domainType;
+    Boolean			wantLease;	/* Client asked for a lease */
+    int				stamp;		/* Lease stamp */
 
     openArgsPtr = (Fs_OpenArgs *) storagePtr->requestParamPtr;
+    wantLease =
+	(storagePtr->requestParamSize >= sizeof(Fs_GetAttrLeaseArgs)) &&
+	(((Fs_GetAttrLeaseArgs *)openArgsPtr)->leaseVersion ==
+	    FS_LEASE_VERSION);
 
     if (openArgsPtr->prefixID.serverID != rpc_SpriteID) {
 	/*
@@ -204,6 +247,7 @@ Fsrmt_RpcGetAttrPath(srvToken, clientID, command, storagePtr)
     getAttrResults.fileIDPtr = &(getAttrResultsParamPtr->attrResults.fileID);
 
     fs_Stats.srvName.getAttrs++;
+    stamp = Fsconsist_LeaseStamp();
     status = (*fs_DomainLookup[domainType][FS_DOMAIN_GET_ATTR])(prefixHandle,
 		(char *) storagePtr->requestDataPtr, (Address)openArgsPtr,
 		(Address)(&getAttrResults), &newNameInfoPtr);
@@ -213,6 +257,16 @@ Fsrmt_RpcGetAttrPath(srvToken, clientID, command, storagePtr)
 	storagePtr->replyParamSize = sizeof(Fs_GetAttrResultsParam);
 	storagePtr->replyDataPtr = (Address) NIL;
 	storagePtr->replyDataSize = 0;
+	if (wantLease) {
+	    /*
+	     * Let the client cache the name and attributes if we can.
+	     */
+	    storagePtr->replyDataSize = sizeof(int);
+	    storagePtr->replyDataPtr = (Address) malloc(sizeof(int));
+	    *(int *)storagePtr->replyDataPtr = Fsconsist_GrantLease(
+		    &getAttrResultsParamPtr->attrResults.fileID,
+		    clientID, stamp);
+	}
     } else if (status == FS_LOOKUP_REDIRECT) {
 	/*
 	 * The file is not found on this server, but somewhere else.
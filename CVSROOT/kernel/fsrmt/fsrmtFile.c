@@ -67,6 +67,8 @@ static Fscache_BackendRoutines  fsrmtBackendRoutines = {
 };
 static 	Fscache_Backend *cacheBackendPtr = (Fscache_Backend *) NIL;
 
+static ReturnStatus LockReopen _ARGS_((ClientData clientData,
+		Fs_FileID *streamIDPtr, Fsio_RangeLockArgs *argPtr));
 static Boolean FileMatch _ARGS_((Fscache_FileInfo *cacheInfoPtr, 
 		ClientData cleintData));
 static Boolean BlockMatch _ARGS_((Fscache_Block *blockPtr,
@@ -155,6 +157,7 @@ FsRmtFileHandleInit(fileIDPtr, fileStatePtr, openForWriting, name,
 	handlePtr->flags = 0;
 	handlePtr->openTimeStamp = fileStatePtr->openTimeStamp;
 	handlePtr->segPtr = (Vm_Segment *)NIL;
+	Fsio_LockInit(&handlePtr->lock);
 	fs_Stats.object.rmtFiles++;
     }
     if (fileStatePtr->newUseFlags & FS_DIR) {
@@ -354,6 +357,80 @@ FsrmtFileReopen(hdrPtr, clientID, inData, outSizePtr, outDataPtr)
     }
     return(status);
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsrmt_FileLockReopen --
+ *
+ *	Reassert the byte-range locks held through a remote file after
+ *	its server reboots.  This is called once the file's streams have
+ *	been reopened, since the server finds the stream for each lock.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	An RPC_FS_IO_CONTROL for each lock.  Locks that another client
+ *	took while the server was recovering are dropped.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Fsrmt_FileLockReopen(hdrPtr)
+    Fs_HandleHeader	*hdrPtr;	/* Locked remote file handle */
+{
+    register Fsrmt_FileIOHandle *handlePtr = (Fsrmt_FileIOHandle *)hdrPtr;
+
+    if (handlePtr->lock.numRanges > 0) {
+	Fsio_LockReopen(&handlePtr->lock, LockReopen, (ClientData)handlePtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LockReopen --
+ *
+ *	Called via Fsio_LockReopen to reassert one byte-range lock with
+ *	the server.  Fsrmt_IOControl only uses the stream's ID and I/O
+ *	handle, so a stream is faked up here rather than looking up the
+ *	real one.
+ *
+ * Results:
+ *	The status of the lock RPC.
+ *
+ * Side effects:
+ *	Does a non-blocking IOC_RANGE_LOCK_SET on the server.
+ *
+ *----------------------------------------------------------------------
+ */
+static ReturnStatus
+LockReopen(clientData, streamIDPtr, argPtr)
+    ClientData		clientData;	/* Remote file handle */
+    Fs_FileID		*streamIDPtr;	/* Stream the lock was made on */
+    Fsio_RangeLockArgs	*argPtr;	/* The lock, with IOC_LOCK_NO_BLOCK */
+{
+    Fs_Stream		stream;
+    Fs_IOCParam		ioctl;
+    Fs_IOReply		reply;
+
+    stream.hdr.fileID = *streamIDPtr;
+    stream.ioHandlePtr = (Fs_HandleHeader *)clientData;
+
+    ioctl.command = IOC_RANGE_LOCK_SET;
+    ioctl.inBuffer = (Address)argPtr;
+    ioctl.inBufSize = sizeof(Fsio_RangeLockArgs);
+    ioctl.outBuffer = (Address)NIL;
+    ioctl.outBufSize = 0;
+    ioctl.format = mach_Format;
+    ioctl.procID = argPtr->pid;
+    ioctl.familyID = argPtr->pid;
+    ioctl.uid = 0;
+    ioctl.flags = 0;
+
+    return(Fsrmt_IOControl(&stream, &ioctl, &reply));
+}
 
 /*
  *----------------------------------------------------------------------
@@ -386,9 +463,12 @@ FsrmtFileClose(streamPtr, clientID, procID, flags, dataSize, closeData)
     register Fsrmt_FileIOHandle *handlePtr =
 	    (Fsrmt_FileIOHandle *)streamPtr->ioHandlePtr;
     /*
-     * Decrement local references.
+     * Decrement local references, and forget the byte-range locks made
+     * through the stream.  The server releases them when it sees the
+     * close.
      */
 
+    Fsio_LockClose(&handlePtr->lock, &streamPtr->hdr.fileID);
     handlePtr->rmt.recovery.use.ref--;
     if (flags & FS_WRITE) {
 	handlePtr->rmt.recovery.use.write--;
@@ -471,6 +551,7 @@ FsrmtFileScavenge(hdrPtr)
 	Fsutil_RecoverySyncLockCleanup(&handlePtr->rmt.recovery);
 	Fscache_InfoSyncLockCleanup(&handlePtr->cacheInfo);
 	Fscache_ReadAheadSyncLockCleanup(&handlePtr->readAhead);
+	Fsio_LockCleanup(&handlePtr->lock);
 	Fsutil_HandleRemove(handlePtr);
 	fs_Stats.object.rmtFiles--;
 	return(TRUE);
@@ -1236,6 +1317,58 @@ FsrmtFileIOControl(streamPtr, ioctlPtr, replyPtr)
 	case IOC_UNLOCK:
 	    status = Fsrmt_IOControl(streamPtr, ioctlPtr, replyPtr);
 	    break;
+	case IOC_RANGE_LOCK_TEST:
+	case IOC_RANGE_LOCK_SET:
+	case IOC_RANGE_LOCK_UNLOCK:
+	    if (ioctlPtr->inBufSize < sizeof(Fsio_RangeLockArgs)) {
+		status = GEN_INVALID_ARG;
+		break;
+	    }
+	    /*
+	     * Tell the owner about locks it held through this stream that
+	     * could not be reclaimed after the server rebooted.
+	     */
+	    status = Fsio_RangeLockLost(&handlePtr->lock,
+			(Fsio_RangeLockArgs *)ioctlPtr->inBuffer,
+			&streamPtr->hdr.fileID);
+	    if (status != SUCCESS) {
+		break;
+	    }
+	    if (ioctlPtr->command == IOC_RANGE_LOCK_TEST) {
+		status = Fsrmt_IOControl(streamPtr, ioctlPtr, replyPtr);
+		break;
+	    }
+	    if (ioctlPtr->command == IOC_RANGE_LOCK_UNLOCK &&
+		!Fsio_RangeLockHeld(&handlePtr->lock,
+			(Fsio_RangeLockArgs *)ioctlPtr->inBuffer)) {
+		/*
+		 * The shadow has every lock the server granted here, so
+		 * there is nothing to release.  This keeps process exit,
+		 * which unlocks all its files, from doing an RPC each.
+		 */
+		status = SUCCESS;
+		break;
+	    }
+	    status = Fsrmt_IOControl(streamPtr, ioctlPtr, replyPtr);
+	    if (status == SUCCESS) {
+		/*
+		 * Shadow the lock the server granted or released.  Only
+		 * locks the server has granted are recorded here, so
+		 * this never blocks, and it is a reclaim so our own
+		 * reclaim window cannot hold it back.
+		 */
+		Fsio_RangeLockArgs lockArgs;
+
+		lockArgs = *(Fsio_RangeLockArgs *)ioctlPtr->inBuffer;
+		lockArgs.flags |= IOC_LOCK_NO_BLOCK|IOC_LOCK_RECLAIM;
+		if (ioctlPtr->command == IOC_RANGE_LOCK_SET) {
+		    (void)Fsio_RangeLock(&handlePtr->lock, &lockArgs,
+				&streamPtr->hdr.fileID);
+		} else {
+		    (void)Fsio_RangeUnlock(&handlePtr->lock, &lockArgs);
+		}
+	    }
+	    break;
 	case IOC_NUM_READABLE: {
 	    register int bytesAvailable;
 	    register int streamOffset;
@@ -0,0 +1,383 @@
+/*
+ * fsrmtNameCache.c --
+ *
+ *	A client-side cache of pathname lookups done by remote servers.
+ *	Each entry maps the arguments of an RPC_FS_GET_ATTR_PATH (server,
+ *	prefix, relative name, user IDs and so on) to the I/O fileID
+ *	and attributes the server returned.  Entries are only made when
+ *	the server grants a lease, and they are good until the lease runs
+ *	out or the server revokes it with an RPC_FS_CONSIST call-back
+ *	(see fsconsistLease.c).  While an entry is good, stats of the
+ *	name are answered here without going to the server.
+ *
+ * Copyright 1991 Regents of the University of California
+ * All rights reserved.
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ */
+
+#ifndef lint
+static char rcsid[] = "$Header$ SPRITE (Berkeley)";
+#endif not lint
+
+
+#include <sprite.h>
+#include <fs.h>
+#include <fsutil.h>
+#include <fsNameOps.h>
+#include <fsrmt.h>
+#include <list.h>
+#include <string.h>
+#include <stdlib.h>
+#include <bstring.h>
+
+static Sync_Lock nameCacheLock = Sync_LockInitStatic("Fs:rmtNameCacheLock");
+#define	LOCKPTR	(&nameCacheLock)
+
+/*
+ * Name caching can be turned off by setting fsrmt_NameCaching to FALSE.
+ * fsrmt_NameCacheSize limits the number of entries; the least recently
+ * used entry is replaced when the cache is full.
+ */
+Boolean	fsrmt_NameCaching = TRUE;
+int	fsrmt_NameCacheSize = 256;
+int	fsrmt_NameCacheHits = 0;
+int	fsrmt_NameCacheMisses = 0;
+
+#define	NAME_HASH_SIZE	64
+
+typedef struct NameCacheEntry {
+    List_Links	links;		/* Hash chain, MUST BE FIRST */
+    struct NameCacheLru {
+	List_Links links;	/* Links for the LRU list */
+	struct NameCacheEntry *entryPtr;	/* Back pointer to the entry */
+    } lru;
+    int		serverID;	/* Server that answered the lookup */
+    Fs_OpenArgs	openArgs;	/* Lookup arguments, part of the key */
+    Fs_FileID	fileID;		/* I/O fileID from the server */
+    Fs_Attributes attrs;	/* Attributes from the server */
+    int		expires;	/* Time the lease runs out */
+    char	name[4];	/* Relative name.  The actual size may be
+				 * longer.  This MUST be the last field. */
+} NameCacheEntry;
+
+static Boolean		nameCacheInit = FALSE;
+static List_Links	nameHashTable[NAME_HASH_SIZE];
+static List_Links	nameLruList;
+static int		numNameEntries = 0;
+
+/*
+ * Incremented on every revocation.  A lookup reply is not entered if
+ * a revocation arrived while it was outstanding, since the revocation
+ * may be for the attributes in the reply.
+ */
+static int		nameCacheStamp = 0;
+
+static int NameHash _ARGS_((int serverID, Fs_OpenArgs *openArgsPtr,
+			char *name));
+static NameCacheEntry *NameFind _ARGS_((int hash, int serverID,
+			Fs_OpenArgs *openArgsPtr, char *name));
+static void NameDelete _ARGS_((NameCacheEntry *entryPtr));
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NameHash --
+ *
+ *	Compute the hash bucket for a lookup.
+ *
+ * Results:
+ *	An index into nameHashTable.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+INTERNAL static int
+NameHash(serverID, openArgsPtr, name)
+    int		serverID;	/* Server of the prefix */
+    Fs_OpenArgs	*openArgsPtr;	/* Lookup arguments */
+    register char *name;	/* Name relative to the prefix */
+{
+    register int i;
+
+    i = serverID + openArgsPtr->prefixID.major + openArgsPtr->prefixID.minor;
+    while (*name != '\0') {
+	i = i * 10 + *name++;
+    }
+    return(((i * 1103515245 + 12345) >> 16) & (NAME_HASH_SIZE - 1));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NameFind --
+ *
+ *	Look for an entry in a hash bucket.  The lookup arguments have
+ *	to match exactly because they affect the result: the root and
+ *	user IDs for permission checks and "..", the client IDs for
+ *	$MACHINE, and the follow flag for links.
+ *
+ * Results:
+ *	The entry, or NIL.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+INTERNAL static NameCacheEntry *
+NameFind(hash, serverID, openArgsPtr, name)
+    int		hash;		/* From NameHash */
+    int		serverID;	/* Server of the prefix */
+    Fs_OpenArgs	*openArgsPtr;	/* Lookup arguments */
+    char	*name;		/* Name relative to the prefix */
+{
+    register NameCacheEntry *entryPtr;
+
+    LIST_FORALL(&nameHashTable[hash], (List_Links *)entryPtr) {
+	if (entryPtr->serverID == serverID &&
+	    strcmp(entryPtr->name, name) == 0 &&
+	    bcmp((char *)&entryPtr->openArgs, (char *)openArgsPtr,
+		 sizeof(Fs_OpenArgs)) == 0) {
+	    return(entryPtr);
+	}
+    }
+    return((NameCacheEntry *)NIL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NameDelete --
+ *
+ *	Remove an entry from the cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the entry.
+ *
+ *----------------------------------------------------------------------
+ */
+INTERNAL static void
+NameDelete(entryPtr)
+    register NameCacheEntry *entryPtr;
+{
+    List_Remove((List_Links *)entryPtr);
+    List_Remove(&entryPtr->lru.links);
+    free((Address)entryPtr);
+    numNameEntries--;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsrmt_NameCacheStamp --
+ *
+ *	Return the revocation stamp.  This is taken before a lookup RPC
+ *	is sent and handed to Fsrmt_NameCacheEnter with the reply.
+ *
+ * Results:
+ *	The revocation stamp.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+ENTRY int
+Fsrmt_NameCacheStamp()
+{
+    int stamp;
+
+    LOCK_MONITOR;
+    stamp = nameCacheStamp;
+    UNLOCK_MONITOR;
+    return(stamp);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsrmt_NameCacheLookup --
+ *
+ *	Look for the result of an earlier lookup whose lease is
+ *	still good.
+ *
+ * Results:
+ *	TRUE, with *fileIDPtr and *attrPtr filled in, if the name
+ *	was found.
+ *
+ * Side effects:
+ *	Expired entries are removed.  The entry moves to the front
+ *	of the LRU list.
+ *
+ *----------------------------------------------------------------------
+ */
+ENTRY Boolean
+Fsrmt_NameCacheLookup(serverID, openArgsPtr, name, fileIDPtr, attrPtr)
+    int		serverID;	/* Server of the prefix */
+    Fs_OpenArgs	*openArgsPtr;	/* Lookup arguments */
+    char	*name;		/* Name relative to the prefix */
+    Fs_FileID	*fileIDPtr;	/* Return, I/O fileID */
+    Fs_Attributes *attrPtr;	/* Return, attributes */
+{
+    register NameCacheEntry *entryPtr;
+    Boolean found = FALSE;
+
+    if (!fsrmt_NameCaching) {
+	return(FALSE);
+    }
+    LOCK_MONITOR;
+    if (nameCacheInit) {
+	entryPtr = NameFind(NameHash(serverID, openArgsPtr, name),
+			    serverID, openArgsPtr, name);
+	if (entryPtr != (NameCacheEntry *)NIL) {
+	    if (entryPtr->expires <= Fsutil_TimeInSeconds()) {
+		NameDelete(entryPtr);
+	    } else {
+		*fileIDPtr = entryPtr->fileID;
+		*attrPtr = entryPtr->attrs;
+		List_Move(&entryPtr->lru.links, LIST_ATFRONT(&nameLruList));
+		found = TRUE;
+	    }
+	}
+    }
+    if (found) {
+	fsrmt_NameCacheHits++;
+    } else {
+	fsrmt_NameCacheMisses++;
+    }
+    UNLOCK_MONITOR;
+    return(found);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsrmt_NameCacheEnter --
+ *
+ *	Remember the result of a lookup that came with a lease.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Adds or replaces an entry, possibly replacing the least
+ *	recently used one.  Nothing is done if there has been a
+ *	revocation since the stamp was taken.
+ *
+ *----------------------------------------------------------------------
+ */
+ENTRY void
+Fsrmt_NameCacheEnter(serverID, openArgsPtr, name, fileIDPtr, attrPtr,
+		     expires, stamp)
+    int		serverID;	/* Server of the prefix */
+    Fs_OpenArgs	*openArgsPtr;	/* Lookup arguments */
+    char	*name;		/* Name relative to the prefix */
+    Fs_FileID	*fileIDPtr;	/* I/O fileID from the server */
+    Fs_Attributes *attrPtr;	/* Attributes from the server */
+    int		expires;	/* Time the lease runs out */
+    int		stamp;		/* From Fsrmt_NameCacheStamp */
+{
+    register NameCacheEntry *entryPtr;
+    register int i;
+    int hash;
+
+    if (!fsrmt_NameCaching || fsrmt_NameCacheSize <= 0) {
+	return;
+    }
+    LOCK_MONITOR;
+    if (stamp != nameCacheStamp) {
+	UNLOCK_MONITOR;
+	return;
+    }
+    if (!nameCacheInit) {
+	for (i = 0; i < NAME_HASH_SIZE; i++) {
+	    List_Init(&nameHashTable[i]);
+	}
+	List_Init(&nameLruList);
+	nameCacheInit = TRUE;
+    }
+    hash = NameHash(serverID, openArgsPtr, name);
+    entryPtr = NameFind(hash, serverID, openArgsPtr, name);
+    if (entryPtr != (NameCacheEntry *)NIL) {
+	NameDelete(entryPtr);
+    }
+    while (numNameEntries >= fsrmt_NameCacheSize) {
+	NameDelete(((struct NameCacheLru *)
+		    List_Last(&nameLruList))->entryPtr);
+    }
+    entryPtr = (NameCacheEntry *)malloc(sizeof(NameCacheEntry) +
+					 strlen(name));
+    List_InitElement((List_Links *)entryPtr);
+    List_InitElement(&entryPtr->lru.links);
+    entryPtr->lru.entryPtr = entryPtr;
+    entryPtr->serverID = serverID;
+    entryPtr->openArgs = *openArgsPtr;
+    entryPtr->fileID = *fileIDPtr;
+    entryPtr->attrs = *attrPtr;
+    entryPtr->expires = expires;
+    (void)strcpy(entryPtr->name, name);
+    List_Insert((List_Links *)entryPtr, LIST_ATFRONT(&nameHashTable[hash]));
+    List_Insert(&entryPtr->lru.links, LIST_ATFRONT(&nameLruList));
+    numNameEntries++;
+    UNLOCK_MONITOR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsrmt_NameCacheRevoke --
+ *
+ *	Drop the cached names of a file because the server revoked our
+ *	lease on it.  If fileIDPtr is NIL then every name cached from
+ *	the server is dropped.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Removes entries and increments the revocation stamp.
+ *
+ *----------------------------------------------------------------------
+ */
+ENTRY void
+Fsrmt_NameCacheRevoke(serverID, fileIDPtr)
+    int		serverID;	/* Server revoking the lease */
+    Fs_FileID	*fileIDPtr;	/* File whose names to drop, or NIL */
+{
+    register NameCacheEntry *entryPtr;
+    register NameCacheEntry *nextPtr;
+    register int i;
+
+    LOCK_MONITOR;
+    nameCacheStamp++;
+    if (!nameCacheInit) {
+	UNLOCK_MONITOR;
+	return;
+    }
+    for (i = 0; i < NAME_HASH_SIZE; i++) {
+	entryPtr = (NameCacheEntry *)List_First(&nameHashTable[i]);
+	while (!List_IsAtEnd(&nameHashTable[i], (List_Links *)entryPtr)) {
+	    nextPtr = (NameCacheEntry *)List_Next((List_Links *)entryPtr);
+	    if (entryPtr->serverID == serverID &&
+		(fileIDPtr == (Fs_FileID *)NIL ||
+		 (entryPtr->fileID.major == fileIDPtr->major &&
+		  entryPtr->fileID.minor == fileIDPtr->minor))) {
+		NameDelete(entryPtr);
+	    }
+	    entryPtr = nextPtr;
+	}
+    }
+    UNLOCK_MONITOR;
+}
@@ -222,10 +222,20 @@ extern void Fsutil_WaitListNotify _ARGS_((List_Links *list));
 extern void Fsutil_FastWaitListInsert _ARGS_((List_Links *list, 
 		Sync_RemoteWaiter *waitPtr));
 extern void Fsutil_FastWaitListNotify _ARGS_((List_Links *list));
+extern void Fsutil_NotifyWaiter _ARGS_((Sync_RemoteWaiter *waitPtr));
 extern void Fsutil_WaitListDelete _ARGS_((List_Links *list));
 extern void Fsutil_WaitListRemove _ARGS_((List_Links *list, 
 		Sync_RemoteWaiter *waitPtr));
 
+/*
+ * Iterator for Fsutil_GetNextHandle.  The handle table is split into
+ * partitions, each with its own hash table.
+ */
+typedef struct Fsutil_HandleSearch {
+    int		partition;	/* Partition being searched. */
+    Hash_Search	hashSearch;	/* Position within that partition. */
+} Fsutil_HandleSearch;
+
 /*
  * File handle routines.
  */
@@ -236,7 +246,10 @@ extern Fs_HandleHeader *Fsutil_HandleFetch _ARGS_((Fs_FileID *fileIDPtr));
 extern Fs_HandleHeader *Fsutil_HandleFetchNoWait _ARGS_((Fs_FileID *fileIDPtr,
 						Boolean *wouldWaitPtr));
 extern Fs_HandleHeader *Fsutil_HandleDup _ARGS_((Fs_HandleHeader *hdrPtr));
-extern Fs_HandleHeader *Fsutil_GetNextHandle _ARGS_((Hash_Search *hashSearchPtr));
+extern void Fsutil_StartHandleSearch _ARGS_((Fsutil_HandleSearch *searchPtr));
+extern Fs_HandleHeader *Fsutil_GetNextHandle _ARGS_((
+		Fsutil_HandleSearch *searchPtr));
+extern Boolean Fsutil_HandleReclaim _ARGS_((unsigned int budget));
 extern void Fsutil_HandleLockHdr _ARGS_((Fs_HandleHeader *hdrPtr));
 extern void Fsutil_HandleIncRefCount _ARGS_((Fs_HandleHeader *hdrPtr,
 		int amount));
@@ -2,7 +2,8 @@
  * fsutilHandle.c --
  *
  *	Routines to manage file handles.  They are kept in a table hashed
- *	by the Fs_FileID type.  They are referenced counted and eligible for
+ *	by the Fs_FileID type.  The table is split into partitions that are
+ *	locked independently.  Handles are referenced counted and eligible for
  *	removal when their reference count goes to zero.  Fsutil_HandleInstall
  *	adds handles to the table.  Fsutil_HandleFetch returns a locked handle.
  *	Fsutil_HandleLock locks a handle that you already have.
@@ -12,7 +13,8 @@
  *	Fsutil_HandleFetchType and Fsutil_HandleRelease do type casting and
  *	are defined in fsInt.h.  Fsutil_HandleRemove deletes a handle from
  *	the table, and Fsutil_GetNextHandle is used to iterate through the
- *	whole hash table.
+ *	whole table.  Fsutil_HandleReclaim is used by the scavenger to
+ *	reclaim unreferenced handles a bit at a time.
  *
  * Copyright 1986 Regents of the University of California.
  * All rights reserved.
@@ -35,37 +37,63 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include <string.h>
 #include <stdio.h>
 
-static Sync_Lock handleTableLock = Sync_LockInitStatic("Fs:handleTable");
-#define	LOCKPTR	&handleTableLock
-
 /*
- * Synchronization and termination variables for LRU replacement.
+ * The handle table is split into partitions so that processes using
+ * unrelated files do not all contend for one lock.  Each partition is a
+ * monitor with its own hash table and LRU list.  HANDLE_PARTITION picks
+ * the partition from the fileID.  It ignores the sign of the minor number
+ * so a handle stays in its partition after Fsutil_HandleInvalidate.
+ *
+ * The LRU list of a partition only holds handles that have a scavenging
+ * routine and no references.  A handle comes off the list when it is
+ * referenced and goes back on the young end when its last reference is
+ * released, so neither LRU replacement nor the scavenger has to step
+ * over handles that are in use.
  */
-Sync_Condition lruDone;
-static Boolean lruInProgress;
-static int lruHandlesChecked;
+typedef struct HandlePartition {
+    Sync_Lock		lock;		/* Monitor lock for the partition. */
+    Hash_Table		table;		/* Handles hashed by Fs_FileID. */
+    List_Links		lruList;	/* Unreferenced handles, oldest first*/
+    int			numHandles;	/* Handles installed in table. */
+    int			lruEntries;	/* Handles on lruList. */
+    Boolean		lruInProgress;	/* TRUE while a process is doing LRU
+					 * replacement in this partition. */
+    Sync_Condition	lruDone;	/* Notified when LRU replacement is
+					 * finished. */
+} HandlePartition;
+
+#define	HANDLE_PARTITIONS	16	/* Must be a power of two. */
+
+static HandlePartition handleTable[HANDLE_PARTITIONS];
+
+#define	HANDLE_PARTITION(fileIDPtr) \
+	(&handleTable[((fileIDPtr)->serverID + (fileIDPtr)->major * 31 + \
+	    (((fileIDPtr)->minor < 0) ? -(fileIDPtr)->minor : \
+	    (fileIDPtr)->minor)) & (HANDLE_PARTITIONS - 1)])
+
+#define	LOCKPTR	(&partPtr->lock)
+
 /*
- * NOTE: The current implementation of handle scavenging leads to serious
- * performance problems.  On systems with large file caches almost all the
- * handles on the LRU will have files in the cache and wont be scavenged.
- * Everytime a new handle needs to be created the entire LRU is scanned 
- * before the code gives up and malloc's memory. This needs to be fixed. 
+ * Reclaiming starts from this partition in the next call to
+ * Fsutil_HandleReclaim.
  */
+static int reclaimPartition = 0;
 
 /*
- * Hash tables for object handles.  These are kept in LRU order and
- * a soft limit on their number is enforced.  If the number of handles
- * gets beyond fs_Stats.handle.maxNumber then LRU replacement is done until
- * handleScavengeThreashold are replaced.  If all handles are in
+ * A soft limit on the number of handles is enforced in each partition,
+ * which may hold its share of fs_Stats.handle.maxNumber.  If a partition
+ * is full then LRU replacement is done in it until
+ * handleScavengeThreashold are replaced.  If all its handles are in
  * use the max table size is allowed to grow by handleLimitInc.
+ * These limits are shared by all the partitions, so they are only
+ * changed under handleLimitLock.
  * The table never shrinks on the premise that once it has grown the
  * memory allocator establishes a high water mark and shrinking the table
  * won't really help overall kernel memory usage.
  */
-Hash_Table	fileHashTableStruct;
-Hash_Table	*fileHashTable = &fileHashTableStruct;
-static List_Links lruListHeader;
-static List_Links *lruList = &lruListHeader;
+#define	PARTITION_LIMIT() \
+	((fs_Stats.handle.maxNumber + HANDLE_PARTITIONS - 1) / HANDLE_PARTITIONS)
+
 /*
  * FS_HANDLE_TABLE_SIZE is the initial size of the handle table.
  *	Observation reveals that it takes about 120 handles to get
@@ -86,9 +114,15 @@ static List_Links *lruList = &lruListHeader;
 int		handleLimitInc =	   LIMIT_INC(FS_HANDLE_TABLE_SIZE);
 #define		THREASHOLD(max)		   ( 1 )
 int		handleScavengeThreashold = THREASHOLD(FS_HANDLE_TABLE_SIZE);
+static Sync_Lock handleLimitLock = Sync_LockInitStatic("Fs:handleLimitLock");
 
-extern Fs_HandleHeader *GetNextLRUHandle _ARGS_((void));
-extern void DoneLRU _ARGS_((int numScavenged));
+static Fs_HandleHeader *GetNextLRUHandle _ARGS_((HandlePartition *partPtr,
+		int *checkedPtr));
+static void DoneLRU _ARGS_((HandlePartition *partPtr, int numScavenged));
+static void GrowHandleLimit _ARGS_((void));
+static Fs_HandleHeader *GetNextPartitionHandle _ARGS_((
+		HandlePartition *partPtr, Hash_Search *hashSearchPtr));
+static int DescWriteBackInt _ARGS_((HandlePartition *partPtr, int domain));
 
 /*
  * Flags for handles referenced from the hash table.
@@ -168,26 +202,43 @@ extern void DoneLRU _ARGS_((int numScavenged));
  * clean it up completely later with this macro.
  */
 
-#define REMOVE_HANDLE(hdrPtr) \
-	if ((hdrPtr)->lruLinks.nextPtr != (List_Links *)NIL) {	\
-	    List_Remove(&(hdrPtr)->lruLinks);		 	\
-	    fs_Stats.handle.lruEntries--;			\
-	}							\
+#define REMOVE_HANDLE(partPtr, hdrPtr) \
+	LRU_REMOVE(partPtr, hdrPtr);				\
 	if ((hdrPtr)->name != (char *)NIL) {			\
 	    free((hdrPtr)->name);				\
 	}							\
 	free((char *)(hdrPtr));
 
 /*
- * MOVE_HANDLE --
- * Macro to move a handle to the back (most recent) end of the LRU list.
- * Not all handle types are in the LRU list, hence the check against NIL.
+ * LRU_INSERT --
+ * Macro to put an unreferenced handle on the back (most recent) end of
+ * its partition's LRU list.  Only handles with a scavenging routine go
+ * on the list.  This allows us to avoid checking un-reclaimable things.
+ *
+ * LRU_REMOVE --
+ * Macro to take a handle off the LRU list when it gets referenced.
+ * Handles not on the list have NIL links, hence the check against NIL.
  */
 
-#define MOVE_HANDLE(hdrPtr) \
-	    if ((hdrPtr)->lruLinks.nextPtr != (List_Links *)NIL) {	\
-		List_Move(&(hdrPtr)->lruLinks, LIST_ATREAR(lruList));	\
-	    }
+#define LRU_INSERT(partPtr, hdrPtr) \
+	if (((hdrPtr)->lruLinks.nextPtr == (List_Links *)NIL) &&	\
+	    (fsio_StreamOpTable[(hdrPtr)->fileID.type].scavenge !=	\
+		(Boolean (*)())NIL)) {					\
+	    List_InitElement(&(hdrPtr)->lruLinks);			\
+	    List_Insert(&(hdrPtr)->lruLinks,				\
+			LIST_ATREAR(&(partPtr)->lruList));		\
+	    (partPtr)->lruEntries++;					\
+	    fs_Stats.handle.lruEntries++;				\
+	}
+
+#define LRU_REMOVE(partPtr, hdrPtr) \
+	if ((hdrPtr)->lruLinks.nextPtr != (List_Links *)NIL) {		\
+	    List_Remove(&(hdrPtr)->lruLinks);				\
+	    (hdrPtr)->lruLinks.nextPtr = (List_Links *)NIL;		\
+	    (hdrPtr)->lruLinks.prevPtr = (List_Links *)NIL;		\
+	    (partPtr)->lruEntries--;					\
+	    fs_Stats.handle.lruEntries--;				\
+	}
 
 /*
  * HDR_FILE_NAME --
@@ -206,22 +257,24 @@ extern Boolean HandleInstallInt _ARGS_((Fs_FileID *fileIDPtr,
  *
  * Fsutil_HandleInit --
  *
- * 	Initialize the hash table.
+ * 	Initialize the handle table.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	Hash table is initialized.
+ *	The partitions of the handle table are initialized.
  *
  *----------------------------------------------------------------------------
  */
 
 void
 Fsutil_HandleInit(fileHashSize)
-    int	fileHashSize;	/* The number of hash table entries to put in the
-			 * file hash table for starters. */
+    int	fileHashSize;	/* The number of hash table entries to put in
+			 * each partition of the handle table for starters. */
 {
+    register HandlePartition *partPtr;
+
     /*
      * Set the initial number of handle to be the maximum of 
      * FS_HANDLE_TABLE_SIZE and 1/4 of the maximum number of blocks in the
@@ -232,8 +285,16 @@ Fsutil_HandleInit(fileHashSize)
     if (fs_Stats.handle.maxNumber < fs_Stats.blockCache.maxNumBlocks/4) {
 	fs_Stats.handle.maxNumber = fs_Stats.blockCache.maxNumBlocks/4;
     }
-    List_Init(lruList);
-    Hash_Init(fileHashTable, fileHashSize, Hash_Size(sizeof(Fs_FileID)));
+    for (partPtr = handleTable; partPtr < &handleTable[HANDLE_PARTITIONS];
+	 partPtr++) {
+	Sync_LockInitDynamic(&partPtr->lock, "Fs:handleTable");
+	Hash_Init(&partPtr->table, fileHashSize, Hash_Size(sizeof(Fs_FileID)));
+	List_Init(&partPtr->lruList);
+	partPtr->numHandles = 0;
+	partPtr->lruEntries = 0;
+	partPtr->lruInProgress = FALSE;
+	partPtr->lruDone.waiting = FALSE;
+    }
 }
 
 
@@ -277,6 +338,8 @@ Fsutil_HandleInstall(fileIDPtr, size, name, cantBlock, hdrPtrPtr)
     Fs_HandleHeader *hdrPtr;
     Fs_HandleHeader *newHdrPtr = (Fs_HandleHeader *)NIL;
     Boolean returnLocked = TRUE;	/* For now, always return locked */
+    HandlePartition *partPtr = HANDLE_PARTITION(fileIDPtr);
+    int numChecked;
 
     fs_Stats.handle.installCalls++;
     do {
@@ -314,18 +377,20 @@ Fsutil_HandleInstall(fileIDPtr, size, name, cantBlock, hdrPtrPtr)
 	    }
 	}
 	hdrPtr = newHdrPtr;
-	tableFull = HandleInstallInt(fileIDPtr, fs_Stats.handle.maxNumber,
+	tableFull = HandleInstallInt(fileIDPtr, PARTITION_LIMIT(),
 				     &hdrPtr, &found, returnLocked);
 	if (tableFull) {
 	    /*
-	     * Size limit would be exceeded.  Recycle some handles.  The
-	     * new handle has not been installed into the hash table yet.
+	     * Size limit of the partition would be exceeded.  Recycle some
+	     * of its handles.  The new handle has not been installed into
+	     * the hash table yet.
 	     */
 	    numScavenged = 0;
+	    numChecked = 0;
 	    fs_Stats.handle.lruScans++;
-	    for (hdrPtr = GetNextLRUHandle();
+	    for (hdrPtr = GetNextLRUHandle(partPtr, &numChecked);
 		 hdrPtr != (Fs_HandleHeader *)NIL;
-		 hdrPtr = GetNextLRUHandle()) {
+		 hdrPtr = GetNextLRUHandle(partPtr, &numChecked)) {
 		if ((*fsio_StreamOpTable[hdrPtr->fileID.type].scavenge)(hdrPtr)) {
 		    numScavenged++;
 		    fs_Stats.handle.lruHits++;
@@ -340,7 +405,7 @@ Fsutil_HandleInstall(fileIDPtr, size, name, cantBlock, hdrPtrPtr)
 	     * Finish LRU, grow the table if needed, and then
 	     * loop back and try to fetch or install the handle again.
 	     */
-	    DoneLRU(numScavenged);
+	    DoneLRU(partPtr, numScavenged);
 	    hdrPtr = (Fs_HandleHeader *)NIL;
 	}
     } while (hdrPtr == (Fs_HandleHeader *)NIL);
@@ -382,12 +447,12 @@ Fsutil_HandleInstall(fileIDPtr, size, name, cantBlock, hdrPtrPtr)
  * HandleInstallInt --
  *
  *      Install a file handle.  This enforces a soft limit on the number
- *	of handles that can exist.  Our caller has to allocate space for
- *	the handle.
+ *	of handles that can exist in the handle's partition.  Our caller
+ *	has to allocate space for the handle.
  *
  * Results:
- *	TRUE is returned if the file handle table was full and our
- *	caller should do LRU replacement on the table.
+ *	TRUE is returned if the partition was full and our caller
+ *	should do LRU replacement on it.
  *	*foundPtr is set to TRUE if the handle was found.  This is possible
  *	on a multiprossor even if our caller has first tried a fetch.
  *
@@ -401,7 +466,8 @@ ENTRY Boolean
 HandleInstallInt(fileIDPtr, handleLimit, hdrPtrPtr, foundPtr, returnLocked)
     register Fs_FileID	*fileIDPtr;	/* Identfies handle to install. */
     unsigned int	handleLimit;	/* Determines how many handles can
-					 * exist before we return NULL */
+					 * exist in the partition before we
+					 * return NULL */
     Fs_HandleHeader	**hdrPtrPtr;	/* In - handle to install into table
 					 * Out - handle found in table. */    
     Boolean		*foundPtr;	/* TRUE upon return if handle found */
@@ -414,30 +480,30 @@ HandleInstallInt(fileIDPtr, handleLimit, hdrPtrPtr, foundPtr, returnLocked)
     register	Fs_HandleHeader	*hdrPtr;
     Boolean			tableFull = FALSE;
     Boolean			found;
+    register HandlePartition	*partPtr = HANDLE_PARTITION(fileIDPtr);
 
     LOCK_MONITOR;
 again:
-    if (fs_Stats.handle.exists >= handleLimit) {
+    if (partPtr->numHandles >= handleLimit) {
 	/*
 	 * Creating a handle will push us past the soft limit on handles.
 	 * We just look into the hash table, but do not create a new
 	 * entry if the handle isn't found.
 	 */
-	hashEntryPtr = Hash_LookOnly(fileHashTable, (Address) fileIDPtr);
+	hashEntryPtr = Hash_LookOnly(&partPtr->table, (Address) fileIDPtr);
 	if (hashEntryPtr == (Hash_Entry *)NIL) {
 	    /*
-	     * Table is full so our caller has to do LRU replacement.
+	     * Partition is full so our caller has to do LRU replacement.
 	     * If LRU is already in progress we wait so there is only
-	     * one process scanning the table at a time.
+	     * one process scanning the partition at a time.
 	     */
-	    if (lruInProgress) {
+	    if (partPtr->lruInProgress) {
 		do {
-		    (void)Sync_Wait(&lruDone, FALSE);
-		} while (lruInProgress);
+		    (void)Sync_Wait(&partPtr->lruDone, FALSE);
+		} while (partPtr->lruInProgress);
 		goto again;
 	    } else {
-		lruInProgress = TRUE;
-		lruHandlesChecked = 0;
+		partPtr->lruInProgress = TRUE;
 		found = FALSE;
 		tableFull = TRUE;
 		goto exit;
@@ -448,7 +514,7 @@ again:
 	 * Lookup the handle.  If a hash table entry doesn't exist
 	 * it will be created by Hash_Find.
 	 */
-	hashEntryPtr = Hash_Find(fileHashTable, (Address) fileIDPtr);
+	hashEntryPtr = Hash_Find(&partPtr->table, (Address) fileIDPtr);
     }
     if (hashEntryPtr->value == (Address) NIL) {
 	/*
@@ -460,24 +526,18 @@ again:
 	found = FALSE;
 	fs_Stats.handle.created++;
 	fs_Stats.handle.exists++;
+	partPtr->numHandles++;
 
 	hdrPtr->fileID = *fileIDPtr;
 	hdrPtr->flags = FS_HANDLE_INSTALLED;
 	hdrPtr->unlocked.waiting = FALSE;
 	hdrPtr->refCount = 1;
 	/*
-	 * Put the handle in the LRU list only if it has a scavenging
-	 * routine defined for it.  This allows us to avoid checking
-	 * un-reclaimable things.
+	 * The handle is referenced so it stays off the LRU list until
+	 * it is released.
 	 */
-	if (fsio_StreamOpTable[fileIDPtr->type].scavenge != (Boolean (*)())NIL) {
-	    List_InitElement(&hdrPtr->lruLinks);
-	    List_Insert(&hdrPtr->lruLinks, LIST_ATREAR(lruList));
-	    fs_Stats.handle.lruEntries++;
-	} else {
-	    hdrPtr->lruLinks.nextPtr = (List_Links *)NIL;
-	    hdrPtr->lruLinks.prevPtr = (List_Links *)NIL;
-	}
+	hdrPtr->lruLinks.nextPtr = (List_Links *)NIL;
+	hdrPtr->lruLinks.prevPtr = (List_Links *)NIL;
     } else {
 	hdrPtr = (Fs_HandleHeader *) Hash_GetValue(hashEntryPtr);
 	if (hdrPtr->flags & FS_HANDLE_LOCKED) {
@@ -492,7 +552,7 @@ again:
 	}
 	found = TRUE;
 	hdrPtr->refCount++;
-	MOVE_HANDLE(hdrPtr);
+	LRU_REMOVE(partPtr, hdrPtr);
 	*hdrPtrPtr = hdrPtr;
     }
     if (returnLocked) {
@@ -521,7 +581,7 @@ exit:
  *
  * Side effects:
  *	Locks the handle and increments its reference count.  The handle
- *	is also moved to the end of the LRU list.
+ *	is also taken off the LRU list.
  *
  *----------------------------------------------------------------------------
  *
@@ -532,6 +592,7 @@ Fsutil_HandleFetch(fileIDPtr)
 {
     Hash_Entry	*hashEntryPtr;
     Fs_HandleHeader	*hdrPtr;
+    register HandlePartition *partPtr = HANDLE_PARTITION(fileIDPtr);
 
     LOCK_MONITOR;
 
@@ -544,7 +605,7 @@ again:
      * handle table's size would have been exceeded by creating the handle.
      */
     hdrPtr = (Fs_HandleHeader *)NIL;
-    hashEntryPtr = Hash_LookOnly(fileHashTable, (Address) fileIDPtr);
+    hashEntryPtr = Hash_LookOnly(&partPtr->table, (Address) fileIDPtr);
     if (hashEntryPtr != (Hash_Entry *) NIL) {
 	hdrPtr = (Fs_HandleHeader *) Hash_GetValue(hashEntryPtr);
 	if (hdrPtr != (Fs_HandleHeader *)NIL) {
@@ -559,9 +620,9 @@ again:
 		(void) Sync_Wait(&hdrPtr->unlocked, FALSE);
 		goto again;
 	    }
-	    MOVE_HANDLE(hdrPtr);
 	    LOCK_HANDLE(hdrPtr);
 	    hdrPtr->refCount++;
+	    LRU_REMOVE(partPtr, hdrPtr);
 	}
     }
     UNLOCK_MONITOR;
@@ -581,7 +642,7 @@ again:
  *
  * Side effects:
  *	Locks the handle and increments its reference count.  The handle
- *	is also moved to the end of the LRU list.
+ *	is also taken off the LRU list.
  *
  *----------------------------------------------------------------------------
  *
@@ -593,6 +654,7 @@ Fsutil_HandleFetchNoWait(fileIDPtr, wouldWaitPtr)
 {
     Hash_Entry	*hashEntryPtr;
     Fs_HandleHeader	*hdrPtr;
+    register HandlePartition *partPtr = HANDLE_PARTITION(fileIDPtr);
 
     LOCK_MONITOR;
 
@@ -605,7 +667,7 @@ Fsutil_HandleFetchNoWait(fileIDPtr, wouldWaitPtr)
      */
     *wouldWaitPtr = FALSE;
     hdrPtr = (Fs_HandleHeader *)NIL;
-    hashEntryPtr = Hash_LookOnly(fileHashTable, (Address) fileIDPtr);
+    hashEntryPtr = Hash_LookOnly(&partPtr->table, (Address) fileIDPtr);
     if (hashEntryPtr != (Hash_Entry *) NIL) {
 	hdrPtr = (Fs_HandleHeader *) Hash_GetValue(hashEntryPtr);
 	if (hdrPtr != (Fs_HandleHeader *)NIL) {
@@ -615,9 +677,9 @@ Fsutil_HandleFetchNoWait(fileIDPtr, wouldWaitPtr)
 		UNLOCK_MONITOR;
 		return (Fs_HandleHeader *) NIL;
 	    }
-	    MOVE_HANDLE(hdrPtr);
 	    LOCK_HANDLE(hdrPtr);
 	    hdrPtr->refCount++;
+	    LRU_REMOVE(partPtr, hdrPtr);
 	}
     }
     UNLOCK_MONITOR;
@@ -645,6 +707,8 @@ ENTRY void
 Fsutil_HandleLockHdr(hdrPtr)
     register	Fs_HandleHeader	*hdrPtr;
 {
+    register HandlePartition *partPtr = HANDLE_PARTITION(&hdrPtr->fileID);
+
     LOCK_MONITOR;
 
     LOCK_HANDLE(hdrPtr);
@@ -664,7 +728,8 @@ Fsutil_HandleLockHdr(hdrPtr)
  *	None.
  *
  * Side effects:
- *	The reference count on the handle is incremented.
+ *	The reference count on the handle is incremented, which takes
+ *	the handle off the LRU list.
  *
  *----------------------------------------------------------------------------
  *
@@ -674,9 +739,14 @@ Fsutil_HandleIncRefCount(hdrPtr, amount)
     register	Fs_HandleHeader	*hdrPtr;
     int 			amount;
 {
+    register HandlePartition *partPtr = HANDLE_PARTITION(&hdrPtr->fileID);
+
     LOCK_MONITOR;
 
     hdrPtr->refCount += amount;
+    if (hdrPtr->refCount > 0) {
+	LRU_REMOVE(partPtr, hdrPtr);
+    }
 
     UNLOCK_MONITOR;
 }
@@ -695,7 +765,8 @@ Fsutil_HandleIncRefCount(hdrPtr, amount)
  *	None.
  *
  * Side effects:
- *	The reference count on the handle is decremented.
+ *	The reference count on the handle is decremented.  The handle
+ *	goes on the LRU list if this was its last reference.
  *
  *----------------------------------------------------------------------------
  *
@@ -704,9 +775,15 @@ ENTRY void
 Fsutil_HandleDecRefCount(hdrPtr)
     register	Fs_HandleHeader	*hdrPtr;
 {
+    register HandlePartition *partPtr = HANDLE_PARTITION(&hdrPtr->fileID);
+
     LOCK_MONITOR;
 
     hdrPtr->refCount--;
+    if ((hdrPtr->refCount == 0) &&
+	((hdrPtr->flags & FS_HANDLE_REMOVED) == 0)) {
+	LRU_INSERT(partPtr, hdrPtr);
+    }
 
     UNLOCK_MONITOR;
 }
@@ -734,11 +811,13 @@ ENTRY Fs_HandleHeader *
 Fsutil_HandleDup(hdrPtr)
     register	Fs_HandleHeader	*hdrPtr;
 {
+    register HandlePartition *partPtr = HANDLE_PARTITION(&hdrPtr->fileID);
+
     LOCK_MONITOR;
 
     LOCK_HANDLE(hdrPtr);
-    MOVE_HANDLE(hdrPtr);
     hdrPtr->refCount++;
+    LRU_REMOVE(partPtr, hdrPtr);
 
     UNLOCK_MONITOR;
     return(hdrPtr);
@@ -766,6 +845,8 @@ Fsutil_HandleValid(hdrPtr)
     register Fs_HandleHeader *hdrPtr;	/* Handle to check. */
 {
     register Boolean valid;
+    register HandlePartition *partPtr = HANDLE_PARTITION(&hdrPtr->fileID);
+
     LOCK_MONITOR;
     valid = ( (hdrPtr->flags & FS_HANDLE_INVALID) == 0 );
     UNLOCK_MONITOR;
@@ -794,6 +875,8 @@ ENTRY Boolean
 Fsutil_HandleUnlockHdr(hdrPtr)
     register	Fs_HandleHeader	*hdrPtr;
 {
+    register HandlePartition *partPtr = HANDLE_PARTITION(&hdrPtr->fileID);
+
     LOCK_MONITOR;
 
     if ((hdrPtr->flags & FS_HANDLE_LOCKED) == 0) {
@@ -822,7 +905,8 @@ Fsutil_HandleUnlockHdr(hdrPtr)
  *
  * Side effects:
  *	The reference count is decremented.  If the reference count goes
- *	to zero	and the handle has been removed then it gets nuked here.
+ *	to zero	and the handle has been removed then it gets nuked here,
+ *	otherwise it goes on the LRU list.
  *
  *----------------------------------------------------------------------------
  *
@@ -832,6 +916,8 @@ Fsutil_HandleReleaseHdr(hdrPtr, locked)
     register Fs_HandleHeader *hdrPtr;  /* Header of handle to release. */
     Boolean	      locked;	   /* TRUE if the handle is already locked. */
 {
+    register HandlePartition *partPtr = HANDLE_PARTITION(&hdrPtr->fileID);
+
     LOCK_MONITOR;
     fs_Stats.handle.release++;
 
@@ -857,8 +943,11 @@ Fsutil_HandleReleaseHdr(hdrPtr, locked)
 	 * The handle has been removed, and we are the last reference.
 	 */
 	fs_Stats.handle.limbo--;
-        REMOVE_HANDLE(hdrPtr);
+        REMOVE_HANDLE(partPtr, hdrPtr);
      } else {
+	if (hdrPtr->refCount == 0) {
+	    LRU_INSERT(partPtr, hdrPtr);
+	}
 	if (locked) {
 	    UNLOCK_HANDLE(hdrPtr);
 	}
@@ -891,9 +980,11 @@ Fsutil_HandleRemoveInt(hdrPtr)
     register Fs_HandleHeader *hdrPtr;  /* Header of handle to remove. */
 {
     register	Hash_Entry	*hashEntryPtr;
+    register HandlePartition	*partPtr = HANDLE_PARTITION(&hdrPtr->fileID);
 
     if (!(hdrPtr->flags & FS_HANDLE_INVALID)) {
-	hashEntryPtr = Hash_LookOnly(fileHashTable, (Address) &hdrPtr->fileID);
+	hashEntryPtr = Hash_LookOnly(&partPtr->table,
+				     (Address) &hdrPtr->fileID);
 	if (hashEntryPtr == (Hash_Entry *) NIL) {
 	    UNLOCK_MONITOR;
 	    panic("Fsutil_HandleRemoveInt: Couldn't find handle in hash table.\n");
@@ -901,9 +992,10 @@ Fsutil_HandleRemoveInt(hdrPtr)
 	    return;
 	}
 	Hash_SetValue(hashEntryPtr, NIL);
-	Hash_Delete(fileHashTable, hashEntryPtr);
+	Hash_Delete(&partPtr->table, hashEntryPtr);
     }
     fs_Stats.handle.exists--;
+    partPtr->numHandles--;
 
     /*
      * Wakeup anyone waiting for this handle to become unlocked.
@@ -918,8 +1010,9 @@ Fsutil_HandleRemoveInt(hdrPtr)
 	 */
 	fs_Stats.handle.limbo++;
 	hdrPtr->flags |= FS_HANDLE_REMOVED;
+	LRU_REMOVE(partPtr, hdrPtr);
     } else {
-	REMOVE_HANDLE(hdrPtr);
+	REMOVE_HANDLE(partPtr, hdrPtr);
     }
 }
 
@@ -949,6 +1042,8 @@ ENTRY void
 Fsutil_HandleRemoveHdr(hdrPtr)
     register Fs_HandleHeader *hdrPtr;	/* Handle to remove. */
 {
+    register HandlePartition *partPtr = HANDLE_PARTITION(&hdrPtr->fileID);
+
     LOCK_MONITOR;
     Fsutil_HandleRemoveInt(hdrPtr);
     UNLOCK_MONITOR;
@@ -982,6 +1077,7 @@ Fsutil_HandleAttemptRemove(hdrPtr)
 {
     register Fsio_FileIOHandle *handlePtr;	
     register Boolean removed;
+    register HandlePartition *partPtr = HANDLE_PARTITION(&hdrPtr->fileID);
 
     handlePtr = (Fsio_FileIOHandle *) hdrPtr;
     LOCK_MONITOR;
@@ -999,44 +1095,106 @@ Fsutil_HandleAttemptRemove(hdrPtr)
     return(removed);
 }
 
+/*
+ *----------------------------------------------------------------------------
+ *
+ * Fsutil_StartHandleSearch --
+ *
+ *	Initialize an iterator for Fsutil_GetNextHandle.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets up the search to start at the first partition.
+ *
+ *----------------------------------------------------------------------------
+ *
+ */
+
+void
+Fsutil_StartHandleSearch(searchPtr)
+    Fsutil_HandleSearch	*searchPtr;	/* Iterator to initialize. */
+{
+    searchPtr->partition = 0;
+    Hash_StartSearch(&searchPtr->hashSearch);
+}
+
 /*
  *----------------------------------------------------------------------------
  *
  * Fsutil_GetNextHandle --
  *
- *	Get the next handle in the hash table.  Return the handle locked.
- *	The hashSearchPtr is initialized with Hash_StartSearch.  This
+ *	Get the next handle in the handle table.  Return the handle locked.
+ *	The searchPtr is initialized with Fsutil_StartHandleSearch.  This
  *	always skips locked handles.  The users of this routine are:
  *	recovery stuff:  it is important not to block recovery as
  *		that ends up hanging the whole machine.
  *	unmounting a disk: this is a rare operation, but it should not
  *		be hung-up by a wedged handle.
- *	scavenging:  if a handle is locked, then it should not
- *		be scavenged anyway.
  *
  * Results:
- *	The next handle in the hash table.
+ *	The next handle in the handle table.
  *
  * Side effects:
  *	Locks the handle (but does not increment its reference count).
- *	This prints a warning if a handle is skipped when locked.
+ *	Advances the search to the next partition as each one runs out.
  *
  *----------------------------------------------------------------------------
  *
  */
 
-ENTRY Fs_HandleHeader *
-Fsutil_GetNextHandle(hashSearchPtr)
-    Hash_Search	*hashSearchPtr;	/* Iterator for going through the hash table. */
+Fs_HandleHeader *
+Fsutil_GetNextHandle(searchPtr)
+    Fsutil_HandleSearch	*searchPtr;	/* Iterator for going through the
+					 * handle table. */
+{
+    register 	Fs_HandleHeader	*hdrPtr;
+
+    while (searchPtr->partition < HANDLE_PARTITIONS) {
+	hdrPtr = GetNextPartitionHandle(&handleTable[searchPtr->partition],
+					&searchPtr->hashSearch);
+	if (hdrPtr != (Fs_HandleHeader *)NIL) {
+	    return(hdrPtr);
+	}
+	searchPtr->partition++;
+	Hash_StartSearch(&searchPtr->hashSearch);
+    }
+    return((Fs_HandleHeader *) NIL);
+}
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * GetNextPartitionHandle --
+ *
+ *	Get the next handle in the hash table of one partition for
+ *	Fsutil_GetNextHandle.  Return the handle locked.  Locked,
+ *	invalid and removed handles are skipped.
+ *
+ * Results:
+ *	The next handle in the partition, or NIL if there are no more.
+ *
+ * Side effects:
+ *	Locks the handle (but does not increment its reference count).
+ *
+ *----------------------------------------------------------------------------
+ *
+ */
+
+static ENTRY Fs_HandleHeader *
+GetNextPartitionHandle(partPtr, hashSearchPtr)
+    register HandlePartition *partPtr;	/* Partition being searched. */
+    Hash_Search	*hashSearchPtr;		/* Position in the partition. */
 {
     register 	Fs_HandleHeader	*hdrPtr;
     register	Hash_Entry	*hashEntryPtr;
 
     LOCK_MONITOR;
 
-    for (hashEntryPtr = Hash_Next(fileHashTable, hashSearchPtr);
+    for (hashEntryPtr = Hash_Next(&partPtr->table, hashSearchPtr);
          hashEntryPtr != (Hash_Entry *) NIL;  
-	 hashEntryPtr = Hash_Next(fileHashTable, hashSearchPtr)) {
+	 hashEntryPtr = Hash_Next(&partPtr->table, hashSearchPtr)) {
 	hdrPtr = (Fs_HandleHeader *) Hash_GetValue(hashEntryPtr);
 	if (hdrPtr == (Fs_HandleHeader *)NIL) {
 	    /*
@@ -1061,19 +1219,22 @@ Fsutil_GetNextHandle(hashSearchPtr)
     UNLOCK_MONITOR;
     return((Fs_HandleHeader *) NIL);
 }
-
+
 /*
  *----------------------------------------------------------------------------
  *
  * GetNextLRUHandle --
  *
- *	Get the next handle in the LRU list.  Return the handle locked.
- *	This skips locked handles because they are obviously in use and not good
- *	candidates for removal.  This also prevents a single locked handle
- *	from clogging up the system.
+ *	Get the next handle from the old end of a partition's LRU list.
+ *	Return the handle locked.  Each handle looked at is moved to the
+ *	young end of the list in case it is not replaced, so a scan stops
+ *	once it has looked at as many handles as are on the list.
+ *	This skips locked handles because they are obviously in use and not
+ *	good candidates for removal.  This also prevents a single locked
+ *	handle from clogging up the system.
  *
  * Results:
- *	The next handle in the LRU list.
+ *	The next handle in the LRU list, or NIL if the scan is over.
  *
  * Side effects:
  *	Increments the number of handles checked in this LRU scan so
@@ -1082,45 +1243,31 @@ Fsutil_GetNextHandle(hashSearchPtr)
  *----------------------------------------------------------------------------
  *
  */
-ENTRY Fs_HandleHeader *
-GetNextLRUHandle()
+static ENTRY Fs_HandleHeader *
+GetNextLRUHandle(partPtr, checkedPtr)
+    register HandlePartition *partPtr;	/* Partition to scan. */
+    int			*checkedPtr;	/* Handles checked so far in this
+					 * scan.  Zero to start a scan. */
 {
     register 	Fs_HandleHeader	*hdrPtr;
     register	List_Links	*listPtr;
 
     LOCK_MONITOR;
-    if (lruHandlesChecked >= fs_Stats.handle.maxNumber) {
-	hdrPtr = (Fs_HandleHeader *)NIL;
-	goto exit;
-    }
-    /*
-     * Get the candidate handle and move it to the young end of
-     * the list in case it is not replaced.
-     */
-    listPtr = List_First(lruList);
-    hdrPtr = LRU_LINKS_TO_HANDLE(listPtr);
-    MOVE_HANDLE(hdrPtr);
-    lruHandlesChecked++;
-    /*
-     * Now skip over locked and removed handles, moving them to the "young" end.
-     */
-    while (hdrPtr->flags & (FS_HANDLE_REMOVED|FS_HANDLE_LOCKED)) {
-	if (lruHandlesChecked >= fs_Stats.handle.maxNumber) {
-	    hdrPtr = (Fs_HandleHeader *)NIL;
-	    goto exit;
-	} else {
-	    listPtr = List_First(lruList);
-	    hdrPtr = LRU_LINKS_TO_HANDLE(listPtr);
-	    MOVE_HANDLE(hdrPtr);
+    while (*checkedPtr < partPtr->lruEntries) {
+	listPtr = List_First(&partPtr->lruList);
+	List_Move(listPtr, LIST_ATREAR(&partPtr->lruList));
+	(*checkedPtr)++;
+	hdrPtr = LRU_LINKS_TO_HANDLE(listPtr);
+	if ((hdrPtr->flags & FS_HANDLE_LOCKED) == 0) {
+	    LOCK_HANDLE(hdrPtr);
+	    UNLOCK_MONITOR;
+	    return(hdrPtr);
 	}
-	lruHandlesChecked++;
     }
-    LOCK_HANDLE(hdrPtr);
-exit:
     UNLOCK_MONITOR;
-    return(hdrPtr);
+    return((Fs_HandleHeader *)NIL);
 }
-
+
 /*
  *----------------------------------------------------------------------------
  *
@@ -1138,24 +1285,108 @@ exit:
  *----------------------------------------------------------------------------
  *
  */
-ENTRY void
-DoneLRU(numScavenged)
-    int numScavenged;		/* Number of handles replaced */
+static ENTRY void
+DoneLRU(partPtr, numScavenged)
+    register HandlePartition *partPtr;	/* Partition that was scanned. */
+    int numScavenged;			/* Number of handles replaced */
 {
     LOCK_MONITOR;
     if (numScavenged == 0) {
 	/*
 	 * Grow the table a bit because no handles could be reclaimed.
 	 */
-	fs_Stats.handle.maxNumber += handleLimitInc;
-	handleLimitInc = LIMIT_INC(fs_Stats.handle.maxNumber);
-	handleScavengeThreashold = THREASHOLD(fs_Stats.handle.maxNumber);
+	GrowHandleLimit();
     }
-    lruInProgress = FALSE;
-    Sync_Broadcast(&lruDone);
+    partPtr->lruInProgress = FALSE;
+    Sync_Broadcast(&partPtr->lruDone);
     UNLOCK_MONITOR;
 }
-
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * GrowHandleLimit --
+ *
+ *	Raise the soft limit on the number of handles.  This is called
+ *	with a partition lock held; handleLimitLock is always taken after
+ *	a partition lock, never before one.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Increases fs_Stats.handle.maxNumber and recomputes handleLimitInc
+ *	and handleScavengeThreashold.
+ *
+ *----------------------------------------------------------------------------
+ *
+ */
+#undef	LOCKPTR
+#define	LOCKPTR	(&handleLimitLock)
+static ENTRY void
+GrowHandleLimit()
+{
+    LOCK_MONITOR;
+    fs_Stats.handle.maxNumber += handleLimitInc;
+    handleLimitInc = LIMIT_INC(fs_Stats.handle.maxNumber);
+    handleScavengeThreashold = THREASHOLD(fs_Stats.handle.maxNumber);
+    UNLOCK_MONITOR;
+}
+#undef	LOCKPTR
+#define	LOCKPTR	(&partPtr->lock)
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * Fsutil_HandleReclaim --
+ *
+ *	Reclaim unreferenced handles for the scavenger.  This works
+ *	through the partitions in turn, offering each handle on a
+ *	partition's LRU list to the scavenging routine for its type.
+ *	It stops when the time budget runs out, and the next call picks
+ *	up with the partition it stopped in, so no single call holds
+ *	things up for long no matter how large the table is.
+ *
+ * Results:
+ *	TRUE if every partition was scanned before the budget ran out.
+ *
+ * Side effects:
+ *	The scavenging routines may remove handles.
+ *
+ *----------------------------------------------------------------------------
+ *
+ */
+Boolean
+Fsutil_HandleReclaim(budget)
+    unsigned int	budget;		/* Time this call may take, as a
+					 * timer interval. */
+{
+    register HandlePartition	*partPtr;
+    register Fs_HandleHeader	*hdrPtr;
+    Timer_Ticks			now;
+    Timer_Ticks			deadline;
+    int				numChecked;
+    int				numScanned;
+
+    Timer_GetCurrentTicks(&now);
+    Timer_AddIntervalToTicks(now, budget, &deadline);
+    for (numScanned = 0; numScanned < HANDLE_PARTITIONS; numScanned++) {
+	partPtr = &handleTable[reclaimPartition];
+	numChecked = 0;
+	for (hdrPtr = GetNextLRUHandle(partPtr, &numChecked);
+	     hdrPtr != (Fs_HandleHeader *)NIL;
+	     hdrPtr = GetNextLRUHandle(partPtr, &numChecked)) {
+	    (void)(*fsio_StreamOpTable[hdrPtr->fileID.type].scavenge)(hdrPtr);
+	    Timer_GetCurrentTicks(&now);
+	    if (Timer_TickGE(now, deadline)) {
+		return(FALSE);
+	    }
+	}
+	reclaimPartition = (reclaimPartition + 1) & (HANDLE_PARTITIONS - 1);
+    }
+    return(TRUE);
+}
+
 /*
  *----------------------------------------------------------------------------
  *
@@ -1179,6 +1410,7 @@ Fsutil_HandleInvalidate(hdrPtr)
     Fs_HandleHeader *hdrPtr;
 {
     Hash_Entry	*hashEntryPtr;
+    register HandlePartition *partPtr = HANDLE_PARTITION(&hdrPtr->fileID);
 
     LOCK_MONITOR;
 
@@ -1189,7 +1421,8 @@ Fsutil_HandleInvalidate(hdrPtr)
 	 * smashed so that all subsequent operations using this handle that
 	 * go to the server will fail with a stale handle return code.
 	 */
-	hashEntryPtr = Hash_LookOnly(fileHashTable, (Address) &hdrPtr->fileID);
+	hashEntryPtr = Hash_LookOnly(&partPtr->table,
+				     (Address) &hdrPtr->fileID);
 	if (hashEntryPtr == (Hash_Entry *) NIL) {
 	    UNLOCK_MONITOR;
 	    panic("Fsutil_HandleInvalidate: Can't find %s handle <%d,%d,%d>\n",
@@ -1199,7 +1432,7 @@ Fsutil_HandleInvalidate(hdrPtr)
 	    return;
 	}
 	Hash_SetValue(hashEntryPtr, NIL);
-	Hash_Delete(fileHashTable, hashEntryPtr);
+	Hash_Delete(&partPtr->table, hashEntryPtr);
 	hdrPtr->fileID.minor = -hdrPtr->fileID.minor;
 	if (hdrPtr->name != (char *) NIL) {
 	    free(hdrPtr->name);
@@ -1210,7 +1443,7 @@ Fsutil_HandleInvalidate(hdrPtr)
     UNLOCK_MONITOR;
 }
 
-
+
 /*
  *----------------------------------------------------------------------------
  *
@@ -1229,10 +1462,49 @@ Fsutil_HandleInvalidate(hdrPtr)
  *
  */
 
-ENTRY int
+int
 Fsutil_HandleDescWriteBack(shutdown, domain)
     Boolean	shutdown;	/* TRUE if the kernel is being shutdowned. */
     int		domain;		/* Domain number, -1 means all local domains */
+{
+    register HandlePartition	*partPtr;
+    int				lockedDesc = 0;
+
+    for (partPtr = handleTable; partPtr < &handleTable[HANDLE_PARTITIONS];
+	 partPtr++) {
+	lockedDesc += DescWriteBackInt(partPtr, domain);
+    }
+
+    if (shutdown & lockedDesc) {
+	printf("Fsutil_HandleDescWriteBack: %d descriptors still locked\n",
+		    lockedDesc);
+    }
+
+    return(lockedDesc);
+}
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * DescWriteBackInt --
+ *
+ *	Write back the dirty descriptors of the handles in one partition
+ *	for Fsutil_HandleDescWriteBack.
+ *
+ * Results:
+ *	The number of locked file handles in the partition.
+ *
+ * Side effects:
+ *	The write backs.
+ *
+ *----------------------------------------------------------------------------
+ *
+ */
+
+static ENTRY int
+DescWriteBackInt(partPtr, domain)
+    register HandlePartition *partPtr;	/* Partition to write back. */
+    int		domain;		/* Domain number, -1 means all domains */
 {
     Hash_Search			hashSearch;
     register Fsio_FileIOHandle *handlePtr;
@@ -1244,9 +1516,9 @@ Fsutil_HandleDescWriteBack(shutdown, domain)
 
     Hash_StartSearch(&hashSearch);
 
-    for (hashEntryPtr = Hash_Next(fileHashTable, &hashSearch);
+    for (hashEntryPtr = Hash_Next(&partPtr->table, &hashSearch);
          hashEntryPtr != (Hash_Entry *) NIL;  
-	 hashEntryPtr = Hash_Next(fileHashTable, &hashSearch)) {
+	 hashEntryPtr = Hash_Next(&partPtr->table, &hashSearch)) {
 	hdrPtr = (Fs_HandleHeader *) Hash_GetValue(hashEntryPtr);
 	if (hdrPtr == (Fs_HandleHeader *)NIL) {
 	    /*
@@ -1274,24 +1546,21 @@ Fsutil_HandleDescWriteBack(shutdown, domain)
 	(void)Fsdm_FileDescWriteBack(handlePtr, FALSE);
     }
 
-    if (shutdown & lockedDesc) {
-	printf("Fsutil_HandleDescWriteBack: %d descriptors still locked\n",
-		    lockedDesc);
-    }
-
     UNLOCK_MONITOR;
 
     return(lockedDesc);
 }
 
-
+
 /*
  *----------------------------------------------------------------------
  *
  * Fsutil_ZeroHandleStats --
  *
  *	Zero the FS handle-related stats, while preserving state 
- *	information.
+ *	information.  The counts of handles and LRU entries are
+ *	recomputed from the partitions.  handleLimitLock is held so
+ *	that a concurrent growth of the table limit isn't lost.
  *
  * Results:
  *	None.
@@ -1301,20 +1570,25 @@ Fsutil_HandleDescWriteBack(shutdown, domain)
  *
  *----------------------------------------------------------------------
  */
-
+#undef	LOCKPTR
+#define	LOCKPTR	(&handleLimitLock)
 ENTRY void
 Fsutil_ZeroHandleStats()
 {
+    register HandlePartition *partPtr;
     unsigned int maxNumber;	/* state variables to preserve */
-    unsigned int exists;
-    unsigned int lruEntries;
+    unsigned int exists = 0;
+    unsigned int lruEntries = 0;
     unsigned int limbo;
 
     LOCK_MONITOR;
     maxNumber = fs_Stats.handle.maxNumber;
-    exists = fs_Stats.handle.exists;
-    lruEntries = fs_Stats.handle.lruEntries;
     limbo = fs_Stats.handle.limbo;
+    for (partPtr = handleTable; partPtr < &handleTable[HANDLE_PARTITIONS];
+	 partPtr++) {
+	exists += partPtr->numHandles;
+	lruEntries += partPtr->lruEntries;
+    }
 
     bzero(&fs_Stats.handle, sizeof(fs_Stats.handle));
 
@@ -1324,3 +1598,5 @@ Fsutil_ZeroHandleStats()
     fs_Stats.handle.limbo = limbo;
     UNLOCK_MONITOR;
 }
+#undef	LOCKPTR
+#define	LOCKPTR	(&partPtr->lock)
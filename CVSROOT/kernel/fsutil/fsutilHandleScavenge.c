@@ -80,6 +80,7 @@ Fsutil_HandleScavengeStub(data)
 
 Boolean		scavengerScheduled = FALSE;
 int		fsScavengeInterval = 2;			/* 2 Minutes */
+int		fsScavengeBudget = 10;			/* 10 Milliseconds */
 int		fsLastScavengeTime = 0;
 
 
@@ -88,10 +89,12 @@ int		fsLastScavengeTime = 0;
  *
  * Fsutil_HandleScavenge --
  *
- *	Go through all of the handles looking for clients that have crashed
- *	and for handles that are no longer needed.  This expects to be
- *	called by a helper kernel processes at regular intervals defined
- *	by fsScavengeInterval.
+ *	Reclaim handles that are no longer needed.  Each call spends at
+ *	most fsScavengeBudget milliseconds working through the LRU lists
+ *	of unreferenced handles.  This expects to be called by a helper
+ *	kernel processes at regular intervals defined by fsScavengeInterval.
+ *	If a pass over the handles does not fit in the budget then the
+ *	background scavenger comes back in a second to continue it.
  *
  * Results:
  *	None.
@@ -109,8 +112,7 @@ Fsutil_HandleScavenge(data, callInfoPtr)
 						 */
     Proc_CallInfo	*callInfoPtr;		/* Specifies interval */
 {
-    Hash_Search				hashSearch;
-    register	Fs_HandleHeader		*hdrPtr;
+    Boolean				done;
 
     /*
      * Note that this is unsynchronized access to a global variable, which
@@ -119,17 +121,8 @@ Fsutil_HandleScavenge(data, callInfoPtr)
      */
     fsLastScavengeTime = Fsutil_TimeInSeconds();
 
-    Hash_StartSearch(&hashSearch);
-    for (hdrPtr = Fsutil_GetNextHandle(&hashSearch);
-	 hdrPtr != (Fs_HandleHeader *) NIL;
-         hdrPtr = Fsutil_GetNextHandle(&hashSearch)) {
-	 if (fsio_StreamOpTable[hdrPtr->fileID.type].scavenge !=
-		 (Boolean (*)())NIL) {
-	     (*fsio_StreamOpTable[hdrPtr->fileID.type].scavenge)(hdrPtr);
-	 } else {
-	     Fsutil_HandleUnlock(hdrPtr);
-	 }
-    }
+    done = Fsutil_HandleReclaim((unsigned int)fsScavengeBudget *
+				timer_IntOneMillisecond);
     /*
      * We are called in two cases.  A regular call background call is indicated
      * by a TRUE data value, while an extra scavenge that is done in an
@@ -139,7 +132,11 @@ Fsutil_HandleScavenge(data, callInfoPtr)
 	/*
 	 * Set up next background call.
 	 */
-	callInfoPtr->interval = fsScavengeInterval * timer_IntOneMinute;
+	if (done) {
+	    callInfoPtr->interval = fsScavengeInterval * timer_IntOneMinute;
+	} else {
+	    callInfoPtr->interval = timer_IntOneSecond;
+	}
     } else {
 	/*
 	 * Indicate that the extra scavenger has completed.
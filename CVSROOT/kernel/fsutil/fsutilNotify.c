@@ -26,6 +26,7 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include <sync.h>
 #include <rpc.h>
 #include <net.h>
+#include <fsioEvent.h>
 
 #include <stdio.h>
 
@@ -78,6 +79,7 @@ Fsutil_WaitListInsert(list, waitPtr)
     myWaitPtr = (Sync_RemoteWaiter *) malloc(sizeof(Sync_RemoteWaiter));
     *myWaitPtr = *waitPtr;
     List_Insert((List_Links *)myWaitPtr, LIST_ATREAR(list));
+    Fsio_EventArmed(waitPtr, list);
 
     UNLOCK_MONITOR;
 }
@@ -130,6 +132,7 @@ Fsutil_FastWaitListInsert(list, waitPtr)
     myWaitPtr = (Sync_RemoteWaiter *) malloc(sizeof(Sync_RemoteWaiter));
     *myWaitPtr = *waitPtr;
     List_Insert((List_Links *)myWaitPtr, LIST_ATREAR(list));
+    Fsio_EventArmed(waitPtr, list);
 }
 
 /*
@@ -170,9 +173,10 @@ Fsutil_WaitListNotify(list)
 	    } else {
 		(void)Sync_RemoteNotify(waitPtr);
 	    }
-	} else {
+	} else if (!Fsio_EventNotify(waitPtr->pid, waitPtr->waitToken)) {
 	    /*
-	     * Mark the local process as runable.
+	     * Mark the local process as runable, unless the waiter was
+	     * the interest of an event set.
 	     */
 	    Sync_ProcWakeup(waitPtr->pid, waitPtr->waitToken);
 	}
@@ -209,22 +213,50 @@ Fsutil_FastWaitListNotify(list)
 
     while ( ! List_IsEmpty(list)) {
 	waitPtr = (Sync_RemoteWaiter *)List_First(list);
-	if (waitPtr->hostID != rpc_SpriteID) {
-	    /*
-	     * Contact the remote host and get it to notify the waiter.
-	     */
-	    (void)Sync_RemoteNotify(waitPtr);
-	} else {
-	    /*
-	     * Mark the local process as runable.
-	     */
-	    Sync_ProcWakeup(waitPtr->pid, waitPtr->waitToken);
-	}
+	Fsutil_NotifyWaiter(waitPtr);
 	List_Remove((List_Links *)waitPtr);
 	free((Address)waitPtr);
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Fsutil_NotifyWaiter --
+ *
+ *      Notify a single waiting process.  This is used by callers that
+ *	keep their own waiters and wake only those whose condition has
+ *	changed, instead of the whole list.  Synchronization is up to
+ *	the caller, as with Fsutil_FastWaitListNotify.
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *      This results in a call to Sync_ProcWakeup on the host of the
+ *      waiting process.  The waiter is not removed from any list.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ENTRY void
+Fsutil_NotifyWaiter(waitPtr)
+    register Sync_RemoteWaiter *waitPtr;	/* Process to notify */
+{
+    if (waitPtr->hostID != rpc_SpriteID) {
+	/*
+	 * Contact the remote host and get it to notify the waiter.
+	 */
+	(void)Sync_RemoteNotify(waitPtr);
+    } else if (!Fsio_EventNotify(waitPtr->pid, waitPtr->waitToken)) {
+	/*
+	 * Mark the local process as runable, unless the waiter was
+	 * the interest of an event set.
+	 */
+	Sync_ProcWakeup(waitPtr->pid, waitPtr->waitToken);
+    }
+}
+
 
 /*
  *----------------------------------------------------------------------
@@ -223,7 +223,7 @@ static void
 ReopenHandles(serverID)
     int		serverID;	/* The to re-establish contact with. */
 {
-    Hash_Search			hashSearch;
+    Fsutil_HandleSearch		handleSearch;
     register	Fs_HandleHeader	*hdrPtr;
     register	Fs_Stream	*streamPtr;
     register	Fsrmt_IOHandle *rmtHandlePtr;
@@ -248,10 +248,10 @@ doSingleRpcsInstead:
 	printf("Server %d couldn't do bulk reopen - starting again.\n",
 		serverID);
     }
-    Hash_StartSearch(&hashSearch);
-    for (hdrPtr = Fsutil_GetNextHandle(&hashSearch);
+    Fsutil_StartHandleSearch(&handleSearch);
+    for (hdrPtr = Fsutil_GetNextHandle(&handleSearch);
 	 hdrPtr != (Fs_HandleHeader *) NIL;
-         hdrPtr = Fsutil_GetNextHandle(&hashSearch)) {
+         hdrPtr = Fsutil_GetNextHandle(&handleSearch)) {
 	 if ((hdrPtr->fileID.type != FSIO_STREAM) &&
 		 (hdrPtr->fileID.serverID == serverID)) {
 	    if (!RemoteHandle(hdrPtr)) {
@@ -339,10 +339,10 @@ doSingleRpcsInstead:
     if (doBulkRpc && recov_BulkHandles && serverID == 53) {
 	InitReopenHandles();
     }
-    Hash_StartSearch(&hashSearch);
-    for (hdrPtr = Fsutil_GetNextHandle(&hashSearch);
+    Fsutil_StartHandleSearch(&handleSearch);
+    for (hdrPtr = Fsutil_GetNextHandle(&handleSearch);
 	 hdrPtr != (Fs_HandleHeader *) NIL;
-         hdrPtr = Fsutil_GetNextHandle(&hashSearch)) {
+         hdrPtr = Fsutil_GetNextHandle(&handleSearch)) {
 	checkStatus = FAILURE;
 	if ((hdrPtr->fileID.type == FSIO_STREAM) &&
 		 (hdrPtr->fileID.serverID == serverID)) {
@@ -401,14 +401,30 @@ doSingleRpcsInstead:
 	    goto reopenReturn;
 	}
     }
+    /*
+     * Reassert the byte-range locks held through files on the server.
+     * This has to wait for the streams, which the server uses to find
+     * the file and to clean up the locks on close.
+     */
+    Fsutil_StartHandleSearch(&handleSearch);
+    for (hdrPtr = Fsutil_GetNextHandle(&handleSearch);
+	 hdrPtr != (Fs_HandleHeader *) NIL;
+         hdrPtr = Fsutil_GetNextHandle(&handleSearch)) {
+	if ((hdrPtr->fileID.type == FSIO_RMT_FILE_STREAM) &&
+	    (hdrPtr->fileID.serverID == serverID) &&
+	    !RecoveryFailed(&((Fsrmt_IOHandle *)hdrPtr)->recovery)) {
+	    Fsrmt_FileLockReopen(hdrPtr);
+	}
+	Fsutil_HandleUnlock(hdrPtr);
+    }
     /*
      * Now we notify processes waiting on I/O handles, and invalidate
      * those I/O handles which failed recovery.
      */
-    Hash_StartSearch(&hashSearch);
-    for (hdrPtr = Fsutil_GetNextHandle(&hashSearch);
+    Fsutil_StartHandleSearch(&handleSearch);
+    for (hdrPtr = Fsutil_GetNextHandle(&handleSearch);
 	 hdrPtr != (Fs_HandleHeader *) NIL;
-         hdrPtr = Fsutil_GetNextHandle(&hashSearch)) {
+         hdrPtr = Fsutil_GetNextHandle(&handleSearch)) {
 	 if (!RemoteHandle(hdrPtr)) {
 	     Fsutil_HandleUnlock(hdrPtr);
 	 } else {
@@ -996,13 +1012,13 @@ void
 Fsutil_RemoveClient(clientID)
     int		clientID;	/* The client to remove the files for. */
 {
-    Hash_Search			hashSearch;
+    Fsutil_HandleSearch		handleSearch;
     register	Fs_HandleHeader	*hdrPtr;
 
-    Hash_StartSearch(&hashSearch);
-    for (hdrPtr = Fsutil_GetNextHandle(&hashSearch);
+    Fsutil_StartHandleSearch(&handleSearch);
+    for (hdrPtr = Fsutil_GetNextHandle(&handleSearch);
 	 hdrPtr != (Fs_HandleHeader *) NIL;
-         hdrPtr = Fsutil_GetNextHandle(&hashSearch)) {
+         hdrPtr = Fsutil_GetNextHandle(&handleSearch)) {
 	(*fsio_StreamOpTable[hdrPtr->fileID.type].clientKill)(hdrPtr, clientID);
     }
 }
@@ -1164,7 +1180,7 @@ Fsutil_FsRecovInfo(length, resultPtr, lengthNeededPtr)
     Fsutil_FsRecovNamedStats	*resultPtr;	/* data buffer */
     int				*lengthNeededPtr;
 {
-    Hash_Search			hashSearch;
+    Fsutil_HandleSearch		handleSearch;
     Fs_HandleHeader		*hdrPtr;
     Fsutil_FsRecovNamedStats	*infoPtr;
     int				numNeeded;
@@ -1179,10 +1195,10 @@ Fsutil_FsRecovInfo(length, resultPtr, lengthNeededPtr)
 
     infoPtr = (Fsutil_FsRecovNamedStats *) resultPtr;
 
-    Hash_StartSearch(&hashSearch);
-    for (hdrPtr = Fsutil_GetNextHandle(&hashSearch);
+    Fsutil_StartHandleSearch(&handleSearch);
+    for (hdrPtr = Fsutil_GetNextHandle(&handleSearch);
 	 hdrPtr != (Fs_HandleHeader *) NIL;
-         hdrPtr = Fsutil_GetNextHandle(&hashSearch)) {
+         hdrPtr = Fsutil_GetNextHandle(&handleSearch)) {
 
 	numNeeded++;
 	if (numNeeded > numAvail) {
@@ -1259,14 +1275,14 @@ int
 Fsutil_TestForHandles(serverID)
     int		serverID;	/* Server we're interested in. */
 {
-    Hash_Search			hashSearch;
+    Fsutil_HandleSearch		handleSearch;
     register	Fs_HandleHeader	*hdrPtr;
     int				count = 0;
 
-    Hash_StartSearch(&hashSearch);
-    for (hdrPtr = Fsutil_GetNextHandle(&hashSearch);
+    Fsutil_StartHandleSearch(&handleSearch);
+    for (hdrPtr = Fsutil_GetNextHandle(&handleSearch);
 	 hdrPtr != (Fs_HandleHeader *) NIL;
-         hdrPtr = Fsutil_GetNextHandle(&hashSearch)) {
+         hdrPtr = Fsutil_GetNextHandle(&handleSearch)) {
 	 if (hdrPtr->fileID.serverID == serverID) {
 	    switch(hdrPtr->fileID.type) {
 /*
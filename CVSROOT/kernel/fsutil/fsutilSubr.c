@@ -255,6 +255,9 @@ Fsutil_FileTypeToString(type)
 	case FSIO_RMT_PFS_STREAM:
 	    fileType = "RmtPfs";
 	    break;
+	case FSIO_EVENT_STREAM:
+	    fileType = "EventSet";
+	    break;
 #ifdef INET
 	case FSIO_RAW_IP_STREAM:
 	    fileType = "RawIp Socket";
@@ -386,6 +386,19 @@ Proc_Migrate(pid, hostID)
 	return(GEN_NO_PERMISSION);
     }
 	
+    /*
+     * Write out the process's modified pages while it is still running,
+     * so that less has to be written once it is frozen.  The process is
+     * unlocked while this happens, so make sure it is still around.
+     */
+    (void) Vm_MigratePreCopy(procPtr);
+    if ((procPtr->state == PROC_DEAD) || (procPtr->state == PROC_EXITING) ||
+	(procPtr->genFlags & PROC_DYING) ||
+	!Proc_ComparePIDs(procPtr->processID, pid)) {
+	Proc_Unlock(procPtr);
+	return(PROC_INVALID_PID);
+    }
+
 #ifndef CLEAN
     if (proc_DoTrace && proc_MigDebugLevel > 0) {
 	record.processID = procPtr->processID;
@@ -616,7 +629,6 @@ Proc_MigrateTrap(procPtr)
 	bufPtr += infoPtr->size;
 	infoPtr->processed = 1;
     }
-
     Proc_Unlock(procPtr);
     /*
      * Send the encapsulated data in the buffer to the other host.  
@@ -631,6 +643,9 @@ Proc_MigrateTrap(procPtr)
 	inBuf.ptr = buffer;
 	if (proc_MigDoStats) {
 	    Proc_MigAddToCounter((bufSize + 1023) / 1024, &proc_MigStats.varStats.rpcKbytes, &proc_MigStats.squared.rpcKbytes);
+	    Proc_MigAddToCounter((bufSize + 1023) / 1024,
+				 &proc_MigStats.varStats.kbytesTransferred,
+				 &proc_MigStats.squared.kbytesTransferred);
 	}
 
 	if (proc_MigDebugLevel > 5) {
@@ -713,6 +728,16 @@ Proc_MigrateTrap(procPtr)
 	goto failure;
     }
 
+    /*
+     * The process was frozen from the time it trapped until now.
+     */
+    if (proc_MigDoStats && whenNeeded == MIG_ENCAP_MIGRATE) {
+	Timer_GetTimeOfDay(&endTime, (int *) NIL, (Boolean *) NIL);
+	Time_Subtract(endTime, startTime, &timeDiff);
+	AddMigrateTime(timeDiff, &proc_MigStats.varStats.freezeTime,
+		       &proc_MigStats.squared.freezeTime);
+    }
+
     /*
      * If not migrating back home, note the dependency on the other host.
      * Otherwise, forget the dependency after eviction.
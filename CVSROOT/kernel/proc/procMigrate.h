@@ -168,7 +168,7 @@ typedef struct {
  * need be.  It's copied into a structure at initialization time.
  */
 #ifndef PROC_MIG_STATS_VERSION
-#define PROC_MIG_STATS_VERSION 1002
+#define PROC_MIG_STATS_VERSION 1003
 #endif /* PROC_MIG_STATS_VERSION */
 
 /*
@@ -204,6 +204,17 @@ typedef struct {
     unsigned int 	evictionCPUTime;/* Cumulative time used by all
 					   processes subsequent to first
 					   eviction. */
+    unsigned int	preCopyPages;	/* Number of pages written before
+					   the process was frozen. */
+    unsigned int 	freezeTime;	/* Cumulative time exported processes
+					   were frozen, from trapping to
+					   being resumed on the other host. */
+    unsigned int	kbytesTransferred;
+					/* Total number of Kbytes of
+					   encapsulated state sent to the
+					   other host per migration.  Pages
+					   written to swap are not
+					   counted. */
 } Proc_MigVarStats;
 
 typedef struct {
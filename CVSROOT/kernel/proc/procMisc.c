@@ -1684,7 +1684,7 @@ typedef struct LockEntry {
 } LockEntry;
 
 extern Sync_Condition cleanBlockCondition, writeBackComplete,
-    closeCondition, lruDone, debugListCondition, familyCondition,
+    closeCondition, debugListCondition, familyCondition,
     migrateCondition, evictCondition, recovCondition, recovPingCondition,
     rpcDaemon, freeChannels, signalCondition, codeSegCondition,
     cleanCondition, swapDownCondition, mappingCondition, swapFileCondition;
@@ -1693,7 +1693,6 @@ LockEntry locks[] = {
     (int)&cleanBlockCondition, "cleanBlockCondition",
     (int)&writeBackComplete, "writeBackComplete",
     (int)&closeCondition, "closeCondition",
-    (int)&lruDone, "lruDone",
     (int)&debugListCondition, "debugListCondition",
     (int)&familyCondition, "familyCondition",
     (int)&migrateCondition, "migrateCondition",
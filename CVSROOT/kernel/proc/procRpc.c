@@ -228,6 +228,8 @@ static CallBack callBackVector[] = {
     { RSNIL /* Not migrated */,		RSNIL }, /* SYS_ZEBRA_CMD 110 */
     { Sys_GetHostName,			RSNIL }, /* SYS_GET_HOSTNAME 111 */
     { Sys_SetHostName,			RSNIL }, /* SYS_SET_HOSTNAME 112 */
+    { RSNIL /* Not migrated */,		RSNIL }, /* FS_CREATE_EVENT_SET 113 */
+    { RSNIL /* Not migrated */,		RSNIL }, /* FS_SPLICE 114 */
 
 };
 
@@ -15,7 +15,18 @@
 static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #endif /* not lint */
 
+#include "sprite.h"
 #include "machparam.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "timer.h"
+#include "devRaidProto.h"
+
+static void XorWords2 _ARGS_((register int numWords, int **sourceArray,
+	register int *dPtr));
+static void XorWordsN _ARGS_((register int numWords, int numSources,
+	int **sourceArray, register int *dPtr));
+static int KBytesPerSecond _ARGS_((int kbytes, int msec));
 
 
 /*
@@ -158,3 +169,317 @@ Xor2(numBytes, sourcePtr, destPtr)
     }
 }
 
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * XorN --
+ *
+ *	*destBuf ^= *srcBuf[0] ^ *srcBuf[1] ^ ... ^ *srcBuf[numSources-1];
+ *
+ *	The sources are all XORed into the destination in a single pass,
+ *	so the destination is only read and written once no matter how
+ *	many sources there are.  The kernel used depends on the number of
+ *	sources and on the alignment of the buffers: unaligned buffers
+ *	and a single source go to Xor2, two sources have their own loop,
+ *	and anything else uses the general loop.  The sources must not
+ *	overlap the destination.
+ *
+ * Results:
+ *      *destBuf.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+XorN(numBytes, numSources, sourceArray, destPtr)
+    register int numBytes;	/* The number of bytes in each buffer */
+    int numSources;		/* The number of source buffers */
+    char **sourceArray;		/* The source buffers */
+    char *destPtr;		/* The buffer to XOR into */
+{
+    register int i;
+    register int align;
+    int numWords;
+
+    if (numSources <= 0 || numBytes <= 0) {
+	return;
+    }
+    align = (int) destPtr;
+    for (i = 0; i < numSources; i++) {
+	align |= (int) sourceArray[i];
+    }
+    if (numSources == 1 || (align & WORDMASK)) {
+	for (i = 0; i < numSources; i++) {
+	    Xor2(numBytes, sourceArray[i], destPtr);
+	}
+	return;
+    }
+    numWords = numBytes / sizeof(int);
+    if (numSources == 2) {
+	XorWords2(numWords, (int **) sourceArray, (int *) destPtr);
+    } else {
+	XorWordsN(numWords, numSources, (int **) sourceArray, (int *) destPtr);
+    }
+    /*
+     * XOR the remaining bytes.
+     */
+    i = numWords * sizeof(int);
+    while (i < numBytes) {
+	register int k;
+	for (k = 0; k < numSources; k++) {
+	    destPtr[i] ^= sourceArray[k][i];
+	}
+	i++;
+    }
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * XorWords2 --
+ *
+ *	*dPtr ^= *sourceArray[0] ^ *sourceArray[1] for word aligned
+ *	buffers.  This is the read-modify-write case: old data and new
+ *	data into the parity.
+ *
+ * Results:
+ *      *dPtr.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+XorWords2(numWords, sourceArray, dPtr)
+    register int numWords;	/* The number of words to XOR */
+    int **sourceArray;		/* The two source buffers */
+    register int *dPtr;		/* The buffer to XOR into */
+{
+    register int *s0Ptr = sourceArray[0];
+    register int *s1Ptr = sourceArray[1];
+
+    while (numWords >= 8) {
+	dPtr[0] ^= s0Ptr[0] ^ s1Ptr[0];
+	dPtr[1] ^= s0Ptr[1] ^ s1Ptr[1];
+	dPtr[2] ^= s0Ptr[2] ^ s1Ptr[2];
+	dPtr[3] ^= s0Ptr[3] ^ s1Ptr[3];
+	dPtr[4] ^= s0Ptr[4] ^ s1Ptr[4];
+	dPtr[5] ^= s0Ptr[5] ^ s1Ptr[5];
+	dPtr[6] ^= s0Ptr[6] ^ s1Ptr[6];
+	dPtr[7] ^= s0Ptr[7] ^ s1Ptr[7];
+	s0Ptr += 8;
+	s1Ptr += 8;
+	dPtr += 8;
+	numWords -= 8;
+    }
+    while (numWords > 0) {
+	*dPtr++ ^= *s0Ptr++ ^ *s1Ptr++;
+	numWords--;
+    }
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * XorWordsN --
+ *
+ *	XOR any number of word aligned sources into *dPtr.  Eight words
+ *	of the destination are kept in registers while every source is
+ *	XORed into them, and then they are stored back.
+ *
+ * Results:
+ *      *dPtr.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+XorWordsN(numWords, numSources, sourceArray, dPtr)
+    register int numWords;	/* The number of words to XOR */
+    int numSources;		/* The number of source buffers */
+    int **sourceArray;		/* The source buffers */
+    register int *dPtr;		/* The buffer to XOR into */
+{
+    register int d0, d1, d2, d3, d4, d5, d6, d7;
+    register int *sPtr;
+    register int k;
+    int off = 0;
+
+    while (numWords >= 8) {
+	d0 = dPtr[0];
+	d1 = dPtr[1];
+	d2 = dPtr[2];
+	d3 = dPtr[3];
+	d4 = dPtr[4];
+	d5 = dPtr[5];
+	d6 = dPtr[6];
+	d7 = dPtr[7];
+	for (k = 0; k < numSources; k++) {
+	    sPtr = sourceArray[k] + off;
+	    d0 ^= sPtr[0];
+	    d1 ^= sPtr[1];
+	    d2 ^= sPtr[2];
+	    d3 ^= sPtr[3];
+	    d4 ^= sPtr[4];
+	    d5 ^= sPtr[5];
+	    d6 ^= sPtr[6];
+	    d7 ^= sPtr[7];
+	}
+	dPtr[0] = d0;
+	dPtr[1] = d1;
+	dPtr[2] = d2;
+	dPtr[3] = d3;
+	dPtr[4] = d4;
+	dPtr[5] = d5;
+	dPtr[6] = d6;
+	dPtr[7] = d7;
+	dPtr += 8;
+	off += 8;
+	numWords -= 8;
+    }
+    while (numWords > 0) {
+	d0 = *dPtr;
+	for (k = 0; k < numSources; k++) {
+	    d0 ^= sourceArray[k][off];
+	}
+	*dPtr++ = d0;
+	off++;
+	numWords--;
+    }
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * KBytesPerSecond --
+ *
+ *	Convert kilobytes moved in msec milliseconds to kilobytes per
+ *	second.  kbytes * 1000 overflows an int for a long benchmark
+ *	run, so the rate is taken in KB/ms and the remainder scaled
+ *	separately.
+ *
+ * Results:
+ *	The rate in KB/s.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+KBytesPerSecond(kbytes, msec)
+    int kbytes;			/* Kilobytes moved */
+    int msec;			/* Time taken, greater than zero */
+{
+    int		remainder;
+
+    remainder = kbytes % msec;
+    if (msec <= 0x7fffffff / 1000) {
+	remainder = remainder * 1000 / msec;
+    } else {
+	remainder = remainder / (msec / 1000);
+    }
+    return (kbytes / msec) * 1000 + remainder;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * XorBenchmark --
+ *
+ *	Time XorN against repeated Xor2 passes for 1 to maxSources
+ *	sources of bufSize bytes each, and print the throughput of each.
+ *	Throughput counts the source bytes consumed, in whole kilobytes,
+ *	so bufSize should be a multiple of 1024.  The timer is coarse, so
+ *	numIters should be large enough for each run to take a good
+ *	fraction of a second.  It is capped at RAID_XOR_MAX_ITERS since it
+ *	comes from the user.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *	Prints to stdout.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+XorBenchmark(bufSize, maxSources, numIters)
+    int bufSize;		/* Bytes in each buffer */
+    int maxSources;		/* Largest number of sources to try */
+    int numIters;		/* Number of XORs timed per measurement */
+{
+    char	*sourceArray[RAID_XOR_MAX_SOURCES];
+    char	*destPtr;
+    Time	startTime, endTime;
+    int		msec[2];
+    int		kbytes;
+    int		numSources;
+    int		kernel;
+    int		iter;
+    int		i;
+
+    if (maxSources > RAID_XOR_MAX_SOURCES) {
+	maxSources = RAID_XOR_MAX_SOURCES;
+    }
+    if (numIters > RAID_XOR_MAX_ITERS) {
+	numIters = RAID_XOR_MAX_ITERS;
+    }
+    if (bufSize <= 0 || maxSources <= 0 || numIters <= 0) {
+	return;
+    }
+    destPtr = (char *) malloc((unsigned) bufSize);
+    bzero(destPtr, bufSize);
+    for (i = 0; i < maxSources; i++) {
+	sourceArray[i] = (char *) malloc((unsigned) bufSize);
+	bzero(sourceArray[i], bufSize);
+    }
+    printf("RAID:MSG:XOR benchmark, %d byte buffers, %d iterations.\n",
+	    bufSize, numIters);
+    printf("sources     XorN KB/s    Xor2 KB/s\n");
+    for (numSources = 1; numSources <= maxSources; numSources++) {
+	for (kernel = 0; kernel < 2; kernel++) {
+	    Timer_GetTimeOfDay(&startTime, (int *) NIL, (Boolean *) NIL);
+	    for (iter = 0; iter < numIters; iter++) {
+		if (kernel == 0) {
+		    XorN(bufSize, numSources, sourceArray, destPtr);
+		} else {
+		    for (i = 0; i < numSources; i++) {
+			Xor2(bufSize, sourceArray[i], destPtr);
+		    }
+		}
+	    }
+	    Timer_GetTimeOfDay(&endTime, (int *) NIL, (Boolean *) NIL);
+	    Time_Subtract(endTime, startTime, &endTime);
+	    msec[kernel] = endTime.seconds * 1000 +
+		    endTime.microseconds / 1000;
+	    if (msec[kernel] <= 0) {
+		msec[kernel] = 1;
+	    }
+	}
+	kbytes = (bufSize / 1024) * numSources * numIters;
+	printf("%7d %12d %12d\n", numSources,
+		KBytesPerSecond(kbytes, msec[0]),
+		KBytesPerSecond(kbytes, msec[1]));
+    }
+    for (i = 0; i < maxSources; i++) {
+	free(sourceArray[i]);
+    }
+    free(destPtr);
+}
@@ -124,7 +124,7 @@ DevRaidAttach(devicePtr)
 	Sync_CondInit(&raidPtr->waitExclusive);
 	Sync_CondInit(&raidPtr->waitNonExclusive);
 #endif TESTING
-	Raid_InitStripeLocks();
+	Raid_InitStripeLocks(raidPtr);
 	InitDebugMem();
 	raidPtr->devicePtr = devicePtr;
 	Raid_Lock(raidPtr);
@@ -367,6 +367,60 @@ IOControlProc(handlePtr, ioctlPtr, replyPtr)
     case IOC_DEV_RAID_ENABLE:
 	Raid_Enable(raidPtr);
 	return SUCCESS;
+    case IOC_DEV_RAID_XOR_BENCH:
+	if (raidPtr->state != RAID_VALID) {
+	    return FAILURE;
+	}
+	XorBenchmark(raidPtr->bytesPerStripeUnit, raidPtr->numCol,
+		raidIOCParamPtr->numStripe);
+	return SUCCESS;
+    case IOC_DEV_RAID_CACHE_STATS: {
+	RaidStripeCacheStats stats;
+
+	Raid_GetStripeCacheStats(raidPtr, &stats);
+	printf("RAID:MSG:stripe cache %d entries: %d/%d hits, %d stripe hits\n",
+		stats.numEntries, stats.numHits, stats.numLookups,
+		stats.numStripeHits);
+	printf("RAID:MSG:stripe cache %d inserts, %d evictions, %d flushes\n",
+		stats.numInserts, stats.numEvictions, stats.numFlushes);
+	if (ioctlPtr->outBufSize >= sizeof(RaidStripeCacheStats)) {
+	    bcopy((char *) &stats, ioctlPtr->outBuffer,
+		    sizeof(RaidStripeCacheStats));
+	}
+	return SUCCESS;
+    }
+    case IOC_DEV_RAID_LOG_STATS: {
+	RaidLogStats stats;
+
+	Raid_GetLogStats(raidPtr, &stats);
+	printf("RAID:MSG:log %d writes, %d records, %d flushes, %d delayed\n",
+		stats.numLogStripe, stats.numRecords, stats.numFlushes,
+		stats.numDelayedFlushes);
+	printf("RAID:MSG:log %d writes already marked on disk\n",
+		stats.numAlreadySaved);
+	if (stats.numLogStripe > 0) {
+	    printf("RAID:MSG:log %d flushes per 1000 stripe writes\n",
+		    stats.numFlushes * 1000 / stats.numLogStripe);
+	}
+	if (ioctlPtr->outBufSize >= sizeof(RaidLogStats)) {
+	    bcopy((char *) &stats, ioctlPtr->outBuffer, sizeof(RaidLogStats));
+	}
+	return SUCCESS;
+    }
+    case IOC_DEV_RAID_LOCK_STATS: {
+	RaidStripeLockStats stats;
+
+	Raid_GetStripeLockStats(raidPtr, &stats);
+	printf("RAID:MSG:locks %d/%d shared waits, %d/%d exclusive waits\n",
+		stats.numSWait, stats.numSLock, stats.numXWait, stats.numXLock);
+	printf("RAID:MSG:locks %d held, %d max held, %d max waiters\n",
+		stats.numLocked, stats.maxLocked, stats.maxWaiters);
+	if (ioctlPtr->outBufSize >= sizeof(RaidStripeLockStats)) {
+	    bcopy((char *) &stats, ioctlPtr->outBuffer,
+		    sizeof(RaidStripeLockStats));
+	}
+	return SUCCESS;
+    }
     default:
 	return SUCCESS;
     }
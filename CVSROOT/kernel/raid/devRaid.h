@@ -24,6 +24,8 @@
 #include "devBlockDevice.h"
 #include "devRaidDisk.h"
 #include "devRaidLog.h"
+#include "devRaidCache.h"
+#include "devRaidLock.h"
 
 #ifndef MIN
 #define MIN(a,b) ( (a) < (b) ? (a) : (b) )
@@ -41,6 +43,40 @@
 #define RAID_ROOT_CONFIG_FILE_NAME	"/ra/raid/RAID"
 #endif TESTING
 
+/*
+ * IOControl to run the parity XOR benchmark in bxor.c using this array's
+ * stripe unit size and number of columns.  numStripe in the RaidIOCParam
+ * is the number of iterations.  It is kept here rather than in
+ * <dev/raid.h> since it is only meant for tuning.
+ */
+#ifndef IOC_DEV_RAID_XOR_BENCH
+#define IOC_DEV_RAID_XOR_BENCH		(IOC_DEV_RAID_ENABLE + 0x40)
+#endif
+
+/*
+ * IOControl to return the stripe cache statistics (a RaidStripeCacheStats)
+ * in the output buffer.  The statistics are also printed on the console.
+ */
+#ifndef IOC_DEV_RAID_CACHE_STATS
+#define IOC_DEV_RAID_CACHE_STATS	(IOC_DEV_RAID_ENABLE + 0x41)
+#endif
+
+/*
+ * IOControl to return the parity log statistics (a RaidLogStats) in the
+ * output buffer.  The statistics are also printed on the console.
+ */
+#ifndef IOC_DEV_RAID_LOG_STATS
+#define IOC_DEV_RAID_LOG_STATS		(IOC_DEV_RAID_ENABLE + 0x42)
+#endif
+
+/*
+ * IOControl to return the stripe lock statistics (a RaidStripeLockStats)
+ * in the output buffer.  The statistics are also printed on the console.
+ */
+#ifndef IOC_DEV_RAID_LOCK_STATS
+#define IOC_DEV_RAID_LOCK_STATS		(IOC_DEV_RAID_ENABLE + 0x43)
+#endif
+
 /*
  * Data structure each RAID device.
  *
@@ -65,6 +101,8 @@ typedef struct Raid {
     RaidDisk	      ***disk;	    /* 2D array of disks (column major) */
 
     RaidLog		 log;
+    RaidStripeCache	 cache;
+    RaidStripeLockTable	 lockTable;
 
     unsigned		 numSector;
     int		 	 numStripe;
@@ -115,6 +153,8 @@ typedef struct RaidBlockRequest {
     int			  row;
     RaidDisk		 *diskPtr;
     int			  version;
+    Boolean		  issued;   /* sent to the disk (i.e. not satisfied */
+				    /* from the stripe cache) */
 } RaidBlockRequest;
 
 /*
@@ -131,6 +171,8 @@ typedef struct RaidIOControl {
     int			 amountTransferred;
     int			 numFailed;
     RaidBlockRequest	*failedReqPtr;
+    struct RaidRequestControl *reqControlPtr; /* requests to update the */
+					/* stripe cache with, or NIL */
 } RaidIOControl;
 
 typedef struct RaidRequestControl {
@@ -171,8 +213,49 @@ typedef struct RaidReconstructionControl {
     ReturnStatus	 status;
     char		*parityBuf;
     char		*readBuf;
+    struct RaidSweepControl *sweepPtr; /* sweep this stripe belongs to */
+    int			 unit;	    /* index of this stripe in the sweep */
+    int			 done;	    /* I/O on this stripe has finished */
 } RaidReconstructionControl;
 
+/*
+ * RaidSweepControl
+ *
+ * Drives reconstruction, hard init and parity check over a range of
+ * units (stripes, or stripe units of a disk for reconstruction) with up
+ * to maxInFlight units in progress.  Units are started in order and
+ * retired in order, so work whose effect is recorded as a prefix (the
+ * valid sectors of a reconstructed disk) stays correct.
+ */
+typedef struct RaidSweepControl {
+    Sync_Semaphore	 mutex;
+    Raid		*raidPtr;
+    int			 col;
+    int			 row;
+    RaidDisk		*diskPtr;
+    int			 ctrlData;
+    void	       (*startProc)();	/* starts I/O on one unit */
+    void	       (*retireProc)();	/* called in unit order when done */
+    void	       (*finishProc)();	/* called before doneProc, or NIL */
+    void	       (*doneProc)();
+    ClientData		 clientData;
+    ReturnStatus	 status;
+    int			 stopOnFailure;	/* don't start more after a failure */
+    int			 nextUnit;	/* next unit to start */
+    int			 endUnit;	/* one past the last unit */
+    int			 doneUnit;	/* all units below this are retired */
+    int			 numInFlight;
+    int			 maxInFlight;
+    int			 busyDelayMs;	/* spacing of starts while */
+					/* foreground I/O is active */
+    RaidReconstructionControl **slot;	/* in flight, indexed by unit */
+    RaidReconstructionControl **freeList;
+    int			 numFree;
+    int			 busy;		/* someone is running the sweep */
+    int			 stopped;
+    int			 throttled;	/* waiting for the throttle timer */
+} RaidSweepControl;
+
 extern DevBlockDeviceHandle *DevRaidAttach _ARGS_((Fs_Device *devicePtr));
 
 #endif _DEVRAID
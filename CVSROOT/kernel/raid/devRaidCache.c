@@ -0,0 +1,595 @@
+/*
+ * devRaidCache.c --
+ *
+ *	Routines for caching recently read and written RAID stripe units.
+ *	A small write normally has to read the old data and old parity
+ *	before it can compute the new parity.  If those stripe units are
+ *	still in the cache the reads are satisfied from memory instead.
+ *
+ *	The cache is kept consistent with the disks by
+ *	Raid_StripeCacheUpdate, which is called with the result of every
+ *	set of requests issued by Raid_InitiateIORequests.  The contents of
+ *	an entry are only read or modified by a process that holds the lock
+ *	on that stripe (see devRaidLock.c), so the cache lock only has to
+ *	protect the hash chains, the LRU list and entries being recycled.
+ *
+ * Copyright 1990 Regents of the University of California
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ *
+ */
+
+#ifndef lint
+static char rcsid[] = "$Header$ SPRITE (Berkeley)";
+#endif /* not lint */
+
+#include "sync.h"
+#include <sprite.h>
+#include <stdio.h>
+#include <string.h>
+#include "fs.h"
+#include "devBlockDevice.h"
+#include "devRaid.h"
+#include "devRaidUtil.h"
+#include "semaphore.h"
+#include "stdlib.h"
+#include "devRaidProto.h"
+
+/*
+ * Number of stripes cached per array.  Each stripe takes numCol stripe
+ * units of memory.  Takes effect the next time the array is configured.
+ */
+int raidStripeCacheEntries = 32;
+
+#define UnitPtr(raidPtr, entryPtr, col)	\
+	((entryPtr)->unitBuf + (col) * (raidPtr)->bytesPerStripeUnit)
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FindEntry --
+ *
+ *	Look up the cache entry for a stripe.  The cache lock must be held.
+ *
+ * Results:
+ *	The entry, or NIL if the stripe is not cached.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static RaidStripeCacheEntry *
+FindEntry(cachePtr, stripeID)
+    RaidStripeCache	*cachePtr;
+    int			 stripeID;
+{
+    RaidStripeCacheEntry *entryPtr;
+
+    for (entryPtr = cachePtr->hashTable[stripeID & cachePtr->hashMask];
+	    entryPtr != (RaidStripeCacheEntry *) NIL;
+	    entryPtr = entryPtr->hashNextPtr) {
+	if (entryPtr->stripeID == stripeID) {
+	    return entryPtr;
+	}
+    }
+    return (RaidStripeCacheEntry *) NIL;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TouchEntry --
+ *
+ *	Move an entry to the most recently used end of the LRU list.
+ *	The cache lock must be held.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Reorders the LRU list.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+TouchEntry(cachePtr, entryPtr)
+    RaidStripeCache	 *cachePtr;
+    RaidStripeCacheEntry *entryPtr;
+{
+    if (cachePtr->lruHeadPtr == entryPtr) {
+	return;
+    }
+    /*
+     * Unlink.  The entry is not the head so it has a predecessor.
+     */
+    entryPtr->lruPrevPtr->lruNextPtr = entryPtr->lruNextPtr;
+    if (entryPtr->lruNextPtr != (RaidStripeCacheEntry *) NIL) {
+	entryPtr->lruNextPtr->lruPrevPtr = entryPtr->lruPrevPtr;
+    } else {
+	cachePtr->lruTailPtr = entryPtr->lruPrevPtr;
+    }
+    /*
+     * Insert at the head.
+     */
+    entryPtr->lruPrevPtr = (RaidStripeCacheEntry *) NIL;
+    entryPtr->lruNextPtr = cachePtr->lruHeadPtr;
+    cachePtr->lruHeadPtr->lruPrevPtr = entryPtr;
+    cachePtr->lruHeadPtr = entryPtr;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UnhashEntry --
+ *
+ *	Remove an entry from its hash chain and mark it unused.
+ *	The cache lock must be held.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Forgets all stripe units cached in the entry.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UnhashEntry(raidPtr, entryPtr)
+    Raid		 *raidPtr;
+    RaidStripeCacheEntry *entryPtr;
+{
+    RaidStripeCache	 *cachePtr = &raidPtr->cache;
+    RaidStripeCacheEntry **prevPtrPtr;
+
+    if (entryPtr->stripeID == -1) {
+	return;
+    }
+    prevPtrPtr = &cachePtr->hashTable[entryPtr->stripeID & cachePtr->hashMask];
+    while (*prevPtrPtr != entryPtr) {
+	prevPtrPtr = &(*prevPtrPtr)->hashNextPtr;
+    }
+    *prevPtrPtr = entryPtr->hashNextPtr;
+    entryPtr->hashNextPtr = (RaidStripeCacheEntry *) NIL;
+    entryPtr->stripeID = -1;
+    bzero(entryPtr->valid, raidPtr->numCol);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AllocEntry --
+ *
+ *	Recycle the least recently used entry for a stripe.
+ *	The cache lock must be held.
+ *
+ * Results:
+ *	An empty entry for stripeID.
+ *
+ * Side effects:
+ *	May evict another stripe from the cache.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static RaidStripeCacheEntry *
+AllocEntry(raidPtr, stripeID)
+    Raid		*raidPtr;
+    int			 stripeID;
+{
+    RaidStripeCache	 *cachePtr = &raidPtr->cache;
+    RaidStripeCacheEntry *entryPtr;
+    int			  bucket;
+
+    entryPtr = cachePtr->lruTailPtr;
+    if (entryPtr->stripeID != -1) {
+	cachePtr->stats.numEvictions++;
+	UnhashEntry(raidPtr, entryPtr);
+    }
+    bucket = stripeID & cachePtr->hashMask;
+    entryPtr->stripeID = stripeID;
+    entryPtr->hashNextPtr = cachePtr->hashTable[bucket];
+    cachePtr->hashTable[bucket] = entryPtr;
+    TouchEntry(cachePtr, entryPtr);
+    return entryPtr;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RequestStripeID --
+ *
+ *	Determine the stripe a single disk request belongs to.
+ *
+ * Results:
+ *	The stripe ID.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+RequestStripeID(reqPtr)
+    RaidBlockRequest	*reqPtr;
+{
+    int			 stripeID;
+
+    Raid_MapPhysicalToStripeID(reqPtr->raidPtr, reqPtr->col, reqPtr->row,
+	    (unsigned) ByteToSector(reqPtr->raidPtr,
+		    reqPtr->devReq.startAddress), &stripeID);
+    return stripeID;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Raid_InitStripeCache --
+ *
+ *	Allocate the stripe cache for a newly configured array.  Any
+ *	previous cache is discarded.  The cache is not used for arrays
+ *	without parity or when data is not being transferred (NODATA).
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Allocates memory for raidStripeCacheEntries stripes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Raid_InitStripeCache(raidPtr)
+    Raid		*raidPtr;
+{
+    RaidStripeCache	 *cachePtr = &raidPtr->cache;
+    RaidStripeCacheEntry *entryPtr;
+    int			  numEntries;
+    int			  hashSize;
+    int			  i;
+
+    if (!cachePtr->initialized) {
+	InitSema(&cachePtr->lock, "Raid Stripe Cache", 1);
+	cachePtr->initialized = 1;
+    }
+    LockSema(&cachePtr->lock);
+    for (i = 0; i < cachePtr->numEntries; i++) {
+	free(cachePtr->entryArray[i].valid);
+	free(cachePtr->entryArray[i].unitBuf);
+    }
+    if (cachePtr->numEntries > 0) {
+	free((char *) cachePtr->entryArray);
+	free((char *) cachePtr->hashTable);
+    }
+
+    numEntries = raidStripeCacheEntries;
+#ifdef NODATA
+    numEntries = 0;
+#endif
+    if (raidPtr->parityConfig == 'S' || numEntries < 0) {
+	numEntries = 0;
+    }
+    bzero((char *) &cachePtr->stats, sizeof(RaidStripeCacheStats));
+    cachePtr->stats.numEntries = numEntries;
+    cachePtr->numEntries = numEntries;
+    cachePtr->lruHeadPtr = (RaidStripeCacheEntry *) NIL;
+    cachePtr->lruTailPtr = (RaidStripeCacheEntry *) NIL;
+    if (numEntries == 0) {
+	UnlockSema(&cachePtr->lock);
+	return;
+    }
+
+    hashSize = 1;
+    while (hashSize < 2 * numEntries) {
+	hashSize <<= 1;
+    }
+    cachePtr->hashMask = hashSize - 1;
+    cachePtr->hashTable = (RaidStripeCacheEntry **)
+	    malloc((unsigned) hashSize * sizeof(RaidStripeCacheEntry *));
+    for (i = 0; i < hashSize; i++) {
+	cachePtr->hashTable[i] = (RaidStripeCacheEntry *) NIL;
+    }
+    cachePtr->entryArray = (RaidStripeCacheEntry *)
+	    malloc((unsigned) numEntries * sizeof(RaidStripeCacheEntry));
+    for (i = 0; i < numEntries; i++) {
+	entryPtr = &cachePtr->entryArray[i];
+	entryPtr->hashNextPtr = (RaidStripeCacheEntry *) NIL;
+	entryPtr->stripeID = -1;
+	entryPtr->valid = malloc((unsigned) raidPtr->numCol);
+	bzero(entryPtr->valid, raidPtr->numCol);
+	entryPtr->unitBuf = malloc((unsigned) raidPtr->numCol *
+		raidPtr->bytesPerStripeUnit);
+	entryPtr->lruPrevPtr = (i == 0) ? (RaidStripeCacheEntry *) NIL :
+		&cachePtr->entryArray[i-1];
+	entryPtr->lruNextPtr = (i == numEntries-1) ?
+		(RaidStripeCacheEntry *) NIL : &cachePtr->entryArray[i+1];
+    }
+    cachePtr->lruHeadPtr = &cachePtr->entryArray[0];
+    cachePtr->lruTailPtr = &cachePtr->entryArray[numEntries-1];
+    UnlockSema(&cachePtr->lock);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Raid_FlushStripeCache --
+ *
+ *	Forget everything in the stripe cache.  Called when a disk is
+ *	replaced so that nothing cached for the old disk is served for
+ *	the new one.  (Requests to a failed disk are never ready, so they
+ *	are not satisfied from the cache in the meantime.)
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Invalidates all cache entries.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Raid_FlushStripeCache(raidPtr)
+    Raid		*raidPtr;
+{
+    RaidStripeCache	*cachePtr = &raidPtr->cache;
+    int			 i;
+
+    if (cachePtr->numEntries == 0) {
+	return;
+    }
+    LockSema(&cachePtr->lock);
+    for (i = 0; i < cachePtr->numEntries; i++) {
+	UnhashEntry(raidPtr, &cachePtr->entryArray[i]);
+    }
+    cachePtr->stats.numFlushes++;
+    UnlockSema(&cachePtr->lock);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Raid_StripeCacheFill --
+ *
+ *	Satisfy ready read requests from the stripe cache.  Requests that
+ *	hit are marked REQ_COMPLETED so Raid_InitiateIORequests will not
+ *	issue them; if every request hits the done procedure is called
+ *	without doing any IO.  The caller must hold the stripe lock.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Copies cached data into the request buffers.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Raid_StripeCacheFill(reqControlPtr)
+    RaidRequestControl	*reqControlPtr;
+{
+    Raid		 *raidPtr;
+    RaidStripeCache	 *cachePtr;
+    RaidBlockRequest	 *reqPtr;
+    RaidStripeCacheEntry *entryPtr;
+    int			  i;
+
+    if (reqControlPtr->numReq == 0) {
+	return;
+    }
+    raidPtr = reqControlPtr->reqPtr[0].raidPtr;
+    cachePtr = &raidPtr->cache;
+    if (cachePtr->numEntries == 0) {
+	return;
+    }
+    LockSema(&cachePtr->lock);
+    for (i = 0; i < reqControlPtr->numReq; i++) {
+	reqPtr = &reqControlPtr->reqPtr[i];
+	if (reqPtr->state != REQ_READY || reqPtr->devReq.operation != FS_READ) {
+	    continue;
+	}
+	cachePtr->stats.numLookups++;
+	entryPtr = FindEntry(cachePtr, RequestStripeID(reqPtr));
+	if (entryPtr == (RaidStripeCacheEntry *) NIL ||
+		!entryPtr->valid[reqPtr->col]) {
+	    continue;
+	}
+	bcopy(UnitPtr(raidPtr, entryPtr, reqPtr->col) +
+		StripeUnitOffset(raidPtr, reqPtr->devReq.startAddress),
+		reqPtr->devReq.buffer, reqPtr->devReq.bufferLen);
+	reqPtr->state = REQ_COMPLETED;
+	reqPtr->status = SUCCESS;
+	cachePtr->stats.numHits++;
+	TouchEntry(cachePtr, entryPtr);
+    }
+    UnlockSema(&cachePtr->lock);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Raid_StripeCacheUpdate --
+ *
+ *	Bring the stripe cache up to date with a set of requests that
+ *	Raid_InitiateIORequests has just finished.  Successful whole
+ *	stripe unit transfers are added to the cache, partial transfers
+ *	update units that are already cached and failed requests
+ *	invalidate the unit.  Requests that were satisfied from the cache
+ *	were never issued and are ignored.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Modifies the cache.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Raid_StripeCacheUpdate(reqControlPtr)
+    RaidRequestControl	*reqControlPtr;
+{
+    Raid		 *raidPtr;
+    RaidStripeCache	 *cachePtr;
+    RaidBlockRequest	 *reqPtr;
+    RaidStripeCacheEntry *entryPtr;
+    int			  offset;
+    int			  stripeID;
+    int			  i;
+
+    if (reqControlPtr->numReq == 0) {
+	return;
+    }
+    raidPtr = reqControlPtr->reqPtr[0].raidPtr;
+    cachePtr = &raidPtr->cache;
+    if (cachePtr->numEntries == 0) {
+	return;
+    }
+    LockSema(&cachePtr->lock);
+    for (i = 0; i < reqControlPtr->numReq; i++) {
+	reqPtr = &reqControlPtr->reqPtr[i];
+	if (!reqPtr->issued) {
+	    continue;
+	}
+	stripeID = RequestStripeID(reqPtr);
+	entryPtr = FindEntry(cachePtr, stripeID);
+	if (reqPtr->state != REQ_COMPLETED) {
+	    if (entryPtr != (RaidStripeCacheEntry *) NIL) {
+		entryPtr->valid[reqPtr->col] = FALSE;
+	    }
+	    continue;
+	}
+	offset = StripeUnitOffset(raidPtr, reqPtr->devReq.startAddress);
+	if (entryPtr != (RaidStripeCacheEntry *) NIL &&
+		entryPtr->valid[reqPtr->col]) {
+	    if (reqPtr->devReq.operation == FS_WRITE) {
+		bcopy(reqPtr->devReq.buffer,
+			UnitPtr(raidPtr, entryPtr, reqPtr->col) + offset,
+			reqPtr->devReq.bufferLen);
+	    }
+	    TouchEntry(cachePtr, entryPtr);
+	    continue;
+	}
+	if (offset != 0 ||
+		reqPtr->devReq.bufferLen != raidPtr->bytesPerStripeUnit) {
+	    continue;
+	}
+	if (entryPtr == (RaidStripeCacheEntry *) NIL) {
+	    entryPtr = AllocEntry(raidPtr, stripeID);
+	} else {
+	    TouchEntry(cachePtr, entryPtr);
+	}
+	bcopy(reqPtr->devReq.buffer, UnitPtr(raidPtr, entryPtr, reqPtr->col),
+		raidPtr->bytesPerStripeUnit);
+	entryPtr->valid[reqPtr->col] = TRUE;
+	cachePtr->stats.numInserts++;
+    }
+    UnlockSema(&cachePtr->lock);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Raid_StripeCacheHasStripe --
+ *
+ *	Check whether every data unit of a stripe is cached, in which case
+ *	a reconstruct write needs no disk reads at all.  The caller must
+ *	hold the stripe lock and is expected to do a reconstruct write
+ *	when TRUE is returned.
+ *
+ * Results:
+ *	TRUE if all data units of the stripe are cached.
+ *
+ * Side effects:
+ *	Counts a stripe hit.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Boolean
+Raid_StripeCacheHasStripe(raidPtr, stripeID)
+    Raid		*raidPtr;
+    int			 stripeID;
+{
+    RaidStripeCache	 *cachePtr = &raidPtr->cache;
+    RaidStripeCacheEntry *entryPtr;
+    int			  parityCol, row;
+    unsigned		  sector;
+    int			  col;
+
+    if (cachePtr->numEntries == 0) {
+	return FALSE;
+    }
+    Raid_MapParity(raidPtr, (unsigned) StripeIDToSector(raidPtr, stripeID),
+	    &parityCol, &row, &sector);
+    LockSema(&cachePtr->lock);
+    entryPtr = FindEntry(cachePtr, stripeID);
+    if (entryPtr == (RaidStripeCacheEntry *) NIL) {
+	UnlockSema(&cachePtr->lock);
+	return FALSE;
+    }
+    for (col = 0; col < raidPtr->numCol; col++) {
+	if (col != parityCol && !entryPtr->valid[col]) {
+	    UnlockSema(&cachePtr->lock);
+	    return FALSE;
+	}
+    }
+    cachePtr->stats.numStripeHits++;
+    UnlockSema(&cachePtr->lock);
+    return TRUE;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Raid_GetStripeCacheStats --
+ *
+ *	Return a snapshot of the stripe cache statistics.
+ *
+ * Results:
+ *	Fills in *statsPtr.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Raid_GetStripeCacheStats(raidPtr, statsPtr)
+    Raid		 *raidPtr;
+    RaidStripeCacheStats *statsPtr;
+{
+    RaidStripeCache	*cachePtr = &raidPtr->cache;
+
+    if (!cachePtr->initialized) {
+	bzero((char *) statsPtr, sizeof(RaidStripeCacheStats));
+	return;
+    }
+    LockSema(&cachePtr->lock);
+    *statsPtr = cachePtr->stats;
+    UnlockSema(&cachePtr->lock);
+}
@@ -0,0 +1,67 @@
+/*
+ * devRaidCache.h --
+ *
+ *	Declarations for the RAID stripe cache.  The cache holds recently
+ *	read or written data and parity stripe units so that small writes
+ *	can skip the pre-read of old data and parity.
+ *
+ * Copyright 1990 Regents of the University of California
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ *
+ * $Header$ SPRITE (Berkeley)
+ */
+
+#ifndef _DEVRAIDCACHE
+#define _DEVRAIDCACHE
+
+#include "sync.h"
+#include <sprite.h>
+#include "semaphore.h"
+
+/*
+ * One entry caches the stripe units of a single stripe, one per column.
+ * All units of a stripe live in the same row at the same disk offset,
+ * so a column number is enough to locate a unit within the entry.
+ */
+typedef struct RaidStripeCacheEntry {
+    struct RaidStripeCacheEntry	*hashNextPtr;	/* hash chain */
+    struct RaidStripeCacheEntry	*lruNextPtr;	/* toward least recent */
+    struct RaidStripeCacheEntry	*lruPrevPtr;	/* toward most recent */
+    int				 stripeID;	/* -1 => entry is unused */
+    char			*valid;		/* per column: unit is cached */
+    char			*unitBuf;	/* numCol stripe units */
+} RaidStripeCacheEntry;
+
+/*
+ * Statistics returned by IOC_DEV_RAID_CACHE_STATS.
+ */
+typedef struct RaidStripeCacheStats {
+    int		numEntries;	/* stripes the cache can hold */
+    int		numLookups;	/* read requests checked against the cache */
+    int		numHits;	/* read requests satisfied from the cache */
+    int		numStripeHits;	/* small writes done as reconstruct writes
+				 * because the whole stripe was cached */
+    int		numInserts;	/* stripe units added to the cache */
+    int		numEvictions;	/* stripes displaced to make room */
+    int		numFlushes;	/* whole cache invalidations */
+} RaidStripeCacheStats;
+
+typedef struct {
+    Sema		  lock;
+    int			  initialized;
+    int			  numEntries;	/* 0 => cache disabled */
+    int			  hashMask;
+    RaidStripeCacheEntry *entryArray;
+    RaidStripeCacheEntry **hashTable;
+    RaidStripeCacheEntry *lruHeadPtr;	/* most recently used */
+    RaidStripeCacheEntry *lruTailPtr;	/* least recently used */
+    RaidStripeCacheStats  stats;
+} RaidStripeCache;
+
+#endif /* _DEVRAIDCACHE */
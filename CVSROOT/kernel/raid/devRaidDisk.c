@@ -179,6 +179,7 @@ Raid_FailDisk(raidPtr, col, row, version)
  *
  * Side effects:
  *	Replaces specified disk.
+ *	Flushes the stripe cache.
  *
  *----------------------------------------------------------------------
  */
@@ -221,4 +222,5 @@ printf("RAID:DISK_REPLACED:raid %d %d:pos %d %d %d:oldDev %d %d:newDev %d %d\n",
 	    newDiskPtr->device.type, newDiskPtr->device.unit);
     raidPtr->disk[col][row] = newDiskPtr;
     UnlockSema(&diskPtr->lock);
+    Raid_FlushStripeCache(raidPtr);
 }
@@ -36,6 +36,7 @@
  *	
  *	Reconstructs the parity beginning at startStripe for numStripe.
  *	If numStripe is negative, all stripes will be reconstucted.
+ *	Several stripes are processed at once (see devRaidSweep.c).
  *	(ctrlData is used by the debug device when debugging in user mode.)
  *
  * Results:
@@ -50,6 +51,7 @@
 static void InitiateStripeHardInit();
 static void hardInitReadDoneProc();
 static void hardInitWriteDoneProc();
+static void hardInitRetireProc();
 
 void
 Raid_InitiateHardInit(raidPtr, startStripe, numStripe, doneProc,clientData,ctrlData)
@@ -60,39 +62,21 @@ Raid_InitiateHardInit(raidPtr, startStripe, numStripe, doneProc,clientData,ctrlD
     ClientData   clientData;
     int		 ctrlData;
 {
-    RaidReconstructionControl	*reconstructionControlPtr;
-    reconstructionControlPtr =
-	    Raid_MakeReconstructionControl(raidPtr, (int) NIL, (int) NIL,
-		    (RaidDisk *) NIL, doneProc, clientData, ctrlData);
-    reconstructionControlPtr->stripeID = startStripe;
-    reconstructionControlPtr->numStripe = numStripe;
-    printf("RAID:MSG:Initiating HardInit %d %d.\n",startStripe,numStripe);
-    InitiateStripeHardInit(reconstructionControlPtr);
-}
+    RaidSweepControl	*sweepPtr;
 
-
-/*
- *----------------------------------------------------------------------
- *
- * hardInitDoneProc --
- *
- *	Callback procedure for Raid_InitiateHardInit.
- *
- * Results:
- *	None.
- *
- * Side effects:
- *	None.
- *
- *----------------------------------------------------------------------
- */
-static void
-hardInitDoneProc(reconstructionControlPtr)
-    RaidReconstructionControl	*reconstructionControlPtr;
-{
-    reconstructionControlPtr->doneProc(reconstructionControlPtr->clientData,
-	    reconstructionControlPtr->status);
-    Raid_FreeReconstructionControl(reconstructionControlPtr);
+    sweepPtr = Raid_MakeSweepControl(raidPtr, (int) NIL, (int) NIL,
+	    (RaidDisk *) NIL, InitiateStripeHardInit, hardInitRetireProc,
+	    doneProc, clientData, ctrlData);
+    sweepPtr->nextUnit = startStripe;
+    if (startStripe < 0) {
+	sweepPtr->endUnit = startStripe;
+    } else if (numStripe < 0 || startStripe + numStripe > raidPtr->numStripe) {
+	sweepPtr->endUnit = raidPtr->numStripe;
+    } else {
+	sweepPtr->endUnit = startStripe + numStripe;
+    }
+    printf("RAID:MSG:Initiating HardInit %d %d.\n",startStripe,numStripe);
+    Raid_StartSweep(sweepPtr);
 }
 
 
@@ -107,7 +91,7 @@ hardInitDoneProc(reconstructionControlPtr)
  *	None.
  *
  * Side effects:
- *	Prints an error message.
+ *	None.
  *
  *----------------------------------------------------------------------
  */
@@ -142,23 +126,16 @@ InitiateStripeHardInit(reconstructionControlPtr)
     RaidReconstructionControl	*reconstructionControlPtr;
 {
     Raid	       *raidPtr       = reconstructionControlPtr->raidPtr;
-
-
     int	       		ctrlData      = reconstructionControlPtr->ctrlData;
     RaidRequestControl *reqControlPtr = reconstructionControlPtr->reqControlPtr;
     char	       *readBuf       = reconstructionControlPtr->readBuf;
-
-    int		        stripeID      = reconstructionControlPtr->stripeID;
-    int		        numStripe     = reconstructionControlPtr->numStripe;
+    int		        stripeID      = reconstructionControlPtr->unit;
     unsigned	        firstSector;
     unsigned	        nthSector;
 
+    reconstructionControlPtr->stripeID = stripeID;
     firstSector = StripeIDToSector(raidPtr, stripeID);
     nthSector   = NthSectorOfStripe(raidPtr, firstSector);
-    if (stripeID >= raidPtr->numStripe || stripeID < 0 || numStripe == 0) {
-	hardInitDoneProc(reconstructionControlPtr);
-	return;
-    }
     Raid_XLockStripe(raidPtr, stripeID);
     reqControlPtr->numReq = reqControlPtr->numFailed = 0;
     AddRaidDataRequests(reqControlPtr, raidPtr, FS_READ,
@@ -230,7 +207,35 @@ hardInitReadDoneProc(reconstructionControlPtr, numFailed)
  *	None.
  *
  * Side effects:
- *	Unlocks stripe and initiates reconstruction for the next stripe.
+ *	Hands the stripe back to the sweep.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+hardInitWriteDoneProc(reconstructionControlPtr, numFailed)
+    RaidReconstructionControl	*reconstructionControlPtr;
+    int				 numFailed;
+{
+    if (numFailed > 0) {
+	reconstructionControlPtr->status = FAILURE;
+    }
+    Raid_SweepStripeDone(reconstructionControlPtr);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * hardInitRetireProc --
+ *
+ *	Called in stripe order once the parity of a stripe is written.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Unlocks stripe.
  *
  *----------------------------------------------------------------------
  */
@@ -241,22 +246,17 @@ hardInitReadDoneProc(reconstructionControlPtr, numFailed)
 #endif
 
 static void
-hardInitWriteDoneProc(reconstructionControlPtr, numFailed)
+hardInitRetireProc(reconstructionControlPtr)
     RaidReconstructionControl	*reconstructionControlPtr;
-    int				 numFailed;
 {
     Raid	*raidPtr = reconstructionControlPtr->raidPtr;
     int		stripeID = reconstructionControlPtr->stripeID;
 
-    if (numFailed > 0) {
+    if (reconstructionControlPtr->status != SUCCESS) {
         Raid_ReportHardInitFailure(stripeID);
-	reconstructionControlPtr->status = FAILURE;
     }
     if (stripeID % NUM_REPORT_STRIPE == 0) {
 	printf("RAID:MSG:%d", stripeID);
     }
     Raid_XUnlockStripe(raidPtr, stripeID);
-    reconstructionControlPtr->stripeID++;
-    reconstructionControlPtr->numStripe--;
-    InitiateStripeHardInit(reconstructionControlPtr);
 }
@@ -68,11 +68,13 @@ Raid_InitiateIORequests(reqControlPtr, doneProc, clientData)
     PrintRequests(reqControlPtr);
 #endif TESTING
     IOControlPtr = Raid_MakeIOControl(doneProc, clientData);
+    IOControlPtr->reqControlPtr = reqControlPtr;
     IOControlPtr->numIO++;
     for ( i = 0; i < reqControlPtr->numReq; i++ ) {
 	reqPtr = &reqControlPtr->reqPtr[i];
 	if (reqPtr->state == REQ_READY) {
 	    reqPtr->state = REQ_PENDING;
+	    reqPtr->issued = TRUE;
 	    MASTER_LOCK(&IOControlPtr->mutex);
 	    IOControlPtr->numIO++;
 	    MASTER_UNLOCK(&IOControlPtr->mutex);
@@ -88,6 +90,7 @@ Raid_InitiateIORequests(reqControlPtr, doneProc, clientData)
     IOControlPtr->numIO--;
     if (IOControlPtr->numIO == 0) {
         MASTER_UNLOCK(&IOControlPtr->mutex);
+	Raid_StripeCacheUpdate(reqControlPtr);
         IOControlPtr->doneProc(IOControlPtr->clientData,
 		IOControlPtr->numFailed, IOControlPtr->failedReqPtr);
 	Raid_FreeIOControl(IOControlPtr);
@@ -186,6 +189,7 @@ blockIODoneProc(reqPtr, status, amountTransferred)
  *	None.
  *
  * Side effects:
+ *	Updates the stripe cache with the completed requests.
  *
  *----------------------------------------------------------------------
  */
@@ -194,6 +198,9 @@ void
 nonInterruptLevelCallBackProc(IOControlPtr)
     RaidIOControl	*IOControlPtr;
 {
+    if (IOControlPtr->reqControlPtr != (RaidRequestControl *) NIL) {
+	Raid_StripeCacheUpdate(IOControlPtr->reqControlPtr);
+    }
     IOControlPtr->doneProc(IOControlPtr->clientData,
 	    IOControlPtr->numFailed, IOControlPtr->failedReqPtr);
     Raid_FreeIOControl(IOControlPtr);
@@ -288,10 +295,13 @@ InitiateStripeWrite(stripeIOControlPtr)
 	} else {
 	    InitiateStripeIOFailure(stripeIOControlPtr);
 	}
-    } else if (nthSector-firstSector < raidPtr->dataSectorsPerStripe/2) {
+    } else if (nthSector-firstSector < raidPtr->dataSectorsPerStripe/2 &&
+	    !Raid_StripeCacheHasStripe(raidPtr,
+		    SectorToStripeID(raidPtr, firstSector))) {
 	/*
 	 * If less than half of the stripe is being written, do a
-	 * read modify write.
+	 * read modify write.  If the rest of the stripe is in the stripe
+	 * cache a reconstruct write is cheaper since it needs no reads.
 	 */
 	stripeIOControlPtr->recoverProc = InitiateReconstructWrite;
 	InitiateReadModifyWrite(stripeIOControlPtr);
@@ -448,6 +458,10 @@ InitiateReadModifyWrite(stripeIOControlPtr)
 	    firstSector, parityBuf, ctrlData,
 	    stripeIOControlPtr->rangeOff, stripeIOControlPtr->rangeLen);
     if (reqControlPtr->numFailed == 0) {
+	/*
+	 * Old data and parity found in the stripe cache need not be read.
+	 */
+	Raid_StripeCacheFill(reqControlPtr);
 	Raid_InitiateIORequests(reqControlPtr,
 		oldInfoReadDoneProc, (ClientData) stripeIOControlPtr);
     } else {
@@ -532,6 +546,7 @@ InitiateReconstructWrite(stripeIOControlPtr)
 	    	    firstSector - FirstSectorOfStripe(raidPtr, firstSector)),
 	    ctrlData,stripeIOControlPtr->rangeOff,stripeIOControlPtr->rangeLen);
     if (reqControlPtr->numFailed == 0) {
+	Raid_StripeCacheFill(reqControlPtr);
 	Raid_InitiateIORequests(stripeIOControlPtr->reqControlPtr,
 		oldInfoReadDoneProc, (ClientData) stripeIOControlPtr);
     } else {
@@ -730,6 +745,7 @@ InitiateStripeRead(stripeIOControlPtr)
 	    firstSector, nthSector, buffer, ctrlData);
     switch (reqControlPtr->numFailed) {
     case 0:
+	Raid_StripeCacheFill(reqControlPtr);
         Raid_InitiateIORequests(reqControlPtr,
 		stripeReadDoneProc, (ClientData) stripeIOControlPtr);
 	break;
@@ -2,12 +2,13 @@
  * devRaidLock.c --
  *
  *	Routines for locking and unlocking RAID stripes.
- *	Note that because of the manner in which these routines are used,
- *	stripes with the same number in different arrays (i.e. different
- *	unit numbers) will share the same lock.  Therefore, care must be
- *	taken to avoid unexpected deadlocks (i.e. a single process should never
- *	simultaneously lock two stripes in different raid devices).
- *	All locks are exclusive.
+ *	Each array has its own stripe lock table (see devRaidLock.h).
+ *	Shared locks are compatible with each other; an exclusive lock
+ *	excludes everything else.  Requests are granted in the order they
+ *	were made, so a stream of shared lockers cannot starve an exclusive
+ *	one.  A process that needs locks on more than one stripe must
+ *	acquire them in ascending stripe order, so that two such processes
+ *	cannot deadlock waiting for each other's stripes.
  *
  * Copyright 1989 Regents of the University of California
  * Permission to use, copy, modify, and distribute this
@@ -27,18 +28,18 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include "sync.h"
 #include <sprite.h>
 #include <stdio.h>
-#include "hash.h"
 #include "devRaid.h"
 #include "semaphore.h"
 #include "devRaidProto.h"
 
 extern char *malloc();
 
-#define LOCK_TABLE_SIZE	4096
-
-static Hash_Table lockTable;
-static Sync_Semaphore mutex =
-	Sync_SemInitStatic("devRaidLock.c: Stripe Lock Table");
+#define LockPartition(raidPtr, stripe) \
+	(&(raidPtr)->lockTable.partition[(unsigned) (stripe) % \
+		RAID_LOCK_PARTITIONS])
+#define LockBucket(partPtr, stripe) \
+	(&(partPtr)->bucket[((unsigned) (stripe) / RAID_LOCK_PARTITIONS) % \
+		RAID_LOCK_BUCKETS])
 
 
 /*
@@ -46,31 +47,293 @@ static Sync_Semaphore mutex =
  *
  * Raid_InitStripeLocks --
  *
- *	Should be called at least once before calling any other procedure
- *	from this module.
+ *	Should be called at least once for each array before calling any
+ *	other procedure from this module on it.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	Initializes stripe lock table.
+ *	Initializes the array's stripe lock table.
  *
  *----------------------------------------------------------------------
  */
 
 void
-Raid_InitStripeLocks()
+Raid_InitStripeLocks(raidPtr)
+    Raid	*raidPtr;
+{
+    RaidStripeLockTable	*tablePtr = &raidPtr->lockTable;
+    RaidStripeLockPartition *partPtr;
+    int			 i, j;
+
+    if (tablePtr->initialized) {
+	return;
+    }
+    bzero((char *) tablePtr, sizeof(RaidStripeLockTable));
+    for (i = 0; i < RAID_LOCK_PARTITIONS; i++) {
+	partPtr = &tablePtr->partition[i];
+	Sync_SemInitDynamic(&partPtr->mutex,
+		"devRaidLock.c: Stripe Lock Partition");
+	for (j = 0; j < RAID_LOCK_BUCKETS; j++) {
+	    partPtr->bucket[j] = (RaidStripeLock *) NIL;
+	}
+	partPtr->freePtr = (RaidStripeLock *) NIL;
+    }
+    tablePtr->initialized = 1;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FindLock --
+ *
+ *	Look up the lock record of a stripe.  The partition mutex must be
+ *	held.
+ *
+ * Results:
+ *	The lock record, or NIL if the stripe is neither locked nor waited
+ *	on.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static RaidStripeLock *
+FindLock(partPtr, stripe)
+    RaidStripeLockPartition	*partPtr;
+    int				 stripe;
+{
+    RaidStripeLock		*lockPtr;
+
+    for (lockPtr = *LockBucket(partPtr, stripe);
+	    lockPtr != (RaidStripeLock *) NIL; lockPtr = lockPtr->nextPtr) {
+	if (lockPtr->stripe == stripe) {
+	    return lockPtr;
+	}
+    }
+    return (RaidStripeLock *) NIL;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GrantWaiters --
+ *
+ *	Hand a stripe that has just been released to the waiters at the
+ *	head of its queue: either one exclusive waiter or every shared
+ *	waiter up to the next exclusive one.  The record is put back on
+ *	the free list if nobody holds or waits for the stripe.  The
+ *	partition mutex must be held.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Wakes up waiters.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+GrantWaiters(partPtr, lockPtr)
+    RaidStripeLockPartition	*partPtr;
+    RaidStripeLock		*lockPtr;
+{
+    RaidStripeLockWaiter	*waiterPtr;
+    RaidStripeLock		**prevPtrPtr;
+
+    if (lockPtr->exclusive || lockPtr->numShared > 0) {
+	return;
+    }
+    while ((waiterPtr = lockPtr->waitHeadPtr) !=
+	    (RaidStripeLockWaiter *) NIL) {
+	if (waiterPtr->exclusive) {
+	    if (lockPtr->numShared > 0) {
+		break;
+	    }
+	    lockPtr->exclusive = 1;
+	} else {
+	    lockPtr->numShared++;
+	}
+	lockPtr->waitHeadPtr = waiterPtr->nextPtr;
+	waiterPtr->granted = 1;
+	Sync_MasterBroadcast(&waiterPtr->wait);
+	if (lockPtr->exclusive) {
+	    break;
+	}
+    }
+    if (lockPtr->waitHeadPtr == (RaidStripeLockWaiter *) NIL) {
+	lockPtr->waitTailPtr = (RaidStripeLockWaiter *) NIL;
+    }
+    if (lockPtr->exclusive || lockPtr->numShared > 0) {
+	return;
+    }
+    for (prevPtrPtr = LockBucket(partPtr, lockPtr->stripe);
+	    *prevPtrPtr != lockPtr; prevPtrPtr = &(*prevPtrPtr)->nextPtr) {
+    }
+    *prevPtrPtr = lockPtr->nextPtr;
+    lockPtr->nextPtr = partPtr->freePtr;
+    partPtr->freePtr = lockPtr;
+    partPtr->numLocked--;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LockStripe --
+ *
+ *	Lock a stripe in shared or exclusive mode, waiting behind any
+ *	earlier requests that conflict.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Locks the stripe.  May block.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+LockStripe(raidPtr, stripe, exclusive)
+    Raid	*raidPtr;
+    int		 stripe;
+    int		 exclusive;
+{
+    RaidStripeLockPartition	*partPtr = LockPartition(raidPtr, stripe);
+    RaidStripeLock		*lockPtr;
+    RaidStripeLock		*newPtr = (RaidStripeLock *) NIL;
+    RaidStripeLockWaiter	 waiter;
+    RaidStripeLockWaiter	*waiterPtr;
+    int				 numWaiters;
+
+    MASTER_LOCK(&partPtr->mutex);
+    if (exclusive) {
+	partPtr->stats.numXLock++;
+    } else {
+	partPtr->stats.numSLock++;
+    }
+    while ((lockPtr = FindLock(partPtr, stripe)) == (RaidStripeLock *) NIL) {
+	if (newPtr == (RaidStripeLock *) NIL &&
+		partPtr->freePtr != (RaidStripeLock *) NIL) {
+	    newPtr = partPtr->freePtr;
+	    partPtr->freePtr = newPtr->nextPtr;
+	}
+	if (newPtr != (RaidStripeLock *) NIL) {
+	    newPtr->stripe = stripe;
+	    newPtr->numShared = 0;
+	    newPtr->exclusive = 0;
+	    newPtr->waitHeadPtr = (RaidStripeLockWaiter *) NIL;
+	    newPtr->waitTailPtr = (RaidStripeLockWaiter *) NIL;
+	    newPtr->nextPtr = *LockBucket(partPtr, stripe);
+	    *LockBucket(partPtr, stripe) = newPtr;
+	    newPtr = (RaidStripeLock *) NIL;
+	    partPtr->numLocked++;
+	    if (partPtr->numLocked > partPtr->stats.maxLocked) {
+		partPtr->stats.maxLocked = partPtr->numLocked;
+	    }
+	    continue;
+	}
+	/*
+	 * Don't call Malloc with the mutex held.  Someone may lock the
+	 * stripe meanwhile, so look it up again afterwards.
+	 */
+	MASTER_UNLOCK(&partPtr->mutex);
+	newPtr = (RaidStripeLock *) Malloc(sizeof(RaidStripeLock));
+	MASTER_LOCK(&partPtr->mutex);
+    }
+    if (newPtr != (RaidStripeLock *) NIL) {
+	newPtr->nextPtr = partPtr->freePtr;
+	partPtr->freePtr = newPtr;
+    }
+    if (lockPtr->waitHeadPtr == (RaidStripeLockWaiter *) NIL &&
+	    !lockPtr->exclusive && (!exclusive || lockPtr->numShared == 0)) {
+	if (exclusive) {
+	    lockPtr->exclusive = 1;
+	} else {
+	    lockPtr->numShared++;
+	}
+	MASTER_UNLOCK(&partPtr->mutex);
+	return;
+    }
+    if (exclusive) {
+	partPtr->stats.numXWait++;
+    } else {
+	partPtr->stats.numSWait++;
+    }
+    bzero((char *) &waiter, sizeof(waiter));
+#ifdef TESTING
+    Sync_CondInit(&waiter.wait);
+#endif TESTING
+    waiter.exclusive = exclusive;
+    waiter.nextPtr = (RaidStripeLockWaiter *) NIL;
+    if (lockPtr->waitTailPtr == (RaidStripeLockWaiter *) NIL) {
+	lockPtr->waitHeadPtr = &waiter;
+    } else {
+	lockPtr->waitTailPtr->nextPtr = &waiter;
+    }
+    lockPtr->waitTailPtr = &waiter;
+    numWaiters = 0;
+    for (waiterPtr = lockPtr->waitHeadPtr;
+	    waiterPtr != (RaidStripeLockWaiter *) NIL;
+	    waiterPtr = waiterPtr->nextPtr) {
+	numWaiters++;
+    }
+    if (numWaiters > partPtr->stats.maxWaiters) {
+	partPtr->stats.maxWaiters = numWaiters;
+    }
+    while (!waiter.granted) {
+	Sync_MasterWait(&waiter.wait, &partPtr->mutex, FALSE);
+    }
+    MASTER_UNLOCK(&partPtr->mutex);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UnlockStripe --
+ *
+ *	Release a shared or exclusive lock on a stripe.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May grant the lock to waiters.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UnlockStripe(raidPtr, stripe, exclusive)
+    Raid	*raidPtr;
+    int		 stripe;
+    int		 exclusive;
 {
-    static int	initialized = 0;
+    RaidStripeLockPartition	*partPtr = LockPartition(raidPtr, stripe);
+    RaidStripeLock		*lockPtr;
 
-    MASTER_LOCK(&mutex);
-    if (initialized == 0) {
-	initialized = 1;
-        MASTER_UNLOCK(&mutex);
-	Hash_Init(&lockTable, 1000, 1);
+    MASTER_LOCK(&partPtr->mutex);
+    lockPtr = FindLock(partPtr, stripe);
+    if (lockPtr == (RaidStripeLock *) NIL ||
+	    (exclusive ? !lockPtr->exclusive : lockPtr->numShared == 0)) {
+	MASTER_UNLOCK(&partPtr->mutex);
+	panic("Error: UnlockStripe: Attempt to unlock unlocked stripe.");
+    }
+    if (exclusive) {
+	lockPtr->exclusive = 0;
     } else {
-	MASTER_UNLOCK(&mutex);
+	lockPtr->numShared--;
     }
+    GrantWaiters(partPtr, lockPtr);
+    MASTER_UNLOCK(&partPtr->mutex);
 }
 
 
@@ -93,22 +356,7 @@ Raid_SLockStripe(raidPtr, stripe)
     Raid *raidPtr;
     int stripe;
 {
-    Hash_Entry		*hashEntryPtr;
-    Sync_Condition	*condPtr;
-    condPtr = (Sync_Condition *) Malloc(sizeof(Sync_Condition));
-
-    MASTER_LOCK(&mutex);
-    hashEntryPtr = Hash_Find(&lockTable, (Address) stripe);
-    while ( Hash_GetValue(hashEntryPtr) != (char *) NIL ) {
-	Sync_MasterWait((Sync_Condition *) Hash_GetValue(hashEntryPtr),
-		&mutex, FALSE);
-        hashEntryPtr = Hash_Find(&lockTable, (Address) stripe);
-    }
-#ifdef TESTING
-    Sync_CondInit(condPtr);
-#endif TESTING
-    Hash_SetValue(hashEntryPtr, condPtr);
-    MASTER_UNLOCK(&mutex);
+    LockStripe(raidPtr, stripe, 0);
 }
 
 
@@ -130,7 +378,7 @@ Raid_XLockStripe(raidPtr, stripe)
     Raid *raidPtr;
     int stripe;
 {
-    Raid_SLockStripe(raidPtr, stripe);
+    LockStripe(raidPtr, stripe, 1);
     Raid_LogStripe(raidPtr, stripe);
 #ifdef TESTING
     CheckStripeLog(raidPtr, stripe); 
@@ -157,20 +405,7 @@ Raid_SUnlockStripe(raidPtr, stripe)
     Raid *raidPtr;
     int stripe;
 {
-    Hash_Entry		*hashEntryPtr;
-    Sync_Condition	*condPtr;
-
-    MASTER_LOCK(&mutex);
-    hashEntryPtr = Hash_Find(&lockTable, (Address) stripe);
-    if ( Hash_GetValue(hashEntryPtr) == (char *) NIL ) {
-	MASTER_UNLOCK(&mutex);
-	panic("Error: UnlockStripe: Attempt to unlock unlocked stripe.");
-    }
-    condPtr = (Sync_Condition *) Hash_GetValue(hashEntryPtr);
-    Sync_MasterBroadcast(condPtr);
-    Hash_Delete(&lockTable, hashEntryPtr);
-    MASTER_UNLOCK(&mutex);
-    Free((char *) condPtr);
+    UnlockStripe(raidPtr, stripe, 0);
 }
 
 
@@ -197,7 +432,52 @@ Raid_XUnlockStripe(raidPtr, stripe)
     CheckStripeLog(raidPtr, stripe); 
 #endif /* TESTING */
     Raid_UnlogStripe(raidPtr, stripe);
-    Raid_SUnlockStripe(raidPtr, stripe);
+    UnlockStripe(raidPtr, stripe, 1);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Raid_GetStripeLockStats --
+ *
+ *	Return a snapshot of the stripe lock statistics of an array.
+ *
+ * Results:
+ *	Fills in *statsPtr.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Raid_GetStripeLockStats(raidPtr, statsPtr)
+    Raid		*raidPtr;
+    RaidStripeLockStats	*statsPtr;
+{
+    RaidStripeLockPartition	*partPtr;
+    int				 i;
+
+    bzero((char *) statsPtr, sizeof(RaidStripeLockStats));
+    if (!raidPtr->lockTable.initialized) {
+	return;
+    }
+    for (i = 0; i < RAID_LOCK_PARTITIONS; i++) {
+	partPtr = &raidPtr->lockTable.partition[i];
+	MASTER_LOCK(&partPtr->mutex);
+	statsPtr->numSLock += partPtr->stats.numSLock;
+	statsPtr->numXLock += partPtr->stats.numXLock;
+	statsPtr->numSWait += partPtr->stats.numSWait;
+	statsPtr->numXWait += partPtr->stats.numXWait;
+	statsPtr->numLocked += partPtr->numLocked;
+	statsPtr->maxLocked = MAX(statsPtr->maxLocked,
+		partPtr->stats.maxLocked);
+	statsPtr->maxWaiters = MAX(statsPtr->maxWaiters,
+		partPtr->stats.maxWaiters);
+	MASTER_UNLOCK(&partPtr->mutex);
+    }
 }
 
 /*
@@ -1,7 +1,7 @@
-/* 
+/*
  * devRaidLock.h --
  *
- *	Declarations for RAID device drivers.
+ *	Declarations for the RAID stripe lock table.
  *
  * Copyright 1989 Regents of the University of California
  * Permission to use, copy, modify, and distribute this
@@ -18,15 +18,66 @@
 #ifndef _DEVRAIDLOCK
 #define _DEVRAIDLOCK
 
-#include "devRaid.h"
+#include "sync.h"
+#include <sprite.h>
+
+/*
+ * Each array has its own stripe lock table.  The table is split into
+ * partitions, each with its own master lock, so that I/Os to different
+ * stripes rarely contend for the same lock.  Consecutive stripes fall
+ * in different partitions.
+ */
+#define RAID_LOCK_PARTITIONS	16
+#define RAID_LOCK_BUCKETS	64	/* hash buckets per partition */
+
+/*
+ * A process waiting for a stripe lock.  Waiters are queued in FIFO order
+ * on the lock; the record lives on the waiting process's stack.
+ */
+typedef struct RaidStripeLockWaiter {
+    struct RaidStripeLockWaiter	*nextPtr;
+    int				 exclusive;	/* wants an exclusive lock */
+    int				 granted;	/* lock has been handed over */
+    Sync_Condition		 wait;
+} RaidStripeLockWaiter;
+
+/*
+ * A stripe that is locked or has waiters.
+ */
+typedef struct RaidStripeLock {
+    struct RaidStripeLock	*nextPtr;	/* hash chain or free list */
+    int				 stripe;
+    int				 numShared;	/* shared holders */
+    int				 exclusive;	/* held exclusively */
+    RaidStripeLockWaiter	*waitHeadPtr;
+    RaidStripeLockWaiter	*waitTailPtr;
+} RaidStripeLock;
+
+/*
+ * Statistics returned by IOC_DEV_RAID_LOCK_STATS, summed over the
+ * partitions of a table.
+ */
+typedef struct RaidStripeLockStats {
+    int		numSLock;	/* shared lock requests */
+    int		numXLock;	/* exclusive lock requests */
+    int		numSWait;	/* shared requests that had to wait */
+    int		numXWait;	/* exclusive requests that had to wait */
+    int		numLocked;	/* stripes currently locked or waited on */
+    int		maxLocked;	/* most stripes ever locked in a partition */
+    int		maxWaiters;	/* longest wait queue seen on a stripe */
+} RaidStripeLockStats;
 
 typedef struct {
-    Sync_Semaphore	mutex;
-    int			val;
-    Sync_Condition	wait;
-} Sema;
+    Sync_Semaphore	 mutex;
+    RaidStripeLock	*bucket[RAID_LOCK_BUCKETS];
+    RaidStripeLock	*freePtr;	/* unused lock records */
+    int			 numLocked;
+    RaidStripeLockStats	 stats;
+} RaidStripeLockPartition;
 
-#define LockSema(sema) (DownSema(sema))
-#define UnlockSema(sema) (UpSema(sema))
+typedef struct {
+    int				initialized;
+    RaidStripeLockPartition	partition[RAID_LOCK_PARTITIONS];
+} RaidStripeLockTable;
 
 #endif /* _DEVRAIDLOCK */
@@ -86,8 +86,15 @@ Raid_InitLog(raidPtr)
     bzero((char *) logPtr->diskLockVec, VecSize(raidPtr));
     logPtr->lockVec = (int *) malloc(VecSize(raidPtr));
     bzero((char *) logPtr->lockVec, VecSize(raidPtr));
+    logPtr->flushVec = (int *) malloc(VecSize(raidPtr));
+    bzero((char *) logPtr->flushVec, VecSize(raidPtr));
+    logPtr->savedLockVec = (int *) malloc(VecSize(raidPtr));
+    bzero((char *) logPtr->savedLockVec, VecSize(raidPtr));
     logPtr->numStripeLocked = 0;
     bzero((char *) logPtr->lockVec, VecSize(raidPtr));
+    logPtr->recordGen = 0;
+    logPtr->flushedGen = 0;
+    bzero((char *) &logPtr->stats, sizeof(RaidLogStats));
     logPtr->logDevEndOffset = logPtr->logDevOffset + LogSize(raidPtr);
 #ifdef TESTING
     Sync_CondInit(&logPtr->flushed);
@@ -406,6 +413,11 @@ Raid_SaveState(raidPtr)
     MASTER_LOCK(&raidPtr->log.mutex);
     bcopy((char *) raidPtr->log.lockVec, (char *) raidPtr->log.diskLockVec,
 	    VecSize(raidPtr));
+    /*
+     * This write is not ordered with FlushLogTo, so don't trust the
+     * last flushed image any more.
+     */
+    bzero((char *) raidPtr->log.savedLockVec, VecSize(raidPtr));
     MASTER_UNLOCK(&raidPtr->log.mutex);
     status = Raid_SaveLog(raidPtr);
     return status;
@@ -469,6 +481,7 @@ Raid_RestoreState(raidPtr, type, unit, offset)
 	return status;
     }
 
+    Raid_InitStripeCache(raidPtr);
     raidPtr->state = RAID_VALID;
     return SUCCESS;
 }
@@ -576,6 +589,7 @@ Raid_Configure(raidPtr, charBuf)
 	}
     }
 
+    Raid_InitStripeCache(raidPtr);
     raidPtr->state = RAID_VALID;
     return SUCCESS;
 }
@@ -583,55 +597,103 @@ Raid_Configure(raidPtr, charBuf)
 /*
  *----------------------------------------------------------------------
  *
- * Raid_FlushLog --
+ * FlushLogTo --
  *
- *	Flush log to disk.
+ *	Make sure that log records up to and including gen are on disk.
+ *	Log records are group committed: a process that finds a flush in
+ *	progress waits for it, since it may already contain its record,
+ *	and the process that starts a flush writes every record made so
+ *	far.  If other requests are active the flusher first waits up to
+ *	raidLogGroupCommitMs so that their records can share the write;
+ *	a lone writer flushes immediately.  The flusher writes a copy of
+ *	diskLockVec, which becomes savedLockVec once it is on disk.
  *
  * Results:
+ *	None.
  *
  * Side effects:
+ *	May write the log.
  *
  *----------------------------------------------------------------------
  */
 
-void
-Raid_FlushLog(raidPtr)
-    Raid *raidPtr;
+int raidLogGroupCommitMs = 2;
+
+static void
+FlushLogTo(raidPtr, gen)
+    Raid	*raidPtr;
+    int		 gen;
 {
-    MASTER_LOCK(&raidPtr->log.mutex);
-    if (!raidPtr->log.enabled) {
-	MASTER_UNLOCK(&raidPtr->log.mutex);
+    RaidLog	*logPtr = &raidPtr->log;
+    int		 flushGen;
+
+    MASTER_LOCK(&logPtr->mutex);
+    if (!logPtr->enabled) {
+	MASTER_UNLOCK(&logPtr->mutex);
 	return;
     }
-    if (raidPtr->log.busy) {
-	/*
-	 * Wait for log flush in operation to finish.
-	 */
-	Sync_MasterWait(&raidPtr->log.flushed, &raidPtr->log.mutex, FALSE);
+    while (logPtr->flushedGen < gen) {
+	if (logPtr->busy) {
+	    Sync_MasterWait(&logPtr->flushed, &logPtr->mutex, FALSE);
+	    continue;
+	}
+	logPtr->busy = 1;
+	if (raidLogGroupCommitMs > 0 && raidPtr->numReqInSys > 1) {
+	    MASTER_UNLOCK(&logPtr->mutex);
+	    Raid_WaitTime(raidLogGroupCommitMs);
+	    MASTER_LOCK(&logPtr->mutex);
+	    logPtr->stats.numDelayedFlushes++;
+	}
 	/*
-	 * If someone else is flushing my log, we just need to wait for it
-	 * to finish.  Otherwise, I'll have to flush it myself.
+	 * Every record made so far is already in diskLockVec.
 	 */
-	if (raidPtr->log.busy) {
-	    Sync_MasterWait(&raidPtr->log.flushed, &raidPtr->log.mutex, FALSE);
-	    MASTER_UNLOCK(&raidPtr->log.mutex);
-	    return;
+	flushGen = logPtr->recordGen;
+	bcopy((char *) logPtr->diskLockVec, (char *) logPtr->flushVec,
+		VecSize(raidPtr));
+	logPtr->stats.numFlushes++;
+	MASTER_UNLOCK(&logPtr->mutex);
+
+	while (Raid_DevWriteSync(logPtr->logHandlePtr, VecLoc(raidPtr),
+		(char *) logPtr->flushVec, VecSize(raidPtr)) != SUCCESS) {
+	    printf("Error writing log\n");
+	    Raid_WaitTime(10000);
 	}
-    }
-    raidPtr->log.busy = 1;
-    MASTER_UNLOCK(&raidPtr->log.mutex);
 
-    while (Raid_SaveLog(raidPtr) != SUCCESS) {
-	printf("Error writing log\n");
-	Raid_WaitTime(10000);
+	MASTER_LOCK(&logPtr->mutex);
+	bcopy((char *) logPtr->flushVec, (char *) logPtr->savedLockVec,
+		VecSize(raidPtr));
+	logPtr->flushedGen = flushGen;
+	logPtr->busy = 0;
+	Sync_MasterBroadcast(&logPtr->flushed);
     }
+    MASTER_UNLOCK(&logPtr->mutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Raid_FlushLog --
+ *
+ *	Flush log to disk.
+ *
+ * Results:
+ *
+ * Side effects:
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Raid_FlushLog(raidPtr)
+    Raid *raidPtr;
+{
+    int		gen;
 
     MASTER_LOCK(&raidPtr->log.mutex);
-    raidPtr->log.busy = 0;
-    Sync_MasterBroadcast(&raidPtr->log.flushed);
+    gen = ++raidPtr->log.recordGen;
     MASTER_UNLOCK(&raidPtr->log.mutex);
+    FlushLogTo(raidPtr, gen);
 }
-
 
 /*
  *----------------------------------------------------------------------
@@ -644,6 +706,7 @@ Raid_FlushLog(raidPtr)
  *	None.
  *
  * Side effects:
+ *	Waits until the log on disk marks the stripe as locked.
  *
  *----------------------------------------------------------------------
  */
@@ -658,13 +721,37 @@ Raid_LogStripe(raidPtr, stripeID)
     Raid		*raidPtr;
     int			stripeID;
 {
+    int			gen;
+
     MASTER_LOCK(&raidPtr->log.mutex);
+    raidPtr->log.stats.numLogStripe++;
     Bit_Set(stripeID, raidPtr->log.lockVec);
     if (Bit_IsSet(stripeID, raidPtr->log.diskLockVec)) {
+	if (Bit_IsSet(stripeID, raidPtr->log.savedLockVec)) {
+	    /*
+	     * The log on disk already marks the stripe.
+	     */
+	    raidPtr->log.stats.numAlreadySaved++;
+	    MASTER_UNLOCK(&raidPtr->log.mutex);
+	    return;
+	}
+	/*
+	 * The record that set the bit may still be waiting to be written
+	 * by a delayed or in-progress flush, so wait for every record made
+	 * so far before letting the caller touch the stripe.
+	 */
+	gen = raidPtr->log.recordGen;
 	MASTER_UNLOCK(&raidPtr->log.mutex);
+	FlushLogTo(raidPtr, gen);
 	return;
     }
     Bit_Set(stripeID, raidPtr->log.diskLockVec);
+    /*
+     * The saved image may still mark the stripe from before it was
+     * lazily cleared, and a later write may have dropped it.  The bit
+     * is set again when a flush that includes the new record completes.
+     */
+    Bit_Clear(stripeID, raidPtr->log.savedLockVec);
     /*
      * Occasionally update log.
      */
@@ -673,9 +760,11 @@ Raid_LogStripe(raidPtr, stripeID)
 	bcopy((char *) raidPtr->log.lockVec, (char *) raidPtr->log.diskLockVec,
 		VecSize(raidPtr));
     }
+    gen = ++raidPtr->log.recordGen;
+    raidPtr->log.stats.numRecords++;
     MASTER_UNLOCK(&raidPtr->log.mutex);
 
-    Raid_FlushLog(raidPtr);
+    FlushLogTo(raidPtr, gen);
 }
 
 void
@@ -687,3 +776,29 @@ Raid_UnlogStripe(raidPtr, stripeID)
     Bit_Clear(stripeID, raidPtr->log.lockVec);
     MASTER_UNLOCK(&raidPtr->log.mutex);
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Raid_GetLogStats --
+ *
+ *	Return a snapshot of the parity log statistics.
+ *
+ * Results:
+ *	Fills in *statsPtr.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Raid_GetLogStats(raidPtr, statsPtr)
+    Raid		*raidPtr;
+    RaidLogStats	*statsPtr;
+{
+    MASTER_LOCK(&raidPtr->log.mutex);
+    *statsPtr = raidPtr->log.stats;
+    MASTER_UNLOCK(&raidPtr->log.mutex);
+}
@@ -55,6 +55,20 @@
 #define LogSize(raidPtr)	\
 	(ParamSize(raidPtr) + DiskSize(raidPtr) + VecSize(raidPtr))
 
+/*
+ * Parity log statistics returned by IOC_DEV_RAID_LOG_STATS.  The ratio
+ * numFlushes / numLogStripe is the number of log writes per stripe write.
+ */
+typedef struct RaidLogStats {
+    int			 numLogStripe;	/* stripes locked for writing */
+    int			 numRecords;	/* locks that needed a new log record */
+    int			 numFlushes;	/* writes of the log to disk */
+    int			 numDelayedFlushes; /* flushes that waited to */
+					/* collect more records */
+    int			 numAlreadySaved; /* locks of stripes already */
+					/* marked in the log on disk */
+} RaidLogStats;
+
 typedef struct {
     Sync_Semaphore	 mutex;
     int			 enabled;
@@ -66,8 +80,13 @@ typedef struct {
     int			*diskLockVec;	/* disk image of locked stripes */
     int			*lockVec;	/* actually locked stripes */
 					/* the disk image is unlocked lazily */
+    int			*flushVec;	/* diskLockVec being written */
+    int			*savedLockVec;	/* diskLockVec as last written */
     int			 numStripeLocked;
     Sync_Condition       flushed;
+    int			 recordGen;	/* bumped for each new log record */
+    int			 flushedGen;	/* records up to here are on disk */
+    RaidLogStats	 stats;
 } RaidLog;
 
 #endif /* _DEVRAIDLOG */
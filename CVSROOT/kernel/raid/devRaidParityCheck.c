@@ -36,6 +36,7 @@
  *	
  *	Check the parity beginning at startStripe for numStripe.
  *	If numStripe is negative, all stripes will be checked.
+ *	Several stripes are checked at once (see devRaidSweep.c).
  *	(ctrlData is used by the debug device when debugging in user mode.)
  *
  * Results:
@@ -49,6 +50,7 @@
 
 static void InitiateStripeParityCheck();
 static void parityCheckReadDoneProc();
+static void parityCheckRetireProc();
 
 void
 Raid_InitiateParityCheck(raidPtr, startStripe, numStripe, doneProc,clientData,ctrlData)
@@ -59,39 +61,21 @@ Raid_InitiateParityCheck(raidPtr, startStripe, numStripe, doneProc,clientData,ct
     ClientData   clientData;
     int		 ctrlData;
 {
-    RaidReconstructionControl	*reconstructionControlPtr;
-    reconstructionControlPtr =
-	    Raid_MakeReconstructionControl(raidPtr, (int) NIL, (int) NIL,
-		    (RaidDisk *) NIL, doneProc, clientData, ctrlData);
-    reconstructionControlPtr->stripeID = startStripe;
-    reconstructionControlPtr->numStripe = numStripe;
+    RaidSweepControl	*sweepPtr;
+
+    sweepPtr = Raid_MakeSweepControl(raidPtr, (int) NIL, (int) NIL,
+	    (RaidDisk *) NIL, InitiateStripeParityCheck, parityCheckRetireProc,
+	    doneProc, clientData, ctrlData);
+    sweepPtr->nextUnit = startStripe;
+    if (startStripe < 0) {
+	sweepPtr->endUnit = startStripe;
+    } else if (numStripe < 0 || startStripe + numStripe > raidPtr->numStripe) {
+	sweepPtr->endUnit = raidPtr->numStripe;
+    } else {
+	sweepPtr->endUnit = startStripe + numStripe;
+    }
     printf("RAID:MSG:Initiating parity check.\n");
-    InitiateStripeParityCheck(reconstructionControlPtr);
-}
-
-
-/*
- *----------------------------------------------------------------------
- *
- * parityCheckDoneProc --
- *
- *	Callback procedure for Raid_InitiateParityCheck.
- *
- * Results:
- *	None.
- *
- * Side effects:
- *	None.
- *
- *----------------------------------------------------------------------
- */
-static void
-parityCheckDoneProc(reconstructionControlPtr)
-    RaidReconstructionControl	*reconstructionControlPtr;
-{
-    reconstructionControlPtr->doneProc(reconstructionControlPtr->clientData,
-	    reconstructionControlPtr->status);
-    Raid_FreeReconstructionControl(reconstructionControlPtr);
+    Raid_StartSweep(sweepPtr);
 }
 
 
@@ -100,7 +84,7 @@ parityCheckDoneProc(reconstructionControlPtr)
  *
  * Raid_InitiateParityCheckFailure --
  *
- *	Causes the initialization of the current stripe to fail.
+ *	Causes the check of the current stripe to fail.
  *
  * Results:
  *	None.
@@ -141,24 +125,17 @@ InitiateStripeParityCheck(reconstructionControlPtr)
     RaidReconstructionControl	*reconstructionControlPtr;
 {
     Raid	       *raidPtr       = reconstructionControlPtr->raidPtr;
-
-
     int	       		ctrlData      = reconstructionControlPtr->ctrlData;
     RaidRequestControl *reqControlPtr = reconstructionControlPtr->reqControlPtr;
     char	       *readBuf       = reconstructionControlPtr->readBuf;
     char	       *parityBuf     = reconstructionControlPtr->parityBuf;
-
-    int		        stripeID      = reconstructionControlPtr->stripeID;
-    int		        numStripe     = reconstructionControlPtr->numStripe;
+    int		        stripeID      = reconstructionControlPtr->unit;
     unsigned	        firstSector;
     unsigned	        nthSector;
 
+    reconstructionControlPtr->stripeID = stripeID;
     firstSector = StripeIDToSector(raidPtr, stripeID);
     nthSector   = NthSectorOfStripe(raidPtr, firstSector);
-    if (stripeID >= raidPtr->numStripe || stripeID < 0 || numStripe == 0) {
-	parityCheckDoneProc(reconstructionControlPtr);
-	return;
-    }
     Raid_SLockStripe(raidPtr, stripeID);
     reqControlPtr->numReq = reqControlPtr->numFailed = 0;
     AddRaidDataRequests(reqControlPtr, raidPtr, FS_READ,
@@ -220,11 +197,34 @@ parityCheckReadDoneProc(reconstructionControlPtr, numFailed)
 	free(xorBuf);
 #endif
     }
+    Raid_SweepStripeDone(reconstructionControlPtr);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * parityCheckRetireProc --
+ *
+ *	Called in stripe order once a stripe has been checked.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Unlocks stripe.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+parityCheckRetireProc(reconstructionControlPtr)
+    RaidReconstructionControl	*reconstructionControlPtr;
+{
+    Raid	       *raidPtr       = reconstructionControlPtr->raidPtr;
+
     if (reconstructionControlPtr->stripeID % 100 == 0) {
 	printf("RAID:MSG:%d", reconstructionControlPtr->stripeID);
     }
     Raid_SUnlockStripe(raidPtr, reconstructionControlPtr->stripeID);
-    reconstructionControlPtr->stripeID++;
-    reconstructionControlPtr->numStripe--;
-    InitiateStripeParityCheck(reconstructionControlPtr);
 }
@@ -3,7 +3,11 @@
 /*
  * bxor.c
  */
+#define RAID_XOR_MAX_SOURCES	16
+#define RAID_XOR_MAX_ITERS	10000
 extern void Xor2 _ARGS_((register int numBytes, char *sourcePtr, char *destPtr));
+extern void XorN _ARGS_((register int numBytes, int numSources, char **sourceArray, char *destPtr));
+extern void XorBenchmark _ARGS_((int bufSize, int maxSources, int numIters));
 
 /*
  * debugMem.c
@@ -30,6 +34,18 @@ extern void PrintRaid _ARGS_((Raid *raidPtr));
 extern void PrintTime _ARGS_((void));
 #endif
 
+/*
+ * devRaidCache.c
+ */
+#ifdef _DEVRAID
+extern void Raid_InitStripeCache _ARGS_((Raid *raidPtr));
+extern void Raid_FlushStripeCache _ARGS_((Raid *raidPtr));
+extern void Raid_StripeCacheFill _ARGS_((RaidRequestControl *reqControlPtr));
+extern void Raid_StripeCacheUpdate _ARGS_((RaidRequestControl *reqControlPtr));
+extern Boolean Raid_StripeCacheHasStripe _ARGS_((Raid *raidPtr, int stripeID));
+extern void Raid_GetStripeCacheStats _ARGS_((Raid *raidPtr, RaidStripeCacheStats *statsPtr));
+#endif
+
 /*
  * devRaidDisk.c (Put here to prevent circular reference.)
  */
@@ -71,12 +87,13 @@ extern void Raid_InitiateSimpleStripeIOs _ARGS_((Raid *raidPtr, int operation, u
  * devRaidLock.c
  */
 #ifdef _DEVRAID
-extern void Raid_InitStripeLocks _ARGS_((void));
+extern void Raid_InitStripeLocks _ARGS_((Raid *raidPtr));
 extern void Raid_SLockStripe _ARGS_((Raid *raidPtr, int stripe));
 extern void Raid_CheckPoint _ARGS_((Raid *raidPtr));
 extern void Raid_XLockStripe _ARGS_((Raid *raidPtr, int stripe));
 extern void Raid_SUnlockStripe _ARGS_((Raid *raidPtr, int stripe));
 extern void Raid_XUnlockStripe _ARGS_((Raid *raidPtr, int stripe));
+extern void Raid_GetStripeLockStats _ARGS_((Raid *raidPtr, RaidStripeLockStats *statsPtr));
 extern void Raid_Disable _ARGS_((Raid *raidPtr));
 extern void Raid_Enable _ARGS_((Raid *raidPtr));
 extern void Raid_Lock _ARGS_((Raid *raidPtr));
@@ -106,6 +123,7 @@ extern ReturnStatus Raid_RestoreState _ARGS_((Raid *raidPtr, int type, int unit,
 extern void Raid_MasterFlushLog _ARGS_((Raid *raidPtr));
 extern void Raid_LogStripe _ARGS_((Raid *raidPtr, int stripeID));
 extern void Raid_UnlogStripe _ARGS_((Raid *raidPtr, int stripeID));
+extern void Raid_GetLogStats _ARGS_((Raid *raidPtr, RaidLogStats *statsPtr));
 #endif
 
 /*
@@ -131,6 +149,15 @@ extern void Raid_InitiateParityCheck _ARGS_((Raid *raidPtr, int startStripe, int
 extern void Raid_InitiateReconstruction _ARGS_((Raid *raidPtr, int col, int row, int version, int numSector, int uSec, void (*doneProc)(), ClientData clientData, int ctrlData));
 #endif
 
+/*
+ * devRaidSweep.c
+ */
+#ifdef _DEVRAID
+extern RaidSweepControl *Raid_MakeSweepControl _ARGS_((Raid *raidPtr, int col, int row, RaidDisk *diskPtr, void (*startProc)(), void (*retireProc)(), void (*doneProc)(), ClientData clientData, int ctrlData));
+extern void Raid_StartSweep _ARGS_((RaidSweepControl *sweepPtr));
+extern void Raid_SweepStripeDone _ARGS_((RaidReconstructionControl *reconstructionControlPtr));
+#endif
+
 /*
  * strUtil.c
  */
@@ -35,8 +35,10 @@
  *
  * Raid_InitiateReconstruction --
  *
- *	Reconstruct the contents of the failed disk.
- *	System must be quiesced
+ *	Reconstruct the contents of the failed disk.  Up to
+ *	raidSweepMaxInFlight stripes are reconstructed at once; uSec, if
+ *	non-zero, overrides the spacing between stripes while foreground
+ *	I/O is in progress.  (numSector is not used.)
  *
  * Results:
  *	None.
@@ -48,6 +50,8 @@
  */
 
 static void InitiateStripeReconstruction();
+static void reconstructionRetireProc();
+static void reconstructionFinishProc();
 
 void
 Raid_InitiateReconstruction(raidPtr, col, row, version, numSector, uSec, doneProc,
@@ -60,8 +64,9 @@ Raid_InitiateReconstruction(raidPtr, col, row, version, numSector, uSec, donePro
     ClientData   clientData;
     int		 ctrlData;
 {
-    RaidReconstructionControl	*reconstructionControlPtr;
-    RaidDisk			*diskPtr;
+    RaidSweepControl	*sweepPtr;
+    RaidDisk		*diskPtr;
+    int			 firstUnit;
 
     LockSema(&raidPtr->disk[col][row]->lock);
     diskPtr = raidPtr->disk[col][row];
@@ -69,36 +74,53 @@ Raid_InitiateReconstruction(raidPtr, col, row, version, numSector, uSec, donePro
 	UnlockSema(&diskPtr->lock);
 	return;
     }
+    firstUnit = diskPtr->numValidSector / raidPtr->sectorsPerStripeUnit;
     UnlockSema(&diskPtr->lock);
-    reconstructionControlPtr = Raid_MakeReconstructionControl(raidPtr,
-	    col, row, diskPtr, doneProc, clientData, ctrlData);
-    InitiateStripeReconstruction(reconstructionControlPtr);
+    sweepPtr = Raid_MakeSweepControl(raidPtr, col, row, diskPtr,
+	    InitiateStripeReconstruction, reconstructionRetireProc,
+	    doneProc, clientData, ctrlData);
+    sweepPtr->finishProc = reconstructionFinishProc;
+    sweepPtr->stopOnFailure = 1;
+    sweepPtr->nextUnit = firstUnit;
+    sweepPtr->endUnit = raidPtr->sectorsPerDisk / raidPtr->sectorsPerStripeUnit;
+    if (uSec > 0) {
+	sweepPtr->busyDelayMs = (uSec + 999) / 1000;
+    }
+    Raid_StartSweep(sweepPtr);
 }
 
 
 /*
  *----------------------------------------------------------------------
  *
- * reconstructionDoneProc --
+ * reconstructionFinishProc --
  *
- *	Callback procedure for Raid_InitiateReconstruction.
+ *	Called when the reconstruction sweep is over.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	None.
+ *	Prints a message.
  *
  *----------------------------------------------------------------------
  */
 
 static void
-reconstructionDoneProc(reconstructionControlPtr)
-    RaidReconstructionControl	*reconstructionControlPtr;
+reconstructionFinishProc(sweepPtr)
+    RaidSweepControl	*sweepPtr;
 {
-    reconstructionControlPtr->doneProc(reconstructionControlPtr->clientData,
-            reconstructionControlPtr->status);
-    Raid_FreeReconstructionControl(reconstructionControlPtr);
+    RaidDisk		*diskPtr = sweepPtr->diskPtr;
+
+    LockSema(&diskPtr->lock);
+    if (sweepPtr->status == SUCCESS &&
+	    diskPtr->numValidSector == sweepPtr->raidPtr->sectorsPerDisk) {
+        printf("RAID:MSG:Reconstruction completed.\n");
+    } else {
+        printf("RAID:MSG:Reconctruction aborted.\n");
+	sweepPtr->status = FAILURE;
+    }
+    UnlockSema(&diskPtr->lock);
 }
 
 
@@ -107,7 +129,7 @@ reconstructionDoneProc(reconstructionControlPtr)
  *
  * Raid_InitiateReconstructionFailure --
  *
- *	Causes the reconstruction to fail.
+ *	Causes the reconstruction of the current stripe to fail.
  *
  * Results:
  *	None.
@@ -122,13 +144,8 @@ static void
 Raid_InitiateReconstructionFailure(reconstructionControlPtr)
     RaidReconstructionControl	*reconstructionControlPtr;
 {
-    int	         stripeID = reconstructionControlPtr->stripeID;
-
-    Raid_XUnlockStripe(reconstructionControlPtr->raidPtr, stripeID);
-    Raid_ReportReconstructionFailure(reconstructionControlPtr->col,
-    	    reconstructionControlPtr->row);
     reconstructionControlPtr->status = FAILURE;
-    reconstructionDoneProc(reconstructionControlPtr);
+    Raid_SweepStripeDone(reconstructionControlPtr);
 }
 
 
@@ -137,13 +154,14 @@ Raid_InitiateReconstructionFailure(reconstructionControlPtr)
  *
  * InitiateStripeReconstruction --
  *
- *	Reconstructs a single stripe.
+ *	Reconstructs a single stripe, the one containing stripe unit
+ *	reconstructionControlPtr->unit of the failed disk.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	None.
+ *	Locks stripe.
  *
  *----------------------------------------------------------------------
  */
@@ -167,23 +185,18 @@ InitiateStripeReconstruction(reconstructionControlPtr)
     unsigned	        firstSector;
     unsigned	        nthSector;
 
+    Raid_MapPhysicalToStripeID(raidPtr, col, row, (unsigned)
+	    (reconstructionControlPtr->unit * raidPtr->sectorsPerStripeUnit),
+	    &stripeID);
+    Raid_XLockStripe(raidPtr, stripeID);
+    reconstructionControlPtr->stripeID = stripeID;
     LockSema(&diskPtr->lock);
-    if (diskPtr->numValidSector == raidPtr->sectorsPerDisk) {
-        printf("RAID:MSG:Reconstruction completed.\n");
-	reconstructionDoneProc(reconstructionControlPtr);
-	UnlockSema(&diskPtr->lock);
-	return;
-    }
     if (diskPtr->state != RAID_DISK_READY) {
-        printf("RAID:MSG:Reconctruction aborted.\n");
-	reconstructionDoneProc(reconstructionControlPtr);
 	UnlockSema(&diskPtr->lock);
+	Raid_InitiateReconstructionFailure(reconstructionControlPtr);
 	return;
     }
-    Raid_MapPhysicalToStripeID(raidPtr, col,row, diskPtr->numValidSector, &stripeID);
-    Raid_XLockStripe(raidPtr, stripeID);
     UnlockSema(&diskPtr->lock);
-    reconstructionControlPtr->stripeID = stripeID;
     firstSector = StripeIDToSector(raidPtr, stripeID);
     nthSector   = NthSectorOfStripe(raidPtr, firstSector);
     reqControlPtr->numReq = reqControlPtr->numFailed = 0;
@@ -223,7 +236,6 @@ reconstructionReadDoneProc(reconstructionControlPtr, numFailed)
     int			 	 numFailed;
 {
     Raid	       *raidPtr       = reconstructionControlPtr->raidPtr;
-    RaidDisk	       *diskPtr       = reconstructionControlPtr->diskPtr;
     RaidRequestControl *reqControlPtr = reconstructionControlPtr->reqControlPtr;
     RaidBlockRequest   *failedReqPtr  =
 	    	          reconstructionControlPtr->reqControlPtr->failedReqPtr;
@@ -240,16 +252,6 @@ reconstructionReadDoneProc(reconstructionControlPtr, numFailed)
 		failedReqPtr->devReq.bufferLen);
 	reqControlPtr->failedReqPtr->devReq.operation = FS_WRITE;
 	reqControlPtr->failedReqPtr->state = REQ_READY;
-	LockSema(&diskPtr->lock);
-	if (diskPtr->state != RAID_DISK_READY) {
-	    printf("RAID:MSG:Reconctruction aborted.\n");
-	    Raid_InitiateReconstructionFailure(reconstructionControlPtr);
-	    UnlockSema(&diskPtr->lock);
-	    return;
-	}
-	diskPtr->numValidSector =
-		NthSectorOfStripeUnit(raidPtr, diskPtr->numValidSector);
-	UnlockSema(&diskPtr->lock);
 	Raid_InitiateIORequests(reqControlPtr, reconstructionWriteDoneProc,
 		(ClientData) reconstructionControlPtr);
     }
@@ -267,7 +269,7 @@ reconstructionReadDoneProc(reconstructionControlPtr, numFailed)
  *	None.
  *
  * Side effects:
- *	Initiates the reconstruction of the next sector on the failed device.
+ *	None.
  *
  *----------------------------------------------------------------------
  */
@@ -276,26 +278,51 @@ static void
 reconstructionWriteDoneProc(reconstructionControlPtr, numFailed)
     RaidReconstructionControl	*reconstructionControlPtr;
     int				 numFailed;
+{
+    if (numFailed > 0) {
+	reconstructionControlPtr->status = FAILURE;
+    }
+    Raid_SweepStripeDone(reconstructionControlPtr);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * reconstructionRetireProc --
+ *
+ *	Called in order for each reconstructed stripe.  Since stripes are
+ *	retired in order, the valid part of the disk can simply be
+ *	extended over the stripe unit.  Nothing more is marked valid once
+ *	a stripe has failed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Records the new number of valid sectors and unlocks the stripe.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+reconstructionRetireProc(reconstructionControlPtr)
+    RaidReconstructionControl	*reconstructionControlPtr;
 {
     Raid	       *raidPtr       = reconstructionControlPtr->raidPtr;
     RaidDisk	       *diskPtr       = reconstructionControlPtr->diskPtr;
-    int		        stripeID      = reconstructionControlPtr->stripeID;
+    RaidSweepControl   *sweepPtr      = reconstructionControlPtr->sweepPtr;
 
-    if (numFailed > 0) {
-	LockSema(&diskPtr->lock);
-	if (diskPtr->state != RAID_DISK_READY) {
-	    printf("RAID:MSG:Reconctruction aborted.\n");
-	    Raid_InitiateReconstructionFailure(reconstructionControlPtr);
-	    UnlockSema(&diskPtr->lock);
-	    return;
+    if (reconstructionControlPtr->status != SUCCESS) {
+	if (sweepPtr->status == SUCCESS) {
+	    Raid_ReportReconstructionFailure(reconstructionControlPtr->col,
+		    reconstructionControlPtr->row);
 	}
-	diskPtr->numValidSector =
-		FirstSectorOfStripeUnit(raidPtr, diskPtr->numValidSector);
-	UnlockSema(&diskPtr->lock);
-	Raid_InitiateReconstructionFailure(reconstructionControlPtr);
-    } else {
+    } else if (sweepPtr->status == SUCCESS) {
 	LockSema(&diskPtr->lock);
 	if (diskPtr->state == RAID_DISK_READY) {
+	    diskPtr->numValidSector = (reconstructionControlPtr->unit + 1) *
+		    raidPtr->sectorsPerStripeUnit;
 	    printf("RAID:RECON:%d %d %d\n",
 		    diskPtr->device.type, diskPtr->device.unit,
 		    SectorToStripeUnitID(raidPtr, diskPtr->numValidSector-1));
@@ -306,9 +333,10 @@ reconstructionWriteDoneProc(reconstructionControlPtr, numFailed)
 	    CheckDiskLog(raidPtr, diskPtr->col, diskPtr->row,
 		    diskPtr->numValidSector);
 #endif TESTING
+	} else {
+	    reconstructionControlPtr->status = FAILURE;
 	}
 	UnlockSema(&diskPtr->lock);
-	Raid_XUnlockStripe(raidPtr, stripeID);
-	InitiateStripeReconstruction(reconstructionControlPtr);
     }
+    Raid_XUnlockStripe(raidPtr, reconstructionControlPtr->stripeID);
 }
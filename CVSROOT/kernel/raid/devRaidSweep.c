@@ -0,0 +1,429 @@
+/*
+ * devRaidSweep.c --
+ *
+ *	Routines for sweeping an operation (reconstruction, hard init or
+ *	parity check) over a range of stripes with several stripes in
+ *	flight at once.
+ *
+ *	Units are started in increasing order, at most maxInFlight ahead
+ *	of the oldest unit that has not been retired, and are retired
+ *	strictly in order.  A unit keeps its stripe lock until it is
+ *	retired.  Only one process at a time runs the sweep (starting
+ *	and retiring units); completions that arrive while it is running
+ *	are noticed by that process before it gives up the sweep.
+ *
+ *	Foreground I/O has priority: while there are requests in the
+ *	array only one unit is kept in flight and starts are spaced by
+ *	busyDelayMs.  raidSweepMaxKBPerSec caps the bandwidth of a sweep
+ *	at all times.
+ *
+ * Copyright 1990 Regents of the University of California
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ */
+
+#ifndef lint
+static char rcsid[] = "$Header$ SPRITE (Berkeley)";
+#endif /* not lint */
+
+#include "sync.h"
+#include <stdio.h>
+#include <string.h>
+#include "sprite.h"
+#include "fs.h"
+#include "dev.h"
+#include "devBlockDevice.h"
+#include "devRaid.h"
+#include "semaphore.h"
+#include "stdlib.h"
+#include "devRaidUtil.h"
+#include "proc.h"
+#include "timer.h"
+#include "devRaidProto.h"
+
+/*
+ * Number of units a sweep keeps in flight when the array is otherwise
+ * idle.
+ */
+int raidSweepMaxInFlight = 8;
+
+/*
+ * Spacing in milliseconds between unit starts while foreground I/O is
+ * in progress, unless the caller asks for something else.
+ */
+int raidSweepBusyDelayMs = 10;
+
+/*
+ * Bandwidth cap for a sweep in kilobytes per second of disk traffic,
+ * or 0 for no cap.
+ */
+int raidSweepMaxKBPerSec = 0;
+
+static void RunSweep();
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Raid_MakeSweepControl --
+ *
+ *	Allocate and initialize a RaidSweepControl.  The caller fills in
+ *	nextUnit, endUnit and any of the other tunable fields and then
+ *	calls Raid_StartSweep.
+ *
+ *	startProc is called with a RaidReconstructionControl whose unit
+ *	field is set; it must arrange for Raid_SweepStripeDone to be
+ *	called with the same control block (and its status set) when the
+ *	unit is finished.  retireProc is called with each control block
+ *	in unit order after that, and should release the stripe lock.
+ *
+ * Results:
+ *	The sweep control block.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+RaidSweepControl *
+Raid_MakeSweepControl(raidPtr, col, row, diskPtr, startProc, retireProc,
+	doneProc, clientData, ctrlData)
+    Raid	*raidPtr;
+    int		 col, row;
+    RaidDisk	*diskPtr;
+    void       (*startProc)();
+    void       (*retireProc)();
+    void       (*doneProc)();
+    ClientData	 clientData;
+    int		 ctrlData;
+{
+    RaidSweepControl	*sweepPtr;
+
+    sweepPtr = (RaidSweepControl *) Malloc(sizeof(RaidSweepControl));
+    Sync_SemInitDynamic(&sweepPtr->mutex, "RAID Sweep Sema");
+    sweepPtr->raidPtr		= raidPtr;
+    sweepPtr->col		= col;
+    sweepPtr->row		= row;
+    sweepPtr->diskPtr		= diskPtr;
+    sweepPtr->ctrlData		= ctrlData;
+    sweepPtr->startProc		= startProc;
+    sweepPtr->retireProc	= retireProc;
+    sweepPtr->finishProc	= (void (*)()) NIL;
+    sweepPtr->doneProc		= doneProc;
+    sweepPtr->clientData	= clientData;
+    sweepPtr->status		= SUCCESS;
+    sweepPtr->stopOnFailure	= 0;
+    sweepPtr->nextUnit		= 0;
+    sweepPtr->endUnit		= 0;
+    sweepPtr->doneUnit		= 0;
+    sweepPtr->numInFlight	= 0;
+    sweepPtr->maxInFlight	= MAX(raidSweepMaxInFlight, 1);
+    sweepPtr->busyDelayMs	= raidSweepBusyDelayMs;
+    sweepPtr->slot		= (RaidReconstructionControl **) NIL;
+    sweepPtr->freeList		= (RaidReconstructionControl **) NIL;
+    sweepPtr->numFree		= 0;
+    sweepPtr->busy		= 0;
+    sweepPtr->stopped		= 0;
+    sweepPtr->throttled		= 0;
+    return sweepPtr;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeSweepControl --
+ *
+ *	Free a RaidSweepControl and the control blocks it cached.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeSweepControl(sweepPtr)
+    RaidSweepControl	*sweepPtr;
+{
+    int			 i;
+
+    for (i = 0; i < sweepPtr->numFree; i++) {
+	Raid_FreeReconstructionControl(sweepPtr->freeList[i]);
+    }
+    Free((char *) sweepPtr->freeList);
+    Free((char *) sweepPtr->slot);
+    Sync_LockClear(&sweepPtr->mutex);
+    Free((char *) sweepPtr);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Raid_StartSweep --
+ *
+ *	Start sweeping the units [nextUnit, endUnit).  The done procedure
+ *	is called with the client data and the overall status when all
+ *	units have been retired.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Starts I/O.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Raid_StartSweep(sweepPtr)
+    RaidSweepControl	*sweepPtr;
+{
+    int			 i;
+
+    sweepPtr->doneUnit = sweepPtr->nextUnit;
+    sweepPtr->slot = (RaidReconstructionControl **)
+	    Malloc((unsigned) sweepPtr->maxInFlight *
+		    sizeof(RaidReconstructionControl *));
+    sweepPtr->freeList = (RaidReconstructionControl **)
+	    Malloc((unsigned) sweepPtr->maxInFlight *
+		    sizeof(RaidReconstructionControl *));
+    for (i = 0; i < sweepPtr->maxInFlight; i++) {
+	sweepPtr->slot[i] = (RaidReconstructionControl *) NIL;
+    }
+    sweepPtr->busy = 1;
+    RunSweep(sweepPtr);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Raid_SweepStripeDone --
+ *
+ *	Called by the operation when I/O on a unit has finished.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May retire units and start new ones.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Raid_SweepStripeDone(reconstructionControlPtr)
+    RaidReconstructionControl	*reconstructionControlPtr;
+{
+    RaidSweepControl	*sweepPtr = reconstructionControlPtr->sweepPtr;
+
+    MASTER_LOCK(&sweepPtr->mutex);
+    reconstructionControlPtr->done = 1;
+    if (reconstructionControlPtr->status != SUCCESS &&
+	    sweepPtr->stopOnFailure) {
+	sweepPtr->stopped = 1;
+    }
+    if (sweepPtr->busy) {
+	MASTER_UNLOCK(&sweepPtr->mutex);
+	return;
+    }
+    sweepPtr->busy = 1;
+    MASTER_UNLOCK(&sweepPtr->mutex);
+    RunSweep(sweepPtr);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * sweepTimerProc --
+ *
+ *	Callback for the throttle timer.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May start the next unit.
+ *
+ *----------------------------------------------------------------------
+ */
+
+/*ARGSUSED*/
+static void
+sweepTimerProc(clientData, callInfoPtr)
+    ClientData		 clientData;
+    Proc_CallInfo	*callInfoPtr;
+{
+    RaidSweepControl	*sweepPtr = (RaidSweepControl *) clientData;
+
+    MASTER_LOCK(&sweepPtr->mutex);
+    sweepPtr->throttled = 0;
+    if (sweepPtr->busy) {
+	MASTER_UNLOCK(&sweepPtr->mutex);
+	return;
+    }
+    sweepPtr->busy = 1;
+    MASTER_UNLOCK(&sweepPtr->mutex);
+    RunSweep(sweepPtr);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StartDelay --
+ *
+ *	Compute how long to wait after starting a unit before the next
+ *	one may be started.
+ *
+ * Results:
+ *	The delay in milliseconds, 0 if the next unit may start at once.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+StartDelay(sweepPtr)
+    RaidSweepControl	*sweepPtr;
+{
+    Raid		*raidPtr = sweepPtr->raidPtr;
+    int			 delayMs = 0;
+
+    if (raidSweepMaxKBPerSec > 0) {
+	delayMs = (raidPtr->numCol * (raidPtr->bytesPerStripeUnit / 1024)
+		* 1000) / raidSweepMaxKBPerSec;
+    }
+    if (raidPtr->numReqInSys > 0) {
+	delayMs = MAX(delayMs, sweepPtr->busyDelayMs);
+    }
+    return delayMs;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RunSweep --
+ *
+ *	Retire finished units in order, start new units and finish the
+ *	sweep when there is nothing left to do.  Called by the one process
+ *	that has set sweepPtr->busy; that process keeps going until a
+ *	check made with the mutex held finds no work.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Calls the start, retire and done procedures.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RunSweep(sweepPtr)
+    RaidSweepControl	*sweepPtr;
+{
+    Raid			*raidPtr = sweepPtr->raidPtr;
+    RaidReconstructionControl	*ctrlPtr;
+    int				 index;
+    int				 limit;
+    int				 delayMs;
+
+    for (;;) {
+	MASTER_LOCK(&sweepPtr->mutex);
+	/*
+	 * Retire the oldest unit if it is done.
+	 */
+	index = sweepPtr->doneUnit % sweepPtr->maxInFlight;
+	ctrlPtr = sweepPtr->slot[index];
+	if (sweepPtr->numInFlight > 0 && ctrlPtr->done) {
+	    sweepPtr->slot[index] = (RaidReconstructionControl *) NIL;
+	    sweepPtr->doneUnit++;
+	    sweepPtr->numInFlight--;
+	    MASTER_UNLOCK(&sweepPtr->mutex);
+	    sweepPtr->retireProc(ctrlPtr);
+	    if (ctrlPtr->status != SUCCESS) {
+		sweepPtr->status = FAILURE;
+	    }
+	    MASTER_LOCK(&sweepPtr->mutex);
+	    sweepPtr->freeList[sweepPtr->numFree++] = ctrlPtr;
+	    MASTER_UNLOCK(&sweepPtr->mutex);
+	    continue;
+	}
+	/*
+	 * Finish when everything has been retired.  A pending throttle
+	 * timer will come back here, so leave the finishing to it.
+	 */
+	if (sweepPtr->numInFlight == 0 && !sweepPtr->throttled &&
+		(sweepPtr->stopped || sweepPtr->nextUnit >= sweepPtr->endUnit)) {
+	    MASTER_UNLOCK(&sweepPtr->mutex);
+	    if (sweepPtr->finishProc != (void (*)()) NIL) {
+		sweepPtr->finishProc(sweepPtr);
+	    }
+	    sweepPtr->doneProc(sweepPtr->clientData, sweepPtr->status);
+	    FreeSweepControl(sweepPtr);
+	    return;
+	}
+	/*
+	 * Start another unit if the window, the foreground load and the
+	 * throttle allow it.
+	 */
+	limit = (raidPtr->numReqInSys > 0) ? 1 : sweepPtr->maxInFlight;
+	if (!sweepPtr->stopped && !sweepPtr->throttled &&
+		sweepPtr->nextUnit < sweepPtr->endUnit &&
+		sweepPtr->nextUnit < sweepPtr->doneUnit + sweepPtr->maxInFlight &&
+		sweepPtr->numInFlight < limit) {
+	    if (sweepPtr->numFree > 0) {
+		ctrlPtr = sweepPtr->freeList[--sweepPtr->numFree];
+	    } else {
+		ctrlPtr = (RaidReconstructionControl *) NIL;
+	    }
+	    index = sweepPtr->nextUnit % sweepPtr->maxInFlight;
+	    sweepPtr->numInFlight++;
+	    MASTER_UNLOCK(&sweepPtr->mutex);
+
+	    if (ctrlPtr == (RaidReconstructionControl *) NIL) {
+		ctrlPtr = Raid_MakeReconstructionControl(raidPtr,
+			sweepPtr->col, sweepPtr->row, sweepPtr->diskPtr,
+			(void (*)()) NIL, (ClientData) NIL, sweepPtr->ctrlData);
+		ctrlPtr->sweepPtr = sweepPtr;
+	    }
+	    ctrlPtr->status = SUCCESS;
+	    ctrlPtr->done = 0;
+
+	    MASTER_LOCK(&sweepPtr->mutex);
+	    ctrlPtr->unit = sweepPtr->nextUnit++;
+	    sweepPtr->slot[index] = ctrlPtr;
+	    delayMs = StartDelay(sweepPtr);
+	    if (delayMs > 0) {
+		sweepPtr->throttled = 1;
+	    }
+	    MASTER_UNLOCK(&sweepPtr->mutex);
+
+	    if (delayMs > 0) {
+		Proc_CallFunc(sweepTimerProc, (ClientData) sweepPtr,
+			(unsigned) delayMs * timer_IntOneMillisecond);
+	    }
+	    sweepPtr->startProc(ctrlPtr);
+	    continue;
+	}
+	sweepPtr->busy = 0;
+	MASTER_UNLOCK(&sweepPtr->mutex);
+	return;
+    }
+}
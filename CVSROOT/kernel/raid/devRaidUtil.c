@@ -74,6 +74,7 @@ InitRaidBlockRequest(reqPtr, raidPtr, operation, col, row, diskSector,
     reqPtr->row                  = row;
     reqPtr->diskPtr              = raidPtr->disk[col][row];
     reqPtr->version              = reqPtr->diskPtr->version;
+    reqPtr->issued               = FALSE;
 }
 
 
@@ -177,6 +178,7 @@ Raid_MakeIOControl(doneProc, clientData)
     IOControlPtr->amountTransferred	= 0;
     IOControlPtr->numFailed		= 0;
     IOControlPtr->failedReqPtr		= (RaidBlockRequest *) NIL;
+    IOControlPtr->reqControlPtr		= (RaidRequestControl *) NIL;
 
     return IOControlPtr;
 }
@@ -397,6 +399,9 @@ Raid_MakeReconstructionControl(raidPtr, col, row, diskPtr, doneProc, clientData,
     reconstructionControlPtr->ctrlData      = ctrlData;
     reconstructionControlPtr->reqControlPtr = Raid_MakeRequestControl(raidPtr);
     reconstructionControlPtr->status        = SUCCESS;
+    reconstructionControlPtr->sweepPtr      = (RaidSweepControl *) NIL;
+    reconstructionControlPtr->unit          = 0;
+    reconstructionControlPtr->done          = 0;
     reconstructionControlPtr->parityBuf     =
 #ifdef NODATA
 	    (char *) NIL;
@@ -484,7 +489,9 @@ Raid_RangeRestrict(start, len, rangeOffset, rangeLen, fieldLen, newStart, newLen
  *
  *	Xor's the contents of the buffers of the requests in *reqControlPtr 
  *	restricted by rangeOffset and rangeLen and place the result in 
- *	*destBuf.
+ *	*destBuf.  Requests that cover the same part of the range are
+ *	handed to XorN together so that *destBuf is only passed over once
+ *	for all of them.
  *
  * Results:
  *      *destBuf.
@@ -507,8 +514,16 @@ Raid_XorRangeRequests(reqControlPtr, raidPtr, destBuf, rangeOffset, rangeLen)
     int			 rangeStartAddress;
     int			 newRangeLen;
     int			 i;
+    char		*sourceArray[RAID_XOR_MAX_SOURCES];
+    int			 numSources;
+    char		*batchDest;
+    int			 batchLen;
+    char		*destPtr;
 
     rangeOffset = StripeUnitOffset(raidPtr, rangeOffset);
+    numSources = 0;
+    batchDest = (char *) NIL;
+    batchLen = 0;
     for (i = 0; i < reqControlPtr->numReq; i++) {
 	reqPtr = &reqControlPtr->reqPtr[i];
 	if (reqPtr->state == REQ_READY || reqPtr->state == REQ_COMPLETED ) {
@@ -516,12 +531,23 @@ Raid_XorRangeRequests(reqControlPtr, raidPtr, destBuf, rangeOffset, rangeLen)
 		    reqPtr->devReq.bufferLen,
 		    rangeOffset, rangeLen, raidPtr->bytesPerStripeUnit,
 		    &rangeStartAddress, &newRangeLen);
-            Xor2(newRangeLen, reqPtr->devReq.buffer +
-		    	    (rangeStartAddress - reqPtr->devReq.startAddress),
-		    destBuf + StripeUnitOffset(raidPtr,
-			    rangeStartAddress)-rangeOffset);
+	    destPtr = destBuf + StripeUnitOffset(raidPtr,
+		    rangeStartAddress)-rangeOffset;
+	    if (numSources > 0 && (destPtr != batchDest ||
+		    newRangeLen != batchLen ||
+		    numSources == RAID_XOR_MAX_SOURCES)) {
+		XorN(batchLen, numSources, sourceArray, batchDest);
+		numSources = 0;
+	    }
+	    batchDest = destPtr;
+	    batchLen = newRangeLen;
+	    sourceArray[numSources++] = reqPtr->devReq.buffer +
+		    (rangeStartAddress - reqPtr->devReq.startAddress);
 	}
     }
+    if (numSources > 0) {
+	XorN(batchLen, numSources, sourceArray, batchDest);
+    }
 }
 
 
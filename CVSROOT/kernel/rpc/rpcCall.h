@@ -203,7 +203,7 @@ ReturnStatus Proc_RpcRemoteCall();	/*  PROC_REMOTE_CALL */
 ReturnStatus Fs_RpcStartMigration();	/*  FS_MIGRATE */
 ReturnStatus Fs_RpcConsist();		/*  FS_CONSIST */
 ReturnStatus Fs_RpcDevOpen();		/*  FS_DEV_OPEN */
-ReturnStatus Sync_RemoteNotifyStub();	/*  REMOTE_WAKEUP */
+ReturnStatus Fsio_RpcRemoteWakeup();	/*  REMOTE_WAKEUP */
 ReturnStatus Proc_RpcRemoteWait();	/*  PROC_REMOTE_WAIT */
 ReturnStatus Fs_RpcSelectStub();		/*  FS_SELECT */
 ReturnStatus Fs_RpcIOControl();		/*  FS_RPC_IO_CONTROL */
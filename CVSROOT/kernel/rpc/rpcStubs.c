@@ -81,7 +81,7 @@ RpcService rpcService[RPC_LAST_COMMAND+1] = {
 	Proc_RpcRemoteCall, "rmt call",		/* 36 - PROC_REMOTE_CALL */
 	Proc_RpcRemoteWait, "remote wait",	/* 37 - PROC_REMOTE_WAIT */
 	Proc_RpcGetPCB, "get PCB",		/* 38 - PROC_GETPCB */
-	Sync_RemoteNotifyStub, "rmt notify",	/* 39 - REMOTE_WAKEUP */
+	Fsio_RpcRemoteWakeup, "rmt notify",	/* 39 - REMOTE_WAKEUP */
 	Sig_RpcSend, "send signal",		/* 40 - SIG_SEND */
 	Fsio_RpcStreamMigCloseNew, "new release",/* 41 - FS_RELEASE_NEW */
 	Fsrmt_RpcBulkReopen, "bulkReopen",	/* 42 - FS_BULK_REOPEN */
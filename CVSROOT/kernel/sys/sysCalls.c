@@ -30,6 +30,7 @@ static char rcsid[] = "$Header$ SPRITE (Berkeley)";
 #include <net.h>
 #include <sched.h>
 #include <dev.h>
+#include <devDiskStats.h>
 #include <recov.h>
 #include <recovBox.h>
 #include <procMigrate.h>
@@ -880,6 +881,38 @@ Sys_StatsStub(command, option, argPtr)
 	    }
 	    break;
 	}
+	case SYS_DISK_MERGE_STATS: {
+	    int			count;
+	    DevDiskMergeStats	*statArrPtr;
+
+	    if ((option < 0) || (option > 10000)) {
+		status = GEN_INVALID_ARG;
+	    } else {
+		statArrPtr = (DevDiskMergeStats *)
+				    malloc(sizeof(DevDiskMergeStats) * option);
+		count = Dev_GetDiskMergeStats(statArrPtr, option);
+		status = Vm_CopyOut(sizeof(DevDiskMergeStats) * count,
+				    (Address)statArrPtr, (Address)argPtr);
+		free((Address) statArrPtr);
+	    }
+	    break;
+	}
+	case SYS_DISK_IO_STATS: {
+	    int			count;
+	    DevDiskIOStats	*statArrPtr;
+
+	    if ((option < 0) || (option > 1000)) {
+		status = GEN_INVALID_ARG;
+	    } else {
+		statArrPtr = (DevDiskIOStats *)
+					malloc(sizeof(DevDiskIOStats) * option);
+		count = Dev_GetDiskIOStats(statArrPtr, option);
+		status = Vm_CopyOut(sizeof(DevDiskIOStats) * count,
+				    (Address)statArrPtr, (Address)argPtr);
+		free((Address) statArrPtr);
+	    }
+	    break;
+	}
 	case SYS_LOCK_STATS: {
 	    status = Sync_GetLockStats(option, argPtr);
 	    break;
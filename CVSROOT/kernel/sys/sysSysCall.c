@@ -306,6 +306,8 @@ static SysCallEntry sysCalls[] = {
     ErrorProc,   		ErrorProc,   		TRUE,	3,   NILPARM,
     Sys_GetHostName,		Proc_DoRemoteCall, 	FALSE,	1,   NILPARM,
     Sys_SetHostName,		Proc_DoRemoteCall, 	FALSE,	1,   NILPARM,
+    Fs_CreateEventSetStub,	Fs_CreateEventSetStub,	TRUE,	1,   NILPARM,
+    Fs_SpliceStub,		Fs_SpliceStub,		TRUE,	4,   NILPARM,
 };
 
 
@@ -494,6 +496,8 @@ static Sys_CallParam paramsArray[] = {
     /* local */				/* SYS_ZEBRA_CMD		110 */
     SYS_PARAM_HOSTNAME,		PARM_OC,	/* SYS_SYS_GET_HOSTNAME	111 */
     SYS_PARAM_HOSTNAME,		PARM_IA,	/* SYS_SYS_SET_HOSTNAME	112 */
+    /* local */				/* SYS_FS_CREATE_EVENT_SET 113 */
+    /* local */				/* SYS_FS_SPLICE	114 */
 
     /*
      * Insert new system call information above this line.
@@ -129,7 +129,9 @@
 #define SYS_ZEBRA_CMD 		110
 #define SYS_SYS_GET_HOSTNAME	111
 #define SYS_SYS_SET_HOSTNAME	112
+#define SYS_FS_CREATE_EVENT_SET	113
+#define SYS_FS_SPLICE		114
 
-#define SYS_NUM_SYSCALLS	113
+#define SYS_NUM_SYSCALLS	115
 
 #endif /* _SYSSYSCALL */
@@ -205,9 +205,101 @@ typedef struct Vm_Segment {
 					 * can ever have. */
     Address		maxAddr;	/* Maximium address that the segment
 					 * can ever have. */
+    int			numForkCORPages;/* Number of pages that were shared
+					 * copy-on-reference rather than
+					 * copied when this segment was
+					 * forked. */
+    int			numCOWBreaks;	/* Number of copy-on-write faults
+					 * in this segment that had to copy
+					 * a page. */
+    int			numCORBreaks;	/* Number of copy-on-reference
+					 * faults in this segment that had
+					 * to copy a page. */
+    int			*swapMapPtr;	/* Swap area cluster of each group of
+					 * vmSwapClusterPages pages of swap
+					 * space, for segments whose swap
+					 * space is in the swap area. */
+    int			swapMapSize;	/* Number of entries in swapMapPtr. */
+    unsigned int	*swapWrittenPtr;/* For each entry of swapMapPtr, a
+					 * bit for each page of the cluster
+					 * that has been written. */
     int			dummy;
 } Vm_Segment;
 
+/*
+ * Per-segment copy-on-write statistics, returned by the
+ * VM_GET_SEG_COW_STATS command to Vm_Cmd.  The argument is a pointer to
+ * one of these structures with segNum filled in.
+ */
+typedef struct Vm_SegCOWStats {
+    int		segNum;			/* Segment to get statistics for. */
+    int		numCOWPages;		/* Pages currently copy-on-write. */
+    int		numCORPages;		/* Pages currently copy-on-ref. */
+    int		numForkCORPages;	/* Pages shared rather than copied
+					 * when the segment was forked. */
+    int		numCOWBreaks;		/* COW faults that copied a page. */
+    int		numCORBreaks;		/* COR faults that copied a page. */
+} Vm_SegCOWStats;
+
+#define	VM_GET_SEG_COW_STATS	2000
+
+/*
+ * Swap area statistics, returned by the VM_GET_SWAP_AREA_STATS command to
+ * Vm_Cmd.  VM_SET_USE_SWAP_AREA turns use of the swap area on or off for
+ * segments that haven't opened their swap space yet.
+ */
+typedef struct Vm_SwapAreaStats {
+    int		useSwapArea;		/* TRUE if new segments use the area. */
+    int		clusterPages;		/* Pages in each cluster. */
+    int		numClusters;		/* Clusters in the area. */
+    int		freeClusters;		/* Clusters not allocated. */
+    int		numSegs;		/* Segments using the area. */
+    int		clustersAllocated;	/* Clusters allocated. */
+    int		clustersFreed;		/* Clusters freed. */
+    int		contigAllocs;		/* Clusters allocated next to the
+					 * segment's neighbouring cluster. */
+    int		allocFailures;		/* Page-outs that found the area
+					 * full. */
+    int		fileFallbacks;		/* Segments given a swap file because
+					 * the area was nearly full. */
+    int		pagesRead;		/* Pages read from the area. */
+    int		pagesWritten;		/* Pages written to the area. */
+    int		pagesDetached;		/* Pages moved to swap files for
+					 * migration. */
+    int		reopens;		/* Times the stream was reopened
+					 * because it became invalid. */
+} Vm_SwapAreaStats;
+
+#define	VM_SET_USE_SWAP_AREA	2001
+#define	VM_GET_SWAP_AREA_STATS	2002
+
+/*
+ * Set the number of passes over a migrating process's memory that are made
+ * before it is frozen.  Zero turns pre-copying off.
+ */
+#define	VM_SET_MIG_PRE_COPY	2003
+
+/*
+ * Statistics about the pool of pre-zeroed free pages, and commands to size
+ * the pool and to get the statistics.  Setting the pool size to zero stops
+ * the zero page daemon.
+ */
+typedef struct Vm_ZeroPageStats {
+    int		poolTarget;		/* Pages the daemon tries to keep
+					 * zeroed. */
+    int		poolPages;		/* Pages currently zeroed. */
+    int		pagesZeroed;		/* Pages zeroed by the daemon. */
+    int		poolHits;		/* Zero-fill faults given a
+					 * pre-zeroed page. */
+    int		poolMisses;		/* Zero-fill faults that had to clear
+					 * the page themselves. */
+    int		zeroedTaken;		/* Zeroed pages used for something
+					 * other than a zero-fill fault. */
+} Vm_ZeroPageStats;
+
+#define	VM_SET_ZERO_POOL_PAGES	2004
+#define	VM_GET_ZERO_PAGE_STATS	2005
+
 /*
  * Pointer to the system segment.
  */
@@ -268,6 +360,17 @@ typedef struct Vm_SegProcList {
  */
 #define VM_COPY_IN_PROGRESS             0x01
 
+/*
+ * A range of user addresses for the scatter/gather copy routines.  A list
+ * of these is pinned once with Vm_PinUserRanges and then copied to or from
+ * with Vm_CopyInRanges and Vm_CopyOutRanges without taking page faults.
+ */
+typedef struct Vm_UserRange {
+    Address	addr;		/* Start of the range in the user's address
+				 * space. */
+    int		numBytes;	/* Number of bytes in the range. */
+} Vm_UserRange;
+
 /*
  * Maximum number of pages that a user process can wire down with the
  * Vm_PinUserMem call.
@@ -327,6 +430,7 @@ extern Address Vm_RawAlloc _ARGS_((int numBytes));
 /*
  * Procedures for process migration.
  */
+extern int Vm_MigratePreCopy _ARGS_((Proc_ControlBlock *procPtr));
 extern ReturnStatus Vm_InitiateMigration _ARGS_((Proc_ControlBlock *procPtr, int hostID, Proc_EncapInfo *infoPtr));
 extern ReturnStatus Vm_EncapState _ARGS_((register Proc_ControlBlock *procPtr, int hostID, Proc_EncapInfo *infoPtr, Address bufferPtr));
 extern ReturnStatus Vm_DeencapState _ARGS_((register Proc_ControlBlock *procPtr, Proc_EncapInfo *infoPtr, Address buffer));
@@ -367,6 +471,10 @@ extern ReturnStatus Vm_CopyOutProc _ARGS_((int numBytes, Address fromAddr,
 	Address toAddr));
 extern ReturnStatus Vm_StringNCopy _ARGS_((int numBytes,
 	Address sourcePtr, Address destPtr, int *bytesCopiedPtr));
+extern ReturnStatus Vm_CopyInRanges _ARGS_((int numRanges,
+	Vm_UserRange *rangePtr, Address toAddr));
+extern ReturnStatus Vm_CopyOutRanges _ARGS_((int numBytes, Address fromAddr,
+	int numRanges, Vm_UserRange *rangePtr));
 extern void Vm_MakeAccessible _ARGS_((int accessType, int numBytes,
 	Address startAddr, register int *retBytesPtr,
 	register Address *retAddrPtr));
@@ -388,6 +496,11 @@ extern void Vm_ProcInit _ARGS_((Proc_ControlBlock *procPtr));
 extern ReturnStatus Vm_PinUserMem _ARGS_((int mapType, int numBytes,
 	register Address addr));
 extern void Vm_UnpinUserMem _ARGS_((int numBytes, Address addr));
+extern void Vm_UnpinProcMem _ARGS_((Proc_ControlBlock *procPtr,
+	int numBytes, Address addr));
+extern ReturnStatus Vm_PinUserRanges _ARGS_((int mapType, int numRanges,
+	Vm_UserRange *rangePtr));
+extern void Vm_UnpinUserRanges _ARGS_((int numRanges, Vm_UserRange *rangePtr));
 extern void Vm_ReservePage _ARGS_((unsigned int pfNum));
 extern Boolean VmMach_VirtAddrParse _ARGS_((Proc_ControlBlock *procPtr,
 	Address virtAddr, register Vm_VirtAddr *transVirtAddrPtr));
@@ -40,8 +40,23 @@
  * onto B.  Otherwise the swap space behind A is copied to B's backing store.
  * 
  * When a segment is migrated, a copy of it has to be made.  This is done by
- * calling the routine VmCOWCopy.  For each COR page a COR fault is simulated.
- * For each COW page a COW fault is simulated.
+ * calling the routine VmCOWCopySeg.  For each COW page a COW fault is
+ * simulated.  COR pages are not faulted in since the segment is about to
+ * be written to swap anyway; instead the master's copy of each COR page is
+ * written (or copied on swap) straight into the migrating segment's swap
+ * file.
+ *
+ * Segments that back private file mappings (see VmIsPrivateMap) are
+ * handled exactly like heap segments: Vm_CopySharedMem forks them
+ * through Vm_SegmentDup and hence VmSegFork.  Pages of such a segment that
+ * are still only in the mapped file are not shared at all; both segments
+ * just demand load them from the file.  If the master of a COR page has
+ * dropped a clean copy of the page then the page is also loaded from the
+ * file.
+ *
+ * Each segment counts the pages it got COR at fork time and the COW and
+ * COR faults that actually had to copy a page, so that the savings of
+ * copy-on-write can be seen per segment.
  *
  * SYNCHRONIZATION
  *
@@ -122,7 +137,10 @@ static ReturnStatus COR _ARGS_((register Vm_VirtAddr *virtAddrPtr,
 	register Vm_PTE *ptePtr));
 static void COW _ARGS_((register Vm_VirtAddr *virtAddrPtr,
 	register Vm_PTE *ptePtr, Boolean isResident, Boolean deletePage));
-static unsigned int GetMasterPF();
+static unsigned int GetMasterPF _ARGS_((Vm_Segment *mastSegPtr,
+	int virtPage, Boolean *onSwapPtr));
+static ReturnStatus CORToSwap _ARGS_((register Vm_VirtAddr *virtAddrPtr,
+	register Vm_PTE *ptePtr));
 static void SeeIfLastCOR _ARGS_((register Vm_Segment *mastSegPtr,
 	int page));
 
@@ -196,7 +214,7 @@ DoFork(srcSegPtr, destSegPtr)
 
     corPTE = VM_VIRT_RES_BIT | VM_COR_BIT | srcSegPtr->segNum;
 
-    if (srcSegPtr->type == VM_HEAP) {
+    if (srcSegPtr->type != VM_STACK) {
 	virtPage = srcSegPtr->offset;
 	lastPage = virtPage + srcSegPtr->numPages - 1;
 	srcPTEPtr = srcSegPtr->ptPtr;
@@ -257,15 +275,16 @@ DoFork(srcSegPtr, destSegPtr)
 
     cowInfoPtr = srcSegPtr->cowInfoPtr;
     if (numCORPages > 0) {
-	if (srcSegPtr->type == VM_HEAP) {
-	    vmStat.numCOWHeapPages += numCOWPages;
-	    vmStat.numCORHeapPages += numCORPages;
-	} else {
+	if (srcSegPtr->type == VM_STACK) {
 	    vmStat.numCOWStkPages += numCOWPages;
 	    vmStat.numCORStkPages += numCORPages;
+	} else {
+	    vmStat.numCOWHeapPages += numCOWPages;
+	    vmStat.numCORHeapPages += numCORPages;
 	}
 	srcSegPtr->numCOWPages += numCOWPages;
 	destSegPtr->numCORPages = numCORPages;
+	destSegPtr->numForkCORPages = numCORPages;
 	/*
 	 * Insert the child into the COW list for the parent segment.
 	 */
@@ -290,9 +309,12 @@ DoFork(srcSegPtr, destSegPtr)
  *	copy-on-write and copy-on-reference pages.  This segment will
  *	be removed from its copy-on-write chain.  It is assumed that the
  *	calling segment has the in-use count of its page tables incremented.
+ *	This is only used for migration so copy-on-reference pages are
+ *	put directly onto this segment's swap file rather than faulted
+ *	into memory.
  *
  * Results:
- *	None.
+ *	Status from writing or copying swap space for a COR page.
  *
  * Side effects:
  *	Memory for a COW info struct may be freed.
@@ -330,7 +352,7 @@ VmCOWCopySeg(segPtr)
 	    COW(&virtAddr, ptePtr, IsResident(ptePtr), FALSE);
 	    VmPageValidate(&virtAddr);
 	} else if (*ptePtr & VM_COR_BIT) {
-	    status = COR(&virtAddr, ptePtr);
+	    status = CORToSwap(&virtAddr, ptePtr);
 	    if (status != SUCCESS) {
 		break;
 	    }
@@ -722,16 +744,28 @@ COR(virtAddrPtr, ptePtr)
     unsigned	int		mastVirtPF;
     ReturnStatus		status;
     int				corCheckBit;
+    Boolean			onSwap;
 
     mastSegPtr = VmGetSegPtr((int) (Vm_GetPageFrame(*ptePtr)));
     virtFrameNum = VmPageAllocate(virtAddrPtr, VM_CAN_BLOCK);
-    mastVirtPF = GetMasterPF(mastSegPtr, virtAddrPtr->page);
+    mastVirtPF = GetMasterPF(mastSegPtr, virtAddrPtr->page, &onSwap);
     if (mastVirtPF != 0) {
 	/*
 	 * The page is resident in memory so copy it.
 	 */
 	CopyPage(mastVirtPF, virtFrameNum);
 	VmUnlockPage(mastVirtPF);
+    } else if (!onSwap) {
+	/*
+	 * The master dropped a clean copy of the page so it is the same
+	 * as what is in the file.  Load it from there.
+	 */
+	status = VmFileServerRead(virtAddrPtr, virtFrameNum);
+	if (status != SUCCESS) {
+	    printf("Warning: VmCOR: Couldn't read page, status <%x>\n", status);
+	    VmPageFree(virtFrameNum);
+	    return(status);
+	}
     } else {
 	/*
 	 * Load the page off of swap space.
@@ -754,6 +788,7 @@ COR(virtAddrPtr, ptePtr)
     if (virtAddrPtr->segPtr->numCORPages < 0) {
 	panic("COR: numCORPages < 0\n");
     }
+    virtAddrPtr->segPtr->numCORBreaks++;
     if (vmCORReadOnly) {
 	corCheckBit = VM_COR_CHECK_BIT | VM_READ_ONLY_PROT;
     } else {
@@ -769,6 +804,67 @@ COR(virtAddrPtr, ptePtr)
 }
 
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * CORToSwap --
+ *
+ *	Resolve a copy-on-reference page of a segment that is being
+ *	migrated.  Rather than faulting the page into memory only to have
+ *	it written back out by the migration code, the master's copy of
+ *	the page is written directly to this segment's swap file, or
+ *	copied there if the master's copy is on swap.  If the master only
+ *	has the page in the file then so do we.
+ *
+ * Results:
+ *	Status from writing or copying the swap page.
+ *
+ * Side effects:
+ *	Page table entry for the page is changed to refer to swap space
+ *	(or the file) and the page is no longer COR.
+ *
+ *----------------------------------------------------------------------
+ */
+static ReturnStatus
+CORToSwap(virtAddrPtr, ptePtr)
+    register	Vm_VirtAddr	*virtAddrPtr;
+    register	Vm_PTE		*ptePtr;
+{
+    register	Vm_Segment	*mastSegPtr;
+    unsigned	int		mastVirtPF;
+    Boolean			onSwap;
+    ReturnStatus		status = SUCCESS;
+    Vm_PTE			pte;
+
+    mastSegPtr = VmGetSegPtr((int) (Vm_GetPageFrame(*ptePtr)));
+    mastVirtPF = GetMasterPF(mastSegPtr, virtAddrPtr->page, &onSwap);
+    pte = VM_VIRT_RES_BIT | VM_ON_SWAP_BIT;
+    if (mastVirtPF != 0) {
+	status = VmPageServerWrite(virtAddrPtr, mastVirtPF, FALSE);
+	VmUnlockPage(mastVirtPF);
+    } else if (onSwap) {
+	status = VmCopySwapPage(mastSegPtr, virtAddrPtr->page,
+				virtAddrPtr->segPtr);
+    } else {
+	pte = VM_VIRT_RES_BIT;
+    }
+    if (status != SUCCESS) {
+	printf("Warning: CORToSwap: Couldn't copy page, status <%x>\n",
+		status);
+	return(status);
+    }
+
+    virtAddrPtr->segPtr->numCORPages--;
+    if (virtAddrPtr->segPtr->numCORPages < 0) {
+	panic("CORToSwap: numCORPages < 0\n");
+    }
+    virtAddrPtr->segPtr->numCORBreaks++;
+    SetPTE(virtAddrPtr, pte);
+    SeeIfLastCOR(mastSegPtr, virtAddrPtr->page);
+    return(SUCCESS);
+}
+
+
 /*
  *----------------------------------------------------------------------
  *
@@ -779,7 +875,8 @@ COR(virtAddrPtr, ptePtr)
  *
  * Results:
  *	The page frame from the masters PTE.  0 if not resident.
- *	Otherwise SUCCESS.
+ *	*onSwapPtr is set to TRUE if the page is on the master's swap
+ *	space.
  *
  * Side effects:
  *	Page frame returned locked if resident.
@@ -787,9 +884,10 @@ COR(virtAddrPtr, ptePtr)
  *----------------------------------------------------------------------
  */
 static unsigned int
-GetMasterPF(mastSegPtr, virtPage)
+GetMasterPF(mastSegPtr, virtPage, onSwapPtr)
     Vm_Segment	*mastSegPtr;
     int		virtPage;
+    Boolean	*onSwapPtr;
 {
     unsigned	int	pf;
     register	Vm_PTE	*mastPTEPtr;
@@ -797,6 +895,7 @@ GetMasterPF(mastSegPtr, virtPage)
     LOCK_MONITOR;
 
     mastPTEPtr = VmGetPTEPtr(mastSegPtr, virtPage);
+    *onSwapPtr = (*mastPTEPtr & VM_ON_SWAP_BIT) ? TRUE : FALSE;
     if (*mastPTEPtr & VM_PHYS_RES_BIT) {
 	pf = Vm_GetPageFrame(*mastPTEPtr);
 	VmLockPageInt(pf);
@@ -1006,8 +1105,9 @@ COW(virtAddrPtr, ptePtr, isResident, deletePage)
 		SetPTE(&virtAddr, pte);
 		VmUnlockPage(virtFrameNum);
 		VmUnlockPage(Vm_GetPageFrame(*ptePtr));
+		virtAddrPtr->segPtr->numCOWBreaks++;
 	    }
-	} else {
+	} else if (*ptePtr & VM_ON_SWAP_BIT) {
 	    /*
 	     * The page is on swap space.
 	     */
@@ -1018,6 +1118,16 @@ COW(virtAddrPtr, ptePtr, isResident, deletePage)
 		pte |= VM_COW_BIT;
 	    }
 	    SetPTE(&virtAddr, pte);
+	} else {
+	    /*
+	     * A clean page that was dropped from memory.  The new master
+	     * can load it from the file just like we would have.
+	     */
+	    pte = VM_VIRT_RES_BIT;
+	    if (others) {
+		pte |= VM_COW_BIT;
+	    }
+	    SetPTE(&virtAddr, pte);
 	}
 	if (mastSegPtr->numCOWPages == 0 && mastSegPtr->numCORPages == 0) {
 	    mastSegPtr->cowInfoPtr->numSegs--;
@@ -275,6 +275,30 @@ extern	Boolean	vmWriteableRefPageout;	/* Page out all pages that have been
 					 * before recycling them whether they
 					 * have been modified or not. */
 
+/*
+ * Variables to control the swap area.
+ */
+extern	Boolean	vmUseSwapArea;		/* TRUE if heap and stack segments
+					 * should swap to the swap area. */
+extern	int	vmSwapClusterPages;	/* Pages in each swap area cluster. */
+
+/*
+ * Variables to control migration.
+ */
+extern	int	vmMigPreCopyPasses;	/* Passes over a migrating process's
+					 * memory made before it is frozen. */
+extern	int	vmMigPreCopyMinPages;	/* Stop pre-copying when a pass
+					 * writes fewer pages than this. */
+
+/*
+ * Variables to control the zero page daemon.
+ */
+extern	int	vmZeroPoolPages;	/* Number of pre-zeroed free pages
+					 * to keep. */
+extern	int	vmZeroBatchPages;	/* Pages zeroed each time the daemon
+					 * runs. */
+extern	int	vmZeroInterval;		/* Time between runs of the daemon. */
+
 /*
  * Flags for VmPageAllocate and VmPageAllocateInt:
  *
@@ -368,6 +392,8 @@ typedef enum {
  *				the page tables.
  *   VM_DEBUGGED_SEG		This is a special code segment that is being
  *				written by the debugger.
+ *   VM_SWAP_AREA_SEG		The swap space for this segment is in the
+ *				swap area rather than a swap file.
  *   VM_SEG_CANT_COW		This segment cannot be forked copy-on-write.
  *   VM_SEG_COW_IN_PROGRESS	This segment is being actively copied at
  *				fork time.
@@ -382,7 +408,7 @@ typedef enum {
 #define	VM_SEG_DEAD			0x010
 #define	VM_PT_EXCL_ACC			0x020
 #define	VM_DEBUGGED_SEG			0x040
-/* 0x080 is not used */
+#define	VM_SWAP_AREA_SEG		0x080
 #define	VM_SEG_CANT_COW			0x100
 #define	VM_SEG_COW_IN_PROGRESS		0x200
 #define VM_SEG_IO_ERROR		        0x400
@@ -434,12 +460,15 @@ typedef struct VmCore {
  * VM_PAGE_BEING_CLEANED	The page is actually being cleaned.
  * VM_DONT_FREE_UNTIL_CLEAN	This page cannot be freed until it has
  *				been written out.
+ * VM_ZEROED_PAGE		The page is free and is known to be filled
+ *				with zeroes.
  */
 #define VM_FREE_PAGE 			0x01
 #define VM_DIRTY_PAGE 			0x02
 #define VM_SEG_PAGEOUT_WAIT 		0x04
 #define VM_PAGE_BEING_CLEANED		0x08
 #define	VM_DONT_FREE_UNTIL_CLEAN	0x10
+#define	VM_ZEROED_PAGE			0x20
 
 /*
  * Copy-on-write info struct.
@@ -488,6 +517,15 @@ extern int vmShmDebug;
 	(&((virtAddrPtr)->segPtr->ptPtr[(page) - segOffset(virtAddrPtr)])))
 #endif /* CLEAN */
 
+/*
+ * Macro to determine if a segment backs a private (MAP_PRIVATE) file
+ * mapping.  Such segments demand load from the mapped file like a heap
+ * but keep modified pages in a swap file of their own, so they can be
+ * forked copy-on-write.
+ */
+#define	VmIsPrivateMap(segPtr) \
+    ((segPtr)->type == VM_SHARED && (segPtr)->filePtr != (Fs_Stream *)NIL)
+
 /*
  * Macro to increment a page table pointer.
  */
@@ -520,6 +558,9 @@ extern	unsigned int	VmPageAllocate _ARGS_((Vm_VirtAddr *virtAddrPtr,
 		int flags));
 extern	unsigned int	VmPageAllocateInt _ARGS_((Vm_VirtAddr *virtAddrPtr,
 		int flags));
+extern	unsigned int	VmPageAllocateZero _ARGS_((Vm_VirtAddr *virtAddrPtr,
+		int flags));
+extern	void		VmGetZeroPageStats _ARGS_((Vm_ZeroPageStats *statsPtr));
 extern	unsigned int	VmGetReservePage _ARGS_((Vm_VirtAddr *virtAddrPtr));
 /*
  * Routine to free pags.
@@ -564,8 +605,10 @@ extern VmDeleteStatus VmSegmentDeleteInt _ARGS_((register Vm_Segment *segPtr,
 	register Proc_ControlBlock *procPtr, VmProcLink **procLinkPtrPtr,
 	Fs_Stream **objStreamPtrPtr, Boolean migFlag));
 extern void VmDecPTUserCount _ARGS_((register Vm_Segment *segPtr));
+extern void VmIncPTUserCount _ARGS_((register Vm_Segment *segPtr));
 extern	Vm_Segment	*VmGetSegPtr _ARGS_((int segNum));
 extern void VmFlushSegment _ARGS_((Vm_VirtAddr *virtAddrPtr, int lastPage));
+extern int VmPreCopySegment _ARGS_((register Vm_Segment *segPtr));
 extern Vm_SegProcList *VmFindSharedSegment _ARGS_((List_Links *sharedSegs,
 	Address virtAddr));
 extern Boolean VmCheckSharedSegment _ARGS_((Proc_ControlBlock *procPtr,
@@ -617,10 +660,25 @@ extern ReturnStatus VmFileServerRead _ARGS_((Vm_VirtAddr *virtAddrPtr,
 	unsigned int pageFrame));
 extern void VmMakeSwapName _ARGS_((int segNum, char *fileName));
 extern ReturnStatus VmOpenSwapFile _ARGS_((register Vm_Segment *segPtr));
+extern ReturnStatus VmCreateSwapFile _ARGS_((register Vm_Segment *segPtr));
 extern ReturnStatus VmCopySwapPage _ARGS_((register Vm_Segment *srcSegPtr,
 	int virtPage, register Vm_Segment *destSegPtr));
 extern void VmSwapFileLock _ARGS_((register Vm_Segment *segPtr));
 extern void VmSwapFileUnlock _ARGS_((register Vm_Segment *segPtr));
+/*
+ * Procedures for the swap area.
+ */
+extern ReturnStatus VmSwapAreaAttach _ARGS_((register Vm_Segment *segPtr));
+extern void VmSwapAreaFree _ARGS_((register Vm_Segment *segPtr));
+extern ReturnStatus VmSwapAreaRead _ARGS_((Vm_Segment *segPtr, int pageIndex,
+	Address pageAddr));
+extern ReturnStatus VmSwapAreaWrite _ARGS_((Vm_Segment *segPtr,
+	int pageIndex, Address pageAddr, Boolean toDisk));
+extern ReturnStatus VmSwapPageCopy _ARGS_((Vm_Segment *srcSegPtr,
+	Vm_Segment *destSegPtr, int pageIndex));
+extern ReturnStatus VmSwapAreaDetach _ARGS_((register Vm_Segment *segPtr));
+extern void VmSwapAreaGetStats _ARGS_((Vm_SwapAreaStats *statsPtr));
+extern void VmSwapAreaRecover _ARGS_((void));
 /*
  * Procedures for process migration.
  */
@@ -41,8 +41,95 @@ ENTRY static ReturnStatus CheckSharers _ARGS_((register Vm_Segment *segPtr,
  */
 #define NUM_FIELDS 5
 
+/*
+ * Before a process is frozen for migration its modified pages are written
+ * to swap in up to vmMigPreCopyPasses passes while it keeps running.  Each
+ * pass only writes the pages modified since the last one, and pre-copying
+ * stops once a pass writes fewer than vmMigPreCopyMinPages pages.  What is
+ * left is written by FlushSegment while the process is frozen.
+ */
+int	vmMigPreCopyPasses = 3;
+int	vmMigPreCopyMinPages = 8;
+
 
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Vm_MigratePreCopy --
+ *
+ *	Write the modified pages of a process that is about to migrate to
+ *	swap space while it is still running, so that fewer pages have to
+ *	be written once it is frozen.  The process is locked on entry and
+ *	exit but is unlocked while the pages are written.  Processes that
+ *	share their heap are skipped since they can't migrate anyway.
+ *
+ * Results:
+ *	The number of pages written.
+ *
+ * Side effects:
+ *	Modified pages of the heap and stack are cleaned.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Vm_MigratePreCopy(procPtr)
+    Proc_ControlBlock *procPtr;			/* process being migrated */
+{
+    Vm_Segment		*segPtrArray[VM_NUM_SEGMENTS];
+    int			seg;
+    int			pass;
+    int			passPages;
+    int			numPages = 0;
+
+    if (vmMigPreCopyPasses <= 0 || (procPtr->genFlags & PROC_NO_VM)) {
+	return(0);
+    }
+    for (seg = VM_HEAP; seg < VM_NUM_SEGMENTS; seg++) {
+	if (procPtr->vmPtr->segPtrArray[seg] == (Vm_Segment *)NIL) {
+	    return(0);
+	}
+    }
+    if (procPtr->vmPtr->segPtrArray[VM_HEAP]->refCount > 1) {
+	return(0);
+    }
+    /*
+     * Count ourselves as a user of the segments' page tables so they stay
+     * around if the process exits while it is unlocked.  This is what
+     * prefetch does; taking a reference instead would make the segments
+     * look shared to the copy-on-write and sharing checks.
+     */
+    for (seg = VM_HEAP; seg < VM_NUM_SEGMENTS; seg++) {
+	segPtrArray[seg] = procPtr->vmPtr->segPtrArray[seg];
+	VmIncPTUserCount(segPtrArray[seg]);
+    }
+    Proc_Unlock(procPtr);
+    for (pass = 0; pass < vmMigPreCopyPasses; pass++) {
+	passPages = 0;
+	for (seg = VM_HEAP; seg < VM_NUM_SEGMENTS; seg++) {
+	    passPages += VmPreCopySegment(segPtrArray[seg]);
+	}
+	numPages += passPages;
+	if (passPages < vmMigPreCopyMinPages) {
+	    break;
+	}
+    }
+    for (seg = VM_HEAP; seg < VM_NUM_SEGMENTS; seg++) {
+	VmDecPTUserCount(segPtrArray[seg]);
+    }
+    Proc_Lock(procPtr);
+
+#ifndef CLEAN
+    if (proc_MigDoStats) {
+	Proc_MigAddToCounter(numPages,
+			     &proc_MigStats.varStats.preCopyPages,
+			     &proc_MigStats.squared.preCopyPages);
+    }
+#endif /* CLEAN */
+    return(numPages);
+}
+
+
 /*
  *----------------------------------------------------------------------
  *
@@ -426,6 +513,19 @@ EncapSegment(segPtr, procPtr, bufPtrPtr)
 	varSize = sizeof(Vm_ExecInfo);
     }
 
+    if (segPtr->flags & VM_SWAP_AREA_SEG) {
+	/*
+	 * The other host can't get at the swap area, so move the swap
+	 * space into a swap file.  All the pages are out by now.
+	 */
+	Proc_Unlock(procPtr);
+	status = VmSwapAreaDetach(segPtr);
+	Proc_Lock(procPtr);
+	if (status != SUCCESS) {
+	    return(status);
+	}
+    }
+
     ptr = *bufPtrPtr;
     bcopy((Address) &segPtr->offset, ptr, NUM_FIELDS * sizeof(int));
     ptr += NUM_FIELDS * sizeof(int);
@@ -88,6 +88,29 @@ static	List_Links	reservePageListHdr;
 #define	freePageList	(&freePageListHdr)
 #define	reservePageList	(&reservePageListHdr)
 
+/*
+ * The zeroed list is a sublist of the free list.  It holds free pages that
+ * the zero page daemon has already filled with zeroes so that zero-fill
+ * page faults don't have to clear a page.  Pages on it have both
+ * VM_FREE_PAGE and VM_ZEROED_PAGE set and are counted in
+ * vmStat.numFreePages.  Ordinary allocations only take pages from it when
+ * the free list proper is empty.
+ */
+static	List_Links	zeroPageListHdr;
+#define	zeroPageList	(&zeroPageListHdr)
+static	int		numZeroedPages = 0;
+
+/*
+ * Number of pre-zeroed pages the zero page daemon tries to keep around,
+ * the maximum number of pages it clears each time that it runs and how
+ * often it runs.  Setting vmZeroPoolPages to 0 turns the daemon off.
+ */
+int	vmZeroPoolPages = 32;
+int	vmZeroBatchPages = 4;
+int	vmZeroInterval;
+static	Boolean		zeroDaemonRunning = FALSE;
+static	Vm_ZeroPageStats	zeroStats;
+
 /*
  * Condition to wait for a clean page to be put onto the allocate list.
  */
@@ -129,6 +152,14 @@ int	vmPhysPageLimit = -1;
 static void PageOut _ARGS_((ClientData data, Proc_CallInfo *callInfoPtr));
 static void PutOnReserveList _ARGS_((register VmCore *corePtr));
 static void PutOnFreeList _ARGS_((register VmCore *corePtr));
+static VmCore *TakeFreePage _ARGS_((Boolean wantZeroed));
+static unsigned int PageAllocate _ARGS_((Vm_VirtAddr *virtAddrPtr, int flags,
+				Boolean *zeroedPtr));
+static void ZeroPageDaemon _ARGS_((ClientData data,
+				Proc_CallInfo *callInfoPtr));
+static VmCore *GetPageToZero _ARGS_((void));
+static void PutOnZeroList _ARGS_((VmCore *corePtr));
+static void CountZeroAlloc _ARGS_((Boolean zeroed));
 
 
 /*
@@ -185,6 +216,7 @@ VmCoreMapInit()
     List_Init(dirtyPageList);
     List_Init(freePageList);
     List_Init(reservePageList);
+    List_Init(zeroPageList);
 
     firstKernPage = (unsigned int)mach_KernStart >> vmPageShift;
     /*
@@ -482,6 +514,55 @@ TakeOffFreeList(corePtr)
 {
     VmListRemove((List_Links *) corePtr);
     vmStat.numFreePages--;
+    if (corePtr->flags & VM_ZEROED_PAGE) {
+	corePtr->flags &= ~VM_ZEROED_PAGE;
+	numZeroedPages--;
+    }
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * TakeFreePage --
+ *
+ *     	Take a page off of the free list or the zeroed list.  If wantZeroed
+ *	is set then a page from the zeroed list is preferred, otherwise
+ *	the zeroed list is only used when the free list is empty.
+ *
+ * Results:
+ *     	The core map entry of the page or NIL if no free pages.  The
+ *	VM_ZEROED_PAGE flag is left set in the returned entry if the page
+ *	is known to be zero filled.
+ *
+ * Side effects:
+ *	Free list or zeroed list modified.
+ * ----------------------------------------------------------------------------
+ */
+INTERNAL static VmCore *
+TakeFreePage(wantZeroed)
+    Boolean	wantZeroed;
+{
+    register	VmCore	*corePtr;
+
+    if (wantZeroed && !List_IsEmpty(zeroPageList)) {
+	corePtr = (VmCore *) List_First(zeroPageList);
+    } else if (!List_IsEmpty(freePageList)) {
+	corePtr = (VmCore *) List_First(freePageList);
+    } else if (!List_IsEmpty(zeroPageList)) {
+	corePtr = (VmCore *) List_First(zeroPageList);
+	if (!wantZeroed) {
+	    zeroStats.zeroedTaken++;
+	}
+    } else {
+	return((VmCore *) NIL);
+    }
+    VmListRemove((List_Links *) corePtr);
+    vmStat.numFreePages--;
+    if (corePtr->flags & VM_ZEROED_PAGE) {
+	numZeroedPages--;
+    }
+    return(corePtr);
 }
 
 
@@ -883,7 +964,7 @@ Vm_GetRefTime()
 	return((int) 0x7fffffff);
     }
 
-    if (!List_IsEmpty(freePageList)) {
+    if (!List_IsEmpty(freePageList) || !List_IsEmpty(zeroPageList)) {
 	vmStat.haveFreePage++;
 	refTime = 0;
 	if (vmDebug) {
@@ -936,18 +1017,24 @@ Vm_GetRefTime()
  * ----------------------------------------------------------------------------
  */
 ENTRY static void
-GetRefTime(refTimePtr, pagePtr)
+GetRefTime(refTimePtr, pagePtr, zeroedPtr)
     register	int	*refTimePtr;
     unsigned	int	*pagePtr;
+    Boolean		*zeroedPtr;	/* If not NIL then a pre-zeroed page 
+					 * is wanted and this is set to TRUE
+					 * if one was returned. */
 {
     register	VmCore	*corePtr; 
 
     LOCK_MONITOR;
 
-    if (!List_IsEmpty(freePageList)) {
+    corePtr = TakeFreePage(zeroedPtr != (Boolean *) NIL);
+    if (corePtr != (VmCore *) NIL) {
 	vmStat.gotFreePage++;
-	corePtr = (VmCore *) List_First(freePageList);
-	TakeOffFreeList(corePtr);
+	if (zeroedPtr != (Boolean *) NIL) {
+	    *zeroedPtr = (corePtr->flags & VM_ZEROED_PAGE) ? TRUE : FALSE;
+	}
+	corePtr->flags &= ~VM_ZEROED_PAGE;
 	*pagePtr = corePtr - coreMap;
     } else {
 	*refTimePtr = (int) 0x7fffffff;
@@ -1033,6 +1120,106 @@ VmPageAllocate(virtAddrPtr, flags)
     Vm_VirtAddr	*virtAddrPtr;	/* The translated virtual address that this
 				 * page frame is being allocated for */
     int		flags;		/* VM_CAN_BLOCK | VM_ABORT_WHEN_DIRTY. */
+{
+    return(PageAllocate(virtAddrPtr, flags, (Boolean *) NIL));
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * VmPageAllocateZero --
+ *
+ *     	Return a page frame that is filled with zeroes.  A page is taken
+ *	from the pool of pre-zeroed pages if there is one, otherwise a page
+ *	is allocated as in VmPageAllocate and cleared here.
+ *
+ * Results:
+ *     	The page frame number that is allocated.
+ *
+ * Side effects:
+ *     	The zeroed list may be modified.
+ *
+ * ----------------------------------------------------------------------------
+ */
+unsigned int
+VmPageAllocateZero(virtAddrPtr, flags)
+    Vm_VirtAddr	*virtAddrPtr;	/* The translated virtual address that this
+				 * page frame is being allocated for */
+    int		flags;		/* VM_CAN_BLOCK | VM_ABORT_WHEN_DIRTY. */
+{
+    unsigned	int	page;
+    Boolean		zeroed;
+
+    zeroed = FALSE;
+    page = PageAllocate(virtAddrPtr, flags, &zeroed);
+    if (page == VM_NO_MEM_VAL) {
+	return(page);
+    }
+    CountZeroAlloc(zeroed);
+    if (!zeroed) {
+	VmZeroPage(page);
+    }
+    return(page);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * CountZeroAlloc --
+ *
+ *     	Count an allocation of a zero filled page as a hit or a miss in
+ *	the pool of pre-zeroed pages.
+ *
+ * Results:
+ *     	None.
+ *
+ * Side effects:
+ *     	zeroStats updated.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ENTRY static void
+CountZeroAlloc(zeroed)
+    Boolean	zeroed;		/* TRUE if the page came off the zeroed list. */
+{
+    LOCK_MONITOR;
+
+    if (zeroed) {
+	zeroStats.poolHits++;
+    } else {
+	zeroStats.poolMisses++;
+    }
+
+    UNLOCK_MONITOR;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * PageAllocate --
+ *
+ *     	Do the work for VmPageAllocate and VmPageAllocateZero.
+ *
+ * Results:
+ *     	The page frame number that is allocated.  If zeroedPtr is not NIL
+ *	then *zeroedPtr is set to TRUE if the page came off of the zeroed
+ *	list.
+ *
+ * Side effects:
+ *     	None.
+ *
+ * ----------------------------------------------------------------------------
+ */
+static unsigned int
+PageAllocate(virtAddrPtr, flags, zeroedPtr)
+    Vm_VirtAddr	*virtAddrPtr;	/* The translated virtual address that this
+				 * page frame is being allocated for */
+    int		flags;		/* VM_CAN_BLOCK | VM_ABORT_WHEN_DIRTY. */
+    Boolean	*zeroedPtr;	/* Where to return whether the page is
+				 * already zero filled, or NIL. */
 {
     unsigned	int	page;
     int			refTime;
@@ -1040,7 +1227,7 @@ VmPageAllocate(virtAddrPtr, flags)
 
     vmStat.numAllocs++;
 
-    GetRefTime(&refTime, &page);
+    GetRefTime(&refTime, &page, zeroedPtr);
     if (page == VM_NO_MEM_VAL) {
 	Fscache_GetPageFromFS(refTime + vmCurPenalty, &tPage);
 	if (tPage == -1) {
@@ -1111,9 +1298,9 @@ VmPageAllocateInt(virtAddrPtr, flags)
     vmStat.numListSearches++;
 
 again:
-    if (!List_IsEmpty(freePageList)) {
-	corePtr = (VmCore *) List_First(freePageList);
-	TakeOffFreeList(corePtr);
+    corePtr = TakeFreePage(FALSE);
+    if (corePtr != (VmCore *) NIL) {
+	corePtr->flags &= ~VM_ZEROED_PAGE;
 	vmStat.usedFreePage++;
     } else {
 	/*
@@ -1563,7 +1750,11 @@ Vm_PageIn(virtAddr, protFault)
     /*
      * Allocate a page.
      */
-    virtFrameNum = VmPageAllocate(&transVirtAddr, TRUE);
+    if (*ptePtr & VM_ZERO_FILL_BIT) {
+	virtFrameNum = VmPageAllocateZero(&transVirtAddr, TRUE);
+    } else {
+	virtFrameNum = VmPageAllocate(&transVirtAddr, TRUE);
+    }
     *ptePtr |= virtFrameNum;
 
     if (transVirtAddr.segPtr->type == VM_SHARED && debugVmStubs) {
@@ -1575,7 +1766,6 @@ Vm_PageIn(virtAddr, protFault)
      */
     if (*ptePtr & VM_ZERO_FILL_BIT) {
 	vmStat.zeroFilled++;
-	VmZeroPage(virtFrameNum);
 	*ptePtr |= VM_MODIFIED_BIT;
 	status = SUCCESS;
     } else if (*ptePtr & VM_ON_SWAP_BIT) {
@@ -1981,12 +2171,38 @@ void
 Vm_UnpinUserMem(numBytes, addr)
     int		numBytes;	/* The number of bytes to map. */
     Address 	addr;		/* The address to start mapping at. */
+{
+    Vm_UnpinProcMem(Proc_GetCurrentProc(), numBytes, addr);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * Vm_UnpinProcMem --
+ *
+ *      Unlock the pages between addr and addr + numBytes of the given
+ *	process, which pinned them with Vm_PinUserMem.  This lets a device
+ *	release the pages of a transfer from another process's context.
+ *	The process must not have released its segments.
+ *
+ * Results:
+ *     None.
+ *
+ * Side effects:
+ *     None.
+ *
+ * ----------------------------------------------------------------------------
+ */
+void
+Vm_UnpinProcMem(procPtr, numBytes, addr)
+    Proc_ControlBlock	*procPtr;	/* Process that pinned the pages. */
+    int			numBytes;	/* Number of bytes to unpin. */
+    Address 		addr;		/* The address to start at. */
 {
     Vm_VirtAddr	 		virtAddr;
-    Proc_ControlBlock		*procPtr;
     int				lastPage;
 
-    procPtr = Proc_GetCurrentProc();
     VmVirtAddrParse(procPtr, addr, &virtAddr);
     lastPage = (unsigned int)(addr + numBytes - 1) >> vmPageShift;
     /*
@@ -2055,6 +2271,86 @@ UnpinPages(virtAddrPtr, lastPage)
 }
 
 
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * Vm_PinUserRanges --
+ *
+ *      Hardwire the pages for a list of user address ranges so that they
+ *	can be copied to and from repeatedly without faulting.  This lets
+ *	scatter/gather I/O validate all of its buffers once up front.
+ *
+ * Results:
+ *     SUCCESS if all of the ranges were pinned and SYS_ARG_NOACCESS
+ *     otherwise.  On failure the ranges before the bad one are unpinned
+ *     again.
+ *
+ * Side effects:
+ *     Pages in the ranges are wired down in memory.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ReturnStatus
+Vm_PinUserRanges(mapType, numRanges, rangePtr)
+    int		 mapType;	/* VM_READONLY_ACCESS | VM_READWRITE_ACCESS */
+    int		 numRanges;	/* Number of ranges to pin. */
+    Vm_UserRange *rangePtr;	/* The ranges to pin. */
+{
+    ReturnStatus	status = SUCCESS;
+    register int	i;
+
+    for (i = 0; i < numRanges; i++) {
+	if (rangePtr[i].numBytes < 0) {
+	    status = SYS_ARG_NOACCESS;
+	    break;
+	}
+	if (rangePtr[i].numBytes == 0) {
+	    continue;
+	}
+	status = Vm_PinUserMem(mapType, rangePtr[i].numBytes, rangePtr[i].addr);
+	if (status != SUCCESS) {
+	    break;
+	}
+    }
+    if (status != SUCCESS) {
+	Vm_UnpinUserRanges(i, rangePtr);
+    }
+    return(status);
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * Vm_UnpinUserRanges --
+ *
+ *      Unlock the pages for a list of ranges pinned by Vm_PinUserRanges.
+ *
+ * Results:
+ *     None.
+ *
+ * Side effects:
+ *     Pages in the ranges may become pageable again.
+ *
+ * ----------------------------------------------------------------------------
+ */
+void
+Vm_UnpinUserRanges(numRanges, rangePtr)
+    int		 numRanges;	/* Number of ranges to unpin. */
+    Vm_UserRange *rangePtr;	/* The ranges to unpin. */
+{
+    register int	i;
+
+    for (i = 0; i < numRanges; i++) {
+	if (rangePtr[i].numBytes > 0) {
+	    Vm_UnpinUserMem(rangePtr[i].numBytes, rangePtr[i].addr);
+	}
+    }
+}
+
+
 
 /*
  * ----------------------------------------------------------------------------
@@ -2243,7 +2539,8 @@ PageOutPutAndGet(corePtrPtr, status, doRecoveryPtr, recStreamPtrPtr)
 			 * We have not realized that we have an error yet.
 			 * Mark the swap server as down, and return a
 			 * pointer to the swap stream.  If it isn't open
-			 * yet we'll return NIL, and our caller should use
+			 * yet, or the segment is in the swap area, we'll
+			 * return NIL, and our caller should use
 			 * vmSwapStreamPtr for recovery, which is guarded
 			 * by a different monitor.
 			 */
@@ -2494,11 +2791,172 @@ Vm_Clock(data, callInfoPtr)
         vmClockSleep = timer_IntOneSecond;
 	initialized = TRUE;
     }
+    if (!zeroDaemonRunning && vmZeroPoolPages > 0) {
+	/*
+	 * Start up the zero page daemon.  It reschedules itself after this.
+	 */
+	zeroDaemonRunning = TRUE;
+	Proc_CallFunc(ZeroPageDaemon, (ClientData) NIL, 0);
+    }
     callInfoPtr->interval = vmClockSleep;
     UNLOCK_MONITOR;
     return;
 }
 
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * ZeroPageDaemon --
+ *
+ *	Fill free pages with zeroes and move them onto the zeroed list so
+ *	that zero-fill faults can be satisfied without clearing a page.  At
+ *	most vmZeroBatchPages pages are cleared each time that this routine
+ *	is called, and nothing is done while pages are being cleaned, so
+ *	that the daemon only uses time that nobody else wants.  The pages
+ *	are cleared without the monitor lock held.
+ *
+ * Results:
+ *     	None.
+ *
+ * Side effects:
+ *     	Free list and zeroed list modified.
+ *
+ * ----------------------------------------------------------------------------
+ */
+/* ARGSUSED */
+static void
+ZeroPageDaemon(data, callInfoPtr)
+    ClientData		data;
+    Proc_CallInfo	*callInfoPtr;
+{
+    register	VmCore	*corePtr;
+    int			i;
+
+    if (vmZeroInterval == 0) {
+	vmZeroInterval = timer_IntOneSecond / 4;
+    }
+    for (i = 0; i < vmZeroBatchPages; i++) {
+	corePtr = GetPageToZero();
+	if (corePtr == (VmCore *) NIL) {
+	    break;
+	}
+	VmZeroPage((unsigned int) (corePtr - coreMap));
+	PutOnZeroList(corePtr);
+    }
+    if (vmZeroPoolPages <= 0) {
+	zeroDaemonRunning = FALSE;
+	callInfoPtr->interval = 0;
+    } else {
+	callInfoPtr->interval = vmZeroInterval;
+    }
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * GetPageToZero --
+ *
+ *	Take a page off of the free list for the zero page daemon to clear.
+ *
+ * Results:
+ *     	The core map entry of the page, or NIL if the zeroed list is full,
+ *	there are no free pages that need to be cleared or pages are
+ *	being written out.
+ *
+ * Side effects:
+ *     	The page is removed from the free list and locked down.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ENTRY static VmCore *
+GetPageToZero()
+{
+    register	VmCore	*corePtr;
+
+    LOCK_MONITOR;
+
+    if (numZeroedPages >= vmZeroPoolPages || List_IsEmpty(freePageList) ||
+	!List_IsEmpty(dirtyPageList) || swapDown) {
+	UNLOCK_MONITOR;
+	return((VmCore *) NIL);
+    }
+    corePtr = (VmCore *) List_First(freePageList);
+    TakeOffFreeList(corePtr);
+    corePtr->flags = 0;
+    corePtr->lockCount = 1;
+
+    UNLOCK_MONITOR;
+    return(corePtr);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * PutOnZeroList --
+ *
+ *	Put a page that the zero page daemon has cleared onto the zeroed
+ *	list.
+ *
+ * Results:
+ *     	None.
+ *
+ * Side effects:
+ *     	Zeroed list or reserve list modified.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ENTRY static void
+PutOnZeroList(corePtr)
+    VmCore	*corePtr;
+{
+    LOCK_MONITOR;
+
+    if (vmStat.numReservePages < NUM_RESERVE_PAGES) {
+	PutOnReserveList(corePtr);
+    } else {
+	corePtr->flags = VM_FREE_PAGE | VM_ZEROED_PAGE;
+	corePtr->lockCount = 0;
+	VmListInsert((List_Links *) corePtr, LIST_ATREAR(zeroPageList));
+	vmStat.numFreePages++;
+	numZeroedPages++;
+	zeroStats.pagesZeroed++;
+    }
+
+    UNLOCK_MONITOR;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * VmGetZeroPageStats --
+ *
+ *	Return statistics about the pre-zeroed page pool.
+ *
+ * Results:
+ *     	None.
+ *
+ * Side effects:
+ *     	None.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ENTRY void
+VmGetZeroPageStats(statsPtr)
+    Vm_ZeroPageStats	*statsPtr;
+{
+    LOCK_MONITOR;
+
+    *statsPtr = zeroStats;
+    statsPtr->poolPages = numZeroedPages;
+    statsPtr->poolTarget = vmZeroPoolPages;
+
+    UNLOCK_MONITOR;
+}
+
 /*
  * ----------------------------------------------------------------------------
  *
@@ -2615,6 +3073,110 @@ VmFlushSegment(virtAddrPtr, lastPage)
     UNLOCK_MONITOR;
 }
 
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * VmPreCopySegment --
+ *
+ *	Write the modified pages of a segment to swap space while the
+ *	processes using it keep running.  This is used to copy most of a
+ *	migrating process's memory before it is frozen.  The pages stay
+ *	resident and mapped; only their modified bits are cleared.  Pages
+ *	that are locked or already being cleaned are left alone.  Wait for
+ *	the writes to finish so that a following pass only sees pages that
+ *	were modified during this one.  The caller must hold a page table
+ *	user count on the segment.
+ *
+ * Results:
+ *     	The number of pages written.
+ *
+ * Side effects:
+ *     	Modified pages are put on the dirty list and cleaned.
+ *
+ * ----------------------------------------------------------------------------
+ */
+ENTRY int
+VmPreCopySegment(segPtr)
+    register	Vm_Segment	*segPtr;
+{
+    register	Vm_PTE		*ptePtr;
+    register	VmCore		*corePtr;
+    register	int		i;
+    Vm_VirtAddr			virtAddr;
+    Vm_PTE			*firstPTEPtr;
+    int				firstPage;
+    int				numPages = 0;
+    Boolean			referenced;
+    Boolean			modified;
+    Boolean			waited;
+
+    LOCK_MONITOR;
+
+    if (segPtr->ptPtr == (Vm_PTE *)NIL || (segPtr->flags & VM_SEG_DEAD)) {
+	UNLOCK_MONITOR;
+	return(0);
+    }
+    virtAddr.segPtr = segPtr;
+    virtAddr.sharedPtr = (Vm_SegProcList *)NIL;
+    if (segPtr->type == VM_STACK) {
+	firstPage = mach_LastUserStackPage - segPtr->numPages + 1;
+    } else {
+	firstPage = segPtr->offset;
+    }
+    firstPTEPtr = VmGetPTEPtr(segPtr, firstPage);
+
+    for (i = 0, ptePtr = firstPTEPtr, virtAddr.page = firstPage;
+	 i < segPtr->numPages;
+	 i++, VmIncPTEPtr(ptePtr, 1), virtAddr.page++) {
+	if (!(*ptePtr & VM_PHYS_RES_BIT)) {
+	    continue;
+	}
+	corePtr = &coreMap[Vm_GetPageFrame(*ptePtr)];
+	if (corePtr->lockCount > 0 ||
+	    (corePtr->flags & (VM_DIRTY_PAGE | VM_PAGE_BEING_CLEANED))) {
+	    continue;
+	}
+	referenced = *ptePtr & VM_REFERENCED_BIT;
+	modified = *ptePtr & VM_MODIFIED_BIT;
+	VmMach_GetRefModBits(&virtAddr, Vm_GetPageFrame(*ptePtr),
+			     &referenced, &modified);
+	if (!modified) {
+	    continue;
+	}
+	*ptePtr |= VM_MODIFIED_BIT;
+	TakeOffAllocList(corePtr);
+	PutOnDirtyList(corePtr);
+	numPages++;
+    }
+
+    /*
+     * Wait for the page-out daemon to get through this segment's pages.
+     * The caller counts itself as a user of the page tables, so the
+     * segment can't be expanded or deleted while we wait.
+     */
+    do {
+	waited = FALSE;
+	for (i = 0, ptePtr = firstPTEPtr;
+	     i < segPtr->numPages && numPages > 0;
+	     i++, VmIncPTEPtr(ptePtr, 1)) {
+	    if (!(*ptePtr & VM_PHYS_RES_BIT)) {
+		continue;
+	    }
+	    corePtr = &coreMap[Vm_GetPageFrame(*ptePtr)];
+	    if (corePtr->flags & (VM_DIRTY_PAGE | VM_PAGE_BEING_CLEANED)) {
+		corePtr->flags |= VM_SEG_PAGEOUT_WAIT;
+		(void) Sync_Wait(&segPtr->condition, FALSE);
+		waited = TRUE;
+		break;
+	    }
+	}
+    } while (waited && !(segPtr->flags & VM_SEG_DEAD));
+
+    UNLOCK_MONITOR;
+    return(numPages);
+}
+
 
 /*
  *----------------------------------------------------------------------
@@ -2839,7 +3401,8 @@ Vm_FsCacheSize(startAddrPtr, endAddrPtr)
  *
  *	The swap area has just come back up.  Wake up anyone waiting for it to
  *	come back and start up page cleaners if there are dirty pages to be
- *	written out.
+ *	written out.  The swap area stream is checked first, since it is
+ *	reopened if its recovery failed.
  *
  * Results:
  *	None.
@@ -2852,6 +3415,8 @@ Vm_FsCacheSize(startAddrPtr, endAddrPtr)
 ENTRY void
 Vm_Recovery()
 {
+    VmSwapAreaRecover();
+
     LOCK_MONITOR;
 
     swapDown = FALSE;
@@ -2951,6 +3516,7 @@ VmPageFlush(virtAddrPtr, length, toDisk, wantRes)
 	 * This stuff should probably be in the fs module.
 	 */
 	if (streamPtr != (Fs_Stream *)NIL &&
+		!(segPtr->flags & VM_SWAP_AREA_SEG) &&
 		streamPtr->ioHandlePtr->fileID.type == FSIO_RMT_FILE_STREAM) {
 	    cacheInfoPtr = & ((Fsrmt_FileIOHandle *)streamPtr
 		    ->ioHandlePtr)->cacheInfo;
@@ -144,6 +144,9 @@ VmSegTableInit()
     for (i = 0, segPtr = segmentTable; i < vmNumSegments; i++, segPtr++) {
 	segPtr->filePtr = (Fs_Stream *)NIL;
 	segPtr->swapFilePtr = (Fs_Stream *)NIL;
+	segPtr->swapMapPtr = (int *)NIL;
+	segPtr->swapMapSize = 0;
+	segPtr->swapWrittenPtr = (unsigned int *)NIL;
 	segPtr->segNum = i;
 	segPtr->cowInfoPtr = (VmCOWInfo *)NIL;
 	segPtr->procList = (List_Links *) &(segPtr->procListHdr);
@@ -568,9 +571,15 @@ GetNewSegment(type, filePtr, fileAddr, numPages, offset, procPtr,
 	segPtr->numPages = numPages;
 	segPtr->numCORPages = 0;
 	segPtr->numCOWPages = 0;
+	segPtr->numForkCORPages = 0;
+	segPtr->numCOWBreaks = 0;
+	segPtr->numCORBreaks = 0;
 	segPtr->type = type;
 	segPtr->offset = offset;
 	segPtr->swapFileName = (char *) NIL;
+	segPtr->swapMapPtr = (int *)NIL;
+	segPtr->swapMapSize = 0;
+	segPtr->swapWrittenPtr = (unsigned int *)NIL;
 	segPtr->ptPtr = spacePtr->ptPtr;
 	segPtr->ptSize = spacePtr->ptSize;
 	bzero((Address)segPtr->ptPtr, segPtr->ptSize * sizeof(Vm_PTE));
@@ -832,7 +841,11 @@ DeleteSeg(segPtr)
 	(void)Fs_Close(segPtr->filePtr);
 	segPtr->filePtr = (Fs_Stream *)NIL;
     }
-    if (segPtr->flags & VM_SWAP_FILE_OPENED) {
+    if (segPtr->flags & VM_SWAP_AREA_SEG) {
+	VmSwapAreaFree(segPtr);
+	segPtr->flags &= ~VM_SWAP_FILE_OPENED;
+	segPtr->swapFilePtr = (Fs_Stream *)NIL;
+    } else if (segPtr->flags & VM_SWAP_FILE_OPENED) {
 	VmSwapFileRemove(segPtr->swapFilePtr, segPtr->swapFileName);
 	segPtr->swapFilePtr = (Fs_Stream *)NIL;
 	segPtr->swapFileName = (char *)NIL;
@@ -946,7 +959,7 @@ Vm_DeleteFromSeg(segPtr, firstPage, lastPage)
      * to get access to the page tables until the exclusive access flag
      * is cleared.  This flag is set by StartDelete and cleared by EndDelete. 
      * The flag is looked at by VmVirtAddrParse (the routine that is called 
-     * before any page fault can occur on the segment) and by IncPTUserCount
+     * before any page fault can occur on the segment) and by VmIncPTUserCount
      * (the routine that is called when a segment is duplicated for a fork).
      */
     if (!StartDelete(segPtr, firstPage, &lastPage)) {
@@ -1393,7 +1406,6 @@ AddToSeg(segPtr, firstPage, lastPage, newNumPages, newSpace, oldSpacePtr)
     return(SUCCESS);
 }
 
-static void IncPTUserCount _ARGS_((register Vm_Segment *segPtr));
 static void CopyInfo _ARGS_((register Vm_Segment *srcSegPtr, register Vm_Segment *destSegPtr, register Vm_PTE **srcPTEPtrPtr, register Vm_PTE **destPTEPtrPtr, Vm_VirtAddr *srcVirtAddrPtr, Vm_VirtAddr *destVirtAddrPtr));
 ENTRY static Boolean CopyPage _ARGS_((Vm_Segment *srcSegPtr,
 	register Vm_PTE *srcPTEPtr, register Vm_PTE *destPTEPtr));
@@ -1409,7 +1421,9 @@ ENTRY static Boolean CopyPage _ARGS_((Vm_Segment *srcSegPtr,
  *	other processes then the segment could be being modified while it is 
  *	being copied.  Hence there is no guarantee that the segment will
  *	be in the same state after it is duplicated as it was when this
- *	routine was called.
+ *	routine was called.  Heap segments and segments that back private
+ *	file mappings get their own reference to the file they demand
+ *	load from.
  *
  * Results:
  *	VM_SWAP_ERROR if swap space could not be duplicated or VM_NO_SEGMENTS
@@ -1444,7 +1458,7 @@ Vm_SegmentDup(srcSegPtr, procPtr, destSegPtrPtr)
 #endif    
     Fs_Stream			*newFilePtr;
 
-    if (srcSegPtr->type == VM_HEAP) {
+    if (srcSegPtr->type == VM_HEAP || VmIsPrivateMap(srcSegPtr)) {
 	Fsio_StreamCopy(srcSegPtr->filePtr, &newFilePtr);
     } else {
 	newFilePtr = (Fs_Stream *) NIL;
@@ -1452,7 +1466,7 @@ Vm_SegmentDup(srcSegPtr, procPtr, destSegPtrPtr)
     /*
      * Prevent the source segment from being expanded.
      */
-    IncPTUserCount(srcSegPtr);
+    VmIncPTUserCount(srcSegPtr);
 
     /*
      * Allocate the segment that we are copying to.
@@ -1462,7 +1476,7 @@ Vm_SegmentDup(srcSegPtr, procPtr, destSegPtrPtr)
 			       srcSegPtr->offset, procPtr);
     if (destSegPtr == (Vm_Segment *) NIL) {
 	VmDecPTUserCount(srcSegPtr);
-	if (srcSegPtr->type == VM_HEAP) {
+	if (newFilePtr != (Fs_Stream *) NIL) {
 	    (void)Fs_Close(newFilePtr);
 	}
 	*destSegPtrPtr = (Vm_Segment *) NIL;
@@ -1553,7 +1567,7 @@ Vm_SegmentDup(srcSegPtr, procPtr, destSegPtrPtr)
 /*
  * ----------------------------------------------------------------------------
  *
- * IncPTUserCount --
+ * VmIncPTUserCount --
  *
  *     	Increment the count of users of the page tables for the given segment.
  *
@@ -1565,8 +1579,8 @@ Vm_SegmentDup(srcSegPtr, procPtr, destSegPtrPtr)
  *     
  * ----------------------------------------------------------------------------
  */
-ENTRY static void
-IncPTUserCount(segPtr)
+ENTRY void
+VmIncPTUserCount(segPtr)
     register	Vm_Segment	*segPtr;
 {
     LOCK_MONITOR;
@@ -1702,7 +1716,7 @@ CopyInfo(srcSegPtr, destSegPtr, srcPTEPtrPtr, destPTEPtrPtr,
 {
     LOCK_MONITOR;
 
-    if (srcSegPtr->type == VM_HEAP) {
+    if (srcSegPtr->type != VM_STACK) {
 	*srcPTEPtrPtr = srcSegPtr->ptPtr;
 	*destPTEPtrPtr = destSegPtr->ptPtr;
 	destVirtAddrPtr->page = srcSegPtr->offset;
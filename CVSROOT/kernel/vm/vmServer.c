@@ -142,11 +142,19 @@ VmPageServerRead(virtAddrPtr, pageFrame)
 
     if (segPtr->type == VM_STACK) {
 	pageToRead = mach_LastUserStackPage - virtAddrPtr->page;
-    } else if (segPtr->type == VM_SHARED) {
+    } else if (segPtr->type == VM_SHARED && !VmIsPrivateMap(segPtr)) {
+	/*
+	 * The swap file of a shared mapping is the mapped file itself.
+	 * Private mappings have a real swap file, laid out like a heap's.
+	 */
 	pageToRead= virtAddrPtr->page - segOffset(virtAddrPtr) +
 		(virtAddrPtr->sharedPtr->fileAddr>>vmPageShift);
     } else {
-	pageToRead = virtAddrPtr->page - segPtr->offset;
+	/*
+	 * Compute the offset the same way VmPageServerWrite does, so a
+	 * private mapping reads its pages back from where they were put.
+	 */
+	pageToRead = virtAddrPtr->page - segOffset(virtAddrPtr);
     }
 
     /*
@@ -154,8 +162,13 @@ VmPageServerRead(virtAddrPtr, pageFrame)
      * file server.
      */
     mappedAddr = (int) VmMapPage(pageFrame);
-    status = Fs_PageRead(segPtr->swapFilePtr, (Address) mappedAddr,
-			 pageToRead << vmPageShift, vm_PageSize, FS_SWAP_PAGE);
+    if (segPtr->flags & VM_SWAP_AREA_SEG) {
+	status = VmSwapAreaRead(segPtr, pageToRead, (Address) mappedAddr);
+    } else {
+	status = Fs_PageRead(segPtr->swapFilePtr, (Address) mappedAddr,
+			     pageToRead << vmPageShift, vm_PageSize,
+			     FS_SWAP_PAGE);
+    }
     VmUnmapPage((Address) mappedAddr);
 
     return(status);
@@ -224,8 +237,13 @@ VmPageServerWrite(virtAddrPtr, pageFrame, toDisk)
      */
     VmMach_FlushPage(virtAddrPtr, FALSE);
     mappedAddr = (int) VmMapPage(pageFrame);
-    status = Fs_PageWrite(segPtr->swapFilePtr, (Address) mappedAddr,
-			  pageToWrite << vmPageShift, vm_PageSize, toDisk);
+    if (segPtr->flags & VM_SWAP_AREA_SEG) {
+	status = VmSwapAreaWrite(segPtr, pageToWrite, (Address) mappedAddr,
+				 toDisk);
+    } else {
+	status = Fs_PageWrite(segPtr->swapFilePtr, (Address) mappedAddr,
+			      pageToWrite << vmPageShift, vm_PageSize, toDisk);
+    }
     VmUnmapPage((Address) mappedAddr);
 
     return(status);
@@ -295,9 +313,7 @@ VmCopySwapSpace(srcSegPtr, destSegPtr)
 	     * the page in the file.
 	     */
 	    vmStat.swapPagesCopied++;
-	    status = Fs_PageCopy(srcSegPtr->swapFilePtr, 
-				destSegPtr->swapFilePtr, 
-				page << vmPageShift, vm_PageSize);
+	    status = VmSwapPageCopy(srcSegPtr, destSegPtr, page);
 	    if (status != SUCCESS) {
 		break;
 	    }
@@ -453,9 +469,7 @@ VmCopySwapPage(srcSegPtr, virtPage, destSegPtr)
 	pageToCopy = virtPage - destSegPtr->offset;
     }
 
-    status = Fs_PageCopy(srcSegPtr->swapFilePtr, 
-			 destSegPtr->swapFilePtr, 
-			 pageToCopy << vmPageShift, vm_PageSize);
+    status = VmSwapPageCopy(srcSegPtr, destSegPtr, pageToCopy);
 
     return(status);
 }
@@ -1069,6 +1069,93 @@ exit:
     return(status);
 }
 
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Vm_CopyInRanges --
+ *
+ *	Gather a list of ranges in the current process's address space
+ *	into one kernel buffer.  The ranges should have been pinned with
+ *	Vm_PinUserRanges so that the copy doesn't fault.
+ *
+ * Results:
+ *	SUCCESS if the copy succeeded, SYS_ARG_NOACCESS if one of the
+ *	ranges is invalid.
+ *
+ * Side effects:
+ *	What toAddr points to is modified.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+Vm_CopyInRanges(numRanges, rangePtr, toAddr)
+    int			numRanges;	/* Number of ranges to copy. */
+    register Vm_UserRange *rangePtr;	/* The user ranges to copy from. */
+    register Address	toAddr;		/* Kernel buffer big enough to hold
+					 * all of the ranges. */
+{
+    register int	i;
+
+    for (i = 0; i < numRanges; i++, rangePtr++) {
+	if (rangePtr->numBytes <= 0) {
+	    continue;
+	}
+	if (Vm_CopyIn(rangePtr->numBytes, rangePtr->addr, toAddr) != SUCCESS) {
+	    return(SYS_ARG_NOACCESS);
+	}
+	toAddr += rangePtr->numBytes;
+    }
+    return(SUCCESS);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Vm_CopyOutRanges --
+ *
+ *	Scatter a kernel buffer over a list of ranges in the current
+ *	process's address space.  The ranges are filled in order until
+ *	numBytes have been copied.  The ranges should have been pinned with
+ *	Vm_PinUserRanges so that the copy doesn't fault.
+ *
+ * Results:
+ *	SUCCESS if the copy succeeded, SYS_ARG_NOACCESS if one of the
+ *	ranges is invalid.
+ *
+ * Side effects:
+ *	The user's ranges are modified.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+Vm_CopyOutRanges(numBytes, fromAddr, numRanges, rangePtr)
+    int			numBytes;	/* Number of bytes to copy. */
+    register Address	fromAddr;	/* Kernel buffer to copy from. */
+    int			numRanges;	/* Number of ranges to copy into. */
+    register Vm_UserRange *rangePtr;	/* The user ranges to copy to. */
+{
+    register int	i;
+    register int	toCopy;
+
+    for (i = 0; i < numRanges && numBytes > 0; i++, rangePtr++) {
+	toCopy = rangePtr->numBytes;
+	if (toCopy <= 0) {
+	    continue;
+	}
+	if (toCopy > numBytes) {
+	    toCopy = numBytes;
+	}
+	if (Vm_CopyOut(toCopy, fromAddr, rangePtr->addr) != SUCCESS) {
+	    return(SYS_ARG_NOACCESS);
+	}
+	fromAddr += toCopy;
+	numBytes -= toCopy;
+    }
+    return(SUCCESS);
+}
+
 
 /*
  *----------------------------------------------------------------------
@@ -1533,12 +1620,30 @@ Vm_CleanupSharedFile(procPtr,streamPtr)
     UNLOCK_SHM_MONITOR;
 }
 
+/*
+ * A private mapping segment of the parent and the child's duplicate of
+ * it, made by DupPrivateSegs before the fork takes the monitor.
+ */
+typedef struct PrivateDup {
+    List_Links		links;
+    Vm_SharedSegTable	*parentTabPtr;	/* Parent's segment table entry. */
+    Vm_Segment		*segPtr;	/* Child's copy, NIL if the dup
+					 * failed. */
+    Vm_SharedSegTable	*childTabPtr;	/* Child's entry, made when the
+					 * first mapping of it is copied. */
+} PrivateDup;
+
+static void DupPrivateSegs _ARGS_((Proc_ControlBlock *parentProcPtr,
+	Proc_ControlBlock *childProcPtr, List_Links *dupList));
+
 /*
  * ----------------------------------------------------------------------------
  *
  * Vm_CopySharedMem --
  *
- *     Copies shared memory data structures to handle a fork.
+ *     Copies shared memory data structures to handle a fork.  Shared
+ *     mappings are shared with the child.  Private mappings are given
+ *     to the child as a copy-on-write duplicate of the parent's segment.
  *
  * Results:
  *     None.
@@ -1556,6 +1661,16 @@ Vm_CopySharedMem(parentProcPtr, childProcPtr)
     Vm_Segment *segPtr;
     Vm_SegProcList *sharedSeg;
     Vm_SegProcList *parentSeg;
+    List_Links dupList;
+    PrivateDup *dupPtr;
+
+    /*
+     * Duplicating a segment can block on swap file I/O, so the private
+     * segments are copied before the monitor is taken.
+     */
+    List_Init(&dupList);
+    DupPrivateSegs(parentProcPtr, childProcPtr, &dupList);
+
     LOCK_SHM_MONITOR;
     if (parentProcPtr->vmPtr->sharedSegs != (List_Links *)NIL) {
 	childProcPtr->vmPtr->sharedSegs = (List_Links *)
@@ -1563,6 +1678,40 @@ Vm_CopySharedMem(parentProcPtr, childProcPtr)
 	List_Init((List_Links *)childProcPtr->vmPtr->sharedSegs);
 	LIST_FORALL(parentProcPtr->vmPtr->sharedSegs,
 		(List_Links *)parentSeg) {
+	    if (VmIsPrivateMap(parentSeg->segTabPtr->segPtr)) {
+		LIST_FORALL(&dupList, (List_Links *)dupPtr) {
+		    if (dupPtr->parentTabPtr == parentSeg->segTabPtr) {
+			break;
+		    }
+		}
+		if (List_IsAtEnd(&dupList, (List_Links *)dupPtr) ||
+			dupPtr->segPtr == (Vm_Segment *)NIL) {
+		    printf("Vm_CopySharedMem: couldn't copy mapping at %x\n",
+			    parentSeg->addr);
+		    continue;
+		}
+		if (dupPtr->childTabPtr == (Vm_SharedSegTable *)NIL) {
+		    dupPtr->childTabPtr = (Vm_SharedSegTable *)
+			    malloc(sizeof(Vm_SharedSegTable));
+		    dupPtr->childTabPtr->segPtr = dupPtr->segPtr;
+		    dupPtr->childTabPtr->serverID =
+			    dupPtr->parentTabPtr->serverID;
+		    dupPtr->childTabPtr->domain = dupPtr->parentTabPtr->domain;
+		    dupPtr->childTabPtr->fileNumber =
+			    dupPtr->parentTabPtr->fileNumber;
+		    dupPtr->childTabPtr->refCount = 0;
+		    List_Insert((List_Links *)dupPtr->childTabPtr,
+			    LIST_ATFRONT((List_Links *)&sharedSegTable));
+		}
+		sharedSeg = (Vm_SegProcList *)malloc(sizeof(Vm_SegProcList));
+		bcopy((Address)parentSeg, (Address)sharedSeg,
+			sizeof(Vm_SegProcList));
+		sharedSeg->segTabPtr = dupPtr->childTabPtr;
+		dupPtr->childTabPtr->refCount++;
+		List_Insert((List_Links *)sharedSeg,
+			LIST_ATREAR((List_Links *)childProcPtr->vmPtr->sharedSegs));
+		continue;
+	    }
 	    sharedSeg = (Vm_SegProcList *)malloc(sizeof(Vm_SegProcList));
 	    bcopy((Address)parentSeg, (Address)sharedSeg,
 		    sizeof(Vm_SegProcList));
@@ -1577,4 +1726,73 @@ Vm_CopySharedMem(parentProcPtr, childProcPtr)
 	VmMach_CopySharedMem(parentProcPtr, childProcPtr);
     }
     UNLOCK_SHM_MONITOR;
+
+    /*
+     * Free the records, and any copy that didn't end up mapped.
+     */
+    while (!List_IsEmpty(&dupList)) {
+	dupPtr = (PrivateDup *)List_First(&dupList);
+	List_Remove((List_Links *)dupPtr);
+	if (dupPtr->segPtr != (Vm_Segment *)NIL &&
+		dupPtr->childTabPtr == (Vm_SharedSegTable *)NIL) {
+	    (void)Vm_SegmentDelete(dupPtr->segPtr, childProcPtr);
+	}
+	free((Address)dupPtr);
+    }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *
+ * DupPrivateSegs --
+ *
+ *     Duplicate each segment behind a private mapping of the parent for
+ *     the child.  A private segment may be mapped by more than one entry
+ *     of the parent's list (if part of it was unmapped), but it is only
+ *     duplicated once.  Vm_SegmentDup forks it copy-on-write when it can.
+ *     This is called without the shared memory monitor since duplicating
+ *     may block.  The parent's list is only changed by the parent itself,
+ *     which is busy forking.
+ *
+ * Results:
+ *     None.
+ *
+ * Side effects:
+ *     New segments are created and recorded on the dup list.
+ *
+ * ----------------------------------------------------------------------------
+ */
+static void
+DupPrivateSegs(parentProcPtr, childProcPtr, dupList)
+    Proc_ControlBlock	*parentProcPtr;	/* Parent process. */
+    Proc_ControlBlock	*childProcPtr;	/* Child process. */
+    List_Links		*dupList;	/* List of PrivateDup to add to. */
+{
+    Vm_SegProcList	*parentSeg;
+    PrivateDup		*dupPtr;
+
+    if (parentProcPtr->vmPtr->sharedSegs == (List_Links *)NIL) {
+	return;
+    }
+    LIST_FORALL(parentProcPtr->vmPtr->sharedSegs, (List_Links *)parentSeg) {
+	if (!VmIsPrivateMap(parentSeg->segTabPtr->segPtr)) {
+	    continue;
+	}
+	LIST_FORALL(dupList, (List_Links *)dupPtr) {
+	    if (dupPtr->parentTabPtr == parentSeg->segTabPtr) {
+		break;
+	    }
+	}
+	if (!List_IsAtEnd(dupList, (List_Links *)dupPtr)) {
+	    continue;
+	}
+	dupPtr = (PrivateDup *)malloc(sizeof(PrivateDup));
+	dupPtr->parentTabPtr = parentSeg->segTabPtr;
+	dupPtr->childTabPtr = (Vm_SharedSegTable *)NIL;
+	if (Vm_SegmentDup(parentSeg->segTabPtr->segPtr, childProcPtr,
+		&dupPtr->segPtr) != SUCCESS) {
+	    dupPtr->segPtr = (Vm_Segment *)NIL;
+	}
+	List_Insert((List_Links *)dupPtr, LIST_ATREAR(dupList));
+    }
 }
@@ -0,0 +1,1073 @@
+/*
+ * vmSwapArea.c --
+ *
+ *	This file manages the swap area.  The swap area is a single
+ *	preallocated file in the swap directory that backs the swap space
+ *	of heap and stack segments in place of the per-segment swap files.
+ *	Using it means paging out a segment never creates, truncates or
+ *	removes a file, and the page-out daemon's writes go to a region
+ *	that is laid out for paging.
+ *
+ *	The area is divided into clusters of vmSwapClusterPages
+ *	contiguous pages and a bitmap records which clusters are in use.
+ *	Each segment using the area has a small cluster map indexed by
+ *	swap page index / vmSwapClusterPages.  Pages that are adjacent in
+ *	a segment's swap space are therefore adjacent in the area, and
+ *	new clusters are placed after the segment's previous cluster
+ *	when possible so that page-outs of a segment stay sequential.
+ *
+ *	The swap area is off unless vmUseSwapArea is set, and any
+ *	segment that can't be placed in the area falls back to a swap
+ *	file.  Segments that migrate are moved out of the area into a
+ *	regular swap file, since the area can't be reached from another
+ *	host.
+ *
+ *	The area is opened by name the first time it is needed, and
+ *	reopened the same way if its stream is invalidated because its
+ *	server's recovery failed.  The clusters keep their places in the
+ *	area across the reopen.
+ *
+ *	This monitor calls FS routines, so as with the swap directory
+ *	monitor these routines must not be called with vmMonitorLock held.
+ *	Opens and the FS reads and writes of pages are done outside the
+ *	monitor.  A count of the page I/Os using the area stream keeps a
+ *	replaced stream open until the last of them is done.
+ *
+ * Copyright 1992 Regents of the University of California
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ */
+
+#ifndef lint
+static char rcsid[] = "$Header$ SPRITE (Berkeley)";
+#endif /* not lint */
+
+#include <sprite.h>
+#include <fs.h>
+#include <vm.h>
+#include <vmInt.h>
+#include <sync.h>
+#include <timer.h>
+#include <vmSwapDir.h>
+#include <fsutil.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static Sync_Lock vmSwapAreaLock = Sync_LockInitStatic("vmSwapAreaLock");
+#define LOCKPTR &vmSwapAreaLock
+
+/*
+ * TRUE if heap and stack segments should use the swap area.  Changing
+ * this only affects segments that haven't opened their swap space yet.
+ */
+Boolean	vmUseSwapArea = FALSE;
+
+/*
+ * Number of contiguous pages in each cluster of the swap area.  This can
+ * only be changed before the swap area is opened.
+ */
+int	vmSwapClusterPages = VM_SWAP_CLUSTER_PAGES;
+
+/*
+ * A segment is only placed in the swap area if at least this many
+ * clusters are free.  This leaves room for segments already in the
+ * area to grow.
+ */
+int	vmSwapAreaReserve = 16;
+
+/*
+ * The stream for the swap area, the cluster allocation bitmap and the
+ * statistics.
+ */
+static Fs_Stream	*swapAreaStreamPtr = (Fs_Stream *)NIL;
+static Fs_Stream	*oldAreaStreamPtr = (Fs_Stream *)NIL;
+						/* Stream replaced by a reopen,
+						 * closed when the I/O using
+						 * it is done. */
+static int		areaStreamUsers = 0;	/* Page I/Os in progress. */
+static Boolean		openInProgress = FALSE;
+static Sync_Condition	areaOpened;		/* Notified when an open
+						 * of the area is done. */
+static Boolean		reopenInProgress = FALSE;
+static unsigned int	*clusterBitmap = (unsigned int *)NIL;
+static int		numClusters = 0;
+static int		nextCluster = 0;	/* Where the next search for
+						 * a free cluster starts. */
+static int		openRetryTime = 0;	/* Time in seconds before
+						 * which a failed open of
+						 * the area isn't retried. */
+static Vm_SwapAreaStats	swapAreaStats;
+
+#define	BITS_PER_WORD	(sizeof(unsigned int) * 8)
+#define	ClusterInUse(c) \
+	(clusterBitmap[(c) / BITS_PER_WORD] & (1 << ((c) % BITS_PER_WORD)))
+#define	MarkCluster(c) \
+	(clusterBitmap[(c) / BITS_PER_WORD] |= (1 << ((c) % BITS_PER_WORD)))
+#define	ClearCluster(c) \
+	(clusterBitmap[(c) / BITS_PER_WORD] &= ~(1 << ((c) % BITS_PER_WORD)))
+
+/*
+ * Seconds to wait before trying again to open an area that couldn't be
+ * opened.
+ */
+#define	OPEN_RETRY_SECONDS	20
+
+/*
+ * No cluster is assigned to a slot of a segment's cluster map.
+ */
+#define	NO_CLUSTER	-1
+
+static ReturnStatus OpenAreaFile _ARGS_((Fs_Stream **streamPtrPtr,
+	int *numPagesPtr));
+static ReturnStatus SetupArea _ARGS_((Fs_Stream *streamPtr, int numPages));
+static Fs_Stream *GetAreaStream _ARGS_((void));
+static void ReleaseAreaStream _ARGS_((ReturnStatus status));
+static void ScheduleReopen _ARGS_((void));
+static void ReopenSwapArea _ARGS_((ClientData data,
+	Proc_CallInfo *callInfoPtr));
+static void MarkPageWritten _ARGS_((Vm_Segment *segPtr, int pageIndex));
+static int AllocCluster _ARGS_((Vm_Segment *segPtr, int slot));
+static ReturnStatus AreaOffset _ARGS_((Vm_Segment *segPtr, int pageIndex,
+	Boolean allocate, int *offsetPtr));
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * OpenAreaFile --
+ *
+ *	Open the swap area for this machine.  The area is opened relative
+ *	to the swap directory, like the swap files.  This is called
+ *	outside the monitor since the open can take a while.
+ *
+ * Results:
+ *	SUCCESS or the error from the open.  The stream and the size of
+ *	the area in pages are returned.
+ *
+ * Side effects:
+ *	Opens a stream.
+ *
+ *----------------------------------------------------------------------
+ */
+static ReturnStatus
+OpenAreaFile(streamPtrPtr, numPagesPtr)
+    Fs_Stream	**streamPtrPtr;	/* Return, stream for the area. */
+    int		*numPagesPtr;	/* Return, size of the area. */
+{
+    ReturnStatus		status;
+    Proc_ControlBlock		*procPtr;
+    int				origID = NIL;
+    Fs_Stream			*swapDirPtr;
+    Fs_Stream			*origCwdPtr = (Fs_Stream *)NIL;
+    char			fileName[FS_MAX_PATH_NAME_LENGTH];
+    char			*areaNamePtr;
+    Fs_Attributes		attr;
+
+    *streamPtrPtr = (Fs_Stream *)NIL;
+    procPtr = Proc_GetEffectiveProc();
+    if (procPtr->effectiveUserID != PROC_SUPER_USER_ID) {
+	origID = procPtr->effectiveUserID;
+	procPtr->effectiveUserID = PROC_SUPER_USER_ID;
+    }
+    swapDirPtr = VmGetSwapStreamPtr();
+    if (swapDirPtr != (Fs_Stream *)NIL) {
+	origCwdPtr = procPtr->fsPtr->cwdPtr;
+	procPtr->fsPtr->cwdPtr = swapDirPtr;
+	areaNamePtr = VM_SWAP_AREA_NAME;
+    } else {
+	(void)sprintf(fileName, "%s%u/%s", VM_SWAP_DIR_NAME,
+		      (unsigned) Sys_GetHostId(), VM_SWAP_AREA_NAME);
+	areaNamePtr = fileName;
+    }
+    /*
+     * The area must be a regular file.  Pages are moved with Fs_PageRead
+     * and Fs_PageWrite, which devices don't implement.
+     */
+    status = Fs_Open(areaNamePtr, FS_READ | FS_WRITE | FS_FOLLOW | FS_SWAP,
+		     FS_FILE, 0, streamPtrPtr);
+    if (origID != NIL) {
+	procPtr->effectiveUserID = origID;
+    }
+    if (swapDirPtr != (Fs_Stream *)NIL) {
+	procPtr->fsPtr->cwdPtr = origCwdPtr;
+	VmDoneWithSwapStreamPtr();
+    }
+    if (status != SUCCESS) {
+	printf("Warning: OpenAreaFile: Could not open swap area %s, %s 0x%x\n",
+		areaNamePtr, "reason", status);
+	*streamPtrPtr = (Fs_Stream *)NIL;
+	return(status);
+    }
+
+    status = Fs_GetAttrStream(*streamPtrPtr, &attr);
+    if (status != SUCCESS) {
+	printf("Warning: OpenAreaFile: Could not stat swap area %s, %s 0x%x\n",
+		areaNamePtr, "reason", status);
+	(void)Fs_Close(*streamPtrPtr);
+	*streamPtrPtr = (Fs_Stream *)NIL;
+	return(status);
+    }
+    *numPagesPtr = attr.size >> vmPageShift;
+    return(SUCCESS);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SetupArea --
+ *
+ *	Set up the cluster bitmap for a newly opened swap area.  Clusters
+ *	are at most one word of pages, since a word of bits records which
+ *	pages of each cluster of a segment have been written.
+ *
+ * Results:
+ *	SUCCESS, or FAILURE if the area is too small to use.
+ *
+ * Side effects:
+ *	The swap area stream and bitmap are set up.
+ *
+ *----------------------------------------------------------------------
+ */
+static INTERNAL ReturnStatus
+SetupArea(streamPtr, numPages)
+    Fs_Stream	*streamPtr;	/* Newly opened area. */
+    int		numPages;	/* Its size. */
+{
+    int		numWords;
+
+    if (vmSwapClusterPages <= 0) {
+	vmSwapClusterPages = VM_SWAP_CLUSTER_PAGES;
+    }
+    if (vmSwapClusterPages > BITS_PER_WORD) {
+	vmSwapClusterPages = BITS_PER_WORD;
+    }
+    numClusters = numPages / vmSwapClusterPages;
+    if (numClusters <= vmSwapAreaReserve) {
+	printf("Warning: SetupArea: swap area has only %d pages.\n",
+		numPages);
+	numClusters = 0;
+	return(FAILURE);
+    }
+    swapAreaStreamPtr = streamPtr;
+    numWords = (numClusters + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    clusterBitmap = (unsigned int *)malloc(numWords * sizeof(unsigned int));
+    bzero((Address)clusterBitmap, numWords * sizeof(unsigned int));
+    nextCluster = 0;
+    bzero((Address)&swapAreaStats, sizeof(swapAreaStats));
+    swapAreaStats.clusterPages = vmSwapClusterPages;
+    swapAreaStats.numClusters = numClusters;
+    swapAreaStats.freeClusters = numClusters;
+    printf("Swap area: %d clusters of %d pages.\n", numClusters,
+	   vmSwapClusterPages);
+    return(SUCCESS);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetAreaStream --
+ *
+ *	Get the swap area stream for a page read or write.  This has to be
+ *	followed by a call to ReleaseAreaStream if NIL is not returned.
+ *
+ * Results:
+ *	The swap area stream, or NIL if it isn't open.
+ *
+ * Side effects:
+ *	Counts a user of the stream.
+ *
+ *----------------------------------------------------------------------
+ */
+static ENTRY Fs_Stream *
+GetAreaStream()
+{
+    Fs_Stream	*streamPtr;
+
+    LOCK_MONITOR;
+    streamPtr = swapAreaStreamPtr;
+    if (streamPtr != (Fs_Stream *)NIL) {
+	areaStreamUsers++;
+    }
+    UNLOCK_MONITOR;
+    return(streamPtr);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseAreaStream --
+ *
+ *	Done with the swap area stream after a page read or write.  A
+ *	stale handle means the area's server rebooted, so a check of the
+ *	stream is scheduled in case its recovery fails.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The last user of a replaced stream closes it.
+ *
+ *----------------------------------------------------------------------
+ */
+static ENTRY void
+ReleaseAreaStream(status)
+    ReturnStatus	status;		/* Status of the read or write. */
+{
+    Fs_Stream	*closePtr = (Fs_Stream *)NIL;
+
+    LOCK_MONITOR;
+    areaStreamUsers--;
+    if (areaStreamUsers == 0 && oldAreaStreamPtr != (Fs_Stream *)NIL) {
+	closePtr = oldAreaStreamPtr;
+	oldAreaStreamPtr = (Fs_Stream *)NIL;
+    }
+    if (status == FS_STALE_HANDLE) {
+	ScheduleReopen();
+    }
+    UNLOCK_MONITOR;
+    if (closePtr != (Fs_Stream *)NIL) {
+	(void)Fs_Close(closePtr);
+    }
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * VmSwapAreaRecover --
+ *
+ *	Called from Vm_Recovery after a server has come back.  If that
+ *	was the swap area's server and the recovery of the area stream
+ *	failed then the area is reopened.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Schedules a check of the swap area stream.
+ *
+ *----------------------------------------------------------------------
+ */
+ENTRY void
+VmSwapAreaRecover()
+{
+    LOCK_MONITOR;
+    ScheduleReopen();
+    UNLOCK_MONITOR;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ScheduleReopen --
+ *
+ *	Start a callback to check the swap area stream, and to reopen it
+ *	if it has become invalid.  Only one is outstanding at a time.  The
+ *	stream is never replaced while the callback is outstanding.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets reopenInProgress.
+ *
+ *----------------------------------------------------------------------
+ */
+static INTERNAL void
+ScheduleReopen()
+{
+    if (!reopenInProgress && swapAreaStreamPtr != (Fs_Stream *)NIL) {
+	reopenInProgress = TRUE;
+	Proc_CallFunc(ReopenSwapArea, (ClientData)NIL, 0);
+    }
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReopenSwapArea --
+ *
+ *	Reopen the swap area if its stream has been invalidated.  The
+ *	stream of a remote area is recovered along with the other handles
+ *	of its server, but if that recovery failed the stream stays
+ *	invalid and all page I/O to it fails.  The new stream is opened
+ *	outside the monitor, and the segments' clusters are kept since the
+ *	pages in the area survive the reboot of its server.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Replaces the swap area stream.  If the open fails it is tried
+ *	again in OPEN_RETRY_SECONDS seconds.
+ *
+ *----------------------------------------------------------------------
+ */
+/* ARGSUSED */
+static void
+ReopenSwapArea(data, callInfoPtr)
+    ClientData		data;
+    Proc_CallInfo	*callInfoPtr;
+{
+    register Fs_Stream	*streamPtr;
+    Fs_Stream		*newStreamPtr;
+    Fs_Stream		*closePtr = (Fs_Stream *)NIL;
+    ReturnStatus	status;
+    int			numPages;
+
+    LOCK_MONITOR;
+    streamPtr = swapAreaStreamPtr;
+    if (Fsutil_HandleValid((Fs_HandleHeader *)streamPtr) &&
+	    Fsutil_HandleValid(streamPtr->ioHandlePtr)) {
+	reopenInProgress = FALSE;
+	UNLOCK_MONITOR;
+	return;
+    }
+    if (oldAreaStreamPtr != (Fs_Stream *)NIL) {
+	/*
+	 * The stream replaced by the last reopen is still in use.
+	 */
+	callInfoPtr->interval = 20 * timer_IntOneSecond;
+	UNLOCK_MONITOR;
+	return;
+    }
+    UNLOCK_MONITOR;
+    status = OpenAreaFile(&newStreamPtr, &numPages);
+    if (status != SUCCESS) {
+	callInfoPtr->interval = OPEN_RETRY_SECONDS * timer_IntOneSecond;
+	return;
+    }
+    LOCK_MONITOR;
+    oldAreaStreamPtr = swapAreaStreamPtr;
+    swapAreaStreamPtr = newStreamPtr;
+    if (areaStreamUsers == 0) {
+	closePtr = oldAreaStreamPtr;
+	oldAreaStreamPtr = (Fs_Stream *)NIL;
+    }
+    swapAreaStats.reopens++;
+    reopenInProgress = FALSE;
+    UNLOCK_MONITOR;
+    if (closePtr != (Fs_Stream *)NIL) {
+	(void)Fs_Close(closePtr);
+    }
+    printf("Reopened swap area.\n");
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AllocCluster --
+ *
+ *	Allocate a cluster of the swap area for the given slot of a
+ *	segment's cluster map.  The cluster just after the one holding the
+ *	previous slot is preferred, and the one just before the cluster
+ *	holding the next slot after that, so that the segment's swap space
+ *	stays contiguous.  Otherwise the first free cluster at or after the
+ *	last one allocated is used.
+ *
+ * Results:
+ *	The cluster number, or NO_CLUSTER if the swap area is full.
+ *
+ * Side effects:
+ *	The cluster is marked in use.
+ *
+ *----------------------------------------------------------------------
+ */
+static INTERNAL int
+AllocCluster(segPtr, slot)
+    Vm_Segment	*segPtr;	/* Segment the cluster is for. */
+    int		slot;		/* Slot in its cluster map. */
+{
+    register int	cluster;
+    register int	i;
+
+    if (swapAreaStats.freeClusters == 0) {
+	return(NO_CLUSTER);
+    }
+    cluster = NO_CLUSTER;
+    if (slot > 0 && segPtr->swapMapPtr[slot - 1] != NO_CLUSTER) {
+	cluster = segPtr->swapMapPtr[slot - 1] + 1;
+    } else if (slot + 1 < segPtr->swapMapSize &&
+	       segPtr->swapMapPtr[slot + 1] != NO_CLUSTER) {
+	cluster = segPtr->swapMapPtr[slot + 1] - 1;
+    }
+    if (cluster >= 0 && cluster < numClusters && !ClusterInUse(cluster)) {
+	swapAreaStats.contigAllocs++;
+    } else {
+	cluster = nextCluster;
+	for (i = 0; i < numClusters; i++) {
+	    if (!ClusterInUse(cluster)) {
+		break;
+	    }
+	    cluster++;
+	    if (cluster == numClusters) {
+		cluster = 0;
+	    }
+	}
+    }
+    MarkCluster(cluster);
+    nextCluster = cluster + 1;
+    if (nextCluster == numClusters) {
+	nextCluster = 0;
+    }
+    swapAreaStats.freeClusters--;
+    swapAreaStats.clustersAllocated++;
+    return(cluster);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AreaOffset --
+ *
+ *	Translate a page index in a segment's swap space into a byte
+ *	offset in the swap area.  If allocate is TRUE the cluster holding
+ *	the page is allocated if the segment doesn't have it yet, growing
+ *	the segment's cluster map as needed.
+ *
+ * Results:
+ *	SUCCESS, or VM_SWAP_ERROR if the page has no cluster and either
+ *	allocate is FALSE or the swap area is full.
+ *
+ * Side effects:
+ *	The segment's cluster map may be grown and a cluster allocated.
+ *
+ *----------------------------------------------------------------------
+ */
+static ENTRY ReturnStatus
+AreaOffset(segPtr, pageIndex, allocate, offsetPtr)
+    register Vm_Segment	*segPtr;	/* Segment in the swap area. */
+    int			pageIndex;	/* Page index in its swap space. */
+    Boolean		allocate;	/* TRUE if a cluster should be
+					 * allocated for the page. */
+    int			*offsetPtr;	/* Byte offset in the area. */
+{
+    int		slot;
+    int		cluster;
+    int		newSize;
+    int		*newMapPtr;
+    unsigned int *newWrittenPtr;
+    register int i;
+
+    LOCK_MONITOR;
+
+    slot = pageIndex / vmSwapClusterPages;
+    if (slot >= segPtr->swapMapSize) {
+	if (!allocate) {
+	    UNLOCK_MONITOR;
+	    return(VM_SWAP_ERROR);
+	}
+	newSize = segPtr->swapMapSize * 2;
+	if (newSize <= slot) {
+	    newSize = slot + 1;
+	}
+	if (newSize < 8) {
+	    newSize = 8;
+	}
+	newMapPtr = (int *)malloc(newSize * sizeof(int));
+	newWrittenPtr = (unsigned int *)malloc(newSize * sizeof(unsigned int));
+	for (i = 0; i < segPtr->swapMapSize; i++) {
+	    newMapPtr[i] = segPtr->swapMapPtr[i];
+	    newWrittenPtr[i] = segPtr->swapWrittenPtr[i];
+	}
+	for (; i < newSize; i++) {
+	    newMapPtr[i] = NO_CLUSTER;
+	    newWrittenPtr[i] = 0;
+	}
+	if (segPtr->swapMapPtr != (int *)NIL) {
+	    free((Address)segPtr->swapMapPtr);
+	    free((Address)segPtr->swapWrittenPtr);
+	}
+	segPtr->swapMapPtr = newMapPtr;
+	segPtr->swapWrittenPtr = newWrittenPtr;
+	segPtr->swapMapSize = newSize;
+    }
+    cluster = segPtr->swapMapPtr[slot];
+    if (cluster == NO_CLUSTER) {
+	if (allocate) {
+	    cluster = AllocCluster(segPtr, slot);
+	}
+	if (cluster == NO_CLUSTER) {
+	    if (allocate) {
+		swapAreaStats.allocFailures++;
+		printf("Warning: AreaOffset: swap area is full.\n");
+	    }
+	    UNLOCK_MONITOR;
+	    return(VM_SWAP_ERROR);
+	}
+	segPtr->swapMapPtr[slot] = cluster;
+    }
+    *offsetPtr = (cluster * vmSwapClusterPages +
+		  pageIndex % vmSwapClusterPages) << vmPageShift;
+
+    UNLOCK_MONITOR;
+    return(SUCCESS);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MarkPageWritten --
+ *
+ *	Record that a page of a segment's swap space has been written to
+ *	the swap area, so it is copied if the segment is detached.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets the page's bit in the segment's written mask.
+ *
+ *----------------------------------------------------------------------
+ */
+static ENTRY void
+MarkPageWritten(segPtr, pageIndex)
+    Vm_Segment	*segPtr;	/* Segment in the swap area. */
+    int		pageIndex;	/* Page index in its swap space. */
+{
+    int		slot;
+
+    LOCK_MONITOR;
+    slot = pageIndex / vmSwapClusterPages;
+    if (slot < segPtr->swapMapSize) {
+	segPtr->swapWrittenPtr[slot] |= 1 << (pageIndex % vmSwapClusterPages);
+    }
+    UNLOCK_MONITOR;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * VmSwapAreaAttach --
+ *
+ *	Give a segment its swap space in the swap area instead of a swap
+ *	file.  Only heap and stack segments use the swap area.  The swap
+ *	area is opened the first time it is needed.
+ *
+ * Results:
+ *	SUCCESS if the segment now uses the swap area, FAILURE if it
+ *	should use a swap file.
+ *
+ * Side effects:
+ *	The segment is marked VM_SWAP_FILE_OPENED and VM_SWAP_AREA_SEG.
+ *
+ *----------------------------------------------------------------------
+ */
+ENTRY ReturnStatus
+VmSwapAreaAttach(segPtr)
+    register Vm_Segment	*segPtr;
+{
+    ReturnStatus	status;
+    Fs_Stream		*streamPtr;
+    int			numPages;
+    Time		curTime;
+
+    if (!vmUseSwapArea ||
+	    (segPtr->type != VM_HEAP && segPtr->type != VM_STACK)) {
+	return(FAILURE);
+    }
+
+    LOCK_MONITOR;
+
+    while (openInProgress) {
+	(void)Sync_Wait(&areaOpened, FALSE);
+    }
+    Timer_GetTimeOfDay(&curTime, (int *) NIL, (Boolean *) NIL);
+    if (swapAreaStreamPtr == (Fs_Stream *)NIL &&
+	    curTime.seconds >= openRetryTime) {
+	/*
+	 * Open the area outside the monitor, since the open goes to the
+	 * swap server.  Other attaches wait for it to finish.  If the
+	 * open fails segments use swap files for a while before it is
+	 * tried again, so a swap server that is down doesn't hold up
+	 * every attach.
+	 */
+	openInProgress = TRUE;
+	UNLOCK_MONITOR;
+	status = OpenAreaFile(&streamPtr, &numPages);
+	LOCK_MONITOR;
+	if (status == SUCCESS) {
+	    status = SetupArea(streamPtr, numPages);
+	}
+	if (status != SUCCESS) {
+	    openRetryTime = curTime.seconds + OPEN_RETRY_SECONDS;
+	}
+	openInProgress = FALSE;
+	Sync_Broadcast(&areaOpened);
+	if (status != SUCCESS && streamPtr != (Fs_Stream *)NIL) {
+	    UNLOCK_MONITOR;
+	    (void)Fs_Close(streamPtr);
+	    return(FAILURE);
+	}
+    }
+    if (swapAreaStreamPtr == (Fs_Stream *)NIL) {
+	UNLOCK_MONITOR;
+	return(FAILURE);
+    }
+    if (swapAreaStats.freeClusters < vmSwapAreaReserve) {
+	swapAreaStats.fileFallbacks++;
+	UNLOCK_MONITOR;
+	return(FAILURE);
+    }
+    /*
+     * The segment doesn't hold the area stream, since that may be
+     * replaced by a reopen.  Page-out recovery waits on the swap
+     * directory instead.
+     */
+    segPtr->swapFilePtr = (Fs_Stream *)NIL;
+    segPtr->swapMapPtr = (int *)NIL;
+    segPtr->swapWrittenPtr = (unsigned int *)NIL;
+    segPtr->swapMapSize = 0;
+    segPtr->flags |= VM_SWAP_FILE_OPENED | VM_SWAP_AREA_SEG;
+    swapAreaStats.numSegs++;
+
+    UNLOCK_MONITOR;
+    return(SUCCESS);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * VmSwapAreaFree --
+ *
+ *	Release the clusters and cluster map of a segment that is being
+ *	deleted.  The swap area stream itself stays open.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The segment's clusters are freed and it is no longer marked as
+ *	using the swap area.
+ *
+ *----------------------------------------------------------------------
+ */
+ENTRY void
+VmSwapAreaFree(segPtr)
+    register Vm_Segment	*segPtr;
+{
+    register int	i;
+
+    LOCK_MONITOR;
+
+    for (i = 0; i < segPtr->swapMapSize; i++) {
+	if (segPtr->swapMapPtr[i] != NO_CLUSTER) {
+	    ClearCluster(segPtr->swapMapPtr[i]);
+	    swapAreaStats.freeClusters++;
+	    swapAreaStats.clustersFreed++;
+	}
+    }
+    if (segPtr->swapMapPtr != (int *)NIL) {
+	free((Address)segPtr->swapMapPtr);
+	free((Address)segPtr->swapWrittenPtr);
+    }
+    segPtr->swapMapPtr = (int *)NIL;
+    segPtr->swapWrittenPtr = (unsigned int *)NIL;
+    segPtr->swapMapSize = 0;
+    segPtr->flags &= ~VM_SWAP_AREA_SEG;
+    swapAreaStats.numSegs--;
+
+    UNLOCK_MONITOR;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * VmSwapAreaRead --
+ *
+ *	Read a page of a segment's swap space from the swap area.
+ *
+ * Results:
+ *	SUCCESS or an error from the read.  VM_SWAP_ERROR if the page
+ *	was never written.
+ *
+ * Side effects:
+ *	The page is filled in.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+VmSwapAreaRead(segPtr, pageIndex, pageAddr)
+    Vm_Segment	*segPtr;	/* Segment in the swap area. */
+    int		pageIndex;	/* Page index in its swap space. */
+    Address	pageAddr;	/* Where to put the page. */
+{
+    ReturnStatus	status;
+    int			offset;
+    Fs_Stream		*streamPtr;
+
+    status = AreaOffset(segPtr, pageIndex, FALSE, &offset);
+    if (status != SUCCESS) {
+	printf("Warning: VmSwapAreaRead: page %d of segment %d %s.\n",
+		pageIndex, segPtr->segNum, "not in swap area");
+	return(status);
+    }
+    streamPtr = GetAreaStream();
+    swapAreaStats.pagesRead++;
+    status = Fs_PageRead(streamPtr, pageAddr, offset, vm_PageSize,
+			 FS_SWAP_PAGE);
+    ReleaseAreaStream(status);
+    return(status);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * VmSwapAreaWrite --
+ *
+ *	Write a page of a segment's swap space to the swap area,
+ *	allocating a cluster for it if necessary.
+ *
+ * Results:
+ *	SUCCESS or an error from the write.  VM_SWAP_ERROR if the swap
+ *	area is full.
+ *
+ * Side effects:
+ *	A cluster may be allocated for the segment, and the page is
+ *	marked as written.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+VmSwapAreaWrite(segPtr, pageIndex, pageAddr, toDisk)
+    Vm_Segment	*segPtr;	/* Segment in the swap area. */
+    int		pageIndex;	/* Page index in its swap space. */
+    Address	pageAddr;	/* Page to write. */
+    Boolean	toDisk;		/* TRUE to write through to disk. */
+{
+    ReturnStatus	status;
+    int			offset;
+    Fs_Stream		*streamPtr;
+
+    status = AreaOffset(segPtr, pageIndex, TRUE, &offset);
+    if (status != SUCCESS) {
+	return(status);
+    }
+    streamPtr = GetAreaStream();
+    swapAreaStats.pagesWritten++;
+    status = Fs_PageWrite(streamPtr, pageAddr, offset, vm_PageSize, toDisk);
+    ReleaseAreaStream(status);
+    if (status == SUCCESS) {
+	MarkPageWritten(segPtr, pageIndex);
+    }
+    return(status);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * VmSwapPageCopy --
+ *
+ *	Copy a page of swap space from one segment to another.  The page
+ *	has the same page index in both.  If neither segment is in the swap
+ *	area the file system copies the page in place, otherwise the page is
+ *	read into a buffer and written to the destination.
+ *
+ * Results:
+ *	SUCCESS or an error from the copy.
+ *
+ * Side effects:
+ *	A cluster may be allocated for the destination segment.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+VmSwapPageCopy(srcSegPtr, destSegPtr, pageIndex)
+    Vm_Segment	*srcSegPtr;	/* Segment to copy from. */
+    Vm_Segment	*destSegPtr;	/* Segment to copy to. */
+    int		pageIndex;	/* Page index in their swap space. */
+{
+    ReturnStatus	status;
+    Address		bufPtr;
+
+    if (!(srcSegPtr->flags & VM_SWAP_AREA_SEG) &&
+	    !(destSegPtr->flags & VM_SWAP_AREA_SEG)) {
+	return(Fs_PageCopy(srcSegPtr->swapFilePtr, destSegPtr->swapFilePtr,
+			   pageIndex << vmPageShift, vm_PageSize));
+    }
+    bufPtr = (Address)malloc(vm_PageSize);
+    if (srcSegPtr->flags & VM_SWAP_AREA_SEG) {
+	status = VmSwapAreaRead(srcSegPtr, pageIndex, bufPtr);
+    } else {
+	status = Fs_PageRead(srcSegPtr->swapFilePtr, bufPtr,
+			     pageIndex << vmPageShift, vm_PageSize,
+			     FS_SWAP_PAGE);
+    }
+    if (status == SUCCESS) {
+	if (destSegPtr->flags & VM_SWAP_AREA_SEG) {
+	    status = VmSwapAreaWrite(destSegPtr, pageIndex, bufPtr, FALSE);
+	} else {
+	    status = Fs_PageWrite(destSegPtr->swapFilePtr, bufPtr,
+				  pageIndex << vmPageShift, vm_PageSize,
+				  FALSE);
+	}
+    }
+    free(bufPtr);
+    return(status);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * VmSwapAreaDetach --
+ *
+ *	Move a segment's swap space out of the swap area into a swap file.
+ *	This is done before a segment is migrated, since the new host
+ *	can only get at the swap space through a file.  The segment must
+ *	have no resident pages and no page-outs in progress.  Only the
+ *	pages that were written to the area are copied.
+ *
+ * Results:
+ *	SUCCESS or an error if the swap file couldn't be opened or written.
+ *
+ * Side effects:
+ *	A swap file is created for the segment and the segment's clusters
+ *	are freed.  If the copy fails the segment is left in the swap
+ *	area and its swap file is removed.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+VmSwapAreaDetach(segPtr)
+    register Vm_Segment	*segPtr;
+{
+    ReturnStatus	status;
+    Address		bufPtr;
+    int			*mapPtr;
+    unsigned int	*writtenPtr;
+    int			mapSize;
+    int			slot;
+    Fs_Stream		*streamPtr;
+    int			pageIndex;
+    register int	i;
+
+    VmSwapFileLock(segPtr);
+    if (!(segPtr->flags & VM_SWAP_AREA_SEG)) {
+	VmSwapFileUnlock(segPtr);
+	return(SUCCESS);
+    }
+    /*
+     * Take the cluster map away from the segment while the pages are
+     * copied, so the segment looks like one with a fresh swap file.
+     */
+    mapPtr = segPtr->swapMapPtr;
+    writtenPtr = segPtr->swapWrittenPtr;
+    mapSize = segPtr->swapMapSize;
+    segPtr->swapMapPtr = (int *)NIL;
+    segPtr->swapWrittenPtr = (unsigned int *)NIL;
+    segPtr->swapMapSize = 0;
+    segPtr->flags &= ~(VM_SWAP_FILE_OPENED | VM_SWAP_AREA_SEG);
+    segPtr->swapFilePtr = (Fs_Stream *)NIL;
+    status = VmCreateSwapFile(segPtr);
+    if (status != SUCCESS) {
+	segPtr->swapMapPtr = mapPtr;
+	segPtr->swapWrittenPtr = writtenPtr;
+	segPtr->swapMapSize = mapSize;
+	segPtr->swapFilePtr = (Fs_Stream *)NIL;
+	segPtr->flags |= VM_SWAP_FILE_OPENED | VM_SWAP_AREA_SEG;
+	VmSwapFileUnlock(segPtr);
+	return(status);
+    }
+    VmSwapFileUnlock(segPtr);
+
+    bufPtr = (Address)malloc(vm_PageSize);
+    streamPtr = GetAreaStream();
+    for (slot = 0; slot < mapSize && status == SUCCESS; slot++) {
+	if (mapPtr[slot] == NO_CLUSTER) {
+	    continue;
+	}
+	for (i = 0; i < vmSwapClusterPages; i++) {
+	    if (!(writtenPtr[slot] & (1 << i))) {
+		continue;
+	    }
+	    pageIndex = slot * vmSwapClusterPages + i;
+	    status = Fs_PageRead(streamPtr, bufPtr,
+		    (mapPtr[slot] * vmSwapClusterPages + i) << vmPageShift,
+		    vm_PageSize, FS_SWAP_PAGE);
+	    if (status != SUCCESS) {
+		break;
+	    }
+	    status = Fs_PageWrite(segPtr->swapFilePtr, bufPtr,
+		    pageIndex << vmPageShift, vm_PageSize, FALSE);
+	    if (status != SUCCESS) {
+		break;
+	    }
+	    swapAreaStats.pagesDetached++;
+	}
+    }
+    ReleaseAreaStream(status);
+    free(bufPtr);
+
+    if (status != SUCCESS) {
+	/*
+	 * The area still holds the only copy of some pages, so the
+	 * segment stays in the area and the new swap file is removed.
+	 * The migration fails and the process keeps running here.
+	 */
+	printf("Warning: VmSwapAreaDetach: Could not copy %s %d, reason 0x%x\n",
+		"swap space of segment", segPtr->segNum, status);
+	VmSwapFileLock(segPtr);
+	VmSwapFileRemove(segPtr->swapFilePtr, segPtr->swapFileName);
+	segPtr->swapFileName = (char *)NIL;
+	segPtr->swapFilePtr = (Fs_Stream *)NIL;
+	segPtr->swapMapPtr = mapPtr;
+	segPtr->swapWrittenPtr = writtenPtr;
+	segPtr->swapMapSize = mapSize;
+	segPtr->flags |= VM_SWAP_FILE_OPENED | VM_SWAP_AREA_SEG;
+	VmSwapFileUnlock(segPtr);
+	return(status);
+    }
+    segPtr->swapMapPtr = mapPtr;
+    segPtr->swapWrittenPtr = writtenPtr;
+    segPtr->swapMapSize = mapSize;
+    VmSwapAreaFree(segPtr);
+    return(SUCCESS);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * VmSwapAreaGetStats --
+ *
+ *	Return the swap area statistics.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	*statsPtr is filled in.
+ *
+ *----------------------------------------------------------------------
+ */
+ENTRY void
+VmSwapAreaGetStats(statsPtr)
+    Vm_SwapAreaStats	*statsPtr;
+{
+    LOCK_MONITOR;
+
+    *statsPtr = swapAreaStats;
+    statsPtr->useSwapArea = vmUseSwapArea;
+
+    UNLOCK_MONITOR;
+}
@@ -133,6 +133,33 @@ Vm_OpenSwapDirectory(data, callInfoPtr)
  *
  * VmOpenSwapFile --
  *
+ *	Open the swap space for this segment.  This is in the swap area
+ *	if it is in use and has room, otherwise it is a swap file.
+ *
+ * Results:
+ *	SUCCESS unless swap file could not be opened.
+ *
+ * Side effects:
+ *	Swap file pointer is set in the segment's data struct.
+ *
+ *----------------------------------------------------------------------
+ */
+ReturnStatus
+VmOpenSwapFile(segPtr)
+    register	Vm_Segment	*segPtr;
+{
+    if (VmSwapAreaAttach(segPtr) == SUCCESS) {
+	return(SUCCESS);
+    }
+    return(VmCreateSwapFile(segPtr));
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * VmCreateSwapFile --
+ *
  *	Open a swap file for this segment.  Store the name of the swap
  *	file with the segment.
  *
@@ -145,7 +172,7 @@ Vm_OpenSwapDirectory(data, callInfoPtr)
  *----------------------------------------------------------------------
  */
 ReturnStatus
-VmOpenSwapFile(segPtr)
+VmCreateSwapFile(segPtr)
     register	Vm_Segment	*segPtr;
 {
     int				status;
@@ -199,7 +226,7 @@ VmOpenSwapFile(segPtr)
 	VmDoneWithSwapStreamPtr();
     }
     if (status != SUCCESS) {
-	printf("%s VmOpenSwapFile: Could not open swap file %s, reason 0x%x\n", 
+	printf("%s VmCreateSwapFile: Could not open swap file %s, reason 0x%x\n", 
 		"Warning:", segPtr->swapFileName, status);
 	return(status);
     }
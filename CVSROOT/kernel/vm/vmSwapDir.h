@@ -18,6 +18,13 @@
  */
 #define	VM_SWAP_DIR_NAME	"/swap/"
 
+/*
+ * The name of the swap area within the swap directory, and the default
+ * number of pages in each cluster of the swap area.
+ */
+#define	VM_SWAP_AREA_NAME	"area"
+#define	VM_SWAP_CLUSTER_PAGES	8
+
 extern void Vm_OpenSwapDirectory _ARGS_((ClientData data, Proc_CallInfo *callInfoPtr));
 extern void VmReopenSwapDirectory _ARGS_((void));
 extern Fs_Stream *VmGetSwapStreamPtr _ARGS_((void));
@@ -424,6 +424,61 @@ Vm_Cmd(command, arg)
 	case VM_SET_WRITEABLE_REF_PAGEOUT:
 	    SETVAR(vmWriteableRefPageout, arg);
 	    break;
+	case VM_GET_SEG_COW_STATS: {
+	    extern int		vmNumSegments;
+	    Vm_SegCOWStats	cowStats;
+	    Vm_Segment		*segPtr;
+
+	    status = Vm_CopyIn(sizeof(cowStats), (Address)arg,
+				(Address)&cowStats);
+	    if (status != SUCCESS) {
+		break;
+	    }
+	    if (cowStats.segNum <= 0 || cowStats.segNum >= vmNumSegments) {
+		status = SYS_INVALID_ARG;
+		break;
+	    }
+	    segPtr = VmGetSegPtr(cowStats.segNum);
+	    cowStats.numCOWPages = segPtr->numCOWPages;
+	    cowStats.numCORPages = segPtr->numCORPages;
+	    cowStats.numForkCORPages = segPtr->numForkCORPages;
+	    cowStats.numCOWBreaks = segPtr->numCOWBreaks;
+	    cowStats.numCORBreaks = segPtr->numCORBreaks;
+	    if (Vm_CopyOut(sizeof(cowStats), (Address)&cowStats,
+			   (Address)arg) != SUCCESS) {
+		status = SYS_ARG_NOACCESS;
+	    }
+	    break;
+	}
+	case VM_SET_USE_SWAP_AREA:
+	    SETVAR(vmUseSwapArea, arg);
+	    break;
+	case VM_GET_SWAP_AREA_STATS: {
+	    Vm_SwapAreaStats	areaStats;
+
+	    VmSwapAreaGetStats(&areaStats);
+	    if (Vm_CopyOut(sizeof(areaStats), (Address)&areaStats,
+			   (Address)arg) != SUCCESS) {
+		status = SYS_ARG_NOACCESS;
+	    }
+	    break;
+	}
+	case VM_SET_MIG_PRE_COPY:
+	    SETVAR(vmMigPreCopyPasses, arg);
+	    break;
+	case VM_SET_ZERO_POOL_PAGES:
+	    SETVAR(vmZeroPoolPages, arg);
+	    break;
+	case VM_GET_ZERO_PAGE_STATS: {
+	    Vm_ZeroPageStats	zeroStats;
+
+	    VmGetZeroPageStats(&zeroStats);
+	    if (Vm_CopyOut(sizeof(zeroStats), (Address)&zeroStats,
+			   (Address)arg) != SUCCESS) {
+		status = SYS_ARG_NOACCESS;
+	    }
+	    break;
+	}
 	case 1999:
 	    SETVAR(vmShmDebug, arg);
 	    break;